@@ -31,11 +31,22 @@ const char *AAY_MSG_TYPE = "AAY";
  * content fields so that the data can be easily obtained at a later
  * point in time.
  * @param buf Pointer to AAY message raw content.
+ * @param size Size of the raw content in bytes.
  * @param aay Pointer to struct to store parsed AAY message content in.
  * @return An integer representing success (zero) or failure (non-zero).
  * @retval 0 Successfully parsed the aay message.
+ * @retval RET_BAD_SIZE Failed, the content is shorter than the message.
  */
-int zdtm_parse_raw_aay_msg(void *buf, struct zdtm_aay_msg_content *aay) {
-    memcpy((void *)aay->uk_data_0, buf, 3);
+int zdtm_parse_raw_aay_msg(void *buf, uint16_t size,
+    struct zdtm_aay_msg_content *aay) {
+    zdtm_reader rd;
+
+    zdtm_rd_init(&rd, buf, size);
+    if (zdtm_rd_need(&rd, sizeof(aay->uk_data_0)) != 0) {
+        return RET_BAD_SIZE;
+    }
+
+    zdtm_rd_bytes(&rd, aay->uk_data_0, sizeof(aay->uk_data_0));
+
     return 0;
 }
@@ -37,6 +37,7 @@ struct zdtm_aay_msg_content {
 extern const char *AAY_MSG_TYPE;
 #define IS_AAY(x) (memcmp(x->body.type, AAY_MSG_TYPE, MSG_TYPE_SIZE) == 0)
 
-int zdtm_parse_raw_aay_msg(void *buf, struct zdtm_aay_msg_content *aay);
+int zdtm_parse_raw_aay_msg(void *buf, uint16_t size,
+    struct zdtm_aay_msg_content *aay);
 
 #endif
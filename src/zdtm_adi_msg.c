@@ -31,31 +31,36 @@ const char *ADI_MSG_TYPE = "ADI";
  * content fields so that the data can be easily obtained at a later
  * point in time.
  * @param buf Pointer to ADI message raw content.
+ * @param size Size of the raw content in bytes.
  * @param adi Pointer to struct to store parsed ADI message content in.
  * @return An integer representing success (zero) or failure (non-zero).
  * @retval 0 Successfully parsed the adi message.
  * @retval -1 Failed to allocate memory for adi message params.
- * @retval -2 Failed to allocate memory for a adi msg param description.
+ * @retval -2 Failed to allocate memory for a adi msg param description,
+ * or the description is cut short.
+ * @retval RET_BAD_SIZE Failed, the content is shorter than the message.
  */
-int zdtm_parse_raw_adi_msg(void *buf, struct zdtm_adi_msg_content *adi) {
+int zdtm_parse_raw_adi_msg(void *buf, uint16_t size,
+    struct zdtm_adi_msg_content *adi) {
+    zdtm_reader rd;
+    const unsigned char *abrevs, *type_ids;
     int i, j;
 
-#ifdef WORDS_BIGENDIAN
-    adi->num_cards = zdtm_liltobigl(*((uint32_t *)buf));
-    buf += sizeof(uint32_t);
-
-    adi->num_params = zdtm_liltobigs(*((uint16_t *)buf));
-    buf += sizeof(uint16_t);
-#else
-    adi->num_cards = *((uint32_t *)buf);
-    buf += sizeof(uint32_t);
+    zdtm_rd_init(&rd, buf, size);
+    if (zdtm_rd_need(&rd, sizeof(uint32_t) + sizeof(uint16_t) + 1) != 0) {
+        return RET_BAD_SIZE;
+    }
 
-    adi->num_params = *((uint16_t *)buf);
-    buf += sizeof(uint16_t);
-#endif
+    adi->num_cards = zdtm_rd_u32(&rd);
+    adi->num_params = zdtm_rd_u16(&rd);
+    adi->uk_data_0 = zdtm_rd_u8(&rd);
 
-    adi->uk_data_0 = *((unsigned char *)buf);
-    buf += 1;
+    // The abrevs and the type ids come as two arrays ahead of the descs.
+    if (zdtm_rd_need(&rd, (size_t)adi->num_params * 5) != 0) {
+        return RET_BAD_SIZE;
+    }
+    abrevs = zdtm_rd_skip(&rd, (size_t)adi->num_params * 4);
+    type_ids = zdtm_rd_skip(&rd, adi->num_params);
 
     adi->params = (struct zdtm_adi_msg_param *)malloc(
         (adi->num_params * sizeof(struct zdtm_adi_msg_param)));
@@ -63,25 +68,17 @@ int zdtm_parse_raw_adi_msg(void *buf, struct zdtm_adi_msg_content *adi) {
         return -1;
 
     for (i = 0; i < adi->num_params; i++) {
-        memcpy((void *)adi->params[i].abrev, buf, 4);
-        buf += 4;
-    }
+        memcpy((void *)adi->params[i].abrev, abrevs + (i * 4), 4);
+        adi->params[i].type_id = type_ids[i];
 
-    for (i = 0; i < adi->num_params; i++) {
-        memcpy((void *)&adi->params[i].type_id, buf, 1);
-        buf += 1;
-    }
-
-    for (i = 0; i < adi->num_params; i++) {
-#ifdef WORDS_BIGENDIAN
-        adi->params[i].desc_len = zdtm_liltobigs(*((uint16_t *)buf));
-#else
-        adi->params[i].desc_len = *((uint16_t *)buf);
-#endif
-        buf += sizeof(uint16_t);
-
-        adi->params[i].desc = \
-            (unsigned char *)malloc(adi->params[i].desc_len);
+        adi->params[i].desc = NULL;
+        if (zdtm_rd_need(&rd, sizeof(uint16_t)) == 0) {
+            adi->params[i].desc_len = zdtm_rd_u16(&rd);
+            if (zdtm_rd_need(&rd, adi->params[i].desc_len) == 0) {
+                adi->params[i].desc = \
+                    (unsigned char *)malloc(adi->params[i].desc_len);
+            }
+        }
         if (adi->params[i].desc == NULL) {
             for (j = 0; j < i; j++) {
                 free((void *)adi->params[j].desc);
@@ -90,8 +87,7 @@ int zdtm_parse_raw_adi_msg(void *buf, struct zdtm_adi_msg_content *adi) {
             return -2;
         }
 
-        memcpy((void *)adi->params[i].desc, buf, adi->params[i].desc_len);
-        buf += adi->params[i].desc_len;
+        zdtm_rd_bytes(&rd, adi->params[i].desc, adi->params[i].desc_len);
     }
 
     return 0;
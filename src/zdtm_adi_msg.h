@@ -41,6 +41,7 @@ struct zdtm_adi_msg_content {
 extern const char *ADI_MSG_TYPE;
 #define IS_ADI(x) (memcmp(x->body.type, ADI_MSG_TYPE, MSG_TYPE_SIZE) == 0)
 
-int zdtm_parse_raw_adi_msg(void *buf, struct zdtm_adi_msg_content *adi);
+int zdtm_parse_raw_adi_msg(void *buf, uint16_t size,
+    struct zdtm_adi_msg_content *adi);
 
 #endif
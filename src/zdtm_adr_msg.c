@@ -23,35 +23,38 @@
 
 const char *ADR_MSG_TYPE = "ADR";
 
-int zdtm_parse_raw_adr_msg(void *buf, struct zdtm_adr_msg_content *adr) {
+int zdtm_parse_raw_adr_msg(void *buf, uint16_t size,
+    struct zdtm_adr_msg_content *adr) {
+    zdtm_reader rd;
     int i, j;
 
-    memcpy(adr->uk, buf, 2);
-    buf += 2;
+    zdtm_rd_init(&rd, buf, size);
+    if (zdtm_rd_need(&rd, sizeof(adr->uk) + sizeof(uint16_t)) != 0) {
+        return RET_BAD_SIZE;
+    }
+
+    zdtm_rd_bytes(&rd, adr->uk, sizeof(adr->uk));
+    adr->num_params = zdtm_rd_u16(&rd);
+
+    // Each param takes its length at the least.
+    if (zdtm_rd_need(&rd, (size_t)adr->num_params * sizeof(uint32_t)) != 0) {
+        return RET_BAD_SIZE;
+    }
 
-#ifdef WORDS_BIGENDIAN
-    adr->num_params = zdtm_liltobigl(*((uint16_t *)buf));
-    buf += sizeof(uint16_t);
-#else
-    adr->num_params = *((uint16_t *)buf);
-    buf += sizeof(uint16_t);
-#endif
-        
     adr->params = (struct zdtm_adr_msg_param *)malloc(
         (adr->num_params * sizeof(struct zdtm_adr_msg_param)));
     if (adr->params == NULL)
         return -1;
 
     for (i = 0; i < adr->num_params; i++) {
-#ifdef WORDS_BIGENDIAN
-        adr->params[i].param_len = zdtm_liltobigl(*((uint32_t *)buf));
-        buf += sizeof(uint32_t);
-#else
-        adr->params[i].param_len = *((uint32_t *)buf);
-        buf += sizeof(uint32_t);
-#endif
-        
-        adr->params[i].param_data = malloc(adr->params[i].param_len);
+        adr->params[i].param_data = NULL;
+        if (zdtm_rd_need(&rd, sizeof(uint32_t)) == 0) {
+            adr->params[i].param_len = zdtm_rd_u32(&rd);
+            if (zdtm_rd_need(&rd, adr->params[i].param_len) == 0) {
+                adr->params[i].param_data =
+                    malloc(adr->params[i].param_len);
+            }
+        }
         if (adr->params[i].param_data == NULL) {
             for (j = 0; j < i; j++) {
                 /* free each previously allocated params data */
@@ -61,8 +64,8 @@ int zdtm_parse_raw_adr_msg(void *buf, struct zdtm_adr_msg_content *adr) {
             free(adr->params);
             return -2;
         }
-        memcpy(adr->params[i].param_data, buf, adr->params[i].param_len);
-        buf += adr->params[i].param_len;
+        zdtm_rd_bytes(&rd, adr->params[i].param_data,
+            adr->params[i].param_len);
     }
 
     return 0;
@@ -38,6 +38,7 @@ struct zdtm_adr_msg_content {
 extern const char *ADR_MSG_TYPE;
 #define IS_ADR(x) (memcmp(x->body.type, ADR_MSG_TYPE, MSG_TYPE_SIZE) == 0)
 
-int zdtm_parse_raw_adr_msg(void *buf, struct zdtm_adr_msg_content *adr);
+int zdtm_parse_raw_adr_msg(void *buf, uint16_t size,
+    struct zdtm_adr_msg_content *adr);
 
 #endif
@@ -23,26 +23,28 @@
 
 const char *ADW_MSG_TYPE = "ADW";
 
-int zdtm_parse_raw_adw_msg(void *buf, struct zdtm_adw_msg_content *adw) {
+int zdtm_parse_raw_adw_msg(void *buf, uint16_t size,
+    struct zdtm_adw_msg_content *adw) {
+    zdtm_reader rd;
 
-    memcpy(adw->uk, buf, 4);
-    buf += 4;
+    zdtm_rd_init(&rd, buf, size);
+    if (zdtm_rd_need(&rd, sizeof(adw->uk) + sizeof(uint16_t) +
+        sizeof(uint32_t)) != 0) {
+        return RET_BAD_SIZE;
+    }
 
-#ifdef WORDS_BIGENDIAN
-    adw->num_sync_ids = zdtm_liltobigl(*((uint16_t *)buf));
-    buf += sizeof(uint16_t);
-#else
-    adw->num_sync_ids = *((uint16_t *)buf);
-    buf += sizeof(uint16_t);
-#endif
+    zdtm_rd_bytes(&rd, adw->uk, sizeof(adw->uk));
+    adw->num_sync_ids = zdtm_rd_u16(&rd);
 
-#ifdef WORDS_BIGENDIAN
-    adw->sync_id = zdtm_liltobigl(*((uint32_t *)buf));
-    buf += sizeof(uint32_t);
-#else
-    adw->sync_id = *((uint32_t *)buf);
-    buf += sizeof(uint32_t);
-#endif
+    /* A write of several records is answered with the sync id of each,
+     * the first of which is the sync_id of a write of one. The ids are
+     * left in the raw content for the caller to convert in bulk. */
+    adw->p_raw_sync_ids = rd.pos;
+    if ((adw->num_sync_ids > 1) && (zdtm_rd_need(&rd,
+        (size_t)adw->num_sync_ids * sizeof(uint32_t)) != 0)) {
+        return RET_BAD_SIZE;
+    }
+    adw->sync_id = zdtm_rd_u32(&rd);
 
     return 0;
 }
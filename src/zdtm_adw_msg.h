@@ -28,11 +28,13 @@ struct zdtm_adw_msg_content {
     unsigned char uk[4];
     uint16_t num_sync_ids;
     uint32_t sync_id;
+    const unsigned char *p_raw_sync_ids;    // num_sync_ids raw sync ids
 };
 
 extern const char *ADW_MSG_TYPE;
 #define IS_ADW(x) (memcmp(x->body.type, ADW_MSG_TYPE, MSG_TYPE_SIZE) == 0)
 
-int zdtm_parse_raw_adw_msg(void *buf, struct zdtm_adw_msg_content *adw);
+int zdtm_parse_raw_adw_msg(void *buf, uint16_t size,
+    struct zdtm_adw_msg_content *adw);
 
 #endif /* _ZDTM_ADW_MSG_H_ */
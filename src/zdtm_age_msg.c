@@ -0,0 +1,63 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+#include "zdtm_age_msg.h"
+
+const char *AGE_MSG_TYPE = "AGE";
+
+/**
+ * Parse a raw AGE message.
+ *
+ * The zdtm_parse_raw_age_msg function takes a raw AGE message and
+ * parses it into it's appropriate components and fills in the age
+ * content fields so that the data can be easily obtained at a later
+ * point in time.
+ * @param buf Pointer to AGE message raw content.
+ * @param size Size of the raw content in bytes.
+ * @param age Pointer to struct to store parsed AGE message content in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully parsed the age message.
+ * @retval -1 Failed, the chunk lies outside of the file.
+ * @retval RET_BAD_SIZE Failed, the content is shorter than the message.
+ */
+int zdtm_parse_raw_age_msg(void *buf, uint16_t size,
+    struct zdtm_age_msg_content *age) {
+    zdtm_reader rd;
+
+    zdtm_rd_init(&rd, buf, size);
+    if (zdtm_rd_need(&rd, 2 * sizeof(uint32_t) + sizeof(uint16_t)) != 0) {
+        return RET_BAD_SIZE;
+    }
+
+    age->file_size = zdtm_rd_u32(&rd);
+    age->offset = zdtm_rd_u32(&rd);
+    age->data_len = zdtm_rd_u16(&rd);
+
+    if ((age->offset > age->file_size) ||
+        (age->data_len > (age->file_size - age->offset)) ||
+        (zdtm_rd_need(&rd, age->data_len) != 0)) {
+        return -1;
+    }
+
+    age->data = (unsigned char *)zdtm_rd_skip(&rd, age->data_len);
+
+    return 0;
+}
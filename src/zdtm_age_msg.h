@@ -0,0 +1,51 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+#ifndef ZDTM_AGE_MSG_H
+#define ZDTM_AGE_MSG_H
+
+#include "zdtm_common.h"
+
+/**
+ * Zaurus AGE message content.
+ *
+ * The zdtm_age_msg_content is a structure which represents an AGE
+ * Zaurus message content after being parsed from the raw message
+ * content. An AGE message carries a chunk of the contents of the DTM
+ * index file or DTM box file requested with an RGE message. Files
+ * larger than what fits in a single message are sent as a sequence of
+ * AGE messages with increasing offsets. Note: The data member points
+ * into the raw message content, hence it is only valid until the
+ * message is cleaned.
+ */
+struct zdtm_age_msg_content {
+    uint32_t file_size;         // total size of the file in bytes
+    uint32_t offset;            // offset of this chunk within the file
+    uint16_t data_len;          // size of this chunk in bytes
+    unsigned char *data;        // the chunk of the file
+};
+extern const char *AGE_MSG_TYPE;
+#define IS_AGE(x) (memcmp(x->body.type, AGE_MSG_TYPE, MSG_TYPE_SIZE) == 0)
+
+int zdtm_parse_raw_age_msg(void *buf, uint16_t size,
+    struct zdtm_age_msg_content *age);
+
+#endif
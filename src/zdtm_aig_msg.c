@@ -31,36 +31,37 @@ const char *AIG_MSG_TYPE = "AIG";
  * content fields so that the data can be easily obtained at a later
  * point in time.
  * @param buf Pointer to AIG message raw content.
+ * @param size Size of the raw content in bytes.
  * @param aig Pointer to struct to store parsed AIG message content in.
  * @return An integer representing success (zero) or failure (non-zero).
  * @retval 0 Successfully parsed the aig message.
  * @retval -1 Failed to allocate memory for the model string.
+ * @retval RET_BAD_SIZE Failed, the content is shorter than the message.
  */
-int zdtm_parse_raw_aig_msg(void *buf, struct zdtm_aig_msg_content *aig) {
-#ifdef WORDS_BIGENDIAN
-    aig->model_str_len = zdtm_liltobigs(*((uint16_t *)buf));
-#else
-    aig->model_str_len = *((uint16_t *)buf);
-#endif
-    buf += sizeof(uint16_t);
+int zdtm_parse_raw_aig_msg(void *buf, uint16_t size,
+    struct zdtm_aig_msg_content *aig) {
+    zdtm_reader rd;
+
+    zdtm_rd_init(&rd, buf, size);
+    if (zdtm_rd_need(&rd, sizeof(uint16_t)) != 0) {
+        return RET_BAD_SIZE;
+    }
+    aig->model_str_len = zdtm_rd_u16(&rd);
+
+    if (zdtm_rd_need(&rd, aig->model_str_len + sizeof(aig->uk_data_0) +
+        sizeof(aig->language) + 1 + sizeof(aig->uk_data_1)) != 0) {
+        return RET_BAD_SIZE;
+    }
 
     aig->model_str = (unsigned char *)malloc(aig->model_str_len);
     if (aig->model_str == NULL) {
         return -1;
     }
-    memcpy((void *)aig->model_str, buf, aig->model_str_len);
-    buf += aig->model_str_len;
-
-    memcpy((void *)aig->uk_data_0, buf, 5);
-    buf += 5;
-
-    memcpy((void *)aig->language, buf, 2);
-    buf += 2;
-
-    aig->auth_state = *((unsigned char *)buf);
-    buf += 1;
-
-    memcpy((void *)aig->uk_data_1, buf, 6);
+    zdtm_rd_bytes(&rd, aig->model_str, aig->model_str_len);
+    zdtm_rd_bytes(&rd, aig->uk_data_0, sizeof(aig->uk_data_0));
+    zdtm_rd_bytes(&rd, aig->language, sizeof(aig->language));
+    aig->auth_state = zdtm_rd_u8(&rd);
+    zdtm_rd_bytes(&rd, aig->uk_data_1, sizeof(aig->uk_data_1));
 
     return 0;
 }
@@ -42,6 +42,7 @@ struct zdtm_aig_msg_content {
 extern const char *AIG_MSG_TYPE;
 #define IS_AIG(x) (memcmp(x->body.type, AIG_MSG_TYPE, MSG_TYPE_SIZE) == 0)
 
-int zdtm_parse_raw_aig_msg(void *buf, struct zdtm_aig_msg_content *aig);
+int zdtm_parse_raw_aig_msg(void *buf, uint16_t size,
+    struct zdtm_aig_msg_content *aig);
 
 #endif
@@ -0,0 +1,68 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+#include "zdtm_alr_msg.h"
+
+const char *ALR_MSG_TYPE = "ALR";
+
+/**
+ * Parse a raw ALR message.
+ *
+ * The zdtm_parse_raw_alr_msg function takes a raw ALR message and
+ * parses it into it's appropriate components and fills in the alr
+ * content fields so that the data can be easily obtained at a later
+ * point in time.
+ * @param buf Pointer to ALR message raw content.
+ * @param size Size of the raw content in bytes.
+ * @param alr Pointer to struct to store parsed ALR message content in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully parsed the alr message.
+ * @retval -1 Failed to allocate memory for the entries.
+ * @retval RET_BAD_SIZE Failed, the content is shorter than the message.
+ */
+int zdtm_parse_raw_alr_msg(void *buf, uint16_t size,
+    struct zdtm_alr_msg_content *alr) {
+    zdtm_reader rd;
+    int i;
+
+    zdtm_rd_init(&rd, buf, size);
+    if (zdtm_rd_need(&rd, sizeof(uint16_t)) != 0) {
+        return RET_BAD_SIZE;
+    }
+    alr->num_entries = zdtm_rd_u16(&rd);
+
+    if (zdtm_rd_need(&rd, (size_t)alr->num_entries *
+        (sizeof(uint32_t) + ALR_MDTM_SIZE)) != 0) {
+        return RET_BAD_SIZE;
+    }
+
+    alr->entries = malloc(sizeof(struct zdtm_alr_entry) *
+        (alr->num_entries + 1));
+    if (alr->entries == NULL)
+        return -1;
+
+    for (i = 0; i < alr->num_entries; i++) {
+        alr->entries[i].sync_id = zdtm_rd_u32(&rd);
+        zdtm_rd_bytes(&rd, alr->entries[i].mdtm, ALR_MDTM_SIZE);
+    }
+
+    return 0;
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+#ifndef ZDTM_ALR_MSG_H
+#define ZDTM_ALR_MSG_H
+
+#include "zdtm_common.h"
+
+// Size in bytes of the modification date of an ALR entry.
+#define ALR_MDTM_SIZE 5
+
+/**
+ * Zaurus ALR message entry.
+ *
+ * The zdtm_alr_entry is designed to be a substructure of the ALR
+ * message content structure. It represents a single item of the
+ * synchronization type listed, identified by its sync id, along with
+ * the modification date (MDTM) of the item in the same format as the
+ * MDTM parameter of the item.
+ */
+struct zdtm_alr_entry {
+    uint32_t sync_id;                       // sync id of the item
+    unsigned char mdtm[ALR_MDTM_SIZE];      // modification date of item
+};
+
+/**
+ * Zaurus ALR message content.
+ *
+ * The zdtm_alr_msg_content is a structure which represents an ALR
+ * Zaurus message content after being parsed from the raw message
+ * content. An ALR message is the response to an RLR message and lists
+ * every item of the requested synchronization type, regardless of the
+ * synchronization state. The raw content is a 16 bit entry count
+ * followed by a 32 bit sync id and a 5 byte modification date for each
+ * entry.
+ */
+struct zdtm_alr_msg_content {
+    uint16_t num_entries;               // Number of entries.
+    struct zdtm_alr_entry *entries;     // Array of entries.
+};
+extern const char *ALR_MSG_TYPE;
+#define IS_ALR(x) (memcmp(x->body.type, ALR_MSG_TYPE, MSG_TYPE_SIZE) == 0)
+
+int zdtm_parse_raw_alr_msg(void *buf, uint16_t size,
+    struct zdtm_alr_msg_content *alr);
+
+#endif
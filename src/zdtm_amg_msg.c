@@ -23,12 +23,18 @@
 
 const char *AMG_MSG_TYPE = "AMG";
 
-int zdtm_parse_raw_amg_msg(void *p_cont, struct zdtm_amg_msg_content *amg) {
-    memcpy((void *)amg->sl, p_cont, 2);
-    p_cont = p_cont + 2;
-    amg->fullsync_flags = *((unsigned char *)p_cont);
-    p_cont = p_cont + 1;
-    memcpy((void *)amg->uk, p_cont, 46);
+int zdtm_parse_raw_amg_msg(void *p_cont, uint16_t size,
+    struct zdtm_amg_msg_content *amg) {
+    zdtm_reader rd;
+
+    zdtm_rd_init(&rd, p_cont, size);
+    if (zdtm_rd_need(&rd, sizeof(amg->sl) + 1 + sizeof(amg->uk)) != 0) {
+        return RET_BAD_SIZE;
+    }
+
+    zdtm_rd_bytes(&rd, amg->sl, sizeof(amg->sl));
+    amg->fullsync_flags = zdtm_rd_u8(&rd);
+    zdtm_rd_bytes(&rd, amg->uk, sizeof(amg->uk));
 
     return 0;
 }
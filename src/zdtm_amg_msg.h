@@ -70,6 +70,7 @@ struct zdtm_amg_msg_content {
 extern const char *AMG_MSG_TYPE;
 #define IS_AMG(x) (memcmp(x->body.type, AMG_MSG_TYPE, MSG_TYPE_SIZE) == 0)
 
-int zdtm_parse_raw_amg_msg(void *p_cont, struct zdtm_amg_msg_content *amg);
+int zdtm_parse_raw_amg_msg(void *p_cont, uint16_t size,
+    struct zdtm_amg_msg_content *amg);
 
 #endif
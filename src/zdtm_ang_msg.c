@@ -31,11 +31,22 @@ const char *ANG_MSG_TYPE = "ANG";
  * content fields so that the data con be easily obtained at a later
  * point in time.
  * @param buf Pointer to ANG message raw content.
+ * @param size Size of the raw content in bytes.
  * @param ang Pointer to struct to store parsed ANG message content in.
  * @return An integer representing success (zero) or failure (non-zero).
  * @retval 0 Successfully parsed the ang message.
+ * @retval RET_BAD_SIZE Failed, the content is shorter than the message.
  */
-int zdtm_parse_raw_ang_msg(void *buf, struct zdtm_ang_msg_content *ang) {
-    ang->uk_data_0 = *(unsigned char *)buf;
+int zdtm_parse_raw_ang_msg(void *buf, uint16_t size,
+    struct zdtm_ang_msg_content *ang) {
+    zdtm_reader rd;
+
+    zdtm_rd_init(&rd, buf, size);
+    if (zdtm_rd_need(&rd, 1) != 0) {
+        return RET_BAD_SIZE;
+    }
+
+    ang->uk_data_0 = zdtm_rd_u8(&rd);
+
     return 0;
 }
@@ -37,6 +37,7 @@ struct zdtm_ang_msg_content {
 extern const char *ANG_MSG_TYPE;
 #define IS_ANG(x) (memcmp(x->body.type, ANG_MSG_TYPE, MSG_TYPE_SIZE) == 0)
 
-int zdtm_parse_raw_ang_msg(void *buf, struct zdtm_ang_msg_content *ang);
+int zdtm_parse_raw_ang_msg(void *buf, uint16_t size,
+    struct zdtm_ang_msg_content *ang);
 
 #endif
@@ -23,106 +23,181 @@
 
 const char *ASY_MSG_TYPE = "ASY";
 
+/**
+ * Scan a raw ASY message.
+ *
+ * The _zdtm_scan_asy_msg function walks the three lists of a raw ASY
+ * message, checking that every one of them fits in the content before
+ * any sync id is converted. It fills in the list ids and the counts of
+ * the asy content, and the position of the raw sync ids of each list.
+ * @param buf Pointer to ASY message raw content.
+ * @param size Size of the raw content in bytes.
+ * @param asy Pointer to struct to store the list ids and counts in.
+ * @param pp_raw Array of three pointers to store the raw lists at.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully scanned the lists.
+ * @retval RET_BAD_SIZE Failed, a list runs past the content.
+ */
+static int _zdtm_scan_asy_msg(void *buf, uint16_t size,
+    struct zdtm_asy_msg_content *asy, const unsigned char **pp_raw) {
+
+    zdtm_reader rd;
+    unsigned char list_ids[3];
+    uint16_t nums[3];
+    int i;
+
+    zdtm_rd_init(&rd, buf, size);
+
+    for (i = 0; i < 3; i++) {
+        if (zdtm_rd_need(&rd, 1 + sizeof(uint16_t)) != 0) {
+            return RET_BAD_SIZE;
+        }
+        list_ids[i] = zdtm_rd_u8(&rd);
+        nums[i] = zdtm_rd_u16(&rd);
+
+        if (zdtm_rd_need(&rd, (size_t)nums[i] * sizeof(uint32_t)) != 0) {
+            return RET_BAD_SIZE;
+        }
+        pp_raw[i] = zdtm_rd_skip(&rd, (size_t)nums[i] * sizeof(uint32_t));
+    }
+
+    asy->new_list_id = list_ids[0];
+    asy->num_new_sync_ids = nums[0];
+    asy->mod_list_id = list_ids[1];
+    asy->num_mod_sync_ids = nums[1];
+    asy->del_list_id = list_ids[2];
+    asy->num_del_sync_ids = nums[2];
+
+    return 0;
+}
+
 /**
  * Parse a raw ASY message.
  *
  * The zdtm_parse_raw_asy_msg function takes a raw ASY message and
  * parses it into it's appropriate components and fills in the asy
  * content fields so that the data can be easily obtained at a later
- * point in time.
+ * point in time. Each of the three lists is allocated on its own and
+ * is freed by _zdtm_clean_message() unless the caller takes it over
+ * by setting its pointer to NULL.
  * @param buf Pointer to ASY message raw content.
+ * @param size Size of the raw content in bytes.
  * @param asy Pointer to struct to stare parsed ASY message content in.
  * @return An integer representing success (zero) or failure (non-zero).
  * @retval 0 Successfully parsed the adi message.
  * @retval -1 Failed to allocate memory for new sync ids.
  * @retval -2 Failed to allocate memory for mod sync ids.
  * @retval -3 Failed to allocate memory for del sync ids.
+ * @retval RET_BAD_SIZE Failed, the content is shorter than the message.
  */
-int zdtm_parse_raw_asy_msg(void *buf, struct zdtm_asy_msg_content *asy) {
-    int i;
+int zdtm_parse_raw_asy_msg(void *buf, uint16_t size,
+    struct zdtm_asy_msg_content *asy) {
+    const unsigned char *raw[3];
+    uint32_t *ids[3];
+    uint16_t nums[3];
+    int r, i, j;
 
-    // New List
-    asy->new_list_id = *((unsigned char *)buf);
-    buf += 1;
+    asy->new_sync_ids = NULL;
+    asy->mod_sync_ids = NULL;
+    asy->del_sync_ids = NULL;
 
-#ifdef WORDS_BIGENDIAN
-    asy->num_new_sync_ids = zdtm_liltobigs(*((uint16_t *)buf));
-    buf += sizeof(uint16_t);
-#else
-    asy->num_new_sync_ids = *((uint16_t *)buf);
-    buf += sizeof(uint16_t);
-#endif
-
-    asy->new_sync_ids = malloc(sizeof(uint32_t) * asy->num_new_sync_ids);
-    if (asy->new_sync_ids == NULL)
-        return -1;
-    
-    for (i = 0; i < asy->num_new_sync_ids; i++) {
-#ifdef WORDS_BIGENDIAN
-        asy->new_sync_ids[i] = zdtm_liltobigl(*((uint32_t *)buf));
-        buf += sizeof(uint32_t);
-#else
-        asy->new_sync_ids[i] = *((uint32_t *)buf);
-        buf += sizeof(uint32_t);
-#endif
+    r = _zdtm_scan_asy_msg(buf, size, asy, raw);
+    if (r != 0) {
+        return r;
     }
 
-    // Mod List
-    asy->mod_list_id = *((unsigned char *)buf);
-    buf += 1;
-
-#ifdef WORDS_BIGENDIAN
-    asy->num_mod_sync_ids = zdtm_liltobigs(*((uint16_t *)buf));
-    buf += sizeof(uint16_t);
-#else
-    asy->num_mod_sync_ids = *((uint16_t *)buf);
-    buf += sizeof(uint16_t);
-#endif
-
-    asy->mod_sync_ids = malloc(sizeof(uint32_t) * asy->num_mod_sync_ids);
-    if (asy->mod_sync_ids == NULL) {
-        free((void *)asy->new_sync_ids);
-        return -2;
+    nums[0] = asy->num_new_sync_ids;
+    nums[1] = asy->num_mod_sync_ids;
+    nums[2] = asy->num_del_sync_ids;
+
+    for (i = 0; i < 3; i++) {
+        ids[i] = malloc(sizeof(uint32_t) * nums[i]);
+        if (ids[i] == NULL) {
+            for (j = 0; j < i; j++) {
+                free(ids[j]);
+            }
+            return -1 - i;
+        }
+        zdtm_liltohostl_bulk(ids[i], raw[i], nums[i]);
     }
 
-    for (i = 0; i < asy->num_mod_sync_ids; i++) {
-#ifdef WORDS_BIGENDIAN
-        asy->mod_sync_ids[i] = zdtm_liltobigl(*((uint32_t *)buf));
-        buf += sizeof(uint32_t);
-#else
-        asy->mod_sync_ids[i] = *((uint32_t *)buf);
-        buf += sizeof(uint32_t);
-#endif
+    asy->new_sync_ids = ids[0];
+    asy->mod_sync_ids = ids[1];
+    asy->del_sync_ids = ids[2];
+
+    return 0;
+}
+
+/**
+ * Count the sync ids of a raw ASY message.
+ *
+ * The zdtm_count_asy_msg function obtains the total number of sync ids
+ * over the three lists of a raw ASY message, so that storage for
+ * zdtm_decode_asy_msg() can be sized.
+ * @param buf Pointer to ASY message raw content.
+ * @param size Size of the raw content in bytes.
+ * @param p_num_ids Pointer to store the total number of sync ids in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully counted the sync ids.
+ * @retval RET_BAD_SIZE Failed, a list runs past the content.
+ */
+int zdtm_count_asy_msg(void *buf, uint16_t size, size_t *p_num_ids) {
+    struct zdtm_asy_msg_content asy;
+    const unsigned char *raw[3];
+    int r;
+
+    r = _zdtm_scan_asy_msg(buf, size, &asy, raw);
+    if (r != 0) {
+        return r;
     }
 
-    // Del List
-    asy->del_list_id = *((unsigned char *)buf);
-    buf += 1;
-
-#ifdef WORDS_BIGENDIAN
-    asy->num_del_sync_ids = zdtm_liltobigs(*((uint16_t *)buf));
-    buf += sizeof(uint16_t);
-#else
-    asy->num_del_sync_ids = *((uint16_t *)buf);
-    buf += sizeof(uint16_t);
-#endif
-
-    asy->del_sync_ids = malloc(sizeof(uint32_t) * asy->num_del_sync_ids);
-    if (asy->del_sync_ids == NULL) {
-        free((void *)asy->new_sync_ids);
-        free((void *)asy->mod_sync_ids);
-        return -3;
+    (*p_num_ids) = (size_t)asy.num_new_sync_ids + asy.num_mod_sync_ids +
+        asy.num_del_sync_ids;
+
+    return 0;
+}
+
+/**
+ * Decode a raw ASY message into given storage.
+ *
+ * The zdtm_decode_asy_msg function parses a raw ASY message like
+ * zdtm_parse_raw_asy_msg() does, but converts the three lists back to
+ * back into the given storage instead of allocating them, the new list
+ * first, then the mod list and then the del list. The list pointers of
+ * the asy content point into the storage, hence they must not be freed
+ * and must not outlive it.
+ * @param buf Pointer to ASY message raw content.
+ * @param size Size of the raw content in bytes.
+ * @param asy Pointer to struct to store parsed ASY message content in.
+ * @param p_ids Pointer to the storage for the sync ids.
+ * @param max_ids The number of sync ids the storage can hold.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully decoded the ASY message.
+ * @retval -1 Failed, the storage is too small for the sync ids.
+ * @retval RET_BAD_SIZE Failed, a list runs past the content.
+ */
+int zdtm_decode_asy_msg(void *buf, uint16_t size,
+    struct zdtm_asy_msg_content *asy, uint32_t *p_ids, size_t max_ids) {
+    const unsigned char *raw[3];
+    int r;
+
+    r = _zdtm_scan_asy_msg(buf, size, asy, raw);
+    if (r != 0) {
+        return r;
     }
 
-    for (i = 0; i < asy->num_del_sync_ids; i++) {
-#ifdef WORDS_BIGENDIAN
-        asy->del_sync_ids[i] = zdtm_liltobigl(*((uint32_t *)buf));
-        buf += sizeof(uint32_t);
-#else
-        asy->del_sync_ids[i] = *((uint32_t *)buf);
-        buf += sizeof(uint32_t);
-#endif
+    if (((size_t)asy->num_new_sync_ids + asy->num_mod_sync_ids +
+            asy->num_del_sync_ids) > max_ids) {
+        return -1;
     }
 
+    asy->new_sync_ids = p_ids;
+    asy->mod_sync_ids = asy->new_sync_ids + asy->num_new_sync_ids;
+    asy->del_sync_ids = asy->mod_sync_ids + asy->num_mod_sync_ids;
+
+    zdtm_liltohostl_bulk(asy->new_sync_ids, raw[0], asy->num_new_sync_ids);
+    zdtm_liltohostl_bulk(asy->mod_sync_ids, raw[1], asy->num_mod_sync_ids);
+    zdtm_liltohostl_bulk(asy->del_sync_ids, raw[2], asy->num_del_sync_ids);
+
     return 0;
 }
@@ -45,6 +45,10 @@ struct zdtm_asy_msg_content {
 extern const char *ASY_MSG_TYPE;
 #define IS_ASY(x) (memcmp(x->body.type, ASY_MSG_TYPE, MSG_TYPE_SIZE) == 0)
 
-int zdtm_parse_raw_asy_msg(void *buf, struct zdtm_asy_msg_content *asy);
+int zdtm_parse_raw_asy_msg(void *buf, uint16_t size,
+    struct zdtm_asy_msg_content *asy);
+int zdtm_count_asy_msg(void *buf, uint16_t size, size_t *p_num_ids);
+int zdtm_decode_asy_msg(void *buf, uint16_t size,
+    struct zdtm_asy_msg_content *asy, uint32_t *p_ids, size_t max_ids);
 
 #endif
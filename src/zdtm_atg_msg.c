@@ -31,22 +31,27 @@ const char *ATG_MSG_TYPE = "ATG";
  * content fields so that the data can be easily obtained at a later
  * point in time.
  * @param buf Pointer to ATG message raw content.
+ * @param size Size of the raw content in bytes.
  * @param atg Poniter to struct to store parsed ATG message content in.
  * @return An integener representing success (zero) or failure (non-zero).
  * @retval 0 Successfully parsed the atg message.
+ * @retval RET_BAD_SIZE Failed, the content is shorter than the message.
  */
-int zdtm_parse_raw_atg_msg(void *buf, struct zdtm_atg_msg_content *atg) {
-    memcpy((void *)atg->year, buf, 4);
-    buf += 4;
-    memcpy((void *)atg->month, buf, 2);
-    buf += 2;
-    memcpy((void *)atg->day, buf, 2);
-    buf += 2;
-    memcpy((void *)atg->hour, buf, 2);
-    buf += 2;
-    memcpy((void *)atg->minutes, buf, 2);
-    buf += 2;
-    memcpy((void *)atg->seconds, buf, 2);
+int zdtm_parse_raw_atg_msg(void *buf, uint16_t size,
+    struct zdtm_atg_msg_content *atg) {
+    zdtm_reader rd;
+
+    zdtm_rd_init(&rd, buf, size);
+    if (zdtm_rd_need(&rd, sizeof(struct zdtm_atg_msg_content)) != 0) {
+        return RET_BAD_SIZE;
+    }
+
+    zdtm_rd_bytes(&rd, atg->year, sizeof(atg->year));
+    zdtm_rd_bytes(&rd, atg->month, sizeof(atg->month));
+    zdtm_rd_bytes(&rd, atg->day, sizeof(atg->day));
+    zdtm_rd_bytes(&rd, atg->hour, sizeof(atg->hour));
+    zdtm_rd_bytes(&rd, atg->minutes, sizeof(atg->minutes));
+    zdtm_rd_bytes(&rd, atg->seconds, sizeof(atg->seconds));
 
     return 0;
 }
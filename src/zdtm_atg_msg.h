@@ -42,6 +42,7 @@ struct zdtm_atg_msg_content {
 extern const char *ATG_MSG_TYPE;
 #define IS_ATG(x) (memcmp(x->body.type, ATG_MSG_TYPE, MSG_TYPE_SIZE) == 0)
 
-int zdtm_parse_raw_atg_msg(void *buf, struct zdtm_atg_msg_content *atg);
+int zdtm_parse_raw_atg_msg(void *buf, uint16_t size,
+    struct zdtm_atg_msg_content *atg);
 
 #endif
@@ -0,0 +1,199 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+
+/**
+ * @file zdtm_category.c
+ * @brief This is an implementation file for category tables.
+ *
+ * The zdtm_category.c file is an implementation of tables interning the
+ * CTGR payloads of items. The payloads are hashed with FNV-1a and found
+ * through an open addressed hash table of their IDs, which is kept at
+ * most half full.
+ */
+
+#include "zdtm_category.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* FNV-1a hash of a payload. */
+static uint32_t _zdtm_category_hash(const unsigned char *data, uint32_t len) {
+    uint32_t hash;
+    uint32_t i;
+
+    hash = 2166136261u;
+    for (i = 0; i < len; i++) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+
+    return hash;
+}
+
+void zdtm_category_table_init(zdtm_category_table *p_table) {
+    p_table->categories = NULL;
+    p_table->num_categories = 0;
+    p_table->cap = 0;
+    p_table->slots = NULL;
+    p_table->shift = 32;
+}
+
+void zdtm_category_table_free(zdtm_category_table *p_table) {
+    uint16_t i;
+
+    for (i = 0; i < p_table->num_categories; i++) {
+        free(p_table->categories[i].data);
+    }
+    free(p_table->categories);
+    free(p_table->slots);
+    zdtm_category_table_init(p_table);
+}
+
+/* Rebuild the hash table with 1 << bits slots. */
+static int _zdtm_category_rehash(zdtm_category_table *p_table,
+    unsigned int bits) {
+
+    uint16_t *slots;
+    unsigned int mask, slot;
+    uint16_t i;
+
+    slots = calloc((size_t)1 << bits, sizeof(uint16_t));
+    if (slots == NULL) {
+        return -1;
+    }
+
+    mask = (1u << bits) - 1;
+    for (i = 0; i < p_table->num_categories; i++) {
+        slot = p_table->categories[i].hash >> (32 - bits);
+        while (slots[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = i + 1;
+    }
+
+    free(p_table->slots);
+    p_table->slots = slots;
+    p_table->shift = 32 - bits;
+
+    return 0;
+}
+
+int zdtm_category_intern(zdtm_category_table *p_table, const void *data,
+    uint32_t len, uint16_t *p_id) {
+
+    struct zdtm_category *p_cat;
+    unsigned int bits, mask, slot;
+    uint32_t hash, cap;
+    uint16_t id;
+
+    if (len == 0) {
+        (*p_id) = ZDTM_CATEGORY_NONE;
+        return 0;
+    }
+
+    hash = _zdtm_category_hash(data, len);
+    if (p_table->slots != NULL) {
+        mask = (1u << (32 - p_table->shift)) - 1;
+        slot = hash >> p_table->shift;
+        while ((id = p_table->slots[slot]) != 0) {
+            p_cat = &p_table->categories[id - 1];
+            if ((p_cat->hash == hash) && (p_cat->len == len) &&
+                (memcmp(p_cat->data, data, len) == 0)) {
+                (*p_id) = id;
+                return 0;
+            }
+            slot = (slot + 1) & mask;
+        }
+    }
+
+    if (p_table->num_categories == 0xffff) {
+        return -2;
+    }
+
+    if (p_table->num_categories == p_table->cap) {
+        cap = (p_table->cap == 0) ? 16 : ((uint32_t)p_table->cap * 2);
+        if (cap > 0xffff) {
+            cap = 0xffff;
+        }
+        p_cat = realloc(p_table->categories,
+            sizeof(struct zdtm_category) * cap);
+        if (p_cat == NULL) {
+            return -1;
+        }
+        p_table->categories = p_cat;
+        p_table->cap = cap;
+    }
+
+    p_cat = &p_table->categories[p_table->num_categories];
+    p_cat->data = malloc(len);
+    if (p_cat->data == NULL) {
+        return -1;
+    }
+    memcpy(p_cat->data, data, len);
+    p_cat->len = len;
+    p_cat->hash = hash;
+    p_table->num_categories++;
+
+    /* Keep the table at most half full so that probes stay short. */
+    bits = 32 - p_table->shift;
+    if ((p_table->slots == NULL) ||
+        ((uint32_t)p_table->num_categories * 2 > (1u << bits))) {
+        if (bits < 4) {
+            bits = 4;
+        }
+        while ((1u << bits) < (uint32_t)p_table->num_categories * 2) {
+            bits++;
+        }
+        if (_zdtm_category_rehash(p_table, bits) != 0) {
+            p_table->num_categories--;
+            free(p_cat->data);
+            return -1;
+        }
+    } else {
+        mask = (1u << bits) - 1;
+        slot = hash >> p_table->shift;
+        while (p_table->slots[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        p_table->slots[slot] = p_table->num_categories;
+    }
+
+    (*p_id) = p_table->num_categories;
+
+    return 0;
+}
+
+const unsigned char *zdtm_category_lookup(const zdtm_category_table *p_table,
+    uint16_t id, uint32_t *p_len) {
+
+    if (id == ZDTM_CATEGORY_NONE) {
+        (*p_len) = 0;
+        return (const unsigned char *)"";
+    }
+
+    if (id > p_table->num_categories) {
+        return NULL;
+    }
+
+    (*p_len) = p_table->categories[id - 1].len;
+
+    return p_table->categories[id - 1].data;
+}
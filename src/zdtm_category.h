@@ -0,0 +1,125 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+
+/**
+ * @file zdtm_category.h
+ * @brief This is a specifications file for category tables.
+ *
+ * The zdtm_category.h file is a specifications file for tables interning
+ * the CTGR payloads of items. A device typically uses a dozen categories
+ * across thousands of items, hence each distinct payload is kept once
+ * and identified by a small integer, so that items can share the
+ * payload and be filtered or grouped by comparing their IDs.
+ */
+
+#ifndef ZDTM_CATEGORY_H
+#define ZDTM_CATEGORY_H
+
+#include "zdtm_export.h"
+#include "zdtm_gentypes.h"
+
+// ID of the empty category, which every table has without storing it.
+#define ZDTM_CATEGORY_NONE 0
+
+/**
+ * Interned category.
+ *
+ * The zdtm_category is a structure which represents a distinct CTGR
+ * payload held by a category table.
+ */
+struct zdtm_category {
+    unsigned char *data;    // payload of the category, never changed
+    uint32_t len;           // length of the payload in bytes
+    uint32_t hash;          // hash of the payload
+};
+
+/**
+ * Category table.
+ *
+ * The zdtm_category_table is a structure which represents the distinct
+ * CTGR payloads seen so far, each with an ID given in the order they
+ * were first seen, ZDTM_CATEGORY_NONE being the empty payload. The
+ * payloads are found by a hash table of their IDs. The payload of an
+ * ID stays at the same address until the table is freed. A table is
+ * initialized with zdtm_category_table_init() and its memory is
+ * released with zdtm_category_table_free().
+ */
+typedef struct zdtm_category_table {
+    struct zdtm_category *categories; // categories, the one of ID i at i - 1
+    uint16_t num_categories;    // number of categories less the empty one
+    uint16_t cap;               // allocated number of categories
+    uint16_t *slots;            // ID of the category in each slot, 0 none
+    unsigned int shift;         // shift of the hash down to a slot
+} zdtm_category_table;
+
+/**
+ * Initialize category table.
+ *
+ * The zdtm_category_table_init function initializes a category table
+ * holding the empty category alone, without allocating any memory.
+ * @param p_table Pointer to the category table to initialize.
+ */
+ZDTM_EXPORT void zdtm_category_table_init(zdtm_category_table *p_table);
+
+/**
+ * Free category table.
+ *
+ * The zdtm_category_table_free function releases the memory of a
+ * category table, payloads included, leaving it as
+ * zdtm_category_table_init() does.
+ * @param p_table Pointer to the category table to free.
+ */
+ZDTM_EXPORT void zdtm_category_table_free(zdtm_category_table *p_table);
+
+/**
+ * Intern category.
+ *
+ * The zdtm_category_intern function looks up the given CTGR payload in
+ * a category table, adding a copy of it under the next ID if the table
+ * has not seen it yet, and stores its ID in p_id.
+ * @param p_table Pointer to the category table.
+ * @param data Pointer to the payload.
+ * @param len The length of the payload in bytes.
+ * @param p_id Pointer to store the ID of the category in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully interned the category.
+ * @retval -1 Failed to allocate memory for the category.
+ * @retval -2 Failed, the table holds as many categories as IDs.
+ */
+ZDTM_EXPORT int zdtm_category_intern(zdtm_category_table *p_table,
+    const void *data, uint32_t len, uint16_t *p_id);
+
+/**
+ * Look up category.
+ *
+ * The zdtm_category_lookup function looks up the payload of the
+ * category of the given ID in a category table.
+ * @param p_table Pointer to the category table.
+ * @param id The ID of the category.
+ * @param p_len Pointer to store the length of the payload in.
+ * @return Pointer to the payload, which must neither be changed nor
+ * freed, or NULL if the table has no category of that ID.
+ */
+ZDTM_EXPORT const unsigned char *zdtm_category_lookup(
+    const zdtm_category_table *p_table, uint16_t id, uint32_t *p_len);
+
+#endif /* ZDTM_CATEGORY_H */
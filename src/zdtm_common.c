@@ -21,70 +21,88 @@
 
 #include "zdtm_common.h"
 
-/**
- * Convert little-endian short to a big-endian short.
- *
- * The zdtm_liltobigs function converts a little-endian uint16_t
- * to a big-endian uint16_t.
- * @param lilshort The lil-end uint16_t to convert to big-end uint16_t.
- * @return The big-endian version of given little-endian uint16_t.
- */
-uint16_t zdtm_liltobigs(uint16_t lilshort) {
-    int size, i;
-    unsigned char buff[sizeof(uint16_t)];
-
-    size = sizeof(uint16_t);
-
-    for (i = 0; i < size; i++) {
-        buff[i] = ((unsigned char *)&lilshort)[(size - i - 1)];
-    }
-
-    return *(uint16_t *)buff;
-}
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 /**
- * Convert little-endian long to a big-endian long.
+ * Convert an array of little-endian longs to big-endian longs.
  *
- * The zdtm_liltobigl function converts a little-endian uint32_t
- * to a big-endian uint32_t.
- * @param lillong The lil-end uint32_t to convert to big-end uint32_t.
- * @return The big-endian version of given little-endian uint32_t.
+ * The zdtm_liltobigl_bulk function converts count little-endian
+ * uint32_t values, which need not be aligned, to big-endian ones.
+ * The values are swapped sixteen bytes at a time with SSSE3, SSE2, or
+ * NEON when the target has them. The conversion may be done in place.
+ * @param dst Pointer to the array to store the converted values in.
+ * @param src Pointer to the values to convert.
+ * @param count The number of values to convert.
  */
-uint32_t zdtm_liltobigl(uint32_t lillong) {
-    int size, i;
-    unsigned char buff[sizeof(uint32_t)];
-
-    size = sizeof(uint32_t);
-    
-    for (i = 0; i < size; i++) {
-        buff[i] = ((unsigned char *)&lillong)[(size - i - 1)];
+void zdtm_liltobigl_bulk(uint32_t *dst, const void *src, size_t count) {
+    const unsigned char *p;
+    uint32_t val;
+    size_t i;
+
+    p = (const unsigned char *)src;
+    i = 0;
+
+#if defined(__SSSE3__)
+    {
+        const __m128i mask = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11,
+            4, 5, 6, 7, 0, 1, 2, 3);
+        __m128i v;
+
+        for (; (i + 4) <= count; i += 4) {
+            v = _mm_loadu_si128((const __m128i *)(p + (i * 4)));
+            _mm_storeu_si128((__m128i *)(dst + i), _mm_shuffle_epi8(v, mask));
+        }
     }
+#elif defined(__SSE2__)
+    {
+        __m128i v;
+
+        /* Swap the bytes of each 16-bit half, then the halves. */
+        for (; (i + 4) <= count; i += 4) {
+            v = _mm_loadu_si128((const __m128i *)(p + (i * 4)));
+            v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+            v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+            v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+            _mm_storeu_si128((__m128i *)(dst + i), v);
+        }
+    }
+#elif defined(__ARM_NEON)
+    for (; (i + 4) <= count; i += 4) {
+        vst1q_u8((uint8_t *)(dst + i), vrev32q_u8(vld1q_u8(p + (i * 4))));
+    }
+#endif
 
-    return *(uint32_t *)buff;
-}
-
-/** 
- * Convert big-endian short to a little-endian short.
- *
- * The zdtm_bigtolils function converts a big-endian uint16_t to a
- * little-endian uint16_t.
- * @param bigshort The big-end uint16_t to convert to lil-end uint16_t.
- * @return The little-endian version of given big-endian uint16_t.
- */ 
-uint16_t zdtm_bigtolils(uint16_t bigshort) {
-    return zdtm_liltobigs(bigshort);
+    for (; i < count; i++) {
+        memcpy(&val, p + (i * 4), sizeof(uint32_t));
+        dst[i] = ZDTM_BSWAP32(val);
+    }
 }
 
 /**
- * Convert big-endian long to a little-endian long.
+ * Convert an array of little-endian longs to host longs.
  *
- * The zdtm_bigtolils function converts a big-endian uint32_t to a
- * little-endian uint32_t.
- * @param biglong The big-end uint32_t to convert to lil-end uint32_t.
- * @return The little-endian version of given big-endian uint32_t.
+ * The zdtm_liltohostl_bulk function converts count little-endian
+ * uint32_t values, which need not be aligned, to host order, which
+ * is a plain copy on little-endian hosts. As the conversion is the
+ * same either way it also converts host values to little-endian ones.
+ * @param dst Pointer to the array to store the converted values in.
+ * @param src Pointer to the values to convert.
+ * @param count The number of values to convert.
  */
-uint32_t zdtm_bigtolill(uint32_t biglong) {
-    return zdtm_liltobigl(biglong);
+void zdtm_liltohostl_bulk(uint32_t *dst, const void *src, size_t count) {
+#ifdef WORDS_BIGENDIAN
+    zdtm_liltobigl_bulk(dst, src, count);
+#else
+    if ((const void *)dst != src) {
+        memcpy(dst, src, count * sizeof(uint32_t));
+    }
+#endif
 }
 
 /**
@@ -105,91 +123,30 @@ int zdtm_todo_length(struct zdtm_todo_item *todo){
 }
 
 /**
- * Copies the contents of a zdtm_todo struct into a packet buffer
- * and returns a pointer just past the end of the data.
+ * Copies the contents of a zdtm_todo struct into a packet buffer,
+ * leaving the writer just past the end of the data. The room for each
+ * field is checked as it is written, so the length need not be known.
+ *
+ * @return RET_BAD_SIZE if the buffer is too small, zero otherwise.
  */
-void* zdtm_todo_write(void *buf, struct zdtm_todo_item *todo){
-#ifdef WORDS_BIGENDIAN
-    *((uint32_t*)buf) = zdtm_liltobigl(todo->category_len);            
-#else
-    *((uint32_t*)buf) = sizeof(todo->category_len);
-#endif
-    buf += sizeof(uint32_t);
-
-    memcpy(buf, todo->category, todo->category_len);
-    buf += todo->category_len;
-
-#ifdef WORDS_BIGENDIAN
-    *((uint32_t*)buf) = zdtm_liltobigl(sizeof(todo->start_date));            
-#else
-    *((uint32_t*)buf) = sizeof(todo->start_date); 
-#endif
-    buf += sizeof(uint32_t);
-
-    memcpy(buf, todo->start_date, sizeof(todo->start_date));
-    buf += sizeof(todo->start_date);
-
-#ifdef WORDS_BIGENDIAN
-    *((uint32_t*)buf) = zdtm_liltobigl(sizeof(todo->due_date));            
-#else
-    *((uint32_t*)buf) = sizeof(todo->due_date); 
-#endif
-    buf += sizeof(uint32_t);
-
-    memcpy(buf, todo->due_date, sizeof(todo->due_date));
-    buf += sizeof(todo->due_date);
-
-#ifdef WORDS_BIGENDIAN
-    *((uint32_t*)buf) = zdtm_liltobigl(sizeof(todo->completed_date));
-#else
-    *((uint32_t*)buf) = sizeof(todo->completed_date); 
-#endif
-    buf += sizeof(uint32_t);
-
-    memcpy(buf, todo->completed_date, sizeof(todo->completed_date));
-    buf += sizeof(todo->completed_date);
-
-#ifdef WORDS_BIGENDIAN
-    *((uint32_t*)buf) = zdtm_liltobigl(sizeof(todo->progress));
-#else
-    *((uint32_t*)buf) = sizeof(todo->progress); 
-#endif
-    buf += sizeof(uint32_t);
-
-    memcpy(buf, &todo->progress, sizeof(todo->progress));
-    buf += sizeof(todo->progress);
-
-#ifdef WORDS_BIGENDIAN
-    *((uint32_t*)buf) = zdtm_liltobigl(sizeof(todo->priority));
-#else
-    *((uint32_t*)buf) = sizeof(todo->priority); 
-#endif
-    buf += sizeof(uint32_t);
-
-    memcpy(buf, &todo->priority, sizeof(todo->priority));
-    buf += sizeof(todo->priority);
-
-#ifdef WORDS_BIGENDIAN
-    *((uint32_t*)buf) = zdtm_liltobigl(todo->description_len);
-#else
-    *((uint32_t*)buf) = todo->description_len; 
-#endif
-    buf += sizeof(uint32_t);
-
-    memcpy(buf, todo->description, sizeof(todo->description_len));
-    buf += sizeof(todo->description_len);
-
-#ifdef WORDS_BIGENDIAN
-    *((uint32_t*)buf) = zdtm_liltobigl(todo->notes_len);
-#else
-    *((uint32_t*)buf) = todo->notes_len; 
-#endif
-    buf += sizeof(uint32_t);
-
-    memcpy(buf, todo->notes, sizeof(todo->notes_len));
-    buf += sizeof(todo->notes_len);
+int zdtm_todo_write(zdtm_writer *p_wr, struct zdtm_todo_item *todo){
+    if ((zdtm_wr_field(p_wr, todo->category, todo->category_len) != 0) ||
+        (zdtm_wr_field(p_wr, todo->start_date,
+            sizeof(todo->start_date)) != 0) ||
+        (zdtm_wr_field(p_wr, todo->due_date, sizeof(todo->due_date)) != 0) ||
+        (zdtm_wr_field(p_wr, todo->completed_date,
+            sizeof(todo->completed_date)) != 0) ||
+        (zdtm_wr_field(p_wr, &todo->progress,
+            sizeof(todo->progress)) != 0) ||
+        (zdtm_wr_field(p_wr, &todo->priority,
+            sizeof(todo->priority)) != 0) ||
+        (zdtm_wr_field(p_wr, todo->description,
+            todo->description_len) != 0) ||
+        (zdtm_wr_field(p_wr, todo->notes, todo->notes_len) != 0)) {
+        return RET_BAD_SIZE;
+    }
 
-    return buf;
+    return 0;
 }
 
 int zdtm_calendar_length(struct zdtm_calendar_item *calendar) {
@@ -202,6 +159,7 @@ int zdtm_calendar_length(struct zdtm_calendar_item *calendar) {
            sizeof(uint32_t) + sizeof(calendar->schedule_type) +
            sizeof(uint32_t) + sizeof(calendar->alarm) +
            sizeof(uint32_t) + sizeof(calendar->alarm_setting) +
+           sizeof(uint32_t) + sizeof(calendar->alarm_time) +
            sizeof(uint32_t) + sizeof(calendar->repeat_type) +
            sizeof(uint32_t) + sizeof(calendar->repeat_period) +
            sizeof(uint32_t) + sizeof(calendar->repeat_position) +
@@ -226,6 +184,7 @@ int zdtm_address_length(struct zdtm_address_item *address) {
            sizeof(uint32_t) + address->last_name_pronun_len +
            sizeof(uint32_t) + address->first_name_pronun_len +
            sizeof(uint32_t) + address->company_len +
+           sizeof(uint32_t) + address->company_pronun_len +
            sizeof(uint32_t) + address->department_len +
            sizeof(uint32_t) + address->job_title_len +
            sizeof(uint32_t) + address->work_phone_len +
@@ -24,6 +24,7 @@
 
 #include "zdtm_gentypes.h"
 #include "zdtm_config.h"
+#include "zdtm_cursor.h"
 
 // Return values
 #define RET_NNULL_RAW     -7
@@ -35,6 +36,13 @@
 #define RET_MALLOC_FAIL   -13
 #define RET_PARSE_RAW_FAIL -14
 
+// Return values of operations on the connections which ran past one
+// of the deadlines of the environment, see zdtm_set_timeouts(). They
+// are kept clear of the per-function return values.
+#define RET_CONNECT_TIMEOUT -100
+#define RET_ACCEPT_TIMEOUT  -101
+#define RET_IO_TIMEOUT      -102
+
 // Sync Types
 #define SYNC_TYPE_CALENDAR  0x01
 #define SYNC_TYPE_TODO      0x06
@@ -49,10 +57,56 @@
 #define DATA_ID_UTF8 0x11
 #define DATA_ID_ULONG 0x12
 
-uint16_t zdtm_liltobigs(uint16_t lilshort);
-uint32_t zdtm_liltobigl(uint32_t lillong);
-uint16_t zdtm_bigtolils(uint16_t bigshort);
-uint32_t zdtm_bigtolill(uint32_t biglong);
+/**
+ * Convert little-endian short to a big-endian short.
+ *
+ * The zdtm_liltobigs function converts a little-endian uint16_t
+ * to a big-endian uint16_t.
+ * @param lilshort The lil-end uint16_t to convert to big-end uint16_t.
+ * @return The big-endian version of given little-endian uint16_t.
+ */
+static inline uint16_t zdtm_liltobigs(uint16_t lilshort) {
+    return ZDTM_BSWAP16(lilshort);
+}
+
+/**
+ * Convert little-endian long to a big-endian long.
+ *
+ * The zdtm_liltobigl function converts a little-endian uint32_t
+ * to a big-endian uint32_t.
+ * @param lillong The lil-end uint32_t to convert to big-end uint32_t.
+ * @return The big-endian version of given little-endian uint32_t.
+ */
+static inline uint32_t zdtm_liltobigl(uint32_t lillong) {
+    return ZDTM_BSWAP32(lillong);
+}
+
+/**
+ * Convert big-endian short to a little-endian short.
+ *
+ * The zdtm_bigtolils function converts a big-endian uint16_t to a
+ * little-endian uint16_t.
+ * @param bigshort The big-end uint16_t to convert to lil-end uint16_t.
+ * @return The little-endian version of given big-endian uint16_t.
+ */
+static inline uint16_t zdtm_bigtolils(uint16_t bigshort) {
+    return zdtm_liltobigs(bigshort);
+}
+
+/**
+ * Convert big-endian long to a little-endian long.
+ *
+ * The zdtm_bigtolils function converts a big-endian uint32_t to a
+ * little-endian uint32_t.
+ * @param biglong The big-end uint32_t to convert to lil-end uint32_t.
+ * @return The little-endian version of given big-endian uint32_t.
+ */
+static inline uint32_t zdtm_bigtolill(uint32_t biglong) {
+    return zdtm_liltobigl(biglong);
+}
+
+void zdtm_liltobigl_bulk(uint32_t *dst, const void *src, size_t count);
+void zdtm_liltohostl_bulk(uint32_t *dst, const void *src, size_t count);
 
 /**
  * zdtm_todo contains the information for a todo message. 
@@ -65,6 +119,7 @@ struct zdtm_todo_item {
 
     uint32_t category_len;
     char *category;
+    uint16_t category_id;
     char start_date[5];
     char due_date[5];
     char completed_date[5];
@@ -84,6 +139,7 @@ struct zdtm_calendar_item {
 
     uint32_t category_len;
     char *category;
+    uint16_t category_id;
     uint32_t description_len;
     char *description;
     uint32_t location_len;
@@ -116,6 +172,7 @@ struct zdtm_address_item {
     
     uint32_t category_len;
     char *category;
+    uint16_t category_id;
     uint32_t full_name_len;
     char *full_name;
     uint32_t full_name_pronun_len;
@@ -213,7 +270,7 @@ struct zdtm_address_item {
 };
 
 inline int zdtm_todo_length(struct zdtm_todo_item * todo);
-inline void *zdtm_todo_write(void *buf, struct zdtm_todo_item *todo);
+inline int zdtm_todo_write(zdtm_writer *p_wr, struct zdtm_todo_item *todo);
 inline int zdtm_calendar_length(struct zdtm_calendar_item *calendar);
 inline int zdtm_address_length(struct zdtm_address_item *address);
 
@@ -0,0 +1,299 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+
+/**
+ * @file zdtm_compact.c
+ * @brief This is an implementation file for compact Address items.
+ *
+ * The zdtm_compact.c file is an implementation of Address items held
+ * in a single allocation. Every compact Address item is sized first and
+ * then filled in, so that building one takes a single malloc() however
+ * many of its fields are set.
+ */
+
+#include "zdtm_compact.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* A string field, the parameter it is carried as, and where it is found
+ * in a zdtm_address_item. */
+struct _zdtm_compact_field {
+    char abrev[4];
+    size_t offset;
+    size_t len_offset;
+};
+
+#define COMPACT_STR(ab, m) \
+    {ab, offsetof(struct zdtm_address_item, m), \
+        offsetof(struct zdtm_address_item, m##_len)}
+
+/* The string fields, in the order of enum zdtm_address_field. */
+static const struct _zdtm_compact_field
+    _zdtm_compact_fields[ZDTM_ADDR_NUM_FIELDS] = {
+    COMPACT_STR("CTGR", category),
+    COMPACT_STR("FULL", full_name),
+    COMPACT_STR("NAPR", full_name_pronun),
+    COMPACT_STR("TITL", title),
+    COMPACT_STR("LNME", last_name),
+    COMPACT_STR("FNME", first_name),
+    COMPACT_STR("MNME", middle_name),
+    COMPACT_STR("SUFX", suffix),
+    COMPACT_STR("FLAS", alternative_name),
+    COMPACT_STR("LNPR", last_name_pronun),
+    COMPACT_STR("FNPR", first_name_pronun),
+    COMPACT_STR("CPNY", company),
+    COMPACT_STR("CPPR", company_pronun),
+    COMPACT_STR("SCTN", department),
+    COMPACT_STR("PSTN", job_title),
+    COMPACT_STR("TEL2", work_phone),
+    COMPACT_STR("FAX2", work_fax),
+    COMPACT_STR("CPS2", work_mobile),
+    COMPACT_STR("BSTA", work_state),
+    COMPACT_STR("BCTY", work_city),
+    COMPACT_STR("BSTR", work_street),
+    COMPACT_STR("BZIP", work_zip),
+    COMPACT_STR("BCTR", work_country),
+    COMPACT_STR("BWEB", work_web_page),
+    COMPACT_STR("OFCE", office),
+    COMPACT_STR("PRFS", profession),
+    COMPACT_STR("ASST", assistant),
+    COMPACT_STR("MNGR", manager),
+    COMPACT_STR("BPGR", pager),
+    COMPACT_STR("CPS1", cellular),
+    COMPACT_STR("TEL1", home_phone),
+    COMPACT_STR("FAX1", home_fax),
+    COMPACT_STR("HSTA", home_state),
+    COMPACT_STR("HCTY", home_city),
+    COMPACT_STR("HSTR", home_street),
+    COMPACT_STR("HZIP", home_zip),
+    COMPACT_STR("HCTR", home_country),
+    COMPACT_STR("HWEB", home_web_page),
+    COMPACT_STR("DMAL", default_email),
+    COMPACT_STR("MAL1", emails),
+    COMPACT_STR("SPUS", spouse),
+    COMPACT_STR("GNDR", gender),
+    COMPACT_STR("BRTH", birthday),
+    COMPACT_STR("ANIV", anniversary),
+    COMPACT_STR("NCNM", nickname),
+    COMPACT_STR("CLDR", children),
+    COMPACT_STR("MEM1", memo),
+    COMPACT_STR("GRPS", group)
+};
+
+/* Allocate a compact Address item with room for len bytes of strings. */
+static zdtm_compact_address *_zdtm_compact_alloc(uint32_t len) {
+    zdtm_compact_address *p_compact;
+
+    p_compact = malloc(sizeof(zdtm_compact_address) + len);
+    if (p_compact == NULL) {
+        return NULL;
+    }
+    memset(p_compact, 0, sizeof(zdtm_compact_address));
+
+    return p_compact;
+}
+
+int zdtm_compact_address_from_item(const struct zdtm_address_item *p_item,
+    zdtm_compact_address **pp_compact) {
+
+    zdtm_compact_address *p_compact;
+    const char *base, *str;
+    uint32_t len, total;
+    int f;
+
+    base = (const char *)p_item;
+
+    total = 0;
+    for (f = 0; f < ZDTM_ADDR_NUM_FIELDS; f++) {
+        memcpy(&len, base + _zdtm_compact_fields[f].len_offset, sizeof(len));
+        if (len > 0xffff - total) {
+            return -1;
+        }
+        total += len;
+    }
+
+    p_compact = _zdtm_compact_alloc(total);
+    if (p_compact == NULL) {
+        return -2;
+    }
+
+    p_compact->sync_id = p_item->sync_id;
+    p_compact->attribute = p_item->attribute;
+    memcpy(p_compact->creation_date, p_item->creation_date,
+        sizeof(p_compact->creation_date));
+    memcpy(p_compact->modification_date, p_item->modification_date,
+        sizeof(p_compact->modification_date));
+
+    total = 0;
+    for (f = 0; f < ZDTM_ADDR_NUM_FIELDS; f++) {
+        memcpy(&len, base + _zdtm_compact_fields[f].len_offset, sizeof(len));
+        memcpy(&str, base + _zdtm_compact_fields[f].offset, sizeof(str));
+        p_compact->offsets[f] = total;
+        if (len > 0) {
+            memcpy(p_compact->strings + total, str, len);
+        }
+        total += len;
+    }
+    p_compact->offsets[ZDTM_ADDR_NUM_FIELDS] = total;
+
+    (*pp_compact) = p_compact;
+
+    return 0;
+}
+
+/* String field of the given format param, or -1 if it is not one. */
+static int _zdtm_compact_field_of(const struct zdtm_adi_msg_param *param) {
+    int f;
+
+    if (memcmp(param->abrev, "CTGR", 4) == 0) {
+        return (param->type_id == DATA_ID_BARRAY) ? ZDTM_ADDR_CATEGORY : -1;
+    }
+    if (param->type_id != DATA_ID_UTF8) {
+        return -1;
+    }
+    for (f = ZDTM_ADDR_CATEGORY + 1; f < ZDTM_ADDR_NUM_FIELDS; f++) {
+        if (memcmp(param->abrev, _zdtm_compact_fields[f].abrev, 4) == 0) {
+            return f;
+        }
+    }
+
+    return -1;
+}
+
+/* Copy the data of a param into a fixed size member, never more than
+ * the size of the member. */
+static void _zdtm_compact_fixed(void *p_dest, size_t size,
+    const struct zdtm_adr_msg_param *param) {
+
+    if (param->param_len < size) {
+        size = param->param_len;
+    }
+    memcpy(p_dest, param->param_data, size);
+}
+
+int zdtm_compact_address_from_params(
+    const struct zdtm_adi_msg_param *p_param_format,
+    uint16_t num_format_params, const struct zdtm_adr_msg_param *params,
+    uint16_t num_params, zdtm_compact_address **pp_compact) {
+
+    zdtm_compact_address *p_compact;
+    int src[ZDTM_ADDR_NUM_FIELDS];
+    uint32_t total;
+    uint16_t i;
+    int f;
+
+    if (num_format_params != num_params) {
+        return -1;
+    }
+
+    /* Find the param of each field, the last one as the item structure
+     * parsing does, and size the strings. */
+    for (f = 0; f < ZDTM_ADDR_NUM_FIELDS; f++) {
+        src[f] = -1;
+    }
+    for (i = 0; i < num_format_params; i++) {
+        f = _zdtm_compact_field_of(&p_param_format[i]);
+        if (f >= 0) {
+            src[f] = i;
+        }
+    }
+    total = 0;
+    for (f = 0; f < ZDTM_ADDR_NUM_FIELDS; f++) {
+        if (src[f] < 0) {
+            continue;
+        }
+        if (params[src[f]].param_len > 0xffff - total) {
+            return -1;
+        }
+        total += params[src[f]].param_len;
+    }
+
+    p_compact = _zdtm_compact_alloc(total);
+    if (p_compact == NULL) {
+        return -2;
+    }
+
+    for (i = 0; i < num_format_params; i++) {
+        if (memcmp(p_param_format[i].abrev, "ATTR", 4) == 0) {
+            if (p_param_format[i].type_id == DATA_ID_BIT) {
+                _zdtm_compact_fixed(&p_compact->attribute,
+                    sizeof(p_compact->attribute), &params[i]);
+            }
+        } else if (memcmp(p_param_format[i].abrev, "CTTM", 4) == 0) {
+            if (p_param_format[i].type_id == DATA_ID_TIME) {
+                _zdtm_compact_fixed(p_compact->creation_date,
+                    sizeof(p_compact->creation_date), &params[i]);
+            }
+        } else if (memcmp(p_param_format[i].abrev, "MDTM", 4) == 0) {
+            if (p_param_format[i].type_id == DATA_ID_TIME) {
+                _zdtm_compact_fixed(p_compact->modification_date,
+                    sizeof(p_compact->modification_date), &params[i]);
+            }
+        } else if (memcmp(p_param_format[i].abrev, "SYID", 4) == 0) {
+            if (p_param_format[i].type_id == DATA_ID_ULONG) {
+                _zdtm_compact_fixed(&p_compact->sync_id,
+                    sizeof(p_compact->sync_id), &params[i]);
+            }
+        }
+    }
+
+    total = 0;
+    for (f = 0; f < ZDTM_ADDR_NUM_FIELDS; f++) {
+        p_compact->offsets[f] = total;
+        if ((src[f] >= 0) && (params[src[f]].param_len > 0)) {
+            memcpy(p_compact->strings + total, params[src[f]].param_data,
+                params[src[f]].param_len);
+            total += params[src[f]].param_len;
+        }
+    }
+    p_compact->offsets[ZDTM_ADDR_NUM_FIELDS] = total;
+
+    (*pp_compact) = p_compact;
+
+    return 0;
+}
+
+void zdtm_compact_address_view(const zdtm_compact_address *p_compact,
+    struct zdtm_address_item *p_item) {
+
+    char *base, *str;
+    uint32_t len;
+    int f;
+
+    memset(p_item, 0, sizeof(struct zdtm_address_item));
+    p_item->sync_id = p_compact->sync_id;
+    p_item->attribute = p_compact->attribute;
+    memcpy(p_item->creation_date, p_compact->creation_date,
+        sizeof(p_item->creation_date));
+    memcpy(p_item->modification_date, p_compact->modification_date,
+        sizeof(p_item->modification_date));
+
+    base = (char *)p_item;
+    for (f = 0; f < ZDTM_ADDR_NUM_FIELDS; f++) {
+        len = p_compact->offsets[f + 1] - p_compact->offsets[f];
+        str = (char *)p_compact->strings + p_compact->offsets[f];
+        memcpy(base + _zdtm_compact_fields[f].len_offset, &len, sizeof(len));
+        memcpy(base + _zdtm_compact_fields[f].offset, &str, sizeof(str));
+    }
+}
@@ -0,0 +1,189 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+
+/**
+ * @file zdtm_compact.h
+ * @brief This is a specifications file for compact Address items.
+ *
+ * The zdtm_compact.h file is a specifications file for Address items
+ * held in a single allocation. The zdtm_address_item structure keeps a
+ * length and a separately allocated string for each of its fields,
+ * which is convenient to fill in but costly to keep around in large
+ * numbers. A compact Address item instead packs all of its strings
+ * back to back behind a table of 16 bit offsets, so that a cache of
+ * many contacts takes a fraction of the memory and is scanned without
+ * chasing pointers across the heap.
+ */
+
+#ifndef ZDTM_COMPACT_H
+#define ZDTM_COMPACT_H
+
+#include "zdtm_export.h"
+#include "zdtm_types.h"
+#include "zdtm_adr_msg.h"
+
+/**
+ * Compact Address item fields.
+ *
+ * The string fields of a compact Address item, in the order of the
+ * members of the zdtm_address_item structure.
+ */
+enum zdtm_address_field {
+    ZDTM_ADDR_CATEGORY,
+    ZDTM_ADDR_FULL_NAME,
+    ZDTM_ADDR_FULL_NAME_PRONUN,
+    ZDTM_ADDR_TITLE,
+    ZDTM_ADDR_LAST_NAME,
+    ZDTM_ADDR_FIRST_NAME,
+    ZDTM_ADDR_MIDDLE_NAME,
+    ZDTM_ADDR_SUFFIX,
+    ZDTM_ADDR_ALTERNATIVE_NAME,
+    ZDTM_ADDR_LAST_NAME_PRONUN,
+    ZDTM_ADDR_FIRST_NAME_PRONUN,
+    ZDTM_ADDR_COMPANY,
+    ZDTM_ADDR_COMPANY_PRONUN,
+    ZDTM_ADDR_DEPARTMENT,
+    ZDTM_ADDR_JOB_TITLE,
+    ZDTM_ADDR_WORK_PHONE,
+    ZDTM_ADDR_WORK_FAX,
+    ZDTM_ADDR_WORK_MOBILE,
+    ZDTM_ADDR_WORK_STATE,
+    ZDTM_ADDR_WORK_CITY,
+    ZDTM_ADDR_WORK_STREET,
+    ZDTM_ADDR_WORK_ZIP,
+    ZDTM_ADDR_WORK_COUNTRY,
+    ZDTM_ADDR_WORK_WEB_PAGE,
+    ZDTM_ADDR_OFFICE,
+    ZDTM_ADDR_PROFESSION,
+    ZDTM_ADDR_ASSISTANT,
+    ZDTM_ADDR_MANAGER,
+    ZDTM_ADDR_PAGER,
+    ZDTM_ADDR_CELLULAR,
+    ZDTM_ADDR_HOME_PHONE,
+    ZDTM_ADDR_HOME_FAX,
+    ZDTM_ADDR_HOME_STATE,
+    ZDTM_ADDR_HOME_CITY,
+    ZDTM_ADDR_HOME_STREET,
+    ZDTM_ADDR_HOME_ZIP,
+    ZDTM_ADDR_HOME_COUNTRY,
+    ZDTM_ADDR_HOME_WEB_PAGE,
+    ZDTM_ADDR_DEFAULT_EMAIL,
+    ZDTM_ADDR_EMAILS,
+    ZDTM_ADDR_SPOUSE,
+    ZDTM_ADDR_GENDER,
+    ZDTM_ADDR_BIRTHDAY,
+    ZDTM_ADDR_ANNIVERSARY,
+    ZDTM_ADDR_NICKNAME,
+    ZDTM_ADDR_CHILDREN,
+    ZDTM_ADDR_MEMO,
+    ZDTM_ADDR_GROUP,
+    ZDTM_ADDR_NUM_FIELDS
+};
+
+/**
+ * Compact Address item.
+ *
+ * The zdtm_compact_address is a structure which represents an Address
+ * item in a single allocation. The string of field f starts at
+ * strings[offsets[f]] and ends at strings[offsets[f + 1]], so the
+ * strings all told are at most 0xffff bytes long, which any item
+ * carried by a single message is. As with zdtm_address_item the
+ * strings are not NUL terminated. A compact Address item is built by
+ * zdtm_compact_address_from_item(), zdtm_compact_address_from_params(),
+ * or zdtm_obtain_compact_address(), and released with free().
+ */
+typedef struct zdtm_compact_address {
+    uint32_t sync_id;
+    unsigned char attribute;
+    char creation_date[5];
+    char modification_date[5];
+    uint16_t offsets[ZDTM_ADDR_NUM_FIELDS + 1];
+    char strings[];
+} zdtm_compact_address;
+
+/**
+ * Compact Address item.
+ *
+ * The zdtm_compact_address_from_item function builds a compact Address
+ * item holding a copy of the given Address item.
+ * @param p_item Pointer to the Address item to copy.
+ * @param pp_compact Pointer to store the pointer to the compact Address
+ * item in, which must be freed using the free() function.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully built the compact Address item.
+ * @retval -1 Failed, the strings of the item are over 0xffff bytes.
+ * @retval -2 Failed to allocate memory for the compact Address item.
+ */
+ZDTM_EXPORT int zdtm_compact_address_from_item(
+    const struct zdtm_address_item *p_item,
+    zdtm_compact_address **pp_compact);
+
+/**
+ * Compact Address item from params.
+ *
+ * The zdtm_compact_address_from_params function builds a compact
+ * Address item straight from the params of an item, such as those of
+ * an ADR message, copying each string once and only into the compact
+ * Address item. The params are matched against the parameter format
+ * just as _zdtm_parse_address_item_params() matches them.
+ * @param p_param_format Pointer to the params of the format.
+ * @param num_format_params The number of params of the format.
+ * @param params Pointer to the params of the item.
+ * @param num_params The number of params of the item.
+ * @param pp_compact Pointer to store the pointer to the compact Address
+ * item in, which must be freed using the free() function.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully built the compact Address item.
+ * @retval -1 Failed, the item has another number of params than the
+ * format, or its strings are over 0xffff bytes.
+ * @retval -2 Failed to allocate memory for the compact Address item.
+ */
+ZDTM_EXPORT int zdtm_compact_address_from_params(
+    const struct zdtm_adi_msg_param *p_param_format,
+    uint16_t num_format_params, const struct zdtm_adr_msg_param *params,
+    uint16_t num_params, zdtm_compact_address **pp_compact);
+
+/**
+ * View compact Address item.
+ *
+ * The zdtm_compact_address_view function fills in an Address item
+ * whose string members point into the given compact Address item,
+ * without copying anything, so that it can be handed to the functions
+ * taking a zdtm_address_item such as zdtm_write_address_items(). The
+ * string members of the Address item must not be freed, and are only
+ * valid as long as the compact Address item is.
+ * @param p_compact Pointer to the compact Address item to view.
+ * @param p_item Pointer to the Address item to fill in.
+ */
+ZDTM_EXPORT void zdtm_compact_address_view(
+    const zdtm_compact_address *p_compact,
+    struct zdtm_address_item *p_item);
+
+/* String of the given field, whose length is stored in p_len. */
+static inline const char *zdtm_compact_address_field(
+    const zdtm_compact_address *p_compact, enum zdtm_address_field field,
+    uint16_t *p_len) {
+    (*p_len) = p_compact->offsets[field + 1] - p_compact->offsets[field];
+    return p_compact->strings + p_compact->offsets[field];
+}
+
+#endif /* ZDTM_COMPACT_H */
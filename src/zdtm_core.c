@@ -0,0 +1,483 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+/**
+ * @file zdtm_core.c
+ * @brief This is an implementation file for the protocol core.
+ *
+ * The zdtm_core.c file is an implementation file for the sans-I/O core
+ * of the Zaurus DTM protocol, the rqst/ack framing state machine which
+ * the blocking network functions and the protocol steps are built on.
+ */
+
+#include "zdtm_core.h"
+
+// States of the exchange in progress.
+#define ZDTM_CORE_IDLE 0
+#define ZDTM_CORE_WAIT_RQST 1
+#define ZDTM_CORE_SEND_MSG 2
+#define ZDTM_CORE_WAIT_ACK 3
+#define ZDTM_CORE_SEND_RQST 4
+#define ZDTM_CORE_WAIT_MSG 5
+#define ZDTM_CORE_SEND_ACK 6
+
+// Parts of the frame being read.
+#define ZDTM_FRAME_COMMON 0
+#define ZDTM_FRAME_HEADER 1
+#define ZDTM_FRAME_BODY 2
+
+// The size of the largest message.
+#define ZDTM_MSG_MAX_SIZE (ZDTM_MSG_OVERHEAD + ZDTM_MSG_MAX_CONT)
+
+static const unsigned char ACK_MSG[COM_MSG_SIZE] = {0x00, 0x00, 0x00,
+    0x00, 0x00, 0x96, 0x06};
+static const unsigned char RQST_MSG[COM_MSG_SIZE] = {0x00, 0x00, 0x00,
+    0x00, 0x00, 0x96, 0x05};
+
+int _zdtm_encode_message(zdtm_lib_env *cur_env, zdtm_msg *p_msg,
+    unsigned char **pp_buf, uint32_t *p_cap, uint32_t *p_size) {
+
+    unsigned char *p_buf;
+    uint32_t cap;
+    int r;
+
+    /* The message is written into the buffer as it stands and the
+     * buffer is only grown, and the message written again, when it is
+     * too small, which a buffer reused across messages rarely is. */
+    for (;;) {
+        r = RET_BAD_SIZE;
+        if ((*pp_buf) != NULL) {
+            r = _zdtm_write_message(p_msg, (*pp_buf), (*p_cap), p_size);
+        }
+        if ((r != RET_BAD_SIZE) || ((*p_cap) >= ZDTM_MSG_MAX_SIZE)) {
+            break;
+        }
+
+        cap = ((*p_cap) < 256) ? 256 : ((*p_cap) * 2);
+        if (cap > ZDTM_MSG_MAX_SIZE) {
+            cap = ZDTM_MSG_MAX_SIZE;
+        }
+        p_buf = realloc((*pp_buf), (size_t)cap);
+        if (p_buf == NULL) {
+            _zdtm_clean_message(p_msg);
+            return RET_MALLOC_FAIL;
+        }
+        (*pp_buf) = p_buf;
+        (*p_cap) = cap;
+    }
+
+    _zdtm_clean_message(p_msg);
+
+    return (r == 0) ? 0 : -1;
+}
+
+void _zdtm_core_init(zdtm_core *p_core, zdtm_lib_env *cur_env) {
+    memset(p_core, 0, sizeof(zdtm_core));
+    p_core->env = cur_env;
+    p_core->state = ZDTM_CORE_IDLE;
+}
+
+void _zdtm_core_cleanup(zdtm_core *p_core) {
+    _zdtm_clean_message(&p_core->msg);
+    memset(&p_core->msg, 0, sizeof(zdtm_msg));
+
+    if (p_core->out != NULL) {
+        free(p_core->out);
+        p_core->out = NULL;
+    }
+    p_core->out_cap = 0;
+
+    if (p_core->body != NULL) {
+        free(p_core->body);
+        p_core->body = NULL;
+    }
+    p_core->body_cap = 0;
+}
+
+/**
+ * Finish exchange.
+ *
+ * The _zdtm_core_finish function finishes the exchange in progress with
+ * the given result. If a step is being run it is handed the result so
+ * that it may queue its next exchange, otherwise the core is done.
+ * @param p_core Pointer to the protocol core.
+ * @param result The result of the exchange.
+ */
+static void _zdtm_core_finish(zdtm_core *p_core, int result) {
+    int r, retval;
+
+    p_core->state = ZDTM_CORE_IDLE;
+    p_core->result = result;
+
+    if (p_core->step == NULL) {
+        p_core->retval = result;
+        p_core->done = 1;
+        return;
+    }
+
+    retval = 0;
+    r = p_core->step(p_core, &retval);
+
+    _zdtm_clean_message(&p_core->msg);
+    memset(&p_core->msg, 0, sizeof(zdtm_msg));
+
+    if (r != 0) {
+        p_core->retval = retval;
+        p_core->done = 1;
+    }
+}
+
+/**
+ * Start writing.
+ *
+ * The _zdtm_core_write function moves the core into the given writing
+ * state with the given bytes waiting to be written.
+ * @param p_core Pointer to the protocol core.
+ * @param state The writing state to move into.
+ * @param buf Pointer to the bytes to write.
+ * @param size The number of bytes to write.
+ */
+static void _zdtm_core_write(zdtm_core *p_core, int state,
+    const unsigned char *buf, uint32_t size) {
+
+    p_core->state = state;
+    p_core->p_out = buf;
+    p_core->out_size = size;
+    p_core->out_off = 0;
+}
+
+/**
+ * Start reading.
+ *
+ * The _zdtm_core_read function moves the core into the given reading
+ * state, waiting for the first bytes of a frame, which are as many as
+ * make up a common message.
+ * @param p_core Pointer to the protocol core.
+ * @param state The reading state to move into.
+ */
+static void _zdtm_core_read(zdtm_core *p_core, int state) {
+    p_core->state = state;
+    p_core->frame_state = ZDTM_FRAME_COMMON;
+    p_core->in_size = COM_MSG_SIZE;
+    p_core->in_off = 0;
+}
+
+/**
+ * Handle a read frame.
+ *
+ * The _zdtm_core_frame_done function moves the exchange in progress on
+ * once a frame has been read, or failed to be read.
+ * @param p_core Pointer to the protocol core.
+ * @param r The result of reading the frame, as per _zdtm_recv_message.
+ */
+static void _zdtm_core_frame_done(zdtm_core *p_core, int r) {
+    switch (p_core->state) {
+        case ZDTM_CORE_WAIT_RQST:
+            if (r == 2) {
+                _zdtm_core_write(p_core, ZDTM_CORE_SEND_MSG, p_core->out,
+                    p_core->out_size);
+            } else {
+                _zdtm_core_finish(p_core, -1);
+            }
+            break;
+        case ZDTM_CORE_WAIT_ACK:
+            if (r == 1) {
+                _zdtm_core_finish(p_core, 0);
+            } else {
+                _zdtm_core_finish(p_core, -3);
+            }
+            break;
+        case ZDTM_CORE_WAIT_MSG:
+            if (p_core->xchg == ZDTM_XCHG_GET) {
+                _zdtm_core_finish(p_core, r);
+            } else if (r < 0) {
+                _zdtm_core_finish(p_core, -2);
+            } else if (r > 0) {
+                _zdtm_core_finish(p_core, r);
+            } else {
+                _zdtm_core_write(p_core, ZDTM_CORE_SEND_ACK, ACK_MSG,
+                    COM_MSG_SIZE);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * Decode a read frame.
+ *
+ * The _zdtm_core_decode function fills in the msg member of the core
+ * from the header and body of a general message which has been read
+ * completely, and parses its content.
+ * @param p_core Pointer to the protocol core.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully decoded the message.
+ * @retval RET_BAD_SIZE Failed, the body is too short for a message type.
+ * @retval RET_MEM_CONTENT Failed to allocate mem for message content.
+ * @retval RET_PARSE_RAW_FAIL Failed to parse the raw message.
+ */
+static int _zdtm_core_decode(zdtm_core *p_core) {
+    zdtm_msg *p_msg;
+
+    p_msg = &p_core->msg;
+
+    // Set the zdtm_message header
+    memcpy((void *)p_msg->header, p_core->hdr, MSG_HDR_SIZE);
+
+    // Set the zdtm_message body size
+    p_msg->body_size = zdtm_get_le16(p_core->hdr + MSG_HDR_SIZE);
+    if (p_msg->body_size < MSG_TYPE_SIZE) {
+        return RET_BAD_SIZE;
+    }
+
+    // Set the zdtm_message_body type
+    memcpy((void *)p_msg->body.type, (const void *)p_core->body,
+        MSG_TYPE_SIZE);
+
+    // Set the zdtm_message cont_size and the zdtm_message_body content
+    p_msg->cont_size = p_msg->body_size - MSG_TYPE_SIZE;
+    if (p_msg->cont_size > 0) {
+        p_msg->body.p_raw_content = malloc((size_t)p_msg->cont_size);
+        if (p_msg->body.p_raw_content == NULL) {
+            return RET_MEM_CONTENT;
+        }
+        memcpy(p_msg->body.p_raw_content,
+            (const void *)(p_core->body + MSG_TYPE_SIZE),
+            p_msg->cont_size);
+    }
+
+    // Set the zdtm_message check_sum
+    p_msg->check_sum = zdtm_get_le16(p_core->body + p_msg->body_size);
+
+    // ADR content asked for raw is handed over by the step unparsed.
+    if (!(p_core->raw_adr && IS_ADR(p_msg)) &&
+        (_zdtm_parse_raw_msg(p_msg) != 0)) {
+        return RET_PARSE_RAW_FAIL;
+    }
+
+    _zdtm_dump_msg_log(p_core->env, p_msg);
+
+    return 0;
+}
+
+int _zdtm_core_exchange(zdtm_core *p_core, int xchg, zdtm_msg *p_msg) {
+    int r;
+
+    p_core->xchg = xchg;
+    p_core->done = 0;
+
+    switch (xchg) {
+        case ZDTM_XCHG_SEND:
+        case ZDTM_XCHG_PUT:
+            _zdtm_dump_msg_log(p_core->env, p_msg);
+            r = _zdtm_encode_message(p_core->env, p_msg, &p_core->out,
+                &p_core->out_cap, &p_core->out_size);
+            if (r != 0) {
+                return r;
+            }
+            if (xchg == ZDTM_XCHG_SEND) {
+                _zdtm_core_read(p_core, ZDTM_CORE_WAIT_RQST);
+            } else {
+                _zdtm_core_write(p_core, ZDTM_CORE_SEND_MSG, p_core->out,
+                    p_core->out_size);
+            }
+            break;
+        case ZDTM_XCHG_RECV:
+            _zdtm_core_write(p_core, ZDTM_CORE_SEND_RQST, RQST_MSG,
+                COM_MSG_SIZE);
+            break;
+        default:
+            _zdtm_core_read(p_core, ZDTM_CORE_WAIT_MSG);
+            break;
+    }
+
+    return 0;
+}
+
+void _zdtm_core_start(zdtm_core *p_core, zdtm_core_step step) {
+    int retval;
+
+    p_core->step = step;
+    p_core->step_state = 0;
+    p_core->result = 0;
+    p_core->done = 0;
+
+    retval = 0;
+    if (step(p_core, &retval) != 0) {
+        p_core->retval = retval;
+        p_core->done = 1;
+    }
+}
+
+uint32_t _zdtm_core_output(zdtm_core *p_core, const unsigned char **pp_buf) {
+    if ((p_core->state != ZDTM_CORE_SEND_MSG) &&
+        (p_core->state != ZDTM_CORE_SEND_RQST) &&
+        (p_core->state != ZDTM_CORE_SEND_ACK)) {
+        return 0;
+    }
+
+    (*pp_buf) = p_core->p_out + p_core->out_off;
+    return p_core->out_size - p_core->out_off;
+}
+
+void _zdtm_core_written(zdtm_core *p_core, uint32_t size) {
+    p_core->out_off += size;
+    if (p_core->out_off < p_core->out_size) {
+        return;
+    }
+
+    switch (p_core->state) {
+        case ZDTM_CORE_SEND_MSG:
+            if (p_core->xchg == ZDTM_XCHG_PUT) {
+                _zdtm_core_finish(p_core, 0);
+            } else {
+                _zdtm_core_read(p_core, ZDTM_CORE_WAIT_ACK);
+            }
+            break;
+        case ZDTM_CORE_SEND_RQST:
+            _zdtm_core_read(p_core, ZDTM_CORE_WAIT_MSG);
+            break;
+        case ZDTM_CORE_SEND_ACK:
+            _zdtm_core_finish(p_core, 0);
+            break;
+        default:
+            break;
+    }
+}
+
+uint32_t _zdtm_core_want(zdtm_core *p_core, unsigned char **pp_buf) {
+    if ((p_core->state != ZDTM_CORE_WAIT_RQST) &&
+        (p_core->state != ZDTM_CORE_WAIT_ACK) &&
+        (p_core->state != ZDTM_CORE_WAIT_MSG)) {
+        return 0;
+    }
+
+    if (p_core->frame_state == ZDTM_FRAME_BODY) {
+        (*pp_buf) = p_core->body + p_core->in_off;
+    } else {
+        (*pp_buf) = p_core->hdr + p_core->in_off;
+    }
+
+    return p_core->in_size - p_core->in_off;
+}
+
+void _zdtm_core_received(zdtm_core *p_core, uint32_t size) {
+    unsigned char *tmp_p;
+    uint16_t body_size;
+
+    p_core->in_off += size;
+    if (p_core->in_off < p_core->in_size) {
+        return;
+    }
+
+    switch (p_core->frame_state) {
+        case ZDTM_FRAME_COMMON:
+            /* The first bytes of a frame are compared to the known
+             * common messages. If they are none of them the frame is
+             * a general message and the rest of its header as well as
+             * its body size is read next. */
+            if (_zdtm_is_ack_message(p_core->hdr)) {
+                _zdtm_core_frame_done(p_core, 1);
+            } else if (_zdtm_is_rqst_message(p_core->hdr)) {
+                _zdtm_core_frame_done(p_core, 2);
+            } else if (_zdtm_is_abrt_message(p_core->hdr)) {
+                _zdtm_core_frame_done(p_core, 3);
+            } else {
+                p_core->frame_state = ZDTM_FRAME_HEADER;
+                p_core->in_size = MSG_HDR_SIZE + sizeof(uint16_t);
+            }
+            break;
+        case ZDTM_FRAME_HEADER:
+            body_size = zdtm_get_le16(p_core->hdr + MSG_HDR_SIZE);
+            if (((uint32_t)body_size + sizeof(uint16_t)) > p_core->body_cap) {
+                tmp_p = realloc(p_core->body,
+                    (size_t)body_size + sizeof(uint16_t));
+                if (tmp_p == NULL) {
+                    _zdtm_core_frame_done(p_core, -4);
+                    break;
+                }
+                p_core->body = tmp_p;
+                p_core->body_cap = body_size + sizeof(uint16_t);
+            }
+            p_core->frame_state = ZDTM_FRAME_BODY;
+            p_core->in_size = body_size + sizeof(uint16_t);
+            p_core->in_off = 0;
+            break;
+        default:
+            _zdtm_core_frame_done(p_core, _zdtm_core_decode(p_core));
+            break;
+    }
+}
+
+uint32_t _zdtm_core_input(zdtm_core *p_core, const unsigned char *buf,
+    uint32_t size) {
+
+    unsigned char *p_in;
+    uint32_t want, used;
+
+    used = 0;
+    while (used < size) {
+        want = _zdtm_core_want(p_core, &p_in);
+        if (want == 0) {
+            break;
+        }
+        if (want > (size - used)) {
+            want = size - used;
+        }
+        memcpy(p_in, buf + used, want);
+        used += want;
+        _zdtm_core_received(p_core, want);
+    }
+
+    return used;
+}
+
+void _zdtm_core_abort(zdtm_core *p_core, int reason) {
+    switch (p_core->state) {
+        case ZDTM_CORE_SEND_MSG:
+            _zdtm_core_finish(p_core, -2);
+            break;
+        case ZDTM_CORE_SEND_RQST:
+            _zdtm_core_finish(p_core, -1);
+            break;
+        case ZDTM_CORE_SEND_ACK:
+            _zdtm_core_finish(p_core, -3);
+            break;
+        case ZDTM_CORE_WAIT_RQST:
+        case ZDTM_CORE_WAIT_ACK:
+        case ZDTM_CORE_WAIT_MSG:
+            if (reason == ZDTM_CORE_IO_ERROR) {
+                _zdtm_core_frame_done(p_core, -3);
+            } else if (p_core->in_off == 0) {
+                /* Closed cleanly by the opposite end. */
+                _zdtm_core_frame_done(p_core, -1);
+            } else {
+                /* Closed by the opposite end in the mid of a msg. */
+                _zdtm_core_frame_done(p_core, -2);
+            }
+            break;
+        default:
+            /* A step which left the core without an exchange. */
+            _zdtm_core_finish(p_core, -3);
+            break;
+    }
+}
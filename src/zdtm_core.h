@@ -0,0 +1,283 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+/**
+ * @file zdtm_core.h
+ * @brief This is a specifications file for the protocol core.
+ *
+ * The zdtm_core.h file is a specifications file for the sans-I/O core
+ * of the Zaurus DTM protocol. The core is a state machine which never
+ * touches a socket. It consumes the bytes received from the Zaurus and
+ * produces the bytes to be written to the Zaurus, and it is up to a
+ * driver to move those bytes over whatever connection is in use. The
+ * blocking functions found in zdtm_net.h are such a driver.
+ *
+ * The core runs exchanges. An exchange is one of the following.
+ *
+ * - SEND: wait for a rqst message, write a general message, then wait
+ *   for an ack message (see _zdtm_wrapped_send_message).
+ * - RECV: write a rqst message, read a general message, then write an
+ *   ack message (see _zdtm_wrapped_recv_message).
+ * - PUT: write a general message as is.
+ * - GET: read a general or common message as is.
+ *
+ * A protocol step (see zdtm_steps.h) is a function which the core calls
+ * each time an exchange finishes, and which queues the next exchange
+ * until the step is complete. A driver runs the core as follows, until
+ * the done member of the core is set, at which point the result of the
+ * step is in the retval member.
+ *
+ * - While _zdtm_core_output() reports bytes, write them and report the
+ *   number written with _zdtm_core_written().
+ * - Otherwise read at most as many bytes as _zdtm_core_want() asks for
+ *   into the buffer it hands out and report them with
+ *   _zdtm_core_received(), or hand arbitrary received bytes to
+ *   _zdtm_core_input().
+ * - If the connection fails or is closed, report it with
+ *   _zdtm_core_abort().
+ */
+
+#ifndef ZDTM_CORE_H
+#define ZDTM_CORE_H
+
+#include "zdtm_types.h"
+#include "zdtm_msgs.h"
+#include "zdtm_log.h"
+
+// Kinds of exchanges run by the protocol core.
+#define ZDTM_XCHG_SEND 1
+#define ZDTM_XCHG_RECV 2
+#define ZDTM_XCHG_PUT 3
+#define ZDTM_XCHG_GET 4
+
+// Reasons for aborting an exchange, see _zdtm_core_abort().
+#define ZDTM_CORE_EOF 1
+#define ZDTM_CORE_IO_ERROR 2
+
+typedef struct zdtm_protocol_core zdtm_core;
+
+/**
+ * Protocol step.
+ *
+ * A zdtm_core_step is a function implementing a protocol step. It is
+ * called once when the step is started with the result member of the
+ * core set to zero and the step_state member set to zero, and then
+ * each time an exchange it queued has finished with the result of the
+ * exchange in the result member and, for RECV and GET exchanges, the
+ * received message in the msg member. The received message is cleaned
+ * by the core after the step returns. The step keeps track of where it
+ * is with the step_state member.
+ * @param p_core Pointer to the protocol core running the step.
+ * @param p_retval Pointer to store the result of the step in.
+ * @return Zero if another exchange was queued, one if the step is done.
+ */
+typedef int (*zdtm_core_step)(zdtm_core *p_core, int *p_retval);
+
+/**
+ * Protocol core.
+ *
+ * The zdtm_protocol_core structure holds the state of an exchange in
+ * progress along with the bytes waiting to be written and the frame
+ * being read. The members following the step member are the arguments
+ * and results of the protocol steps.
+ */
+struct zdtm_protocol_core {
+    zdtm_lib_env *env;      // environment the protocol acts on
+    int xchg;               // kind of the exchange in progress
+    int state;              // state of the exchange in progress
+    int result;             // result of the last finished exchange
+    zdtm_msg msg;           // message read by the last exchange
+    unsigned char *out;     // encoded general message to be written
+    uint32_t out_cap;       // allocated size of out
+    const unsigned char *p_out; // bytes being written, out or a common msg
+    uint32_t out_size;      // number of bytes being written
+    uint32_t out_off;       // number of bytes already written
+    int frame_state;        // part of the frame being read
+    unsigned char hdr[MSG_HDR_SIZE + sizeof(uint16_t)]; // frame header
+    unsigned char *body;    // frame body and check sum
+    uint32_t body_cap;      // allocated size of body
+    uint32_t in_size;       // number of bytes of the frame part
+    uint32_t in_off;        // number of bytes of the frame part read
+    zdtm_core_step step;    // protocol step being run, NULL if none
+    int step_state;         // position within the protocol step
+    int done;               // flag stating the step has finished
+    int retval;             // result of the finished step
+    uint32_t sync_id;       // sync id the step operates on
+    const char *passcode;   // passcode the step authenticates with
+    struct zdtm_adr_msg_param *params; // params of an obtained item
+    uint16_t num_params;    // number of params of an obtained item
+    int raw_adr;            // flag stating ADR content is left unparsed
+    void *raw;              // raw content of an obtained item
+    uint16_t raw_size;      // size of the raw content of an obtained item
+    uint32_t *ids[3];       // new, mod, and del sync id lists
+    uint16_t num_ids[3];    // number of sync ids in each list
+};
+
+/**
+ * Encode a message.
+ *
+ * The _zdtm_encode_message function lays out the given message in the
+ * form it is written to the Zaurus in with _zdtm_write_message(). The
+ * buffer is grown as needed. The message is cleaned whether or not the
+ * function succeeds, the same as when it is sent.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param p_msg Pointer to the message to encode.
+ * @param pp_buf Pointer to the buffer to encode into, may point to NULL.
+ * @param p_cap Pointer to the allocated size of the buffer.
+ * @param p_size Pointer to store the size of the encoded message in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully encoded the message.
+ * @retval -1 Failed to write the message.
+ * @retval RET_MALLOC_FAIL Failed to allocate memory for raw message.
+ */
+int _zdtm_encode_message(zdtm_lib_env *cur_env, zdtm_msg *p_msg,
+    unsigned char **pp_buf, uint32_t *p_cap, uint32_t *p_size);
+
+/**
+ * Initialize protocol core.
+ *
+ * The _zdtm_core_init function initializes a protocol core so that it
+ * is ready to start an exchange or a step.
+ * @param p_core Pointer to the protocol core to initialize.
+ * @param cur_env Pointer to the current zdtm library environment.
+ */
+void _zdtm_core_init(zdtm_core *p_core, zdtm_lib_env *cur_env);
+
+/**
+ * Clean up protocol core.
+ *
+ * The _zdtm_core_cleanup function frees the buffers of a protocol core
+ * and any message still held in its msg member.
+ * @param p_core Pointer to the protocol core to clean up.
+ */
+void _zdtm_core_cleanup(zdtm_core *p_core);
+
+/**
+ * Start exchange.
+ *
+ * The _zdtm_core_exchange function queues an exchange of the given
+ * kind. The message is only used by SEND and PUT exchanges, it is
+ * encoded right away and cleaned. When no step is being run the done
+ * member of the core is set as soon as the exchange finishes, the
+ * retval member then holding the result of the exchange.
+ *
+ * The result of a SEND exchange is zero on success, -1 if no rqst
+ * message was received, -2 if the message failed to be written, and
+ * -3 if no ack message was received. The result of a RECV exchange is
+ * zero on success, one, two or three if an ack, rqst or abort message
+ * was received in place of a general message, -1 if the rqst message
+ * failed to be written, -2 if no message was received, and -3 if the
+ * ack message failed to be written. The result of a PUT exchange is
+ * zero on success or -2 if the message failed to be written. The
+ * result of a GET exchange is that of _zdtm_recv_message().
+ * @param p_core Pointer to the protocol core.
+ * @param xchg The kind of exchange, one of the ZDTM_XCHG_ values.
+ * @param p_msg Pointer to the message to send, NULL for RECV and GET.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully queued the exchange.
+ * @retval -1 Failed to prepare message.
+ * @retval RET_MALLOC_FAIL Failed to allocate memory for raw message.
+ */
+int _zdtm_core_exchange(zdtm_core *p_core, int xchg, zdtm_msg *p_msg);
+
+/**
+ * Start protocol step.
+ *
+ * The _zdtm_core_start function starts running a protocol step on the
+ * core. The arguments of the step are to be set in the core before
+ * calling it.
+ * @param p_core Pointer to the protocol core.
+ * @param step The protocol step to run.
+ */
+void _zdtm_core_start(zdtm_core *p_core, zdtm_core_step step);
+
+/**
+ * Obtain output.
+ *
+ * The _zdtm_core_output function hands out the bytes waiting to be
+ * written to the Zaurus.
+ * @param p_core Pointer to the protocol core.
+ * @param pp_buf Pointer to store a pointer to the bytes in.
+ * @return The number of bytes waiting to be written.
+ */
+uint32_t _zdtm_core_output(zdtm_core *p_core, const unsigned char **pp_buf);
+
+/**
+ * Report written output.
+ *
+ * The _zdtm_core_written function reports that the given number of
+ * the bytes handed out by _zdtm_core_output() have been written.
+ * @param p_core Pointer to the protocol core.
+ * @param size The number of bytes written.
+ */
+void _zdtm_core_written(zdtm_core *p_core, uint32_t size);
+
+/**
+ * Obtain input buffer.
+ *
+ * The _zdtm_core_want function hands out the buffer the next bytes
+ * received from the Zaurus are to be read into. No more bytes than
+ * asked for may be read, so that no bytes of the following message are
+ * consumed. The buffer is only valid until the next call to any of the
+ * functions of the core.
+ * @param p_core Pointer to the protocol core.
+ * @param pp_buf Pointer to store a pointer to the buffer in.
+ * @return The number of bytes wanted, zero if no input is wanted.
+ */
+uint32_t _zdtm_core_want(zdtm_core *p_core, unsigned char **pp_buf);
+
+/**
+ * Report received input.
+ *
+ * The _zdtm_core_received function reports that the given number of
+ * bytes have been read into the buffer handed out by _zdtm_core_want().
+ * @param p_core Pointer to the protocol core.
+ * @param size The number of bytes read.
+ */
+void _zdtm_core_received(zdtm_core *p_core, uint32_t size);
+
+/**
+ * Feed input.
+ *
+ * The _zdtm_core_input function copies bytes received from the Zaurus
+ * into the core. Only as many bytes as the core wants are consumed,
+ * the remaining ones are to be fed again once the core wants input.
+ * @param p_core Pointer to the protocol core.
+ * @param buf Pointer to the received bytes.
+ * @param size The number of received bytes.
+ * @return The number of bytes consumed.
+ */
+uint32_t _zdtm_core_input(zdtm_core *p_core, const unsigned char *buf,
+    uint32_t size);
+
+/**
+ * Abort exchange.
+ *
+ * The _zdtm_core_abort function reports that the connection the core
+ * is driven over has failed or was closed, and finishes the exchange
+ * in progress with the matching result.
+ * @param p_core Pointer to the protocol core.
+ * @param reason ZDTM_CORE_EOF if the connection was closed by the
+ * Zaurus, ZDTM_CORE_IO_ERROR if reading or writing failed.
+ */
+void _zdtm_core_abort(zdtm_core *p_core, int reason);
+
+#endif
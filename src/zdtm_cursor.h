@@ -0,0 +1,237 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+
+/**
+ * @file zdtm_cursor.h
+ * @brief This is a specifications file for the message codec cursors.
+ *
+ * The zdtm_cursor.h file is a specifications file for the reader and
+ * writer cursors the message modules parse and write raw message
+ * content with. The fields of the protocol are little-endian and are
+ * not aligned, so they are loaded and stored with memcpy and swapped
+ * on big-endian hosts. The loads and stores do not check the bounds
+ * themselves, a message checks once, with zdtm_rd_need() or
+ * zdtm_wr_need(), that what it is about to go through is there. The
+ * writer keeps the byte sum of what it wrote, which is the checksum of
+ * the message, so that the content is not read again to compute it.
+ */
+
+#ifndef ZDTM_CURSOR_H
+#define ZDTM_CURSOR_H
+
+#include "zdtm_gentypes.h"
+
+#if defined(__GNUC__) && \
+    ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 8)))
+#define ZDTM_BSWAP16(x) __builtin_bswap16(x)
+#define ZDTM_BSWAP32(x) __builtin_bswap32(x)
+#else
+#define ZDTM_BSWAP16(x) ((uint16_t)((((x) & 0xff) << 8) | ((x) >> 8)))
+#define ZDTM_BSWAP32(x) ((uint32_t)((((x) & 0xff) << 24) | \
+    (((x) & 0xff00) << 8) | (((x) >> 8) & 0xff00) | ((x) >> 24)))
+#endif
+
+// Convert between little-endian and host order, either way.
+#ifdef WORDS_BIGENDIAN
+#define ZDTM_LE16(x) ZDTM_BSWAP16(x)
+#define ZDTM_LE32(x) ZDTM_BSWAP32(x)
+#else
+#define ZDTM_LE16(x) (x)
+#define ZDTM_LE32(x) (x)
+#endif
+
+/* Load a little-endian field, wherever it lies. */
+static inline uint16_t zdtm_get_le16(const void *p) {
+    uint16_t val;
+
+    memcpy(&val, p, sizeof(uint16_t));
+
+    return ZDTM_LE16(val);
+}
+
+static inline uint32_t zdtm_get_le32(const void *p) {
+    uint32_t val;
+
+    memcpy(&val, p, sizeof(uint32_t));
+
+    return ZDTM_LE32(val);
+}
+
+/* Store a little-endian field, wherever it lies. */
+static inline void zdtm_put_le16(void *p, uint16_t val) {
+    val = ZDTM_LE16(val);
+    memcpy(p, &val, sizeof(uint16_t));
+}
+
+static inline void zdtm_put_le32(void *p, uint32_t val) {
+    val = ZDTM_LE32(val);
+    memcpy(p, &val, sizeof(uint32_t));
+}
+
+/**
+ * Reader cursor.
+ *
+ * The zdtm_reader is a type defined to represent the position reached
+ * in parsing raw message content, along with its end.
+ */
+typedef struct zdtm_reader {
+    const unsigned char *pos;   // next byte to read
+    const unsigned char *end;   // byte past the end of the content
+} zdtm_reader;
+
+/**
+ * Writer cursor.
+ *
+ * The zdtm_writer is a type defined to represent the position reached
+ * in writing raw message content, along with the end of the buffer.
+ */
+typedef struct zdtm_writer {
+    unsigned char *pos;         // next byte to write
+    unsigned char *end;         // byte past the end of the buffer
+    uint16_t sum;               // sum of the bytes written
+} zdtm_writer;
+
+static inline void zdtm_rd_init(zdtm_reader *p_rd, const void *buf,
+    size_t size) {
+    p_rd->pos = (const unsigned char *)buf;
+    p_rd->end = p_rd->pos + size;
+}
+
+/* Number of bytes left to read. */
+static inline size_t zdtm_rd_left(const zdtm_reader *p_rd) {
+    return (size_t)(p_rd->end - p_rd->pos);
+}
+
+/* Zero if there are at least size bytes left to read, else non-zero. */
+static inline int zdtm_rd_need(const zdtm_reader *p_rd, size_t size) {
+    return (zdtm_rd_left(p_rd) >= size) ? 0 : -1;
+}
+
+static inline unsigned char zdtm_rd_u8(zdtm_reader *p_rd) {
+    return *(p_rd->pos++);
+}
+
+static inline uint16_t zdtm_rd_u16(zdtm_reader *p_rd) {
+    uint16_t val;
+
+    val = zdtm_get_le16(p_rd->pos);
+    p_rd->pos += sizeof(uint16_t);
+
+    return val;
+}
+
+static inline uint32_t zdtm_rd_u32(zdtm_reader *p_rd) {
+    uint32_t val;
+
+    val = zdtm_get_le32(p_rd->pos);
+    p_rd->pos += sizeof(uint32_t);
+
+    return val;
+}
+
+static inline void zdtm_rd_bytes(zdtm_reader *p_rd, void *dst,
+    size_t size) {
+    memcpy(dst, p_rd->pos, size);
+    p_rd->pos += size;
+}
+
+/* Skip size bytes, returning where they start. */
+static inline const unsigned char *zdtm_rd_skip(zdtm_reader *p_rd,
+    size_t size) {
+    const unsigned char *p;
+
+    p = p_rd->pos;
+    p_rd->pos += size;
+
+    return p;
+}
+
+static inline void zdtm_wr_init(zdtm_writer *p_wr, void *buf,
+    size_t size) {
+    p_wr->pos = (unsigned char *)buf;
+    p_wr->end = p_wr->pos + size;
+    p_wr->sum = 0;
+}
+
+/* Number of bytes left to write. */
+static inline size_t zdtm_wr_left(const zdtm_writer *p_wr) {
+    return (size_t)(p_wr->end - p_wr->pos);
+}
+
+/* Zero if there is room for size more bytes, else non-zero. */
+static inline int zdtm_wr_need(const zdtm_writer *p_wr, size_t size) {
+    return (zdtm_wr_left(p_wr) >= size) ? 0 : -1;
+}
+
+static inline void zdtm_wr_u8(zdtm_writer *p_wr, unsigned char val) {
+    *(p_wr->pos++) = val;
+    p_wr->sum += val;
+}
+
+static inline void zdtm_wr_u16(zdtm_writer *p_wr, uint16_t val) {
+    zdtm_put_le16(p_wr->pos, val);
+    p_wr->pos += sizeof(uint16_t);
+    p_wr->sum += (val & 0xff) + (val >> 8);
+}
+
+static inline void zdtm_wr_u32(zdtm_writer *p_wr, uint32_t val) {
+    zdtm_put_le32(p_wr->pos, val);
+    p_wr->pos += sizeof(uint32_t);
+    p_wr->sum += (val & 0xff) + ((val >> 8) & 0xff) +
+        ((val >> 16) & 0xff) + (val >> 24);
+}
+
+static inline void zdtm_wr_bytes(zdtm_writer *p_wr, const void *src,
+    size_t size) {
+    const unsigned char *p;
+    uint16_t sum;
+    size_t i;
+
+    p = (const unsigned char *)src;
+    sum = 0;
+    for (i = 0; i < size; i++) {
+        p_wr->pos[i] = p[i];
+        sum += p[i];
+    }
+    p_wr->pos += size;
+    p_wr->sum += sum;
+}
+
+static inline void zdtm_wr_zero(zdtm_writer *p_wr, size_t size) {
+    memset(p_wr->pos, 0x00, size);
+    p_wr->pos += size;
+}
+
+/* Write a field of an item, its 32 bit size followed by its bytes,
+ * checking the room for it. Zero if written, else non-zero. */
+static inline int zdtm_wr_field(zdtm_writer *p_wr, const void *src,
+    uint32_t size) {
+    if (zdtm_wr_need(p_wr, sizeof(uint32_t) + (size_t)size) != 0) {
+        return -1;
+    }
+    zdtm_wr_u32(p_wr, size);
+    zdtm_wr_bytes(p_wr, src, size);
+
+    return 0;
+}
+
+#endif
@@ -0,0 +1,457 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+
+/**
+ * @file zdtm_discover.c
+ * @brief This is an implementation file for device discovery.
+ *
+ * The zdtm_discover.c file is an implementation of device discovery.
+ * The addresses of the range are walked in order, a non-blocking
+ * connect being started to each one as soon as there is room for one
+ * more probe in flight, and the probes are polled all at once. A probe
+ * whose connect completes is kept open, so that identifying the device
+ * reuses it as the connection the RAY message is sent over.
+ */
+
+#include "zdtm_discover.h"
+#include "zdtm_sync.h"
+
+#include <errno.h>
+#include <time.h>
+
+#ifdef WIN32
+#define poll WSAPoll
+#define ZDTM_CONNECT_PENDING (WSAGetLastError() == WSAEWOULDBLOCK)
+#else
+#include <poll.h>
+#include <fcntl.h>
+#define ZDTM_CONNECT_PENDING (errno == EINPROGRESS)
+#endif
+
+/**
+ * Parse range.
+ *
+ * The _zdtm_parse_cidr function parses a range of addresses given in
+ * CIDR notation into the first and last host addresses to probe.
+ * @param cidr The range of addresses.
+ * @param p_first Pointer to store the first address in, in host order.
+ * @param p_num Pointer to store the number of addresses in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ */
+static int _zdtm_parse_cidr(const char *cidr, uint32_t *p_first,
+    uint32_t *p_num) {
+
+    char addr[IP_STR_SIZE];
+    struct in_addr in;
+    const char *slash;
+    char *end;
+    unsigned long prefix;
+    uint32_t mask, num;
+
+    slash = strchr(cidr, '/');
+    if ((slash == NULL) || ((size_t)(slash - cidr) >= IP_STR_SIZE)) {
+        return -1;
+    }
+    memcpy(addr, cidr, slash - cidr);
+    addr[slash - cidr] = '\0';
+
+    prefix = strtoul(slash + 1, &end, 10);
+    if ((slash[1] == '\0') || (*end != '\0') || (prefix > 32)) {
+        return -1;
+    }
+    num = (prefix == 0) ? 0 : ((uint32_t)1 << (32 - prefix));
+    if ((num == 0) || (num > ZDTM_DISCOVER_MAX_HOSTS)) {
+        return -1;
+    }
+
+#ifdef WIN32
+    in.s_addr = inet_addr(addr);
+    if (in.s_addr == INADDR_NONE) {
+        return -1;
+    }
+#else
+    if (inet_pton(AF_INET, addr, &in) <= 0) {
+        return -1;
+    }
+#endif
+
+    mask = ~(num - 1);
+    (*p_first) = ntohl(in.s_addr) & mask;
+    (*p_num) = num;
+
+    /* Leave out the network and broadcast addresses. */
+    if (num > 2) {
+        (*p_first)++;
+        (*p_num) -= 2;
+    }
+
+    return 0;
+}
+
+/**
+ * Obtain elapsed time.
+ *
+ * The _zdtm_elapsed_ms function obtains the milliseconds which passed
+ * since the given time.
+ * @param p_start Pointer to the time to measure from.
+ * @return The number of milliseconds which passed.
+ */
+static long _zdtm_elapsed_ms(const struct timespec *p_start) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (long)(now.tv_sec - p_start->tv_sec) * 1000 +
+        (now.tv_nsec - p_start->tv_nsec) / 1000000;
+}
+
+/**
+ * Close probe.
+ *
+ * The _zdtm_close_probe function closes the socket of a probe.
+ * @param fd The socket to close.
+ */
+static void _zdtm_close_probe(SOCKET fd) {
+#ifdef WIN32
+    closesocket(fd);
+#else
+    close(fd);
+#endif
+}
+
+/**
+ * Start probe.
+ *
+ * The _zdtm_start_probe function starts a non-blocking connect to
+ * ZLISTPORT of the given address.
+ * @param addr The address to probe, in host order.
+ * @param p_fd Pointer to a SOCKET to store the probe in.
+ * @return An integer representing the state of the probe.
+ * @retval 0 The connect completed at once.
+ * @retval 1 The connect is in progress.
+ * @retval -1 The connect failed, nothing listens at the address.
+ */
+static int _zdtm_start_probe(uint32_t addr, SOCKET *p_fd) {
+    struct sockaddr_in sa;
+    SOCKET fd;
+#ifdef WIN32
+    u_long on;
+#else
+    int flags;
+#endif
+
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd == INVALID_SOCKET) {
+        return -1;
+    }
+
+#ifdef WIN32
+    on = 1;
+    if (ioctlsocket(fd, FIONBIO, &on) == SOCKET_ERROR) {
+        _zdtm_close_probe(fd);
+        return -1;
+    }
+#else
+    flags = fcntl(fd, F_GETFL, 0);
+    if ((flags < 0) || (fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)) {
+        _zdtm_close_probe(fd);
+        return -1;
+    }
+#endif
+
+    memset(&sa, 0, sizeof(struct sockaddr_in));
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(ZLISTPORT);
+    sa.sin_addr.s_addr = htonl(addr);
+
+    (*p_fd) = fd;
+
+    if (connect(fd, (struct sockaddr *)&sa, sizeof(sa)) == 0) {
+        return 0;
+    } else if (ZDTM_CONNECT_PENDING) {
+        return 1;
+    }
+
+    _zdtm_close_probe(fd);
+
+    return -1;
+}
+
+/**
+ * Probe range.
+ *
+ * The _zdtm_probe_range function probes the given range of addresses
+ * for listeners on ZLISTPORT within the time budget, storing the
+ * connection made to each address which answered, and INVALID_SOCKET
+ * for the others.
+ * @param first The first address to probe, in host order.
+ * @param num The number of addresses to probe.
+ * @param p_start Pointer to the time the budget started at.
+ * @param budget_ms Milliseconds the probing may take.
+ * @param max_probes Max number of probes at once.
+ * @param p_conns Pointer to an array of num SOCKETs to store in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully probed the range.
+ * @retval -2 Failed to allocate memory.
+ */
+static int _zdtm_probe_range(uint32_t first, uint32_t num,
+    const struct timespec *p_start, int budget_ms, unsigned int max_probes,
+    SOCKET *p_conns) {
+
+    struct pollfd *pfds;
+    uint32_t *hosts;
+    uint32_t next;
+    unsigned int num_probes, i;
+    long left;
+    int r, err;
+    socklen_t len;
+
+    pfds = (struct pollfd *)malloc(sizeof(struct pollfd) * max_probes);
+    hosts = (uint32_t *)malloc(sizeof(uint32_t) * max_probes);
+    if ((pfds == NULL) || (hosts == NULL)) {
+        free(pfds);
+        free(hosts);
+        return -2;
+    }
+
+    for (next = 0; next < num; next++) {
+        p_conns[next] = INVALID_SOCKET;
+    }
+
+    next = 0;
+    num_probes = 0;
+    for (;;) {
+        left = budget_ms - _zdtm_elapsed_ms(p_start);
+        if (left <= 0) {
+            break;
+        }
+
+        /* Top up the probes in flight. */
+        while ((num_probes < max_probes) && (next < num)) {
+            r = _zdtm_start_probe(first + next, &pfds[num_probes].fd);
+            if (r == 0) {
+                p_conns[next] = pfds[num_probes].fd;
+            } else if (r == 1) {
+                pfds[num_probes].events = POLLOUT;
+                pfds[num_probes].revents = 0;
+                hosts[num_probes] = next;
+                num_probes++;
+            }
+            next++;
+        }
+
+        if (num_probes == 0) {
+            break;
+        }
+
+        r = poll(pfds, num_probes, (int)left);
+        if (r < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        /* Retire the probes which are done, moving the last probe in
+         * flight into the slot of each. */
+        i = 0;
+        while (i < num_probes) {
+            if (pfds[i].revents == 0) {
+                i++;
+                continue;
+            }
+
+            err = 0;
+            len = (socklen_t)sizeof(err);
+#ifdef WIN32
+            r = getsockopt(pfds[i].fd, SOL_SOCKET, SO_ERROR, (char *)&err,
+                &len);
+#else
+            r = getsockopt(pfds[i].fd, SOL_SOCKET, SO_ERROR, &err, &len);
+#endif
+            if ((r == 0) && (err == 0)) {
+                p_conns[hosts[i]] = pfds[i].fd;
+            } else {
+                _zdtm_close_probe(pfds[i].fd);
+            }
+
+            num_probes--;
+            pfds[i] = pfds[num_probes];
+            hosts[i] = hosts[num_probes];
+        }
+    }
+
+    /* The budget is spent, the probes left never got an answer. */
+    for (i = 0; i < num_probes; i++) {
+        _zdtm_close_probe(pfds[i].fd);
+    }
+
+    free(pfds);
+    free(hosts);
+
+    return 0;
+}
+
+/**
+ * Identify device.
+ *
+ * The _zdtm_identify_device function obtains the device info of a
+ * discovered device over the probe made to it, within the given time.
+ * The probe is closed either way.
+ * @param p_dev Pointer to the device to identify.
+ * @param listenfd The listener the device is to connect back to.
+ * @param conn The probe made to the device.
+ * @param left_ms Milliseconds left to identify the device in.
+ */
+static void _zdtm_identify_device(struct zdtm_discovered *p_dev,
+    SOCKET listenfd, SOCKET conn, int left_ms) {
+
+    zdtm_lib_env cur_env;
+
+    memset(&cur_env, 0, sizeof(zdtm_lib_env));
+    if (zdtm_initialize_listener(&cur_env, NULL, listenfd) != 0) {
+        _zdtm_close_probe(conn);
+        return;
+    }
+    zdtm_set_log_none(&cur_env);
+    zdtm_set_zaurus_ip(&cur_env, p_dev->zaurus_ip);
+
+    /* The probe is left non-blocking, which the environment expects of
+     * its connections once it has an I/O deadline. */
+    zdtm_set_timeouts(&cur_env, left_ms, left_ms, left_ms);
+    cur_env.reqfd = conn;
+
+    if (_zdtm_identify(&cur_env) == 0) {
+        memcpy(p_dev->model, cur_env.model, sizeof(p_dev->model));
+        p_dev->model[sizeof(p_dev->model) - 1] = '\0';
+        memcpy(p_dev->language, cur_env.language, 2);
+        p_dev->language[2] = '\0';
+        p_dev->identified = 1;
+    }
+
+    _zdtm_disconnect(&cur_env);
+    zdtm_finalize(&cur_env);
+}
+
+int zdtm_discover(const char *cidr, int budget_ms, unsigned int max_probes,
+    int identify, struct zdtm_discovered **pp_found,
+    unsigned int *p_num_found) {
+
+    struct zdtm_discovered *p_found;
+    struct timespec start;
+    zdtm_transport *p_tp;
+    SOCKET *p_conns;
+    SOCKET listenfd;
+    uint32_t first, num, i, addr;
+    unsigned int num_found, num_answered;
+    long left;
+
+    (*pp_found) = NULL;
+    (*p_num_found) = 0;
+
+    if ((cidr == NULL) || (_zdtm_parse_cidr(cidr, &first, &num) != 0)) {
+        return -1;
+    }
+
+    if (max_probes == 0) {
+        max_probes = ZDTM_DISCOVER_PROBES;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    /* Listen before probing, a device being identified connects back
+     * as soon as it is asked to. */
+    listenfd = INVALID_SOCKET;
+    p_tp = zdtm_tcp_transport();
+    if (identify && (p_tp->listen(p_tp, NULL, DLISTPORT, &listenfd) != 0)) {
+        return -3;
+    }
+
+    p_conns = (SOCKET *)malloc(sizeof(SOCKET) * num);
+    if (p_conns == NULL) {
+        if (listenfd != INVALID_SOCKET) { p_tp->close(p_tp, listenfd); }
+        return -2;
+    }
+
+    if (_zdtm_probe_range(first, num, &start, budget_ms, max_probes,
+        p_conns) != 0) {
+        free(p_conns);
+        if (listenfd != INVALID_SOCKET) { p_tp->close(p_tp, listenfd); }
+        return -2;
+    }
+
+    num_found = 0;
+    for (i = 0; i < num; i++) {
+        if (p_conns[i] != INVALID_SOCKET) {
+            num_found++;
+        }
+    }
+
+    p_found = NULL;
+    if (num_found > 0) {
+        p_found = (struct zdtm_discovered *)calloc(num_found,
+            sizeof(struct zdtm_discovered));
+        if (p_found == NULL) {
+            for (i = 0; i < num; i++) {
+                if (p_conns[i] != INVALID_SOCKET) {
+                    _zdtm_close_probe(p_conns[i]);
+                }
+            }
+            free(p_conns);
+            if (listenfd != INVALID_SOCKET) { p_tp->close(p_tp, listenfd); }
+            return -2;
+        }
+    }
+
+    num_answered = num_found;
+    num_found = 0;
+    for (i = 0; i < num; i++) {
+        if (p_conns[i] == INVALID_SOCKET) {
+            continue;
+        }
+
+        addr = first + i;
+        snprintf(p_found[num_found].zaurus_ip, IP_STR_SIZE, "%u.%u.%u.%u",
+            (unsigned int)(addr >> 24), (unsigned int)((addr >> 16) & 0xff),
+            (unsigned int)((addr >> 8) & 0xff), (unsigned int)(addr & 0xff));
+
+        /* Each device gets an equal share of what is left of the budget,
+         * so that one which never connects back does not starve those
+         * after it, and what it does not use goes to the following. */
+        left = budget_ms - _zdtm_elapsed_ms(&start);
+        if (identify && (left > 0)) {
+            _zdtm_identify_device(&p_found[num_found], listenfd, p_conns[i],
+                (int)(left / (num_answered - num_found)));
+        } else {
+            _zdtm_close_probe(p_conns[i]);
+        }
+        num_found++;
+    }
+
+    free(p_conns);
+    if (listenfd != INVALID_SOCKET) { p_tp->close(p_tp, listenfd); }
+
+    (*pp_found) = p_found;
+    (*p_num_found) = num_found;
+
+    return 0;
+}
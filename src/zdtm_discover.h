@@ -0,0 +1,96 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+
+/**
+ * @file zdtm_discover.h
+ * @brief This is a specifications file for device discovery.
+ *
+ * The zdtm_discover.h file is a specifications file for discovering
+ * the Zaurus devices of a network. Every address of a range is probed
+ * for the Zaurus synchronization daemon listening on ZLISTPORT, with
+ * many connections in flight at once, and the devices which answer
+ * may be asked for their device info.
+ */
+
+#ifndef ZDTM_DISCOVER_H
+#define ZDTM_DISCOVER_H
+
+#include "zdtm_export.h"
+#include "zdtm_types.h"
+
+// Largest range of addresses probed, that of a /16 network.
+#define ZDTM_DISCOVER_MAX_HOSTS 65536
+
+// Connections in flight at once when none is given.
+#define ZDTM_DISCOVER_PROBES 256
+
+/**
+ * Discovered device.
+ *
+ * The zdtm_discovered structure describes a device found listening on
+ * ZLISTPORT by zdtm_discover(). The model and language are only filled
+ * in if the device was identified.
+ */
+struct zdtm_discovered {
+    char zaurus_ip[IP_STR_SIZE];    // Zaurus IP address
+    int identified;     // flag stating the device info was obtained
+    char model[256];    // c-string of the devices model
+    char language[3];   // c-string of the language of the device
+};
+
+/**
+ * Discover devices.
+ *
+ * The zdtm_discover function probes every host address of the given
+ * range for a listener on ZLISTPORT, keeping up to max_probes
+ * non-blocking connections in flight at once, and gives up on the
+ * probes still in flight once budget_ms milliseconds have passed. If
+ * identify is non-zero each device found is then asked for its device
+ * info, one after the other as they all connect back to DLISTPORT,
+ * for as long as the budget lasts. Each device is given an equal share
+ * of the time left when its turn comes, so that a device which never
+ * connects back only holds up the others for its share. Identifying
+ * needs DLISTPORT to be free, i.e. no synchronization may be running
+ * over TCP/IP meanwhile.
+ *
+ * The range is given in CIDR notation, e.g. "192.168.129.0/24", of at
+ * most ZDTM_DISCOVER_MAX_HOSTS addresses. The network and broadcast
+ * addresses of ranges larger than two addresses are not probed. The
+ * devices found are stored in order of address in an array allocated
+ * by the function, which the caller is to free().
+ * @param cidr The range of addresses to probe.
+ * @param budget_ms Milliseconds the discovery may take.
+ * @param max_probes Max number of probes at once (0 = ZDTM_DISCOVER_PROBES).
+ * @param identify Non-zero to obtain the device info of each device.
+ * @param pp_found Pointer to a pointer to store the devices found in.
+ * @param p_num_found Pointer to store the number of devices found in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully probed the range.
+ * @retval -1 Failed, the range is invalid or too large.
+ * @retval -2 Failed to allocate memory.
+ * @retval -3 Failed to listen for the devices to identify.
+ */
+ZDTM_EXPORT int zdtm_discover(const char *cidr, int budget_ms,
+    unsigned int max_probes, int identify, struct zdtm_discovered **pp_found,
+    unsigned int *p_num_found);
+
+#endif
@@ -0,0 +1,654 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+/**
+ * @file zdtm_dtm.c
+ * @brief This is an implementation file for DTM file handling.
+ *
+ * The zdtm_dtm.c file is an implementation of obtaining the DTM index
+ * files and DTM box files from the Zaurus and decoding the records of
+ * the DTM box files locally.
+ */
+
+#include "zdtm_dtm.h"
+#include "zdtm_proto.h"
+#include "zdtm_mirror.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_SYS_STAT_H) && \
+    defined(HAVE_FCNTL_H) && defined(HAVE_UNISTD_H)
+#define ZDTM_DTM_USE_MMAP 1
+#endif
+
+/**
+ * DTM database.
+ *
+ * The zdtm_dtm_database is a structure which represents an opened DTM
+ * box file and its optional DTM index file. The files are memory mapped
+ * where supported and otherwise read into dynamically allocated memory.
+ * The params array is shared by all the record views and only ever
+ * grows, hence iterating the records does not allocate per record.
+ */
+struct zdtm_dtm_database {
+    unsigned char *box;                 // contents of the box file
+    uint32_t box_size;                  // size of the box file
+    unsigned char *idx;                 // contents of the index file
+    uint32_t idx_size;                  // size of the index file
+    uint32_t num_entries;               // number of index entries
+    int idx_sorted;                     // flag, index sorted by sync id
+    struct zdtm_adr_msg_param *params;  // params of the current record
+    uint16_t max_params;                // number of entries in params
+};
+
+const char *zdtm_dtm_path(unsigned char sync_type, int which) {
+    switch (sync_type) {
+        case SYNC_TYPE_TODO:
+            return (which == ZDTM_DTM_BOX) ? ZDTM_DTM_DIR "SLTODO.BOX" :
+                ((which == ZDTM_DTM_IDX) ? ZDTM_DTM_DIR "SLTODO.IDX" : NULL);
+        case SYNC_TYPE_CALENDAR:
+            return (which == ZDTM_DTM_BOX) ? ZDTM_DTM_DIR "SLDATE.BOX" :
+                ((which == ZDTM_DTM_IDX) ? ZDTM_DTM_DIR "SLDATE.IDX" : NULL);
+        case SYNC_TYPE_ADDRESS:
+            return (which == ZDTM_DTM_BOX) ? ZDTM_DTM_DIR "SLADRS.BOX" :
+                ((which == ZDTM_DTM_IDX) ? ZDTM_DTM_DIR "SLADRS.IDX" : NULL);
+        default:
+            return NULL;
+    }
+}
+
+int zdtm_obtain_dtm_file(zdtm_lib_env *cur_env, int which,
+    const char *local_path, unsigned char **pp_buf, uint32_t *p_size) {
+
+    int r;
+    const char *path;
+    FILE *fp;
+
+    path = zdtm_dtm_path(cur_env->sync_type, which);
+    if (path == NULL) {
+        return -1;
+    }
+
+    fp = NULL;
+    if (local_path != NULL) {
+        fp = fopen(local_path, "wb");
+        if (fp == NULL) {
+            return -2;
+        }
+    }
+
+    r = _zdtm_obtain_file(cur_env, path, fp, pp_buf, p_size);
+    if (r != 0) {
+        if (fp != NULL) { fclose(fp); }
+        return _zdtm_timeout_result(cur_env, -3);
+    }
+
+    if (fp != NULL) {
+        if (fclose(fp) != 0) {
+            return -4;
+        }
+    }
+
+    return 0;
+}
+
+int _zdtm_dtm_parse_record(const unsigned char *buf, uint32_t size,
+    struct zdtm_adr_msg_param *params, uint16_t max_params,
+    uint16_t *p_num_params, uint32_t *p_rec_size) {
+
+    uint32_t rec_len, pos, param_len;
+    uint16_t num_params;
+    int i;
+
+    if (size < (sizeof(uint32_t) + sizeof(uint16_t))) {
+        return -1;
+    }
+
+    rec_len = zdtm_get_le32(buf);
+    num_params = zdtm_get_le16(buf + sizeof(uint32_t));
+
+    if ((rec_len < sizeof(uint16_t)) ||
+        (rec_len > (size - sizeof(uint32_t))) || (num_params > max_params)) {
+        return -1;
+    }
+
+    /* rec_len covers everything following the record length, hence
+     * every parameter has to lie within it. */
+    pos = sizeof(uint16_t);
+    for (i = 0; i < num_params; i++) {
+        if ((rec_len - pos) < sizeof(uint32_t)) {
+            return -1;
+        }
+        param_len = zdtm_get_le32(buf + sizeof(uint32_t) + pos);
+        pos += sizeof(uint32_t);
+        if (param_len > (rec_len - pos)) {
+            return -1;
+        }
+        params[i].param_len = param_len;
+        params[i].param_data = (unsigned char *)buf + sizeof(uint32_t) + pos;
+        pos += param_len;
+    }
+
+    (*p_num_params) = num_params;
+    (*p_rec_size) = sizeof(uint32_t) + rec_len;
+
+    return 0;
+}
+
+int zdtm_dtm_decode_box(zdtm_lib_env *cur_env, const unsigned char *buf,
+    uint32_t size, zdtm_item_handler handler, void *arg) {
+
+    int r;
+    uint32_t pos, rec_size;
+    uint16_t num_params;
+    struct zdtm_adr_msg_param *params;
+    struct zdtm_item item;
+
+    if ((cur_env->sync_type != SYNC_TYPE_TODO) &&
+        (cur_env->sync_type != SYNC_TYPE_CALENDAR) &&
+        (cur_env->sync_type != SYNC_TYPE_ADDRESS)) {
+        return -1;
+    }
+
+    /* The params array is reused for every record as the parameters
+     * only ever point into buf. */
+    params = malloc(sizeof(struct zdtm_adr_msg_param) *
+        (cur_env->num_params + 1));
+    if (params == NULL) {
+        return -4;
+    }
+
+    for (pos = 0; pos < size; pos += rec_size) {
+        r = _zdtm_dtm_parse_record(buf + pos, size - pos, params,
+            cur_env->num_params, &num_params, &rec_size);
+        if (r != 0) {
+            free(params);
+            return -2;
+        }
+
+        memset(&item, 0, sizeof(struct zdtm_item));
+        item.list = ZDTM_ITEM_NEW;
+        item.sync_type = cur_env->sync_type;
+
+        if (cur_env->sync_type == SYNC_TYPE_TODO) {
+            r = _zdtm_parse_todo_item_params(cur_env->params,
+                cur_env->num_params, params, num_params, &item.cont.todo);
+            item.sync_id = item.cont.todo.sync_id;
+        } else if (cur_env->sync_type == SYNC_TYPE_CALENDAR) {
+            r = _zdtm_parse_calendar_item_params(cur_env->params,
+                cur_env->num_params, params, num_params, &item.cont.calendar);
+            item.sync_id = item.cont.calendar.sync_id;
+        } else {
+            r = _zdtm_parse_address_item_params(cur_env->params,
+                cur_env->num_params, params, num_params, &item.cont.address);
+            item.sync_id = item.cont.address.sync_id;
+        }
+        if (r != 0) {
+            zdtm_clean_item(&item);
+            free(params);
+            return -3;
+        }
+
+        if (cur_env->mirror != NULL) {
+            if (zdtm_mirror_put(cur_env->mirror, cur_env->sync_type,
+                item.sync_id, params, num_params) != 0) {
+                zdtm_clean_item(&item);
+                free(params);
+                return -5;
+            }
+        }
+
+        if (_zdtm_share_item_category(cur_env, &item) != 0) {
+            zdtm_clean_item(&item);
+            free(params);
+            return -6;
+        }
+
+        if (handler(&item, arg) != 0) {
+            free(params);
+            return 1;
+        }
+    }
+
+    free(params);
+
+    return 0;
+}
+
+/**
+ * Map a file.
+ *
+ * The _zdtm_dtm_map_file function maps the file at path read only into
+ * memory, or reads it into dynamically allocated memory where memory
+ * mapping is not supported. An empty file results in a NULL buffer.
+ * @param path The path of the file to map.
+ * @param pp_buf Pointer to the pointer to store addr of the contents in.
+ * @param p_size Pointer to variable to store the size of the file in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully mapped the file.
+ * @retval -1 Failed to open or map the file.
+ */
+static int _zdtm_dtm_map_file(const char *path, unsigned char **pp_buf,
+    uint32_t *p_size) {
+
+#ifdef ZDTM_DTM_USE_MMAP
+    int fd;
+    struct stat st;
+    void *p;
+
+    fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        return -1;
+    }
+
+    if ((fstat(fd, &st) != 0) || (st.st_size > 0xffffffffLL)) {
+        close(fd);
+        return -1;
+    }
+
+    (*pp_buf) = NULL;
+    (*p_size) = (uint32_t)st.st_size;
+    if (st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+
+    p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        return -1;
+    }
+#ifdef MADV_SEQUENTIAL
+    madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+
+    (*pp_buf) = (unsigned char *)p;
+
+    return 0;
+#else
+    FILE *fp;
+    long size;
+
+    fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return -1;
+    }
+
+    if ((fseek(fp, 0, SEEK_END) != 0) || ((size = ftell(fp)) < 0) ||
+        (fseek(fp, 0, SEEK_SET) != 0)) {
+        fclose(fp);
+        return -1;
+    }
+
+    (*pp_buf) = NULL;
+    (*p_size) = (uint32_t)size;
+    if (size == 0) {
+        fclose(fp);
+        return 0;
+    }
+
+    (*pp_buf) = malloc(size);
+    if ((*pp_buf) == NULL) {
+        fclose(fp);
+        return -1;
+    }
+
+    if (fread((*pp_buf), 1, size, fp) != (size_t)size) {
+        free((*pp_buf));
+        (*pp_buf) = NULL;
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+
+    return 0;
+#endif
+}
+
+/**
+ * Unmap a file.
+ *
+ * The _zdtm_dtm_unmap_file function releases the contents of a file
+ * previously mapped using the _zdtm_dtm_map_file() function.
+ * @param buf Pointer to the contents of the file.
+ * @param size The size of the file.
+ */
+static void _zdtm_dtm_unmap_file(unsigned char *buf, uint32_t size) {
+    if (buf == NULL) {
+        return;
+    }
+#ifdef ZDTM_DTM_USE_MMAP
+    munmap(buf, size);
+#else
+    free(buf);
+#endif
+}
+
+/**
+ * Read a DTM index entry.
+ *
+ * The _zdtm_dtm_idx_entry function reads the sync id and box file offset
+ * of the given entry of the DTM index file of a DTM database.
+ * @param p_db Pointer to the DTM database.
+ * @param i The number of the entry.
+ * @param p_sync_id Pointer to variable to store the sync id in.
+ * @param p_offset Pointer to variable to store the offset in.
+ */
+static void _zdtm_dtm_idx_entry(zdtm_dtm_db *p_db, uint32_t i,
+    uint32_t *p_sync_id, uint32_t *p_offset) {
+
+    const unsigned char *p;
+
+    p = p_db->idx + sizeof(uint32_t) + (i * 2 * sizeof(uint32_t));
+    (*p_sync_id) = zdtm_get_le32(p);
+    if (p_offset != NULL) {
+        (*p_offset) = zdtm_get_le32(p + sizeof(uint32_t));
+    }
+}
+
+int zdtm_dtm_open(const char *box_path, const char *idx_path,
+    zdtm_dtm_db **pp_db) {
+
+    zdtm_dtm_db *p_db;
+    uint32_t i, cur_id, prev_id;
+
+    p_db = malloc(sizeof(zdtm_dtm_db));
+    if (p_db == NULL) {
+        return -1;
+    }
+    memset(p_db, 0, sizeof(zdtm_dtm_db));
+
+    if (_zdtm_dtm_map_file(box_path, &p_db->box, &p_db->box_size) != 0) {
+        free(p_db);
+        return -2;
+    }
+
+    if (idx_path != NULL) {
+        if (_zdtm_dtm_map_file(idx_path, &p_db->idx, &p_db->idx_size) != 0) {
+            zdtm_dtm_close(p_db);
+            return -3;
+        }
+
+        if (p_db->idx_size < sizeof(uint32_t)) {
+            zdtm_dtm_close(p_db);
+            return -4;
+        }
+        p_db->num_entries = zdtm_get_le32(p_db->idx);
+        if (p_db->num_entries >
+            ((p_db->idx_size - sizeof(uint32_t)) / (2 * sizeof(uint32_t)))) {
+            zdtm_dtm_close(p_db);
+            return -4;
+        }
+
+        /* Check once up front if lookups can use a binary search. */
+        p_db->idx_sorted = 1;
+        prev_id = 0;
+        for (i = 0; i < p_db->num_entries; i++) {
+            _zdtm_dtm_idx_entry(p_db, i, &cur_id, NULL);
+            if ((i > 0) && (cur_id <= prev_id)) {
+                p_db->idx_sorted = 0;
+                break;
+            }
+            prev_id = cur_id;
+        }
+    }
+
+    (*pp_db) = p_db;
+
+    return 0;
+}
+
+int zdtm_dtm_close(zdtm_dtm_db *p_db) {
+    if (p_db == NULL) {
+        return -1;
+    }
+
+    _zdtm_dtm_unmap_file(p_db->box, p_db->box_size);
+    _zdtm_dtm_unmap_file(p_db->idx, p_db->idx_size);
+    if (p_db->params != NULL) {
+        free(p_db->params);
+    }
+    free(p_db);
+
+    return 0;
+}
+
+/**
+ * Obtain DTM box record at offset.
+ *
+ * The _zdtm_dtm_record_at function obtains a view of the record at the
+ * given offset of the DTM box file of a DTM database, growing the shared
+ * params array of the database if the record has more params than it
+ * can hold.
+ * @param p_db Pointer to the DTM database.
+ * @param offset The offset of the record in the box file.
+ * @param p_rec Pointer to zdtm_dtm_record struct to store the view in.
+ * @param p_rec_size Pointer to variable to store the record size in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully obtained the record.
+ * @retval -1 Failed, the record is malformed.
+ * @retval -2 Failed to allocate memory for the record parameters.
+ */
+static int _zdtm_dtm_record_at(zdtm_dtm_db *p_db, uint32_t offset,
+    struct zdtm_dtm_record *p_rec, uint32_t *p_rec_size) {
+
+    uint16_t num_params;
+    struct zdtm_adr_msg_param *params;
+
+    if ((offset >= p_db->box_size) ||
+        ((p_db->box_size - offset) < (sizeof(uint32_t) + sizeof(uint16_t)))) {
+        return -1;
+    }
+
+    num_params = zdtm_get_le16(p_db->box + offset + sizeof(uint32_t));
+
+    if (num_params > p_db->max_params) {
+        params = realloc(p_db->params,
+            sizeof(struct zdtm_adr_msg_param) * num_params);
+        if (params == NULL) {
+            return -2;
+        }
+        p_db->params = params;
+        p_db->max_params = num_params;
+    }
+
+    if (_zdtm_dtm_parse_record(p_db->box + offset, p_db->box_size - offset,
+        p_db->params, p_db->max_params, &p_rec->num_params,
+        p_rec_size) != 0) {
+        return -1;
+    }
+
+    p_rec->offset = offset;
+    p_rec->params = p_db->params;
+
+    return 0;
+}
+
+int zdtm_dtm_next_record(zdtm_dtm_db *p_db, uint32_t *p_cursor,
+    struct zdtm_dtm_record *p_rec) {
+
+    int r;
+    uint32_t rec_size;
+
+    if ((*p_cursor) >= p_db->box_size) {
+        return 1;
+    }
+
+    r = _zdtm_dtm_record_at(p_db, (*p_cursor), p_rec, &rec_size);
+    if (r != 0) {
+        return r;
+    }
+
+    (*p_cursor) += rec_size;
+
+    return 0;
+}
+
+int zdtm_dtm_find_record(zdtm_dtm_db *p_db, uint32_t sync_id,
+    struct zdtm_dtm_record *p_rec) {
+
+    uint32_t lo, hi, mid, cur_id, offset, rec_size;
+    int found;
+
+    if (p_db->idx == NULL) {
+        return -1;
+    }
+
+    found = 0;
+    offset = 0;
+    if (p_db->idx_sorted) {
+        lo = 0;
+        hi = p_db->num_entries;
+        while (lo < hi) {
+            mid = lo + ((hi - lo) / 2);
+            _zdtm_dtm_idx_entry(p_db, mid, &cur_id, &offset);
+            if (cur_id == sync_id) {
+                found = 1;
+                break;
+            } else if (cur_id < sync_id) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+    } else {
+        for (mid = 0; mid < p_db->num_entries; mid++) {
+            _zdtm_dtm_idx_entry(p_db, mid, &cur_id, &offset);
+            if (cur_id == sync_id) {
+                found = 1;
+                break;
+            }
+        }
+    }
+
+    if (!found) {
+        return 1;
+    }
+
+    if (_zdtm_dtm_record_at(p_db, offset, p_rec, &rec_size) != 0) {
+        return -2;
+    }
+
+    return 0;
+}
+
+int zdtm_dtm_record_field(struct zdtm_adi_msg_param *p_format,
+    uint16_t num_format, struct zdtm_dtm_record *p_rec, const char *abrev,
+    const unsigned char **pp_data, uint32_t *p_len) {
+
+    uint16_t i;
+
+    /* Never compare past the end of a shorter string. */
+    if (memchr(abrev, '\0', 4) != NULL) {
+        return 1;
+    }
+
+    for (i = 0; (i < num_format) && (i < p_rec->num_params); i++) {
+        if (memcmp(p_format[i].abrev, abrev, 4) == 0) {
+            (*pp_data) = p_rec->params[i].param_data;
+            (*p_len) = p_rec->params[i].param_len;
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+int zdtm_dtm_record_item(struct zdtm_adi_msg_param *p_format,
+    uint16_t num_format, unsigned char sync_type,
+    struct zdtm_dtm_record *p_rec, struct zdtm_item *p_item) {
+
+    int r;
+
+    memset(p_item, 0, sizeof(struct zdtm_item));
+    p_item->list = ZDTM_ITEM_NEW;
+    p_item->sync_type = sync_type;
+
+    if (sync_type == SYNC_TYPE_TODO) {
+        r = _zdtm_map_todo_item_params(p_format, num_format, p_rec->params,
+            p_rec->num_params, &p_item->cont.todo, 0);
+        p_item->sync_id = p_item->cont.todo.sync_id;
+    } else if (sync_type == SYNC_TYPE_CALENDAR) {
+        r = _zdtm_map_calendar_item_params(p_format, num_format,
+            p_rec->params, p_rec->num_params, &p_item->cont.calendar, 0);
+        p_item->sync_id = p_item->cont.calendar.sync_id;
+    } else if (sync_type == SYNC_TYPE_ADDRESS) {
+        r = _zdtm_map_address_item_params(p_format, num_format,
+            p_rec->params, p_rec->num_params, &p_item->cont.address, 0);
+        p_item->sync_id = p_item->cont.address.sync_id;
+    } else {
+        return -1;
+    }
+
+    if (r != 0) {
+        return -2;
+    }
+
+    return 0;
+}
+
+int zdtm_bulk_obtain_items(zdtm_lib_env *cur_env, const char *save_path,
+    zdtm_item_handler handler, void *arg) {
+
+    int r;
+    unsigned char *p_buf;
+    uint32_t size;
+    zdtm_dtm_db *p_db;
+
+    p_buf = NULL;
+    r = zdtm_obtain_dtm_file(cur_env, ZDTM_DTM_BOX, save_path, &p_buf, &size);
+    if (r != 0) {
+        return _zdtm_timeout_result(cur_env, -1);
+    }
+
+    if (save_path != NULL) {
+        /* Map the box file back in rather than reading it into memory. */
+        if (zdtm_dtm_open(save_path, NULL, &p_db) != 0) {
+            return -2;
+        }
+        r = zdtm_dtm_decode_box(cur_env, p_db->box, p_db->box_size, handler,
+            arg);
+        zdtm_dtm_close(p_db);
+    } else {
+        r = zdtm_dtm_decode_box(cur_env, p_buf, size, handler, arg);
+        free(p_buf);
+    }
+    if (r < 0) {
+        return -3;
+    }
+
+    return r;
+}
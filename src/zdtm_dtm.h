@@ -0,0 +1,311 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+/**
+ * @file zdtm_dtm.h
+ * @brief This is a specifications file for DTM file handling.
+ *
+ * The zdtm_dtm.h file is a specifications file for obtaining and
+ * decoding the DTM index files and DTM box files in which the Zaurus
+ * stores the items of each synchronization type. Obtaining the box file
+ * in bulk and decoding its records locally is a much faster alternative
+ * to obtaining each item with its own RDR message during a slow sync.
+ *
+ * A DTM box file is a sequence of records, each made up of a 32 bit
+ * record length followed by the parameters of an item laid out the same
+ * way as in the content of an ADR message, a 16 bit parameter count
+ * followed by a 32 bit length and the data of each parameter, in the
+ * order given by the parameter format of the ADI message. A DTM index
+ * file is a 32 bit entry count followed by a 32 bit sync id and a 32
+ * bit box file offset for each record. All values are little endian.
+ */
+
+#ifndef ZDTM_DTM_H
+#define ZDTM_DTM_H
+
+#include "zdtm_export.h"
+#include "zdtm_types.h"
+#include "zdtm_iter.h"
+#include "zdtm_adr_msg.h"
+
+// Identifiers of the DTM files of a synchronization type.
+#define ZDTM_DTM_BOX 0
+#define ZDTM_DTM_IDX 1
+
+// Directory in which the Zaurus keeps its DTM files.
+#define ZDTM_DTM_DIR "/home/zaurus/Applications/dtm/"
+
+/**
+ * Item handler.
+ *
+ * The zdtm_item_handler is a type defined to represent a function which
+ * is handed each item decoded from a DTM box file. The handler owns the
+ * dynamically allocated members of the item and is responsible for
+ * freeing them with zdtm_clean_item(). The category of the item is
+ * shared, see zdtm_item_iter_next(). Returning non-zero from the
+ * handler stops the decoding.
+ */
+typedef int (*zdtm_item_handler)(struct zdtm_item *p_item, void *arg);
+
+/**
+ * Obtain DTM file path.
+ *
+ * The zdtm_dtm_path function obtains the path on the Zaurus of the
+ * given DTM file of the given synchronization type.
+ * @param sync_type The synchronization type (SYNC_TYPE_*).
+ * @param which The DTM file (ZDTM_DTM_BOX or ZDTM_DTM_IDX).
+ * @return Pointer to the path, or NULL if either argument is unknown.
+ */
+ZDTM_EXPORT const char *zdtm_dtm_path(unsigned char sync_type, int which);
+
+/**
+ * Obtain DTM file.
+ *
+ * The zdtm_obtain_dtm_file function obtains the given DTM file of the
+ * current synchronization type from the Zaurus. If local_path is not
+ * NULL the file is streamed to disk at local_path as it is received and
+ * pp_buf is left untouched. Otherwise the file is obtained in a
+ * dynamically allocated buffer whose address is stored in the pointer
+ * passed by address as pp_buf, which must be freed using free().
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param which The DTM file (ZDTM_DTM_BOX or ZDTM_DTM_IDX).
+ * @param local_path Path to save the file at, NULL to obtain a buffer.
+ * @param pp_buf Pointer to the pointer to store addr of the buffer in.
+ * @param p_size Pointer to variable to store the size of the file in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully obtained the DTM file.
+ * @retval -1 Failed, the current sync type is not a recognized type.
+ * @retval -2 Failed to open local_path for writing.
+ * @retval -3 Failed to obtain the file from the Zaurus.
+ * @retval -4 Failed to finish writing the file at local_path.
+ */
+ZDTM_EXPORT int zdtm_obtain_dtm_file(zdtm_lib_env *cur_env, int which,
+    const char *local_path, unsigned char **pp_buf, uint32_t *p_size);
+
+/**
+ * Parse a DTM box record.
+ *
+ * The _zdtm_dtm_parse_record function parses the parameters of the DTM
+ * box record at the start of buf into the params array without copying
+ * any of the parameter data, the param_data members point into buf.
+ * @param buf Pointer to the start of the record.
+ * @param size The number of bytes available at buf.
+ * @param params Array to store the parameters of the record in.
+ * @param max_params The number of entries in the params array.
+ * @param p_num_params Pointer to variable to store num of params in.
+ * @param p_rec_size Pointer to variable to store the record size in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully parsed the record.
+ * @retval -1 Failed, the record is malformed.
+ */
+int _zdtm_dtm_parse_record(const unsigned char *buf, uint32_t size,
+    struct zdtm_adr_msg_param *params, uint16_t max_params,
+    uint16_t *p_num_params, uint32_t *p_rec_size);
+
+/**
+ * Decode DTM box.
+ *
+ * The zdtm_dtm_decode_box function decodes each record of the DTM box
+ * file contents in buf into an item of the current synchronization
+ * type, using the parameter format of the current library environment,
+ * and hands it to handler. The items are reported as coming from the
+ * new list. If a mirror store is attached the items are stored in it.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param buf Pointer to the DTM box file contents.
+ * @param size The size of the DTM box file contents in bytes.
+ * @param handler The function to hand each decoded item to.
+ * @param arg Argument passed through to handler.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully decoded all the records.
+ * @retval 1 Stopped, handler returned non-zero.
+ * @retval -1 Failed, the current sync type is not a recognized type.
+ * @retval -2 Failed, a record is malformed.
+ * @retval -3 Failed to build the item struct from a record.
+ * @retval -4 Failed to allocate memory for the record parameters.
+ * @retval -5 Failed to store an item in the mirror store.
+ * @retval -6 Failed to intern the category of an item.
+ */
+ZDTM_EXPORT int zdtm_dtm_decode_box(zdtm_lib_env *cur_env,
+    const unsigned char *buf, uint32_t size, zdtm_item_handler handler,
+    void *arg);
+
+/**
+ * DTM database.
+ *
+ * The zdtm_dtm_db is a type defined to represent a DTM box file, and
+ * optionally its DTM index file, opened for reading with
+ * zdtm_dtm_open(). The files are memory mapped where supported.
+ */
+typedef struct zdtm_dtm_database zdtm_dtm_db;
+
+/**
+ * DTM box record.
+ *
+ * The zdtm_dtm_record is a structure which represents a view of a
+ * record of a DTM box file. The params point directly into the DTM
+ * database, the record is only valid until the next record is obtained
+ * from the same database or the database is closed.
+ */
+struct zdtm_dtm_record {
+    uint32_t offset;                    // offset of the record in the box
+    uint16_t num_params;                // number of params in the record
+    struct zdtm_adr_msg_param *params;  // params of the record
+};
+
+/**
+ * Open DTM database.
+ *
+ * The zdtm_dtm_open function opens a DTM box file, and optionally its
+ * DTM index file, such as those saved by zdtm_obtain_dtm_file() or
+ * pulled off a device backup, for zero-copy reading of its records.
+ * @param box_path The path of the DTM box file.
+ * @param idx_path The path of the DTM index file, or NULL.
+ * @param pp_db Pointer to a pointer to store the new database in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully opened the DTM database.
+ * @retval -1 Failed to allocate memory for the database.
+ * @retval -2 Failed to open or map the DTM box file.
+ * @retval -3 Failed to open or map the DTM index file.
+ * @retval -4 Failed, the DTM index file is malformed.
+ */
+ZDTM_EXPORT int zdtm_dtm_open(const char *box_path, const char *idx_path,
+    zdtm_dtm_db **pp_db);
+
+/**
+ * Close DTM database.
+ *
+ * The zdtm_dtm_close function unmaps the files of a DTM database and
+ * frees it. All the records and items obtained from it become invalid.
+ * @param p_db Pointer to the DTM database.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully closed the DTM database.
+ * @retval -1 Failed, p_db is NULL.
+ */
+ZDTM_EXPORT int zdtm_dtm_close(zdtm_dtm_db *p_db);
+
+/**
+ * Obtain next DTM box record.
+ *
+ * The zdtm_dtm_next_record function obtains a view of the record at the
+ * offset p_cursor points to and advances it to the following record.
+ * The cursor is to be set to zero to start at the first record. No
+ * memory is allocated per record.
+ * @param p_db Pointer to the DTM database.
+ * @param p_cursor Pointer to the offset of the record to obtain.
+ * @param p_rec Pointer to zdtm_dtm_record struct to store the view in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully obtained the record.
+ * @retval 1 There are no more records.
+ * @retval -1 Failed, the record is malformed.
+ * @retval -2 Failed to allocate memory for the record parameters.
+ */
+ZDTM_EXPORT int zdtm_dtm_next_record(zdtm_dtm_db *p_db, uint32_t *p_cursor,
+    struct zdtm_dtm_record *p_rec);
+
+/**
+ * Find DTM box record.
+ *
+ * The zdtm_dtm_find_record function looks the record with the given
+ * sync id up in the DTM index file and obtains a view of it. The lookup
+ * is a binary search when the index is sorted by sync id.
+ * @param p_db Pointer to the DTM database.
+ * @param sync_id The sync id of the record to find.
+ * @param p_rec Pointer to zdtm_dtm_record struct to store the view in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully found the record.
+ * @retval 1 There is no record with the given sync id.
+ * @retval -1 Failed, the database was opened without an index file.
+ * @retval -2 Failed, the record is malformed.
+ */
+ZDTM_EXPORT int zdtm_dtm_find_record(zdtm_dtm_db *p_db, uint32_t sync_id,
+    struct zdtm_dtm_record *p_rec);
+
+/**
+ * Obtain DTM box record field.
+ *
+ * The zdtm_dtm_record_field function looks up the field with the given
+ * four character abbreviation in a record, using the ADI parameter
+ * format describing the records, and obtains a pointer to its data.
+ * An abbreviation shorter than four characters matches no field.
+ * @param p_format Pointer to the parameter format of the records.
+ * @param num_format The number of params in the format.
+ * @param p_rec Pointer to the record view.
+ * @param abrev The four character abbreviation of the field.
+ * @param pp_data Pointer to the pointer to store addr of the data in.
+ * @param p_len Pointer to variable to store the length of the data in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully obtained the field.
+ * @retval 1 There is no such field in the record.
+ */
+ZDTM_EXPORT int zdtm_dtm_record_field(struct zdtm_adi_msg_param *p_format,
+    uint16_t num_format, struct zdtm_dtm_record *p_rec, const char *abrev,
+    const unsigned char **pp_data, uint32_t *p_len);
+
+/**
+ * Obtain DTM box record item.
+ *
+ * The zdtm_dtm_record_item function maps a record onto an item of the
+ * given synchronization type, using the same field mappings as the
+ * zdtm_obtain_*_item() functions. The string members of the item are
+ * not allocated but point into the DTM database, hence the item must
+ * NOT be passed to zdtm_clean_item() and is only valid as long as the
+ * record is.
+ * @param p_format Pointer to the parameter format of the records.
+ * @param num_format The number of params in the format.
+ * @param sync_type The synchronization type of the records.
+ * @param p_rec Pointer to the record view.
+ * @param p_item Pointer to zdtm_item structure to store the item in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully mapped the record onto the item.
+ * @retval -1 Failed, the sync type is not a recognized type.
+ * @retval -2 Failed, the record does not match the format.
+ */
+ZDTM_EXPORT int zdtm_dtm_record_item(struct zdtm_adi_msg_param *p_format,
+    uint16_t num_format, unsigned char sync_type,
+    struct zdtm_dtm_record *p_rec, struct zdtm_item *p_item);
+
+/**
+ * Obtain all items in bulk.
+ *
+ * The zdtm_bulk_obtain_items function is the bulk slow sync mode. It
+ * obtains the DTM box file of the current synchronization type with a
+ * single RGE request, rather than an RDR request per item, and decodes
+ * all of its records locally, handing each item to handler. If
+ * save_path is not NULL the box file is streamed to disk at save_path
+ * and mapped back in to be decoded, otherwise it is kept in memory. It
+ * is meant to be used in place of zdtm_obtain_sync_id_lists() and the
+ * zdtm_obtain_*_item() functions when zdtm_requires_slow_sync() states
+ * a slow sync is required, as every item is then new to the Desktop.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param save_path Path to save the box file at, NULL to keep in memory.
+ * @param handler The function to hand each decoded item to.
+ * @param arg Argument passed through to handler.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully obtained all the items.
+ * @retval 1 Stopped, handler returned non-zero.
+ * @retval -1 Failed to obtain the DTM box file.
+ * @retval -2 Failed to read back the DTM box file at save_path.
+ * @retval -3 Failed to decode the DTM box file.
+ */
+ZDTM_EXPORT int zdtm_bulk_obtain_items(zdtm_lib_env *cur_env,
+    const char *save_path, zdtm_item_handler handler, void *arg);
+
+#endif
@@ -0,0 +1,1070 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+
+/**
+ * @file zdtm_fleet.c
+ * @brief This is an implementation file for the fleet scheduler.
+ *
+ * The zdtm_fleet.c file is an implementation of the fleet scheduler.
+ * Each worker has a queue of its own, kept as a binary heap of the
+ * devices ordered by priority and then by submission, guarded by a
+ * lock of its own. The scheduler lock only guards the counters, so
+ * that workers taking tasks from different queues do not contend. A
+ * worker reserves a task by taking one off the count of queued tasks,
+ * which guarantees there is one left in some queue for it to take.
+ *
+ * The synchronizations over TCP/IP share a single listener. An
+ * acceptor thread accepts every connection made to it and queues it,
+ * along with the address it comes from, under a lock of its own. The
+ * environment of each synchronization is given a copy of the TCP
+ * transport whose accept and poll operations wait for a connection
+ * from the address of its device on that queue.
+ */
+
+#include "zdtm_fleet.h"
+#include "zdtm_sync.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#include <errno.h>
+#endif
+
+// Seconds a connection no synchronization claims is kept queued for.
+#define ZDTM_FLEET_CONN_TTL 30
+
+// Milliseconds the acceptor waits for a connection between checking
+// whether it is to stop.
+#define ZDTM_FLEET_ACCEPT_POLL 100
+
+struct zdtm_fleet_queue {
+    struct zdtm_fleet_device **heap;    // heap of the queued devices
+    unsigned int count;                 // number of queued devices
+    unsigned int cap;                   // capacity of the heap
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_t lock;               // protects the heap
+#endif
+};
+
+struct zdtm_fleet_worker {
+    struct zdtm_fleet_sched *fleet;     // scheduler the worker is part of
+    unsigned int index;                 // index of the queue of the worker
+#ifdef HAVE_PTHREAD_H
+    pthread_t thread;
+#endif
+};
+
+#ifdef HAVE_PTHREAD_H
+struct zdtm_fleet_conn {
+    SOCKET conn;                        // connection accepted
+    uint32_t addr;                      // address it came from
+    struct timespec when;               // time it was accepted
+};
+
+struct zdtm_fleet_route {
+    zdtm_transport tp;                  // TCP transport routing accepts
+    struct zdtm_fleet_sched *fleet;     // scheduler owning the listener
+    uint32_t addr;                      // address of the device
+};
+#endif
+
+struct zdtm_fleet_sched {
+    struct zdtm_fleet_queue *queues;    // queue of each worker
+    struct zdtm_fleet_worker *workers;  // the workers
+    unsigned int num_workers;           // number of workers and queues
+    unsigned int num_started;           // number of workers started
+    unsigned int next_queue;            // queue of the next submission
+    unsigned int max_running;           // cap on running syncs, 0 none
+    unsigned int num_running;           // number of running syncs
+    unsigned long seq;                  // sequence of the last submission
+    unsigned long num_submitted;        // syncs submitted
+    unsigned long num_queued;           // syncs queued and not reserved
+    unsigned long num_done;             // syncs finished
+    int stop;                           // flag asking the workers to stop
+    struct timespec first;              // time of the first submission
+    struct timespec last;               // time of the last finish
+    struct zdtm_fleet_metrics metrics;  // aggregate metrics
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_t lock;               // protects all but the queues
+    pthread_cond_t changed;             // signaled when a counter changes
+
+    SOCKET listenfd;                    // listener of the TCP/IP syncs
+    struct zdtm_fleet_conn *conns;      // connections not claimed yet
+    unsigned int num_conns;             // number of connections queued
+    unsigned int cap_conns;             // capacity of conns
+    int acceptor_started;               // flag stating acceptor runs
+    int stop_acceptor;                  // flag asking it to stop
+    pthread_t acceptor;
+    pthread_mutex_t route_lock;         // protects the members above
+    pthread_cond_t routed;              // signaled when one is queued
+#endif
+};
+
+static double _zdtm_fleet_secs(const struct timespec *p_from,
+    const struct timespec *p_to) {
+
+    return (p_to->tv_sec - p_from->tv_sec) +
+        ((p_to->tv_nsec - p_from->tv_nsec) / 1000000000.0);
+}
+
+/**
+ * Compare fleet devices.
+ *
+ * The _zdtm_fleet_before function tells whether device a is to be
+ * synchronized before device b, that is whether it has a higher
+ * priority or has the same priority and was submitted first.
+ * @param a Pointer to the first device.
+ * @param b Pointer to the second device.
+ * @return One if a goes before b, zero otherwise.
+ */
+static int _zdtm_fleet_before(const struct zdtm_fleet_device *a,
+    const struct zdtm_fleet_device *b) {
+
+    if (a->priority != b->priority) {
+        return a->priority > b->priority;
+    }
+    return a->seq < b->seq;
+}
+
+/**
+ * Push a device on a queue.
+ *
+ * The _zdtm_fleet_push function adds a device to the heap of a queue.
+ * Note: The lock of the queue must be held.
+ * @param p_queue Pointer to the queue.
+ * @param p_dev Pointer to the device to add.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully added the device.
+ * @retval -1 Failed to allocate memory for the heap.
+ */
+static int _zdtm_fleet_push(struct zdtm_fleet_queue *p_queue,
+    struct zdtm_fleet_device *p_dev) {
+
+    struct zdtm_fleet_device **heap;
+    unsigned int i, parent, cap;
+
+    if (p_queue->count == p_queue->cap) {
+        cap = (p_queue->cap == 0) ? 16 : (p_queue->cap * 2);
+        heap = realloc(p_queue->heap,
+            cap * sizeof(struct zdtm_fleet_device *));
+        if (heap == NULL) {
+            return -1;
+        }
+        p_queue->heap = heap;
+        p_queue->cap = cap;
+    }
+
+    heap = p_queue->heap;
+    i = p_queue->count++;
+    while (i > 0) {
+        parent = (i - 1) / 2;
+        if (!_zdtm_fleet_before(p_dev, heap[parent])) {
+            break;
+        }
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = p_dev;
+
+    return 0;
+}
+
+/**
+ * Pop a device off a queue.
+ *
+ * The _zdtm_fleet_pop function removes the most urgent device from the
+ * heap of a queue. Note: The lock of the queue must be held.
+ * @param p_queue Pointer to the queue.
+ * @return Pointer to the device removed, or NULL if the queue is empty.
+ */
+static struct zdtm_fleet_device *_zdtm_fleet_pop(
+    struct zdtm_fleet_queue *p_queue) {
+
+    struct zdtm_fleet_device **heap;
+    struct zdtm_fleet_device *p_top, *p_last;
+    unsigned int i, child;
+
+    if (p_queue->count == 0) {
+        return NULL;
+    }
+
+    heap = p_queue->heap;
+    p_top = heap[0];
+    p_last = heap[--p_queue->count];
+    i = 0;
+    for (;;) {
+        child = (2 * i) + 1;
+        if (child >= p_queue->count) {
+            break;
+        }
+        if ((child + 1 < p_queue->count) &&
+            _zdtm_fleet_before(heap[child + 1], heap[child])) {
+            child++;
+        }
+        if (!_zdtm_fleet_before(heap[child], p_last)) {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = p_last;
+
+    return p_top;
+}
+
+static void _zdtm_fleet_lock_queue(struct zdtm_fleet_queue *p_queue) {
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&p_queue->lock);
+#endif
+}
+
+static void _zdtm_fleet_unlock_queue(struct zdtm_fleet_queue *p_queue) {
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_unlock(&p_queue->lock);
+#endif
+}
+
+/**
+ * Take a reserved task.
+ *
+ * The _zdtm_fleet_take function takes the most urgent device off the
+ * queue of the given worker, or, if that queue is empty, steals the
+ * most urgent device queued on the other workers. Note: The caller must
+ * have reserved a task beforehand, which guarantees there is one to
+ * take.
+ * @param p_fleet Pointer to the fleet scheduler.
+ * @param index The index of the queue of the worker.
+ * @param p_stolen Pointer to a flag to store whether it was stolen in.
+ * @return Pointer to the device taken.
+ */
+static struct zdtm_fleet_device *_zdtm_fleet_take(zdtm_fleet *p_fleet,
+    unsigned int index, int *p_stolen) {
+
+    struct zdtm_fleet_queue *p_queue;
+    struct zdtm_fleet_device *p_dev, *p_best;
+    unsigned int i, victim;
+
+    for (;;) {
+        p_queue = &p_fleet->queues[index];
+        _zdtm_fleet_lock_queue(p_queue);
+        p_dev = _zdtm_fleet_pop(p_queue);
+        _zdtm_fleet_unlock_queue(p_queue);
+        if (p_dev != NULL) {
+            (*p_stolen) = 0;
+            return p_dev;
+        }
+
+        /* Look for the most urgent device of the other queues, which
+         * may well be gone by the time its queue is locked again. */
+        p_best = NULL;
+        victim = index;
+        for (i = 0; i < p_fleet->num_workers; i++) {
+            if (i == index) {
+                continue;
+            }
+            p_queue = &p_fleet->queues[i];
+            _zdtm_fleet_lock_queue(p_queue);
+            if ((p_queue->count > 0) && ((p_best == NULL) ||
+                _zdtm_fleet_before(p_queue->heap[0], p_best))) {
+                p_best = p_queue->heap[0];
+                victim = i;
+            }
+            _zdtm_fleet_unlock_queue(p_queue);
+        }
+
+        if (victim != index) {
+            p_queue = &p_fleet->queues[victim];
+            _zdtm_fleet_lock_queue(p_queue);
+            p_dev = _zdtm_fleet_pop(p_queue);
+            _zdtm_fleet_unlock_queue(p_queue);
+            if (p_dev != NULL) {
+                (*p_stolen) = 1;
+                return p_dev;
+            }
+        }
+    }
+}
+
+#ifdef HAVE_PTHREAD_H
+/**
+ * Parse a device address.
+ *
+ * The _zdtm_fleet_parse_addr function parses the dotted-quad address
+ * of a device into the form connections report their address in.
+ * @param zaurus_ip The dotted-quad address.
+ * @param p_addr Pointer to store the address in, in network order.
+ * @return An integer representing success (zero) or failure (non-zero).
+ */
+static int _zdtm_fleet_parse_addr(const char *zaurus_ip, uint32_t *p_addr) {
+    struct in_addr in;
+
+#ifdef WIN32
+    in.s_addr = inet_addr(zaurus_ip);
+    if (in.s_addr == INADDR_NONE) {
+        return -1;
+    }
+#else
+    if (inet_pton(AF_INET, zaurus_ip, &in) <= 0) {
+        return -1;
+    }
+#endif
+    (*p_addr) = in.s_addr;
+
+    return 0;
+}
+
+/**
+ * Find a queued connection.
+ *
+ * The _zdtm_fleet_find_conn function looks for the oldest connection
+ * queued by the acceptor which comes from the given address. Note: The
+ * route lock must be held.
+ * @param p_fleet Pointer to the fleet scheduler.
+ * @param addr The address, in network order.
+ * @return The index of the connection, or -1 if there is none.
+ */
+static int _zdtm_fleet_find_conn(zdtm_fleet *p_fleet, uint32_t addr) {
+    unsigned int i;
+
+    for (i = 0; i < p_fleet->num_conns; i++) {
+        if (p_fleet->conns[i].addr == addr) {
+            return (int)i;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Remove a queued connection.
+ *
+ * The _zdtm_fleet_remove_conn function removes a connection from the
+ * queue, keeping the others in the order they were accepted in. Note:
+ * The route lock must be held.
+ * @param p_fleet Pointer to the fleet scheduler.
+ * @param i The index of the connection.
+ * @return The connection removed.
+ */
+static SOCKET _zdtm_fleet_remove_conn(zdtm_fleet *p_fleet, unsigned int i) {
+    SOCKET conn;
+
+    conn = p_fleet->conns[i].conn;
+    p_fleet->num_conns--;
+    memmove(&p_fleet->conns[i], &p_fleet->conns[i + 1],
+        (p_fleet->num_conns - i) * sizeof(struct zdtm_fleet_conn));
+
+    return conn;
+}
+
+/**
+ * Queue a connection.
+ *
+ * The _zdtm_fleet_queue_conn function queues a connection accepted on
+ * the listener for the synchronization of the device it comes from to
+ * claim. Note: The route lock must be held.
+ * @param p_fleet Pointer to the fleet scheduler.
+ * @param conn The connection.
+ * @param addr The address it comes from, in network order.
+ * @param p_now Pointer to the time it was accepted.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully queued the connection.
+ * @retval -1 Failed to allocate memory for the queue.
+ */
+static int _zdtm_fleet_queue_conn(zdtm_fleet *p_fleet, SOCKET conn,
+    uint32_t addr, const struct timespec *p_now) {
+
+    struct zdtm_fleet_conn *conns;
+    unsigned int cap;
+
+    if (p_fleet->num_conns == p_fleet->cap_conns) {
+        cap = (p_fleet->cap_conns == 0) ? 16 : (p_fleet->cap_conns * 2);
+        conns = realloc(p_fleet->conns, cap * sizeof(struct zdtm_fleet_conn));
+        if (conns == NULL) {
+            return -1;
+        }
+        p_fleet->conns = conns;
+        p_fleet->cap_conns = cap;
+    }
+
+    p_fleet->conns[p_fleet->num_conns].conn = conn;
+    p_fleet->conns[p_fleet->num_conns].addr = addr;
+    p_fleet->conns[p_fleet->num_conns].when = (*p_now);
+    p_fleet->num_conns++;
+
+    return 0;
+}
+
+/**
+ * Accept connections for the fleet.
+ *
+ * The _zdtm_fleet_acceptor function is the body of the acceptor thread.
+ * It accepts the connections made to the listener of the fleet, queues
+ * each one along with the address it comes from, and closes those no
+ * synchronization claimed in time, until it is asked to stop.
+ * @param arg Pointer to the fleet scheduler.
+ * @return NULL.
+ */
+static void *_zdtm_fleet_acceptor(void *arg) {
+    zdtm_fleet *p_fleet;
+    zdtm_transport *p_tp;
+    struct sockaddr_in peer;
+    struct timespec now;
+    socklen_t len;
+    SOCKET conn;
+    unsigned int i;
+
+    p_fleet = (zdtm_fleet *)arg;
+    p_tp = zdtm_tcp_transport();
+
+    pthread_mutex_lock(&p_fleet->route_lock);
+    while (!p_fleet->stop_acceptor) {
+        pthread_mutex_unlock(&p_fleet->route_lock);
+
+        conn = INVALID_SOCKET;
+        if ((p_tp->poll(p_tp, p_fleet->listenfd, ZDTM_POLL_IN,
+            ZDTM_FLEET_ACCEPT_POLL) > 0) &&
+            (p_tp->accept(p_tp, p_fleet->listenfd, &conn) == 0)) {
+            len = (socklen_t)sizeof(peer);
+            if (getpeername(conn, (struct sockaddr *)&peer, &len) != 0) {
+                p_tp->close(p_tp, conn);
+                conn = INVALID_SOCKET;
+            }
+        }
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        pthread_mutex_lock(&p_fleet->route_lock);
+        i = 0;
+        while (i < p_fleet->num_conns) {
+            if ((now.tv_sec - p_fleet->conns[i].when.tv_sec) >=
+                ZDTM_FLEET_CONN_TTL) {
+                p_tp->close(p_tp, _zdtm_fleet_remove_conn(p_fleet, i));
+            } else {
+                i++;
+            }
+        }
+        if (conn != INVALID_SOCKET) {
+            if (_zdtm_fleet_queue_conn(p_fleet, conn, peer.sin_addr.s_addr,
+                &now) != 0) {
+                p_tp->close(p_tp, conn);
+            } else {
+                pthread_cond_broadcast(&p_fleet->routed);
+            }
+        }
+    }
+    pthread_mutex_unlock(&p_fleet->route_lock);
+
+    return NULL;
+}
+
+/**
+ * Listen for the fleet.
+ *
+ * The _zdtm_fleet_listen function creates the listener shared by the
+ * synchronizations over TCP/IP and starts the acceptor thread, unless
+ * they already are.
+ * @param p_fleet Pointer to the fleet scheduler.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully listened or was already listening.
+ * @retval -1 Failed to listen on the desktop port.
+ * @retval -2 Failed to start the acceptor thread.
+ */
+static int _zdtm_fleet_listen(zdtm_fleet *p_fleet) {
+    zdtm_transport *p_tp;
+    int r;
+
+    r = 0;
+    p_tp = zdtm_tcp_transport();
+    pthread_mutex_lock(&p_fleet->route_lock);
+    if (!p_fleet->acceptor_started) {
+        if (p_tp->listen(p_tp, NULL, DLISTPORT, &p_fleet->listenfd) != 0) {
+            p_fleet->listenfd = INVALID_SOCKET;
+            r = -1;
+        } else if (pthread_create(&p_fleet->acceptor, NULL,
+            _zdtm_fleet_acceptor, p_fleet) != 0) {
+            p_tp->close(p_tp, p_fleet->listenfd);
+            p_fleet->listenfd = INVALID_SOCKET;
+            r = -2;
+        } else {
+            p_fleet->acceptor_started = 1;
+        }
+    }
+    pthread_mutex_unlock(&p_fleet->route_lock);
+
+    return r;
+}
+
+/**
+ * Accept a routed connection.
+ *
+ * The _zdtm_fleet_route_accept function is the accept operation of the
+ * transport of a synchronization over TCP/IP. On the fleet listener it
+ * waits for a connection from the address of the device to be queued
+ * and claims it, on any other listener it accepts as TCP does.
+ */
+static int _zdtm_fleet_route_accept(zdtm_transport *p_tp, SOCKET listen,
+    SOCKET *p_conn) {
+
+    struct zdtm_fleet_route *p_route;
+    zdtm_fleet *p_fleet;
+    int i;
+
+    p_route = (struct zdtm_fleet_route *)p_tp->ctx;
+    p_fleet = p_route->fleet;
+    if (listen != p_fleet->listenfd) {
+        p_tp = zdtm_tcp_transport();
+        return p_tp->accept(p_tp, listen, p_conn);
+    }
+
+    pthread_mutex_lock(&p_fleet->route_lock);
+    while (((i = _zdtm_fleet_find_conn(p_fleet, p_route->addr)) < 0) &&
+        !p_fleet->stop_acceptor) {
+        pthread_cond_wait(&p_fleet->routed, &p_fleet->route_lock);
+    }
+    if (i >= 0) {
+        (*p_conn) = _zdtm_fleet_remove_conn(p_fleet, i);
+    }
+    pthread_mutex_unlock(&p_fleet->route_lock);
+
+    return (i >= 0) ? 0 : -1;
+}
+
+/**
+ * Poll a routed connection.
+ *
+ * The _zdtm_fleet_route_poll function is the poll operation of the
+ * transport of a synchronization over TCP/IP. On the fleet listener it
+ * waits up to timeout_ms milliseconds for a connection from the
+ * address of the device to be queued, on any other connection or
+ * listener it polls as TCP does.
+ */
+static int _zdtm_fleet_route_poll(zdtm_transport *p_tp, SOCKET conn,
+    int events, int timeout_ms) {
+
+    struct zdtm_fleet_route *p_route;
+    zdtm_fleet *p_fleet;
+    struct timespec deadline;
+    int r;
+
+    p_route = (struct zdtm_fleet_route *)p_tp->ctx;
+    p_fleet = p_route->fleet;
+    if (conn != p_fleet->listenfd) {
+        p_tp = zdtm_tcp_transport();
+        return p_tp->poll(p_tp, conn, events, timeout_ms);
+    }
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    if (timeout_ms > 0) {
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (timeout_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+    }
+
+    r = 0;
+    pthread_mutex_lock(&p_fleet->route_lock);
+    while ((_zdtm_fleet_find_conn(p_fleet, p_route->addr) < 0) &&
+        !p_fleet->stop_acceptor && (r != ETIMEDOUT)) {
+        if (timeout_ms < 0) {
+            pthread_cond_wait(&p_fleet->routed, &p_fleet->route_lock);
+        } else {
+            r = pthread_cond_timedwait(&p_fleet->routed,
+                &p_fleet->route_lock, &deadline);
+        }
+    }
+    r = (_zdtm_fleet_find_conn(p_fleet, p_route->addr) >= 0) ?
+        (events & ZDTM_POLL_IN) : 0;
+    pthread_mutex_unlock(&p_fleet->route_lock);
+
+    return r;
+}
+
+/**
+ * Release the connections of a device.
+ *
+ * The _zdtm_fleet_release function closes the connections from the
+ * address of a device still queued once its synchronization is over,
+ * so that they are not taken for those of its next synchronization.
+ * @param p_fleet Pointer to the fleet scheduler.
+ * @param addr The address of the device, in network order.
+ */
+static void _zdtm_fleet_release(zdtm_fleet *p_fleet, uint32_t addr) {
+    zdtm_transport *p_tp;
+    int i;
+
+    p_tp = zdtm_tcp_transport();
+    pthread_mutex_lock(&p_fleet->route_lock);
+    while ((i = _zdtm_fleet_find_conn(p_fleet, addr)) >= 0) {
+        p_tp->close(p_tp, _zdtm_fleet_remove_conn(p_fleet, i));
+    }
+    pthread_mutex_unlock(&p_fleet->route_lock);
+}
+
+/**
+ * Initialize the environment of a device.
+ *
+ * The _zdtm_fleet_init_env function initializes the environment of a
+ * device synchronization. One over TCP/IP is given the listener of the
+ * fleet and a transport of its own routing the connections made to it,
+ * any other one listens over the transport of the device.
+ * @param p_fleet Pointer to the fleet scheduler.
+ * @param p_dev Pointer to the device to synchronize.
+ * @param cur_env Pointer to the environment to initialize.
+ * @param p_route Pointer to the route to fill in for TCP/IP.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully initialized the environment.
+ * @retval -2 Failed to listen for Zaurus connections.
+ * @retval -3 Failed, the address of the device is not a valid one.
+ */
+static int _zdtm_fleet_init_env(zdtm_fleet *p_fleet,
+    struct zdtm_fleet_device *p_dev, zdtm_lib_env *cur_env,
+    struct zdtm_fleet_route *p_route) {
+
+    if (p_dev->transport != NULL) {
+        return zdtm_initialize_transport(cur_env, p_dev->transport);
+    }
+
+    if (_zdtm_fleet_parse_addr(p_dev->zaurus_ip, &p_route->addr) != 0) {
+        return -3;
+    }
+    if (_zdtm_fleet_listen(p_fleet) != 0) {
+        return -2;
+    }
+
+    p_route->tp = (*zdtm_tcp_transport());
+    p_route->tp.ctx = p_route;
+    p_route->tp.accept = _zdtm_fleet_route_accept;
+    p_route->tp.poll = _zdtm_fleet_route_poll;
+    p_route->fleet = p_fleet;
+
+    return zdtm_initialize_listener(cur_env, &p_route->tp,
+        p_fleet->listenfd);
+}
+#endif
+
+/**
+ * Exchange with a device.
+ *
+ * The _zdtm_fleet_exchange function runs a device synchronization on
+ * an initialized environment: it initiates the synchronization, walks
+ * the items of the sync ID lists handing each one to the consume
+ * function of the device, and terminates the synchronization.
+ * @param p_dev Pointer to the device to synchronize.
+ * @param cur_env Pointer to the initialized environment of the device.
+ * @return Zero on success, or the ZDTM_FLEET_* stage which failed.
+ */
+static int _zdtm_fleet_exchange(struct zdtm_fleet_device *p_dev,
+    zdtm_lib_env *cur_env) {
+
+    zdtm_item_iter *p_iter;
+    struct zdtm_item item;
+    int r, stage;
+
+    r = zdtm_initiate_sync(cur_env);
+    if (r != 0) {
+        p_dev->error = r;
+        return ZDTM_FLEET_INITIATE;
+    }
+
+    r = zdtm_item_iter_open(cur_env, 0, &p_iter);
+    if (r != 0) {
+        p_dev->error = r;
+        return ZDTM_FLEET_LISTS;
+    }
+
+    stage = 0;
+    while ((r = zdtm_item_iter_next(p_iter, &item)) == 0) {
+        if (item.list != ZDTM_ITEM_DEL) {
+            p_dev->items++;
+        }
+        if (p_dev->consume != NULL) {
+            r = p_dev->consume(&item, p_dev->arg);
+        }
+        zdtm_clean_item(&item);
+        if (r != 0) {
+            p_dev->error = r;
+            stage = ZDTM_FLEET_CONSUME;
+            break;
+        }
+    }
+    if ((stage == 0) && (r < 0)) {
+        p_dev->error = r;
+        stage = ZDTM_FLEET_ITEM;
+    }
+    zdtm_item_iter_close(p_iter);
+    if (stage != 0) {
+        return stage;
+    }
+
+    r = zdtm_terminate_sync(cur_env);
+    if (r != 0) {
+        p_dev->error = r;
+        return ZDTM_FLEET_TERMINATE;
+    }
+
+    return 0;
+}
+
+/**
+ * Synchronize a device.
+ *
+ * The _zdtm_fleet_sync function runs the synchronization of a device
+ * on an environment of its own, filling in the results of the device.
+ * The connections of a failed synchronization are closed.
+ * @param p_fleet Pointer to the fleet scheduler.
+ * @param p_dev Pointer to the device to synchronize.
+ */
+static void _zdtm_fleet_sync(zdtm_fleet *p_fleet,
+    struct zdtm_fleet_device *p_dev) {
+
+    zdtm_lib_env cur_env;
+    struct timespec start, end;
+#ifdef HAVE_PTHREAD_H
+    struct zdtm_fleet_route route;
+#endif
+    int r;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    p_dev->result = 0;
+    p_dev->error = 0;
+    p_dev->items = 0;
+
+    memset(&cur_env, 0, sizeof(zdtm_lib_env));
+#ifdef HAVE_PTHREAD_H
+    r = _zdtm_fleet_init_env(p_fleet, p_dev, &cur_env, &route);
+#else
+    /* Without an acceptor every synchronization listens on its own, one
+     * after the other. */
+    r = zdtm_initialize_transport(&cur_env, p_dev->transport);
+#endif
+    if (r != 0) {
+        p_dev->result = ZDTM_FLEET_INITIALIZE;
+        p_dev->error = r;
+    } else {
+        zdtm_set_zaurus_ip(&cur_env, p_dev->zaurus_ip);
+        zdtm_set_sync_type(&cur_env, p_dev->sync_type);
+        zdtm_set_log_none(&cur_env);
+
+        r = 0;
+        if (p_dev->setup != NULL) {
+            r = p_dev->setup(&cur_env, p_dev->arg);
+        }
+        if (r != 0) {
+            p_dev->result = ZDTM_FLEET_SETUP;
+            p_dev->error = r;
+        } else {
+            p_dev->result = _zdtm_fleet_exchange(p_dev, &cur_env);
+            if (p_dev->result != 0) {
+                _zdtm_close_conn_to_zaurus(&cur_env);
+                _zdtm_close_zaurus_conn(&cur_env);
+            }
+        }
+
+        zdtm_finalize(&cur_env);
+#ifdef HAVE_PTHREAD_H
+        if (p_dev->transport == NULL) {
+            _zdtm_fleet_release(p_fleet, route.addr);
+        }
+#endif
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    p_dev->secs = _zdtm_fleet_secs(&start, &end);
+}
+
+/**
+ * Account for a finished device.
+ *
+ * The _zdtm_fleet_account function adds a finished device to the
+ * aggregate metrics of the scheduler. Note: The scheduler lock must be
+ * held.
+ * @param p_fleet Pointer to the fleet scheduler.
+ * @param p_dev Pointer to the finished device.
+ * @param stolen Flag stating the device was stolen from another worker.
+ */
+static void _zdtm_fleet_account(zdtm_fleet *p_fleet,
+    struct zdtm_fleet_device *p_dev, int stolen) {
+
+    p_fleet->num_done++;
+    p_fleet->metrics.devices++;
+    if (p_dev->result != 0) {
+        p_fleet->metrics.failed++;
+    }
+    p_fleet->metrics.items += p_dev->items;
+    if (stolen) {
+        p_fleet->metrics.steals++;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &p_fleet->last);
+}
+
+#ifdef HAVE_PTHREAD_H
+static void *_zdtm_fleet_worker(void *arg) {
+    struct zdtm_fleet_worker *p_worker;
+    zdtm_fleet *p_fleet;
+    struct zdtm_fleet_device *p_dev;
+    int stolen;
+
+    p_worker = (struct zdtm_fleet_worker *)arg;
+    p_fleet = p_worker->fleet;
+
+    pthread_mutex_lock(&p_fleet->lock);
+    for (;;) {
+        while (!p_fleet->stop && ((p_fleet->num_queued == 0) ||
+            ((p_fleet->max_running > 0) &&
+            (p_fleet->num_running >= p_fleet->max_running)))) {
+            pthread_cond_wait(&p_fleet->changed, &p_fleet->lock);
+        }
+        if (p_fleet->stop) {
+            break;
+        }
+
+        /* Reserve a task and a place among the running ones. */
+        p_fleet->num_queued--;
+        p_fleet->num_running++;
+        if (p_fleet->num_running > p_fleet->metrics.peak_running) {
+            p_fleet->metrics.peak_running = p_fleet->num_running;
+        }
+        pthread_mutex_unlock(&p_fleet->lock);
+
+        p_dev = _zdtm_fleet_take(p_fleet, p_worker->index, &stolen);
+        _zdtm_fleet_sync(p_fleet, p_dev);
+
+        pthread_mutex_lock(&p_fleet->lock);
+        p_fleet->num_running--;
+        _zdtm_fleet_account(p_fleet, p_dev, stolen);
+        pthread_cond_broadcast(&p_fleet->changed);
+    }
+    pthread_mutex_unlock(&p_fleet->lock);
+
+    return NULL;
+}
+#endif
+
+int zdtm_fleet_new(unsigned int num_workers, unsigned int max_running,
+    zdtm_fleet **pp_fleet) {
+
+    zdtm_fleet *p_fleet;
+    unsigned int i;
+
+    if (num_workers == 0) {
+        num_workers = 1;
+    }
+
+    p_fleet = calloc(1, sizeof(zdtm_fleet));
+    if (p_fleet == NULL) {
+        return -1;
+    }
+    p_fleet->queues = calloc(num_workers, sizeof(struct zdtm_fleet_queue));
+    p_fleet->workers = calloc(num_workers, sizeof(struct zdtm_fleet_worker));
+    if ((p_fleet->queues == NULL) || (p_fleet->workers == NULL)) {
+        free(p_fleet->queues);
+        free(p_fleet->workers);
+        free(p_fleet);
+        return -1;
+    }
+    p_fleet->num_workers = num_workers;
+    p_fleet->max_running = max_running;
+
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_init(&p_fleet->lock, NULL);
+    pthread_cond_init(&p_fleet->changed, NULL);
+    pthread_mutex_init(&p_fleet->route_lock, NULL);
+    pthread_cond_init(&p_fleet->routed, NULL);
+    p_fleet->listenfd = INVALID_SOCKET;
+    for (i = 0; i < num_workers; i++) {
+        pthread_mutex_init(&p_fleet->queues[i].lock, NULL);
+    }
+    for (i = 0; i < num_workers; i++) {
+        p_fleet->workers[i].fleet = p_fleet;
+        p_fleet->workers[i].index = i;
+        if (pthread_create(&p_fleet->workers[i].thread, NULL,
+            _zdtm_fleet_worker, &p_fleet->workers[i]) != 0) {
+            zdtm_fleet_free(p_fleet);
+            return -2;
+        }
+        p_fleet->num_started++;
+    }
+#else
+    for (i = 0; i < num_workers; i++) {
+        p_fleet->workers[i].fleet = p_fleet;
+        p_fleet->workers[i].index = i;
+    }
+#endif
+
+    (*pp_fleet) = p_fleet;
+
+    return 0;
+}
+
+int zdtm_fleet_submit(zdtm_fleet *p_fleet, struct zdtm_fleet_device *p_dev) {
+    struct zdtm_fleet_queue *p_queue;
+    int r;
+
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&p_fleet->lock);
+#endif
+    p_dev->seq = ++p_fleet->seq;
+    p_queue = &p_fleet->queues[p_fleet->next_queue];
+    p_fleet->next_queue = (p_fleet->next_queue + 1) % p_fleet->num_workers;
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_unlock(&p_fleet->lock);
+#endif
+
+    _zdtm_fleet_lock_queue(p_queue);
+    r = _zdtm_fleet_push(p_queue, p_dev);
+    _zdtm_fleet_unlock_queue(p_queue);
+    if (r != 0) {
+        return -1;
+    }
+
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&p_fleet->lock);
+#endif
+    if (p_fleet->num_submitted == 0) {
+        clock_gettime(CLOCK_MONOTONIC, &p_fleet->first);
+    }
+    p_fleet->num_submitted++;
+    p_fleet->num_queued++;
+#ifdef HAVE_PTHREAD_H
+    pthread_cond_broadcast(&p_fleet->changed);
+    pthread_mutex_unlock(&p_fleet->lock);
+#endif
+
+    return 0;
+}
+
+int zdtm_fleet_wait(zdtm_fleet *p_fleet) {
+    int failed;
+#ifndef HAVE_PTHREAD_H
+    struct zdtm_fleet_device *p_dev;
+    int stolen;
+#endif
+
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&p_fleet->lock);
+    while (p_fleet->num_done < p_fleet->num_submitted) {
+        pthread_cond_wait(&p_fleet->changed, &p_fleet->lock);
+    }
+    failed = p_fleet->metrics.failed;
+    pthread_mutex_unlock(&p_fleet->lock);
+#else
+    /* Without workers the devices are synchronized right here, the
+     * most urgent one of all the queues first. */
+    while (p_fleet->num_queued > 0) {
+        p_fleet->num_queued--;
+        p_dev = _zdtm_fleet_take(p_fleet, 0, &stolen);
+        p_fleet->metrics.peak_running = 1;
+        _zdtm_fleet_sync(p_fleet, p_dev);
+        _zdtm_fleet_account(p_fleet, p_dev, 0);
+    }
+    failed = p_fleet->metrics.failed;
+#endif
+
+    return failed;
+}
+
+int zdtm_fleet_metrics(zdtm_fleet *p_fleet,
+    struct zdtm_fleet_metrics *p_metrics) {
+
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&p_fleet->lock);
+#endif
+    (*p_metrics) = p_fleet->metrics;
+    p_metrics->secs = 0.0;
+    p_metrics->devices_per_sec = 0.0;
+    p_metrics->items_per_sec = 0.0;
+    if (p_fleet->metrics.devices > 0) {
+        p_metrics->secs = _zdtm_fleet_secs(&p_fleet->first, &p_fleet->last);
+    }
+    if (p_metrics->secs > 0.0) {
+        p_metrics->devices_per_sec = p_metrics->devices / p_metrics->secs;
+        p_metrics->items_per_sec = p_metrics->items / p_metrics->secs;
+    }
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_unlock(&p_fleet->lock);
+#endif
+
+    return 0;
+}
+
+int zdtm_fleet_free(zdtm_fleet *p_fleet) {
+    struct zdtm_fleet_device *p_dev;
+    unsigned int i;
+
+    if (p_fleet == NULL) {
+        return -1;
+    }
+
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&p_fleet->lock);
+    p_fleet->stop = 1;
+    pthread_cond_broadcast(&p_fleet->changed);
+    pthread_mutex_unlock(&p_fleet->lock);
+    for (i = 0; i < p_fleet->num_started; i++) {
+        pthread_join(p_fleet->workers[i].thread, NULL);
+    }
+
+    /* The acceptor is only stopped once no synchronization waits for a
+     * connection any more. */
+    if (p_fleet->acceptor_started) {
+        pthread_mutex_lock(&p_fleet->route_lock);
+        p_fleet->stop_acceptor = 1;
+        pthread_cond_broadcast(&p_fleet->routed);
+        pthread_mutex_unlock(&p_fleet->route_lock);
+        pthread_join(p_fleet->acceptor, NULL);
+
+        for (i = 0; i < p_fleet->num_conns; i++) {
+            zdtm_tcp_transport()->close(zdtm_tcp_transport(),
+                p_fleet->conns[i].conn);
+        }
+        zdtm_tcp_transport()->close(zdtm_tcp_transport(), p_fleet->listenfd);
+    }
+    free(p_fleet->conns);
+#endif
+
+    for (i = 0; i < p_fleet->num_workers; i++) {
+        while ((p_dev = _zdtm_fleet_pop(&p_fleet->queues[i])) != NULL) {
+            p_dev->result = ZDTM_FLEET_CANCELLED;
+        }
+        free(p_fleet->queues[i].heap);
+#ifdef HAVE_PTHREAD_H
+        pthread_mutex_destroy(&p_fleet->queues[i].lock);
+#endif
+    }
+
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_destroy(&p_fleet->lock);
+    pthread_cond_destroy(&p_fleet->changed);
+    pthread_mutex_destroy(&p_fleet->route_lock);
+    pthread_cond_destroy(&p_fleet->routed);
+#endif
+
+    free(p_fleet->queues);
+    free(p_fleet->workers);
+    free(p_fleet);
+
+    return 0;
+}
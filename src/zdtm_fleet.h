@@ -0,0 +1,190 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+
+/**
+ * @file zdtm_fleet.h
+ * @brief This is a specifications file for the fleet scheduler.
+ *
+ * The zdtm_fleet.h file is a specifications file for the fleet
+ * scheduler, which synchronizes many devices at once on a pool of
+ * worker threads. Each device synchronization is a task of its own,
+ * walking through initiating the synchronization, obtaining the sync ID
+ * lists and the items, and terminating the synchronization. Every
+ * worker has a queue of its own, ordered by device priority, and a
+ * worker out of tasks steals the most urgent task queued on the other
+ * workers.
+ */
+
+#ifndef ZDTM_FLEET_H
+#define ZDTM_FLEET_H
+
+#include "zdtm_export.h"
+#include "zdtm_types.h"
+#include "zdtm_iter.h"
+
+// Stages a device synchronization failed at, see zdtm_fleet_device.
+#define ZDTM_FLEET_INITIALIZE -1
+#define ZDTM_FLEET_SETUP -2
+#define ZDTM_FLEET_INITIATE -3
+#define ZDTM_FLEET_LISTS -4
+#define ZDTM_FLEET_ITEM -5
+#define ZDTM_FLEET_CONSUME -6
+#define ZDTM_FLEET_TERMINATE -7
+#define ZDTM_FLEET_CANCELLED -8
+
+/**
+ * Fleet device.
+ *
+ * The zdtm_fleet_device structure describes the synchronization of a
+ * single device handed to the fleet scheduler. The configuration
+ * members are filled in by the caller prior to calling
+ * zdtm_fleet_submit(), the results may be read once zdtm_fleet_wait()
+ * has returned. Each synchronization has an environment of its own
+ * which logs nowhere, unless the setup function says otherwise.
+ */
+struct zdtm_fleet_device {
+    /* configuration */
+    char zaurus_ip[IP_STR_SIZE];    // Zaurus IP address
+    unsigned int sync_type;         // type as for zdtm_set_sync_type()
+    int priority;                   // devices of higher priority go first
+    zdtm_transport *transport;      // transport to sync over, NULL for TCP
+    // function setting up the environment further, NULL for none
+    int (*setup)(zdtm_lib_env *cur_env, void *arg);
+    // function consuming each item, which is cleaned after, NULL for none
+    int (*consume)(struct zdtm_item *p_item, void *arg);
+    void *arg;                      // argument handed to the functions
+
+    /* results */
+    int result;         // zero, or the ZDTM_FLEET_* stage which failed
+    int error;          // the value the failed stage returned
+    unsigned long items; // number of items obtained
+    double secs;        // seconds the synchronization took
+
+    /* private */
+    unsigned long seq;
+};
+
+/**
+ * Fleet metrics.
+ *
+ * The zdtm_fleet_metrics structure holds the aggregate metrics of the
+ * device synchronizations run by a fleet scheduler.
+ */
+struct zdtm_fleet_metrics {
+    unsigned long devices;      // device synchronizations finished
+    unsigned long failed;       // of which failed or were cancelled
+    unsigned long items;        // items obtained
+    unsigned long steals;       // tasks stolen from another worker
+    unsigned int peak_running;  // most synchronizations run at once
+    double secs;                // seconds from first submit to last finish
+    double devices_per_sec;     // device synchronizations per second
+    double items_per_sec;       // items obtained per second
+};
+
+/**
+ * Fleet scheduler.
+ *
+ * The zdtm_fleet is a type defined to represent a fleet scheduler. It
+ * is only ever handled through a pointer obtained from
+ * zdtm_fleet_new().
+ */
+typedef struct zdtm_fleet_sched zdtm_fleet;
+
+/**
+ * Create a fleet scheduler.
+ *
+ * The zdtm_fleet_new function creates a fleet scheduler and starts its
+ * worker threads. At most max_running device synchronizations run at
+ * once. The synchronizations over TCP/IP, those of devices without a
+ * transport of their own, share a single listener on the desktop port
+ * which the fleet creates with the first of them. Each connection made
+ * back to it is handed to the synchronization of the device whose
+ * zaurus_ip it comes from, hence devices sharing an address are not to
+ * be synchronized at the same time. When the library is built without
+ * pthreads support there are no workers and the devices are
+ * synchronized one after the other by zdtm_fleet_wait(), each one
+ * listening on its own.
+ * @param num_workers The number of worker threads (0 = 1).
+ * @param max_running Max number of synchronizations at once (0 = no cap).
+ * @param pp_fleet Pointer to a pointer to store the new scheduler in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully created the fleet scheduler.
+ * @retval -1 Failed to allocate memory for the scheduler.
+ * @retval -2 Failed to start the worker threads.
+ */
+ZDTM_EXPORT int zdtm_fleet_new(unsigned int num_workers,
+    unsigned int max_running, zdtm_fleet **pp_fleet);
+
+/**
+ * Submit a device synchronization.
+ *
+ * The zdtm_fleet_submit function queues the synchronization of a
+ * device on the fleet scheduler, on the queue of the next worker in
+ * turn. The device structure must stay around and untouched until
+ * zdtm_fleet_wait() has returned.
+ * @param p_fleet Pointer to the fleet scheduler.
+ * @param p_dev Pointer to the device to synchronize.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully queued the synchronization.
+ * @retval -1 Failed to allocate memory for the queue.
+ */
+ZDTM_EXPORT int zdtm_fleet_submit(zdtm_fleet *p_fleet,
+    struct zdtm_fleet_device *p_dev);
+
+/**
+ * Wait for the fleet.
+ *
+ * The zdtm_fleet_wait function waits for all the synchronizations
+ * submitted so far to finish.
+ * @param p_fleet Pointer to the fleet scheduler.
+ * @return The number of synchronizations which failed.
+ */
+ZDTM_EXPORT int zdtm_fleet_wait(zdtm_fleet *p_fleet);
+
+/**
+ * Obtain the fleet metrics.
+ *
+ * The zdtm_fleet_metrics function obtains the aggregate metrics of the
+ * synchronizations finished so far.
+ * @param p_fleet Pointer to the fleet scheduler.
+ * @param p_metrics Pointer to the structure to store the metrics in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully obtained the metrics.
+ */
+ZDTM_EXPORT int zdtm_fleet_metrics(zdtm_fleet *p_fleet,
+    struct zdtm_fleet_metrics *p_metrics);
+
+/**
+ * Free a fleet scheduler.
+ *
+ * The zdtm_fleet_free function stops the worker threads, waiting for
+ * the synchronizations they are running to finish, and frees the fleet
+ * scheduler. The synchronizations still queued are not run and get
+ * ZDTM_FLEET_CANCELLED as their result.
+ * @param p_fleet Pointer to the fleet scheduler.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully freed the fleet scheduler.
+ * @retval -1 Failed, p_fleet is NULL.
+ */
+ZDTM_EXPORT int zdtm_fleet_free(zdtm_fleet *p_fleet);
+
+#endif
@@ -43,6 +43,7 @@
     #include <netdb.h>
     #include <unistd.h>
     #include <netinet/in.h>
+    #include <netinet/tcp.h>
     #include <arpa/inet.h>
 #endif
 
@@ -0,0 +1,475 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+
+/**
+ * @file zdtm_idset.c
+ * @brief This is an implementation file for sorted sync ID sets.
+ *
+ * The zdtm_idset.c file is an implementation of sets of sync IDs kept
+ * as sorted arrays. Intersection and difference compare the sets four
+ * sync IDs against four at a time with SSE2 or NEON when the target
+ * has them, and membership finishes its search with the same compare.
+ */
+
+#include "zdtm_idset.h"
+#include "zdtm_proto.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/**
+ * Match a block of sync ids.
+ *
+ * The _zdtm_id_block_match function compares the four sync ids at p_a
+ * with the four sync ids at p_b.
+ * @param p_a Pointer to the four sync ids to look for.
+ * @param p_b Pointer to the four sync ids to look in.
+ * @return A mask with bit k set if p_a[k] is one of the ids at p_b.
+ */
+static unsigned int _zdtm_id_block_match(const uint32_t *p_a,
+    const uint32_t *p_b) {
+#if defined(__SSE2__)
+    __m128i va, vb, eq;
+
+    va = _mm_loadu_si128((const __m128i *)p_a);
+    vb = _mm_loadu_si128((const __m128i *)p_b);
+    eq = _mm_cmpeq_epi32(va, vb);
+    eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va,
+        _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1))));
+    eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va,
+        _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2))));
+    eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va,
+        _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3))));
+
+    return (unsigned int)_mm_movemask_ps(_mm_castsi128_ps(eq));
+#elif defined(__ARM_NEON)
+    static const uint32_t bits[4] = {1, 2, 4, 8};
+    uint32x4_t va, vb, eq;
+    uint32x2_t half;
+
+    va = vld1q_u32(p_a);
+    vb = vld1q_u32(p_b);
+    eq = vceqq_u32(va, vb);
+    eq = vorrq_u32(eq, vceqq_u32(va, vextq_u32(vb, vb, 1)));
+    eq = vorrq_u32(eq, vceqq_u32(va, vextq_u32(vb, vb, 2)));
+    eq = vorrq_u32(eq, vceqq_u32(va, vextq_u32(vb, vb, 3)));
+    eq = vandq_u32(eq, vld1q_u32(bits));
+    half = vorr_u32(vget_low_u32(eq), vget_high_u32(eq));
+
+    return vget_lane_u32(half, 0) | vget_lane_u32(half, 1);
+#else
+    unsigned int mask;
+    int k, l;
+
+    mask = 0;
+    for (k = 0; k < 4; k++) {
+        for (l = 0; l < 4; l++) {
+            if (p_a[k] == p_b[l]) {
+                mask |= (1 << k);
+            }
+        }
+    }
+
+    return mask;
+#endif
+}
+
+/**
+ * Check a block of sync ids.
+ *
+ * The _zdtm_id_block_has function checks if a sync id is one of the
+ * four sync ids at p_ids.
+ * @param p_ids Pointer to the four sync ids to look in.
+ * @param sync_id The sync id to look for.
+ * @return Non-zero if the sync id is one of them, zero otherwise.
+ */
+static int _zdtm_id_block_has(const uint32_t *p_ids, uint32_t sync_id) {
+#if defined(__SSE2__)
+    return _mm_movemask_epi8(_mm_cmpeq_epi32(
+        _mm_loadu_si128((const __m128i *)p_ids),
+        _mm_set1_epi32((int)sync_id)));
+#elif defined(__ARM_NEON)
+    uint32x4_t eq;
+    uint32x2_t half;
+
+    eq = vceqq_u32(vld1q_u32(p_ids), vdupq_n_u32(sync_id));
+    half = vorr_u32(vget_low_u32(eq), vget_high_u32(eq));
+
+    return (vget_lane_u32(half, 0) | vget_lane_u32(half, 1)) != 0;
+#else
+    return (p_ids[0] == sync_id) || (p_ids[1] == sync_id) ||
+        (p_ids[2] == sync_id) || (p_ids[3] == sync_id);
+#endif
+}
+
+/**
+ * Reserve room in a sync id set.
+ *
+ * The _zdtm_id_set_reserve function makes sure a set has room for the
+ * given number of sync ids, its content being lost when it grows.
+ * @param p_set Pointer to the set.
+ * @param max_ids The number of sync ids to make room for.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully reserved the room.
+ * @retval -1 Failed to allocate memory for the set.
+ */
+static int _zdtm_id_set_reserve(zdtm_id_set *p_set, uint32_t max_ids) {
+    uint32_t *ids;
+
+    if ((p_set->ids != NULL) && (max_ids <= p_set->max_ids)) {
+        return 0;
+    }
+
+    ids = malloc(sizeof(uint32_t) * ((size_t)max_ids + 1));
+    if (ids == NULL) {
+        return -1;
+    }
+
+    free(p_set->ids);
+    p_set->ids = ids;
+    p_set->max_ids = max_ids;
+
+    return 0;
+}
+
+/**
+ * Sort a sync id set.
+ *
+ * The _zdtm_id_set_sort function sorts the num_ids sync ids held by a
+ * set with a least significant byte first radix sort and then drops
+ * the duplicates. A pass is skipped when every sync id has the same
+ * value in its byte, as is usual for the high bytes of sync ids.
+ * @param p_set Pointer to the set holding the unsorted sync ids.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully sorted the set.
+ * @retval -1 Failed to allocate memory for the sort.
+ */
+static int _zdtm_id_set_sort(zdtm_id_set *p_set) {
+    uint32_t counts[4][256];
+    uint32_t *src, *dst, *tmp;
+    uint32_t num_ids, pos, n, i;
+    int pass, shift;
+
+    num_ids = p_set->num_ids;
+    if (num_ids < 2) {
+        return 0;
+    }
+
+    tmp = malloc(sizeof(uint32_t) * num_ids);
+    if (tmp == NULL) {
+        return -1;
+    }
+
+    memset(counts, 0, sizeof(counts));
+    for (i = 0; i < num_ids; i++) {
+        counts[0][p_set->ids[i] & 0xff]++;
+        counts[1][(p_set->ids[i] >> 8) & 0xff]++;
+        counts[2][(p_set->ids[i] >> 16) & 0xff]++;
+        counts[3][p_set->ids[i] >> 24]++;
+    }
+
+    src = p_set->ids;
+    dst = tmp;
+    for (pass = 0; pass < 4; pass++) {
+        shift = pass * 8;
+        if (counts[pass][(src[0] >> shift) & 0xff] == num_ids) {
+            continue;
+        }
+
+        pos = 0;
+        for (i = 0; i < 256; i++) {
+            n = counts[pass][i];
+            counts[pass][i] = pos;
+            pos += n;
+        }
+        for (i = 0; i < num_ids; i++) {
+            dst[counts[pass][(src[i] >> shift) & 0xff]++] = src[i];
+        }
+
+        src = dst;
+        dst = (src == tmp) ? p_set->ids : tmp;
+    }
+
+    if (src != p_set->ids) {
+        memcpy(p_set->ids, src, sizeof(uint32_t) * num_ids);
+    }
+    free(tmp);
+
+    n = 1;
+    for (i = 1; i < num_ids; i++) {
+        p_set->ids[n] = p_set->ids[i];
+        n += (p_set->ids[i] != p_set->ids[n - 1]);
+    }
+    p_set->num_ids = n;
+
+    return 0;
+}
+
+void zdtm_id_set_init(zdtm_id_set *p_set) {
+    memset(p_set, 0, sizeof(zdtm_id_set));
+}
+
+void zdtm_id_set_free(zdtm_id_set *p_set) {
+    free(p_set->ids);
+    memset(p_set, 0, sizeof(zdtm_id_set));
+}
+
+int zdtm_id_set_from_ids(zdtm_id_set *p_set, const uint32_t *p_ids,
+    uint32_t num_ids) {
+
+    if (_zdtm_id_set_reserve(p_set, num_ids) != 0) {
+        return -1;
+    }
+
+    memcpy(p_set->ids, p_ids, sizeof(uint32_t) * num_ids);
+    p_set->num_ids = num_ids;
+
+    return _zdtm_id_set_sort(p_set);
+}
+
+int zdtm_id_set_from_listing(zdtm_lib_env *cur_env, zdtm_id_set *p_set) {
+    struct zdtm_alr_entry *entries;
+    uint16_t num_entries, i;
+    int r;
+
+    r = _zdtm_obtain_item_listing(cur_env, &entries, &num_entries);
+    if (r != 0) {
+        return _zdtm_timeout_result(cur_env, -2);
+    }
+
+    if (_zdtm_id_set_reserve(p_set, num_entries) != 0) {
+        free(entries);
+        return -1;
+    }
+
+    for (i = 0; i < num_entries; i++) {
+        p_set->ids[i] = entries[i].sync_id;
+    }
+    p_set->num_ids = num_entries;
+    free(entries);
+
+    return _zdtm_id_set_sort(p_set);
+}
+
+int zdtm_id_set_contains(const zdtm_id_set *p_set, uint32_t sync_id) {
+    const uint32_t *base;
+    uint32_t len, half, i;
+
+    base = p_set->ids;
+    len = p_set->num_ids;
+
+    /* Narrow down to eight sync ids without branching on the data. */
+    while (len > 8) {
+        half = len / 2;
+        base = (base[half] <= sync_id) ? (base + half) : base;
+        len -= half;
+    }
+
+    if (p_set->num_ids >= 8) {
+        if ((base + 8) > (p_set->ids + p_set->num_ids)) {
+            base = p_set->ids + p_set->num_ids - 8;
+        }
+        return (_zdtm_id_block_has(base, sync_id) ||
+            _zdtm_id_block_has(base + 4, sync_id)) ? 1 : 0;
+    }
+
+    for (i = 0; i < len; i++) {
+        if (base[i] == sync_id) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+int zdtm_id_set_union(zdtm_id_set *p_out, const zdtm_id_set *p_a,
+    const zdtm_id_set *p_b) {
+
+    const uint32_t *a, *b;
+    uint32_t na, nb, i, j, n, x, y;
+
+    a = p_a->ids;
+    b = p_b->ids;
+    na = p_a->num_ids;
+    nb = p_b->num_ids;
+
+    if ((na > (0xffffffff - nb)) ||
+        (_zdtm_id_set_reserve(p_out, na + nb) != 0)) {
+        return -1;
+    }
+
+    i = 0;
+    j = 0;
+    n = 0;
+    while ((i < na) && (j < nb)) {
+        /* Runs of four from one side are copied at once. */
+        if (((i + 4) <= na) && (a[i + 3] < b[j])) {
+            memcpy(p_out->ids + n, a + i, sizeof(uint32_t) * 4);
+            n += 4;
+            i += 4;
+        } else if (((j + 4) <= nb) && (b[j + 3] < a[i])) {
+            memcpy(p_out->ids + n, b + j, sizeof(uint32_t) * 4);
+            n += 4;
+            j += 4;
+        } else {
+            x = a[i];
+            y = b[j];
+            p_out->ids[n++] = (x <= y) ? x : y;
+            i += (x <= y);
+            j += (y <= x);
+        }
+    }
+
+    memcpy(p_out->ids + n, a + i, sizeof(uint32_t) * (na - i));
+    n += na - i;
+    memcpy(p_out->ids + n, b + j, sizeof(uint32_t) * (nb - j));
+    n += nb - j;
+
+    p_out->num_ids = n;
+
+    return 0;
+}
+
+int zdtm_id_set_intersect(zdtm_id_set *p_out, const zdtm_id_set *p_a,
+    const zdtm_id_set *p_b) {
+
+    const uint32_t *a, *b;
+    uint32_t na, nb, i, j, n;
+    unsigned int mask;
+    int k;
+
+    a = p_a->ids;
+    b = p_b->ids;
+    na = p_a->num_ids;
+    nb = p_b->num_ids;
+
+    /* Unmatched sync ids of a block are stored past the result before
+     * being overwritten, hence the room for four more. */
+    if (_zdtm_id_set_reserve(p_out, ((na < nb) ? na : nb) + 4) != 0) {
+        return -1;
+    }
+
+    i = 0;
+    j = 0;
+    n = 0;
+    while (((i + 4) <= na) && ((j + 4) <= nb)) {
+        mask = _zdtm_id_block_match(a + i, b + j);
+        for (k = 0; k < 4; k++) {
+            p_out->ids[n] = a[i + k];
+            n += (mask >> k) & 1;
+        }
+
+        /* The block ending first is done with, both when they end on
+         * the same sync id. */
+        if (a[i + 3] < b[j + 3]) {
+            i += 4;
+        } else if (a[i + 3] > b[j + 3]) {
+            j += 4;
+        } else {
+            i += 4;
+            j += 4;
+        }
+    }
+
+    /* The sync ids left over from a block the other list moved past
+     * are all below its next sync id, so the merge skips them. */
+    while ((i < na) && (j < nb)) {
+        if (a[i] < b[j]) {
+            i++;
+        } else if (a[i] > b[j]) {
+            j++;
+        } else {
+            p_out->ids[n++] = a[i];
+            i++;
+            j++;
+        }
+    }
+
+    p_out->num_ids = n;
+
+    return 0;
+}
+
+int zdtm_id_set_difference(zdtm_id_set *p_out, const zdtm_id_set *p_a,
+    const zdtm_id_set *p_b) {
+
+    const uint32_t *a, *b;
+    uint32_t na, nb, i, j, n;
+    unsigned int found;
+    int k;
+
+    a = p_a->ids;
+    b = p_b->ids;
+    na = p_a->num_ids;
+    nb = p_b->num_ids;
+
+    if (_zdtm_id_set_reserve(p_out, na) != 0) {
+        return -1;
+    }
+
+    /* The matches of the current block of a are gathered over every
+     * block of b it overlaps before its unmatched sync ids are kept. */
+    i = 0;
+    j = 0;
+    n = 0;
+    found = 0;
+    while (((i + 4) <= na) && ((j + 4) <= nb)) {
+        found |= _zdtm_id_block_match(a + i, b + j);
+        if (a[i + 3] > b[j + 3]) {
+            j += 4;
+            continue;
+        }
+
+        if (a[i + 3] == b[j + 3]) {
+            j += 4;
+        }
+        for (k = 0; k < 4; k++) {
+            p_out->ids[n] = a[i + k];
+            n += ((found >> k) & 1) ^ 1;
+        }
+        found = 0;
+        i += 4;
+    }
+
+    for (; i < na; i++, found >>= 1) {
+        if (found & 1) {
+            continue;
+        }
+        while ((j < nb) && (b[j] < a[i])) {
+            j++;
+        }
+        if ((j < nb) && (b[j] == a[i])) {
+            continue;
+        }
+        p_out->ids[n++] = a[i];
+    }
+
+    p_out->num_ids = n;
+
+    return 0;
+}
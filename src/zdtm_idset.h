@@ -0,0 +1,170 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+
+/**
+ * @file zdtm_idset.h
+ * @brief This is a specifications file for sorted sync ID sets.
+ *
+ * The zdtm_idset.h file is a specifications file for sets of sync IDs
+ * kept as sorted arrays without duplicates. A set is built from a sync
+ * ID list, such as those obtained with zdtm_obtain_sync_id_lists(), or
+ * from the listing of every item on the Zaurus, and is then combined
+ * with other sets to work out which items to obtain from, write to, or
+ * delete from either side of a synchronization.
+ */
+
+#ifndef ZDTM_IDSET_H
+#define ZDTM_IDSET_H
+
+#include "zdtm_export.h"
+#include "zdtm_types.h"
+
+/**
+ * Sync ID set.
+ *
+ * The zdtm_id_set is a structure which represents a set of sync IDs.
+ * The ids member holds the num_ids sync IDs of the set in increasing
+ * order, and may be read directly. A set is initialized with
+ * zdtm_id_set_init() and its memory is released with
+ * zdtm_id_set_free(). The functions storing a set in a zdtm_id_set
+ * reuse its memory when it is large enough.
+ */
+typedef struct zdtm_id_set {
+    uint32_t *ids;      // sync ids of the set, in increasing order
+    uint32_t num_ids;   // number of sync ids in the set
+    uint32_t max_ids;   // number of sync ids ids has room for
+} zdtm_id_set;
+
+/**
+ * Initialize sync ID set.
+ *
+ * The zdtm_id_set_init function initializes a sync ID set to the empty
+ * set, without allocating any memory.
+ * @param p_set Pointer to the set to initialize.
+ */
+ZDTM_EXPORT void zdtm_id_set_init(zdtm_id_set *p_set);
+
+/**
+ * Free sync ID set.
+ *
+ * The zdtm_id_set_free function releases the memory of a sync ID set,
+ * leaving it the empty set.
+ * @param p_set Pointer to the set to free.
+ */
+ZDTM_EXPORT void zdtm_id_set_free(zdtm_id_set *p_set);
+
+/**
+ * Build sync ID set from a list.
+ *
+ * The zdtm_id_set_from_ids function stores the set of the sync IDs of
+ * the given list in p_set. The list need not be sorted and may hold
+ * duplicates. It is sorted with a radix sort, which only makes the
+ * passes over the bytes that differ between the sync IDs.
+ * @param p_set Pointer to the set to store the result in.
+ * @param p_ids Pointer to the sync ids of the list.
+ * @param num_ids The number of sync ids in the list.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully built the set.
+ * @retval -1 Failed to allocate memory for the set.
+ */
+ZDTM_EXPORT int zdtm_id_set_from_ids(zdtm_id_set *p_set,
+    const uint32_t *p_ids, uint32_t num_ids);
+
+/**
+ * Build sync ID set from the item listing.
+ *
+ * The zdtm_id_set_from_listing function obtains the listing of every
+ * item of the current synchronization type on the Zaurus with an RLR
+ * message, regardless of the synchronization state, and stores the set
+ * of their sync IDs in p_set.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param p_set Pointer to the set to store the result in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully built the set.
+ * @retval -1 Failed to allocate memory for the set.
+ * @retval -2 Failed to obtain the item listing from the Zaurus.
+ */
+ZDTM_EXPORT int zdtm_id_set_from_listing(zdtm_lib_env *cur_env,
+    zdtm_id_set *p_set);
+
+/**
+ * Check sync ID set membership.
+ *
+ * The zdtm_id_set_contains function checks if a sync ID is in a set.
+ * @param p_set Pointer to the set to look in.
+ * @param sync_id The sync id to look for.
+ * @return An integer representing the result.
+ * @retval 1 The sync id is in the set.
+ * @retval 0 The sync id is NOT in the set.
+ */
+ZDTM_EXPORT int zdtm_id_set_contains(const zdtm_id_set *p_set,
+    uint32_t sync_id);
+
+/**
+ * Union of sync ID sets.
+ *
+ * The zdtm_id_set_union function stores the sync IDs which are in
+ * either p_a or p_b in p_out, which must be neither of them.
+ * @param p_out Pointer to the set to store the result in.
+ * @param p_a Pointer to the first set.
+ * @param p_b Pointer to the second set.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully computed the union.
+ * @retval -1 Failed to allocate memory for the result.
+ */
+ZDTM_EXPORT int zdtm_id_set_union(zdtm_id_set *p_out,
+    const zdtm_id_set *p_a, const zdtm_id_set *p_b);
+
+/**
+ * Intersection of sync ID sets.
+ *
+ * The zdtm_id_set_intersect function stores the sync IDs which are in
+ * both p_a and p_b in p_out, which must be neither of them.
+ * @param p_out Pointer to the set to store the result in.
+ * @param p_a Pointer to the first set.
+ * @param p_b Pointer to the second set.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully computed the intersection.
+ * @retval -1 Failed to allocate memory for the result.
+ */
+ZDTM_EXPORT int zdtm_id_set_intersect(zdtm_id_set *p_out,
+    const zdtm_id_set *p_a, const zdtm_id_set *p_b);
+
+/**
+ * Difference of sync ID sets.
+ *
+ * The zdtm_id_set_difference function stores the sync IDs which are in
+ * p_a but not in p_b in p_out, which must be neither of them. For
+ * example the difference of the listing of the Zaurus and the set held
+ * by the Desktop is the set of items to obtain, and the other way
+ * around it is the set of items to write or to delete.
+ * @param p_out Pointer to the set to store the result in.
+ * @param p_a Pointer to the set to take sync ids from.
+ * @param p_b Pointer to the set of sync ids to leave out.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully computed the difference.
+ * @retval -1 Failed to allocate memory for the result.
+ */
+ZDTM_EXPORT int zdtm_id_set_difference(zdtm_id_set *p_out,
+    const zdtm_id_set *p_a, const zdtm_id_set *p_b);
+
+#endif
@@ -0,0 +1,457 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+/**
+ * @file zdtm_iter.c
+ * @brief This is an implementation file for the item iterator.
+ *
+ * The zdtm_iter.c file is an implementation of the item iterator which
+ * walks the sync ID lists obtained from the Zaurus and yields decoded
+ * items. When the library is built with pthreads support the items are
+ * obtained and decoded on a worker thread which stays up to read_ahead
+ * items ahead of the consumer. Otherwise each item is obtained when it
+ * is asked for.
+ */
+
+#include "zdtm_iter.h"
+#include "zdtm_sync.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+struct zdtm_item_iterator {
+    zdtm_lib_env *cur_env;      // environment the items are fetched with
+    uint32_t *sync_ids[3];      // new, mod, and del sync id lists
+    uint16_t num_sync_ids[3];   // number of ids in each of the lists
+    int cur_list;               // list of the next id to fetch
+    int cur_index;              // index of the next id to fetch
+    struct zdtm_item *slots;    // ring of decoded items
+    unsigned int num_slots;     // capacity of the ring of decoded items
+    unsigned int head;          // index of the oldest decoded item
+    unsigned int count;         // number of decoded items in the ring
+    int done;                   // flag stating all ids have been fetched
+    int error;                  // error that stopped the fetching
+    int cancel;                 // flag asking the worker to stop
+#ifdef HAVE_PTHREAD_H
+    pthread_t worker;           // thread fetching and decoding the items
+    pthread_mutex_t lock;       // protects the ring and the flags
+    pthread_cond_t not_empty;   // signaled when an item is decoded
+    pthread_cond_t not_full;    // signaled when an item is consumed
+#endif
+};
+
+/**
+ * Fetch the next item.
+ *
+ * The _zdtm_iter_fetch function advances the iterator to the next sync
+ * ID and obtains and decodes the associated item. Items from the
+ * deleted list are not obtained from the Zaurus as they no longer exist
+ * there. Note: Only the thread which owns the current environment may
+ * call this function.
+ * @param p_iter Pointer to the item iterator.
+ * @param p_item Pointer to zdtm_item structure to store the item in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully fetched the next item.
+ * @retval 1 There are no more items to fetch.
+ * @retval -1 Failed, the current sync type is not a recognized type.
+ * @retval -2 Failed to obtain item data from the Zaurus.
+ * @retval -3 Failed to build the item struct from the item data.
+ */
+static int _zdtm_iter_fetch(zdtm_item_iter *p_iter, struct zdtm_item *p_item) {
+    int r;
+    zdtm_lib_env *cur_env;
+    struct zdtm_adr_msg_param *params;
+    uint16_t num_params;
+
+    cur_env = p_iter->cur_env;
+
+    while ((p_iter->cur_list <= ZDTM_ITEM_DEL) &&
+           (p_iter->cur_index >= p_iter->num_sync_ids[p_iter->cur_list])) {
+        p_iter->cur_list++;
+        p_iter->cur_index = 0;
+    }
+
+    if (p_iter->cur_list > ZDTM_ITEM_DEL) {
+        return 1;
+    }
+
+    memset(p_item, 0, sizeof(struct zdtm_item));
+    p_item->list = p_iter->cur_list;
+    p_item->sync_id = p_iter->sync_ids[p_iter->cur_list][p_iter->cur_index];
+    p_item->sync_type = cur_env->sync_type;
+    p_iter->cur_index++;
+
+    if (p_item->list == ZDTM_ITEM_DEL) {
+        return 0;
+    }
+
+    if ((cur_env->sync_type != SYNC_TYPE_TODO) &&
+        (cur_env->sync_type != SYNC_TYPE_CALENDAR) &&
+        (cur_env->sync_type != SYNC_TYPE_ADDRESS)) {
+        return -1;
+    }
+
+    r = _zdtm_obtain_item(cur_env, p_item->sync_id, &params, &num_params);
+    if (r != 0) {
+        return -2;
+    }
+
+    if (cur_env->sync_type == SYNC_TYPE_TODO) {
+        r = _zdtm_parse_todo_item_params(cur_env->params, cur_env->num_params,
+            params, num_params, &p_item->cont.todo);
+    } else if (cur_env->sync_type == SYNC_TYPE_CALENDAR) {
+        r = _zdtm_parse_calendar_item_params(cur_env->params,
+            cur_env->num_params, params, num_params, &p_item->cont.calendar);
+    } else {
+        r = _zdtm_parse_address_item_params(cur_env->params,
+            cur_env->num_params, params, num_params, &p_item->cont.address);
+    }
+
+    _zdtm_free_params(cur_env, params, num_params);
+
+    if (r != 0) {
+        zdtm_clean_item(p_item);
+        return -3;
+    }
+
+    return 0;
+}
+
+#ifdef HAVE_PTHREAD_H
+/**
+ * Item iterator worker.
+ *
+ * The _zdtm_iter_worker function is the body of the worker thread. It
+ * fetches items into the ring of decoded items until either all the
+ * sync IDs have been fetched, a fetch fails, or the iterator is being
+ * closed. It blocks whenever the ring is full.
+ * @param arg Pointer to the item iterator.
+ * @return Always returns NULL.
+ */
+static void *_zdtm_iter_worker(void *arg) {
+    int r;
+    zdtm_item_iter *p_iter;
+    struct zdtm_item item;
+
+    p_iter = (zdtm_item_iter *)arg;
+
+    pthread_mutex_lock(&p_iter->lock);
+    while (!p_iter->cancel) {
+        while ((p_iter->count == p_iter->num_slots) && !p_iter->cancel) {
+            pthread_cond_wait(&p_iter->not_full, &p_iter->lock);
+        }
+        if (p_iter->cancel) {
+            break;
+        }
+
+        /* The worker is the only one adding to the ring, hence the slot
+         * stays free while the lock is released for the network I/O. */
+        pthread_mutex_unlock(&p_iter->lock);
+        r = _zdtm_iter_fetch(p_iter, &item);
+        pthread_mutex_lock(&p_iter->lock);
+
+        if (r != 0) {
+            if (r < 0) { p_iter->error = r; }
+            break;
+        }
+
+        p_iter->slots[(p_iter->head + p_iter->count) % p_iter->num_slots] =
+            item;
+        p_iter->count++;
+        pthread_cond_signal(&p_iter->not_empty);
+    }
+    p_iter->done = 1;
+    pthread_cond_broadcast(&p_iter->not_empty);
+    pthread_mutex_unlock(&p_iter->lock);
+
+    return NULL;
+}
+#endif
+
+int zdtm_item_iter_open(zdtm_lib_env *cur_env, unsigned int read_ahead,
+    zdtm_item_iter **pp_iter) {
+
+    int r;
+    zdtm_item_iter *p_iter;
+
+    if (read_ahead == 0) {
+        read_ahead = ZDTM_ITER_DEF_READ_AHEAD;
+    }
+
+    p_iter = malloc(sizeof(zdtm_item_iter));
+    if (p_iter == NULL) {
+        return -2;
+    }
+    memset(p_iter, 0, sizeof(zdtm_item_iter));
+
+    p_iter->slots = malloc(sizeof(struct zdtm_item) * read_ahead);
+    if (p_iter->slots == NULL) {
+        free(p_iter);
+        return -2;
+    }
+    p_iter->num_slots = read_ahead;
+
+    r = zdtm_obtain_sync_id_lists(cur_env,
+        &p_iter->sync_ids[ZDTM_ITEM_NEW], &p_iter->num_sync_ids[ZDTM_ITEM_NEW],
+        &p_iter->sync_ids[ZDTM_ITEM_MOD], &p_iter->num_sync_ids[ZDTM_ITEM_MOD],
+        &p_iter->sync_ids[ZDTM_ITEM_DEL], &p_iter->num_sync_ids[ZDTM_ITEM_DEL]);
+    if (r != 0) {
+        free(p_iter->slots);
+        free(p_iter);
+        return -1;
+    }
+
+    p_iter->cur_env = cur_env;
+    p_iter->cur_list = ZDTM_ITEM_NEW;
+    p_iter->cur_index = 0;
+
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_init(&p_iter->lock, NULL);
+    pthread_cond_init(&p_iter->not_empty, NULL);
+    pthread_cond_init(&p_iter->not_full, NULL);
+
+    r = pthread_create(&p_iter->worker, NULL, _zdtm_iter_worker, p_iter);
+    if (r != 0) {
+        pthread_cond_destroy(&p_iter->not_full);
+        pthread_cond_destroy(&p_iter->not_empty);
+        pthread_mutex_destroy(&p_iter->lock);
+        free(p_iter->sync_ids[ZDTM_ITEM_NEW]);
+        free(p_iter->sync_ids[ZDTM_ITEM_MOD]);
+        free(p_iter->sync_ids[ZDTM_ITEM_DEL]);
+        free(p_iter->slots);
+        free(p_iter);
+        return -3;
+    }
+#endif
+
+    (*pp_iter) = p_iter;
+
+    return 0;
+}
+
+int zdtm_item_iter_next(zdtm_item_iter *p_iter, struct zdtm_item *p_item) {
+    int r;
+
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&p_iter->lock);
+    while ((p_iter->count == 0) && !p_iter->done) {
+        pthread_cond_wait(&p_iter->not_empty, &p_iter->lock);
+    }
+
+    if (p_iter->count > 0) {
+        (*p_item) = p_iter->slots[p_iter->head];
+        p_iter->head = (p_iter->head + 1) % p_iter->num_slots;
+        p_iter->count--;
+        pthread_cond_signal(&p_iter->not_full);
+        r = 0;
+    } else if (p_iter->error != 0) {
+        r = p_iter->error;
+    } else {
+        r = 1;
+    }
+    pthread_mutex_unlock(&p_iter->lock);
+#else
+    if (p_iter->done) {
+        return (p_iter->error != 0) ? p_iter->error : 1;
+    }
+
+    r = _zdtm_iter_fetch(p_iter, p_item);
+    if (r != 0) {
+        p_iter->done = 1;
+        if (r < 0) { p_iter->error = r; }
+    }
+#endif
+
+    if (r == 0) {
+        if (_zdtm_share_item_category(p_iter->cur_env, p_item) != 0) {
+            zdtm_clean_item(p_item);
+            return -4;
+        }
+    }
+
+    return r;
+}
+
+int zdtm_item_iter_close(zdtm_item_iter *p_iter) {
+    if (p_iter == NULL) {
+        return -1;
+    }
+
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&p_iter->lock);
+    p_iter->cancel = 1;
+    pthread_cond_broadcast(&p_iter->not_full);
+    pthread_mutex_unlock(&p_iter->lock);
+
+    pthread_join(p_iter->worker, NULL);
+
+    pthread_cond_destroy(&p_iter->not_full);
+    pthread_cond_destroy(&p_iter->not_empty);
+    pthread_mutex_destroy(&p_iter->lock);
+#endif
+
+    /* Free the items which were decoded ahead but never consumed. */
+    while (p_iter->count > 0) {
+        zdtm_clean_item(&p_iter->slots[p_iter->head]);
+        p_iter->head = (p_iter->head + 1) % p_iter->num_slots;
+        p_iter->count--;
+    }
+
+    free(p_iter->sync_ids[ZDTM_ITEM_NEW]);
+    free(p_iter->sync_ids[ZDTM_ITEM_MOD]);
+    free(p_iter->sync_ids[ZDTM_ITEM_DEL]);
+    free(p_iter->slots);
+    free(p_iter);
+
+    return 0;
+}
+
+int _zdtm_share_item_category(zdtm_lib_env *cur_env,
+    struct zdtm_item *p_item) {
+
+    int r;
+
+    if (p_item->list == ZDTM_ITEM_DEL) {
+        return 0;
+    }
+
+    if (p_item->sync_type == SYNC_TYPE_TODO) {
+        r = _zdtm_intern_category(cur_env, &p_item->cont.todo.category,
+            p_item->cont.todo.category_len, &p_item->cont.todo.category_id, 1);
+    } else if (p_item->sync_type == SYNC_TYPE_CALENDAR) {
+        r = _zdtm_intern_category(cur_env, &p_item->cont.calendar.category,
+            p_item->cont.calendar.category_len,
+            &p_item->cont.calendar.category_id, 1);
+    } else if (p_item->sync_type == SYNC_TYPE_ADDRESS) {
+        r = _zdtm_intern_category(cur_env, &p_item->cont.address.category,
+            p_item->cont.address.category_len,
+            &p_item->cont.address.category_id, 1);
+    } else {
+        return -1;
+    }
+    if (r != 0) {
+        return -2;
+    }
+
+    p_item->shared_category = 1;
+
+    return 0;
+}
+
+int zdtm_clean_item(struct zdtm_item *p_item) {
+    unsigned int i, first;
+    char **todo_strs[] = {
+        &p_item->cont.todo.category,
+        &p_item->cont.todo.description,
+        &p_item->cont.todo.notes
+    };
+    char **calendar_strs[] = {
+        &p_item->cont.calendar.category,
+        &p_item->cont.calendar.description,
+        &p_item->cont.calendar.location,
+        &p_item->cont.calendar.notes
+    };
+    char **address_strs[] = {
+        &p_item->cont.address.category,
+        &p_item->cont.address.full_name,
+        &p_item->cont.address.full_name_pronun,
+        &p_item->cont.address.title,
+        &p_item->cont.address.last_name,
+        &p_item->cont.address.first_name,
+        &p_item->cont.address.middle_name,
+        &p_item->cont.address.suffix,
+        &p_item->cont.address.alternative_name,
+        &p_item->cont.address.last_name_pronun,
+        &p_item->cont.address.first_name_pronun,
+        &p_item->cont.address.company,
+        &p_item->cont.address.company_pronun,
+        &p_item->cont.address.department,
+        &p_item->cont.address.job_title,
+        &p_item->cont.address.work_phone,
+        &p_item->cont.address.work_fax,
+        &p_item->cont.address.work_mobile,
+        &p_item->cont.address.work_state,
+        &p_item->cont.address.work_city,
+        &p_item->cont.address.work_street,
+        &p_item->cont.address.work_zip,
+        &p_item->cont.address.work_country,
+        &p_item->cont.address.work_web_page,
+        &p_item->cont.address.office,
+        &p_item->cont.address.profession,
+        &p_item->cont.address.assistant,
+        &p_item->cont.address.manager,
+        &p_item->cont.address.pager,
+        &p_item->cont.address.cellular,
+        &p_item->cont.address.home_phone,
+        &p_item->cont.address.home_fax,
+        &p_item->cont.address.home_state,
+        &p_item->cont.address.home_city,
+        &p_item->cont.address.home_street,
+        &p_item->cont.address.home_zip,
+        &p_item->cont.address.home_country,
+        &p_item->cont.address.home_web_page,
+        &p_item->cont.address.default_email,
+        &p_item->cont.address.emails,
+        &p_item->cont.address.spouse,
+        &p_item->cont.address.gender,
+        &p_item->cont.address.birthday,
+        &p_item->cont.address.anniversary,
+        &p_item->cont.address.nickname,
+        &p_item->cont.address.children,
+        &p_item->cont.address.memo,
+        &p_item->cont.address.group
+    };
+
+    /* Items from the deleted list never have any content to free. */
+    if (p_item->list == ZDTM_ITEM_DEL) {
+        return 0;
+    }
+
+    /* A shared category, the first of the strings, belongs to the
+     * category table of the session rather than to the item. */
+    first = p_item->shared_category ? 1 : 0;
+
+    if (p_item->sync_type == SYNC_TYPE_TODO) {
+        for (i = first; i < (sizeof(todo_strs) / sizeof(char **)); i++) {
+            if ((*todo_strs[i]) != NULL) { free(*todo_strs[i]); }
+        }
+        memset(&p_item->cont.todo, 0, sizeof(struct zdtm_todo_item));
+    } else if (p_item->sync_type == SYNC_TYPE_CALENDAR) {
+        for (i = first; i < (sizeof(calendar_strs) / sizeof(char **)); i++) {
+            if ((*calendar_strs[i]) != NULL) { free(*calendar_strs[i]); }
+        }
+        memset(&p_item->cont.calendar, 0, sizeof(struct zdtm_calendar_item));
+    } else if (p_item->sync_type == SYNC_TYPE_ADDRESS) {
+        for (i = first; i < (sizeof(address_strs) / sizeof(char **)); i++) {
+            if ((*address_strs[i]) != NULL) { free(*address_strs[i]); }
+        }
+        memset(&p_item->cont.address, 0, sizeof(struct zdtm_address_item));
+    } else {
+        return -1;
+    }
+    p_item->shared_category = 0;
+
+    return 0;
+}
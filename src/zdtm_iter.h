@@ -0,0 +1,181 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+/**
+ * @file zdtm_iter.h
+ * @brief This is a specifications file for the item iterator.
+ *
+ * The zdtm_iter.h file is a specifications file for the item iterator
+ * which walks the new, modified, and deleted sync ID lists obtained
+ * from the Zaurus and yields the decoded items. The items are fetched
+ * and decoded on a worker thread ahead of the consumer so that the
+ * consumers own processing overlaps with the network I/O.
+ */
+
+#ifndef ZDTM_ITER_H
+#define ZDTM_ITER_H
+
+#include "zdtm_export.h"
+#include "zdtm_types.h"
+#include "zdtm_common.h"
+
+// Identifiers of the sync ID list an item was obtained from.
+#define ZDTM_ITEM_NEW 0
+#define ZDTM_ITEM_MOD 1
+#define ZDTM_ITEM_DEL 2
+
+// The default number of items decoded ahead of the consumer.
+#define ZDTM_ITER_DEF_READ_AHEAD 8
+
+/**
+ * Zaurus item.
+ *
+ * The zdtm_item is a structure which represents a single item yielded
+ * by the item iterator. The list member identifies which sync ID list
+ * the item came from. Items from the deleted list only have the list,
+ * sync_id, and sync_type members set because deleted items can no
+ * longer be obtained from the Zaurus. The content union member which
+ * is valid is determined by the sync_type member. The shared_category
+ * member states that the category of the content points at the payload
+ * held by the category table of the session rather than at a copy
+ * owned by the item.
+ */
+struct zdtm_item {
+    int list;                   // list the item came from (ZDTM_ITEM_*)
+    uint32_t sync_id;           // sync id of the item
+    unsigned char sync_type;    // sync type of the item content
+    int shared_category;        // flag stating category is table owned
+    union {
+        struct zdtm_todo_item todo;
+        struct zdtm_calendar_item calendar;
+        struct zdtm_address_item address;
+    } cont;
+};
+
+/**
+ * Zaurus item iterator.
+ *
+ * The zdtm_item_iter is a type defined to represent the state of a walk
+ * over the sync ID lists of the current synchronization. Its members
+ * depend on the threading support the library was built with, hence it
+ * is only ever handled through a pointer obtained from
+ * zdtm_item_iter_open().
+ */
+typedef struct zdtm_item_iterator zdtm_item_iter;
+
+/**
+ * Open an item iterator.
+ *
+ * The zdtm_item_iter_open function obtains the sync ID lists from the
+ * Zaurus and starts walking them, fetching and decoding up to
+ * read_ahead items ahead of the consumer on a worker thread. Note:
+ * While the iterator is open the worker thread owns the current
+ * environment, hence no other lib_zdtm_sync function but
+ * zdtm_lookup_category() may be called on it until
+ * zdtm_item_iter_close() has been called.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param read_ahead Max number of decoded items to buffer (0 = default).
+ * @param pp_iter Pointer to a pointer to store the new iterator in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully opened the item iterator.
+ * @retval -1 Failed to obtain the sync ID lists.
+ * @retval -2 Failed to allocate memory for the iterator.
+ * @retval -3 Failed to start the worker thread.
+ */
+ZDTM_EXPORT int zdtm_item_iter_open(zdtm_lib_env *cur_env,
+    unsigned int read_ahead, zdtm_item_iter **pp_iter);
+
+/**
+ * Obtain the next item.
+ *
+ * The zdtm_item_iter_next function obtains the next item from the
+ * iterator, blocking until the worker thread has decoded it. Items
+ * from the new list are yielded first, followed by the items from the
+ * modified list and the deleted list. On success the item is copied
+ * into the structure pointed to by p_item and the caller owns its
+ * dynamically allocated members, which can be freed with the
+ * zdtm_clean_item() function. Items yielded by the iterator always
+ * share their categories, see zdtm_set_category_sharing(), hence their
+ * category must neither be changed nor freed, and it is valid until
+ * zdtm_finalize() is called. The categories are interned on the
+ * calling thread, so zdtm_lookup_category() may be called on the
+ * current environment in between calls to this function.
+ * @param p_iter Pointer to the item iterator.
+ * @param p_item Pointer to zdtm_item structure to store the item in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully obtained the next item.
+ * @retval 1 There are no more items.
+ * @retval -1 Failed, the current sync type is not a recognized type.
+ * @retval -2 Failed to obtain item data from the Zaurus.
+ * @retval -3 Failed to build the item struct from the item data.
+ * @retval -4 Failed to intern the category of the item.
+ */
+ZDTM_EXPORT int zdtm_item_iter_next(zdtm_item_iter *p_iter,
+    struct zdtm_item *p_item);
+
+/**
+ * Close an item iterator.
+ *
+ * The zdtm_item_iter_close function stops the worker thread, waiting
+ * for any item it is currently fetching to complete so that the
+ * protocol is left in a consistent state, and frees the iterator along
+ * with any decoded items which were not consumed.
+ * @param p_iter Pointer to the item iterator.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully closed the item iterator.
+ * @retval -1 Failed, p_iter is NULL.
+ */
+ZDTM_EXPORT int zdtm_item_iter_close(zdtm_item_iter *p_iter);
+
+/**
+ * Share item category.
+ *
+ * The _zdtm_share_item_category function interns the category of an
+ * item in the category table of the session and points the item at the
+ * payload held by the table, setting its shared_category member. It is
+ * only ever called on the thread handing the item to the caller, the
+ * worker thread of an iterator never touches the category table, hence
+ * it needs no locking.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param p_item Pointer to the zdtm_item structure to share category of.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully shared the category of the item.
+ * @retval -1 Failed, the sync type of the item is not recognized.
+ * @retval -2 Failed to intern the category of the item.
+ */
+int _zdtm_share_item_category(zdtm_lib_env *cur_env,
+    struct zdtm_item *p_item);
+
+/**
+ * Clean Item
+ *
+ * The zdtm_clean_item function frees all the dynamically allocated
+ * members of an item obtained from the item iterator based on its sync
+ * type and resets the item content. A shared category is left to the
+ * category table of the session.
+ * @param p_item Pointer to zdtm_item structure to free members of.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully freed the members of the item.
+ * @retval -1 Failed, the sync type of the item is not recognized.
+ */
+ZDTM_EXPORT int zdtm_clean_item(struct zdtm_item *p_item);
+
+#endif
@@ -0,0 +1,746 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+/**
+ * @file zdtm_journal.c
+ * @brief This is an implementation file for the sync checkpoint journal.
+ *
+ * The zdtm_journal.c file is an implementation of the checkpoint
+ * journal, an append-only file of the progress of a synchronization
+ * which is replayed into memory when it is opened.
+ */
+
+#include "zdtm_journal.h"
+#include "zdtm_steps.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+// Types of the journal records, besides the item states.
+#define ZDTM_JOURNAL_BEGIN 0x10
+#define ZDTM_JOURNAL_ANCHOR 0x11
+#define ZDTM_JOURNAL_LISTS 0x12
+
+// Sizes of the parts of a journal record.
+#define ZDTM_JOURNAL_REC_HDR_SIZE 8
+#define ZDTM_JOURNAL_BEGIN_SIZE 12
+#define ZDTM_JOURNAL_LISTS_SIZE 8
+
+// Largest journal file, keeping every size within 32 bits.
+#define ZDTM_JOURNAL_MAX_SIZE 0x7fffffff
+
+// Initial number of slots of the item table, always a power of two.
+#define ZDTM_JOURNAL_MIN_SLOTS 64
+
+/**
+ * Checkpoint journal.
+ *
+ * The zdtm_journal_store is a structure which represents an opened
+ * checkpoint journal, holding what its file records. The items are
+ * kept in an open addressing hash table, a slot whose state is zero
+ * being empty. The buf member is scratch space for building and
+ * reading records which only ever grows.
+ */
+struct zdtm_journal_store {
+    FILE *fp;                       // journal file
+    uint32_t size;                  // size of the journal file
+    int resumed;                    // flag stating the sync was resumed
+    int have_begin;                 // flag stating a sync is recorded
+    unsigned char sync_type;        // sync type of the recorded sync
+    unsigned char auth_state;       // auth state of the Zaurus
+    unsigned char slow_flags[3];    // todo, calendar, address slow flags
+    char model[256];                // model of the Zaurus
+    uint64_t anchor;                // time of the ATG message
+    int have_set_anchor;            // flag stating an anchor was set
+    uint64_t set_anchor;            // time set as the last time synced
+    int have_lists;                 // flag stating lists are recorded
+    uint32_t *lists[3];             // new, mod and del lists
+    uint16_t num_lists[3];          // number of IDs in each list
+    uint32_t *item_ids;             // sync ids of the item table
+    unsigned char *item_states;     // states of the item table
+    uint32_t capacity;              // number of slots of the item table
+    uint32_t count;                 // number of items in the item table
+    unsigned char *buf;             // record scratch space
+    uint32_t buf_size;              // size of buf
+};
+
+/**
+ * Reserve scratch space.
+ *
+ * The _zdtm_journal_reserve function makes sure the scratch buffer of a
+ * journal holds at least size bytes.
+ * @param p_journal Pointer to the journal.
+ * @param size The number of bytes required.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully reserved the space.
+ * @retval -1 Failed to allocate memory for the space.
+ */
+static int _zdtm_journal_reserve(zdtm_journal *p_journal, uint32_t size) {
+    unsigned char *buf;
+
+    if (size <= p_journal->buf_size) {
+        return 0;
+    }
+
+    buf = realloc(p_journal->buf, size);
+    if (buf == NULL) {
+        return -1;
+    }
+    p_journal->buf = buf;
+    p_journal->buf_size = size;
+
+    return 0;
+}
+
+/**
+ * Find item slot.
+ *
+ * The _zdtm_journal_slot function finds the slot of the item table
+ * holding the item with the given sync id by linear probing, or the
+ * empty slot it would be stored in.
+ * @param p_journal Pointer to the journal, whose item table is not full.
+ * @param sync_id The sync id of the item.
+ * @return The index of the slot.
+ */
+static uint32_t _zdtm_journal_slot(zdtm_journal *p_journal,
+    uint32_t sync_id) {
+
+    uint32_t i, mask;
+
+    mask = p_journal->capacity - 1;
+    i = (sync_id * 2654435761U) & mask;
+    while ((p_journal->item_states[i] != 0) &&
+        (p_journal->item_ids[i] != sync_id)) {
+        i = (i + 1) & mask;
+    }
+
+    return i;
+}
+
+/**
+ * Store item state.
+ *
+ * The _zdtm_journal_store_item function stores the state of an item in
+ * the item table, growing the table first if it would become more than
+ * three quarters full.
+ * @param p_journal Pointer to the journal.
+ * @param state The state of the item.
+ * @param sync_id The sync id of the item.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully stored the item state.
+ * @retval -1 Failed to allocate memory for the item table.
+ */
+static int _zdtm_journal_store_item(zdtm_journal *p_journal, int state,
+    uint32_t sync_id) {
+
+    uint32_t *old_ids;
+    unsigned char *old_states;
+    uint32_t i, old_capacity, slot;
+
+    if (((p_journal->count + 1) * 4) > (p_journal->capacity * 3)) {
+        old_ids = p_journal->item_ids;
+        old_states = p_journal->item_states;
+        old_capacity = p_journal->capacity;
+
+        p_journal->capacity = (old_capacity == 0) ? ZDTM_JOURNAL_MIN_SLOTS :
+            (old_capacity * 2);
+        p_journal->item_ids = malloc(sizeof(uint32_t) * p_journal->capacity);
+        p_journal->item_states = calloc(p_journal->capacity, 1);
+        if ((p_journal->item_ids == NULL) ||
+            (p_journal->item_states == NULL)) {
+            free(p_journal->item_ids);
+            free(p_journal->item_states);
+            p_journal->item_ids = old_ids;
+            p_journal->item_states = old_states;
+            p_journal->capacity = old_capacity;
+            return -1;
+        }
+
+        for (i = 0; i < old_capacity; i++) {
+            if (old_states[i] != 0) {
+                slot = _zdtm_journal_slot(p_journal, old_ids[i]);
+                p_journal->item_ids[slot] = old_ids[i];
+                p_journal->item_states[slot] = old_states[i];
+            }
+        }
+        free(old_ids);
+        free(old_states);
+    }
+
+    slot = _zdtm_journal_slot(p_journal, sync_id);
+    if (p_journal->item_states[slot] == 0) {
+        p_journal->count++;
+    }
+    p_journal->item_ids[slot] = sync_id;
+    p_journal->item_states[slot] = (unsigned char)state;
+
+    return 0;
+}
+
+/**
+ * Forget recorded synchronization.
+ *
+ * The _zdtm_journal_forget function drops everything the journal holds
+ * in memory about the recorded synchronization.
+ * @param p_journal Pointer to the journal.
+ */
+static void _zdtm_journal_forget(zdtm_journal *p_journal) {
+    int i;
+
+    p_journal->resumed = 0;
+    p_journal->have_begin = 0;
+    p_journal->have_set_anchor = 0;
+    p_journal->have_lists = 0;
+    for (i = ZDTM_NEW_IDS; i <= ZDTM_DEL_IDS; i++) {
+        if (p_journal->lists[i] != NULL) {
+            free(p_journal->lists[i]);
+            p_journal->lists[i] = NULL;
+        }
+        p_journal->num_lists[i] = 0;
+    }
+    if (p_journal->item_states != NULL) {
+        memset(p_journal->item_states, 0, p_journal->capacity);
+    }
+    p_journal->count = 0;
+}
+
+/**
+ * Cut journal file.
+ *
+ * The _zdtm_journal_cut function cuts the journal file off at the
+ * given size.
+ * @param p_journal Pointer to the journal.
+ * @param size The size to cut the journal file off at.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully cut the journal file.
+ * @retval -1 Failed to cut the journal file.
+ */
+static int _zdtm_journal_cut(zdtm_journal *p_journal, uint32_t size) {
+#ifdef HAVE_UNISTD_H
+    if ((fflush(p_journal->fp) != 0) ||
+        (ftruncate(fileno(p_journal->fp), size) != 0)) {
+        return -1;
+    }
+    p_journal->size = size;
+
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+/**
+ * Append journal record.
+ *
+ * The _zdtm_journal_append function appends a record, whose data was
+ * built in the scratch buffer of a journal following the room left for
+ * its header, to the journal file. A partially written record is cut
+ * off again where possible, otherwise it is discarded the next time the
+ * journal is opened.
+ * @param p_journal Pointer to the journal.
+ * @param type The type of the record.
+ * @param data_size The size of the data of the record.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully appended the record.
+ * @retval -2 Failed to write the record.
+ */
+static int _zdtm_journal_append(zdtm_journal *p_journal, unsigned char type,
+    uint32_t data_size) {
+
+    unsigned char *p;
+    uint32_t size;
+
+    size = ZDTM_JOURNAL_REC_HDR_SIZE + data_size;
+    if ((size > (ZDTM_JOURNAL_MAX_SIZE - p_journal->size)) ||
+        (fseek(p_journal->fp, 0, SEEK_END) != 0)) {
+        return -2;
+    }
+
+    p = p_journal->buf;
+    p[0] = type;
+    p[1] = p_journal->sync_type;
+    p[2] = 0x00;
+    p[3] = 0x00;
+    zdtm_put_le32(p + 4, data_size);
+
+    if ((fwrite(p_journal->buf, 1, size, p_journal->fp) != size) ||
+        (fflush(p_journal->fp) != 0)) {
+        _zdtm_journal_cut(p_journal, p_journal->size);
+        return -2;
+    }
+
+    p_journal->size += size;
+
+    return 0;
+}
+
+/**
+ * Apply journal record.
+ *
+ * The _zdtm_journal_apply function applies a record read from the
+ * journal file, whose data is in the scratch buffer of the journal, to
+ * what the journal holds in memory.
+ * @param p_journal Pointer to the journal.
+ * @param type The type of the record.
+ * @param sync_type The sync type of the record.
+ * @param size The size of the data of the record.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully applied the record.
+ * @retval 1 The record is malformed.
+ * @retval -1 Failed to allocate memory for the record.
+ */
+static int _zdtm_journal_apply(zdtm_journal *p_journal, unsigned char type,
+    unsigned char sync_type, uint32_t size) {
+
+    const unsigned char *p;
+    uint32_t len, num, off;
+    int i;
+
+    p = p_journal->buf;
+
+    if (type == ZDTM_JOURNAL_BEGIN) {
+        len = size - ZDTM_JOURNAL_BEGIN_SIZE;
+        if ((size < ZDTM_JOURNAL_BEGIN_SIZE) ||
+            (len >= sizeof(p_journal->model))) {
+            return 1;
+        }
+        _zdtm_journal_forget(p_journal);
+        p_journal->have_begin = 1;
+        p_journal->sync_type = sync_type;
+        p_journal->auth_state = p[0];
+        memcpy(p_journal->slow_flags, p + 1, 3);
+        p_journal->anchor = ((uint64_t)zdtm_get_le32(p + 8) << 32) |
+            zdtm_get_le32(p + 4);
+        memcpy(p_journal->model, p + ZDTM_JOURNAL_BEGIN_SIZE, len);
+        p_journal->model[len] = '\0';
+        return 0;
+    }
+
+    /* Every other record belongs to the synchronization begun last. */
+    if (!p_journal->have_begin) {
+        return 1;
+    }
+
+    if (type == ZDTM_JOURNAL_ANCHOR) {
+        if (size != 8) {
+            return 1;
+        }
+        p_journal->have_set_anchor = 1;
+        p_journal->set_anchor = ((uint64_t)zdtm_get_le32(p + 4) << 32) |
+            zdtm_get_le32(p);
+    } else if (type == ZDTM_JOURNAL_LISTS) {
+        if (size < ZDTM_JOURNAL_LISTS_SIZE) {
+            return 1;
+        }
+        num = 0;
+        for (i = ZDTM_NEW_IDS; i <= ZDTM_DEL_IDS; i++) {
+            num += p[i * 2] | (p[(i * 2) + 1] << 8);
+        }
+        if (size != (ZDTM_JOURNAL_LISTS_SIZE + (num * sizeof(uint32_t)))) {
+            return 1;
+        }
+        off = ZDTM_JOURNAL_LISTS_SIZE;
+        for (i = ZDTM_NEW_IDS; i <= ZDTM_DEL_IDS; i++) {
+            if (p_journal->lists[i] != NULL) {
+                free(p_journal->lists[i]);
+            }
+            p_journal->num_lists[i] = p[i * 2] | (p[(i * 2) + 1] << 8);
+            p_journal->lists[i] = malloc(sizeof(uint32_t) *
+                (p_journal->num_lists[i] + 1));
+            if (p_journal->lists[i] == NULL) {
+                return -1;
+            }
+            for (num = 0; num < p_journal->num_lists[i]; num++) {
+                p_journal->lists[i][num] = zdtm_get_le32(p + off);
+                off += sizeof(uint32_t);
+            }
+        }
+        p_journal->have_lists = 1;
+    } else if ((type == ZDTM_JOURNAL_OBTAINED) ||
+        (type == ZDTM_JOURNAL_DELETED)) {
+        if (size != sizeof(uint32_t)) {
+            return 1;
+        }
+        if (_zdtm_journal_store_item(p_journal, type,
+            zdtm_get_le32(p)) != 0) {
+            return -1;
+        }
+    } else {
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * Replay journal.
+ *
+ * The _zdtm_journal_replay function replays the records of the journal
+ * file into memory. A trailing record which is incomplete or malformed
+ * is cut off the journal file.
+ * @param p_journal Pointer to the journal.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully replayed the journal.
+ * @retval -1 Failed to read the journal file.
+ * @retval -2 Failed to allocate memory for a record.
+ * @retval -3 Failed to cut off an incomplete trailing record.
+ */
+static int _zdtm_journal_replay(zdtm_journal *p_journal) {
+    unsigned char hdr[ZDTM_JOURNAL_REC_HDR_SIZE];
+    uint32_t pos, size;
+    int r;
+
+    if (fseek(p_journal->fp, 0, SEEK_SET) != 0) {
+        return -1;
+    }
+
+    pos = 0;
+    while ((p_journal->size - pos) >= ZDTM_JOURNAL_REC_HDR_SIZE) {
+        if (fread(hdr, 1, sizeof(hdr), p_journal->fp) != sizeof(hdr)) {
+            return -1;
+        }
+
+        size = zdtm_get_le32(hdr + 4);
+        if (size > (p_journal->size - pos - ZDTM_JOURNAL_REC_HDR_SIZE)) {
+            break;
+        }
+        if (_zdtm_journal_reserve(p_journal, size) != 0) {
+            return -2;
+        }
+        if (fread(p_journal->buf, 1, size, p_journal->fp) != size) {
+            return -1;
+        }
+
+        r = _zdtm_journal_apply(p_journal, hdr[0], hdr[1], size);
+        if (r < 0) {
+            return -2;
+        } else if (r != 0) {
+            break;
+        }
+
+        pos += ZDTM_JOURNAL_REC_HDR_SIZE + size;
+    }
+
+    if (pos != p_journal->size) {
+        if (_zdtm_journal_cut(p_journal, pos) != 0) {
+            return -3;
+        }
+    }
+
+    return 0;
+}
+
+int zdtm_journal_open(const char *path, zdtm_journal **pp_journal) {
+    zdtm_journal *p_journal;
+    long size;
+
+    p_journal = malloc(sizeof(zdtm_journal));
+    if (p_journal == NULL) {
+        return -1;
+    }
+    memset(p_journal, 0, sizeof(zdtm_journal));
+
+    p_journal->fp = fopen(path, "a+b");
+    if (p_journal->fp == NULL) {
+        free(p_journal);
+        return -2;
+    }
+
+    if ((fseek(p_journal->fp, 0, SEEK_END) != 0) ||
+        ((size = ftell(p_journal->fp)) < 0) ||
+        ((unsigned long)size > ZDTM_JOURNAL_MAX_SIZE)) {
+        zdtm_journal_close(p_journal);
+        return -2;
+    }
+    p_journal->size = (uint32_t)size;
+
+    if (_zdtm_journal_replay(p_journal) != 0) {
+        zdtm_journal_close(p_journal);
+        return -3;
+    }
+
+    (*pp_journal) = p_journal;
+
+    return 0;
+}
+
+int zdtm_journal_close(zdtm_journal *p_journal) {
+    if (p_journal == NULL) {
+        return -1;
+    }
+
+    if (p_journal->fp != NULL) {
+        fclose(p_journal->fp);
+    }
+
+    _zdtm_journal_forget(p_journal);
+    if (p_journal->item_ids != NULL) {
+        free(p_journal->item_ids);
+    }
+    if (p_journal->item_states != NULL) {
+        free(p_journal->item_states);
+    }
+    if (p_journal->buf != NULL) {
+        free(p_journal->buf);
+    }
+    free(p_journal);
+
+    return 0;
+}
+
+int zdtm_set_journal(zdtm_lib_env *cur_env, zdtm_journal *p_journal) {
+    cur_env->journal = p_journal;
+
+    return 0;
+}
+
+int zdtm_journal_resumed(zdtm_journal *p_journal) {
+    return p_journal->resumed;
+}
+
+int zdtm_journal_state(zdtm_journal *p_journal, uint32_t sync_id) {
+    if (p_journal->count == 0) {
+        return 0;
+    }
+
+    return p_journal->item_states[_zdtm_journal_slot(p_journal, sync_id)];
+}
+
+int _zdtm_journal_begin(zdtm_journal *p_journal, zdtm_lib_env *cur_env,
+    time_t last_time_synced) {
+
+    unsigned char flags[3], resume_flags[3];
+    uint64_t anchor;
+    uint32_t len;
+    unsigned char *p;
+    int type_flag;
+
+    flags[0] = (unsigned char)cur_env->todo_slow_sync_required;
+    flags[1] = (unsigned char)cur_env->calendar_slow_sync_required;
+    flags[2] = (unsigned char)cur_env->address_book_slow_sync_required;
+    anchor = (uint64_t)last_time_synced;
+
+    if (cur_env->sync_type == SYNC_TODO) {
+        type_flag = 0;
+    } else if (cur_env->sync_type == SYNC_CALENDAR) {
+        type_flag = 1;
+    } else if (cur_env->sync_type == SYNC_ADDRESSBOOK) {
+        type_flag = 2;
+    } else {
+        type_flag = -1;
+    }
+
+    /* Once it set the last time synced, the interrupted synchronization
+     * may have got to reset the sync state, which clears the slow sync
+     * flag of its sync type on the Zaurus. A slow sync recorded by the
+     * journal is hence resumed even though that flag is now clear. */
+    memcpy(resume_flags, flags, sizeof(flags));
+    if ((type_flag >= 0) && p_journal->have_set_anchor &&
+        p_journal->slow_flags[type_flag] && !flags[type_flag]) {
+        resume_flags[type_flag] = p_journal->slow_flags[type_flag];
+    }
+
+    /* The interrupted synchronization may or may not have got to set
+     * the last time synced, hence either time is accepted. */
+    if (p_journal->have_begin &&
+        (p_journal->sync_type == cur_env->sync_type) &&
+        (p_journal->auth_state == cur_env->cur_auth_state) &&
+        (memcmp(p_journal->slow_flags, resume_flags, sizeof(flags)) == 0) &&
+        (strcmp(p_journal->model, cur_env->model) == 0) &&
+        ((p_journal->anchor == anchor) ||
+        (p_journal->have_set_anchor && (p_journal->set_anchor == anchor)))) {
+        /* The resumed synchronization carries on as a slow sync if the
+         * recorded one was. */
+        cur_env->todo_slow_sync_required = resume_flags[0];
+        cur_env->calendar_slow_sync_required = resume_flags[1];
+        cur_env->address_book_slow_sync_required = resume_flags[2];
+        p_journal->resumed = 1;
+        return 1;
+    }
+
+    _zdtm_journal_forget(p_journal);
+    if (_zdtm_journal_cut(p_journal, 0) != 0) {
+        return -1;
+    }
+
+    len = strlen(cur_env->model);
+    if (_zdtm_journal_reserve(p_journal, ZDTM_JOURNAL_REC_HDR_SIZE +
+        ZDTM_JOURNAL_BEGIN_SIZE + len) != 0) {
+        return -2;
+    }
+
+    p_journal->sync_type = cur_env->sync_type;
+    p_journal->auth_state = cur_env->cur_auth_state;
+    memcpy(p_journal->slow_flags, flags, sizeof(flags));
+    p_journal->anchor = anchor;
+    memcpy(p_journal->model, cur_env->model, len + 1);
+
+    p = p_journal->buf + ZDTM_JOURNAL_REC_HDR_SIZE;
+    p[0] = p_journal->auth_state;
+    memcpy(p + 1, flags, sizeof(flags));
+    zdtm_put_le32(p + 4, (uint32_t)(anchor & 0xffffffff));
+    zdtm_put_le32(p + 8, (uint32_t)(anchor >> 32));
+    memcpy(p + ZDTM_JOURNAL_BEGIN_SIZE, cur_env->model, len);
+
+    if (_zdtm_journal_append(p_journal, ZDTM_JOURNAL_BEGIN,
+        ZDTM_JOURNAL_BEGIN_SIZE + len) != 0) {
+        return -2;
+    }
+    p_journal->have_begin = 1;
+
+    return 0;
+}
+
+int _zdtm_journal_anchor(zdtm_journal *p_journal, time_t time_synced) {
+    uint64_t anchor;
+    unsigned char *p;
+
+    if (_zdtm_journal_reserve(p_journal, ZDTM_JOURNAL_REC_HDR_SIZE + 8) != 0) {
+        return -2;
+    }
+
+    anchor = (uint64_t)time_synced;
+    p = p_journal->buf + ZDTM_JOURNAL_REC_HDR_SIZE;
+    zdtm_put_le32(p, (uint32_t)(anchor & 0xffffffff));
+    zdtm_put_le32(p + 4, (uint32_t)(anchor >> 32));
+
+    if (_zdtm_journal_append(p_journal, ZDTM_JOURNAL_ANCHOR, 8) != 0) {
+        return -2;
+    }
+    p_journal->have_set_anchor = 1;
+    p_journal->set_anchor = anchor;
+
+    return 0;
+}
+
+int _zdtm_journal_put_lists(zdtm_journal *p_journal, uint32_t **ids,
+    uint16_t *num_ids) {
+
+    uint32_t size, num, off;
+    unsigned char *p;
+    int i;
+
+    num = 0;
+    for (i = ZDTM_NEW_IDS; i <= ZDTM_DEL_IDS; i++) {
+        num += num_ids[i];
+    }
+    size = ZDTM_JOURNAL_LISTS_SIZE + (num * sizeof(uint32_t));
+
+    if (_zdtm_journal_reserve(p_journal,
+        ZDTM_JOURNAL_REC_HDR_SIZE + size) != 0) {
+        return -1;
+    }
+
+    p = p_journal->buf + ZDTM_JOURNAL_REC_HDR_SIZE;
+    memset(p, 0, ZDTM_JOURNAL_LISTS_SIZE);
+    off = ZDTM_JOURNAL_LISTS_SIZE;
+    for (i = ZDTM_NEW_IDS; i <= ZDTM_DEL_IDS; i++) {
+        p[i * 2] = num_ids[i] & 0xff;
+        p[(i * 2) + 1] = (num_ids[i] >> 8) & 0xff;
+        for (num = 0; num < num_ids[i]; num++) {
+            zdtm_put_le32(p + off, ids[i][num]);
+            off += sizeof(uint32_t);
+        }
+    }
+
+    if (_zdtm_journal_append(p_journal, ZDTM_JOURNAL_LISTS, size) != 0) {
+        return -2;
+    }
+
+    /* Read the record back in, keeping the lists in memory. */
+    memmove(p_journal->buf, p, size);
+    if (_zdtm_journal_apply(p_journal, ZDTM_JOURNAL_LISTS,
+        p_journal->sync_type, size) != 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+int _zdtm_journal_get_lists(zdtm_journal *p_journal, uint32_t **ids,
+    uint16_t *num_ids) {
+
+    uint32_t sync_id;
+    uint16_t j;
+    int i;
+
+    if (!p_journal->resumed || !p_journal->have_lists) {
+        return 1;
+    }
+
+    for (i = ZDTM_NEW_IDS; i <= ZDTM_DEL_IDS; i++) {
+        ids[i] = malloc(sizeof(uint32_t) * (p_journal->num_lists[i] + 1));
+        if (ids[i] == NULL) {
+            while (i > ZDTM_NEW_IDS) {
+                free(ids[--i]);
+            }
+            return -1;
+        }
+
+        num_ids[i] = 0;
+        for (j = 0; j < p_journal->num_lists[i]; j++) {
+            sync_id = p_journal->lists[i][j];
+            if ((i != ZDTM_DEL_IDS) && (zdtm_journal_state(p_journal,
+                sync_id) == ZDTM_JOURNAL_OBTAINED)) {
+                continue;
+            }
+            ids[i][num_ids[i]++] = sync_id;
+        }
+    }
+
+    return 0;
+}
+
+int _zdtm_journal_mark(zdtm_journal *p_journal, int state,
+    uint32_t sync_id) {
+
+    if (_zdtm_journal_reserve(p_journal,
+        ZDTM_JOURNAL_REC_HDR_SIZE + sizeof(uint32_t)) != 0) {
+        return -1;
+    }
+
+    zdtm_put_le32(p_journal->buf + ZDTM_JOURNAL_REC_HDR_SIZE, sync_id);
+    if (_zdtm_journal_append(p_journal, (unsigned char)state,
+        sizeof(uint32_t)) != 0) {
+        return -2;
+    }
+
+    if (_zdtm_journal_store_item(p_journal, state, sync_id) != 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+int _zdtm_journal_finish(zdtm_journal *p_journal) {
+    _zdtm_journal_forget(p_journal);
+
+    if (_zdtm_journal_cut(p_journal, 0) != 0) {
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,237 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+/**
+ * @file zdtm_journal.h
+ * @brief This is a specifications file for the sync checkpoint journal.
+ *
+ * The zdtm_journal.h file is a specifications file for the checkpoint
+ * journal, an optional file kept per device which records the progress
+ * of a synchronization, so that one cut short by a lost connection can
+ * be resumed rather than started over.
+ *
+ * The journal records the handshake state of the synchronization (the
+ * device model, its authentication state, the slow sync flags of its
+ * AMG message, and the time of its ATG message), the ID lists obtained,
+ * and every item obtained from or deleted on the Zaurus. A following
+ * synchronization of the same type with a device reporting the same
+ * handshake state resumes it. The journal is emptied once a
+ * synchronization is terminated properly.
+ *
+ * The journal file is append-only, each record being an 8 bit record
+ * type, an 8 bit sync type, 16 bits of padding, and the 32 bit size of
+ * the data of the record which follows it. All values in the journal
+ * are little endian. A trailing record left incomplete by an
+ * interrupted write is discarded when the journal is opened.
+ */
+
+#ifndef ZDTM_JOURNAL_H
+#define ZDTM_JOURNAL_H
+
+#include <time.h>
+#include "zdtm_export.h"
+#include "zdtm_types.h"
+
+// States of an item in the journal, see zdtm_journal_state().
+#define ZDTM_JOURNAL_OBTAINED 0x01
+#define ZDTM_JOURNAL_DELETED 0x02
+
+/**
+ * Checkpoint journal.
+ *
+ * The zdtm_journal is a type defined to represent an opened checkpoint
+ * journal. It is only ever handled through a pointer obtained from
+ * zdtm_journal_open(). A journal keeps track of a single device and is
+ * not safe to use from multiple threads at once.
+ */
+typedef struct zdtm_journal_store zdtm_journal;
+
+/**
+ * Open checkpoint journal.
+ *
+ * The zdtm_journal_open function opens the checkpoint journal at path,
+ * creating it if it does not exist yet, and replays what it records.
+ * @param path The path of the journal file.
+ * @param pp_journal Pointer to a pointer to store the journal in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully opened the journal.
+ * @retval -1 Failed to allocate memory for the journal.
+ * @retval -2 Failed to open the journal file.
+ * @retval -3 Failed to replay the journal file.
+ */
+ZDTM_EXPORT int zdtm_journal_open(const char *path,
+    zdtm_journal **pp_journal);
+
+/**
+ * Close checkpoint journal.
+ *
+ * The zdtm_journal_close function closes the file of a checkpoint
+ * journal and frees it.
+ * @param p_journal Pointer to the journal.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully closed the journal.
+ * @retval -1 Failed, p_journal is NULL.
+ */
+ZDTM_EXPORT int zdtm_journal_close(zdtm_journal *p_journal);
+
+/**
+ * Set checkpoint journal.
+ *
+ * The zdtm_set_journal function attaches a checkpoint journal to the
+ * current library environment. While attached, zdtm_initiate_sync
+ * resumes the synchronization recorded by the journal if the Zaurus
+ * still reports the same handshake state, and starts recording a new
+ * one otherwise. A resumed synchronization obtains the ID lists from
+ * the journal rather than from the Zaurus, leaving out the items which
+ * were already obtained, and does not delete items again. Passing NULL
+ * detaches it.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param p_journal Pointer to the journal, or NULL.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully set the journal.
+ */
+ZDTM_EXPORT int zdtm_set_journal(zdtm_lib_env *cur_env,
+    zdtm_journal *p_journal);
+
+/**
+ * Check if resumed.
+ *
+ * The zdtm_journal_resumed function checks whether the synchronization
+ * in progress resumes one recorded by the journal.
+ * @param p_journal Pointer to the journal.
+ * @return 1 if the synchronization was resumed, zero otherwise.
+ */
+ZDTM_EXPORT int zdtm_journal_resumed(zdtm_journal *p_journal);
+
+/**
+ * Obtain item state.
+ *
+ * The zdtm_journal_state function obtains what the synchronization
+ * recorded by the journal has done with an item.
+ * @param p_journal Pointer to the journal.
+ * @param sync_id The sync id of the item.
+ * @return ZDTM_JOURNAL_OBTAINED if the item was obtained,
+ * ZDTM_JOURNAL_DELETED if it was deleted, zero otherwise.
+ */
+ZDTM_EXPORT int zdtm_journal_state(zdtm_journal *p_journal,
+    uint32_t sync_id);
+
+/**
+ * Begin journaled synchronization.
+ *
+ * The _zdtm_journal_begin function compares the handshake state held by
+ * the current library environment with the one recorded by the journal.
+ * If they match the recorded synchronization is resumed, otherwise the
+ * journal is emptied and starts recording a new one. A recorded slow
+ * sync whose slow sync flag the Zaurus now reports clear, as resetting
+ * the sync state leaves it, is resumed and left a slow sync.
+ * @param p_journal Pointer to the journal.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param last_time_synced The time of the ATG message of the Zaurus.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully began a new synchronization.
+ * @retval 1 Successfully resumed the recorded synchronization.
+ * @retval -1 Failed to empty the journal file.
+ * @retval -2 Failed to append the record to the journal file.
+ */
+int _zdtm_journal_begin(zdtm_journal *p_journal, zdtm_lib_env *cur_env,
+    time_t last_time_synced);
+
+/**
+ * Record sync anchor.
+ *
+ * The _zdtm_journal_anchor function records the time the Desktop set
+ * as the last time synced on the Zaurus, which the Zaurus reports in
+ * its ATG message when the synchronization is resumed.
+ * @param p_journal Pointer to the journal.
+ * @param time_synced The time set as the last time synced.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully recorded the anchor.
+ * @retval -2 Failed to append the record to the journal file.
+ */
+int _zdtm_journal_anchor(zdtm_journal *p_journal, time_t time_synced);
+
+/**
+ * Record ID lists.
+ *
+ * The _zdtm_journal_put_lists function records the ID lists obtained
+ * from the Zaurus.
+ * @param p_journal Pointer to the journal.
+ * @param ids The new, mod and del lists, indexed by ZDTM_NEW_IDS,
+ * ZDTM_MOD_IDS and ZDTM_DEL_IDS.
+ * @param num_ids The number of IDs in each list.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully recorded the lists.
+ * @retval -1 Failed to allocate memory for the record.
+ * @retval -2 Failed to append the record to the journal file.
+ */
+int _zdtm_journal_put_lists(zdtm_journal *p_journal, uint32_t **ids,
+    uint16_t *num_ids);
+
+/**
+ * Obtain recorded ID lists.
+ *
+ * The _zdtm_journal_get_lists function obtains dynamically allocated
+ * copies of the ID lists recorded by a resumed synchronization, which
+ * leave out the items of the new and mod lists already obtained. The
+ * lists are to be freed by the caller.
+ * @param p_journal Pointer to the journal.
+ * @param ids The new, mod and del lists, indexed by ZDTM_NEW_IDS,
+ * ZDTM_MOD_IDS and ZDTM_DEL_IDS.
+ * @param num_ids The number of IDs in each list.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully obtained the lists.
+ * @retval 1 No lists were recorded, or the synchronization was not
+ * resumed.
+ * @retval -1 Failed to allocate memory for the lists.
+ */
+int _zdtm_journal_get_lists(zdtm_journal *p_journal, uint32_t **ids,
+    uint16_t *num_ids);
+
+/**
+ * Record item state.
+ *
+ * The _zdtm_journal_mark function records that an item was obtained
+ * from or deleted on the Zaurus.
+ * @param p_journal Pointer to the journal.
+ * @param state ZDTM_JOURNAL_OBTAINED or ZDTM_JOURNAL_DELETED.
+ * @param sync_id The sync id of the item.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully recorded the item state.
+ * @retval -1 Failed to grow the item table.
+ * @retval -2 Failed to append the record to the journal file.
+ */
+int _zdtm_journal_mark(zdtm_journal *p_journal, int state,
+    uint32_t sync_id);
+
+/**
+ * Finish journaled synchronization.
+ *
+ * The _zdtm_journal_finish function empties the journal once the
+ * synchronization it recorded has been terminated.
+ * @param p_journal Pointer to the journal.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully emptied the journal.
+ * @retval -1 Failed to empty the journal file.
+ */
+int _zdtm_journal_finish(zdtm_journal *p_journal);
+
+#endif
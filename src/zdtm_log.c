@@ -29,44 +29,109 @@
 
 #include "zdtm_log.h"
 
-int _zdtm_open_log(zdtm_lib_env *cur_env) {
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include <errno.h>
+
+int _zdtm_open_log(zdtm_lib_env *cur_env, const char *path) {
     char *home_env;
     char file_path[256];
     int free_bytes;
 
-    home_env = getenv("HOME");
-    if (home_env == NULL) {
-        return -1;
-    }
+    if (path == NULL) {
+        home_env = getenv("HOME");
+        if (home_env == NULL) {
+            return -1;
+        }
 
-    strncpy(file_path, home_env, 256);
-
-    free_bytes = 256 - strlen(file_path) - 1;
-    /*
-     * Note: the 19 check here is tied to length of cat str below hence
-     * if the name of the cat str used for the log file below changes
-     * then the 19 should change to match the length of the new cat str
-     * as well.
-     */
-    if (free_bytes >= 19) {
-        strncat(file_path, "/.lib_zdtm_sync.log", free_bytes);
-    } else {
-        return -2;
+        strncpy(file_path, home_env, 256);
+
+        free_bytes = 256 - strlen(file_path) - 1;
+        /*
+         * Note: the 19 check here is tied to length of cat str below
+         * hence if the name of the cat str used for the log file below
+         * changes then the 19 should change to match the length of the
+         * new cat str as well.
+         */
+        if (free_bytes >= 19) {
+            strncat(file_path, "/.lib_zdtm_sync.log", free_bytes);
+        } else {
+            return -2;
+        }
+        path = file_path;
     }
 
-    cur_env->logfp = fopen(file_path, "w");
+    /* The log is appended to, so that environments sharing a log file
+     * do not clobber each other. */
+    cur_env->logfp = fopen(path, "a");
     if (cur_env->logfp == NULL) {
-        perror("_zdtm_open_log - fopen");
         return -3;
     }
 
     return 0;
 }
 
+/**
+ * Write log to a descriptor.
+ *
+ * The _zdtm_write_log_fd function writes all of the given content to
+ * the descriptor of a ZDTM_LOG_FD sink, retrying interrupted and short
+ * writes.
+ * @param fd The descriptor to write to.
+ * @param buff Pointer to the content to write to the log.
+ * @param size The size, in bytes, of the content to write to the log.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully wrote the content.
+ * @retval -1 Failed to write the content.
+ */
+static int _zdtm_write_log_fd(int fd, const char *buff, unsigned int size) {
+#ifdef HAVE_UNISTD_H
+    ssize_t r;
+
+    while (size > 0) {
+        r = write(fd, buff, size);
+        if (r < 0) {
+            if (errno == EINTR) { continue; }
+            return -1;
+        }
+        buff += r;
+        size -= r;
+    }
+
+    return 0;
+#else
+    return -1;
+#endif
+}
+
 int _zdtm_write_log(zdtm_lib_env *cur_env, const char *buff,
     unsigned int size) {
     int bytes_written;  // The number of bytes written
 
+    switch (cur_env->log_sink) {
+        case ZDTM_LOG_NONE:
+            return 0;
+        case ZDTM_LOG_FD:
+            if (_zdtm_write_log_fd(cur_env->logfd, buff, size) != 0) {
+                return -2;
+            }
+            return 0;
+        case ZDTM_LOG_FUNC:
+            cur_env->log_func(buff, size, cur_env->log_arg);
+            return 0;
+        default:
+            break;
+    }
+
+    /* The default log file is only opened once there is something to
+     * write to it. */
+    if ((cur_env->logfp == NULL) && (cur_env->log_sink == ZDTM_LOG_DEFAULT)) {
+        if (_zdtm_open_log(cur_env, NULL) != 0) {
+            return -1;
+        }
+    }
+
     if (cur_env->logfp == NULL) {
         return -1;
     }
@@ -78,7 +143,6 @@ int _zdtm_write_log(zdtm_lib_env *cur_env, const char *buff,
     }
 
     if (fflush(cur_env->logfp) != 0) {
-        perror("_zdtm_write_log - fflush");
         return -3;
     }
    
@@ -91,12 +155,16 @@ int _zdtm_log_error(zdtm_lib_env *cur_env, const char *func_name, int err) {
     int buff_size;
     int retval;
 
+    if (cur_env->log_sink == ZDTM_LOG_NONE) {
+        return 0;
+    }
+
     buff_size = 256;
 
-    retval = snprintf(buff, buff_size, "Error: %s - %d", func_name, err);
+    retval = snprintf(buff, buff_size, "Error: %s - %d\n", func_name, err);
     if (retval == -1) {
         return -1;
-    } else if (retval == buff_size) {
+    } else if (retval >= buff_size) {
         return -2;
     }
     retval = _zdtm_write_log(cur_env, buff, retval);
@@ -110,16 +178,17 @@ int _zdtm_log_error(zdtm_lib_env *cur_env, const char *func_name, int err) {
 int _zdtm_close_log(zdtm_lib_env *cur_env) {
     int retval;
 
+    /* Descriptors and functions belong to the caller, only a log file
+     * opened by the library is closed. */
     if (cur_env->logfp != NULL) {
         retval = fclose(cur_env->logfp);
+        cur_env->logfp = NULL;
         if (retval != 0) {
-            perror("_zdtm_close_log - fclose");
             return -1;
         }
-        return 0;
     }
 
-    return -2;
+    return 0;
 }
 
 int _zdtm_dump_msg_log(zdtm_lib_env *cur_env, zdtm_msg *p_msg) {
@@ -129,6 +198,11 @@ int _zdtm_dump_msg_log(zdtm_lib_env *cur_env, zdtm_msg *p_msg) {
     int buff_bytes; /* bytes of buff used */
     int retval;     /* retval temporary holder */
 
+    /* Do not bother building a dump nobody is going to read. */
+    if (cur_env->log_sink == ZDTM_LOG_NONE) {
+        return 0;
+    }
+
     buff_size = 256;
     buff_bytes = 0;
 
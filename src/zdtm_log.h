@@ -36,24 +36,28 @@
 /**
  * Open zdtm library log file.
  *
- * The _zdtm_open_log function opens the zdtm libraries log file in
- * append mode so that the log may be written to.
+ * The _zdtm_open_log function opens a log file of the environment in
+ * append mode so that the log may be written to. The file opened is
+ * the one at path, or the default $HOME/.lib_zdtm_sync.log one if path
+ * is NULL.
  * @param cur_env Pointer to the current zdtm library environment.
+ * @param path The path of the log file, NULL for the default one.
  * @return An integer representing success (zero) or failure (non-zero).
  * @retval 0 Successfully opened the zdtm library log file.
  * @retval -1 Failed to get HOME environment variable.
  * @retval -2 Not enough free bytes in internal buff to create file path.
- * @retval -3 Failed to open the created file path to append.
+ * @retval -3 Failed to open the file path to append.
  */
-int _zdtm_open_log(zdtm_lib_env *cur_env);
+int _zdtm_open_log(zdtm_lib_env *cur_env, const char *path);
 
 /**
  * Write log to zdtm library log file.
  *
- * The _zdtm_write_log function writes content to the zdtm libraries log
- * file in append mode. This function also flushes the file stream so
- * that the content is written to the log file right away, rather than
- * waiting in a buffer somewhere.
+ * The _zdtm_write_log function writes content to the log sink of the
+ * environment, opening the default log file the first time it is
+ * written to. This function also flushes the file stream so that the
+ * content is written to the log file right away, rather than waiting in
+ * a buffer somewhere.
  * @param cur_env Pointer to the current zdtm library environment.
  * @param buff Pointer to the content to write to the log.
  * @param size The size, in bytes, of the content to write to the log.
@@ -66,17 +70,32 @@ int _zdtm_open_log(zdtm_lib_env *cur_env);
 int _zdtm_write_log(zdtm_lib_env *cur_env, const char *buff,
     unsigned int size);
 
+/**
+ * Log an error.
+ *
+ * The _zdtm_log_error function writes a line naming the function which
+ * failed and the value it failed with to the log of the environment.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param func_name The name of the function which failed.
+ * @param err The value the function failed with.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully logged the error.
+ * @retval -1 Failed to construct the line to write to the log.
+ * @retval -2 Failed, truncated the line to fit in buff.
+ * @retval -3 Failed to write the line to the log.
+ */
 int _zdtm_log_error(zdtm_lib_env *cur_env, const char *func_name, int err);
 
 /**
  * Close zdtm library log file.
  *
- * The _zdtm_close_log function closes the zdtm libraries log file.
+ * The _zdtm_close_log function closes the log file the library opened
+ * for the environment, if any. Descriptors and functions set as the log
+ * sink belong to the caller and are left alone.
  * @param cur_env Pointer to the current zdtm library environment.
  * @return An integer representing success (zero) or failure (non-zero).
  * @retval 0 Successfully closed the zdtm library log file.
  * @retval -1 Failed to close zdtm library log file.
- * @retval -2 Failed, zdtm library log file was NOT open.
  */
 int _zdtm_close_log(zdtm_lib_env *cur_env);
 
@@ -0,0 +1,898 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+/**
+ * @file zdtm_mirror.c
+ * @brief This is an implementation file for the local item mirror store.
+ *
+ * The zdtm_mirror.c file is an implementation of the local item mirror
+ * store, an append-only log of item versions with a memory mapped hash
+ * index of the latest version of each item.
+ */
+
+#include "zdtm_mirror.h"
+#include "zdtm_proto.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_SYS_STAT_H) && \
+    defined(HAVE_FCNTL_H) && defined(HAVE_UNISTD_H)
+#define ZDTM_MIRROR_USE_MMAP 1
+#endif
+
+// Operations of the log records.
+#define ZDTM_MIRROR_PUT 0x01
+#define ZDTM_MIRROR_DEL 0x02
+
+// Sizes of the parts of a log record.
+#define ZDTM_MIRROR_REC_HDR_SIZE 16
+#define ZDTM_MIRROR_BOX_HDR_SIZE (sizeof(uint32_t) + sizeof(uint16_t))
+
+// Identification of the index file ("ZDMR").
+#define ZDTM_MIRROR_MAGIC 0x524d445a
+#define ZDTM_MIRROR_VERSION 1
+
+// Initial number of slots of the index, always a power of two.
+#define ZDTM_MIRROR_MIN_SLOTS 64
+
+// Log offsets marking empty and deleted index slots.
+#define ZDTM_MIRROR_EMPTY 0xffffffff
+#define ZDTM_MIRROR_TOMB 0xfffffffe
+
+/**
+ * Mirror index header.
+ *
+ * The zdtm_mirror_idx_hdr is a structure which represents the header
+ * at the start of the index file. The log_size member is the size of
+ * the log the index was last brought up to date with, an index whose
+ * log_size does not match the log is rebuilt.
+ */
+struct zdtm_mirror_idx_hdr {
+    uint32_t magic;         // ZDTM_MIRROR_MAGIC
+    uint32_t version;       // ZDTM_MIRROR_VERSION
+    uint32_t capacity;      // number of slots, a power of two
+    uint32_t count;         // number of items held
+    uint32_t tombs;         // number of deleted slots
+    uint32_t log_size;      // size of the log the index matches
+};
+
+/**
+ * Mirror index slot.
+ *
+ * The zdtm_mirror_slot is a structure which represents a slot of the
+ * index. The offset is that of the DTM box record of the item in the
+ * log, or one of ZDTM_MIRROR_EMPTY and ZDTM_MIRROR_TOMB.
+ */
+struct zdtm_mirror_slot {
+    uint32_t sync_id;       // sync id of the item
+    uint32_t offset;        // offset of the item params in the log
+    uint64_t hash;          // content hash of the item params
+};
+
+/**
+ * Mirror store.
+ *
+ * The zdtm_mirror_store is a structure which represents an opened
+ * mirror store. The buf and params members are scratch space for
+ * building and reading log records which only ever grows.
+ */
+struct zdtm_mirror_store {
+    FILE *logfp;                        // log file
+    uint32_t log_size;                  // size of the log file
+    int idx_fd;                         // index file, -1 if not mapped
+    size_t idx_size;                    // size of the index
+    struct zdtm_mirror_idx_hdr *hdr;    // header of the index
+    struct zdtm_mirror_slot *slots;     // slots of the index
+    unsigned char *buf;                 // log record scratch space
+    uint32_t buf_size;                  // size of buf
+    struct zdtm_adr_msg_param *params;  // params of the read record
+    uint16_t max_params;                // number of entries in params
+};
+
+uint64_t zdtm_mirror_hash(struct zdtm_adr_msg_param *params,
+    uint16_t num_params) {
+
+    uint64_t hash;
+    unsigned char len[sizeof(uint32_t)];
+    uint32_t i, j;
+
+    hash = 14695981039346656037ULL;
+    for (i = 0; i < num_params; i++) {
+        /* The length is hashed as well so that moving bytes between
+         * adjacent params changes the hash. */
+        zdtm_put_le32(len, params[i].param_len);
+        for (j = 0; j < sizeof(uint32_t); j++) {
+            hash = (hash ^ len[j]) * 1099511628211ULL;
+        }
+        for (j = 0; j < params[i].param_len; j++) {
+            hash = (hash ^ params[i].param_data[j]) * 1099511628211ULL;
+        }
+    }
+
+    return hash;
+}
+
+/**
+ * Find index slot.
+ *
+ * The _zdtm_mirror_find function finds the index slot holding the item
+ * with the given sync id by linear probing.
+ * @param p_mirror Pointer to the mirror store.
+ * @param sync_id The sync id of the item.
+ * @return Pointer to the slot, or NULL if the item is not held.
+ */
+static struct zdtm_mirror_slot *_zdtm_mirror_find(zdtm_mirror *p_mirror,
+    uint32_t sync_id) {
+
+    uint32_t i, mask;
+    struct zdtm_mirror_slot *slot;
+
+    mask = p_mirror->hdr->capacity - 1;
+    i = (sync_id * 2654435761U) & mask;
+    for (;;) {
+        slot = &p_mirror->slots[i];
+        if (slot->offset == ZDTM_MIRROR_EMPTY) {
+            return NULL;
+        }
+        if ((slot->offset != ZDTM_MIRROR_TOMB) && (slot->sync_id == sync_id)) {
+            return slot;
+        }
+        i = (i + 1) & mask;
+    }
+}
+
+/**
+ * Store in free index slot.
+ *
+ * The _zdtm_mirror_place function stores an item, known not to be held
+ * yet, in the first free index slot found by linear probing. The index
+ * must have a free slot.
+ * @param p_mirror Pointer to the mirror store.
+ * @param sync_id The sync id of the item.
+ * @param offset The offset of the item params in the log.
+ * @param hash The content hash of the item params.
+ */
+static void _zdtm_mirror_place(zdtm_mirror *p_mirror, uint32_t sync_id,
+    uint32_t offset, uint64_t hash) {
+
+    uint32_t i, mask;
+    struct zdtm_mirror_slot *slot;
+
+    mask = p_mirror->hdr->capacity - 1;
+    i = (sync_id * 2654435761U) & mask;
+    for (;;) {
+        slot = &p_mirror->slots[i];
+        if (slot->offset == ZDTM_MIRROR_TOMB) {
+            p_mirror->hdr->tombs--;
+            break;
+        }
+        if (slot->offset == ZDTM_MIRROR_EMPTY) {
+            break;
+        }
+        i = (i + 1) & mask;
+    }
+
+    slot->sync_id = sync_id;
+    slot->offset = offset;
+    slot->hash = hash;
+    p_mirror->hdr->count++;
+}
+
+/**
+ * Allocate index.
+ *
+ * The _zdtm_mirror_alloc_index function replaces the index of a mirror
+ * store with an empty one of the given capacity, growing the index file
+ * and mapping it when memory mapping is supported. The log_size of the
+ * new index is left invalid.
+ * @param p_mirror Pointer to the mirror store.
+ * @param capacity The number of slots, a power of two.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully allocated the index.
+ * @retval -1 Failed to grow, map, or allocate the index.
+ */
+static int _zdtm_mirror_alloc_index(zdtm_mirror *p_mirror,
+    uint32_t capacity) {
+
+    size_t size;
+    void *p;
+
+    size = sizeof(struct zdtm_mirror_idx_hdr) +
+        (sizeof(struct zdtm_mirror_slot) * (size_t)capacity);
+
+#ifdef ZDTM_MIRROR_USE_MMAP
+    if (p_mirror->hdr != NULL) {
+        munmap(p_mirror->hdr, p_mirror->idx_size);
+        p_mirror->hdr = NULL;
+        p_mirror->slots = NULL;
+    }
+    if (ftruncate(p_mirror->idx_fd, (off_t)size) != 0) {
+        return -1;
+    }
+    p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+        p_mirror->idx_fd, 0);
+    if (p == MAP_FAILED) {
+        return -1;
+    }
+#else
+    if (p_mirror->hdr != NULL) {
+        free(p_mirror->hdr);
+        p_mirror->hdr = NULL;
+        p_mirror->slots = NULL;
+    }
+    p = malloc(size);
+    if (p == NULL) {
+        return -1;
+    }
+#endif
+
+    p_mirror->idx_size = size;
+    p_mirror->hdr = (struct zdtm_mirror_idx_hdr *)p;
+    p_mirror->slots = (struct zdtm_mirror_slot *)((unsigned char *)p +
+        sizeof(struct zdtm_mirror_idx_hdr));
+
+    memset(p_mirror->slots, 0xff, size - sizeof(struct zdtm_mirror_idx_hdr));
+    p_mirror->hdr->magic = ZDTM_MIRROR_MAGIC;
+    p_mirror->hdr->version = ZDTM_MIRROR_VERSION;
+    p_mirror->hdr->capacity = capacity;
+    p_mirror->hdr->count = 0;
+    p_mirror->hdr->tombs = 0;
+    p_mirror->hdr->log_size = ZDTM_MIRROR_EMPTY;
+
+    return 0;
+}
+
+/**
+ * Grow index.
+ *
+ * The _zdtm_mirror_grow function rehashes the items of a mirror store
+ * into a new index with room for at least twice as many items, which
+ * also drops all the deleted slots.
+ * @param p_mirror Pointer to the mirror store.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully grew the index.
+ * @retval -1 Failed to allocate memory for the rehash.
+ * @retval -2 Failed to allocate the new index.
+ */
+static int _zdtm_mirror_grow(zdtm_mirror *p_mirror) {
+    struct zdtm_mirror_slot *old;
+    uint32_t i, old_capacity, capacity;
+
+    old_capacity = p_mirror->hdr->capacity;
+    capacity = old_capacity;
+    while (((p_mirror->hdr->count + 1) * 2) > capacity) {
+        capacity *= 2;
+    }
+
+    old = malloc(sizeof(struct zdtm_mirror_slot) * old_capacity);
+    if (old == NULL) {
+        return -1;
+    }
+    memcpy(old, p_mirror->slots,
+        sizeof(struct zdtm_mirror_slot) * old_capacity);
+
+    if (_zdtm_mirror_alloc_index(p_mirror, capacity) != 0) {
+        free(old);
+        return -2;
+    }
+
+    for (i = 0; i < old_capacity; i++) {
+        if ((old[i].offset != ZDTM_MIRROR_EMPTY) &&
+            (old[i].offset != ZDTM_MIRROR_TOMB)) {
+            _zdtm_mirror_place(p_mirror, old[i].sync_id, old[i].offset,
+                old[i].hash);
+        }
+    }
+    free(old);
+
+    return 0;
+}
+
+/**
+ * Insert into index.
+ *
+ * The _zdtm_mirror_insert function stores an item in the index of a
+ * mirror store, replacing the slot of a previous version, and growing
+ * the index first if it would become more than three quarters full.
+ * @param p_mirror Pointer to the mirror store.
+ * @param sync_id The sync id of the item.
+ * @param offset The offset of the item params in the log.
+ * @param hash The content hash of the item params.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully inserted the item.
+ * @retval -1 Failed to grow the index.
+ */
+static int _zdtm_mirror_insert(zdtm_mirror *p_mirror, uint32_t sync_id,
+    uint32_t offset, uint64_t hash) {
+
+    struct zdtm_mirror_slot *slot;
+
+    slot = _zdtm_mirror_find(p_mirror, sync_id);
+    if (slot != NULL) {
+        slot->offset = offset;
+        slot->hash = hash;
+        return 0;
+    }
+
+    if (((p_mirror->hdr->count + p_mirror->hdr->tombs + 1) * 4) >
+        (p_mirror->hdr->capacity * 3)) {
+        if (_zdtm_mirror_grow(p_mirror) != 0) {
+            return -1;
+        }
+    }
+
+    _zdtm_mirror_place(p_mirror, sync_id, offset, hash);
+
+    return 0;
+}
+
+/**
+ * Remove from index.
+ *
+ * The _zdtm_mirror_remove function marks the index slot of an item as
+ * deleted.
+ * @param p_mirror Pointer to the mirror store.
+ * @param sync_id The sync id of the item.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully removed the item.
+ * @retval 1 The item is not held.
+ */
+static int _zdtm_mirror_remove(zdtm_mirror *p_mirror, uint32_t sync_id) {
+    struct zdtm_mirror_slot *slot;
+
+    slot = _zdtm_mirror_find(p_mirror, sync_id);
+    if (slot == NULL) {
+        return 1;
+    }
+
+    slot->offset = ZDTM_MIRROR_TOMB;
+    p_mirror->hdr->count--;
+    p_mirror->hdr->tombs++;
+
+    return 0;
+}
+
+/**
+ * Reserve scratch space.
+ *
+ * The _zdtm_mirror_reserve function makes sure the scratch buffer of a
+ * mirror store holds at least size bytes.
+ * @param p_mirror Pointer to the mirror store.
+ * @param size The number of bytes required.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully reserved the space.
+ * @retval -1 Failed to allocate memory for the space.
+ */
+static int _zdtm_mirror_reserve(zdtm_mirror *p_mirror, uint32_t size) {
+    unsigned char *buf;
+
+    if (size <= p_mirror->buf_size) {
+        return 0;
+    }
+
+    buf = realloc(p_mirror->buf, size);
+    if (buf == NULL) {
+        return -1;
+    }
+    p_mirror->buf = buf;
+    p_mirror->buf_size = size;
+
+    return 0;
+}
+
+/**
+ * Append log record.
+ *
+ * The _zdtm_mirror_append function appends the log record built in the
+ * scratch buffer of a mirror store to its log file. A partially written
+ * record is cut off again where possible, otherwise it is discarded the
+ * next time the mirror store is opened.
+ * @param p_mirror Pointer to the mirror store.
+ * @param size The size of the log record.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully appended the record.
+ * @retval -1 Failed to write the record.
+ */
+static int _zdtm_mirror_append(zdtm_mirror *p_mirror, uint32_t size) {
+    if ((size > (ZDTM_MIRROR_TOMB - p_mirror->log_size)) ||
+        (fseek(p_mirror->logfp, 0, SEEK_END) != 0)) {
+        return -1;
+    }
+
+    if ((fwrite(p_mirror->buf, 1, size, p_mirror->logfp) != size) ||
+        (fflush(p_mirror->logfp) != 0)) {
+#ifdef HAVE_UNISTD_H
+        if (ftruncate(fileno(p_mirror->logfp), p_mirror->log_size) != 0) {
+            return -1;
+        }
+#endif
+        return -1;
+    }
+
+    p_mirror->log_size += size;
+
+    return 0;
+}
+
+/**
+ * Build log record header.
+ *
+ * The _zdtm_mirror_build_hdr function builds the header of a log record
+ * at the start of the scratch buffer of a mirror store.
+ * @param p_mirror Pointer to the mirror store.
+ * @param op The operation of the record (ZDTM_MIRROR_*).
+ * @param sync_type The synchronization type of the item.
+ * @param sync_id The sync id of the item.
+ * @param hash The content hash of the item params.
+ */
+static void _zdtm_mirror_build_hdr(zdtm_mirror *p_mirror, unsigned char op,
+    unsigned char sync_type, uint32_t sync_id, uint64_t hash) {
+
+    unsigned char *p;
+
+    p = p_mirror->buf;
+    zdtm_put_le32(p, sync_id);
+    p[4] = op;
+    p[5] = sync_type;
+    p[6] = 0x00;
+    p[7] = 0x00;
+    zdtm_put_le32(p + 8, (uint32_t)(hash & 0xffffffff));
+    zdtm_put_le32(p + 12, (uint32_t)(hash >> 32));
+}
+
+/**
+ * Rebuild index.
+ *
+ * The _zdtm_mirror_rebuild function replays the log of a mirror store
+ * into its freshly allocated index. A trailing record left incomplete
+ * by an interrupted write is cut off the log.
+ * @param p_mirror Pointer to the mirror store.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully rebuilt the index.
+ * @retval -1 Failed to read the log file.
+ * @retval -2 Failed to grow the index.
+ * @retval -3 Failed to cut off an incomplete trailing record.
+ */
+static int _zdtm_mirror_rebuild(zdtm_mirror *p_mirror) {
+    unsigned char hdr[ZDTM_MIRROR_REC_HDR_SIZE + ZDTM_MIRROR_BOX_HDR_SIZE];
+    uint32_t pos, sync_id, rec_len;
+    uint64_t hash;
+
+    if (fseek(p_mirror->logfp, 0, SEEK_SET) != 0) {
+        return -1;
+    }
+
+    pos = 0;
+    while ((p_mirror->log_size - pos) >= sizeof(hdr)) {
+        if (fread(hdr, 1, sizeof(hdr), p_mirror->logfp) != sizeof(hdr)) {
+            return -1;
+        }
+
+        sync_id = zdtm_get_le32(hdr);
+        hash = ((uint64_t)zdtm_get_le32(hdr + 12) << 32) |
+            zdtm_get_le32(hdr + 8);
+        rec_len = zdtm_get_le32(hdr + ZDTM_MIRROR_REC_HDR_SIZE);
+        if ((rec_len < sizeof(uint16_t)) ||
+            (rec_len > (p_mirror->log_size - pos - ZDTM_MIRROR_REC_HDR_SIZE -
+            sizeof(uint32_t)))) {
+            break;
+        }
+
+        if (hdr[4] == ZDTM_MIRROR_PUT) {
+            if (_zdtm_mirror_insert(p_mirror, sync_id,
+                pos + ZDTM_MIRROR_REC_HDR_SIZE, hash) != 0) {
+                return -2;
+            }
+        } else if (hdr[4] == ZDTM_MIRROR_DEL) {
+            _zdtm_mirror_remove(p_mirror, sync_id);
+        } else {
+            break;
+        }
+
+        pos += ZDTM_MIRROR_REC_HDR_SIZE + sizeof(uint32_t) + rec_len;
+        if (fseek(p_mirror->logfp, pos, SEEK_SET) != 0) {
+            return -1;
+        }
+    }
+
+    if (pos != p_mirror->log_size) {
+#ifdef HAVE_UNISTD_H
+        if ((fflush(p_mirror->logfp) != 0) ||
+            (ftruncate(fileno(p_mirror->logfp), pos) != 0)) {
+            return -3;
+        }
+#else
+        return -3;
+#endif
+        p_mirror->log_size = pos;
+    }
+
+    p_mirror->hdr->log_size = p_mirror->log_size;
+
+    return 0;
+}
+
+#ifdef ZDTM_MIRROR_USE_MMAP
+/**
+ * Map existing index.
+ *
+ * The _zdtm_mirror_map_index function maps the index file of a mirror
+ * store if it holds a valid index matching the log.
+ * @param p_mirror Pointer to the mirror store.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully mapped the index.
+ * @retval 1 The index file does not hold a matching index.
+ * @retval -1 Failed to map the index file.
+ */
+static int _zdtm_mirror_map_index(zdtm_mirror *p_mirror) {
+    struct stat st;
+    struct zdtm_mirror_idx_hdr *hdr;
+    void *p;
+
+    if (fstat(p_mirror->idx_fd, &st) != 0) {
+        return -1;
+    }
+    if (st.st_size < (off_t)sizeof(struct zdtm_mirror_idx_hdr)) {
+        return 1;
+    }
+
+    p = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+        p_mirror->idx_fd, 0);
+    if (p == MAP_FAILED) {
+        return -1;
+    }
+
+    hdr = (struct zdtm_mirror_idx_hdr *)p;
+    if ((hdr->magic != ZDTM_MIRROR_MAGIC) ||
+        (hdr->version != ZDTM_MIRROR_VERSION) ||
+        (hdr->capacity < ZDTM_MIRROR_MIN_SLOTS) ||
+        ((hdr->capacity & (hdr->capacity - 1)) != 0) ||
+        ((size_t)st.st_size != (sizeof(struct zdtm_mirror_idx_hdr) +
+        (sizeof(struct zdtm_mirror_slot) * (size_t)hdr->capacity))) ||
+        (hdr->count + hdr->tombs >= hdr->capacity) ||
+        (hdr->log_size != p_mirror->log_size)) {
+        munmap(p, (size_t)st.st_size);
+        return 1;
+    }
+
+    p_mirror->idx_size = (size_t)st.st_size;
+    p_mirror->hdr = hdr;
+    p_mirror->slots = (struct zdtm_mirror_slot *)((unsigned char *)p +
+        sizeof(struct zdtm_mirror_idx_hdr));
+
+    return 0;
+}
+#endif
+
+int zdtm_mirror_open(const char *path, zdtm_mirror **pp_mirror) {
+    zdtm_mirror *p_mirror;
+    long size;
+#ifdef ZDTM_MIRROR_USE_MMAP
+    char *idx_path;
+    int r;
+#endif
+
+    p_mirror = malloc(sizeof(zdtm_mirror));
+    if (p_mirror == NULL) {
+        return -1;
+    }
+    memset(p_mirror, 0, sizeof(zdtm_mirror));
+    p_mirror->idx_fd = -1;
+
+    p_mirror->logfp = fopen(path, "a+b");
+    if (p_mirror->logfp == NULL) {
+        free(p_mirror);
+        return -2;
+    }
+
+    if ((fseek(p_mirror->logfp, 0, SEEK_END) != 0) ||
+        ((size = ftell(p_mirror->logfp)) < 0) ||
+        ((unsigned long)size >= ZDTM_MIRROR_TOMB)) {
+        zdtm_mirror_close(p_mirror);
+        return -2;
+    }
+    p_mirror->log_size = (uint32_t)size;
+
+#ifdef ZDTM_MIRROR_USE_MMAP
+    idx_path = malloc(strlen(path) + strlen(ZDTM_MIRROR_IDX_SUFFIX) + 1);
+    if (idx_path == NULL) {
+        zdtm_mirror_close(p_mirror);
+        return -1;
+    }
+    strcpy(idx_path, path);
+    strcat(idx_path, ZDTM_MIRROR_IDX_SUFFIX);
+
+    p_mirror->idx_fd = open(idx_path, O_RDWR | O_CREAT, 0644);
+    free(idx_path);
+    if (p_mirror->idx_fd == -1) {
+        zdtm_mirror_close(p_mirror);
+        return -3;
+    }
+
+    r = _zdtm_mirror_map_index(p_mirror);
+    if (r < 0) {
+        zdtm_mirror_close(p_mirror);
+        return -3;
+    } else if (r == 0) {
+        (*pp_mirror) = p_mirror;
+        return 0;
+    }
+#endif
+
+    /* There is no usable index, hence build one from the log. */
+    if (_zdtm_mirror_alloc_index(p_mirror, ZDTM_MIRROR_MIN_SLOTS) != 0) {
+        zdtm_mirror_close(p_mirror);
+        return -3;
+    }
+
+    if (_zdtm_mirror_rebuild(p_mirror) != 0) {
+        zdtm_mirror_close(p_mirror);
+        return -4;
+    }
+
+    (*pp_mirror) = p_mirror;
+
+    return 0;
+}
+
+int zdtm_mirror_close(zdtm_mirror *p_mirror) {
+    if (p_mirror == NULL) {
+        return -1;
+    }
+
+    if (p_mirror->logfp != NULL) {
+        fclose(p_mirror->logfp);
+    }
+
+#ifdef ZDTM_MIRROR_USE_MMAP
+    if (p_mirror->hdr != NULL) {
+        munmap(p_mirror->hdr, p_mirror->idx_size);
+    }
+    if (p_mirror->idx_fd != -1) {
+        close(p_mirror->idx_fd);
+    }
+#else
+    if (p_mirror->hdr != NULL) {
+        free(p_mirror->hdr);
+    }
+#endif
+
+    if (p_mirror->buf != NULL) {
+        free(p_mirror->buf);
+    }
+    if (p_mirror->params != NULL) {
+        free(p_mirror->params);
+    }
+    free(p_mirror);
+
+    return 0;
+}
+
+int zdtm_set_mirror(zdtm_lib_env *cur_env, zdtm_mirror *p_mirror) {
+    cur_env->mirror = p_mirror;
+
+    return 0;
+}
+
+int zdtm_mirror_put(zdtm_mirror *p_mirror, unsigned char sync_type,
+    uint32_t sync_id, struct zdtm_adr_msg_param *params,
+    uint16_t num_params) {
+
+    struct zdtm_mirror_slot *slot;
+    uint64_t hash, total;
+    uint32_t size, rec_len, offset;
+    unsigned char *p;
+    int i;
+
+    hash = zdtm_mirror_hash(params, num_params);
+
+    slot = _zdtm_mirror_find(p_mirror, sync_id);
+    if ((slot != NULL) && (slot->hash == hash)) {
+        return 0;
+    }
+
+    total = sizeof(uint16_t);
+    for (i = 0; i < num_params; i++) {
+        total += sizeof(uint32_t) + params[i].param_len;
+    }
+    if (total >= (ZDTM_MIRROR_TOMB - ZDTM_MIRROR_REC_HDR_SIZE -
+        sizeof(uint32_t))) {
+        return -2;
+    }
+    rec_len = (uint32_t)total;
+    size = ZDTM_MIRROR_REC_HDR_SIZE + sizeof(uint32_t) + rec_len;
+
+    if (_zdtm_mirror_reserve(p_mirror, size) != 0) {
+        return -1;
+    }
+
+    _zdtm_mirror_build_hdr(p_mirror, ZDTM_MIRROR_PUT, sync_type, sync_id,
+        hash);
+    p = p_mirror->buf + ZDTM_MIRROR_REC_HDR_SIZE;
+    zdtm_put_le32(p, rec_len);
+    p += sizeof(uint32_t);
+    zdtm_put_le16(p, num_params);
+    p += sizeof(uint16_t);
+    for (i = 0; i < num_params; i++) {
+        zdtm_put_le32(p, params[i].param_len);
+        p += sizeof(uint32_t);
+        memcpy(p, params[i].param_data, params[i].param_len);
+        p += params[i].param_len;
+    }
+
+    offset = p_mirror->log_size + ZDTM_MIRROR_REC_HDR_SIZE;
+    if (_zdtm_mirror_append(p_mirror, size) != 0) {
+        return -2;
+    }
+
+    if (_zdtm_mirror_insert(p_mirror, sync_id, offset, hash) != 0) {
+        return -3;
+    }
+    p_mirror->hdr->log_size = p_mirror->log_size;
+
+    return 0;
+}
+
+int zdtm_mirror_delete(zdtm_mirror *p_mirror, unsigned char sync_type,
+    uint32_t sync_id) {
+
+    uint32_t size;
+    unsigned char *p;
+
+    if (_zdtm_mirror_find(p_mirror, sync_id) == NULL) {
+        return 1;
+    }
+
+    size = ZDTM_MIRROR_REC_HDR_SIZE + ZDTM_MIRROR_BOX_HDR_SIZE;
+    if (_zdtm_mirror_reserve(p_mirror, size) != 0) {
+        return -2;
+    }
+
+    _zdtm_mirror_build_hdr(p_mirror, ZDTM_MIRROR_DEL, sync_type, sync_id, 0);
+    p = p_mirror->buf + ZDTM_MIRROR_REC_HDR_SIZE;
+    zdtm_put_le32(p, sizeof(uint16_t));
+    p[4] = 0x00;
+    p[5] = 0x00;
+
+    if (_zdtm_mirror_append(p_mirror, size) != 0) {
+        return -2;
+    }
+
+    _zdtm_mirror_remove(p_mirror, sync_id);
+    p_mirror->hdr->log_size = p_mirror->log_size;
+
+    return 0;
+}
+
+int zdtm_mirror_lookup(zdtm_mirror *p_mirror, uint32_t sync_id,
+    uint64_t *p_hash, uint32_t *p_offset) {
+
+    struct zdtm_mirror_slot *slot;
+
+    slot = _zdtm_mirror_find(p_mirror, sync_id);
+    if (slot == NULL) {
+        return 1;
+    }
+
+    (*p_hash) = slot->hash;
+    if (p_offset != NULL) {
+        (*p_offset) = slot->offset;
+    }
+
+    return 0;
+}
+
+int zdtm_mirror_read(zdtm_mirror *p_mirror, uint32_t sync_id,
+    struct zdtm_dtm_record *p_rec) {
+
+    struct zdtm_mirror_slot *slot;
+    struct zdtm_adr_msg_param *params;
+    unsigned char hdr[ZDTM_MIRROR_BOX_HDR_SIZE];
+    uint32_t rec_len, rec_size;
+    uint16_t num_params;
+
+    slot = _zdtm_mirror_find(p_mirror, sync_id);
+    if (slot == NULL) {
+        return 1;
+    }
+
+    if ((fseek(p_mirror->logfp, slot->offset, SEEK_SET) != 0) ||
+        (fread(hdr, 1, sizeof(hdr), p_mirror->logfp) != sizeof(hdr))) {
+        return -1;
+    }
+
+    rec_len = zdtm_get_le32(hdr);
+    num_params = zdtm_get_le16(hdr + sizeof(uint32_t));
+    if (rec_len > (p_mirror->log_size - slot->offset - sizeof(uint32_t))) {
+        return -3;
+    }
+
+    if (_zdtm_mirror_reserve(p_mirror, sizeof(uint32_t) + rec_len) != 0) {
+        return -2;
+    }
+    if (num_params > p_mirror->max_params) {
+        params = realloc(p_mirror->params,
+            sizeof(struct zdtm_adr_msg_param) * num_params);
+        if (params == NULL) {
+            return -2;
+        }
+        p_mirror->params = params;
+        p_mirror->max_params = num_params;
+    }
+
+    if ((fseek(p_mirror->logfp, slot->offset, SEEK_SET) != 0) ||
+        (fread(p_mirror->buf, 1, sizeof(uint32_t) + rec_len,
+        p_mirror->logfp) != (sizeof(uint32_t) + rec_len))) {
+        return -1;
+    }
+
+    if (_zdtm_dtm_parse_record(p_mirror->buf, sizeof(uint32_t) + rec_len,
+        p_mirror->params, p_mirror->max_params, &p_rec->num_params,
+        &rec_size) != 0) {
+        return -3;
+    }
+
+    p_rec->offset = slot->offset;
+    p_rec->params = p_mirror->params;
+
+    return 0;
+}
+
+int zdtm_mirror_next(zdtm_mirror *p_mirror, uint32_t *p_cursor,
+    uint32_t *p_sync_id, uint64_t *p_hash) {
+
+    uint32_t i;
+    struct zdtm_mirror_slot *slot;
+
+    for (i = (*p_cursor); i < p_mirror->hdr->capacity; i++) {
+        slot = &p_mirror->slots[i];
+        if ((slot->offset != ZDTM_MIRROR_EMPTY) &&
+            (slot->offset != ZDTM_MIRROR_TOMB)) {
+            (*p_sync_id) = slot->sync_id;
+            (*p_hash) = slot->hash;
+            (*p_cursor) = i + 1;
+            return 0;
+        }
+    }
+
+    (*p_cursor) = i;
+
+    return 1;
+}
+
+uint32_t zdtm_mirror_count(zdtm_mirror *p_mirror) {
+    return p_mirror->hdr->count;
+}
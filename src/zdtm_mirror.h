@@ -0,0 +1,225 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+/**
+ * @file zdtm_mirror.h
+ * @brief This is a specifications file for the local item mirror store.
+ *
+ * The zdtm_mirror.h file is a specifications file for the local item
+ * mirror store, an optional embedded store which holds the last known
+ * version of each item of a synchronization type so that the Desktop
+ * can tell whether it already has an item without obtaining it from
+ * the Zaurus again.
+ *
+ * A mirror store is made up of two files. The log file at the path the
+ * store is opened with is append-only, each record being a 32 bit sync
+ * id, an 8 bit operation, an 8 bit sync type, 16 bits of padding, and
+ * a 64 bit content hash, followed by the parameters of the item laid
+ * out as a record of a DTM box file (see zdtm_dtm.h). A delete record
+ * carries no parameters. All values in the log are little endian. The
+ * index file, at the same path with ".idx" appended, is a memory mapped
+ * open addressing hash table of sync id to content hash and log offset.
+ * It is stored in host byte order and is rebuilt from the log whenever
+ * it is missing or does not match the log.
+ */
+
+#ifndef ZDTM_MIRROR_H
+#define ZDTM_MIRROR_H
+
+#include "zdtm_export.h"
+#include "zdtm_types.h"
+#include "zdtm_dtm.h"
+
+// Suffix appended to the log file path to form the index file path.
+#define ZDTM_MIRROR_IDX_SUFFIX ".idx"
+
+/**
+ * Mirror store.
+ *
+ * The zdtm_mirror is a type defined to represent an opened mirror
+ * store. It is only ever handled through a pointer obtained from
+ * zdtm_mirror_open(). A mirror store holds the items of a single
+ * synchronization type and is not safe to use from multiple threads
+ * at once.
+ */
+typedef struct zdtm_mirror_store zdtm_mirror;
+
+/**
+ * Open mirror store.
+ *
+ * The zdtm_mirror_open function opens the mirror store whose log file
+ * is at path, creating it if it does not exist yet. A trailing record
+ * left incomplete by an interrupted write is discarded.
+ * @param path The path of the log file of the mirror store.
+ * @param pp_mirror Pointer to a pointer to store the mirror store in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully opened the mirror store.
+ * @retval -1 Failed to allocate memory for the mirror store.
+ * @retval -2 Failed to open the log file.
+ * @retval -3 Failed to open or map the index file.
+ * @retval -4 Failed to rebuild the index from the log file.
+ */
+ZDTM_EXPORT int zdtm_mirror_open(const char *path, zdtm_mirror **pp_mirror);
+
+/**
+ * Close mirror store.
+ *
+ * The zdtm_mirror_close function flushes and closes the files of a
+ * mirror store and frees it.
+ * @param p_mirror Pointer to the mirror store.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully closed the mirror store.
+ * @retval -1 Failed, p_mirror is NULL.
+ */
+ZDTM_EXPORT int zdtm_mirror_close(zdtm_mirror *p_mirror);
+
+/**
+ * Set mirror store.
+ *
+ * The zdtm_set_mirror function attaches a mirror store to the current
+ * library environment. While attached, every item obtained from the
+ * Zaurus is stored in it and every item deleted on either side is
+ * removed from it. The mirror store must hold the items of the sync
+ * type the environment is set to. Passing NULL detaches it.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param p_mirror Pointer to the mirror store, or NULL.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully set the mirror store.
+ */
+ZDTM_EXPORT int zdtm_set_mirror(zdtm_lib_env *cur_env, zdtm_mirror *p_mirror);
+
+/**
+ * Hash item params.
+ *
+ * The zdtm_mirror_hash function computes the 64 bit FNV-1a content hash
+ * of the parameters of an item, as stored in a mirror store. Identical
+ * parameters always result in identical hashes.
+ * @param params Pointer to the params of the item.
+ * @param num_params The number of params of the item.
+ * @return The content hash of the params.
+ */
+ZDTM_EXPORT uint64_t zdtm_mirror_hash(struct zdtm_adr_msg_param *params,
+    uint16_t num_params);
+
+/**
+ * Store item in mirror store.
+ *
+ * The zdtm_mirror_put function stores a version of an item in the
+ * mirror store, replacing any previous version. Nothing is written if
+ * the mirror store already holds an identical version.
+ * @param p_mirror Pointer to the mirror store.
+ * @param sync_type The synchronization type of the item.
+ * @param sync_id The sync id of the item.
+ * @param params Pointer to the params of the item.
+ * @param num_params The number of params of the item.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully stored the item.
+ * @retval -1 Failed to allocate memory for the log record.
+ * @retval -2 Failed to append the record to the log file.
+ * @retval -3 Failed to grow the index.
+ */
+ZDTM_EXPORT int zdtm_mirror_put(zdtm_mirror *p_mirror,
+    unsigned char sync_type, uint32_t sync_id,
+    struct zdtm_adr_msg_param *params, uint16_t num_params);
+
+/**
+ * Delete item from mirror store.
+ *
+ * The zdtm_mirror_delete function removes an item from the mirror store.
+ * @param p_mirror Pointer to the mirror store.
+ * @param sync_type The synchronization type of the item.
+ * @param sync_id The sync id of the item.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully deleted the item.
+ * @retval 1 The mirror store does not hold the item.
+ * @retval -2 Failed to append the record to the log file.
+ */
+ZDTM_EXPORT int zdtm_mirror_delete(zdtm_mirror *p_mirror,
+    unsigned char sync_type, uint32_t sync_id);
+
+/**
+ * Look up item in mirror store.
+ *
+ * The zdtm_mirror_lookup function looks up the version of an item held
+ * by the mirror store using only the memory mapped index. Comparing the
+ * content hash against zdtm_mirror_hash() of freshly obtained params
+ * tells if the held version is identical.
+ * @param p_mirror Pointer to the mirror store.
+ * @param sync_id The sync id of the item.
+ * @param p_hash Pointer to variable to store the content hash in.
+ * @param p_offset Pointer to variable to store the log offset in, or NULL.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully found the item.
+ * @retval 1 The mirror store does not hold the item.
+ */
+ZDTM_EXPORT int zdtm_mirror_lookup(zdtm_mirror *p_mirror, uint32_t sync_id,
+    uint64_t *p_hash, uint32_t *p_offset);
+
+/**
+ * Read item from mirror store.
+ *
+ * The zdtm_mirror_read function reads the params of the version of an
+ * item held by the mirror store into a DTM box record view, which can
+ * then be handed to zdtm_dtm_record_field() or zdtm_dtm_record_item().
+ * The view is only valid until the mirror store is next read from or
+ * written to.
+ * @param p_mirror Pointer to the mirror store.
+ * @param sync_id The sync id of the item.
+ * @param p_rec Pointer to zdtm_dtm_record struct to store the view in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully read the item.
+ * @retval 1 The mirror store does not hold the item.
+ * @retval -1 Failed to read the record from the log file.
+ * @retval -2 Failed to allocate memory for the record.
+ * @retval -3 Failed, the record is malformed.
+ */
+ZDTM_EXPORT int zdtm_mirror_read(zdtm_mirror *p_mirror, uint32_t sync_id,
+    struct zdtm_dtm_record *p_rec);
+
+/**
+ * Obtain next item of mirror store.
+ *
+ * The zdtm_mirror_next function walks the items held by the mirror
+ * store in no particular order. The cursor is to be set to zero to
+ * start the walk and must not be reused once the mirror store has been
+ * modified.
+ * @param p_mirror Pointer to the mirror store.
+ * @param p_cursor Pointer to the position of the walk.
+ * @param p_sync_id Pointer to variable to store the sync id in.
+ * @param p_hash Pointer to variable to store the content hash in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully obtained the next item.
+ * @retval 1 There are no more items.
+ */
+ZDTM_EXPORT int zdtm_mirror_next(zdtm_mirror *p_mirror, uint32_t *p_cursor,
+    uint32_t *p_sync_id, uint64_t *p_hash);
+
+/**
+ * Count items of mirror store.
+ *
+ * The zdtm_mirror_count function obtains the number of items held by
+ * the mirror store.
+ * @param p_mirror Pointer to the mirror store.
+ * @return The number of items held by the mirror store.
+ */
+ZDTM_EXPORT uint32_t zdtm_mirror_count(zdtm_mirror *p_mirror);
+
+#endif
@@ -91,6 +91,24 @@ int _zdtm_clean_message(zdtm_msg *p_msg) {
         p_msg->body.p_raw_content = NULL;
     }
 
+    /* Cleanup ALR Messages. */
+    if (memcmp(p_msg->body.type, ALR_MSG_TYPE, MSG_TYPE_SIZE) == 0){
+        if(p_msg->body.cont.alr.entries != NULL){
+            free(p_msg->body.cont.alr.entries);
+            p_msg->body.cont.alr.entries = NULL;
+        }
+    }
+
+    /* Cleanup ASY Messages, less the lists a step took over. */
+    if (memcmp(p_msg->body.type, ASY_MSG_TYPE, MSG_TYPE_SIZE) == 0){
+        free(p_msg->body.cont.asy.new_sync_ids);
+        free(p_msg->body.cont.asy.mod_sync_ids);
+        free(p_msg->body.cont.asy.del_sync_ids);
+        p_msg->body.cont.asy.new_sync_ids = NULL;
+        p_msg->body.cont.asy.mod_sync_ids = NULL;
+        p_msg->body.cont.asy.del_sync_ids = NULL;
+    }
+
     /* Cleanup RRL Messages. */
     if (memcmp(p_msg->body.type, RRL_MSG_TYPE, MSG_TYPE_SIZE) == 0){
         if(p_msg->body.cont.rrl.pw != NULL){
@@ -102,10 +120,76 @@ int _zdtm_clean_message(zdtm_msg *p_msg) {
     return 0;
 }
 
+/**
+ * Write the content of a message.
+ *
+ * The _zdtm_write_content function writes the raw content of the given
+ * message with the writer of its type.
+ * @param p_wr Pointer to the writer to write the content with.
+ * @param p_msg Pointer to the message to write the content of.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully wrote the content.
+ * @retval RET_UNK_TYPE Failed, unknown message type.
+ * @retval RET_BAD_SIZE Failed, the content does not fit the writer.
+ * @retval RET_UNK_VAR Failed, unknown variation for RDW message.
+ */
+static int _zdtm_write_content(zdtm_writer *p_wr, zdtm_msg *p_msg) {
+    if(IS_RRL(p_msg)) {
+        return zdtm_rrl_write(p_wr, &p_msg->body.cont.rrl);
+
+    }else if(IS_RMG(p_msg)){
+        return zdtm_rmg_write(p_wr, &p_msg->body.cont.rmg);
+
+    }else if(IS_RMS(p_msg)){
+        return zdtm_rms_write(p_wr, &p_msg->body.cont.rms);
+
+    }else if(IS_RTS(p_msg)){
+        return zdtm_rts_write(p_wr, &p_msg->body.cont.rts);
+
+    }else if(IS_RDI(p_msg)){
+        return zdtm_rdi_write(p_wr, &p_msg->body.cont.rdi);
+
+    }else if(IS_RSY(p_msg)){
+        return zdtm_rsy_write(p_wr, &p_msg->body.cont.rsy);
+
+    }else if(IS_RSS(p_msg)){
+        return zdtm_rss_write(p_wr, &p_msg->body.cont.rss);
+
+    }else if(IS_RDR(p_msg)){
+        return zdtm_rdr_write(p_wr, &p_msg->body.cont.rdr);
+
+    }else if(IS_RDW(p_msg)){
+        return zdtm_rdw_write(p_wr, &p_msg->body.cont.rdw);
+
+    }else if(IS_RDD(p_msg)){
+        return zdtm_rdd_write(p_wr, &p_msg->body.cont.rdd);
+
+    }else if(IS_RDS(p_msg)){
+        return zdtm_rds_write(p_wr, &p_msg->body.cont.rds);
+
+    }else if(IS_RQT(p_msg)){
+        return zdtm_rqt_write(p_wr, &p_msg->body.cont.rqt);
+
+    }else if(IS_RLR(p_msg)){
+        return zdtm_rlr_write(p_wr, &p_msg->body.cont.rlr);
+
+    }else if(IS_RGE(p_msg)){
+        return zdtm_rge_write(p_wr, &p_msg->body.cont.rge);
+
+    }else if(IS_RAY(p_msg) || IS_RIG(p_msg) || IS_RTG(p_msg)) {
+        // No additional content
+        return 0;
+
+    }
+
+    return RET_UNK_TYPE;
+}
+
 int _zdtm_prepare_message(zdtm_lib_env *cur_env, zdtm_msg *p_msg) {
     
     void *p_body;
-    uint16_t *p_cont_size;
+    zdtm_writer wr;
+    int size, r;
 
     // First we will calculate the body size -- all messages have
     // the message type.
@@ -136,7 +220,9 @@ int _zdtm_prepare_message(zdtm_lib_env *cur_env, zdtm_msg *p_msg) {
         p_msg->body_size += zdtm_rdr_length(&p_msg->body.cont.rdr);
 
     }else if(IS_RDW(p_msg)) {
-        p_msg->body_size += zdtm_rdw_length(&p_msg->body.cont.rdw);
+        size = zdtm_rdw_length(&p_msg->body.cont.rdw);
+        if (size < 0) return size;
+        p_msg->body_size += size;
 
     }else if(IS_RDD(p_msg)){
         p_msg->body_size += zdtm_rdd_length(&p_msg->body.cont.rdd);
@@ -164,16 +250,9 @@ int _zdtm_prepare_message(zdtm_lib_env *cur_env, zdtm_msg *p_msg) {
     // The cont_size is the body - the type size
     p_msg->cont_size = p_msg->body_size - MSG_TYPE_SIZE;
 
-    // Set up the header
+    // Set up the header, along with the content size
     memcpy(p_msg->header, DMSG_HDR, MSG_HDR_SIZE);
-    // Write the content size;
-    p_cont_size = (uint16_t *)(p_msg->header + MSG_HDR_CONT_OFFSET);
-
-#ifdef WORDS_BIGENDIAN
-    *p_cont_size = zdtm_liltobigs(p_msg->cont_size);
-#else
-    *p_cont_size = p_msg->cont_size;
-#endif
+    zdtm_put_le16(p_msg->header + MSG_HDR_CONT_OFFSET, p_msg->cont_size);
 
     // Initialize the raw content.
     if(p_msg->body.p_raw_content != NULL) return RET_NNULL_RAW;
@@ -183,82 +262,87 @@ int _zdtm_prepare_message(zdtm_lib_env *cur_env, zdtm_msg *p_msg) {
     if (p_body == NULL) {
         return -1;
     }
+    zdtm_wr_init(&wr, p_body, p_msg->cont_size);
 
     // Fill in the rest for non-trivial messages
-    if(IS_RRL(p_msg)) {
-        p_body = zdtm_rrl_write(p_body, &p_msg->body.cont.rrl);
+    r = _zdtm_write_content(&wr, p_msg);
+    if (r != 0) return r;
 
-    }else if(IS_RMG(p_msg)){
-        p_body = zdtm_rmg_write(p_body, &p_msg->body.cont.rmg);
-
-    }else if(IS_RMS(p_msg)){
-        p_body = zdtm_rms_write(p_body, &p_msg->body.cont.rms);
+    // The content written must be exactly the size computed for it.
+    if (zdtm_wr_left(&wr) != 0) return RET_SIZE_MISMATCH;
 
-        /*
-        if(p_body == NULL) return RET_BAD_SIZE;
-        */
-
-    }else if(IS_RTS(p_msg)){
-        p_body = zdtm_rts_write(p_body, &p_msg->body.cont.rts);
-
-    }else if(IS_RDI(p_msg)){
-        p_body = zdtm_rdi_write(p_body, &p_msg->body.cont.rdi);
-
-    }else if(IS_RSY(p_msg)){
-        p_body = zdtm_rsy_write(p_body, &p_msg->body.cont.rsy);
-
-    }else if(IS_RSS(p_msg)){
-        p_body = zdtm_rss_write(p_body, &p_msg->body.cont.rss);
-
-    }else if(IS_RDR(p_msg)){
-        p_body = zdtm_rdr_write(p_body, &p_msg->body.cont.rdr);
-
-    }else if(IS_RDW(p_msg)){
-        p_body = zdtm_rdw_write(p_body, &p_msg->body.cont.rdw);
+    // The checksum is the sum of the type and of the content written.
+    p_msg->check_sum = wr.sum;
+    for (size = 0; size < MSG_TYPE_SIZE; size++) {
+        p_msg->check_sum += (unsigned char)p_msg->body.type[size];
+    }
 
-        if(p_body == NULL) return RET_UNK_TYPE;
+    return 0; 
+}
 
-    }else if(IS_RDD(p_msg)){
-        p_body = zdtm_rdd_write(p_body, &p_msg->body.cont.rdd);
+int _zdtm_write_message(zdtm_msg *p_msg, unsigned char *buf, uint32_t cap,
+    uint32_t *p_size) {
 
-    }else if(IS_RDS(p_msg)){
-        p_body = zdtm_rds_write(p_body, &p_msg->body.cont.rds);
+    zdtm_writer wr;
+    unsigned char *p_cont;
+    uint32_t room;
+    int i, r;
 
-    }else if(IS_RQT(p_msg)){
-        p_body = zdtm_rqt_write(p_body, &p_msg->body.cont.rqt);
+    if (cap < ZDTM_MSG_OVERHEAD) {
+        return RET_BAD_SIZE;
+    }
 
-    }else if(IS_RLR(p_msg)){
-        p_body = zdtm_rlr_write(p_body, &p_msg->body.cont.rlr);
+    // The content goes past the header, body size, and type, which are
+    // filled in once its size is known.
+    p_cont = buf + MSG_HDR_SIZE + sizeof(uint16_t) + MSG_TYPE_SIZE;
+    room = cap - ZDTM_MSG_OVERHEAD;
+    if (room > ZDTM_MSG_MAX_CONT) {
+        room = ZDTM_MSG_MAX_CONT;
+    }
+    zdtm_wr_init(&wr, p_cont, room);
 
-    }else if(IS_RGE(p_msg)){
-        p_body = zdtm_rge_write(p_body, &p_msg->body.cont.rge);
+    r = _zdtm_write_content(&wr, p_msg);
+    if (r != 0) return r;
 
+    p_msg->cont_size = (uint16_t)(wr.pos - p_cont);
+    p_msg->body_size = p_msg->cont_size + MSG_TYPE_SIZE;
+    memcpy(p_msg->header, DMSG_HDR, MSG_HDR_SIZE);
+    zdtm_put_le16(p_msg->header + MSG_HDR_CONT_OFFSET, p_msg->cont_size);
 
+    p_msg->check_sum = wr.sum;
+    for (i = 0; i < MSG_TYPE_SIZE; i++) {
+        p_msg->check_sum += (unsigned char)p_msg->body.type[i];
     }
 
-    // Compute the checksum -- sill in host byte order
-    p_msg->check_sum = _zdtm_checksum(p_msg);
+    // Back-patch the parts that depend on the size of the content.
+    memcpy(buf, p_msg->header, MSG_HDR_SIZE);
+    zdtm_put_le16(buf + MSG_HDR_SIZE, p_msg->body_size);
+    memcpy(buf + MSG_HDR_SIZE + sizeof(uint16_t), p_msg->body.type,
+        MSG_TYPE_SIZE);
+    zdtm_put_le16(wr.pos, p_msg->check_sum);
 
-    return 0; 
+    (*p_size) = ZDTM_MSG_OVERHEAD + p_msg->cont_size;
+
+    return 0;
 }
 
 int _zdtm_parse_raw_msg(zdtm_msg *p_msg) {
 
     if (IS_AAY(p_msg)) {
         if (zdtm_parse_raw_aay_msg(p_msg->body.p_raw_content,
-                    &p_msg->body.cont.aay))
+                    p_msg->cont_size, &p_msg->body.cont.aay))
             return -1;
     } else if (IS_AIG(p_msg)) {
         if (zdtm_parse_raw_aig_msg(p_msg->body.p_raw_content,
-                    &p_msg->body.cont.aig))
+                    p_msg->cont_size, &p_msg->body.cont.aig))
             return -2;
     } else if (IS_AMG(p_msg)) {
         if (zdtm_parse_raw_amg_msg(p_msg->body.p_raw_content,
-                    &p_msg->body.cont.amg))
+                    p_msg->cont_size, &p_msg->body.cont.amg))
             return -3;
     } else if (IS_ATG(p_msg)) {
         if (zdtm_parse_raw_atg_msg(p_msg->body.p_raw_content,
-                    &p_msg->body.cont.atg))
+                    p_msg->cont_size, &p_msg->body.cont.atg))
             return -4;
     } else if (IS_AEX(p_msg)) {
         /*
@@ -266,29 +350,37 @@ int _zdtm_parse_raw_msg(zdtm_msg *p_msg) {
          * is no content inside the AEX messages. Hence, there is
          * nothing to parse.
         if (zdtm_parse_raw_aex_msg(p_msg->body.p_raw_content,
-                    &p_msg->body.cont.aex))
+                    p_msg->cont_size, &p_msg->body.cont.aex))
             return -5;
          */
     } else if (IS_ANG(p_msg)) {
         if (zdtm_parse_raw_ang_msg(p_msg->body.p_raw_content,
-                    &p_msg->body.cont.ang))
+                    p_msg->cont_size, &p_msg->body.cont.ang))
             return -6;
     } else if (IS_ADI(p_msg)) {
         if (zdtm_parse_raw_adi_msg(p_msg->body.p_raw_content,
-                    &p_msg->body.cont.adi))
+                    p_msg->cont_size, &p_msg->body.cont.adi))
             return -7;
     } else if (IS_ASY(p_msg)) {
         if (zdtm_parse_raw_asy_msg(p_msg->body.p_raw_content,
-                    &p_msg->body.cont.asy))
+                    p_msg->cont_size, &p_msg->body.cont.asy))
             return -8;
     } else if (IS_ADR(p_msg)) {
         if (zdtm_parse_raw_adr_msg(p_msg->body.p_raw_content,
-                    &p_msg->body.cont.adr))
+                    p_msg->cont_size, &p_msg->body.cont.adr))
             return -9;
     } else if (IS_ADW(p_msg)) {
         if (zdtm_parse_raw_adw_msg(p_msg->body.p_raw_content,
-                    &p_msg->body.cont.adw))
+                    p_msg->cont_size, &p_msg->body.cont.adw))
             return -10;
+    } else if (IS_ALR(p_msg)) {
+        if (zdtm_parse_raw_alr_msg(p_msg->body.p_raw_content,
+                    p_msg->cont_size, &p_msg->body.cont.alr))
+            return -11;
+    } else if (IS_AGE(p_msg)) {
+        if (zdtm_parse_raw_age_msg(p_msg->body.p_raw_content,
+                    p_msg->cont_size, &p_msg->body.cont.age))
+            return -12;
     } else {
         return -255;
     }
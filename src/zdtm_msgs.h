@@ -42,6 +42,8 @@
 #include "zdtm_asy_msg.h"
 #include "zdtm_atg_msg.h"
 #include "zdtm_adw_msg.h"
+#include "zdtm_age_msg.h"
+#include "zdtm_alr_msg.h"
 
 #include "zdtm_ray_msg.h"
 #include "zdtm_rig_msg.h"
@@ -82,6 +84,8 @@ struct zdtm_message_body {
         struct zdtm_adr_msg_content adr;
         struct zdtm_asy_msg_content asy;
         struct zdtm_adw_msg_content adw;
+        struct zdtm_age_msg_content age;
+        struct zdtm_alr_msg_content alr;
 
         // Content structures for Qtopia Desktop messages
         struct zdtm_ray_msg_content ray;
@@ -201,11 +205,34 @@ int _zdtm_clean_message(zdtm_msg *p_msg);
  * @retval RET_NNULL_RAW Failed, raw message not null.
  * @retval RET_UNK_TYPE Failed, unknown message type. 
  * @retval RET_BAD_SIZE Failed, size field bad.
+ * @retval RET_SIZE_MISMATCH Failed, the content written is not its size.
  * @retval -1 Failed to allocate memory for raw content.
  * @return RET_UNK_VAR  Failed, unknown variation for RDW message.
  */
 int _zdtm_prepare_message(zdtm_lib_env *cur_env, zdtm_msg *p_msg);
 
+/**
+ * Write a message.
+ *
+ * The _zdtm_write_message function lays out the given message in the
+ * form it is written to the Zaurus in, straight into buf, in a single
+ * pass over its content. The header, body size, and type are filled in
+ * once the content is written and the checksum is summed as the content
+ * is written. The header, body_size, cont_size, and check_sum of p_msg
+ * are filled in as well, but no raw content is allocated.
+ * @param p_msg Pointer to the message to write.
+ * @param buf Pointer to the buffer to write the message into.
+ * @param cap The size of the buffer.
+ * @param p_size Pointer to store the size of the written message in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully wrote the message.
+ * @retval RET_UNK_TYPE Failed, unknown message type.
+ * @retval RET_BAD_SIZE Failed, the message does not fit in buf.
+ * @retval RET_UNK_VAR Failed, unknown variation for RDW message.
+ */
+int _zdtm_write_message(zdtm_msg *p_msg, unsigned char *buf, uint32_t cap,
+    uint32_t *p_size);
+
 /**
  * Parse a raw message.
  *
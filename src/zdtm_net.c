@@ -30,171 +30,229 @@
 #include "zdtm_net.h"
 
 int _zdtm_listen_for_zaurus(zdtm_lib_env *cur_env) {
-    struct sockaddr_in servaddr;
-    int retval;
-    int reuse_set_flag;
+    zdtm_transport *p_tp;
+    int r;
 
-    reuse_set_flag = 1;
+    p_tp = cur_env->transport;
 
-    cur_env->listenfd = socket(AF_INET, SOCK_STREAM, 0);
-    if (cur_env->listenfd == INVALID_SOCKET) {
-        perror("_zdtm_listen_for_zaurus - socket");
-        return -1;
+    r = p_tp->listen(p_tp, NULL, DLISTPORT, &cur_env->listenfd);
+    if (r != 0) {
+        _zdtm_log_error(cur_env, "_zdtm_listen_for_zaurus: listen", r);
     }
 
-    // Here I set a socket option so that if the applications ends
-    // prematurely the socket is not blocked by the TIME_WAIT state.
-#ifdef WIN32
-    retval = setsockopt(cur_env->listenfd, SOL_SOCKET, SO_REUSEADDR,
-        (const char *)&reuse_set_flag, (socklen_t)sizeof(reuse_set_flag));
-#else
-    retval = setsockopt(cur_env->listenfd, SOL_SOCKET, SO_REUSEADDR,
-        (const void *)&reuse_set_flag, (socklen_t)sizeof(reuse_set_flag));
-#endif
-    if (retval == SOCKET_ERROR) {
-        perror("_zdtm_listen_for_zaurus - setsockopt");
-        return -2;
-    }
+    return r;
+}
+
+int _zdtm_stop_listening(zdtm_lib_env *cur_env) {
+    zdtm_transport *p_tp;
 
-    memset(&servaddr, 0, sizeof(servaddr));
-    servaddr.sin_family = AF_INET;
-    servaddr.sin_addr.s_addr = htonl(INADDR_ANY);
-    servaddr.sin_port = htons(DLISTPORT);
+    p_tp = cur_env->transport;
 
-    retval = bind(cur_env->listenfd, (struct sockaddr *)&servaddr,
-        (socklen_t)sizeof(servaddr));
-    if (retval == SOCKET_ERROR) {
-        perror("_zdtm_listen_for_zaurus - bind");
-        return -3;
+    if (p_tp->close(p_tp, cur_env->listenfd) != 0) {
+        _zdtm_log_error(cur_env, "_zdtm_stop_listening: close", -1);
+        return -1;
     }
+    
+    return 0;
+}
+
+/**
+ * Prepare connection.
+ *
+ * The _zdtm_prepare_conn function switches a new connection to
+ * non-blocking mode when the environment has an I/O deadline and the
+ * transport has such a mode, so that no read or write can block past
+ * the deadline.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param sockfd The new connection.
+ * @return An integer representing success (zero) or failure (non-zero).
+ */
+static int _zdtm_prepare_conn(zdtm_lib_env *cur_env, SOCKET sockfd) {
+    zdtm_transport *p_tp;
 
-    retval = listen(cur_env->listenfd, 1);
-    if (retval == SOCKET_ERROR) {
-        perror("_zdtm_listen_for_zaurus - listen");
-        return -4;
+    p_tp = cur_env->transport;
+
+    if ((cur_env->io_timeout >= 0) && (p_tp->nonblock != NULL)) {
+        return p_tp->nonblock(p_tp, sockfd);
     }
 
-    // Return success
     return 0;
 }
 
-int _zdtm_stop_listening(zdtm_lib_env *cur_env) {
-    int retval;
+/**
+ * Await connection.
+ *
+ * The _zdtm_await_conn function waits up to the I/O deadline of the
+ * environment for the given events on a connection, recording it in
+ * the environment if the deadline passed.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param sockfd The connection.
+ * @param events The ZDTM_POLL_ events to wait for.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully waited for the events.
+ * @retval -1 Failed to wait for the events.
+ * @retval RET_IO_TIMEOUT The deadline passed first.
+ */
+static int _zdtm_await_conn(zdtm_lib_env *cur_env, SOCKET sockfd,
+    int events) {
+
+    zdtm_transport *p_tp;
+    int r;
+
+    p_tp = cur_env->transport;
 
-#ifdef WIN32
-    retval = closesocket(cur_env->listenfd);
-#else
-    retval = close(cur_env->listenfd);
-#endif
-    if (retval == SOCKET_ERROR) {
-        perror("_zdtm_stop_listening - close");
+    r = p_tp->poll(p_tp, sockfd, events, cur_env->io_timeout);
+    if (r < 0) {
         return -1;
+    } else if (r == 0) {
+        cur_env->timed_out = RET_IO_TIMEOUT;
+        return RET_IO_TIMEOUT;
     }
-    
+
     return 0;
 }
 
+/**
+ * Transfer over connection.
+ *
+ * The _zdtm_conn_io function reads into or writes from a buffer over a
+ * connection, waiting no longer than the I/O deadline of the
+ * environment for the connection to become ready. Transports which
+ * can not be made non-blocking are waited for before every transfer,
+ * the others only when they report that the transfer would block.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param sockfd The connection.
+ * @param events ZDTM_POLL_IN to read, ZDTM_POLL_OUT to write.
+ * @param p_iov Pointer to the buffer to transfer.
+ * @return The number of bytes transferred, zero if the other end closed
+ * the connection, -1 on failure, or RET_IO_TIMEOUT if the deadline
+ * passed first.
+ */
+static zdtm_ssize_t _zdtm_conn_io(zdtm_lib_env *cur_env, SOCKET sockfd,
+    int events, const struct zdtm_iovec *p_iov) {
+
+    zdtm_transport *p_tp;
+    zdtm_ssize_t bytes;
+    int r;
+
+    p_tp = cur_env->transport;
+
+    if ((cur_env->io_timeout >= 0) && (p_tp->nonblock == NULL)) {
+        r = _zdtm_await_conn(cur_env, sockfd, events);
+        if (r != 0) { return r; }
+    }
+
+    for (;;) {
+        if (events == ZDTM_POLL_IN) {
+            bytes = p_tp->readv(p_tp, sockfd, p_iov, 1);
+        } else {
+            bytes = p_tp->writev(p_tp, sockfd, p_iov, 1);
+        }
+        if (bytes != ZDTM_TRANSPORT_AGAIN) {
+            return (bytes < 0) ? -1 : bytes;
+        }
+
+        r = _zdtm_await_conn(cur_env, sockfd, events);
+        if (r != 0) { return r; }
+    }
+}
+
 int _zdtm_handle_zaurus_conn(zdtm_lib_env *cur_env) {
-    struct sockaddr_in clntaddr;
-    socklen_t len;
-    /*
-    char source_addr[16];
-    char *retval;
-    */
-
-    memset(&clntaddr, 0, sizeof(clntaddr));
-    len = sizeof(clntaddr);
-    cur_env->connfd = accept(cur_env->listenfd,
-        (struct sockaddr *)&clntaddr, &len);
-    if (cur_env->connfd == INVALID_SOCKET) {
-        perror("_zdtm_handle_zaurus_connection - accept");
-        return -1;
+    zdtm_transport *p_tp;
+    int r;
+
+    p_tp = cur_env->transport;
+
+    if (cur_env->accept_timeout >= 0) {
+        r = p_tp->poll(p_tp, cur_env->listenfd, ZDTM_POLL_IN,
+            cur_env->accept_timeout);
+        if (r < 0) {
+            return -1;
+        } else if (r == 0) {
+            cur_env->timed_out = RET_ACCEPT_TIMEOUT;
+            return RET_ACCEPT_TIMEOUT;
+        }
     }
 
-    /*
-    retval = (char *)inet_ntop(AF_INET, &clntaddr.sin_addr,
-        source_addr, 16);
-    if (retval == NULL) {
-        perror("_zdtm_handle_zaurus_connection - inet_ntop");
-        return -2;
+    r = p_tp->accept(p_tp, cur_env->listenfd, &cur_env->connfd);
+    if (r != 0) {
+        _zdtm_log_error(cur_env, "_zdtm_handle_zaurus_conn: accept", r);
+        return -1;
     }
 
-    printf("_zdtm_handle_zaurus_connection: Received connection from \
-        %s, port %d.\n", source_addr, ntohs(clntaddr.sin_port));
-    */
+    if (_zdtm_prepare_conn(cur_env, cur_env->connfd) != 0) {
+        p_tp->close(p_tp, cur_env->connfd);
+        cur_env->connfd = INVALID_SOCKET;
+        return -1;
+    }
 
     // Return in success.
     return 0;
 }
 
 int _zdtm_close_zaurus_conn(zdtm_lib_env *cur_env) {
-    int retval;
+    zdtm_transport *p_tp;
+
+    p_tp = cur_env->transport;
+
+    if (cur_env->connfd == INVALID_SOCKET) {
+        return 0;
+    }
 
-#ifdef WIN32
-    retval = closesocket(cur_env->connfd);
-#else
-    retval = close(cur_env->connfd);
-#endif
-    if (retval == SOCKET_ERROR) {
-        perror("_zdtm_close_zaurus_conn - close");
+    if (p_tp->close(p_tp, cur_env->connfd) != 0) {
         return -1;
     }
+    cur_env->connfd = INVALID_SOCKET;
     
     return 0;
 }
 
 int _zdtm_conn_to_zaurus(zdtm_lib_env *cur_env, const char *zaurus_ip) {
-    struct sockaddr_in servaddr;
-    int retval;
+    zdtm_transport *p_tp;
+    int r;
 
-    cur_env->reqfd = socket(AF_INET, SOCK_STREAM, 0);
-    if (cur_env->reqfd == INVALID_SOCKET) {
-        perror("_zdtm_conn_to_zaurus - socket");
-        return -1;
-    }
+    p_tp = cur_env->transport;
 
-    memset(&servaddr, 0, sizeof(struct sockaddr_in));
-    servaddr.sin_family = AF_INET;
-    servaddr.sin_port = htons(ZLISTPORT);
-#ifdef WIN32
-    servaddr.sin_addr.s_addr = inet_addr(zaurus_ip);
-    if (servaddr.sin_addr.s_addr == INADDR_NONE) {
-        return -2;
-    }
-#else
-    if (inet_pton(AF_INET, zaurus_ip, &servaddr.sin_addr) <= 0) {
-        perror("_zdtm_conn_to_zaurus - inet_pton");
-        return -2;
+    r = p_tp->connect(p_tp, zaurus_ip, ZLISTPORT, cur_env->connect_timeout,
+        &cur_env->reqfd);
+    if (r == ZDTM_TRANSPORT_TIMEOUT) {
+        cur_env->timed_out = RET_CONNECT_TIMEOUT;
+        return RET_CONNECT_TIMEOUT;
+    } else if (r != 0) {
+        _zdtm_log_error(cur_env, "_zdtm_conn_to_zaurus: connect", r);
+        return r;
     }
-#endif
 
-    retval = connect(cur_env->reqfd, (struct sockaddr *)&servaddr,
-        sizeof(struct sockaddr));
-    if(retval == SOCKET_ERROR) {
-        perror("_zdtm_conn_to_zaurus - connect");
-        return -3;
+    if (_zdtm_prepare_conn(cur_env, cur_env->reqfd) != 0) {
+        p_tp->close(p_tp, cur_env->reqfd);
+        cur_env->reqfd = INVALID_SOCKET;
+        return -5;
     }
 
     return 0;
 }
 
 int _zdtm_close_conn_to_zaurus(zdtm_lib_env *cur_env) {
-    int retval;
+    zdtm_transport *p_tp;
+
+    p_tp = cur_env->transport;
+
+    if (cur_env->reqfd == INVALID_SOCKET) {
+        return 0;
+    }
 
-#ifdef WIN32
-    retval = closesocket(cur_env->reqfd);
-#else
-    retval = close(cur_env->reqfd);
-#endif
-    if (retval == SOCKET_ERROR) {
-        perror("_zdtm_close_conn_to_zaurus - close");
+    if (p_tp->close(p_tp, cur_env->reqfd) != 0) {
         return -1;
     }
+    cur_env->reqfd = INVALID_SOCKET;
 
     return 0;
 }
 
-int _zdtm_send_comm_message_to(SOCKET sockfd, char *data) {
+int _zdtm_send_comm_message_to(zdtm_lib_env *cur_env, SOCKET sockfd,
+    char *data) {
+
+    struct zdtm_iovec iov;
     int bytes_to_send;
     zdtm_ssize_t bytes_sent;
     zdtm_ssize_t tot_bytes_sent;
@@ -203,10 +261,12 @@ int _zdtm_send_comm_message_to(SOCKET sockfd, char *data) {
 
     tot_bytes_sent = 0;
     while (tot_bytes_sent < bytes_to_send) {
-        bytes_sent = send(sockfd, (const zdtm_buf_t)data,
-            (zdtm_size_t)(bytes_to_send - tot_bytes_sent), 0);
-        if (bytes_sent < 0) {
-            perror("_zdtm_send_comm_message_to - send");
+        iov.base = data + tot_bytes_sent;
+        iov.len = (zdtm_size_t)(bytes_to_send - tot_bytes_sent);
+        bytes_sent = _zdtm_conn_io(cur_env, sockfd, ZDTM_POLL_OUT, &iov);
+        if (bytes_sent == RET_IO_TIMEOUT) {
+            return RET_IO_TIMEOUT;
+        } else if (bytes_sent < 0) {
             return -1;
         }
 
@@ -221,7 +281,8 @@ int _zdtm_send_ack_message(zdtm_lib_env *cur_env) {
     char msg_data[COM_MSG_SIZE] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x96,
         0x06};
 
-    retval = _zdtm_send_comm_message_to(cur_env->connfd, msg_data);
+    retval = _zdtm_send_comm_message_to(cur_env, cur_env->connfd,
+        msg_data);
     return retval;
 }
 
@@ -230,7 +291,8 @@ int _zdtm_send_rqst_message(zdtm_lib_env *cur_env) {
     char msg_data[COM_MSG_SIZE] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x96,
         0x05};
 
-    retval = _zdtm_send_comm_message_to(cur_env->connfd, msg_data);
+    retval = _zdtm_send_comm_message_to(cur_env, cur_env->connfd,
+        msg_data);
     return retval;
 }
 
@@ -239,337 +301,195 @@ int _zdtm_send_abrt_message(zdtm_lib_env *cur_env) {
     char msg_data[COM_MSG_SIZE] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x96,
         0x18};
 
-    retval = _zdtm_send_comm_message_to(cur_env->connfd, msg_data);
+    retval = _zdtm_send_comm_message_to(cur_env, cur_env->connfd,
+        msg_data);
     return retval;
 }
 
-int _zdtm_recv_message(zdtm_lib_env *cur_env, zdtm_msg *p_msg) {
-    unsigned char header[MSG_HDR_SIZE + sizeof(uint16_t)];
-    unsigned char *buff;
-    unsigned char *cur_buff_pos;
-    unsigned char *tmp_p;
-    uint16_t body_size;
-    uint16_t check_sum;
-    zdtm_ssize_t bytes_to_read;
-    zdtm_ssize_t tot_bytes_read;
-    zdtm_ssize_t bytes_read;
-
-    bytes_to_read = COM_MSG_SIZE;
-    tot_bytes_read = 0;
-    /* Attempt to read in a 7 byte common message. If the seven bytes
-     * are a common message then return with a value representing which
-     * common message was recveived. If the seven bytes read in are not
-     * a common message then assume that it is a general message and
-     * read the following 6 bytes of header in as well as the following
-     * 2 bytes representing the body size. */
-    while(tot_bytes_read < bytes_to_read) {
-        bytes_read = recv(cur_env->connfd,
-            (zdtm_buf_t)(header + tot_bytes_read),
-            (zdtm_size_t)(bytes_to_read - tot_bytes_read), 0);
-        if (bytes_read == 0) {
-            if (tot_bytes_read == 0) {
-                /* Socket was closed cleanly by opposite end. */
-                return -1;
-            } else {
-                /* Socket was closed on opposite end in mid of msg. */
-                return -2;
-            }
-        } else if (bytes_read == SOCKET_ERROR) {
-            /* error */
-            return -3;
+int _zdtm_drive_core(zdtm_core *p_core, SOCKET sockfd) {
+    zdtm_lib_env *cur_env;
+    struct zdtm_iovec iov;
+    const unsigned char *p_out;
+    unsigned char *p_in;
+    uint32_t size;
+    zdtm_ssize_t bytes;
+    int timed_out;
+
+    cur_env = p_core->env;
+    timed_out = 0;
+
+    while (!p_core->done) {
+        /* Once a deadline passed the connection is given up on, the
+         * step only being left to clean up after itself. */
+        if (timed_out) {
+            _zdtm_core_abort(p_core, ZDTM_CORE_IO_ERROR);
+            continue;
         }
-        tot_bytes_read += bytes_read;
-    }
-
-    /* If I made it this far then I know that 7 bytes have successfully
-     * been read in and I want to compare the 7 bytes to known common
-     * messages to see if it is one of the common messages or not. */
-    if (_zdtm_is_ack_message(header)) {
-        return 1;
-    } else if (_zdtm_is_rqst_message(header)) {
-        return 2;
-    } else if (_zdtm_is_abrt_message(header)) {
-        return 3;
-    }
 
-    bytes_to_read = MSG_HDR_SIZE + sizeof(uint16_t);
-    /* If I made it this far then I know that it is none of the know
-     * common messages. Hence, I assume that it is a general message and
-     * read in the reast of the message header and the body size. */
-    while(tot_bytes_read < bytes_to_read) {
-        bytes_read = recv(cur_env->connfd,
-            (zdtm_buf_t)(header + tot_bytes_read),
-            (zdtm_size_t)(bytes_to_read - tot_bytes_read), 0);
-        if (bytes_read == 0) {
-            if (tot_bytes_read == 0) {
-                /* Socket was closed cleanly by opposite end. */
-                return -1;
+        /* Write out whatever the core has to say first. */
+        size = _zdtm_core_output(p_core, &p_out);
+        if (size > 0) {
+            iov.base = (void *)p_out;
+            iov.len = (zdtm_size_t)size;
+            bytes = _zdtm_conn_io(cur_env, sockfd, ZDTM_POLL_OUT, &iov);
+            if (bytes < 0) {
+                timed_out = (bytes == RET_IO_TIMEOUT);
+                _zdtm_core_abort(p_core, ZDTM_CORE_IO_ERROR);
             } else {
-                /* Socket was closed on opposite end in mid of msg. */
-                return -2;
+                _zdtm_core_written(p_core, (uint32_t)bytes);
             }
-        } else if (bytes_read == SOCKET_ERROR) {
-            /* error */
-            return -3;
+            continue;
         }
-        tot_bytes_read += bytes_read;
-    }
 
-    /* If I made it this far then I know that I have successfully read
-     * in the number of bytes used in a general message header as well
-     * as the following body size. */
-    tmp_p = header + MSG_HDR_SIZE;
-    body_size = *((uint16_t *)tmp_p);
-#ifdef WORDS_BIGENDIAN
-    body_size = zdtm_liltobigs(body_size);
-#endif
-
-    /* Now, I want to allocate memory necessary to temporarily store the
-     * body of the general message. Read in the general messages body
-     * and checksum. */
-    bytes_to_read = body_size + sizeof(uint16_t);
-    tot_bytes_read = 0;
-    buff = (unsigned char *)malloc((zdtm_size_t)bytes_to_read);
-    if (buff == NULL) {
-        perror("_zdtm_recv_message - malloc");
-        return -4;
-    }
-    
-    while(tot_bytes_read < bytes_to_read) {
-        bytes_read = recv(cur_env->connfd,
-            (zdtm_buf_t)(buff + tot_bytes_read),
-            (zdtm_size_t)(bytes_to_read - tot_bytes_read), 0);
-        if (bytes_read == 0) {
-            if (tot_bytes_read == 0) {
-                /* Socket was closed cleanly by opposite end. */
-                free((void *)buff);
-                return -1;
-            } else {
-                /* Socket was closed on opposite end in mid of msg. */
-                free((void *)buff);
-                return -2;
-            }
-        } else if (bytes_read == SOCKET_ERROR) {
-            /* error */
-            free((void *)buff);
-            return -3;
+        /* Then read exactly what the core asks for, so that nothing
+         * of a following message is consumed. */
+        size = _zdtm_core_want(p_core, &p_in);
+        if (size == 0) {
+            _zdtm_core_abort(p_core, ZDTM_CORE_IO_ERROR);
+            continue;
         }
-        tot_bytes_read += bytes_read;
-    }
 
-    /* If I made it this far I know that I have successfully read in the
-     * body size number of bytes as well as the following 2 bytes
-     * representing the checksum. */
-    tmp_p = buff + body_size;
-    check_sum = *((uint16_t *)tmp_p);
-#ifdef WORDS_BIGENDIAN
-    check_sum = zdtm_liltobigs(check_sum);
-#endif
-
-    /*
-     * Since it made it this far I know that it is an acceptable message
-     * based on size alone. Hence, I am going to need somewhere to put
-     * the data.
-     */
-    if (p_msg == NULL) {
-        free((void *)buff);
-        return -5;
+        iov.base = p_in;
+        iov.len = (zdtm_size_t)size;
+        bytes = _zdtm_conn_io(cur_env, sockfd, ZDTM_POLL_IN, &iov);
+        if (bytes == 0) {
+            _zdtm_core_abort(p_core, ZDTM_CORE_EOF);
+        } else if (bytes < 0) {
+            timed_out = (bytes == RET_IO_TIMEOUT);
+            _zdtm_core_abort(p_core, ZDTM_CORE_IO_ERROR);
+        } else {
+            _zdtm_core_received(p_core, (uint32_t)bytes);
+        }
     }
 
-    /*
-     * Check if the body raw content is initialized to NULL so that
-     * in-case of failure at some point so the user can determine if
-     * they need to free the content or not.
-     */
-    if (p_msg->body.p_raw_content != NULL) {
-        free((void *)buff);
-        return -6;
+    if (timed_out) {
+        return RET_IO_TIMEOUT;
     }
 
-    /*
-     * Now that I know the size is acceptable I am going to parse the
-     * data into the proper pieces to fill the zdtm_message structure so
-     * that the information may be easily obtained later on. Note, I am
-     * only parsing into to the raw portions. Later parsing will occur
-     * in a seperate function for each specific type of message.
-     */
-
-    // Set the zdtm_message header
-    memcpy((void *)p_msg->header, header, MSG_HDR_SIZE);
-
-    // Set the zdtm_message body size
-    p_msg->body_size = body_size;
-
-    cur_buff_pos = buff;
-    // Set the zdtm_message_body type
-    memcpy((void *)p_msg->body.type, (const void *)cur_buff_pos,
-        MSG_TYPE_SIZE);
-    cur_buff_pos = cur_buff_pos + MSG_TYPE_SIZE;
-
-    // Set the zdtm_message cont_size and the zdtm_message_body content
-    p_msg->cont_size = p_msg->body_size - MSG_TYPE_SIZE;
-    if (p_msg->cont_size > 0) {
-        p_msg->body.p_raw_content = malloc((size_t)p_msg->cont_size);
-        if (p_msg->body.p_raw_content == NULL) {
-            free((void *)buff);
-            // return signifying that malloc failed
-            perror("_zdtm_recv_message - malloc");
-            return RET_MEM_CONTENT;
-        }
-        memcpy(p_msg->body.p_raw_content, (const void *)cur_buff_pos,
-            p_msg->cont_size);
-        cur_buff_pos = cur_buff_pos + p_msg->cont_size;
-    }
+    return p_core->retval;
+}
 
-    // Set the zdtm_message check_sum
-    p_msg->check_sum = check_sum;
+int _zdtm_run_step(zdtm_lib_env *cur_env, zdtm_core *p_core,
+    zdtm_core_step step) {
 
-    // Free the temp message buffer since I am done with it
-    free((void *)buff);
+    _zdtm_core_start(p_core, step);
+    return _zdtm_drive_core(p_core, cur_env->connfd);
+}
 
-    /*
-     * At this point everything in the zdtm_message struct is filled in
-     * except for the p_msg->body.cont.
-     */
+int _zdtm_recv_message(zdtm_lib_env *cur_env, zdtm_msg *p_msg) {
+    zdtm_core core;
+    int r;
 
-    if (_zdtm_parse_raw_msg(p_msg) != 0) {
-        return RET_PARSE_RAW_FAIL;
+    _zdtm_core_init(&core, cur_env);
+    _zdtm_core_exchange(&core, ZDTM_XCHG_GET, NULL);
+    r = _zdtm_drive_core(&core, cur_env->connfd);
+    if (r == 0) {
+        if (p_msg == NULL) {
+            /* no where to store the message */
+            r = -5;
+        } else if (p_msg->body.p_raw_content != NULL) {
+            /* raw content not initialized to NULL */
+            r = -6;
+        } else {
+            memcpy(p_msg, &core.msg, sizeof(zdtm_msg));
+            memset(&core.msg, 0, sizeof(zdtm_msg));
+        }
     }
-    
-    _zdtm_dump_msg_log(cur_env, p_msg);
-    
-    return 0;
+    _zdtm_core_cleanup(&core);
+
+    return r;
 }
 
 int _zdtm_send_message(zdtm_lib_env *cur_env, zdtm_msg *p_msg) {
-    int retval;
+    zdtm_core core;
+    int r;
 
-    _zdtm_dump_msg_log(cur_env, p_msg);
+    _zdtm_core_init(&core, cur_env);
+    r = _zdtm_core_exchange(&core, ZDTM_XCHG_PUT, p_msg);
+    if (r == 0) {
+        r = _zdtm_drive_core(&core, cur_env->connfd);
+    }
+    _zdtm_core_cleanup(&core);
 
-    retval = _zdtm_send_message_to(cur_env, p_msg, cur_env->connfd);
-    return retval;
+    return r;
 }
 
-int _zdtm_send_message_to(zdtm_lib_env *cur_env, zdtm_msg *p_msg, int sockfd) {
-    void *p_wire_msg;
-    void *p_cur_pos;
-    unsigned int msg_size;
+int _zdtm_send_message_to(zdtm_lib_env *cur_env, zdtm_msg *p_msg,
+    SOCKET sockfd) {
+
+    struct zdtm_iovec iov;
+    unsigned char *p_wire_msg;
+    uint32_t msg_size, wire_cap;
     int retval;
     zdtm_ssize_t bytes_written;
     zdtm_ssize_t tot_bytes_written;
-    zdtm_ssize_t bytes_to_write;
 
     p_wire_msg = NULL;
+    wire_cap = 0;
 
-    retval = _zdtm_prepare_message(cur_env, p_msg);
+    retval = _zdtm_encode_message(cur_env, p_msg, &p_wire_msg, &wire_cap,
+        &msg_size);
     if (retval != 0) {
-        _zdtm_clean_message(p_msg);
-        return -1;
+        return retval;
     }
-    
-    msg_size = MSG_HDR_SIZE + sizeof(uint16_t) +p_msg->body_size + \
-               sizeof(uint16_t);
-
-    p_wire_msg = malloc((size_t)msg_size);
-    if (p_wire_msg == NULL) {
-        _zdtm_clean_message(p_msg);
-        return RET_MALLOC_FAIL;
-    }
-
-    p_cur_pos = p_wire_msg;
-
-    // Copy the header into the raw message
-    memcpy(p_cur_pos, (void *)p_msg->header, (size_t)MSG_HDR_SIZE);
-    p_cur_pos = p_cur_pos + MSG_HDR_SIZE;
-    
-    // Copy the body size into the raw message
-    memcpy(p_cur_pos, (void *)&p_msg->body_size, sizeof(uint16_t));
-    p_cur_pos = p_cur_pos + sizeof(uint16_t);
-
-    // Copy the message type into the raw message
-    memcpy(p_cur_pos, (void *)p_msg->body.type, (size_t)MSG_TYPE_SIZE);
-    p_cur_pos = p_cur_pos + MSG_TYPE_SIZE;
-
-    // Copy the message content into the raw message.
-    memcpy(p_cur_pos, p_msg->body.p_raw_content, (size_t)p_msg->cont_size);
-    p_cur_pos = p_cur_pos + p_msg->cont_size;
-
-    // Copy the message check sum into the raw message.
-    memcpy(p_cur_pos, (void *)&p_msg->check_sum, sizeof(uint16_t));
-    p_cur_pos = p_cur_pos + sizeof(uint16_t);
 
-    // At this point the wire message should be properly built.
-
-    bytes_to_write = msg_size;
     tot_bytes_written = 0;
-    while (tot_bytes_written < bytes_to_write) {
-        bytes_written = send(sockfd, (const zdtm_buf_t)p_wire_msg,
-            (zdtm_size_t)(bytes_to_write - tot_bytes_written), 0);
+    while (tot_bytes_written < msg_size) {
+        iov.base = p_wire_msg + tot_bytes_written;
+        iov.len = (zdtm_size_t)(msg_size - tot_bytes_written);
+        bytes_written = _zdtm_conn_io(cur_env, sockfd, ZDTM_POLL_OUT, &iov);
         if (bytes_written < 0) {
-            perror("_zdtm_send_message_to - send");
-            _zdtm_clean_message(p_msg);
             free(p_wire_msg);
-            return -2;
+            return (bytes_written == RET_IO_TIMEOUT) ? RET_IO_TIMEOUT : -2;
         }
 
         tot_bytes_written += bytes_written;
     }
 
-    _zdtm_clean_message(p_msg);
     free(p_wire_msg);
 
     return 0;
 }
 
 int _zdtm_wrapped_send_message(zdtm_lib_env *cur_env, zdtm_msg *msg) {
+    zdtm_core core;
     int r;
-    zdtm_msg rmsg;
-
-    /* recv rqst message */
-    memset(&rmsg, 0, sizeof(zdtm_msg));
-    r = _zdtm_recv_message(cur_env, &rmsg);
-    if (r != 2) {
-        _zdtm_clean_message(&rmsg); return -1; }
 
-    /* send general message */
-    r = _zdtm_send_message(cur_env, msg);
+    _zdtm_core_init(&core, cur_env);
+    r = _zdtm_core_exchange(&core, ZDTM_XCHG_SEND, msg);
     if (r != 0) {
-        _zdtm_clean_message(&rmsg); return -2; }
+        _zdtm_core_cleanup(&core);
+        return -2;
+    }
 
-    /* recv ack message */
-    memset(&rmsg, 0, sizeof(zdtm_msg));
-    r = _zdtm_recv_message(cur_env, &rmsg);
-    if (r != 1) {
-        _zdtm_clean_message(&rmsg); return -3; }
+    r = _zdtm_drive_core(&core, cur_env->connfd);
+    _zdtm_core_cleanup(&core);
 
-    return 0;
+    return r;
 }
 
 int _zdtm_wrapped_recv_message(zdtm_lib_env *cur_env, zdtm_msg *msg) {
+    zdtm_core core;
     int r;
 
-    /* send rqst message */
-    r = _zdtm_send_rqst_message(cur_env);
-    if (r != 0) {
-        _zdtm_log_error(cur_env, "_zdtm_send_rqst_message", r);
-        return -1;
-    }
-
-    /* recv general message */
-    r = _zdtm_recv_message(cur_env, msg);
+    _zdtm_core_init(&core, cur_env);
+    _zdtm_core_exchange(&core, ZDTM_XCHG_RECV, NULL);
+    r = _zdtm_drive_core(&core, cur_env->connfd);
     if (r < 0) {
-        _zdtm_log_error(cur_env, "_zdtm_recv_message", r);
-        return -2;
-    } else if (r > 0) {
-        return r;
+        _zdtm_log_error(cur_env, "_zdtm_wrapped_recv_message", r);
+    } else if (r == 0) {
+        memcpy(msg, &core.msg, sizeof(zdtm_msg));
+        memset(&core.msg, 0, sizeof(zdtm_msg));
     }
+    _zdtm_core_cleanup(&core);
 
-    /* send ack message */
-    r = _zdtm_send_ack_message(cur_env);
-    if (r != 0) {
-        _zdtm_log_error(cur_env, "_zdtm_send_ack_message", r);
-        return -3;
+    return r;
+}
+
+int _zdtm_timeout_result(zdtm_lib_env *cur_env, int retval) {
+    if ((retval < 0) && (cur_env->timed_out != 0)) {
+        return cur_env->timed_out;
     }
 
-    return 0;
+    return retval;
 }
@@ -32,12 +32,14 @@
 
 #include "zdtm_types.h"
 #include "zdtm_log.h"
+#include "zdtm_core.h"
 
 /**
  * Listen for an incoming synchronization connection from a Zaurus.
  *
  * The _zdtm_listen_for_zaurus function creates a socket and configures
- * it to listen for a synchronization connection from a Zaurus. Note:
+ * it to listen for a synchronization connection from a Zaurus, over
+ * the transport of the current environment. Note:
  * This function does not handle accepting a connection from the Zaurus
  * it just creates a socket and puts it in the proper state so that a
  * Zaurus may make a connection to it, which will be backlogged and can
@@ -74,24 +76,24 @@ int _zdtm_stop_listening(zdtm_lib_env *cur_env);
  * Zaurus connection if one exists. If no backlogged Zaurus connection
  * exists then _zdtm_handle_zaurus_connection will block waiting for a
  * Zaurus connection, at which point it will release after accepting the
- * connection from the Zaurus. Note: In order to handle a Zaurus
+ * connection from the Zaurus, or give up once the accept deadline of
+ * the environment passed. Note: In order to handle a Zaurus
  * connection one must first call _zdtm_listen_for_zaurus to be in the
  * correct state.
  * @param cur_env Pointer to the current zdtm library environment.
  * @return An integer representing success (zero) or failure (non-zero).
  * @retval 0 Successfully accepted a Zaurus connection.
  * @retval -1 Failed to accept a Zaurus connection.
+ * @retval RET_ACCEPT_TIMEOUT No Zaurus connection before the deadline.
  */
 int _zdtm_handle_zaurus_conn(zdtm_lib_env *cur_env);
 
 /**
  * Close the Zaurus connection.
  *
- * The _zdtm_close_zaurus_conn function closes the Zaurus connection.
- * Note: In order to close a zaurus connection, a working zaurus
- * connection must already exist. Hence, the _zdtm_listen_for_zaurus and
- * the _zdtm_handle_zaurus_conn must have previously been called and
- * succeeded.
+ * The _zdtm_close_zaurus_conn function closes the Zaurus connection,
+ * if there is one open. Hence, it may be called to clean up after a
+ * synchronization which failed at any point.
  * @param cur_env Pointer to the current zdtm library environment.
  * @return An integer representing success (zero) or failure (non-zero).
  * @retval 0 Successfully closed the Zaurus connection.
@@ -104,7 +106,8 @@ int _zdtm_close_zaurus_conn(zdtm_lib_env *cur_env);
  *
  * The _zdtm_conn_to_zaurus function initiates a connection to the
  * Zaurus. This connection is used to initiate a synchornization
- * originating from the desktop.
+ * originating from the desktop. It gives up once the connect deadline
+ * of the environment passed.
  * @param cur_env Pointer to the current zdtm library environment.
  * @param zaurus_ip A string containing dotted quad zaurus ip address.
  * @return An integer representing success (zero) or failure (non-zero).
@@ -112,6 +115,8 @@ int _zdtm_close_zaurus_conn(zdtm_lib_env *cur_env);
  * @retval -1 Failed to create a socket to use to connect to the zaurus.
  * @retval -2 Failed to convert the zaurus ip address.
  * @retval -3 Failed to connect to the zaurus.
+ * @retval -5 Failed to make the connection non-blocking.
+ * @retval RET_CONNECT_TIMEOUT Not connected before the deadline.
  */
 int _zdtm_conn_to_zaurus(zdtm_lib_env *cur_env, const char *zaurus_ip);
 
@@ -119,10 +124,9 @@ int _zdtm_conn_to_zaurus(zdtm_lib_env *cur_env, const char *zaurus_ip);
  * Close the connection to the Zaurus.
  *
  * The _zdtm_close_conn_to_zaurus function closes the connetion which was
- * made to the Zaurus to request a synchronization. Note: In order to
- * close a connection using this function a working connection to the
- * zaurus must already exist. Hence, the _zdtm_conn_to_zaurus must have
- * previously been caled and succeeded.
+ * made to the Zaurus to request a synchronization, if there is one
+ * open. Hence, it may be called to clean up after a synchronization
+ * which failed at any point.
  * @param cur_env Pointer to the current zdtm library environment.
  * @return An integer representing success (zero) or failure (non-zero).
  * @retval 0 Successfully closed the connection to the Zaurus.
@@ -134,13 +138,16 @@ int _zdtm_close_conn_to_zaurus(zdtm_lib_env *cur_env);
  * Send a raw common message.
  *
  * Send a specified raw common message to a specified socket.
+ * @param cur_env Pointer to the current zdtm library environment.
  * @param sockfd Socket descriptor to write the raw common message to.
  * @param data Pointe to buffer containing raw common message.
  * @return An SOCKET representing success (zero) or failure (non-zero).
  * @retval 0 Successfully sent common messaeg.
  * @retval -1 Failed to write raw common message to socket descriptor.
+ * @retval RET_IO_TIMEOUT The I/O deadline passed while writing.
  */
-int _zdtm_send_comm_message_to(SOCKET sockfd, char *data);
+int _zdtm_send_comm_message_to(zdtm_lib_env *cur_env, SOCKET sockfd,
+    char *data);
 
 /**
  * Send acknowledgement message.
@@ -175,6 +182,39 @@ int _zdtm_send_rqst_message(zdtm_lib_env *cur_env);
  */
 int _zdtm_send_abrt_message(zdtm_lib_env *cur_env);
 
+/**
+ * Drive protocol core.
+ *
+ * The _zdtm_drive_core function is the blocking driver of the sans-I/O
+ * protocol core. It writes the bytes the core produces to the given
+ * socket and feeds it the bytes read from the socket, both over the
+ * transport of the environment of the core, until the core is done
+ * with the exchange or step it was started with. Every read and write
+ * is given up on once the I/O deadline of the environment passed, the
+ * core then being aborted as if the connection failed.
+ * @param p_core Pointer to the protocol core to drive.
+ * @param sockfd The socket connected to the Zaurus.
+ * @return The result of the exchange or step the core was running, or
+ * RET_IO_TIMEOUT if the I/O deadline passed.
+ */
+int _zdtm_drive_core(zdtm_core *p_core, SOCKET sockfd);
+
+/**
+ * Run protocol step.
+ *
+ * The _zdtm_run_step function starts the given protocol step on the
+ * given protocol core and drives it over the connection from the
+ * Zaurus until it is done. The arguments of the step are to be set in
+ * the core beforehand and its results may be read from the core
+ * afterwards, before the core is cleaned up.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param p_core Pointer to an initialized protocol core.
+ * @param step The protocol step to run, see zdtm_steps.h.
+ * @return The result of the protocol step.
+ */
+int _zdtm_run_step(zdtm_lib_env *cur_env, zdtm_core *p_core,
+    zdtm_core_step step);
+
 /**
  * Receive Message.
  *
@@ -238,8 +278,10 @@ int _zdtm_send_message(zdtm_lib_env *cur_env, zdtm_msg *p_msg);
  * @retval -1 Failed to prepare message.
  * @retval RET_MALLOC_FAIL Failed to allocate memory for raw message.
  * @retval -2 Failed to write raw message to the connection socket.
+ * @retval RET_IO_TIMEOUT The I/O deadline passed while writing.
  */
-int _zdtm_send_message_to(zdtm_lib_env *cur_env, zdtm_msg *p_msg, int sockfd);
+int _zdtm_send_message_to(zdtm_lib_env *cur_env, zdtm_msg *p_msg,
+    SOCKET sockfd);
 
 /**
  * Send a Message
@@ -276,4 +318,20 @@ int _zdtm_wrapped_send_message(zdtm_lib_env *cur_env, zdtm_msg *msg);
  */
 int _zdtm_wrapped_recv_message(zdtm_lib_env *cur_env, zdtm_msg *msg);
 
+/**
+ * Obtain timeout result.
+ *
+ * The _zdtm_timeout_result function turns the failure of a public
+ * function into the RET_*_TIMEOUT value of the deadline of the
+ * environment which was missed, if any was, so that callers may tell
+ * a Zaurus which went silent from one which failed. Once a deadline
+ * was missed the connection is of no further use, hence this holds
+ * until the next synchronization is initiated.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param retval The value the public function is about to return.
+ * @return The RET_*_TIMEOUT value of the missed deadline if retval is
+ * negative and a deadline was missed, retval otherwise.
+ */
+int _zdtm_timeout_result(zdtm_lib_env *cur_env, int retval);
+
 #endif
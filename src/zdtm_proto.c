@@ -31,6 +31,7 @@
  */
 
 #include "zdtm_proto.h"
+#include "zdtm_category.h"
 
 int _zdtm_connect(zdtm_lib_env *cur_env, const char *ip_addr) {
     int r;
@@ -71,6 +72,38 @@ int _zdtm_handle_connection(zdtm_lib_env *cur_env) {
     return 0;
 }
 
+int _zdtm_identify(zdtm_lib_env *cur_env) {
+    zdtm_core core;
+    zdtm_msg msg;
+    int r;
+
+    /* Ask the Zaurus to connect back over the connection already made
+     * to it. */
+    memset(&msg, 0, sizeof(zdtm_msg));
+    memcpy(msg.body.type, RAY_MSG_TYPE, MSG_TYPE_SIZE);
+    r = _zdtm_send_message_to(cur_env, &msg, cur_env->reqfd);
+    if (r != 0) { return -1; }
+
+    r = _zdtm_handle_zaurus_conn(cur_env);
+    if (r != 0) { return -2; }
+
+    _zdtm_core_init(&core, cur_env);
+    r = _zdtm_run_step(cur_env, &core, _zdtm_step_initiate);
+    _zdtm_core_cleanup(&core);
+    if (r != 0) { return -3; }
+
+    r = _zdtm_obtain_device_info(cur_env);
+    if (r != 0) { return -4; }
+
+    /* Quit, there is nothing more to the session. */
+    _zdtm_core_init(&core, cur_env);
+    r = _zdtm_run_step(cur_env, &core, _zdtm_step_terminate);
+    _zdtm_core_cleanup(&core);
+    if (r != 0) { return -5; }
+
+    return 0;
+}
+
 int _zdtm_obtain_device_info(zdtm_lib_env *cur_env) {
     int r;
     zdtm_msg msg, rmsg;
@@ -115,46 +148,14 @@ int _zdtm_obtain_device_info(zdtm_lib_env *cur_env) {
 }
 
 int _zdtm_obtain_sync_state(zdtm_lib_env *cur_env) {
+    zdtm_core core;
     int r;
-    zdtm_msg msg, rmsg;
-
-    memset(&msg, 0, sizeof(zdtm_msg));
-    memcpy(msg.body.type, RMG_MSG_TYPE, MSG_TYPE_SIZE);
-    msg.body.cont.rmg.uk = 0x01;
-    msg.body.cont.rmg.sync_type = cur_env->sync_type;
 
-    r = _zdtm_wrapped_send_message(cur_env, &msg);
-    if (r != 0) { return -1; }
+    _zdtm_core_init(&core, cur_env);
+    r = _zdtm_run_step(cur_env, &core, _zdtm_step_sync_state);
+    _zdtm_core_cleanup(&core);
 
-    memset(&rmsg, 0, sizeof(zdtm_msg));
-    r = _zdtm_wrapped_recv_message(cur_env, &rmsg);
-    if (r != 0) { _zdtm_clean_message(&rmsg); return -2; }
-
-    if (memcmp(rmsg.body.type, AMG_MSG_TYPE, MSG_TYPE_SIZE) != 0) {
-        _zdtm_clean_message(&rmsg);
-        return -3;
-    }
-
-    /* check if todo slow sync is required */
-    if ((rmsg.body.cont.amg.fullsync_flags & AMG_TODO_MASK) == 0) {
-        cur_env->todo_slow_sync_required = 1;
-    }
-
-    /* check if calendar slow sync is required */
-    if ((rmsg.body.cont.amg.fullsync_flags & AMG_CAL_MASK) == 0) {
-        cur_env->calendar_slow_sync_required = 1;
-    }
-
-    /* check if address book slow sync is required */
-    if ((rmsg.body.cont.amg.fullsync_flags & AMG_ADDR_MASK) == 0) {
-        cur_env->address_book_slow_sync_required = 1;
-    }
-
-    cur_env->retrieved_sync_state = 1;
-
-    _zdtm_clean_message(&rmsg);
-
-    return 0;
+    return r;
 }
 
 int _zdtm_reset_sync_state(zdtm_lib_env *cur_env) {
@@ -191,57 +192,15 @@ int _zdtm_reset_sync_state(zdtm_lib_env *cur_env) {
 }
 
 int _zdtm_authenticate_passcode(zdtm_lib_env *cur_env, char *passcode) {
-    int r, pw_size;
-    zdtm_msg msg, rmsg, angmsg;
-
-    pw_size = strlen(passcode);
-
-    /* construct a RRL message to attempt to authenticate */
-    memset(&msg, 0, sizeof(zdtm_msg));
-    memcpy(msg.body.type, RRL_MSG_TYPE, MSG_TYPE_SIZE);
-    msg.body.cont.rrl.pw = malloc(pw_size);
-    if (msg.body.cont.rrl.pw == NULL) {
-        return -1;
-    }
-    memcpy(msg.body.cont.rrl.pw, passcode, pw_size);
-    msg.body.cont.rrl.pw_size = pw_size;
-
-    /* send RRL message */
-    r = _zdtm_wrapped_send_message(cur_env, &msg);
-    if (r != 0) { free(msg.body.cont.rrl.pw); return -2; }
-
-    free(msg.body.cont.rrl.pw);
-
-    /* recv response message (AEX if succeeded, abort common msg) */
-    memset(&rmsg, 0, sizeof(zdtm_msg));
-    r = _zdtm_wrapped_recv_message(cur_env, &rmsg);
-    if (r == 3) {
-        memset(&angmsg, 0, sizeof(zdtm_msg));
-        r = _zdtm_wrapped_recv_message(cur_env, &angmsg);
-        if (r != 0) {
-            _zdtm_clean_message(&angmsg);
-            _zdtm_clean_message(&rmsg);
-            return -3;
-        }
+    zdtm_core core;
+    int r;
 
-        if (memcmp(angmsg.body.type, ANG_MSG_TYPE, MSG_TYPE_SIZE) == 0) {
-            _zdtm_clean_message(&angmsg);
-            _zdtm_clean_message(&rmsg);
-            return 1;
-        } else {
-            _zdtm_clean_message(&angmsg);
-            _zdtm_clean_message(&rmsg);
-            return -4; 
-        }
-    } else if (r != 0) { _zdtm_clean_message(&rmsg); return -5; }
+    _zdtm_core_init(&core, cur_env);
+    core.passcode = passcode;
+    r = _zdtm_run_step(cur_env, &core, _zdtm_step_authenticate);
+    _zdtm_core_cleanup(&core);
 
-    if (memcmp(rmsg.body.type, AEX_MSG_TYPE, MSG_TYPE_SIZE) == 0) {
-        _zdtm_clean_message(&rmsg);
-        return 0;
-    } else {
-        _zdtm_clean_message(&rmsg);
-        return -6;
-    }
+    return r;
 }
 
 int _zdtm_obtain_last_time_synced(zdtm_lib_env *cur_env, time_t *p_time) {
@@ -461,31 +420,122 @@ int _zdtm_obtain_param_format(zdtm_lib_env *cur_env) {
 int _zdtm_obtain_item(zdtm_lib_env *cur_env, uint32_t sync_id,
     struct zdtm_adr_msg_param **p_params, uint16_t *p_num_params) {
 
-    zdtm_msg msg, rmsg;
+    zdtm_core core;
     int r;
 
-    memset(&msg, 0, sizeof(zdtm_msg));
-    memcpy(msg.body.type, RDR_MSG_TYPE, MSG_TYPE_SIZE);
-    msg.body.cont.rdr.sync_type = cur_env->sync_type;
-    msg.body.cont.rdr.num_sync_ids = 1;
-    msg.body.cont.rdr.sync_id = sync_id;
+    _zdtm_core_init(&core, cur_env);
+    core.sync_id = sync_id;
+    r = _zdtm_run_step(cur_env, &core, _zdtm_step_obtain_item);
+    if (r == 0) {
+        (*p_params) = core.params;
+        (*p_num_params) = core.num_params;
+    }
+    _zdtm_core_cleanup(&core);
 
-    r = _zdtm_wrapped_send_message(cur_env, &msg);
-    if (r != 0) { return -1; }
-    
-    memset(&rmsg, 0, sizeof(zdtm_msg));
-    r = _zdtm_wrapped_recv_message(cur_env, &rmsg);
-    if (r != 0) { _zdtm_clean_message(&rmsg); return -2; }
-    
-    if (memcmp(rmsg.body.type, ADR_MSG_TYPE, MSG_TYPE_SIZE) != 0) {
-        _zdtm_clean_message(&rmsg);
-        return -3;
+    return r;
+}
+
+int _zdtm_obtain_raw_item(zdtm_lib_env *cur_env, uint32_t sync_id,
+    void **pp_buf, uint16_t *p_size) {
+
+    zdtm_core core;
+    int r;
+
+    _zdtm_core_init(&core, cur_env);
+    core.sync_id = sync_id;
+    core.raw_adr = 1;
+    r = _zdtm_run_step(cur_env, &core, _zdtm_step_obtain_item);
+    if (r == 0) {
+        (*pp_buf) = core.raw;
+        (*p_size) = core.raw_size;
     }
+    _zdtm_core_cleanup(&core);
 
-    (*p_params) = rmsg.body.cont.adr.params;
-    (*p_num_params) = rmsg.body.cont.adr.num_params;
+    return r;
+}
 
-    _zdtm_clean_message(&rmsg);
+int _zdtm_write_items(zdtm_lib_env *cur_env, unsigned char variation,
+    const void *items, size_t item_size, uint16_t num_items,
+    uint32_t *p_sync_ids) {
+
+    zdtm_msg msg, rmsg;
+    int16_t *p_map;
+    uint16_t done, max_batch, num_written, num_taken;
+    int fixed, r;
+
+    if (cur_env->params == NULL) {
+        r = _zdtm_obtain_param_format(cur_env);
+        if (r != 0) { return -1; }
+    }
+
+    /* The format is mapped onto the fields of the items once, rather
+     * than searched for every item. Records need no map. */
+    p_map = malloc(sizeof(int16_t) * (cur_env->num_params + 1));
+    if (p_map == NULL) { return -2; }
+    if (variation == RDW_VAR_FORMAT) {
+        r = zdtm_rdw_map_format(cur_env->sync_type, cur_env->params,
+            cur_env->num_params, p_map);
+        if (r != 0) { free(p_map); return -3; }
+    }
+
+    /* Nothing tells whether a Zaurus takes more than one record from an
+     * RDW message, hence the first one carries a single record. */
+    done = 0;
+    max_batch = 1;
+    fixed = 0;
+    while (done < num_items) {
+        memset(&msg, 0, sizeof(zdtm_msg));
+        memcpy(msg.body.type, RDW_MSG_TYPE, MSG_TYPE_SIZE);
+        msg.body.cont.rdw.sync_type = cur_env->sync_type;
+        msg.body.cont.rdw.variation = variation;
+        msg.body.cont.rdw.num_sync_ids = num_items - done;
+        if (msg.body.cont.rdw.num_sync_ids > max_batch) {
+            msg.body.cont.rdw.num_sync_ids = max_batch;
+        }
+        msg.body.cont.rdw.vars.four.map = p_map;
+        msg.body.cont.rdw.vars.four.num_params = cur_env->num_params;
+        msg.body.cont.rdw.vars.four.items =
+            (const unsigned char *)items + (size_t)done * item_size;
+
+        r = _zdtm_wrapped_send_message(cur_env, &msg);
+        if (r != 0) { free(p_map); return -4; }
+        num_written = msg.body.cont.rdw.vars.four.num_written;
+
+        memset(&rmsg, 0, sizeof(zdtm_msg));
+        r = _zdtm_wrapped_recv_message(cur_env, &rmsg);
+        if (r != 0) {
+            _zdtm_clean_message(&rmsg);
+            free(p_map);
+            return -5;
+        }
+
+        num_taken = 0;
+        if (IS_ADW((&rmsg))) {
+            num_taken = rmsg.body.cont.adw.num_sync_ids;
+        }
+        if ((num_taken == 0) || (num_taken > num_written)) {
+            _zdtm_clean_message(&rmsg);
+            free(p_map);
+            return -6;
+        }
+
+        zdtm_liltohostl_bulk(p_sync_ids + done,
+            rmsg.body.cont.adw.p_raw_sync_ids, num_taken);
+        _zdtm_clean_message(&rmsg);
+
+        /* A Zaurus taking every item of a message is sent twice as
+         * many in the next one, while one taking fewer items than it
+         * was sent is not sent more than that at once from then on. */
+        if (num_taken < num_written) {
+            max_batch = num_taken;
+            fixed = 1;
+        } else if (!fixed && (num_written == max_batch)) {
+            max_batch = (max_batch > 0x7fff) ? 0xffff : (max_batch * 2);
+        }
+        done += num_taken;
+    }
+
+    free(p_map);
 
     return 0;
 }
@@ -510,10 +560,213 @@ int _zdtm_free_params(zdtm_lib_env *cur_env,
     return 0;
 }
 
+int _zdtm_obtain_file(zdtm_lib_env *cur_env, const char *path, FILE *fp,
+    unsigned char **pp_buf, uint32_t *p_size) {
+
+    zdtm_msg msg, rmsg;
+    int r;
+    unsigned char *p_buf, *p_grown;
+    uint32_t file_size, received;
+    size_t buf_cap, need;
+
+    memset(&msg, 0, sizeof(zdtm_msg));
+    memcpy(msg.body.type, RGE_MSG_TYPE, MSG_TYPE_SIZE);
+    msg.body.cont.rge.path_len = strlen(path);
+    msg.body.cont.rge.path = (char *)path;
+
+    r = _zdtm_wrapped_send_message(cur_env, &msg);
+    if (r != 0) { return -1; }
+
+    p_buf = NULL;
+    buf_cap = 0;
+    file_size = 0;
+    received = 0;
+
+    /* The file arrives as a sequence of AGE messages, each carrying the
+     * chunk following the previous one, until the whole file has been
+     * received. */
+    do {
+        memset(&rmsg, 0, sizeof(zdtm_msg));
+        r = _zdtm_wrapped_recv_message(cur_env, &rmsg);
+        if (r != 0) {
+            _zdtm_clean_message(&rmsg);
+            if (p_buf != NULL) { free(p_buf); }
+            return -2;
+        }
+
+        if (memcmp(rmsg.body.type, AGE_MSG_TYPE, MSG_TYPE_SIZE) != 0) {
+            _zdtm_clean_message(&rmsg);
+            if (p_buf != NULL) { free(p_buf); }
+            return -3;
+        }
+
+        if (received == 0) {
+            file_size = rmsg.body.cont.age.file_size;
+            if (file_size > ZDTM_MAX_FILE_SIZE) {
+                _zdtm_clean_message(&rmsg);
+                if (p_buf != NULL) { free(p_buf); }
+                return -7;
+            }
+        }
+
+        if ((rmsg.body.cont.age.file_size != file_size) ||
+            (rmsg.body.cont.age.offset != received) ||
+            ((rmsg.body.cont.age.data_len == 0) && (received < file_size))) {
+            _zdtm_clean_message(&rmsg);
+            if (p_buf != NULL) { free(p_buf); }
+            return -4;
+        }
+
+        /* The buffer grows with the chunks actually received rather
+         * than to the size the device claims up front. It is at least
+         * a byte so that an empty file still results in a buffer that
+         * can be freed. */
+        if (fp == NULL) {
+            need = (size_t)received + rmsg.body.cont.age.data_len;
+            if ((need < received) || (need > ZDTM_MAX_FILE_SIZE)) {
+                _zdtm_clean_message(&rmsg);
+                if (p_buf != NULL) { free(p_buf); }
+                return -7;
+            }
+            if ((p_buf == NULL) || (need > buf_cap)) {
+                buf_cap = (buf_cap == 0) ? 4096 : buf_cap;
+                while (buf_cap < need) {
+                    buf_cap *= 2;
+                }
+                if (buf_cap > (size_t)file_size + 1) {
+                    buf_cap = (size_t)file_size + 1;
+                }
+                p_grown = realloc(p_buf, buf_cap);
+                if (p_grown == NULL) {
+                    _zdtm_clean_message(&rmsg);
+                    if (p_buf != NULL) { free(p_buf); }
+                    return -5;
+                }
+                p_buf = p_grown;
+            }
+        }
+
+        if (fp != NULL) {
+            if (fwrite(rmsg.body.cont.age.data, 1,
+                rmsg.body.cont.age.data_len, fp) !=
+                rmsg.body.cont.age.data_len) {
+                _zdtm_clean_message(&rmsg);
+                return -6;
+            }
+        } else {
+            memcpy(p_buf + received, rmsg.body.cont.age.data,
+                rmsg.body.cont.age.data_len);
+        }
+        received += rmsg.body.cont.age.data_len;
+
+        _zdtm_clean_message(&rmsg);
+    } while (received < file_size);
+
+    if (fp == NULL) {
+        (*pp_buf) = p_buf;
+    }
+    (*p_size) = file_size;
+
+    return 0;
+}
+
+int _zdtm_obtain_item_listing(zdtm_lib_env *cur_env,
+    struct zdtm_alr_entry **pp_entries, uint16_t *p_num_entries) {
+
+    zdtm_msg msg, rmsg;
+    int r;
+
+    memset(&msg, 0, sizeof(zdtm_msg));
+    memcpy(msg.body.type, RLR_MSG_TYPE, MSG_TYPE_SIZE);
+    msg.body.cont.rlr.sync_type = cur_env->sync_type;
+
+    r = _zdtm_wrapped_send_message(cur_env, &msg);
+    if (r != 0) { return -1; }
+
+    memset(&rmsg, 0, sizeof(zdtm_msg));
+    r = _zdtm_wrapped_recv_message(cur_env, &rmsg);
+    if (r != 0) { _zdtm_clean_message(&rmsg); return -2; }
+
+    if (memcmp(rmsg.body.type, ALR_MSG_TYPE, MSG_TYPE_SIZE) != 0) {
+        _zdtm_clean_message(&rmsg);
+        return -3;
+    }
+
+    /* Take the entries over so cleaning the message leaves them be. */
+    (*pp_entries) = rmsg.body.cont.alr.entries;
+    (*p_num_entries) = rmsg.body.cont.alr.num_entries;
+    rmsg.body.cont.alr.entries = NULL;
+
+    _zdtm_clean_message(&rmsg);
+
+    return 0;
+}
+
+/**
+ * Set a string item member from a parameter.
+ *
+ * The _zdtm_set_param_str function sets a string member of an item and
+ * its associated length from the given parameter. If copy is non-zero
+ * the data is copied into dynamically allocated memory, otherwise the
+ * member points directly at the parameter data.
+ * @param pp_str Pointer to the string member to set.
+ * @param p_len Pointer to the length member to set.
+ * @param param Pointer to the parameter to set the member from.
+ * @param copy Flag stating if the parameter data should be copied.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully set the member.
+ * @retval -1 Failed to allocate memory for the copy.
+ */
+static int _zdtm_set_param_str(char **pp_str, uint32_t *p_len,
+    struct zdtm_adr_msg_param *param, int copy) {
+
+    (*p_len) = param->param_len;
+    if (!copy) {
+        (*pp_str) = (char *)param->param_data;
+        return 0;
+    }
+
+    (*pp_str) = malloc(param->param_len);
+    if ((*pp_str) == NULL) {
+        return -1;
+    }
+    memcpy((*pp_str), param->param_data, param->param_len);
+
+    return 0;
+}
+
+/**
+ * Set a fixed size item member from a parameter.
+ *
+ * The _zdtm_set_param_fixed function copies the data of the given
+ * parameter into a fixed size member of an item, never copying more
+ * than the size of the member so that malformed parameters can not
+ * overrun it.
+ * @param p_dest Pointer to the member to set.
+ * @param size The size of the member in bytes.
+ * @param param Pointer to the parameter to set the member from.
+ */
+static void _zdtm_set_param_fixed(void *p_dest, size_t size,
+    struct zdtm_adr_msg_param *param) {
+
+    if (param->param_len < size) {
+        size = param->param_len;
+    }
+    memcpy(p_dest, param->param_data, size);
+}
+
 int _zdtm_parse_todo_item_params(struct zdtm_adi_msg_param *p_param_format,
     uint16_t num_format_params, struct zdtm_adr_msg_param *params,
     uint16_t num_params, struct zdtm_todo_item *p_todo_item) {
 
+    return _zdtm_map_todo_item_params(p_param_format, num_format_params,
+        params, num_params, p_todo_item, 1);
+}
+
+int _zdtm_map_todo_item_params(struct zdtm_adi_msg_param *p_param_format,
+    uint16_t num_format_params, struct zdtm_adr_msg_param *params,
+    uint16_t num_params, struct zdtm_todo_item *p_todo_item, int copy) {
+
     int i;
 
     if (num_format_params != num_params) {
@@ -525,72 +778,62 @@ int _zdtm_parse_todo_item_params(struct zdtm_adi_msg_param *p_param_format,
         switch (p_param_format[i].type_id) {
             case DATA_ID_TIME:
                 if (memcmp(p_param_format[i].abrev, "CTTM", 4) == 0) {
-                    memcpy(p_todo_item->creation_date, params[i].param_data,
-                        params[i].param_len);
+                    _zdtm_set_param_fixed(p_todo_item->creation_date,
+                        sizeof(p_todo_item->creation_date), &params[i]);
                 } else if (memcmp(p_param_format[i].abrev, "MDTM", 4) == 0) {
-                    memcpy(p_todo_item->modification_date, params[i].param_data,
-                        params[i].param_len);
+                    _zdtm_set_param_fixed(p_todo_item->modification_date,
+                        sizeof(p_todo_item->modification_date), &params[i]);
                 } else if (memcmp(p_param_format[i].abrev, "ETDY", 4) == 0) {
-                    memcpy(p_todo_item->start_date, params[i].param_data,
-                        params[i].param_len);
+                    _zdtm_set_param_fixed(p_todo_item->start_date,
+                        sizeof(p_todo_item->start_date), &params[i]);
                 } else if (memcmp(p_param_format[i].abrev, "LTDY", 4) == 0) {
-                    memcpy(p_todo_item->due_date, params[i].param_data,
-                        params[i].param_len);
+                    _zdtm_set_param_fixed(p_todo_item->due_date,
+                        sizeof(p_todo_item->due_date), &params[i]);
                 } else if (memcmp(p_param_format[i].abrev, "FNDY", 4) == 0) {
-                    memcpy(p_todo_item->completed_date, params[i].param_data,
-                        params[i].param_len);
+                    _zdtm_set_param_fixed(p_todo_item->completed_date,
+                        sizeof(p_todo_item->completed_date), &params[i]);
                 }
                 break;
             case DATA_ID_BIT:
                 if (memcmp(p_param_format[i].abrev, "ATTR", 4) == 0) {
-                    memcpy(&p_todo_item->attribute, params[i].param_data,
-                        params[i].param_len);
+                    _zdtm_set_param_fixed(&p_todo_item->attribute,
+                        sizeof(p_todo_item->attribute), &params[i]);
                 }
                 break;
             case DATA_ID_UCHAR:
                 if (memcmp(p_param_format[i].abrev, "MARK", 4) == 0) {
-                    memcpy(&p_todo_item->progress, params[i].param_data,
-                        params[i].param_len);
+                    _zdtm_set_param_fixed(&p_todo_item->progress,
+                        sizeof(p_todo_item->progress), &params[i]);
                 } else if (memcmp(p_param_format[i].abrev, "PRTY", 4) == 0) {
-                    memcpy(&p_todo_item->priority, params[i].param_data,
-                        params[i].param_len);
+                    _zdtm_set_param_fixed(&p_todo_item->priority,
+                        sizeof(p_todo_item->priority), &params[i]);
                 }
                 break;
             case DATA_ID_BARRAY:
                 if (memcmp(p_param_format[i].abrev, "CTGR", 4) == 0) {
-                    p_todo_item->category_len = params[i].param_len;
-                    p_todo_item->category = malloc(params[i].param_len);
-                    if (p_todo_item->category == NULL) {
+                    if (_zdtm_set_param_str(&p_todo_item->category,
+                        &p_todo_item->category_len, &params[i], copy) != 0) {
                         return -2;
                     }
-                    memcpy(p_todo_item->category, params[i].param_data,
-                        params[i].param_len);
-
                 }
                 break;
             case DATA_ID_UTF8:
                 if (memcmp(p_param_format[i].abrev, "TITL", 4) == 0) {
-                    p_todo_item->description_len = params[i].param_len;
-                    p_todo_item->description = malloc(params[i].param_len);
-                    if (p_todo_item->description == NULL) {
+                    if (_zdtm_set_param_str(&p_todo_item->description,
+                        &p_todo_item->description_len, &params[i], copy) != 0) {
                         return -3;
                     }
-                    memcpy(p_todo_item->description, params[i].param_data,
-                        params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "MEM1", 4) == 0) {
-                    p_todo_item->notes_len = params[i].param_len;
-                    p_todo_item->notes = malloc(params[i].param_len);
-                    if (p_todo_item->notes == NULL) {
+                    if (_zdtm_set_param_str(&p_todo_item->notes,
+                        &p_todo_item->notes_len, &params[i], copy) != 0) {
                         return -4;
                     }
-                    memcpy(p_todo_item->notes, params[i].param_data,
-                        params[i].param_len);
                 }
                 break;
             case DATA_ID_ULONG:
                 if (memcmp(p_param_format[i].abrev, "SYID", 4) == 0) {
-                    memcpy(&p_todo_item->sync_id, params[i].param_data,
-                        params[i].param_len);
+                    _zdtm_set_param_fixed(&p_todo_item->sync_id,
+                        sizeof(p_todo_item->sync_id), &params[i]);
                 }
                 break;
             default:
@@ -605,6 +848,14 @@ int _zdtm_parse_calendar_item_params(struct zdtm_adi_msg_param *p_param_format,
     uint16_t num_format_params, struct zdtm_adr_msg_param *params,
     uint16_t num_params, struct zdtm_calendar_item *p_calendar_item) {
 
+    return _zdtm_map_calendar_item_params(p_param_format, num_format_params,
+        params, num_params, p_calendar_item, 1);
+}
+
+int _zdtm_map_calendar_item_params(struct zdtm_adi_msg_param *p_param_format,
+    uint16_t num_format_params, struct zdtm_adr_msg_param *params,
+    uint16_t num_params, struct zdtm_calendar_item *p_calendar_item, int copy) {
+
     int i;
 
     if (num_format_params != num_params) {
@@ -616,113 +867,107 @@ int _zdtm_parse_calendar_item_params(struct zdtm_adi_msg_param *p_param_format,
         switch (p_param_format[i].type_id) {
             case DATA_ID_TIME:
                 if (memcmp(p_param_format[i].abrev, "CTTM", 4) == 0) {
-                    memcpy(p_calendar_item->creation_date, params[i].param_data,
-                        params[i].param_len);
+                    _zdtm_set_param_fixed(p_calendar_item->creation_date,
+                        sizeof(p_calendar_item->creation_date), &params[i]);
                 } else if (memcmp(p_param_format[i].abrev, "MDTM", 4) == 0) {
-                    memcpy(p_calendar_item->modification_date,
-                        params[i].param_data, params[i].param_len);
+                    _zdtm_set_param_fixed(p_calendar_item->modification_date,
+                        sizeof(p_calendar_item->modification_date), &params[i]);
                 } else if (memcmp(p_param_format[i].abrev, "TIM1", 4) == 0) {
-                    memcpy(p_calendar_item->start_time,
-                        params[i].param_data, params[i].param_len);
+                    _zdtm_set_param_fixed(p_calendar_item->start_time,
+                        sizeof(p_calendar_item->start_time), &params[i]);
                 } else if (memcmp(p_param_format[i].abrev, "TIM2", 4) == 0) {
-                    memcpy(p_calendar_item->end_time,
-                        params[i].param_data, params[i].param_len);
+                    _zdtm_set_param_fixed(p_calendar_item->end_time,
+                        sizeof(p_calendar_item->end_time), &params[i]);
                 } else if (memcmp(p_param_format[i].abrev, "REDT", 4) == 0) {
-                    memcpy(p_calendar_item->repeat_end_date,
-                        params[i].param_data, params[i].param_len);
+                    _zdtm_set_param_fixed(p_calendar_item->repeat_end_date,
+                        sizeof(p_calendar_item->repeat_end_date), &params[i]);
                 } else if (memcmp(p_param_format[i].abrev, "ALSD", 4) == 0) {
-                    memcpy(p_calendar_item->all_day_start_date,
-                        params[i].param_data, params[i].param_len);
+                    _zdtm_set_param_fixed(p_calendar_item->all_day_start_date,
+                        sizeof(p_calendar_item->all_day_start_date),
+                        &params[i]);
                 } else if (memcmp(p_param_format[i].abrev, "ALED", 4) == 0) {
-                    memcpy(p_calendar_item->all_day_end_date,
-                        params[i].param_data, params[i].param_len);
+                    _zdtm_set_param_fixed(p_calendar_item->all_day_end_date,
+                        sizeof(p_calendar_item->all_day_end_date), &params[i]);
                 }
                 break;
             case DATA_ID_BIT:
                 if (memcmp(p_param_format[i].abrev, "ATTR", 4) == 0) {
-                    memcpy(&p_calendar_item->attribute, params[i].param_data,
-                        params[i].param_len);
+                    _zdtm_set_param_fixed(&p_calendar_item->attribute,
+                        sizeof(p_calendar_item->attribute), &params[i]);
                 }
                 break;
             case DATA_ID_UCHAR:
                 if (memcmp(p_param_format[i].abrev, "ADAY", 4) == 0) {
-                    memcpy(&p_calendar_item->schedule_type,
-                        params[i].param_data, params[i].param_len);
+                    _zdtm_set_param_fixed(&p_calendar_item->schedule_type,
+                        sizeof(p_calendar_item->schedule_type), &params[i]);
                 } else if (memcmp(p_param_format[i].abrev, "ARON", 4) == 0) {
-                    memcpy(&p_calendar_item->alarm,
-                        params[i].param_data, params[i].param_len);
+                    _zdtm_set_param_fixed(&p_calendar_item->alarm,
+                        sizeof(p_calendar_item->alarm), &params[i]);
                 } else if (memcmp(p_param_format[i].abrev, "ARSD", 4) == 0) {
-                    memcpy(&p_calendar_item->alarm_setting,
-                        params[i].param_data, params[i].param_len);
+                    _zdtm_set_param_fixed(&p_calendar_item->alarm_setting,
+                        sizeof(p_calendar_item->alarm_setting), &params[i]);
                 } else if (memcmp(p_param_format[i].abrev, "RTYP", 4) == 0) {
-                    memcpy(&p_calendar_item->repeat_type,
-                        params[i].param_data, params[i].param_len);
+                    _zdtm_set_param_fixed(&p_calendar_item->repeat_type,
+                        sizeof(p_calendar_item->repeat_type), &params[i]);
                 } else if (memcmp(p_param_format[i].abrev, "RDYS", 4) == 0) {
-                    memcpy(&p_calendar_item->repeat_date,
-                        params[i].param_data, params[i].param_len);
+                    _zdtm_set_param_fixed(&p_calendar_item->repeat_date,
+                        sizeof(p_calendar_item->repeat_date), &params[i]);
                 } else if (memcmp(p_param_format[i].abrev, "REND", 4) == 0) {
-                    memcpy(&p_calendar_item->repeat_end_date_setting,
-                        params[i].param_data, params[i].param_len);
+                    _zdtm_set_param_fixed(
+                        &p_calendar_item->repeat_end_date_setting,
+                        sizeof(p_calendar_item->repeat_end_date_setting),
+                        &params[i]);
                 } else if (memcmp(p_param_format[i].abrev, "MDAY", 4) == 0) {
-                    memcpy(&p_calendar_item->multiple_days_flag,
-                        params[i].param_data, params[i].param_len);
+                    _zdtm_set_param_fixed(&p_calendar_item->multiple_days_flag,
+                        sizeof(p_calendar_item->multiple_days_flag),
+                        &params[i]);
                 }
                 break;
             case DATA_ID_WORD:
                 if (memcmp(p_param_format[i].abrev, "ARMN", 4) == 0) {
-                    memcpy(&p_calendar_item->alarm_time,
-                        params[i].param_data, params[i].param_len);
+                    _zdtm_set_param_fixed(&p_calendar_item->alarm_time,
+                        sizeof(p_calendar_item->alarm_time), &params[i]);
                 } else if (memcmp(p_param_format[i].abrev, "RFRQ", 4) == 0) {
-                    memcpy(&p_calendar_item->repeat_period,
-                        params[i].param_data, params[i].param_len);
+                    _zdtm_set_param_fixed(&p_calendar_item->repeat_period,
+                        sizeof(p_calendar_item->repeat_period), &params[i]);
                 } else if (memcmp(p_param_format[i].abrev, "RPOS", 4) == 0) {
-                    memcpy(&p_calendar_item->repeat_position,
-                        params[i].param_data, params[i].param_len);
+                    _zdtm_set_param_fixed(&p_calendar_item->repeat_position,
+                        sizeof(p_calendar_item->repeat_position), &params[i]);
                 }
                 break;
             case DATA_ID_BARRAY:
                 if (memcmp(p_param_format[i].abrev, "CTGR", 4) == 0) {
-                    p_calendar_item->category_len = params[i].param_len;
-                    p_calendar_item->category = malloc(params[i].param_len);
-                    if (p_calendar_item->category == NULL) {
+                    if (_zdtm_set_param_str(&p_calendar_item->category,
+                        &p_calendar_item->category_len, &params[i],
+                        copy) != 0) {
                         return -2;
                     }
-                    memcpy(p_calendar_item->category, params[i].param_data,
-                        params[i].param_len);
-
                 }
                 break;
             case DATA_ID_UTF8:
                 if (memcmp(p_param_format[i].abrev, "DSRP", 4) == 0) {
-                    p_calendar_item->description_len = params[i].param_len;
-                    p_calendar_item->description = malloc(params[i].param_len);
-                    if (p_calendar_item->description == NULL) {
+                    if (_zdtm_set_param_str(&p_calendar_item->description,
+                        &p_calendar_item->description_len, &params[i],
+                        copy) != 0) {
                         return -3;
                     }
-                    memcpy(p_calendar_item->description, params[i].param_data,
-                        params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "PLCE", 4) == 0) {
-                    p_calendar_item->location_len = params[i].param_len;
-                    p_calendar_item->location = malloc(params[i].param_len);
-                    if (p_calendar_item->location == NULL) {
+                    if (_zdtm_set_param_str(&p_calendar_item->location,
+                        &p_calendar_item->location_len, &params[i],
+                        copy) != 0) {
                         return -4;
                     }
-                    memcpy(p_calendar_item->location, params[i].param_data,
-                        params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "MEM1", 4) == 0) {
-                    p_calendar_item->notes_len = params[i].param_len;
-                    p_calendar_item->notes = malloc(params[i].param_len);
-                    if (p_calendar_item->notes == NULL) {
+                    if (_zdtm_set_param_str(&p_calendar_item->notes,
+                        &p_calendar_item->notes_len, &params[i], copy) != 0) {
                         return -5;
                     }
-                    memcpy(p_calendar_item->notes, params[i].param_data,
-                        params[i].param_len);
                 }
                 break;
             case DATA_ID_ULONG:
                 if (memcmp(p_param_format[i].abrev, "SYID", 4) == 0) {
-                    memcpy(&p_calendar_item->sync_id, params[i].param_data,
-                        params[i].param_len);
+                    _zdtm_set_param_fixed(&p_calendar_item->sync_id,
+                        sizeof(p_calendar_item->sync_id), &params[i]);
                 }
                 break;
             default:
@@ -737,6 +982,14 @@ int _zdtm_parse_address_item_params(struct zdtm_adi_msg_param *p_param_format,
     uint16_t num_format_params, struct zdtm_adr_msg_param *params,
     uint16_t num_params, struct zdtm_address_item *p_address_item) {
 
+    return _zdtm_map_address_item_params(p_param_format, num_format_params,
+        params, num_params, p_address_item, 1);
+}
+
+int _zdtm_map_address_item_params(struct zdtm_adi_msg_param *p_param_format,
+    uint16_t num_format_params, struct zdtm_adr_msg_param *params,
+    uint16_t num_params, struct zdtm_address_item *p_address_item, int copy) {
+
     int i;
 
     if (num_format_params != num_params) {
@@ -748,460 +1001,297 @@ int _zdtm_parse_address_item_params(struct zdtm_adi_msg_param *p_param_format,
         switch (p_param_format[i].type_id) {
             case DATA_ID_TIME:
                 if (memcmp(p_param_format[i].abrev, "CTTM", 4) == 0) {
-                    memcpy(p_address_item->creation_date,
-                        params[i].param_data, params[i].param_len);
+                    _zdtm_set_param_fixed(p_address_item->creation_date,
+                        sizeof(p_address_item->creation_date), &params[i]);
                 } else if (memcmp(p_param_format[i].abrev, "MDTM", 4) == 0) {
-                    memcpy(p_address_item->modification_date,
-                        params[i].param_data, params[i].param_len);
+                    _zdtm_set_param_fixed(p_address_item->modification_date,
+                        sizeof(p_address_item->modification_date), &params[i]);
                 }
                 break;
             case DATA_ID_BIT:
                 if (memcmp(p_param_format[i].abrev, "ATTR", 4) == 0) {
-                    memcpy(&p_address_item->attribute, params[i].param_data,
-                        params[i].param_len);
+                    _zdtm_set_param_fixed(&p_address_item->attribute,
+                        sizeof(p_address_item->attribute), &params[i]);
                 }
                 break;
             case DATA_ID_BARRAY:
                 if (memcmp(p_param_format[i].abrev, "CTGR", 4) == 0) {
-                    p_address_item->category_len = params[i].param_len;
-                    p_address_item->category = malloc(params[i].param_len);
-                    if (p_address_item->category == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->category,
+                        &p_address_item->category_len, &params[i], copy) != 0) {
                         return -2;
                     }
-                    memcpy(p_address_item->category, params[i].param_data,
-                        params[i].param_len);
-
                 }
                 break;
             case DATA_ID_UTF8:
                 if (memcmp(p_param_format[i].abrev, "FULL", 4) == 0) {
-                    p_address_item->full_name_len = params[i].param_len;
-                    p_address_item->full_name = malloc(params[i].param_len);
-                    if (p_address_item->full_name == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->full_name,
+                        &p_address_item->full_name_len, &params[i],
+                        copy) != 0) {
                         return -3;
                     }
-                    memcpy(p_address_item->full_name, params[i].param_data,
-                        params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "NAPR", 4) == 0) {
-                    p_address_item->full_name_pronun_len = params[i].param_len;
-                    p_address_item->full_name_pronun = malloc(
-                        params[i].param_len);
-                    if (p_address_item->full_name_pronun == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->full_name_pronun,
+                        &p_address_item->full_name_pronun_len, &params[i],
+                        copy) != 0) {
                         return -4;
                     }
-                    memcpy(p_address_item->full_name_pronun,
-                        params[i].param_data, params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "TITL", 4) == 0) {
-                    p_address_item->title_len = params[i].param_len;
-                    p_address_item->title = malloc(
-                        params[i].param_len);
-                    if (p_address_item->title == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->title,
+                        &p_address_item->title_len, &params[i], copy) != 0) {
                         return -5;
                     }
-                    memcpy(p_address_item->title, params[i].param_data,
-                        params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "LNME", 4) == 0) {
-                    p_address_item->last_name_len = params[i].param_len;
-                    p_address_item->last_name = malloc(
-                        params[i].param_len);
-                    if (p_address_item->last_name == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->last_name,
+                        &p_address_item->last_name_len, &params[i],
+                        copy) != 0) {
                         return -6;
                     }
-                    memcpy(p_address_item->last_name, params[i].param_data,
-                        params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "FNME", 4) == 0) {
-                    p_address_item->first_name_len = params[i].param_len;
-                    p_address_item->first_name = malloc(
-                        params[i].param_len);
-                    if (p_address_item->first_name == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->first_name,
+                        &p_address_item->first_name_len, &params[i],
+                        copy) != 0) {
                         return -7;
                     }
-                    memcpy(p_address_item->first_name, params[i].param_data,
-                        params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "MNME", 4) == 0) {
-                    p_address_item->middle_name_len = params[i].param_len;
-                    p_address_item->middle_name = malloc(
-                        params[i].param_len);
-                    if (p_address_item->middle_name == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->middle_name,
+                        &p_address_item->middle_name_len, &params[i],
+                        copy) != 0) {
                         return -8;
                     }
-                    memcpy(p_address_item->middle_name, params[i].param_data,
-                        params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "SUFX", 4) == 0) {
-                    p_address_item->suffix_len = params[i].param_len;
-                    p_address_item->suffix = malloc(
-                        params[i].param_len);
-                    if (p_address_item->suffix == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->suffix,
+                        &p_address_item->suffix_len, &params[i], copy) != 0) {
                         return -9;
                     }
-                    memcpy(p_address_item->suffix, params[i].param_data,
-                        params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "FLAS", 4) == 0) {
-                    p_address_item->alternative_name_len = params[i].param_len;
-                    p_address_item->alternative_name = malloc(
-                        params[i].param_len);
-                    if (p_address_item->alternative_name == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->alternative_name,
+                        &p_address_item->alternative_name_len, &params[i],
+                        copy) != 0) {
                         return -10;
                     }
-                    memcpy(p_address_item->alternative_name,
-                        params[i].param_data, params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "LNPR", 4) == 0) {
-                    p_address_item->last_name_pronun_len = params[i].param_len;
-                    p_address_item->last_name_pronun = malloc(
-                        params[i].param_len);
-                    if (p_address_item->last_name_pronun == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->last_name_pronun,
+                        &p_address_item->last_name_pronun_len, &params[i],
+                        copy) != 0) {
                         return -11;
                     }
-                    memcpy(p_address_item->last_name_pronun,
-                        params[i].param_data, params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "FNPR", 4) == 0) {
-                    p_address_item->first_name_pronun_len = params[i].param_len;
-                    p_address_item->first_name_pronun = malloc(
-                        params[i].param_len);
-                    if (p_address_item->first_name_pronun == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->first_name_pronun,
+                        &p_address_item->first_name_pronun_len, &params[i],
+                        copy) != 0) {
                         return -12;
                     }
-                    memcpy(p_address_item->first_name_pronun,
-                        params[i].param_data, params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "CPNY", 4) == 0) {
-                    p_address_item->company_len = params[i].param_len;
-                    p_address_item->company = malloc(
-                        params[i].param_len);
-                    if (p_address_item->company == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->company,
+                        &p_address_item->company_len, &params[i], copy) != 0) {
                         return -13;
                     }
-                    memcpy(p_address_item->company,
-                        params[i].param_data, params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "CPPR", 4) == 0) {
-                    p_address_item->company_pronun_len = params[i].param_len;
-                    p_address_item->company_pronun = malloc(
-                        params[i].param_len);
-                    if (p_address_item->company_pronun == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->company_pronun,
+                        &p_address_item->company_pronun_len, &params[i],
+                        copy) != 0) {
                         return -14;
                     }
-                    memcpy(p_address_item->company_pronun,
-                        params[i].param_data, params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "SCTN", 4) == 0) {
-                    p_address_item->department_len = params[i].param_len;
-                    p_address_item->department = malloc(
-                        params[i].param_len);
-                    if (p_address_item->department == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->department,
+                        &p_address_item->department_len, &params[i],
+                        copy) != 0) {
                         return -15;
                     }
-                    memcpy(p_address_item->department,
-                        params[i].param_data, params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "PSTN", 4) == 0) {
-                    p_address_item->job_title_len = params[i].param_len;
-                    p_address_item->job_title = malloc(
-                        params[i].param_len);
-                    if (p_address_item->job_title == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->job_title,
+                        &p_address_item->job_title_len, &params[i],
+                        copy) != 0) {
                         return -16;
                     }
-                    memcpy(p_address_item->job_title,
-                        params[i].param_data, params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "TEL2", 4) == 0) {
-                    p_address_item->work_phone_len = params[i].param_len;
-                    p_address_item->work_phone = malloc(
-                        params[i].param_len);
-                    if (p_address_item->work_phone == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->work_phone,
+                        &p_address_item->work_phone_len, &params[i],
+                        copy) != 0) {
                         return -17;
                     }
-                    memcpy(p_address_item->work_phone,
-                        params[i].param_data, params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "FAX2", 4) == 0) {
-                    p_address_item->work_fax_len = params[i].param_len;
-                    p_address_item->work_fax = malloc(
-                        params[i].param_len);
-                    if (p_address_item->work_fax == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->work_fax,
+                        &p_address_item->work_fax_len, &params[i], copy) != 0) {
                         return -18;
                     }
-                    memcpy(p_address_item->work_fax,
-                        params[i].param_data, params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "CPS2", 4) == 0) {
-                    p_address_item->work_mobile_len = params[i].param_len;
-                    p_address_item->work_mobile = malloc(
-                        params[i].param_len);
-                    if (p_address_item->work_mobile == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->work_mobile,
+                        &p_address_item->work_mobile_len, &params[i],
+                        copy) != 0) {
                         return -19;
                     }
-                    memcpy(p_address_item->work_mobile,
-                        params[i].param_data, params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "BSTA", 4) == 0) {
-                    p_address_item->work_state_len = params[i].param_len;
-                    p_address_item->work_state = malloc(
-                        params[i].param_len);
-                    if (p_address_item->work_state == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->work_state,
+                        &p_address_item->work_state_len, &params[i],
+                        copy) != 0) {
                         return -20;
                     }
-                    memcpy(p_address_item->work_state,
-                        params[i].param_data, params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "BCTY", 4) == 0) {
-                    p_address_item->work_city_len = params[i].param_len;
-                    p_address_item->work_city = malloc(
-                        params[i].param_len);
-                    if (p_address_item->work_city == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->work_city,
+                        &p_address_item->work_city_len, &params[i],
+                        copy) != 0) {
                         return -21;
                     }
-                    memcpy(p_address_item->work_city,
-                        params[i].param_data, params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "BSTR", 4) == 0) {
-                    p_address_item->work_street_len = params[i].param_len;
-                    p_address_item->work_street = malloc(
-                        params[i].param_len);
-                    if (p_address_item->work_street == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->work_street,
+                        &p_address_item->work_street_len, &params[i],
+                        copy) != 0) {
                         return -22;
                     }
-                    memcpy(p_address_item->work_street,
-                        params[i].param_data, params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "BZIP", 4) == 0) {
-                    p_address_item->work_zip_len = params[i].param_len;
-                    p_address_item->work_zip = malloc(
-                        params[i].param_len);
-                    if (p_address_item->work_zip == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->work_zip,
+                        &p_address_item->work_zip_len, &params[i], copy) != 0) {
                         return -23;
                     }
-                    memcpy(p_address_item->work_zip,
-                        params[i].param_data, params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "BCTR", 4) == 0) {
-                    p_address_item->work_country_len = params[i].param_len;
-                    p_address_item->work_country = malloc(
-                        params[i].param_len);
-                    if (p_address_item->work_country == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->work_country,
+                        &p_address_item->work_country_len, &params[i],
+                        copy) != 0) {
                         return -24;
                     }
-                    memcpy(p_address_item->work_country,
-                        params[i].param_data, params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "BWEB", 4) == 0) {
-                    p_address_item->work_web_page_len = params[i].param_len;
-                    p_address_item->work_web_page = malloc(
-                        params[i].param_len);
-                    if (p_address_item->work_web_page == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->work_web_page,
+                        &p_address_item->work_web_page_len, &params[i],
+                        copy) != 0) {
                         return -25;
                     }
-                    memcpy(p_address_item->work_web_page,
-                        params[i].param_data, params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "OFCE", 4) == 0) {
-                    p_address_item->office_len = params[i].param_len;
-                    p_address_item->office = malloc(
-                        params[i].param_len);
-                    if (p_address_item->office == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->office,
+                        &p_address_item->office_len, &params[i], copy) != 0) {
                         return -26;
                     }
-                    memcpy(p_address_item->office,
-                        params[i].param_data, params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "PRFS", 4) == 0) {
-                    p_address_item->profession_len = params[i].param_len;
-                    p_address_item->profession = malloc(
-                        params[i].param_len);
-                    if (p_address_item->profession == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->profession,
+                        &p_address_item->profession_len, &params[i],
+                        copy) != 0) {
                         return -27;
                     }
-                    memcpy(p_address_item->profession,
-                        params[i].param_data, params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "ASST", 4) == 0) {
-                    p_address_item->assistant_len = params[i].param_len;
-                    p_address_item->assistant = malloc(
-                        params[i].param_len);
-                    if (p_address_item->assistant == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->assistant,
+                        &p_address_item->assistant_len, &params[i],
+                        copy) != 0) {
                         return -28;
                     }
-                    memcpy(p_address_item->assistant,
-                        params[i].param_data, params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "MNGR", 4) == 0) {
-                    p_address_item->manager_len = params[i].param_len;
-                    p_address_item->manager = malloc(
-                        params[i].param_len);
-                    if (p_address_item->manager == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->manager,
+                        &p_address_item->manager_len, &params[i], copy) != 0) {
                         return -29;
                     }
-                    memcpy(p_address_item->manager,
-                        params[i].param_data, params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "BPGR", 4) == 0) {
-                    p_address_item->pager_len = params[i].param_len;
-                    p_address_item->pager = malloc(
-                        params[i].param_len);
-                    if (p_address_item->pager == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->pager,
+                        &p_address_item->pager_len, &params[i], copy) != 0) {
                         return -30;
                     }
-                    memcpy(p_address_item->pager,
-                        params[i].param_data, params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "CPS1", 4) == 0) {
-                    p_address_item->cellular_len = params[i].param_len;
-                    p_address_item->cellular = malloc(
-                        params[i].param_len);
-                    if (p_address_item->cellular == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->cellular,
+                        &p_address_item->cellular_len, &params[i], copy) != 0) {
                         return -31;
                     }
-                    memcpy(p_address_item->cellular,
-                        params[i].param_data, params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "TEL1", 4) == 0) {
-                    p_address_item->home_phone_len = params[i].param_len;
-                    p_address_item->home_phone = malloc(
-                        params[i].param_len);
-                    if (p_address_item->home_phone == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->home_phone,
+                        &p_address_item->home_phone_len, &params[i],
+                        copy) != 0) {
                         return -32;
                     }
-                    memcpy(p_address_item->home_phone,
-                        params[i].param_data, params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "FAX1", 4) == 0) {
-                    p_address_item->home_fax_len = params[i].param_len;
-                    p_address_item->home_fax = malloc(
-                        params[i].param_len);
-                    if (p_address_item->home_fax == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->home_fax,
+                        &p_address_item->home_fax_len, &params[i], copy) != 0) {
                         return -33;
                     }
-                    memcpy(p_address_item->home_fax,
-                        params[i].param_data, params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "HSTA", 4) == 0) {
-                    p_address_item->home_state_len = params[i].param_len;
-                    p_address_item->home_state = malloc(
-                        params[i].param_len);
-                    if (p_address_item->home_state == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->home_state,
+                        &p_address_item->home_state_len, &params[i],
+                        copy) != 0) {
                         return -34;
                     }
-                    memcpy(p_address_item->home_state,
-                        params[i].param_data, params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "HCTY", 4) == 0) {
-                    p_address_item->home_city_len = params[i].param_len;
-                    p_address_item->home_city = malloc(
-                        params[i].param_len);
-                    if (p_address_item->home_city == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->home_city,
+                        &p_address_item->home_city_len, &params[i],
+                        copy) != 0) {
                         return -35;
                     }
-                    memcpy(p_address_item->home_city,
-                        params[i].param_data, params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "HSTR", 4) == 0) {
-                    p_address_item->home_street_len = params[i].param_len;
-                    p_address_item->home_street = malloc(
-                        params[i].param_len);
-                    if (p_address_item->home_street == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->home_street,
+                        &p_address_item->home_street_len, &params[i],
+                        copy) != 0) {
                         return -36;
                     }
-                    memcpy(p_address_item->home_street,
-                        params[i].param_data, params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "HZIP", 4) == 0) {
-                    p_address_item->home_zip_len = params[i].param_len;
-                    p_address_item->home_zip = malloc(
-                        params[i].param_len);
-                    if (p_address_item->home_zip == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->home_zip,
+                        &p_address_item->home_zip_len, &params[i], copy) != 0) {
                         return -37;
                     }
-                    memcpy(p_address_item->home_zip,
-                        params[i].param_data, params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "HCTR", 4) == 0) {
-                    p_address_item->home_country_len = params[i].param_len;
-                    p_address_item->home_country = malloc(
-                        params[i].param_len);
-                    if (p_address_item->home_country == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->home_country,
+                        &p_address_item->home_country_len, &params[i],
+                        copy) != 0) {
                         return -38;
                     }
-                    memcpy(p_address_item->home_country,
-                        params[i].param_data, params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "HWEB", 4) == 0) {
-                    p_address_item->home_web_page_len = params[i].param_len;
-                    p_address_item->home_web_page = malloc(
-                        params[i].param_len);
-                    if (p_address_item->home_web_page == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->home_web_page,
+                        &p_address_item->home_web_page_len, &params[i],
+                        copy) != 0) {
                         return -39;
                     }
-                    memcpy(p_address_item->home_web_page,
-                        params[i].param_data, params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "DMAL", 4) == 0) {
-                    p_address_item->default_email_len = params[i].param_len;
-                    p_address_item->default_email = malloc(
-                        params[i].param_len);
-                    if (p_address_item->default_email == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->default_email,
+                        &p_address_item->default_email_len, &params[i],
+                        copy) != 0) {
                         return -40;
                     }
-                    memcpy(p_address_item->default_email,
-                        params[i].param_data, params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "MAL1", 4) == 0) {
-                    p_address_item->emails_len = params[i].param_len;
-                    p_address_item->emails = malloc(
-                        params[i].param_len);
-                    if (p_address_item->emails == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->emails,
+                        &p_address_item->emails_len, &params[i], copy) != 0) {
                         return -41;
                     }
-                    memcpy(p_address_item->emails,
-                        params[i].param_data, params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "SPUS", 4) == 0) {
-                    p_address_item->spouse_len = params[i].param_len;
-                    p_address_item->spouse = malloc(
-                        params[i].param_len);
-                    if (p_address_item->spouse == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->spouse,
+                        &p_address_item->spouse_len, &params[i], copy) != 0) {
                         return -42;
                     }
-                    memcpy(p_address_item->spouse,
-                        params[i].param_data, params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "GNDR", 4) == 0) {
-                    p_address_item->gender_len = params[i].param_len;
-                    p_address_item->gender = malloc(
-                        params[i].param_len);
-                    if (p_address_item->gender == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->gender,
+                        &p_address_item->gender_len, &params[i], copy) != 0) {
                         return -43;
                     }
-                    memcpy(p_address_item->gender,
-                        params[i].param_data, params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "BRTH", 4) == 0) {
-                    p_address_item->birthday_len = params[i].param_len;
-                    p_address_item->birthday = malloc(
-                        params[i].param_len);
-                    if (p_address_item->birthday == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->birthday,
+                        &p_address_item->birthday_len, &params[i], copy) != 0) {
                         return -44;
                     }
-                    memcpy(p_address_item->birthday,
-                        params[i].param_data, params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "ANIV", 4) == 0) {
-                    p_address_item->anniversary_len = params[i].param_len;
-                    p_address_item->anniversary = malloc(
-                        params[i].param_len);
-                    if (p_address_item->anniversary == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->anniversary,
+                        &p_address_item->anniversary_len, &params[i],
+                        copy) != 0) {
                         return -45;
                     }
-                    memcpy(p_address_item->anniversary,
-                        params[i].param_data, params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "NCNM", 4) == 0) {
-                    p_address_item->nickname_len = params[i].param_len;
-                    p_address_item->nickname = malloc(
-                        params[i].param_len);
-                    if (p_address_item->nickname == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->nickname,
+                        &p_address_item->nickname_len, &params[i], copy) != 0) {
                         return -46;
                     }
-                    memcpy(p_address_item->nickname,
-                        params[i].param_data, params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "CLDR", 4) == 0) {
-                    p_address_item->children_len = params[i].param_len;
-                    p_address_item->children = malloc(
-                        params[i].param_len);
-                    if (p_address_item->children == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->children,
+                        &p_address_item->children_len, &params[i], copy) != 0) {
                         return -47;
                     }
-                    memcpy(p_address_item->children,
-                        params[i].param_data, params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "MEM1", 4) == 0) {
-                    p_address_item->memo_len = params[i].param_len;
-                    p_address_item->memo = malloc(
-                        params[i].param_len);
-                    if (p_address_item->memo == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->memo,
+                        &p_address_item->memo_len, &params[i], copy) != 0) {
                         return -48;
                     }
-                    memcpy(p_address_item->memo,
-                        params[i].param_data, params[i].param_len);
                 } else if (memcmp(p_param_format[i].abrev, "GRPS", 4) == 0) {
-                    p_address_item->group_len = params[i].param_len;
-                    p_address_item->group = malloc(
-                        params[i].param_len);
-                    if (p_address_item->group == NULL) {
+                    if (_zdtm_set_param_str(&p_address_item->group,
+                        &p_address_item->group_len, &params[i], copy) != 0) {
                         return -49;
                     }
-                    memcpy(p_address_item->group,
-                        params[i].param_data, params[i].param_len);
                 }
                 break;
             case DATA_ID_ULONG:
                 if (memcmp(p_param_format[i].abrev, "SYID", 4) == 0) {
-                    memcpy(&p_address_item->sync_id, params[i].param_data,
-                        params[i].param_len);
+                    _zdtm_set_param_fixed(&p_address_item->sync_id,
+                        sizeof(p_address_item->sync_id), &params[i]);
                 }
                 break;
             default:
@@ -1212,6 +1302,33 @@ int _zdtm_parse_address_item_params(struct zdtm_adi_msg_param *p_param_format,
     return 0;
 }
 
+int _zdtm_intern_category(zdtm_lib_env *cur_env, char **pp_category,
+    uint32_t category_len, uint16_t *p_id, int share) {
+
+    uint32_t len;
+
+    if (cur_env->categories == NULL) {
+        cur_env->categories = malloc(sizeof(zdtm_category_table));
+        if (cur_env->categories == NULL) {
+            return -1;
+        }
+        zdtm_category_table_init(cur_env->categories);
+    }
+
+    if (zdtm_category_intern(cur_env->categories, (*pp_category),
+        category_len, p_id) != 0) {
+        return -1;
+    }
+
+    if (share) {
+        free(*pp_category);
+        (*pp_category) = (char *)zdtm_category_lookup(cur_env->categories,
+            (*p_id), &len);
+    }
+
+    return 0;
+}
+
 int _zdtm_state_sync_done(zdtm_lib_env *cur_env) {
     zdtm_msg msg, rmsg;
     int r;
@@ -1247,5 +1364,9 @@ int _zdtm_disconnect(zdtm_lib_env *cur_env) {
     r = _zdtm_close_conn_to_zaurus(cur_env);
     if (r != 0) { return -1; }
 
+    /* close connection from the Zaurus */
+    r = _zdtm_close_zaurus_conn(cur_env);
+    if (r != 0) { return -2; }
+
     return 0;
 }
@@ -33,11 +33,17 @@
 #ifndef ZDTM_PROTO_H
 #define ZDTM_PROTO_H
 
+#include <stdio.h>
 #include <time.h>
 #include "zdtm_types.h"
 #include "zdtm_net.h"
+#include "zdtm_steps.h"
 #include "zdtm_log.h"
 
+// Largest file _zdtm_obtain_file() accepts from the Zaurus. DTM files
+// are far smaller, the size reported by the device is not trusted.
+#define ZDTM_MAX_FILE_SIZE (64UL * 1024 * 1024)
+
 /**
  * Connect to Zaurus.
  *
@@ -71,6 +77,26 @@ int _zdtm_connect(zdtm_lib_env *cur_env, const char *ip_addr);
  */
 int _zdtm_handle_connection(zdtm_lib_env *cur_env);
 
+/**
+ * Identify Zaurus.
+ *
+ * The _zdtm_identify function performs the shortest session which
+ * obtains the device info of a Zaurus, over a connection to the
+ * Zaurus already made and stored as the reqfd of the environment. It
+ * asks the Zaurus to connect back, obtains the device info and quits
+ * the session, leaving the connections to be closed with
+ * _zdtm_disconnect().
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully obtained the device information.
+ * @retval -1 Failed to send RAY message to the Zaurus.
+ * @retval -2 Failed to handle the incoming Zaurus connection.
+ * @retval -3 Failed to initiate the session.
+ * @retval -4 Failed to obtain the device information.
+ * @retval -5 Failed to quit the session.
+ */
+int _zdtm_identify(zdtm_lib_env *cur_env);
+
 /**
  * Obtain Device Information
  *
@@ -236,6 +262,63 @@ int _zdtm_obtain_param_format(zdtm_lib_env *cur_env);
 int _zdtm_obtain_item(zdtm_lib_env *cur_env, uint32_t sync_id,
     struct zdtm_adr_msg_param **p_params, uint16_t *p_num_params);
 
+/**
+ * Obtain Raw Item
+ *
+ * The _zdtm_obtain_raw_item function attempts to obtain the data of an
+ * item on the Zaurus given the sync id of that item, the same as
+ * _zdtm_obtain_item() does, but leaves the content of the ADR message
+ * unparsed. If successful it stores the address of the dynamically
+ * allocated raw content in the pointer passed by address as pp_buf,
+ * which must be freed using the free() function, and its size in the
+ * variable passed by address as p_size. The raw content is NULL when
+ * the ADR message has none.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param sync_id The sync id of the item to obtain.
+ * @param pp_buf Pointer to the pointer to store addr of raw content in.
+ * @param p_size Pointer to variable to store size of raw content in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully obtained the raw item.
+ * @retval -1 Failed to send RDR message.
+ * @retval -2 Failed to recv response message.
+ * @retval -3 Failed, response message is NOT an ADR message.
+ */
+int _zdtm_obtain_raw_item(zdtm_lib_env *cur_env, uint32_t sync_id,
+    void **pp_buf, uint16_t *p_size);
+
+/**
+ * Write Items
+ *
+ * The _zdtm_write_items function attempts to write the given items of
+ * the current sync type to the Zaurus, laid out by the parameter format
+ * of the session, either item structures or records. The first RDW
+ * message carries a single item, and each message the Zaurus takes
+ * whole is followed by one carrying twice as many, as many as fit at
+ * most. When the Zaurus answers with the sync ids of fewer items than a
+ * message carried, the rest are sent again, never packing more items
+ * into a message than the Zaurus took from the last one.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param variation RDW_VAR_FORMAT for item structures of the current
+ * sync type, RDW_VAR_RECORD for records.
+ * @param items Pointer to the array of items to write.
+ * @param item_size The size of an item of the array in bytes.
+ * @param num_items The number of items in the array.
+ * @param p_sync_ids Pointer to num_items entries to store the sync id
+ * the Zaurus assigned to each item in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully wrote the items.
+ * @retval -1 Failed to obtain the parameter format.
+ * @retval -2 Failed to allocate memory for the map of the format.
+ * @retval -3 Failed, the items do not fit the current sync type.
+ * @retval -4 Failed to send RDW message.
+ * @retval -5 Failed to recv response message.
+ * @retval -6 Failed, response message is NOT an ADW message taking up
+ * to as many items as were sent.
+ */
+int _zdtm_write_items(zdtm_lib_env *cur_env, unsigned char variation,
+    const void *items, size_t item_size, uint16_t num_items,
+    uint32_t *p_sync_ids);
+
 /**
  * Free Parameters
  *
@@ -253,6 +336,58 @@ int _zdtm_obtain_item(zdtm_lib_env *cur_env, uint32_t sync_id,
 int _zdtm_free_params(zdtm_lib_env *cur_env,
     struct zdtm_adr_msg_param *p_params, uint16_t num_params);
 
+/**
+ * Obtain File
+ *
+ * The _zdtm_obtain_file function attempts to obtain the contents of a
+ * file on the Zaurus, such as a DTM index file or DTM box file, given
+ * the path of the file. It sends an RGE message and receives the AGE
+ * messages carrying the file in chunks. If fp is not NULL each chunk is
+ * written to fp as it is received, otherwise the chunks are assembled
+ * in a dynamically allocated buffer whose address is stored in the
+ * pointer passed by address as pp_buf. Said buffer must be freed using
+ * the free() function. In both cases the size of the file is stored in
+ * the variable passed by address as p_size.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param path The path of the file on the Zaurus.
+ * @param fp File to write the contents to, NULL to obtain a buffer.
+ * @param pp_buf Pointer to the pointer to store addr of the buffer in.
+ * @param p_size Pointer to variable to store the size of the file in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully obtained the file.
+ * @retval -1 Failed to send RGE message.
+ * @retval -2 Failed to recv response message.
+ * @retval -3 Failed, response message is NOT an AGE message.
+ * @retval -4 Failed, a chunk does not follow the previous one.
+ * @retval -5 Failed to allocate memory for the file contents.
+ * @retval -6 Failed to write the contents to fp.
+ * @retval -7 Failed, the file is larger than ZDTM_MAX_FILE_SIZE.
+ */
+int _zdtm_obtain_file(zdtm_lib_env *cur_env, const char *path, FILE *fp,
+    unsigned char **pp_buf, uint32_t *p_size);
+
+/**
+ * Obtain Item Listing
+ *
+ * The _zdtm_obtain_item_listing function attempts to obtain a listing
+ * of every item of the current synchronization type on the Zaurus,
+ * regardless of the synchronization state, by sending an RLR message.
+ * If successful it stores the address of a dynamically allocated array
+ * of the entries of the listing, which must be freed using free(), in
+ * the pointer passed by address as pp_entries and the number of entries
+ * in the variable passed by address as p_num_entries.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param pp_entries Pointer to the pointer to store addr of entries in.
+ * @param p_num_entries Pointer to variable to store num of entries in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully obtained the item listing.
+ * @retval -1 Failed to send RLR message.
+ * @retval -2 Failed to recv response message.
+ * @retval -3 Failed, response message is NOT an ALR message.
+ */
+int _zdtm_obtain_item_listing(zdtm_lib_env *cur_env,
+    struct zdtm_alr_entry **pp_entries, uint16_t *p_num_entries);
+
 /**
  * Parse params for a Todo item.
  *
@@ -277,6 +412,26 @@ int _zdtm_parse_todo_item_params(struct zdtm_adi_msg_param *p_param_format,
     uint16_t num_format_params, struct zdtm_adr_msg_param *params,
     uint16_t num_params, struct zdtm_todo_item *p_todo_item);
 
+/**
+ * Map params onto a Todo item.
+ *
+ * The _zdtm_map_todo_item_params function implements the field mapping
+ * of the _zdtm_parse_todo_item_params() function. If copy is zero the
+ * string members of the Todo item are not allocated but point directly
+ * at the data of the params, hence they are only valid as long as the
+ * params data is and must not be freed.
+ * @param p_param_format Pointer to parameter based format.
+ * @param num_format_params The number of params in the format.
+ * @param params Pointer to item data params.
+ * @param num_params The number of item data params.
+ * @param p_todo_item Pointer to zdtm_todo_item struct to store results in.
+ * @param copy Flag stating if the string members should be copied.
+ * @return The same values as _zdtm_parse_todo_item_params().
+ */
+int _zdtm_map_todo_item_params(struct zdtm_adi_msg_param *p_param_format,
+    uint16_t num_format_params, struct zdtm_adr_msg_param *params,
+    uint16_t num_params, struct zdtm_todo_item *p_todo_item, int copy);
+
 /**
  * Parse params for a Calendar item.
  *
@@ -302,6 +457,26 @@ int _zdtm_parse_calendar_item_params(struct zdtm_adi_msg_param *p_param_format,
     uint16_t num_format_params, struct zdtm_adr_msg_param *params,
     uint16_t num_params, struct zdtm_calendar_item *p_calendar_item);
 
+/**
+ * Map params onto a Calendar item.
+ *
+ * The _zdtm_map_calendar_item_params function implements the field mapping
+ * of the _zdtm_parse_calendar_item_params() function. If copy is zero the
+ * string members of the Calendar item are not allocated but point directly
+ * at the data of the params, hence they are only valid as long as the
+ * params data is and must not be freed.
+ * @param p_param_format Pointer to parameter based format.
+ * @param num_format_params The number of params in the format.
+ * @param params Pointer to item data params.
+ * @param num_params The number of item data params.
+ * @param p_calendar_item Pointer to zdtm_calendar_item struct to store results in.
+ * @param copy Flag stating if the string members should be copied.
+ * @return The same values as _zdtm_parse_calendar_item_params().
+ */
+int _zdtm_map_calendar_item_params(struct zdtm_adi_msg_param *p_param_format,
+    uint16_t num_format_params, struct zdtm_adr_msg_param *params,
+    uint16_t num_params, struct zdtm_calendar_item *p_calendar_item, int copy);
+
 /**
  * Parse params for a Address item.
  *
@@ -324,6 +499,48 @@ int _zdtm_parse_address_item_params(struct zdtm_adi_msg_param *p_param_format,
     uint16_t num_format_params, struct zdtm_adr_msg_param *params,
     uint16_t num_params, struct zdtm_address_item *p_address_item);
 
+/**
+ * Map params onto a Address item.
+ *
+ * The _zdtm_map_address_item_params function implements the field mapping
+ * of the _zdtm_parse_address_item_params() function. If copy is zero the
+ * string members of the Address item are not allocated but point directly
+ * at the data of the params, hence they are only valid as long as the
+ * params data is and must not be freed.
+ * @param p_param_format Pointer to parameter based format.
+ * @param num_format_params The number of params in the format.
+ * @param params Pointer to item data params.
+ * @param num_params The number of item data params.
+ * @param p_address_item Pointer to zdtm_address_item struct to store results in.
+ * @param copy Flag stating if the string members should be copied.
+ * @return The same values as _zdtm_parse_address_item_params().
+ */
+int _zdtm_map_address_item_params(struct zdtm_adi_msg_param *p_param_format,
+    uint16_t num_format_params, struct zdtm_adr_msg_param *params,
+    uint16_t num_params, struct zdtm_address_item *p_address_item, int copy);
+
+/**
+ * Intern item category.
+ *
+ * The _zdtm_intern_category function interns the category of an item
+ * obtained in the session, creating the category table of the session
+ * the first time, and sets the category ID of the item. When share is
+ * non-zero the copy of the category the item was built with is
+ * released and the item is pointed at the payload held by the table
+ * instead. Note: Only one thread may use the category table of the
+ * session at a time.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param pp_category Pointer to the category member of the item.
+ * @param category_len The length of the category of the item.
+ * @param p_id Pointer to the category ID member of the item.
+ * @param share Flag stating if the item should share its category.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully interned the category.
+ * @retval -1 Failed to intern the category.
+ */
+int _zdtm_intern_category(zdtm_lib_env *cur_env, char **pp_category,
+    uint32_t category_len, uint16_t *p_id, int share);
+
 /**
  * State Sync is Done
  * 
@@ -348,6 +565,7 @@ int _zdtm_state_sync_done(zdtm_lib_env *cur_env);
  * @return An integer representing success (zero) or failure (non-zero).
  * @retval 0 Successfully disconnected from the Zaurus.
  * @retval -1 Failed to close TCP/IP connection to Zaurus.
+ * @retval -2 Failed to close TCP/IP connection from Zaurus.
  */
 int _zdtm_disconnect(zdtm_lib_env *cur_env);
 
@@ -29,25 +29,14 @@ int zdtm_rdd_length(struct zdtm_rdd_msg_content *rdd){
            sizeof(rdd->sync_id);
 }
 
-void *zdtm_rdd_write(void *buf, struct zdtm_rdd_msg_content *rdd){
-    *((unsigned char*)buf++) = rdd->sync_type;
+int zdtm_rdd_write(zdtm_writer *p_wr, struct zdtm_rdd_msg_content *rdd){
+    if (zdtm_wr_need(p_wr, zdtm_rdd_length(rdd)) != 0)
+        return RET_BAD_SIZE;
 
-#ifdef WORDS_BIGENDIAN
-    *((uint16_t*)buf) = zdtm_liltobigs(rdd->num_sync_ids);
-    buf += sizeof(uint16_t);
+    zdtm_wr_u8(p_wr, rdd->sync_type);
+    zdtm_wr_u16(p_wr, rdd->num_sync_ids);
+    zdtm_wr_u32(p_wr, rdd->sync_id);
 
-    *((uint32_t*)buf) = zdtm_liltobigs(rdd->sync_id);
-    buf += sizeof(uint32_t);
-
-#else
-    *((uint16_t*)buf) = rdd->num_sync_ids;
-    buf += sizeof(uint16_t);
-
-    *((uint32_t*)buf) = rdd->sync_id;
-    buf += sizeof(uint32_t);
-
-#endif
-
-    return buf;
+    return 0;
 }
 
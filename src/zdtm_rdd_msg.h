@@ -44,7 +44,8 @@ extern const char *RDD_MSG_TYPE;
 #define IS_RDD(x) (memcmp(x->body.type, RDD_MSG_TYPE, MSG_TYPE_SIZE) == 0)
 
 inline int zdtm_rdd_length(struct zdtm_rdd_msg_content *rdd);
-inline void *zdtm_rdd_write(void *buf, struct zdtm_rdd_msg_content *rdd);
+inline int zdtm_rdd_write(zdtm_writer *p_wr,
+    struct zdtm_rdd_msg_content *rdd);
 
 
 #endif
@@ -28,8 +28,12 @@ int zdtm_rdi_length(struct zdtm_rdi_msg_content *rdi){
     return sizeof(struct zdtm_rdi_msg_content);
 }
 
-void *zdtm_rdi_write(void *buf, struct zdtm_rdi_msg_content *rdi){
-    *((unsigned char*)buf++) = rdi->sync_type;
-    *((unsigned char*)buf++) = rdi->uk;
-    return buf;
+int zdtm_rdi_write(zdtm_writer *p_wr, struct zdtm_rdi_msg_content *rdi){
+    if (zdtm_wr_need(p_wr, zdtm_rdi_length(rdi)) != 0)
+        return RET_BAD_SIZE;
+
+    zdtm_wr_u8(p_wr, rdi->sync_type);
+    zdtm_wr_u8(p_wr, rdi->uk);
+
+    return 0;
 }
@@ -44,7 +44,8 @@ extern const char *RDI_MSG_TYPE;
 #define IS_RDI(x) (memcmp(x->body.type, RDI_MSG_TYPE, MSG_TYPE_SIZE) == 0)
 
 inline int zdtm_rdi_length(struct zdtm_rdi_msg_content *rdi);
-inline void *zdtm_rdi_write(void *buf, struct zdtm_rdi_msg_content *rdi);
+inline int zdtm_rdi_write(zdtm_writer *p_wr,
+    struct zdtm_rdi_msg_content *rdi);
 
 
 #endif
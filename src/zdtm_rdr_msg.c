@@ -42,24 +42,14 @@ int zdtm_rdr_length(struct zdtm_rdr_msg_content *rdr){
            sizeof(rdr->sync_id);
 }
 
-void *zdtm_rdr_write(void *buf, struct zdtm_rdr_msg_content *rdr){
-    *((unsigned char*)buf++) = rdr->sync_type;
+int zdtm_rdr_write(zdtm_writer *p_wr, struct zdtm_rdr_msg_content *rdr){
+    if (zdtm_wr_need(p_wr, zdtm_rdr_length(rdr)) != 0)
+        return RET_BAD_SIZE;
 
-#ifdef WORDS_BIGENDIAN
-    *((uint16_t*)buf) = zdtm_liltobigs(rdr->num_sync_ids);
-    buf += sizeof(uint16_t);
+    zdtm_wr_u8(p_wr, rdr->sync_type);
+    zdtm_wr_u16(p_wr, rdr->num_sync_ids);
+    zdtm_wr_u32(p_wr, rdr->sync_id);
 
-    *((uint32_t*)buf) = zdtm_liltobigs(rdr->sync_id);
-    buf += sizeof(uint32_t);
-
-#else
-    *((uint16_t*)buf) = rdr->num_sync_ids;
-    buf += sizeof(uint16_t);
-
-    *((uint32_t*)buf) = rdr->sync_id;
-    buf += sizeof(uint32_t);
-
-#endif
-    return buf;
+    return 0;
 }
 
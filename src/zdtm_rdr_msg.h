@@ -47,7 +47,8 @@ extern const char *RDR_MSG_TYPE;
 #define IS_RDR(x) (memcmp(x->body.type, RDR_MSG_TYPE, MSG_TYPE_SIZE) == 0)
 
 inline int zdtm_rdr_length(struct zdtm_rdr_msg_content *rdr);
-inline void *zdtm_rdr_write(void *buf, struct zdtm_rdr_msg_content *rdr);
+inline int zdtm_rdr_write(zdtm_writer *p_wr,
+    struct zdtm_rdr_msg_content *rdr);
 
 
 #endif
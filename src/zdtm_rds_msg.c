@@ -27,12 +27,14 @@ int zdtm_rds_length(struct zdtm_rds_msg_content *rds){
     return sizeof(struct zdtm_rds_msg_content);
 }
 
-void *zdtm_rds_write(void *buf, struct zdtm_rds_msg_content *rds){
-    *((unsigned char*)buf++) = rds->sync_type;
-    *((unsigned char*)buf++) = rds->status;
-    memcpy(buf, rds->null_bytes, sizeof(rds->null_bytes));
-    buf += sizeof(rds->null_bytes);
+int zdtm_rds_write(zdtm_writer *p_wr, struct zdtm_rds_msg_content *rds){
+    if (zdtm_wr_need(p_wr, zdtm_rds_length(rds)) != 0)
+        return RET_BAD_SIZE;
 
-    return buf;
+    zdtm_wr_u8(p_wr, rds->sync_type);
+    zdtm_wr_u8(p_wr, rds->status);
+    zdtm_wr_bytes(p_wr, rds->null_bytes, sizeof(rds->null_bytes));
+
+    return 0;
 }
 
@@ -43,7 +43,8 @@ extern const char *RDS_MSG_TYPE;
 #define IS_RDS(x) (memcmp(x->body.type, RDS_MSG_TYPE, MSG_TYPE_SIZE) == 0)
 
 inline int zdtm_rds_length(struct zdtm_rds_msg_content *rds);
-inline void *zdtm_rds_write(void *buf, struct zdtm_rds_msg_content *rds);
+inline int zdtm_rds_write(zdtm_writer *p_wr,
+    struct zdtm_rds_msg_content *rds);
 
 
 #endif
@@ -20,11 +20,406 @@
  */
 
 #include "zdtm_rdw_msg.h"
+#include <stddef.h>
 
 const char *RDW_MSG_TYPE = "RDW";
 
+// How a member of an item is written.
+#define RDW_FIELD_FIXED 0   // bytes of a fixed size member
+#define RDW_FIELD_U16 1     // uint16_t member
+#define RDW_FIELD_U32 2     // uint32_t member
+#define RDW_FIELD_STR 3     // string member along with its length member
+
+// Number of fields, leading the fields of every item, which are written
+// ahead of the content of the item by variation three.
+#define RDW_NUM_HEADER 4
+
+/* A field of an item, the parameter it is written as, and where it is
+ * found in the item. */
+struct _zdtm_rdw_field {
+    const char *abrev;          // abbreviation of the parameter
+    unsigned char type_id;      // data type of the parameter
+    unsigned char kind;         // how the member is written (RDW_FIELD_*)
+    uint16_t size;              // size of a fixed size member
+    size_t offset;              // offset of the member in the item
+    size_t len_offset;          // offset of the length of a string member
+};
+
+#define RDW_FIXED(ab, id, type, m) \
+    {ab, id, RDW_FIELD_FIXED, sizeof(((type *)0)->m), offsetof(type, m), 0}
+#define RDW_U16(ab, id, type, m) \
+    {ab, id, RDW_FIELD_U16, sizeof(uint16_t), offsetof(type, m), 0}
+#define RDW_U32(ab, id, type, m) \
+    {ab, id, RDW_FIELD_U32, sizeof(uint32_t), offsetof(type, m), 0}
+#define RDW_STR(ab, id, type, m) \
+    {ab, id, RDW_FIELD_STR, 0, offsetof(type, m), offsetof(type, m##_len)}
+
+#define RDW_HEADER(type) \
+    RDW_FIXED("ATTR", DATA_ID_BIT, type, attribute), \
+    RDW_FIXED("CTTM", DATA_ID_TIME, type, creation_date), \
+    RDW_FIXED("MDTM", DATA_ID_TIME, type, modification_date), \
+    RDW_U32("SYID", DATA_ID_ULONG, type, sync_id)
+
+/* The fields of the items, the header ones followed by the content in
+ * the order the fixed variations write it. */
+static const struct _zdtm_rdw_field _zdtm_todo_fields[] = {
+    RDW_HEADER(struct zdtm_todo_item),
+    RDW_STR("CTGR", DATA_ID_BARRAY, struct zdtm_todo_item, category),
+    RDW_FIXED("ETDY", DATA_ID_TIME, struct zdtm_todo_item, start_date),
+    RDW_FIXED("LTDY", DATA_ID_TIME, struct zdtm_todo_item, due_date),
+    RDW_FIXED("FNDY", DATA_ID_TIME, struct zdtm_todo_item, completed_date),
+    RDW_FIXED("MARK", DATA_ID_UCHAR, struct zdtm_todo_item, progress),
+    RDW_FIXED("PRTY", DATA_ID_UCHAR, struct zdtm_todo_item, priority),
+    RDW_STR("TITL", DATA_ID_UTF8, struct zdtm_todo_item, description),
+    RDW_STR("MEM1", DATA_ID_UTF8, struct zdtm_todo_item, notes)
+};
+
+static const struct _zdtm_rdw_field _zdtm_calendar_fields[] = {
+    RDW_HEADER(struct zdtm_calendar_item),
+    RDW_STR("CTGR", DATA_ID_BARRAY, struct zdtm_calendar_item, category),
+    RDW_STR("DSRP", DATA_ID_UTF8, struct zdtm_calendar_item, description),
+    RDW_STR("PLCE", DATA_ID_UTF8, struct zdtm_calendar_item, location),
+    RDW_STR("MEM1", DATA_ID_UTF8, struct zdtm_calendar_item, notes),
+    RDW_FIXED("TIM1", DATA_ID_TIME, struct zdtm_calendar_item, start_time),
+    RDW_FIXED("TIM2", DATA_ID_TIME, struct zdtm_calendar_item, end_time),
+    RDW_FIXED("ADAY", DATA_ID_UCHAR, struct zdtm_calendar_item,
+        schedule_type),
+    RDW_FIXED("ARON", DATA_ID_UCHAR, struct zdtm_calendar_item, alarm),
+    RDW_FIXED("ARSD", DATA_ID_UCHAR, struct zdtm_calendar_item,
+        alarm_setting),
+    RDW_U16("ARMN", DATA_ID_WORD, struct zdtm_calendar_item, alarm_time),
+    RDW_FIXED("RTYP", DATA_ID_UCHAR, struct zdtm_calendar_item,
+        repeat_type),
+    RDW_U16("RFRQ", DATA_ID_WORD, struct zdtm_calendar_item, repeat_period),
+    RDW_U16("RPOS", DATA_ID_WORD, struct zdtm_calendar_item,
+        repeat_position),
+    RDW_FIXED("RDYS", DATA_ID_UCHAR, struct zdtm_calendar_item,
+        repeat_date),
+    RDW_FIXED("REND", DATA_ID_UCHAR, struct zdtm_calendar_item,
+        repeat_end_date_setting),
+    RDW_FIXED("REDT", DATA_ID_TIME, struct zdtm_calendar_item,
+        repeat_end_date),
+    RDW_FIXED("ALSD", DATA_ID_TIME, struct zdtm_calendar_item,
+        all_day_start_date),
+    RDW_FIXED("ALED", DATA_ID_TIME, struct zdtm_calendar_item,
+        all_day_end_date),
+    RDW_FIXED("MDAY", DATA_ID_UCHAR, struct zdtm_calendar_item,
+        multiple_days_flag)
+};
+
+#define RDW_ADDR_STR(ab, m) \
+    RDW_STR(ab, DATA_ID_UTF8, struct zdtm_address_item, m)
+
+static const struct _zdtm_rdw_field _zdtm_address_fields[] = {
+    RDW_HEADER(struct zdtm_address_item),
+    RDW_STR("CTGR", DATA_ID_BARRAY, struct zdtm_address_item, category),
+    RDW_ADDR_STR("FULL", full_name),
+    RDW_ADDR_STR("NAPR", full_name_pronun),
+    RDW_ADDR_STR("TITL", title),
+    RDW_ADDR_STR("LNME", last_name),
+    RDW_ADDR_STR("FNME", first_name),
+    RDW_ADDR_STR("MNME", middle_name),
+    RDW_ADDR_STR("SUFX", suffix),
+    RDW_ADDR_STR("FLAS", alternative_name),
+    RDW_ADDR_STR("LNPR", last_name_pronun),
+    RDW_ADDR_STR("FNPR", first_name_pronun),
+    RDW_ADDR_STR("CPNY", company),
+    RDW_ADDR_STR("CPPR", company_pronun),
+    RDW_ADDR_STR("SCTN", department),
+    RDW_ADDR_STR("PSTN", job_title),
+    RDW_ADDR_STR("TEL2", work_phone),
+    RDW_ADDR_STR("FAX2", work_fax),
+    RDW_ADDR_STR("CPS2", work_mobile),
+    RDW_ADDR_STR("BSTA", work_state),
+    RDW_ADDR_STR("BCTY", work_city),
+    RDW_ADDR_STR("BSTR", work_street),
+    RDW_ADDR_STR("BZIP", work_zip),
+    RDW_ADDR_STR("BCTR", work_country),
+    RDW_ADDR_STR("BWEB", work_web_page),
+    RDW_ADDR_STR("OFCE", office),
+    RDW_ADDR_STR("PRFS", profession),
+    RDW_ADDR_STR("ASST", assistant),
+    RDW_ADDR_STR("MNGR", manager),
+    RDW_ADDR_STR("BPGR", pager),
+    RDW_ADDR_STR("CPS1", cellular),
+    RDW_ADDR_STR("TEL1", home_phone),
+    RDW_ADDR_STR("FAX1", home_fax),
+    RDW_ADDR_STR("HSTA", home_state),
+    RDW_ADDR_STR("HCTY", home_city),
+    RDW_ADDR_STR("HSTR", home_street),
+    RDW_ADDR_STR("HZIP", home_zip),
+    RDW_ADDR_STR("HCTR", home_country),
+    RDW_ADDR_STR("HWEB", home_web_page),
+    RDW_ADDR_STR("DMAL", default_email),
+    RDW_ADDR_STR("MAL1", emails),
+    RDW_ADDR_STR("SPUS", spouse),
+    RDW_ADDR_STR("GNDR", gender),
+    RDW_ADDR_STR("BRTH", birthday),
+    RDW_ADDR_STR("ANIV", anniversary),
+    RDW_ADDR_STR("NCNM", nickname),
+    RDW_ADDR_STR("CLDR", children),
+    RDW_ADDR_STR("MEM1", memo),
+    RDW_ADDR_STR("GRPS", group)
+};
+
+/* The items of a sync type. */
+struct _zdtm_rdw_type {
+    unsigned char sync_type;
+    const struct _zdtm_rdw_field *fields;
+    uint16_t num_fields;
+    size_t item_size;
+    size_t sync_id_offset;
+};
+
+#define RDW_TYPE(id, fields, type) \
+    {id, fields, sizeof(fields) / sizeof(fields[0]), sizeof(type), \
+        offsetof(type, sync_id)}
+
+static const struct _zdtm_rdw_type _zdtm_rdw_types[] = {
+    RDW_TYPE(SYNC_TYPE_TODO, _zdtm_todo_fields, struct zdtm_todo_item),
+    RDW_TYPE(SYNC_TYPE_CALENDAR, _zdtm_calendar_fields,
+        struct zdtm_calendar_item),
+    RDW_TYPE(SYNC_TYPE_ADDRESS, _zdtm_address_fields,
+        struct zdtm_address_item)
+};
+
+static const struct _zdtm_rdw_type *_zdtm_rdw_type(unsigned char sync_type) {
+    size_t i;
+
+    for (i = 0; i < sizeof(_zdtm_rdw_types) / sizeof(_zdtm_rdw_types[0]);
+        i++) {
+        if (_zdtm_rdw_types[i].sync_type == sync_type) {
+            return &_zdtm_rdw_types[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* Number of bytes the given field of the item is written as. */
+static uint32_t _zdtm_rdw_field_length(const struct _zdtm_rdw_field *field,
+    const unsigned char *item) {
+
+    if (field->kind == RDW_FIELD_STR) {
+        return sizeof(uint32_t) +
+            *(const uint32_t *)(item + field->len_offset);
+    }
+
+    return sizeof(uint32_t) + field->size;
+}
+
+/* Write the given field of the item, its length followed by its data.
+ * Zero on success, else non-zero if the writer has no room for it. */
+static int _zdtm_rdw_write_field(zdtm_writer *p_wr,
+    const struct _zdtm_rdw_field *field, const unsigned char *item) {
+
+    const unsigned char *p;
+
+    p = item + field->offset;
+    switch (field->kind) {
+        case RDW_FIELD_STR:
+            return zdtm_wr_field(p_wr, *(char * const *)p,
+                *(const uint32_t *)(item + field->len_offset));
+
+        case RDW_FIELD_U16:
+            if (zdtm_wr_need(p_wr, sizeof(uint32_t) + sizeof(uint16_t)) != 0)
+                return -1;
+            zdtm_wr_u32(p_wr, sizeof(uint16_t));
+            zdtm_wr_u16(p_wr, *(const uint16_t *)p);
+            return 0;
+
+        case RDW_FIELD_U32:
+            if (zdtm_wr_need(p_wr, 2 * sizeof(uint32_t)) != 0)
+                return -1;
+            zdtm_wr_u32(p_wr, sizeof(uint32_t));
+            zdtm_wr_u32(p_wr, *(const uint32_t *)p);
+            return 0;
+
+        default:
+            return zdtm_wr_field(p_wr, p, field->size);
+    }
+}
+
+/* Length of the fields of the item from the given one on. */
+static int _zdtm_rdw_fields_length(const struct _zdtm_rdw_type *p_type,
+    uint16_t first, const void *item) {
+
+    int size;
+    uint16_t i;
+
+    size = 0;
+    for (i = first; i < p_type->num_fields; i++) {
+        size += _zdtm_rdw_field_length(&p_type->fields[i], item);
+    }
+
+    return size;
+}
+
+static int _zdtm_rdw_write_fields(zdtm_writer *p_wr,
+    const struct _zdtm_rdw_type *p_type, uint16_t first, const void *item) {
+
+    uint16_t i;
+
+    for (i = first; i < p_type->num_fields; i++) {
+        if (_zdtm_rdw_write_field(p_wr, &p_type->fields[i], item) != 0)
+            return RET_BAD_SIZE;
+    }
+
+    return 0;
+}
+
+/* Length of the record of an item, as laid out by a format. */
+static int _zdtm_rdw_record_length(const struct _zdtm_rdw_type *p_type,
+    struct zdtm_rdw_msg_content *rdw, const unsigned char *item) {
+
+    int size;
+    uint16_t i;
+
+    size = sizeof(uint32_t);
+    for (i = 0; i < rdw->vars.four.num_params; i++) {
+        if (rdw->vars.four.map[i] < 0) {
+            size += sizeof(uint32_t);
+        } else {
+            size += _zdtm_rdw_field_length(
+                &p_type->fields[rdw->vars.four.map[i]], item);
+        }
+    }
+
+    return size;
+}
+
+static int _zdtm_rdw_write_record(zdtm_writer *p_wr,
+    const struct _zdtm_rdw_type *p_type, struct zdtm_rdw_msg_content *rdw,
+    const unsigned char *item) {
+
+    uint16_t i;
+
+    if (zdtm_wr_need(p_wr, sizeof(uint32_t)) != 0)
+        return -1;
+    zdtm_wr_u32(p_wr, *(const uint32_t *)(item + p_type->sync_id_offset));
+
+    for (i = 0; i < rdw->vars.four.num_params; i++) {
+        if (rdw->vars.four.map[i] < 0) {
+            // The items have nothing for it, it is left empty.
+            if (zdtm_wr_need(p_wr, sizeof(uint32_t)) != 0)
+                return -1;
+            zdtm_wr_u32(p_wr, 0);
+        } else if (_zdtm_rdw_write_field(p_wr,
+                &p_type->fields[rdw->vars.four.map[i]], item) != 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* Length of a record laid out by its schema. */
+static int _zdtm_rdw_rec_length(const zdtm_record *p_rec) {
+    return sizeof(uint32_t) +
+        (p_rec->schema->num_params * sizeof(uint32_t)) +
+        p_rec->offsets[p_rec->schema->num_params];
+}
+
+static int _zdtm_rdw_write_rec(zdtm_writer *p_wr, const zdtm_record *p_rec) {
+    uint16_t i;
+
+    if (zdtm_wr_need(p_wr, _zdtm_rdw_rec_length(p_rec)) != 0)
+        return -1;
+
+    zdtm_wr_u32(p_wr, p_rec->sync_id);
+    for (i = 0; i < p_rec->schema->num_params; i++) {
+        zdtm_wr_u32(p_wr, zdtm_record_len(p_rec, i));
+        zdtm_wr_bytes(p_wr, zdtm_record_field(p_rec, i),
+            zdtm_record_len(p_rec, i));
+    }
+
+    return 0;
+}
+
+/* Write the records of the items, as many as fit. A message is only
+ * cut short when the writer has the room of the largest message, so
+ * that a smaller buffer is grown rather than sending fewer records. */
+static int _zdtm_rdw_write_records(zdtm_writer *p_wr,
+    const struct _zdtm_rdw_type *p_type, struct zdtm_rdw_msg_content *rdw) {
+
+    const unsigned char *item;
+    unsigned char *p_count;
+    zdtm_writer mark;
+    uint16_t i, num;
+    int full, r;
+
+    full = (zdtm_wr_left(p_wr) >= ZDTM_MSG_MAX_CONT);
+    if (zdtm_wr_need(p_wr, sizeof(rdw->sync_type) +
+            sizeof(rdw->num_sync_ids)) != 0)
+        return RET_BAD_SIZE;
+
+    zdtm_wr_u8(p_wr, rdw->sync_type);
+    p_count = p_wr->pos;
+    zdtm_wr_u16(p_wr, rdw->num_sync_ids);
+
+    item = (const unsigned char *)rdw->vars.four.items;
+    for (i = 0; i < rdw->num_sync_ids; i++) {
+        mark = (*p_wr);
+        if (rdw->variation == RDW_VAR_RECORD) {
+            r = _zdtm_rdw_write_rec(p_wr, (const zdtm_record *)item);
+            item += sizeof(zdtm_record);
+        } else {
+            r = _zdtm_rdw_write_record(p_wr, p_type, rdw, item);
+            item += p_type->item_size;
+        }
+        if (r != 0) {
+            (*p_wr) = mark;
+            break;
+        }
+    }
+
+    if (i < rdw->num_sync_ids) {
+        if ((i == 0) || !full)
+            return RET_BAD_SIZE;
+
+        // Back-patch the number of records, and the sum along with it.
+        num = rdw->num_sync_ids;
+        zdtm_put_le16(p_count, i);
+        p_wr->sum += (i & 0xff) + (i >> 8);
+        p_wr->sum -= (num & 0xff) + (num >> 8);
+    }
+    rdw->vars.four.num_written = i;
+
+    return 0;
+}
+
+int zdtm_rdw_map_format(unsigned char sync_type,
+    const struct zdtm_adi_msg_param *params, uint16_t num_params,
+    int16_t *p_map) {
+
+    const struct _zdtm_rdw_type *p_type;
+    uint16_t i, j;
+
+    p_type = _zdtm_rdw_type(sync_type);
+    if (p_type == NULL)
+        return RET_UNK_TYPE;
+
+    for (i = 0; i < num_params; i++) {
+        p_map[i] = -1;
+        for (j = 0; j < p_type->num_fields; j++) {
+            if ((params[i].type_id == p_type->fields[j].type_id) &&
+                (memcmp(params[i].abrev, p_type->fields[j].abrev, 4) == 0)) {
+                p_map[i] = j;
+                break;
+            }
+        }
+    }
+
+    return 0;
+}
+
 int zdtm_rdw_length(struct zdtm_rdw_msg_content *rdw){
+    const struct _zdtm_rdw_type *p_type;
+    const unsigned char *item;
     int size = 0;
+    uint16_t i;
+
+    p_type = _zdtm_rdw_type(rdw->sync_type);
 
     /* This one is tricky. */
     size += sizeof(rdw->sync_type);
@@ -33,19 +428,11 @@ int zdtm_rdw_length(struct zdtm_rdw_msg_content *rdw){
 
     switch(rdw->variation){
         case 1:
+            if (p_type == NULL)
+                return RET_UNK_TYPE;
             size += sizeof(rdw->vars.one.padding);
-
-            switch(rdw->sync_type){
-                //case SYNC_TYPE_CALENDAR:
-                case SYNC_TYPE_TODO:
-                    size += zdtm_todo_length(&rdw->cont.todo);
-                    break;
-                //case SYNC_TYPE_ADDRESS:
-                default:
-                    return RET_UNK_TYPE;
-                    break;
-            }
-
+            size += _zdtm_rdw_fields_length(p_type, RDW_NUM_HEADER,
+                &rdw->cont);
             break;
             
         case 2:
@@ -53,6 +440,8 @@ int zdtm_rdw_length(struct zdtm_rdw_msg_content *rdw){
             break;
 
         case 3:
+            if (p_type == NULL)
+                return RET_UNK_TYPE;
             size += 
                 sizeof(uint32_t) +
                 sizeof(rdw->vars.three.attribute) +
@@ -62,19 +451,35 @@ int zdtm_rdw_length(struct zdtm_rdw_msg_content *rdw){
                 sizeof(rdw->vars.three.card_mod_date_time) +
                 sizeof(uint32_t) +
                 sizeof(rdw->vars.three.sync_id);
+            size += _zdtm_rdw_fields_length(p_type, RDW_NUM_HEADER,
+                &rdw->cont);
+            break;
 
+        case RDW_VAR_FORMAT:
+            if (p_type == NULL)
+                return RET_UNK_TYPE;
+            // The sync id is that of each record.
+            size -= sizeof(rdw->sync_id);
+            item = (const unsigned char *)rdw->vars.four.items;
+            for (i = 0; i < rdw->num_sync_ids; i++) {
+                size += _zdtm_rdw_record_length(p_type, rdw, item);
+                if (size > ZDTM_MSG_MAX_CONT)
+                    return RET_BAD_SIZE;
+                item += p_type->item_size;
+            }
+            break;
 
-            switch(rdw->sync_type){
-                //case SYNC_TYPE_CALENDAR:
-                case SYNC_TYPE_TODO:
-                    size += zdtm_todo_length(&rdw->cont.todo);
-                    break;
-                //case SYNC_TYPE_ADDRESS:
-                default:
-                    return RET_UNK_TYPE;
-                    break;
+        case RDW_VAR_RECORD:
+            size -= sizeof(rdw->sync_id);
+            item = (const unsigned char *)rdw->vars.four.items;
+            for (i = 0; i < rdw->num_sync_ids; i++) {
+                size += _zdtm_rdw_rec_length((const zdtm_record *)item);
+                if (size > ZDTM_MSG_MAX_CONT)
+                    return RET_BAD_SIZE;
+                item += sizeof(zdtm_record);
             }
             break;
+
         default:
             return RET_UNK_VAR;
             break;
@@ -83,122 +488,65 @@ int zdtm_rdw_length(struct zdtm_rdw_msg_content *rdw){
     return size;
 }
 
-void *zdtm_rdw_write(void *buf, struct zdtm_rdw_msg_content *rdw){
-    *((unsigned char*)buf++) = rdw->sync_type;
-    
-#ifdef WORDS_BIGENDIAN
-    *((uint16_t*)buf) = zdtm_liltobigs(rdw->num_sync_ids);
-    buf += sizeof(uint16_t);
+/* The room for the item is checked as it is written, so the length of
+ * the message is not worked out beforehand. */
+int zdtm_rdw_write(zdtm_writer *p_wr, struct zdtm_rdw_msg_content *rdw){
+    const struct _zdtm_rdw_type *p_type;
 
-    *((uint32_t*)buf) = zdtm_liltobigs(rdw->sync_id);
-    buf += sizeof(uint32_t);
+    if ((rdw->variation < 1) || (rdw->variation > RDW_VAR_RECORD))
+        return RET_UNK_VAR;
 
-#else
-    *((uint16_t*)buf) = rdw->num_sync_ids;
-    buf += sizeof(uint16_t);
+    // Records are laid out by their schema whatever the sync type.
+    if (rdw->variation == RDW_VAR_RECORD)
+        return _zdtm_rdw_write_records(p_wr, NULL, rdw);
 
-    *((uint32_t*)buf) = rdw->sync_id;
-    buf += sizeof(uint32_t);
+    p_type = _zdtm_rdw_type(rdw->sync_type);
+    if ((rdw->variation != 2) && (p_type == NULL))
+        return RET_UNK_TYPE;
 
-#endif
+    if (rdw->variation == RDW_VAR_FORMAT)
+        return _zdtm_rdw_write_records(p_wr, p_type, rdw);
 
-    switch(rdw->variation){
-        case 1:
-            memcpy(buf, rdw->vars.one.padding, 
-                   sizeof(rdw->vars.one.padding));
-            buf += sizeof(rdw->vars.one.padding);
-
-            switch(rdw->sync_type){
-                //case SYNC_TYPE_CALENDAR:
-                case SYNC_TYPE_TODO:
-                    buf = zdtm_todo_write(buf, &rdw->cont.todo);
-                    break;
-                //case SYNC_TYPE_ADDRESS:
-                default:
-                    return NULL;
-                    break;
-            }
-            break;
+    if (zdtm_wr_need(p_wr, sizeof(rdw->sync_type) +
+            sizeof(rdw->num_sync_ids) + sizeof(rdw->sync_id)) != 0)
+        return RET_BAD_SIZE;
 
-        case 2:
-#ifdef WORDS_BIGENDIAN
-            *((uint32_t*)buf) = zdtm_liltobigl(sizeof(rdw->vars.two.attribute));
-#else
-            *((uint32_t*)buf) = sizeof(rdw->vars.two.attribute);
-#endif
-            buf += sizeof(uint32_t);
+    zdtm_wr_u8(p_wr, rdw->sync_type);
+    zdtm_wr_u16(p_wr, rdw->num_sync_ids);
+    zdtm_wr_u32(p_wr, rdw->sync_id);
 
-            memcpy(buf, &rdw->vars.two.attribute,
-                   sizeof(rdw->vars.two.attribute));
+    switch(rdw->variation){
+        case 1:
+            if (zdtm_wr_need(p_wr, sizeof(rdw->vars.one.padding)) != 0)
+                return RET_BAD_SIZE;
+            zdtm_wr_bytes(p_wr, rdw->vars.one.padding,
+                sizeof(rdw->vars.one.padding));
 
-            buf += sizeof(rdw->vars.two.attribute);
-            break;
+            return _zdtm_rdw_write_fields(p_wr, p_type, RDW_NUM_HEADER,
+                &rdw->cont);
 
-        case 3:
-#ifdef WORDS_BIGENDIAN
-            *((uint32_t*)buf) = zdtm_liltobigl(
-                                    sizeof(rdw->vars.three.attribute));
-#else
-            *((uint32_t*)buf) = sizeof(rdw->vars.three.attribute);
-#endif
-            buf += sizeof(uint32_t);
-
-            memcpy(buf, &rdw->vars.three.attribute,
-                   sizeof(rdw->vars.three.attribute));
-
-            buf += sizeof(rdw->vars.three.attribute);
-
-#ifdef WORDS_BIGENDIAN
-            *((uint32_t*)buf) = zdtm_liltobigl(
-                                sizeof(rdw->vars.three.card_created_date_time));
-#else
-            *((uint32_t*)buf) = sizeof(rdw->vars.three.card_created_date_time);
-#endif
-            buf += sizeof(uint32_t);
-
-            memcpy(buf, rdw->vars.three.card_created_date_time, 
-                    sizeof(rdw->vars.three.card_created_date_time));
-
-            buf += sizeof(rdw->vars.three.card_created_date_time);
-
-#ifdef WORDS_BIGENDIAN
-            *((uint32_t*)buf) = zdtm_liltobigl(
-                                    sizeof(rdw->vars.three.card_mod_date_time));
-#else
-            *((uint32_t*)buf) = sizeof(rdw->vars.three.card_mod_date_time);
-#endif
-            buf += sizeof(uint32_t);
-
-            memcpy(buf, rdw->vars.three.card_mod_date_time, 
-                    sizeof(rdw->vars.three.card_created_date_time));
-            buf += sizeof(rdw->vars.three.card_mod_date_time);
-
-#ifdef WORDS_BIGENDIAN
-            *((uint32_t*)buf) = zdtm_liltobigl(sizeof(rdw->vars.three.sync_id));
-#else
-            *((uint32_t*)buf) = sizeof(rdw->vars.three.sync_id);
-#endif
-            buf += sizeof(uint32_t);
-
-            memcpy(buf, &rdw->vars.three.sync_id, 
-                        sizeof(rdw->vars.three.sync_id));
-            buf += sizeof(rdw->vars.three.sync_id);
-
-            switch(rdw->sync_type){
-                //case SYNC_TYPE_CALENDAR:
-                case SYNC_TYPE_TODO:
-                    buf = zdtm_todo_write(buf, &rdw->cont.todo);
-                    break;
-                //case SYNC_TYPE_ADDRESS:
-                default:
-                    return NULL;
-                    break;
-            }
+        case 2:
+            if (zdtm_wr_field(p_wr, &rdw->vars.two.attribute,
+                    sizeof(rdw->vars.two.attribute)) != 0)
+                return RET_BAD_SIZE;
             break;
 
         default:
-            break;
+            if ((zdtm_wr_field(p_wr, &rdw->vars.three.attribute,
+                    sizeof(rdw->vars.three.attribute)) != 0) ||
+                (zdtm_wr_field(p_wr, rdw->vars.three.card_created_date_time,
+                    sizeof(rdw->vars.three.card_created_date_time)) != 0) ||
+                (zdtm_wr_field(p_wr, rdw->vars.three.card_mod_date_time,
+                    sizeof(rdw->vars.three.card_mod_date_time)) != 0) ||
+                (zdtm_wr_need(p_wr, 2 * sizeof(uint32_t)) != 0))
+                return RET_BAD_SIZE;
+
+            zdtm_wr_u32(p_wr, sizeof(rdw->vars.three.sync_id));
+            zdtm_wr_u32(p_wr, rdw->vars.three.sync_id);
+
+            return _zdtm_rdw_write_fields(p_wr, p_type, RDW_NUM_HEADER,
+                &rdw->cont);
     }
 
-    return buf;
+    return 0;
 }
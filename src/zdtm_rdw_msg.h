@@ -23,6 +23,8 @@
 #define _ZDTM_RDW_MSG_H_ 1
 
 #include "zdtm_common.h"
+#include "zdtm_adi_msg.h"
+#include "zdtm_record.h"
 
 /**
  * Desktop RDW message content.
@@ -32,8 +34,19 @@
  *
  *    - variation -- added to help the preparation process.
  *
+ * The RDW_VAR_FORMAT variation writes the items it is given as records
+ * laid out by the parameter format of the session, each record being
+ * the sync id of the item followed by a field for every parameter of
+ * the format. Those of the records that fit a message are written and
+ * num_written is set to how many, the rest being left for the next.
+ * The RDW_VAR_RECORD variation writes records the same way, items
+ * being an array of zdtm_record, which are laid out by their schema
+ * already and need no map.
  */
 
+#define RDW_VAR_FORMAT 4
+#define RDW_VAR_RECORD 5
+
 
 struct zdtm_rdw_msg_content {
     unsigned char sync_type;
@@ -55,10 +68,19 @@ struct zdtm_rdw_msg_content {
             char card_mod_date_time[5];
             uint32_t sync_id;
         } three;
+
+        struct {
+            const int16_t *map;     // field of each format param, -1 none
+            uint16_t num_params;    // number of format params
+            const void *items;      // array of num_sync_ids items, records
+            uint16_t num_written;   // number of records written
+        } four;
     } vars;
 
     union {
         struct zdtm_todo_item todo;
+        struct zdtm_calendar_item calendar;
+        struct zdtm_address_item address;
     } cont;
 };
 
@@ -66,6 +88,28 @@ extern const char *RDW_MSG_TYPE;
 #define IS_RDW(x) (memcmp(x->body.type, RDW_MSG_TYPE, MSG_TYPE_SIZE) == 0)
 
 inline int zdtm_rdw_length(struct zdtm_rdw_msg_content *rdw);
-inline void *zdtm_rdw_write(void *buf, struct zdtm_rdw_msg_content *rdw);
+inline int zdtm_rdw_write(zdtm_writer *p_wr,
+    struct zdtm_rdw_msg_content *rdw);
+
+/**
+ * Map a parameter format onto the fields of an item.
+ *
+ * The zdtm_rdw_map_format function looks up, for each parameter of the
+ * given format, the field of the items of the given sync type it
+ * stands for, so that the records of an RDW_VAR_FORMAT message are
+ * written without searching the format again for every item.
+ * @param sync_type The sync type of the items.
+ * @param params Pointer to the parameters of the format.
+ * @param num_params The number of parameters of the format.
+ * @param p_map Pointer to num_params entries to set to the index of
+ * the field of each parameter, or to -1 for those the items have no
+ * field for.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully mapped the format.
+ * @retval RET_UNK_TYPE Failed, unknown sync type.
+ */
+int zdtm_rdw_map_format(unsigned char sync_type,
+    const struct zdtm_adi_msg_param *params, uint16_t num_params,
+    int16_t *p_map);
 
 #endif
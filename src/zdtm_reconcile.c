@@ -0,0 +1,298 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+/**
+ * @file zdtm_reconcile.c
+ * @brief This is an implementation file for slow sync reconciliation.
+ *
+ * The zdtm_reconcile.c file is an implementation of reconciling a slow
+ * sync against the local item mirror store.
+ */
+
+#include "zdtm_reconcile.h"
+#include "zdtm_proto.h"
+#include "zdtm_idset.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Check if an item is current.
+ *
+ * The _zdtm_reconcile_is_current function checks if the version of an
+ * item held by the mirror store has the given modification date.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param p_entry Pointer to the listing entry of the item.
+ * @return An integer representing the result.
+ * @retval 0 The version held has the same modification date.
+ * @retval 1 The version held has another or no modification date.
+ * @retval -1 Failed to read the item from the mirror store.
+ */
+static int _zdtm_reconcile_is_current(zdtm_lib_env *cur_env,
+    struct zdtm_alr_entry *p_entry) {
+
+    struct zdtm_dtm_record rec;
+    const unsigned char *p_mdtm;
+    uint32_t mdtm_len;
+
+    if (zdtm_mirror_read(cur_env->mirror, p_entry->sync_id, &rec) != 0) {
+        return -1;
+    }
+
+    if (zdtm_dtm_record_field(cur_env->params, cur_env->num_params, &rec,
+        "MDTM", &p_mdtm, &mdtm_len) != 0) {
+        return 1;
+    }
+
+    if ((mdtm_len != ALR_MDTM_SIZE) ||
+        (memcmp(p_mdtm, p_entry->mdtm, ALR_MDTM_SIZE) != 0)) {
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * Refresh an item.
+ *
+ * The _zdtm_reconcile_refresh function obtains an item from the Zaurus
+ * and stores it in the mirror store.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param sync_id The sync id of the item.
+ * @param p_hash Pointer to variable to store the content hash in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully refreshed the item.
+ * @retval -1 Failed to obtain the item from the Zaurus.
+ * @retval -2 Failed to store the item in the mirror store.
+ */
+static int _zdtm_reconcile_refresh(zdtm_lib_env *cur_env, uint32_t sync_id,
+    uint64_t *p_hash) {
+
+    struct zdtm_adr_msg_param *params;
+    uint16_t num_params;
+    int r;
+
+    if (_zdtm_obtain_item(cur_env, sync_id, &params, &num_params) != 0) {
+        return -1;
+    }
+
+    (*p_hash) = zdtm_mirror_hash(params, num_params);
+    r = zdtm_mirror_put(cur_env->mirror, cur_env->sync_type, sync_id,
+        params, num_params);
+    _zdtm_free_params(cur_env, params, num_params);
+    if (r != 0) {
+        return -2;
+    }
+
+    return 0;
+}
+
+/**
+ * Reconcile the listed items.
+ *
+ * The _zdtm_reconcile_listed function walks the item listing obtained
+ * from the Zaurus, obtaining the items which are missing from the mirror
+ * store or whose modification date changed, and sorting them into the
+ * new and mod lists. The sync ids of all the listed items are stored in
+ * p_all_sync_ids, in the order of the listing.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param entries Pointer to the entries of the item listing.
+ * @param num_entries The number of entries of the item listing.
+ * @param p_new_sync_ids Pointer to the new ID list to fill in.
+ * @param p_num_new Pointer to var to store num new IDs in.
+ * @param p_mod_sync_ids Pointer to the mod ID list to fill in.
+ * @param p_num_mod Pointer to var to store num mod IDs in.
+ * @param p_all_sync_ids Pointer to the list of all IDs to fill in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully reconciled the listed items.
+ * @retval -4 Failed to read an item from the mirror store.
+ * @retval -5 Failed to obtain an item from the Zaurus.
+ * @retval -6 Failed to update the mirror store.
+ */
+static int _zdtm_reconcile_listed(zdtm_lib_env *cur_env,
+    struct zdtm_alr_entry *entries, uint16_t num_entries,
+    uint32_t *p_new_sync_ids, uint16_t *p_num_new,
+    uint32_t *p_mod_sync_ids, uint16_t *p_num_mod,
+    uint32_t *p_all_sync_ids) {
+
+    uint64_t old_hash, new_hash;
+    uint16_t num_new, num_mod, i;
+    int r;
+
+    num_new = 0;
+    num_mod = 0;
+    for (i = 0; i < num_entries; i++) {
+        p_all_sync_ids[i] = entries[i].sync_id;
+
+        if (zdtm_mirror_lookup(cur_env->mirror, entries[i].sync_id,
+            &old_hash, NULL) != 0) {
+            r = _zdtm_reconcile_refresh(cur_env, entries[i].sync_id,
+                &new_hash);
+            if (r != 0) {
+                return (r == -1) ? -5 : -6;
+            }
+            p_new_sync_ids[num_new++] = entries[i].sync_id;
+            continue;
+        }
+
+        /* Only obtain the items whose modification date changed. */
+        r = _zdtm_reconcile_is_current(cur_env, &entries[i]);
+        if (r < 0) {
+            return -4;
+        } else if (r == 0) {
+            continue;
+        }
+
+        r = _zdtm_reconcile_refresh(cur_env, entries[i].sync_id, &new_hash);
+        if (r != 0) {
+            return (r == -1) ? -5 : -6;
+        }
+        if (new_hash != old_hash) {
+            p_mod_sync_ids[num_mod++] = entries[i].sync_id;
+        }
+    }
+
+    (*p_num_new) = num_new;
+    (*p_num_mod) = num_mod;
+
+    return 0;
+}
+
+/**
+ * Reconcile the deleted items.
+ *
+ * The _zdtm_reconcile_deleted function removes the items the mirror
+ * store holds which are no longer listed on the Zaurus from it, and
+ * puts them in the del list. At most 0xffff items are put in the del
+ * list, any further items are left in the mirror store for a later
+ * reconciliation to find.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param p_listed Pointer to the set of all listed IDs.
+ * @param p_del_sync_ids Pointer to the del ID list to fill in.
+ * @param max_del The number of entries of the del ID list.
+ * @param p_num_del Pointer to var to store num del IDs in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully reconciled the deleted items.
+ * @retval 1 Successfully reconciled, more deleted items remain.
+ * @retval -6 Failed to update the mirror store.
+ */
+static int _zdtm_reconcile_deleted(zdtm_lib_env *cur_env,
+    const zdtm_id_set *p_listed, uint32_t *p_del_sync_ids,
+    uint32_t max_del, uint16_t *p_num_del) {
+
+    uint32_t cursor, sync_id, num_del, i;
+    uint64_t hash;
+    int more;
+
+    /* The walk is finished before removing any of the items, as the
+     * cursor is no longer valid once the mirror store is modified. */
+    num_del = 0;
+    more = 0;
+    cursor = 0;
+    while (zdtm_mirror_next(cur_env->mirror, &cursor, &sync_id, &hash) == 0) {
+        if (zdtm_id_set_contains(p_listed, sync_id)) {
+            continue;
+        }
+        if ((num_del == max_del) || (num_del == 0xffff)) {
+            more = 1;
+            break;
+        }
+        p_del_sync_ids[num_del++] = sync_id;
+    }
+
+    for (i = 0; i < num_del; i++) {
+        if (zdtm_mirror_delete(cur_env->mirror, cur_env->sync_type,
+            p_del_sync_ids[i]) < 0) {
+            return -6;
+        }
+    }
+
+    (*p_num_del) = num_del;
+
+    return more;
+}
+
+int zdtm_reconcile_sync_id_lists(zdtm_lib_env *cur_env,
+    uint32_t **pp_new_sync_ids, uint16_t *p_num_new_sync_ids,
+    uint32_t **pp_mod_sync_ids, uint16_t *p_num_mod_sync_ids,
+    uint32_t **pp_del_sync_ids, uint16_t *p_num_del_sync_ids) {
+
+    struct zdtm_alr_entry *entries;
+    uint16_t num_entries, num_new, num_mod, num_del;
+    uint32_t *p_new_sync_ids, *p_mod_sync_ids, *p_del_sync_ids;
+    uint32_t *p_all_sync_ids;
+    uint32_t max_del;
+    zdtm_id_set listed;
+    int r;
+
+    if (cur_env->mirror == NULL) {
+        return -1;
+    }
+
+    r = _zdtm_obtain_item_listing(cur_env, &entries, &num_entries);
+    if (r != 0) {
+        return _zdtm_timeout_result(cur_env, -2);
+    }
+
+    max_del = zdtm_mirror_count(cur_env->mirror);
+    p_new_sync_ids = malloc(sizeof(uint32_t) * (num_entries + 1));
+    p_mod_sync_ids = malloc(sizeof(uint32_t) * (num_entries + 1));
+    p_all_sync_ids = malloc(sizeof(uint32_t) * (num_entries + 1));
+    p_del_sync_ids = malloc(sizeof(uint32_t) * (max_del + 1));
+    if ((p_new_sync_ids == NULL) || (p_mod_sync_ids == NULL) ||
+        (p_all_sync_ids == NULL) || (p_del_sync_ids == NULL)) {
+        r = -3;
+    } else {
+        r = _zdtm_reconcile_listed(cur_env, entries, num_entries,
+            p_new_sync_ids, &num_new, p_mod_sync_ids, &num_mod,
+            p_all_sync_ids);
+        if (r == 0) {
+            zdtm_id_set_init(&listed);
+            if (zdtm_id_set_from_ids(&listed, p_all_sync_ids,
+                num_entries) != 0) {
+                r = -3;
+            } else {
+                r = _zdtm_reconcile_deleted(cur_env, &listed,
+                    p_del_sync_ids, max_del, &num_del);
+            }
+            zdtm_id_set_free(&listed);
+        }
+    }
+
+    free(p_all_sync_ids);
+    free(entries);
+
+    if (r < 0) {
+        free(p_new_sync_ids);
+        free(p_mod_sync_ids);
+        free(p_del_sync_ids);
+        return r;
+    }
+
+    (*pp_new_sync_ids) = p_new_sync_ids;
+    (*pp_mod_sync_ids) = p_mod_sync_ids;
+    (*pp_del_sync_ids) = p_del_sync_ids;
+    (*p_num_new_sync_ids) = num_new;
+    (*p_num_mod_sync_ids) = num_mod;
+    (*p_num_del_sync_ids) = num_del;
+
+    return r;
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+/**
+ * @file zdtm_reconcile.h
+ * @brief This is a specifications file for slow sync reconciliation.
+ *
+ * The zdtm_reconcile.h file is a specifications file for reconciling a
+ * slow sync against the local item mirror store. Rather than obtaining
+ * every item from the Zaurus when zdtm_requires_slow_sync() states a
+ * slow sync is required, the full listing of the items on the Zaurus is
+ * compared with the mirror store and only the items which are missing
+ * from it or whose modification date changed are obtained.
+ */
+
+#ifndef ZDTM_RECONCILE_H
+#define ZDTM_RECONCILE_H
+
+#include "zdtm_export.h"
+#include "zdtm_types.h"
+#include "zdtm_mirror.h"
+
+/**
+ * Reconcile Sync ID Lists
+ *
+ * The zdtm_reconcile_sync_id_lists function builds the three lists of
+ * synchronization IDs of a slow sync from the mirror store attached to
+ * the current library environment with zdtm_set_mirror(), in place of
+ * zdtm_obtain_sync_id_lists(). It obtains the listing of every item on
+ * the Zaurus with an RLR message and then obtains only the items that
+ * the mirror store does not hold or whose MDTM differs from the version
+ * it holds, storing them in the mirror store. Items whose obtained
+ * content turns out identical to the version held are left off the
+ * lists. Items the mirror store holds that are no longer on the Zaurus
+ * are removed from it and make up the deleted list. The deleted list
+ * holds at most 0xffff items, if more are no longer on the Zaurus the
+ * function returns 1 and reconciling again, once the lists have been
+ * processed, finds the remaining ones. The items of the new and mod
+ * lists can then be read from the mirror store with zdtm_mirror_read()
+ * without obtaining them again. In the case of failure none of the
+ * variables pointed to by the parameters will be altered. If this
+ * function succeeds the memory containing the lists needs to be freed
+ * using the free() function.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param pp_new_sync_ids Pointer to a pointer to head of new ID list.
+ * @param p_num_new_sync_ids Pointer to var to store num new IDs in.
+ * @param pp_mod_sync_ids Pointer to a pointer to head of mod ID list.
+ * @param p_num_mod_sync_ids Pointer to var to store num mod IDs in.
+ * @param pp_del_sync_ids Pointer to a pointer to head of del ID list.
+ * @param p_num_del_sync_ids Pointer to var to store num del IDs in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully reconciled the sync ID lists.
+ * @retval 1 Successfully reconciled, more deleted items remain.
+ * @retval -1 Failed, no mirror store is attached.
+ * @retval -2 Failed to obtain the item listing from the Zaurus.
+ * @retval -3 Failed to allocate memory for ID lists.
+ * @retval -4 Failed to read an item from the mirror store.
+ * @retval -5 Failed to obtain an item from the Zaurus.
+ * @retval -6 Failed to update the mirror store.
+ */
+ZDTM_EXPORT int zdtm_reconcile_sync_id_lists(zdtm_lib_env *cur_env,
+    uint32_t **pp_new_sync_ids, uint16_t *p_num_new_sync_ids,
+    uint32_t **pp_mod_sync_ids, uint16_t *p_num_mod_sync_ids,
+    uint32_t **pp_del_sync_ids, uint16_t *p_num_del_sync_ids);
+
+#endif
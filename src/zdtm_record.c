@@ -0,0 +1,395 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+
+
+/**
+ * @file zdtm_record.c
+ * @brief This is an implementation file for generic item records.
+ *
+ * The zdtm_record.c file is an implementation of records holding the
+ * data of an item as laid out by a parameter format. The abbreviations
+ * of the format are looked up in an open addressed hash table, whose
+ * four character keys are hashed as a single word.
+ */
+
+#include "zdtm_record.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Hash of an abbreviation down to the given shift. */
+static unsigned int _zdtm_abrev_hash(const void *abrev, unsigned int shift) {
+    uint32_t key;
+
+    memcpy(&key, abrev, sizeof(key));
+
+    return (uint32_t)(key * 0x9e3779b1u) >> shift;
+}
+
+int zdtm_schema_init(zdtm_schema *p_schema,
+    const struct zdtm_adi_msg_param *params, uint16_t num_params) {
+
+    unsigned int bits, mask, slot;
+    uint16_t i;
+
+    /* Keep the table at most half full so that probes stay short. */
+    bits = 3;
+    while ((1u << bits) < 2u * num_params) {
+        bits++;
+    }
+    mask = (1u << bits) - 1;
+
+    p_schema->params = params;
+    p_schema->num_params = num_params;
+    p_schema->shift = 32 - bits;
+    p_schema->slots = calloc(mask + 1, sizeof(uint16_t));
+    if (p_schema->slots == NULL) {
+        return -1;
+    }
+
+    for (i = 0; i < num_params; i++) {
+        if (zdtm_schema_index(p_schema, (const char *)params[i].abrev) >= 0) {
+            continue;
+        }
+        slot = _zdtm_abrev_hash(params[i].abrev, p_schema->shift);
+        while (p_schema->slots[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        p_schema->slots[slot] = i + 1;
+    }
+
+    return 0;
+}
+
+void zdtm_schema_free(zdtm_schema *p_schema) {
+    free(p_schema->slots);
+    p_schema->slots = NULL;
+    p_schema->params = NULL;
+    p_schema->num_params = 0;
+}
+
+int zdtm_schema_index(const zdtm_schema *p_schema, const char *abrev) {
+    unsigned int mask, slot;
+    uint16_t i;
+
+    /* Never hash or compare past the end of a shorter string. */
+    if ((p_schema->slots == NULL) || (memchr(abrev, '\0', 4) != NULL)) {
+        return -1;
+    }
+
+    mask = (1u << (32 - p_schema->shift)) - 1;
+    slot = _zdtm_abrev_hash(abrev, p_schema->shift);
+    while ((i = p_schema->slots[slot]) != 0) {
+        if (memcmp(p_schema->params[i - 1].abrev, abrev, 4) == 0) {
+            return i - 1;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    return -1;
+}
+
+void zdtm_record_init(zdtm_record *p_rec) {
+    p_rec->schema = NULL;
+    p_rec->sync_id = 0;
+    p_rec->offsets = NULL;
+    p_rec->data = NULL;
+}
+
+void zdtm_record_free(zdtm_record *p_rec) {
+    free(p_rec->offsets);
+    zdtm_record_init(p_rec);
+}
+
+/* Allocate the offsets and the data of a record in a single block. */
+static int _zdtm_record_alloc(zdtm_record *p_rec,
+    const zdtm_schema *p_schema, uint32_t data_size) {
+
+    zdtm_record_free(p_rec);
+
+    p_rec->offsets = malloc((p_schema->num_params + 1) * sizeof(uint32_t) +
+        data_size);
+    if (p_rec->offsets == NULL) {
+        return -2;
+    }
+    p_rec->data = (unsigned char *)(p_rec->offsets + p_schema->num_params + 1);
+    p_rec->schema = p_schema;
+
+    return 0;
+}
+
+/* Take the sync id of a record from its SYID field. */
+static void _zdtm_record_sync_id(zdtm_record *p_rec) {
+    int i;
+
+    i = zdtm_schema_index(p_rec->schema, "SYID");
+    if ((i >= 0) && (zdtm_record_len(p_rec, i) >= sizeof(uint32_t))) {
+        p_rec->sync_id = zdtm_get_le32(zdtm_record_field(p_rec, i));
+    }
+}
+
+/* Check that raw ADR content holds an item of the format of a schema
+ * with every field within the content, and total the field lengths. */
+static int _zdtm_record_check(const zdtm_schema *p_schema, const void *buf,
+    uint16_t size, uint32_t *p_data_size) {
+
+    zdtm_reader rd;
+    uint32_t len, data_size;
+    uint16_t num_params, i;
+
+    zdtm_rd_init(&rd, buf, size);
+    if (zdtm_rd_need(&rd, 2 + sizeof(uint16_t)) != 0) {
+        return RET_BAD_SIZE;
+    }
+    zdtm_rd_skip(&rd, 2);
+    num_params = zdtm_rd_u16(&rd);
+    if (num_params != p_schema->num_params) {
+        return -1;
+    }
+
+    data_size = 0;
+    for (i = 0; i < num_params; i++) {
+        if (zdtm_rd_need(&rd, sizeof(uint32_t)) != 0) {
+            return RET_BAD_SIZE;
+        }
+        len = zdtm_rd_u32(&rd);
+        if (zdtm_rd_need(&rd, len) != 0) {
+            return RET_BAD_SIZE;
+        }
+        zdtm_rd_skip(&rd, len);
+        data_size += len;
+    }
+
+    (*p_data_size) = data_size;
+
+    return 0;
+}
+
+int zdtm_record_decode(const zdtm_schema *p_schema, const void *buf,
+    uint16_t size, zdtm_record *p_rec) {
+
+    zdtm_reader rd;
+    uint32_t len, data_size;
+    uint16_t num_params, i;
+    int r;
+
+    /* Check and size the fields before copying any. */
+    r = _zdtm_record_check(p_schema, buf, size, &data_size);
+    if (r != 0) {
+        return r;
+    }
+
+    if (_zdtm_record_alloc(p_rec, p_schema, data_size) != 0) {
+        return -2;
+    }
+
+    num_params = p_schema->num_params;
+    zdtm_rd_init(&rd, buf, size);
+    zdtm_rd_skip(&rd, 2 + sizeof(uint16_t));
+    data_size = 0;
+    for (i = 0; i < num_params; i++) {
+        len = zdtm_rd_u32(&rd);
+        p_rec->offsets[i] = data_size;
+        zdtm_rd_bytes(&rd, p_rec->data + data_size, len);
+        data_size += len;
+    }
+    p_rec->offsets[num_params] = data_size;
+    _zdtm_record_sync_id(p_rec);
+
+    return 0;
+}
+
+int zdtm_record_from_params(const zdtm_schema *p_schema,
+    const struct zdtm_adr_msg_param *params, uint16_t num_params,
+    zdtm_record *p_rec) {
+
+    uint32_t data_size;
+    uint16_t i;
+
+    if (num_params != p_schema->num_params) {
+        return -1;
+    }
+
+    data_size = 0;
+    for (i = 0; i < num_params; i++) {
+        data_size += params[i].param_len;
+    }
+
+    if (_zdtm_record_alloc(p_rec, p_schema, data_size) != 0) {
+        return -2;
+    }
+
+    data_size = 0;
+    for (i = 0; i < num_params; i++) {
+        p_rec->offsets[i] = data_size;
+        if (params[i].param_len != 0) {
+            memcpy(p_rec->data + data_size, params[i].param_data,
+                params[i].param_len);
+        }
+        data_size += params[i].param_len;
+    }
+    p_rec->offsets[num_params] = data_size;
+    _zdtm_record_sync_id(p_rec);
+
+    return 0;
+}
+
+int zdtm_record_set(zdtm_record *p_rec, int index, const void *data,
+    uint32_t len) {
+
+    uint32_t *p_block, old_len, size;
+    uint16_t num_params;
+    int i;
+
+    if ((p_rec->schema == NULL) || (index < 0) ||
+        (index >= p_rec->schema->num_params)) {
+        return -1;
+    }
+
+    num_params = p_rec->schema->num_params;
+    old_len = zdtm_record_len(p_rec, index);
+    size = p_rec->offsets[num_params];
+    if (len > old_len) {
+        p_block = realloc(p_rec->offsets,
+            (num_params + 1) * sizeof(uint32_t) + size - old_len + len);
+        if (p_block == NULL) {
+            return -2;
+        }
+        p_rec->offsets = p_block;
+        p_rec->data = (unsigned char *)(p_block + num_params + 1);
+    }
+
+    /* Move the fields following it, then shift their offsets. */
+    memmove(p_rec->data + p_rec->offsets[index] + len,
+        p_rec->data + p_rec->offsets[index + 1],
+        size - p_rec->offsets[index + 1]);
+    if (len != 0) {
+        memcpy(p_rec->data + p_rec->offsets[index], data, len);
+    }
+    for (i = index + 1; i <= num_params; i++) {
+        p_rec->offsets[i] = p_rec->offsets[i] - old_len + len;
+    }
+
+    if (memcmp(p_rec->schema->params[index].abrev, "SYID", 4) == 0) {
+        _zdtm_record_sync_id(p_rec);
+    }
+
+    return 0;
+}
+
+const unsigned char *zdtm_record_get(const zdtm_record *p_rec,
+    const char *abrev, uint32_t *p_len) {
+
+    int i;
+
+    if (p_rec->schema == NULL) {
+        return NULL;
+    }
+
+    i = zdtm_schema_index(p_rec->schema, abrev);
+    if (i < 0) {
+        return NULL;
+    }
+
+    (*p_len) = zdtm_record_len(p_rec, i);
+
+    return zdtm_record_field(p_rec, i);
+}
+
+void zdtm_lazy_item_init(zdtm_lazy_item *p_item) {
+    p_item->schema = NULL;
+    p_item->sync_id = 0;
+    p_item->buf = NULL;
+    p_item->size = 0;
+}
+
+void zdtm_lazy_item_free(zdtm_lazy_item *p_item) {
+    free(p_item->buf);
+    zdtm_lazy_item_init(p_item);
+}
+
+int zdtm_lazy_item_attach(zdtm_lazy_item *p_item,
+    const zdtm_schema *p_schema, void *buf, uint16_t size) {
+
+    const unsigned char *p;
+    uint32_t data_size, len;
+    int r;
+
+    /* Checked once here, the content is walked unchecked afterwards. */
+    r = _zdtm_record_check(p_schema, buf, size, &data_size);
+    if (r != 0) {
+        return r;
+    }
+
+    zdtm_lazy_item_free(p_item);
+    p_item->schema = p_schema;
+    p_item->buf = buf;
+    p_item->size = size;
+
+    p = zdtm_lazy_item_get(p_item, "SYID", &len);
+    if ((p != NULL) && (len >= sizeof(uint32_t))) {
+        p_item->sync_id = zdtm_get_le32(p);
+    }
+
+    return 0;
+}
+
+const unsigned char *zdtm_lazy_item_field(const zdtm_lazy_item *p_item,
+    int index, uint32_t *p_len) {
+
+    const unsigned char *p;
+    int i;
+
+    if ((p_item->schema == NULL) || (index < 0) ||
+        (index >= p_item->schema->num_params)) {
+        return NULL;
+    }
+
+    /* Step over the fields ahead of it by their lengths alone. */
+    p = p_item->buf + 2 + sizeof(uint16_t);
+    for (i = 0; i < index; i++) {
+        p += sizeof(uint32_t) + zdtm_get_le32(p);
+    }
+    (*p_len) = zdtm_get_le32(p);
+
+    return p + sizeof(uint32_t);
+}
+
+const unsigned char *zdtm_lazy_item_get(const zdtm_lazy_item *p_item,
+    const char *abrev, uint32_t *p_len) {
+
+    if (p_item->schema == NULL) {
+        return NULL;
+    }
+
+    return zdtm_lazy_item_field(p_item,
+        zdtm_schema_index(p_item->schema, abrev), p_len);
+}
+
+int zdtm_lazy_item_record(const zdtm_lazy_item *p_item, zdtm_record *p_rec) {
+    if (p_item->schema == NULL) {
+        return -1;
+    }
+
+    return zdtm_record_decode(p_item->schema, p_item->buf, p_item->size,
+        p_rec);
+}
@@ -0,0 +1,328 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+
+
+/**
+ * @file zdtm_record.h
+ * @brief This is a specifications file for generic item records.
+ *
+ * The zdtm_record.h file is a specifications file for records holding
+ * the data of an item as laid out by the parameter format the Zaurus
+ * hands out for the current synchronization type. Unlike the Todo,
+ * Calendar, and Address item structures a record keeps every
+ * parameter of the format, including those the library has no member
+ * for, so an item obtained as a record is written back unchanged.
+ * Lazy items keep the raw content an item was obtained in instead,
+ * finding each field in it only when the field is asked for.
+ */
+
+#ifndef ZDTM_RECORD_H
+#define ZDTM_RECORD_H
+
+#include "zdtm_export.h"
+#include "zdtm_types.h"
+#include "zdtm_adr_msg.h"
+
+/**
+ * Record schema.
+ *
+ * The zdtm_schema is a structure which represents a parameter format,
+ * along with a hash table of the abbreviations of its parameters for
+ * looking up the position of a parameter by its abbreviation. The
+ * params are borrowed, and must outlive the schema. A schema is built
+ * with zdtm_schema_init() and its memory is released with
+ * zdtm_schema_free().
+ */
+typedef struct zdtm_schema {
+    const struct zdtm_adi_msg_param *params; // params of the format
+    uint16_t num_params;    // number of params of the format
+    uint16_t *slots;        // index + 1 of the param in each slot, 0 none
+    unsigned int shift;     // shift of the hash down to a slot
+} zdtm_schema;
+
+/**
+ * Item record.
+ *
+ * The zdtm_record is a structure which represents the data of an item,
+ * a field for each parameter of its schema. The fields are held back to
+ * back in data, the field of the parameter at position i starting at
+ * offsets[i] and ending at offsets[i + 1]. The offsets and the data
+ * are a single allocation. A record is initialized with
+ * zdtm_record_init() and its memory is released with
+ * zdtm_record_free().
+ */
+typedef struct zdtm_record {
+    const zdtm_schema *schema;  // schema the fields are laid out by
+    uint32_t sync_id;           // sync id of the item, zero for a new one
+    uint32_t *offsets;          // num_params + 1 offsets of the fields
+    unsigned char *data;        // data of the fields, back to back
+} zdtm_record;
+
+/**
+ * Build record schema.
+ *
+ * The zdtm_schema_init function builds the schema of the given
+ * parameter format, hashing the abbreviation of each parameter. When
+ * an abbreviation appears more than once its first parameter is the
+ * one looked up.
+ * @param p_schema Pointer to the schema to build.
+ * @param params Pointer to the params of the format.
+ * @param num_params The number of params of the format.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully built the schema.
+ * @retval -1 Failed to allocate memory for the hash table.
+ */
+ZDTM_EXPORT int zdtm_schema_init(zdtm_schema *p_schema,
+    const struct zdtm_adi_msg_param *params, uint16_t num_params);
+
+/**
+ * Free record schema.
+ *
+ * The zdtm_schema_free function releases the memory of a schema.
+ * @param p_schema Pointer to the schema to free.
+ */
+ZDTM_EXPORT void zdtm_schema_free(zdtm_schema *p_schema);
+
+/**
+ * Look up parameter position.
+ *
+ * The zdtm_schema_index function looks up the position of the
+ * parameter of the given abbreviation in the format of a schema.
+ * An abbreviation shorter than four characters matches no parameter,
+ * no more of it than its terminating null character being read.
+ * @param p_schema Pointer to the schema to look in.
+ * @param abrev Pointer to the four characters of the abbreviation,
+ * which need not be null terminated, or to a shorter string.
+ * @return The position of the parameter, or -1 if the format has no
+ * parameter of that abbreviation.
+ */
+ZDTM_EXPORT int zdtm_schema_index(const zdtm_schema *p_schema,
+    const char *abrev);
+
+/**
+ * Initialize record.
+ *
+ * The zdtm_record_init function initializes a record to have no
+ * schema nor fields, without allocating any memory.
+ * @param p_rec Pointer to the record to initialize.
+ */
+ZDTM_EXPORT void zdtm_record_init(zdtm_record *p_rec);
+
+/**
+ * Free record.
+ *
+ * The zdtm_record_free function releases the memory of a record,
+ * leaving it as zdtm_record_init() does.
+ * @param p_rec Pointer to the record to free.
+ */
+ZDTM_EXPORT void zdtm_record_free(zdtm_record *p_rec);
+
+/**
+ * Decode record from raw ADR content.
+ *
+ * The zdtm_record_decode function stores the item carried by the raw
+ * content of an ADR message in p_rec, whose memory is released first.
+ * The content is checked and sized in a first pass so that the fields
+ * are copied straight into the single allocation of the record. The
+ * sync id of the record is taken from its SYID field when it has one.
+ * @param p_schema Pointer to the schema of the current format.
+ * @param buf Pointer to the raw content of the ADR message.
+ * @param size The size of the raw content in bytes.
+ * @param p_rec Pointer to the record to store the item in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully decoded the record.
+ * @retval -1 Failed, the item has another number of params than the
+ * format.
+ * @retval -2 Failed to allocate memory for the record.
+ * @retval RET_BAD_SIZE Failed, the raw content is cut short.
+ */
+ZDTM_EXPORT int zdtm_record_decode(const zdtm_schema *p_schema,
+    const void *buf, uint16_t size, zdtm_record *p_rec);
+
+/**
+ * Build record from item params.
+ *
+ * The zdtm_record_from_params function stores the item of the given
+ * params, such as those of an ADR message, in p_rec, whose memory is
+ * released first. The sync id of the record is taken from its SYID
+ * field when it has one.
+ * @param p_schema Pointer to the schema of the current format.
+ * @param params Pointer to the params of the item.
+ * @param num_params The number of params of the item.
+ * @param p_rec Pointer to the record to store the item in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully built the record.
+ * @retval -1 Failed, the item has another number of params than the
+ * format.
+ * @retval -2 Failed to allocate memory for the record.
+ */
+ZDTM_EXPORT int zdtm_record_from_params(const zdtm_schema *p_schema,
+    const struct zdtm_adr_msg_param *params, uint16_t num_params,
+    zdtm_record *p_rec);
+
+/**
+ * Set record field.
+ *
+ * The zdtm_record_set function replaces the data of the field at the
+ * given position of a record, moving the fields following it. Setting
+ * the SYID field also sets the sync id of the record.
+ * @param p_rec Pointer to the record to set the field of.
+ * @param index The position of the field.
+ * @param data Pointer to the new data of the field.
+ * @param len The length of the new data in bytes.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully set the field.
+ * @retval -1 Failed, the record has no field at that position.
+ * @retval -2 Failed to allocate memory for the record.
+ */
+ZDTM_EXPORT int zdtm_record_set(zdtm_record *p_rec, int index,
+    const void *data, uint32_t len);
+
+/**
+ * Get record field by abbreviation.
+ *
+ * The zdtm_record_get function looks up the field of the parameter of
+ * the given abbreviation in a record.
+ * @param p_rec Pointer to the record to look in.
+ * @param abrev Pointer to the four characters of the abbreviation.
+ * @param p_len Pointer to store the length of the field in.
+ * @return Pointer to the data of the field, or NULL if the format has
+ * no parameter of that abbreviation.
+ */
+ZDTM_EXPORT const unsigned char *zdtm_record_get(const zdtm_record *p_rec,
+    const char *abrev, uint32_t *p_len);
+
+/* Data of the field at position index, which must be in range. */
+static inline const unsigned char *zdtm_record_field(
+    const zdtm_record *p_rec, int index) {
+    return p_rec->data + p_rec->offsets[index];
+}
+
+/* Length of the field at position index, which must be in range. */
+static inline uint32_t zdtm_record_len(const zdtm_record *p_rec,
+    int index) {
+    return p_rec->offsets[index + 1] - p_rec->offsets[index];
+}
+
+/**
+ * Lazy item.
+ *
+ * The zdtm_lazy_item is a structure which represents an item by the raw
+ * content of the ADR message it was obtained in. Nothing is decoded up
+ * front, a field is found in the content only when it is asked for, and
+ * asking for one allocates no memory, hence checking a few fields of an
+ * item such as its MDTM is cheap whatever the number of its fields. The
+ * raw content is owned by the item. A lazy item is initialized with
+ * zdtm_lazy_item_init() and its memory is released with
+ * zdtm_lazy_item_free().
+ */
+typedef struct zdtm_lazy_item {
+    const zdtm_schema *schema;  // schema the content is laid out by
+    uint32_t sync_id;           // sync id of the item, from its SYID
+    unsigned char *buf;         // raw content of the ADR message
+    uint16_t size;              // size of the raw content in bytes
+} zdtm_lazy_item;
+
+/**
+ * Initialize lazy item.
+ *
+ * The zdtm_lazy_item_init function initializes a lazy item to have no
+ * schema nor content, without allocating any memory.
+ * @param p_item Pointer to the lazy item to initialize.
+ */
+ZDTM_EXPORT void zdtm_lazy_item_init(zdtm_lazy_item *p_item);
+
+/**
+ * Free lazy item.
+ *
+ * The zdtm_lazy_item_free function releases the raw content of a lazy
+ * item, leaving it as zdtm_lazy_item_init() does.
+ * @param p_item Pointer to the lazy item to free.
+ */
+ZDTM_EXPORT void zdtm_lazy_item_free(zdtm_lazy_item *p_item);
+
+/**
+ * Attach raw content to lazy item.
+ *
+ * The zdtm_lazy_item_attach function checks that the given raw content
+ * of an ADR message holds an item of the format of the schema, every
+ * field within the content, and if so hands the content over to the
+ * lazy item, whose previous content is released. The content must have
+ * been allocated with malloc(). On failure the content is left to the
+ * caller and the lazy item is unchanged.
+ * @param p_item Pointer to the lazy item to attach the content to.
+ * @param p_schema Pointer to the schema of the current format.
+ * @param buf Pointer to the raw content of the ADR message.
+ * @param size The size of the raw content in bytes.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully attached the content.
+ * @retval -1 Failed, the item has another number of params than the
+ * format.
+ * @retval RET_BAD_SIZE Failed, the raw content is cut short.
+ */
+ZDTM_EXPORT int zdtm_lazy_item_attach(zdtm_lazy_item *p_item,
+    const zdtm_schema *p_schema, void *buf, uint16_t size);
+
+/**
+ * Get lazy item field by position.
+ *
+ * The zdtm_lazy_item_field function finds the field at the given
+ * position in the raw content of a lazy item, stepping over the fields
+ * ahead of it by their lengths.
+ * @param p_item Pointer to the lazy item to look in.
+ * @param index The position of the field.
+ * @param p_len Pointer to store the length of the field in.
+ * @return Pointer to the data of the field within the raw content, or
+ * NULL if the item has no field at that position.
+ */
+ZDTM_EXPORT const unsigned char *zdtm_lazy_item_field(
+    const zdtm_lazy_item *p_item, int index, uint32_t *p_len);
+
+/**
+ * Get lazy item field by abbreviation.
+ *
+ * The zdtm_lazy_item_get function finds the field of the parameter of
+ * the given abbreviation in the raw content of a lazy item.
+ * @param p_item Pointer to the lazy item to look in.
+ * @param abrev Pointer to the four characters of the abbreviation.
+ * @param p_len Pointer to store the length of the field in.
+ * @return Pointer to the data of the field within the raw content, or
+ * NULL if the format has no parameter of that abbreviation.
+ */
+ZDTM_EXPORT const unsigned char *zdtm_lazy_item_get(
+    const zdtm_lazy_item *p_item, const char *abrev, uint32_t *p_len);
+
+/**
+ * Decode lazy item into record.
+ *
+ * The zdtm_lazy_item_record function decodes every field of a lazy item
+ * at once into p_rec, as zdtm_record_decode() does, for when most of
+ * the fields are needed after all.
+ * @param p_item Pointer to the lazy item to decode.
+ * @param p_rec Pointer to the record to store the item in.
+ * @return The same values as zdtm_record_decode(), or -1 if the lazy
+ * item has no content.
+ */
+ZDTM_EXPORT int zdtm_lazy_item_record(const zdtm_lazy_item *p_item,
+    zdtm_record *p_rec);
+
+#endif /* ZDTM_RECORD_H */
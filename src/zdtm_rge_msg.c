@@ -27,13 +27,13 @@ int zdtm_rge_length(struct zdtm_rge_msg_content *rge){
     return sizeof(rge->path_len) + rge->path_len;
 }
 
-void *zdtm_rge_write(void *buf, struct zdtm_rge_msg_content *rge){ 
-    *((uint16_t*)buf) = rge->path_len;
-    buf += sizeof(rge->path_len);
+int zdtm_rge_write(zdtm_writer *p_wr, struct zdtm_rge_msg_content *rge){
+    if (zdtm_wr_need(p_wr, zdtm_rge_length(rge)) != 0)
+        return RET_BAD_SIZE;
 
-    memcpy(buf, rge->path, rge->path_len);
-    buf += rge->path_len;
+    zdtm_wr_u16(p_wr, rge->path_len);
+    zdtm_wr_bytes(p_wr, rge->path, rge->path_len);
 
-    return buf;
+    return 0;
 }
 
@@ -41,6 +41,7 @@ extern const char *RGE_MSG_TYPE;
 #define IS_RGE(x) (memcmp(x->body.type, RGE_MSG_TYPE, MSG_TYPE_SIZE) == 0)
 
 inline int zdtm_rge_length(struct zdtm_rge_msg_content *rge);
-inline void *zdtm_rge_write(void *buf, struct zdtm_rge_msg_content *rge);
+inline int zdtm_rge_write(zdtm_writer *p_wr,
+    struct zdtm_rge_msg_content *rge);
 
 #endif
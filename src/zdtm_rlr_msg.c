@@ -27,9 +27,12 @@ int zdtm_rlr_length(struct zdtm_rlr_msg_content *rlr){
     return sizeof(rlr->sync_type);
 }
 
-void *zdtm_rlr_write(void *buf, struct zdtm_rlr_msg_content *rlr){
-    *((unsigned char*)buf++) = rlr->sync_type;
+int zdtm_rlr_write(zdtm_writer *p_wr, struct zdtm_rlr_msg_content *rlr){
+    if (zdtm_wr_need(p_wr, zdtm_rlr_length(rlr)) != 0)
+        return RET_BAD_SIZE;
 
-    return buf;
+    zdtm_wr_u8(p_wr, rlr->sync_type);
+
+    return 0;
 }
 
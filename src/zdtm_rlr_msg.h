@@ -41,7 +41,8 @@ extern const char *RLR_MSG_TYPE;
 #define IS_RLR(x) (memcmp(x->body.type, RLR_MSG_TYPE, MSG_TYPE_SIZE) == 0)
 
 inline int zdtm_rlr_length(struct zdtm_rlr_msg_content *rlr);
-inline void *zdtm_rlr_write(void *buf, struct zdtm_rlr_msg_content *rlr);
+inline int zdtm_rlr_write(zdtm_writer *p_wr,
+    struct zdtm_rlr_msg_content *rlr);
 
 
 #endif 
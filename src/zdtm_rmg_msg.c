@@ -28,9 +28,13 @@ int zdtm_rmg_length(struct zdtm_rmg_msg_content *rmg){
     return sizeof(struct zdtm_rmg_msg_content);
 }
 
-void *zdtm_rmg_write(void *buf, struct zdtm_rmg_msg_content *rmg){
-    *((unsigned char*)buf++) = rmg->uk;
-    *((unsigned char*)buf++) = rmg->sync_type;
-    return buf;
+int zdtm_rmg_write(zdtm_writer *p_wr, struct zdtm_rmg_msg_content *rmg){
+    if (zdtm_wr_need(p_wr, zdtm_rmg_length(rmg)) != 0)
+        return RET_BAD_SIZE;
+
+    zdtm_wr_u8(p_wr, rmg->uk);
+    zdtm_wr_u8(p_wr, rmg->sync_type);
+
+    return 0;
 }
 
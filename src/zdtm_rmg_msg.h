@@ -46,7 +46,8 @@ extern const char *RMG_MSG_TYPE;
 #define IS_RMG(x) (memcmp(x->body.type, RMG_MSG_TYPE, MSG_TYPE_SIZE) == 0)
 
 inline int zdtm_rmg_length(struct zdtm_rmg_msg_content *rmg);
-inline void *zdtm_rmg_write(void *buf, struct zdtm_rmg_msg_content *rmg);
+inline int zdtm_rmg_write(zdtm_writer *p_wr,
+    struct zdtm_rmg_msg_content *rmg);
 
 
 #endif 
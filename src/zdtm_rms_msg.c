@@ -28,28 +28,17 @@ int zdtm_rms_length(struct zdtm_rms_msg_content *rms){
     return sizeof(struct zdtm_rms_msg_content);
 }
 
-void *zdtm_rms_write(void *buf, struct zdtm_rms_msg_content *rms){
-        if(rms->log_size > sizeof(rms->log))
-            return NULL;
-        
-#ifdef WORDS_BIGENDIAN            
-        *((uint16_t*)buf) = zdtm_liltobigs(rms->log_size);
-        buf += sizeof(uint16_t);
-        
-#else
-        *((uint16_t*)buf) = rms->log_size;
-        buf += sizeof(uint16_t);
+int zdtm_rms_write(zdtm_writer *p_wr, struct zdtm_rms_msg_content *rms){
+    if (rms->log_size > sizeof(rms->log))
+        return RET_BAD_SIZE;
 
-#endif
+    if (zdtm_wr_need(p_wr, zdtm_rms_length(rms)) != 0)
+        return RET_BAD_SIZE;
 
-        memcpy(buf, rms->log, rms->log_size);
+    zdtm_wr_u16(p_wr, rms->log_size);
+    zdtm_wr_bytes(p_wr, rms->log, rms->log_size);
+    zdtm_wr_zero(p_wr, RMS_LOG_SIZE - rms->log_size);
 
-        buf += rms->log_size;
-
-        memset(buf, 0x00, (RMS_LOG_SIZE - rms->log_size));
-
-        buf += (RMS_LOG_SIZE - rms->log_size);
-
-        return buf;
+    return 0;
 }
 
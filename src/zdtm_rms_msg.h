@@ -45,7 +45,8 @@ extern const char *RMS_MSG_TYPE;
 #define IS_RMS(x) (memcmp(x->body.type, RMS_MSG_TYPE, MSG_TYPE_SIZE) == 0)
 
 inline int zdtm_rms_length(struct zdtm_rms_msg_content *rms);
-inline void *zdtm_rms_write(void *buf, struct zdtm_rms_msg_content *rms);
+inline int zdtm_rms_write(zdtm_writer *p_wr,
+    struct zdtm_rms_msg_content *rms);
 
 
 #endif
@@ -27,8 +27,11 @@ int zdtm_rqt_length(struct zdtm_rqt_msg_content *rqt){
     return sizeof(rqt->null_bytes);
 }
 
-void *zdtm_rqt_write(void *buf, struct zdtm_rqt_msg_content *rqt){
-    memcpy(buf, rqt->null_bytes, sizeof(rqt->null_bytes));
-    buf += sizeof(rqt->null_bytes);
-    return buf;
+int zdtm_rqt_write(zdtm_writer *p_wr, struct zdtm_rqt_msg_content *rqt){
+    if (zdtm_wr_need(p_wr, zdtm_rqt_length(rqt)) != 0)
+        return RET_BAD_SIZE;
+
+    zdtm_wr_bytes(p_wr, rqt->null_bytes, sizeof(rqt->null_bytes));
+
+    return 0;
 }
@@ -40,7 +40,8 @@ extern const char *RQT_MSG_TYPE;
 
 
 inline int zdtm_rqt_length(struct zdtm_rqt_msg_content *rqt);
-inline void *zdtm_rqt_write(void *buf, struct zdtm_rqt_msg_content *rqt);
+inline int zdtm_rqt_write(zdtm_writer *p_wr,
+    struct zdtm_rqt_msg_content *rqt);
 
 
 #endif
@@ -28,9 +28,12 @@ int zdtm_rrl_length(struct zdtm_rrl_msg_content *rrl){
     return sizeof(rrl->pw_size) + rrl->pw_size;
 }
 
-void *zdtm_rrl_write(void *buf, struct zdtm_rrl_msg_content *rrl){
-    *((unsigned char*)buf++) = rrl->pw_size;
-    memcpy(buf, rrl->pw, rrl->pw_size);
-    buf += rrl->pw_size;
-    return buf;
+int zdtm_rrl_write(zdtm_writer *p_wr, struct zdtm_rrl_msg_content *rrl){
+    if (zdtm_wr_need(p_wr, zdtm_rrl_length(rrl)) != 0)
+        return RET_BAD_SIZE;
+
+    zdtm_wr_u8(p_wr, rrl->pw_size);
+    zdtm_wr_bytes(p_wr, rrl->pw, rrl->pw_size);
+
+    return 0;
 }
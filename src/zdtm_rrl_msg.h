@@ -39,6 +39,7 @@ extern const char *RRL_MSG_TYPE;
 #define IS_RRL(x) (memcmp(x->body.type, RRL_MSG_TYPE, MSG_TYPE_SIZE) == 0)
 
 inline int zdtm_rrl_length(struct zdtm_rrl_msg_content *rrl);
-inline void *zdtm_rrl_write(void *buf, struct zdtm_rrl_msg_content *rrl);
+inline int zdtm_rrl_write(zdtm_writer *p_wr,
+    struct zdtm_rrl_msg_content *rrl);
 
 #endif
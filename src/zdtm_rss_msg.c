@@ -28,10 +28,14 @@ int zdtm_rss_length(struct zdtm_rss_msg_content *rss){
     return sizeof(struct zdtm_rss_msg_content);
 }
 
-void *zdtm_rss_write(void *buf, struct zdtm_rss_msg_content *rss){
-    *((unsigned char*)buf++) = rss->uk_1;
-    *((unsigned char*)buf++) = rss->sync_type;
-    *((unsigned char*)buf++) = rss->uk_2;
-    return buf;
+int zdtm_rss_write(zdtm_writer *p_wr, struct zdtm_rss_msg_content *rss){
+    if (zdtm_wr_need(p_wr, zdtm_rss_length(rss)) != 0)
+        return RET_BAD_SIZE;
+
+    zdtm_wr_u8(p_wr, rss->uk_1);
+    zdtm_wr_u8(p_wr, rss->sync_type);
+    zdtm_wr_u8(p_wr, rss->uk_2);
+
+    return 0;
 }
 
@@ -27,8 +27,12 @@ int zdtm_rsy_length(struct zdtm_rsy_msg_content *rsy){
     return sizeof(struct zdtm_rsy_msg_content);
 }
 
-void *zdtm_rsy_write(void *buf, struct zdtm_rsy_msg_content *rsy){
-    *((unsigned char*)buf++) = rsy->sync_type;
-    *((unsigned char*)buf++) = rsy->uk;
-    return buf;
+int zdtm_rsy_write(zdtm_writer *p_wr, struct zdtm_rsy_msg_content *rsy){
+    if (zdtm_wr_need(p_wr, zdtm_rsy_length(rsy)) != 0)
+        return RET_BAD_SIZE;
+
+    zdtm_wr_u8(p_wr, rsy->sync_type);
+    zdtm_wr_u8(p_wr, rsy->uk);
+
+    return 0;
 }
@@ -45,7 +45,8 @@ extern const char *RSY_MSG_TYPE;
 #define IS_RSY(x) (memcmp(x->body.type, RSY_MSG_TYPE, MSG_TYPE_SIZE) == 0)
 
 inline int zdtm_rsy_length(struct zdtm_rsy_msg_content *rsy);
-inline void *zdtm_rsy_write(void *buf, struct zdtm_rsy_msg_content *rsy);
+inline int zdtm_rsy_write(zdtm_writer *p_wr,
+    struct zdtm_rsy_msg_content *rsy);
 
 
 #endif
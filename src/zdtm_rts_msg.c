@@ -29,9 +29,12 @@ int zdtm_rts_length(struct zdtm_rts_msg_content *rts){
     return sizeof(struct zdtm_rts_msg_content);
 }
 
-void *zdtm_rts_write(void *buf, struct zdtm_rts_msg_content *rts){
-    memcpy(buf, rts->date, RTS_DATE_LEN);
-    buf += RTS_DATE_LEN;
-    return buf; 
+int zdtm_rts_write(zdtm_writer *p_wr, struct zdtm_rts_msg_content *rts){
+    if (zdtm_wr_need(p_wr, zdtm_rts_length(rts)) != 0)
+        return RET_BAD_SIZE;
+
+    zdtm_wr_bytes(p_wr, rts->date, RTS_DATE_LEN);
+
+    return 0;
 }
 
@@ -43,7 +43,8 @@ extern const char *RTS_MSG_TYPE;
 #define IS_RTS(x) (memcmp(x->body.type, RTS_MSG_TYPE, MSG_TYPE_SIZE) == 0)
 
 inline int zdtm_rts_length(struct zdtm_rts_msg_content *rts);
-inline void *zdtm_rts_write(void *buf, struct zdtm_rts_msg_content *rts);
+inline int zdtm_rts_write(zdtm_writer *p_wr,
+    struct zdtm_rts_msg_content *rts);
 
 
 #endif
@@ -0,0 +1,336 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+/**
+ * @file zdtm_steps.c
+ * @brief This is an implementation file for the protocol steps.
+ *
+ * The zdtm_steps.c file is an implementation file for the steps of the
+ * Zaurus DTM protocol run by the sans-I/O protocol core.
+ */
+
+#include "zdtm_steps.h"
+
+int _zdtm_step_initiate(zdtm_core *p_core, int *p_retval) {
+    zdtm_msg msg;
+
+    switch (p_core->step_state++) {
+        case 0:
+            /* Send RAY message to the Zaurus */
+            memset(&msg, 0, sizeof(zdtm_msg));
+            memcpy(msg.body.type, RAY_MSG_TYPE, MSG_TYPE_SIZE);
+            if (_zdtm_core_exchange(p_core, ZDTM_XCHG_PUT, &msg) != 0) {
+                (*p_retval) = -1;
+                return 1;
+            }
+            return 0;
+        case 1:
+            if (p_core->result != 0) { (*p_retval) = -1; return 1; }
+            /* receive an ack */
+            _zdtm_core_exchange(p_core, ZDTM_XCHG_GET, NULL);
+            return 0;
+        case 2:
+            if (p_core->result == 0) {
+                (*p_retval) = -1;   /* received message other than an ack */
+                return 1;
+            } else if (p_core->result != 1) {
+                (*p_retval) = -2;
+                return 1;
+            }
+            /* Receive a AAY message */
+            _zdtm_core_exchange(p_core, ZDTM_XCHG_RECV, NULL);
+            return 0;
+        default:
+            if (p_core->result != 0) { (*p_retval) = -3; return 1; }
+            /* Check if the received message is an AAY message */
+            if (!IS_AAY((&p_core->msg))) { (*p_retval) = -4; return 1; }
+            (*p_retval) = 0;
+            return 1;
+    }
+}
+
+int _zdtm_step_authenticate(zdtm_core *p_core, int *p_retval) {
+    zdtm_msg msg;
+    int pw_size;
+
+    switch (p_core->step_state++) {
+        case 0:
+            pw_size = strlen(p_core->passcode);
+
+            /* construct a RRL message to attempt to authenticate */
+            memset(&msg, 0, sizeof(zdtm_msg));
+            memcpy(msg.body.type, RRL_MSG_TYPE, MSG_TYPE_SIZE);
+            msg.body.cont.rrl.pw = malloc(pw_size);
+            if (msg.body.cont.rrl.pw == NULL) {
+                (*p_retval) = -1;
+                return 1;
+            }
+            memcpy(msg.body.cont.rrl.pw, p_core->passcode, pw_size);
+            msg.body.cont.rrl.pw_size = pw_size;
+
+            /* send RRL message, the password is freed with the msg */
+            if (_zdtm_core_exchange(p_core, ZDTM_XCHG_SEND, &msg) != 0) {
+                (*p_retval) = -2;
+                return 1;
+            }
+            return 0;
+        case 1:
+            if (p_core->result != 0) { (*p_retval) = -2; return 1; }
+            /* recv response message (AEX if succeeded, abort common msg) */
+            _zdtm_core_exchange(p_core, ZDTM_XCHG_RECV, NULL);
+            return 0;
+        case 2:
+            if (p_core->result == 3) {
+                _zdtm_core_exchange(p_core, ZDTM_XCHG_RECV, NULL);
+                return 0;
+            } else if (p_core->result != 0) {
+                (*p_retval) = -5;
+            } else if (IS_AEX((&p_core->msg))) {
+                (*p_retval) = 0;
+            } else {
+                (*p_retval) = -6;
+            }
+            return 1;
+        default:
+            if (p_core->result != 0) {
+                (*p_retval) = -3;
+            } else if (IS_ANG((&p_core->msg))) {
+                (*p_retval) = 1;
+            } else {
+                (*p_retval) = -4;
+            }
+            return 1;
+    }
+}
+
+int _zdtm_step_sync_state(zdtm_core *p_core, int *p_retval) {
+    zdtm_lib_env *cur_env;
+    zdtm_msg msg;
+
+    cur_env = p_core->env;
+
+    switch (p_core->step_state++) {
+        case 0:
+            memset(&msg, 0, sizeof(zdtm_msg));
+            memcpy(msg.body.type, RMG_MSG_TYPE, MSG_TYPE_SIZE);
+            msg.body.cont.rmg.uk = 0x01;
+            msg.body.cont.rmg.sync_type = cur_env->sync_type;
+            if (_zdtm_core_exchange(p_core, ZDTM_XCHG_SEND, &msg) != 0) {
+                (*p_retval) = -1;
+                return 1;
+            }
+            return 0;
+        case 1:
+            if (p_core->result != 0) { (*p_retval) = -1; return 1; }
+            _zdtm_core_exchange(p_core, ZDTM_XCHG_RECV, NULL);
+            return 0;
+        default:
+            if (p_core->result != 0) { (*p_retval) = -2; return 1; }
+            if (!IS_AMG((&p_core->msg))) { (*p_retval) = -3; return 1; }
+
+            /* check if todo slow sync is required */
+            if ((p_core->msg.body.cont.amg.fullsync_flags &
+                AMG_TODO_MASK) == 0) {
+                cur_env->todo_slow_sync_required = 1;
+            }
+
+            /* check if calendar slow sync is required */
+            if ((p_core->msg.body.cont.amg.fullsync_flags &
+                AMG_CAL_MASK) == 0) {
+                cur_env->calendar_slow_sync_required = 1;
+            }
+
+            /* check if address book slow sync is required */
+            if ((p_core->msg.body.cont.amg.fullsync_flags &
+                AMG_ADDR_MASK) == 0) {
+                cur_env->address_book_slow_sync_required = 1;
+            }
+
+            cur_env->retrieved_sync_state = 1;
+
+            (*p_retval) = 0;
+            return 1;
+    }
+}
+
+/**
+ * Take a sync id list.
+ *
+ * The _zdtm_step_take_ids function moves a sync id list the ASY parser
+ * allocated into the given list slot of the core, leaving NULL in its
+ * place so that cleaning the message does not free it.
+ * @param p_core Pointer to the protocol core.
+ * @param which The list slot, ZDTM_NEW_IDS, ZDTM_MOD_IDS or ZDTM_DEL_IDS.
+ * @param pp_ids Pointer to the pointer to the sync ids to take.
+ * @param num_ids The number of sync ids in the list.
+ */
+static void _zdtm_step_take_ids(zdtm_core *p_core, int which,
+    uint32_t **pp_ids, uint16_t num_ids) {
+
+    p_core->ids[which] = (*pp_ids);
+    p_core->num_ids[which] = num_ids;
+    (*pp_ids) = NULL;
+}
+
+int _zdtm_step_sync_id_lists(zdtm_core *p_core, int *p_retval) {
+    struct zdtm_asy_msg_content *p_asy;
+    zdtm_msg msg;
+
+    switch (p_core->step_state++) {
+        case 0:
+            memset(&msg, 0, sizeof(zdtm_msg));
+            memcpy(msg.body.type, RSY_MSG_TYPE, MSG_TYPE_SIZE);
+            msg.body.cont.rsy.sync_type = p_core->env->sync_type;
+            msg.body.cont.rsy.uk = 0x07;
+            if (_zdtm_core_exchange(p_core, ZDTM_XCHG_SEND, &msg) != 0) {
+                (*p_retval) = -1;
+                return 1;
+            }
+            return 0;
+        case 1:
+            if (p_core->result != 0) { (*p_retval) = -1; return 1; }
+            _zdtm_core_exchange(p_core, ZDTM_XCHG_RECV, NULL);
+            return 0;
+        default:
+            if (p_core->result != 0) { (*p_retval) = -2; return 1; }
+            if (!IS_ASY((&p_core->msg))) { (*p_retval) = -3; return 1; }
+
+            p_asy = &p_core->msg.body.cont.asy;
+            _zdtm_step_take_ids(p_core, ZDTM_NEW_IDS, &p_asy->new_sync_ids,
+                p_asy->num_new_sync_ids);
+            _zdtm_step_take_ids(p_core, ZDTM_MOD_IDS, &p_asy->mod_sync_ids,
+                p_asy->num_mod_sync_ids);
+            _zdtm_step_take_ids(p_core, ZDTM_DEL_IDS, &p_asy->del_sync_ids,
+                p_asy->num_del_sync_ids);
+
+            (*p_retval) = 0;
+            return 1;
+    }
+}
+
+int _zdtm_step_obtain_item(zdtm_core *p_core, int *p_retval) {
+    zdtm_msg msg;
+
+    switch (p_core->step_state++) {
+        case 0:
+            memset(&msg, 0, sizeof(zdtm_msg));
+            memcpy(msg.body.type, RDR_MSG_TYPE, MSG_TYPE_SIZE);
+            msg.body.cont.rdr.sync_type = p_core->env->sync_type;
+            msg.body.cont.rdr.num_sync_ids = 1;
+            msg.body.cont.rdr.sync_id = p_core->sync_id;
+            if (_zdtm_core_exchange(p_core, ZDTM_XCHG_SEND, &msg) != 0) {
+                (*p_retval) = -1;
+                return 1;
+            }
+            return 0;
+        case 1:
+            if (p_core->result != 0) { (*p_retval) = -1; return 1; }
+            _zdtm_core_exchange(p_core, ZDTM_XCHG_RECV, NULL);
+            return 0;
+        default:
+            if (p_core->result != 0) { (*p_retval) = -2; return 1; }
+            if (!IS_ADR((&p_core->msg))) { (*p_retval) = -3; return 1; }
+
+            if (p_core->raw_adr) {
+                /* Take the raw content over so cleaning the message
+                 * leaves it be. */
+                p_core->raw = p_core->msg.body.p_raw_content;
+                p_core->raw_size = p_core->msg.cont_size;
+                p_core->msg.body.p_raw_content = NULL;
+            } else {
+                /* The params are not freed when the message is
+                 * cleaned, hence they are simply handed over. */
+                p_core->params = p_core->msg.body.cont.adr.params;
+                p_core->num_params = p_core->msg.body.cont.adr.num_params;
+            }
+
+            (*p_retval) = 0;
+            return 1;
+    }
+}
+
+int _zdtm_step_delete_item(zdtm_core *p_core, int *p_retval) {
+    zdtm_msg msg;
+
+    switch (p_core->step_state++) {
+        case 0:
+            memset(&msg, 0, sizeof(zdtm_msg));
+            memcpy(msg.body.type, RDD_MSG_TYPE, MSG_TYPE_SIZE);
+            msg.body.cont.rdd.sync_type = p_core->env->sync_type;
+            msg.body.cont.rdd.num_sync_ids = 1;
+            msg.body.cont.rdd.sync_id = p_core->sync_id;
+            if (_zdtm_core_exchange(p_core, ZDTM_XCHG_SEND, &msg) != 0) {
+                (*p_retval) = -1;
+                return 1;
+            }
+            return 0;
+        case 1:
+            if (p_core->result != 0) { (*p_retval) = -1; return 1; }
+            _zdtm_core_exchange(p_core, ZDTM_XCHG_RECV, NULL);
+            return 0;
+        default:
+            if (p_core->result != 0) { (*p_retval) = -2; return 1; }
+            if (!IS_AEX((&p_core->msg))) { (*p_retval) = -3; return 1; }
+            (*p_retval) = 0;
+            return 1;
+    }
+}
+
+int _zdtm_step_terminate(zdtm_core *p_core, int *p_retval) {
+    zdtm_msg msg;
+
+    switch (p_core->step_state++) {
+        case 0:
+            /* send RQT message */
+            memset(&msg, 0, sizeof(zdtm_msg));
+            memcpy(msg.body.type, RQT_MSG_TYPE, MSG_TYPE_SIZE);
+            memset(msg.body.cont.rqt.null_bytes, 0,
+                sizeof(msg.body.cont.rqt.null_bytes));
+            if (_zdtm_core_exchange(p_core, ZDTM_XCHG_SEND, &msg) != 0) {
+                (*p_retval) = -1;
+                return 1;
+            }
+            return 0;
+        case 1:
+            if (p_core->result != 0) { (*p_retval) = -1; return 1; }
+            _zdtm_core_exchange(p_core, ZDTM_XCHG_RECV, NULL);
+            return 0;
+        case 2:
+            if (p_core->result != 0) { (*p_retval) = -2; return 1; }
+            /* recv rqst message */
+            _zdtm_core_exchange(p_core, ZDTM_XCHG_GET, NULL);
+            return 0;
+        case 3:
+            if (p_core->result != 2) { (*p_retval) = -3; return 1; }
+            /* send RAY message */
+            memset(&msg, 0, sizeof(zdtm_msg));
+            memcpy(msg.body.type, RAY_MSG_TYPE, MSG_TYPE_SIZE);
+            if (_zdtm_core_exchange(p_core, ZDTM_XCHG_PUT, &msg) != 0) {
+                (*p_retval) = -4;
+                return 1;
+            }
+            return 0;
+        default:
+            if (p_core->result != 0) { (*p_retval) = -4; return 1; }
+            (*p_retval) = 0;
+            return 1;
+    }
+}
@@ -0,0 +1,167 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+/**
+ * @file zdtm_steps.h
+ * @brief This is a specifications file for the protocol steps.
+ *
+ * The zdtm_steps.h file is a specifications file for the steps of the
+ * Zaurus DTM protocol, written as zdtm_core_step functions run by the
+ * sans-I/O protocol core (see zdtm_core.h). A step only builds and
+ * interprets messages, the environment being updated with what it
+ * learns, it neither touches a socket nor the mirror store. Each step
+ * takes its arguments from and stores its results in the protocol core
+ * it is run on, as described for each step.
+ */
+
+#ifndef ZDTM_STEPS_H
+#define ZDTM_STEPS_H
+
+#include "zdtm_core.h"
+
+// Indexes of the sync id lists obtained by _zdtm_step_sync_id_lists.
+#define ZDTM_NEW_IDS 0
+#define ZDTM_MOD_IDS 1
+#define ZDTM_DEL_IDS 2
+
+/**
+ * Initiate step.
+ *
+ * The _zdtm_step_initiate step sends a RAY message, as is, over the
+ * connection from the Zaurus, expects an ack message back, and then
+ * receives the AAY message starting the synchronization.
+ * @param p_core Pointer to the protocol core running the step.
+ * @param p_retval Pointer to store the result of the step, listed below, in.
+ * @return Zero if another exchange was queued, one if the step is done.
+ * @retval 0 Successfully initiated the synchronization.
+ * @retval -1 Failed to send RAY, or received a message in
+ * place of the ack.
+ * @retval -2 Failed to receive the ack message.
+ * @retval -3 Failed to receive the AAY message.
+ * @retval -4 Received message is not an AAY message.
+ */
+int _zdtm_step_initiate(zdtm_core *p_core, int *p_retval);
+
+/**
+ * Authenticate step.
+ *
+ * The _zdtm_step_authenticate step authenticates with the passcode in
+ * the passcode member of the core by sending a RRL message.
+ * @param p_core Pointer to the protocol core running the step.
+ * @param p_retval Pointer to store the result of the step, listed below, in.
+ * @return Zero if another exchange was queued, one if the step is done.
+ * @retval 0 Successfully authenticated.
+ * @retval 1 The Zaurus refused the passcode.
+ * @retval -1 Failed to allocate memory for the RRL message.
+ * @retval -2 Failed to send the RRL message.
+ * @retval -3 Failed to receive message following abort message.
+ * @retval -4 Message following abort message is not ANG.
+ * @retval -5 Failed to receive response to the RRL message.
+ * @retval -6 Response to the RRL message is not AEX.
+ */
+int _zdtm_step_authenticate(zdtm_core *p_core, int *p_retval);
+
+/**
+ * Sync state step.
+ *
+ * The _zdtm_step_sync_state step obtains the synchronization state with
+ * a RMG message and sets the slow sync required flags of the
+ * environment accordingly.
+ * @param p_core Pointer to the protocol core running the step.
+ * @param p_retval Pointer to store the result of the step, listed below, in.
+ * @return Zero if another exchange was queued, one if the step is done.
+ * @retval 0 Successfully obtained the sync state.
+ * @retval -1 Failed to send the RMG message.
+ * @retval -2 Failed to receive the response message.
+ * @retval -3 Response message is not an AMG message.
+ */
+int _zdtm_step_sync_state(zdtm_core *p_core, int *p_retval);
+
+/**
+ * Sync id lists step.
+ *
+ * The _zdtm_step_sync_id_lists step obtains the new, modified, and
+ * deleted sync id lists with a RSY message. On success the ids and
+ * num_ids members of the core, indexed by ZDTM_NEW_IDS, ZDTM_MOD_IDS,
+ * and ZDTM_DEL_IDS, hold dynamically allocated copies of the lists
+ * which are to be freed by the caller.
+ * @param p_core Pointer to the protocol core running the step.
+ * @param p_retval Pointer to store the result of the step, listed below, in.
+ * @return Zero if another exchange was queued, one if the step is done.
+ * @retval 0 Successfully obtained the sync id lists.
+ * @retval -1 Failed to send the RSY message.
+ * @retval -2 Failed to receive the response message.
+ * @retval -3 Response message is not an ASY message.
+ * @retval -4 Failed to allocate memory for the lists.
+ */
+int _zdtm_step_sync_id_lists(zdtm_core *p_core, int *p_retval);
+
+/**
+ * Obtain item step.
+ *
+ * The _zdtm_step_obtain_item step obtains the parameters of the item
+ * with the sync id in the sync_id member of the core with a RDR
+ * message. On success the params and num_params members of the core
+ * hold the parameters, which are to be freed by the caller with
+ * _zdtm_free_params().
+ * @param p_core Pointer to the protocol core running the step.
+ * @param p_retval Pointer to store the result of the step, listed below, in.
+ * @return Zero if another exchange was queued, one if the step is done.
+ * @retval 0 Successfully obtained the item.
+ * @retval -1 Failed to send the RDR message.
+ * @retval -2 Failed to receive the response message.
+ * @retval -3 Response message is not an ADR message.
+ */
+int _zdtm_step_obtain_item(zdtm_core *p_core, int *p_retval);
+
+/**
+ * Delete item step.
+ *
+ * The _zdtm_step_delete_item step deletes the item with the sync id in
+ * the sync_id member of the core with a RDD message.
+ * @param p_core Pointer to the protocol core running the step.
+ * @param p_retval Pointer to store the result of the step, listed below, in.
+ * @return Zero if another exchange was queued, one if the step is done.
+ * @retval 0 Successfully deleted the item.
+ * @retval -1 Failed to send the RDD message.
+ * @retval -2 Failed to receive the response message.
+ * @retval -3 Response message is not an AEX message.
+ */
+int _zdtm_step_delete_item(zdtm_core *p_core, int *p_retval);
+
+/**
+ * Terminate step.
+ *
+ * The _zdtm_step_terminate step ends the synchronization by sending a
+ * RQT message, and then sends a RAY message, as is, once the Zaurus
+ * asks for it with a rqst message.
+ * @param p_core Pointer to the protocol core running the step.
+ * @param p_retval Pointer to store the result of the step, listed below, in.
+ * @return Zero if another exchange was queued, one if the step is done.
+ * @retval 0 Successfully terminated the synchronization.
+ * @retval -1 Failed to send the RQT message.
+ * @retval -2 Failed to receive the response message.
+ * @retval -3 Failed to receive the rqst message.
+ * @retval -4 Failed to send the RAY message.
+ */
+int _zdtm_step_terminate(zdtm_core *p_core, int *p_retval);
+
+#endif
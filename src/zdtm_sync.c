@@ -32,10 +32,44 @@
 #include "zdtm_sync.h"
 
 int zdtm_initialize(zdtm_lib_env *cur_env) {
-    int r;
+    return zdtm_initialize_transport(cur_env, NULL);
+}
 
-    r = _zdtm_open_log(cur_env);
-    if (r != 0) { return -1; }
+/**
+ * Initialize the environment.
+ *
+ * The _zdtm_init_env function sets all the members of the environment
+ * to their initial values, short of listening for the Zaurus.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param p_tp Pointer to the transport to use, NULL for TCP/IP.
+ */
+static void _zdtm_init_env(zdtm_lib_env *cur_env, zdtm_transport *p_tp) {
+    /* Log to the default log file, opened once there is something to
+     * log to it. */
+    cur_env->log_sink = ZDTM_LOG_DEFAULT;
+    cur_env->logfp = NULL;
+    cur_env->logfd = -1;
+    cur_env->log_func = NULL;
+    cur_env->log_arg = NULL;
+
+    if (p_tp == NULL) {
+        p_tp = zdtm_tcp_transport();
+    }
+    cur_env->transport = p_tp;
+
+    /* Neither the listener nor any connection with the Zaurus is open
+     * yet. */
+    cur_env->listenfd = INVALID_SOCKET;
+    cur_env->own_listener = 0;
+    cur_env->connfd = INVALID_SOCKET;
+    cur_env->reqfd = INVALID_SOCKET;
+
+    /* Wait as long as it takes on the connections until deadlines are
+     * set with zdtm_set_timeouts. */
+    cur_env->connect_timeout = -1;
+    cur_env->accept_timeout = -1;
+    cur_env->io_timeout = -1;
+    cur_env->timed_out = 0;
 
     /* Set the stored Zaurus IP address to all nulls so that I can check
      * it at a later point to see if the user has set it yet. */
@@ -56,12 +90,40 @@ int zdtm_initialize(zdtm_lib_env *cur_env) {
     /* Set the pramaters format to appropriate initial values. */
     cur_env->num_params = 0;
     cur_env->params = NULL;
+    cur_env->schema = NULL;
+    cur_env->categories = NULL;
+    cur_env->share_categories = 0;
 
     /* Set the passcode to an appropriate initial value. */
     cur_env->passcode = NULL;
 
+    /* Set the mirror store to an appropriate initial value. */
+    cur_env->mirror = NULL;
+
+    /* Set the checkpoint journal to an appropriate initial value. */
+    cur_env->journal = NULL;
+}
+
+int zdtm_initialize_transport(zdtm_lib_env *cur_env, zdtm_transport *p_tp) {
+    int r;
+
+    _zdtm_init_env(cur_env, p_tp);
+
     r = _zdtm_listen_for_zaurus(cur_env);
     if (r != 0) { return -2; }
+    cur_env->own_listener = 1;
+
+    return 0;
+}
+
+int zdtm_initialize_listener(zdtm_lib_env *cur_env, zdtm_transport *p_tp,
+    SOCKET listenfd) {
+
+    _zdtm_init_env(cur_env, p_tp);
+
+    /* Without a listener one is created by the first synchronization
+     * initiated. */
+    cur_env->listenfd = listenfd;
 
     return 0;
 }
@@ -73,6 +135,66 @@ int zdtm_set_zaurus_ip(zdtm_lib_env *cur_env, char *ip_addr) {
     return 0;
 }
 
+int zdtm_set_log_file(zdtm_lib_env *cur_env, const char *path) {
+    FILE *prev_fp;
+
+    prev_fp = cur_env->logfp;
+    cur_env->logfp = NULL;
+    if (path != NULL) {
+        if (_zdtm_open_log(cur_env, path) != 0) {
+            cur_env->logfp = prev_fp;
+            return -1;
+        }
+    }
+
+    if (prev_fp != NULL) {
+        fclose(prev_fp);
+    }
+    cur_env->log_sink = (path != NULL) ? ZDTM_LOG_FILE : ZDTM_LOG_DEFAULT;
+
+    return 0;
+}
+
+int zdtm_set_log_fd(zdtm_lib_env *cur_env, int fd) {
+    if (_zdtm_close_log(cur_env) != 0) { return -1; }
+
+    cur_env->logfd = fd;
+    cur_env->log_sink = ZDTM_LOG_FD;
+
+    return 0;
+}
+
+int zdtm_set_log_func(zdtm_lib_env *cur_env, zdtm_log_func func,
+    void *arg) {
+
+    if (func == NULL) { return -2; }
+    if (_zdtm_close_log(cur_env) != 0) { return -1; }
+
+    cur_env->log_func = func;
+    cur_env->log_arg = arg;
+    cur_env->log_sink = ZDTM_LOG_FUNC;
+
+    return 0;
+}
+
+int zdtm_set_log_none(zdtm_lib_env *cur_env) {
+    if (_zdtm_close_log(cur_env) != 0) { return -1; }
+
+    cur_env->log_sink = ZDTM_LOG_NONE;
+
+    return 0;
+}
+
+int zdtm_set_timeouts(zdtm_lib_env *cur_env, int connect_ms, int accept_ms,
+    int io_ms) {
+
+    cur_env->connect_timeout = connect_ms;
+    cur_env->accept_timeout = accept_ms;
+    cur_env->io_timeout = io_ms;
+
+    return 0;
+}
+
 int zdtm_set_sync_type(zdtm_lib_env *cur_env, unsigned int type) {
     if (type == 0) {            /* ToDo */
         cur_env->sync_type = 0x06;
@@ -87,6 +209,12 @@ int zdtm_set_sync_type(zdtm_lib_env *cur_env, unsigned int type) {
     return 0;
 }
 
+int zdtm_set_category_sharing(zdtm_lib_env *cur_env, int share) {
+    cur_env->share_categories = share;
+
+    return 0;
+}
+
 int zdtm_set_passcode(zdtm_lib_env *cur_env, char *passcode) {
     size_t pass_len;
 
@@ -106,7 +234,7 @@ int zdtm_initiate_sync(zdtm_lib_env *cur_env) {
     int r, retval;
     int i, desc_len;
     char buff[256];
-    zdtm_msg msg, rmsg;
+    zdtm_core core;
     char ip_cmp[IP_STR_SIZE];
     time_t last_time_synced, time_synced;
 
@@ -116,71 +244,51 @@ int zdtm_initiate_sync(zdtm_lib_env *cur_env) {
     
     memset(ip_cmp, '\0', IP_STR_SIZE);
 
+    /* A deadline missed by a previous synchronization is forgotten. */
+    cur_env->timed_out = 0;
+
     if (memcmp(cur_env->zaurus_ip, ip_cmp, IP_STR_SIZE) == 0) {
         /* The Zaurus IP address has not been set yet */
         return -5;
     }
 
-    r = _zdtm_connect(cur_env, cur_env->zaurus_ip);
-    if (r != 0) {
-        return -6;
+    /* Create the deferred listener before the Zaurus is asked to
+     * connect back to it. */
+    if (cur_env->listenfd == INVALID_SOCKET) {
+        r = _zdtm_listen_for_zaurus(cur_env);
+        if (r != 0) {
+            return -18;
+        }
+        cur_env->own_listener = 1;
     }
 
-    /* Send RAY message to the Zaurus */
-    memset(&msg, 0, sizeof(zdtm_msg));
-    memcpy(msg.body.type, RAY_MSG_TYPE, MSG_TYPE_SIZE);
-    r = _zdtm_send_message(cur_env, &msg);
+    r = _zdtm_connect(cur_env, cur_env->zaurus_ip);
     if (r != 0) {
-        _zdtm_log_error(cur_env, "zdtm_initiate_sync: _zdtm_send_message",
-            r);
-        return -1;
+        return _zdtm_timeout_result(cur_env, -6);
     }
 
-    /* receive an ack */
-    memset(&rmsg, 0, sizeof(zdtm_msg));
-    r = _zdtm_recv_message(cur_env, &rmsg);
-    if (r != 1) {
-        _zdtm_log_error(cur_env, "zdtm_initiate_sync: _zdtm_recv_message",
-            r);
-        if (r == 0) {
-            _zdtm_clean_message(&rmsg);
-            return -1;  /* received message other than an ack */
-        } else {
-            _zdtm_clean_message(&rmsg);
-            return -2;
-        }
-    }
-    _zdtm_clean_message(&rmsg);
-
-    /* Receive a AAY message */
-    memset(&rmsg, 0, sizeof(zdtm_msg));
-    r = _zdtm_wrapped_recv_message(cur_env, &rmsg);
+    /* Send RAY message to the Zaurus, receive an ack, and receive a
+     * AAY message */
+    _zdtm_core_init(&core, cur_env);
+    r = _zdtm_run_step(cur_env, &core, _zdtm_step_initiate);
+    _zdtm_core_cleanup(&core);
     if (r != 0) {
-        _zdtm_log_error(cur_env, "zdtm_initiate_sync: _zdtm_wrapped_recv_message",
+        _zdtm_log_error(cur_env, "zdtm_initiate_sync: _zdtm_step_initiate",
             r);
-        _zdtm_clean_message(&rmsg);
-        return -3;
-    }
-
-    /* Check if the received message is an AAY message */
-    if (!IS_AAY((&rmsg))) {
-        _zdtm_clean_message(&rmsg);
-        return -4;
+        return _zdtm_timeout_result(cur_env, r);
     }
 
-    _zdtm_clean_message(&rmsg);
-
     /* Obtain Device Info from Zaurus */
     r = zdtm_check_cur_auth_state(cur_env);
     if (r < 0) {
-        return -6;
+        return _zdtm_timeout_result(cur_env, -6);
     } else if (r == 1) {
         if (cur_env->passcode != NULL) {
             retval = _zdtm_authenticate_passcode(cur_env, cur_env->passcode);
             if (retval == 1) {
                 return 1;
             } else if (retval != 0) {
-                return -7;
+                return _zdtm_timeout_result(cur_env, -7);
             }
         } else {
             return -8;
@@ -189,22 +297,31 @@ int zdtm_initiate_sync(zdtm_lib_env *cur_env) {
 
     r = _zdtm_obtain_device_info(cur_env);
     if (r < 0) {
-        return -9;
+        return _zdtm_timeout_result(cur_env, -9);
     }
 
     /* Obtain Zaurus Sync State */
     r = _zdtm_obtain_sync_state(cur_env);
     if (r != 0) {
-        return -10;
+        return _zdtm_timeout_result(cur_env, -10);
     }
 
     /* Here I get the last time it was synced */
     r = _zdtm_obtain_last_time_synced(cur_env, &last_time_synced);
     if (r != 0) {
         if (r == 1) {
-            return -11;
+            return _zdtm_timeout_result(cur_env, -11);
         } else {
-            return -12;
+            return _zdtm_timeout_result(cur_env, -12);
+        }
+    }
+
+    /* Resume the synchronization recorded by the checkpoint journal if
+     * the Zaurus is in the same state, else start recording this one. */
+    if (cur_env->journal != NULL) {
+        r = _zdtm_journal_begin(cur_env->journal, cur_env, last_time_synced);
+        if (r < 0) {
+            return -17;
         }
     }
 
@@ -212,7 +329,7 @@ int zdtm_initiate_sync(zdtm_lib_env *cur_env) {
     if (zdtm_requires_slow_sync(cur_env) == 1) {
         r = _zdtm_reset_sync_log(cur_env);
         if (r != 0) {
-            return -13;
+            return _zdtm_timeout_result(cur_env, -13);
         }
     }
 
@@ -221,21 +338,27 @@ int zdtm_initiate_sync(zdtm_lib_env *cur_env) {
     time_synced = time(NULL);
     r = _zdtm_set_last_time_synced(cur_env, time_synced);
     if (r != 0) {
-        return -14;
+        return _zdtm_timeout_result(cur_env, -14);
+    }
+    if (cur_env->journal != NULL) {
+        r = _zdtm_journal_anchor(cur_env->journal, time_synced);
+        if (r != 0) {
+            return -17;
+        }
     }
 
     /* Attempt to reset the sync state */
     if (zdtm_requires_slow_sync(cur_env) == 1) {
         r = _zdtm_reset_sync_state(cur_env);
         if (r != 0) {
-            return -15;
+            return _zdtm_timeout_result(cur_env, -15);
         }
     }
 
     /* Attempt to obtain param format */
     r = _zdtm_obtain_param_format(cur_env);
     if (r != 0) {
-        return -16;
+        return _zdtm_timeout_result(cur_env, -16);
     }
     for (i = 0; i < cur_env->num_params; i++) {
         desc_len = 4;
@@ -255,7 +378,7 @@ int zdtm_check_cur_auth_state(zdtm_lib_env *cur_env) {
     if (!cur_env->retreived_device_info) { /* get device info, it is needed */
         r = _zdtm_obtain_device_info(cur_env);
         if (r != 0) {
-            return -1;
+            return _zdtm_timeout_result(cur_env, -1);
         }
     }
 
@@ -273,7 +396,7 @@ int zdtm_requires_slow_sync(zdtm_lib_env *cur_env) {
     if (!cur_env->retrieved_sync_state) { /* get sync state, it is needed */
         r = _zdtm_obtain_sync_state(cur_env);
         if (r != 0) {
-            return -1;
+            return _zdtm_timeout_result(cur_env, -1);
         }
     }
 
@@ -293,74 +416,90 @@ int zdtm_obtain_sync_id_lists(zdtm_lib_env *cur_env,
     uint32_t **pp_mod_sync_ids, uint16_t *p_num_mod_sync_ids,
     uint32_t **pp_del_sync_ids, uint16_t *p_num_del_sync_ids) {
 
-    int r;
-    zdtm_msg msg, rmsg;
-    uint32_t *p_new_sync_ids;
-    uint32_t *p_mod_sync_ids;
-    uint32_t *p_del_sync_ids;
-    uint16_t num_new_sync_ids, num_mod_sync_ids, num_del_sync_ids;
-
-    p_new_sync_ids = NULL;
-    p_mod_sync_ids = NULL;
-    p_del_sync_ids = NULL;
-
-    memset(&msg, 0, sizeof(zdtm_msg));
-    memcpy(msg.body.type, RSY_MSG_TYPE, MSG_TYPE_SIZE);
-    msg.body.cont.rsy.sync_type = cur_env->sync_type;
-    msg.body.cont.rsy.uk = 0x07;
-
-    r = _zdtm_wrapped_send_message(cur_env, &msg);
-    if(r != 0){ return -1; }
-
-    memset(&rmsg, 0, sizeof(zdtm_msg));
-    r = _zdtm_wrapped_recv_message(cur_env, &rmsg);
-    if(r != 0){ _zdtm_clean_message(&rmsg); return -2; }
-
-    if (memcmp(rmsg.body.type, ASY_MSG_TYPE, MSG_TYPE_SIZE) != 0) {
-        _zdtm_clean_message(&rmsg);
-        return -3;
+    int r, i;
+    zdtm_core core;
+    uint32_t *ids[3];
+    uint16_t num_ids[3];
+
+    /* A resumed synchronization goes by the lists it obtained before,
+     * less the items it already obtained. */
+    r = 1;
+    if (cur_env->journal != NULL) {
+        r = _zdtm_journal_get_lists(cur_env->journal, ids, num_ids);
+        if (r < 0) {
+            return -6;
+        }
+    }
+
+    if (r != 0) {
+        _zdtm_core_init(&core, cur_env);
+        r = _zdtm_run_step(cur_env, &core, _zdtm_step_sync_id_lists);
+        if (r != 0) {
+            _zdtm_core_cleanup(&core);
+            return _zdtm_timeout_result(cur_env, r);
+        }
+        for (i = ZDTM_NEW_IDS; i <= ZDTM_DEL_IDS; i++) {
+            ids[i] = core.ids[i];
+            num_ids[i] = core.num_ids[i];
+        }
+        _zdtm_core_cleanup(&core);
+
+        if (cur_env->journal != NULL) {
+            r = _zdtm_journal_put_lists(cur_env->journal, ids, num_ids);
+            if (r != 0) {
+                for (i = ZDTM_NEW_IDS; i <= ZDTM_DEL_IDS; i++) {
+                    free(ids[i]);
+                }
+                return -6;
+            }
+        }
+    }
+
+    /* The items on the deleted list no longer exist on the Zaurus,
+     * hence they are dropped from the mirror store right away. */
+    if (cur_env->mirror != NULL) {
+        for (i = 0; i < num_ids[ZDTM_DEL_IDS]; i++) {
+            r = zdtm_mirror_delete(cur_env->mirror, cur_env->sync_type,
+                ids[ZDTM_DEL_IDS][i]);
+            if (r < 0) {
+                for (i = ZDTM_NEW_IDS; i <= ZDTM_DEL_IDS; i++) {
+                    free(ids[i]);
+                }
+                return -5;
+            }
+        }
+    }
+
+    (*pp_new_sync_ids) = ids[ZDTM_NEW_IDS];
+    (*pp_mod_sync_ids) = ids[ZDTM_MOD_IDS];
+    (*pp_del_sync_ids) = ids[ZDTM_DEL_IDS];
+    (*p_num_new_sync_ids) = num_ids[ZDTM_NEW_IDS];
+    (*p_num_mod_sync_ids) = num_ids[ZDTM_MOD_IDS];
+    (*p_num_del_sync_ids) = num_ids[ZDTM_DEL_IDS];
+
+    return 0;
+}
+
+int zdtm_lookup_category(zdtm_lib_env *cur_env, uint16_t category_id,
+    const unsigned char **pp_data, uint32_t *p_len) {
+
+    const unsigned char *p_data;
+
+    if (category_id == ZDTM_CATEGORY_NONE) {
+        (*pp_data) = (const unsigned char *)"";
+        (*p_len) = 0;
+        return 0;
+    }
+
+    if (cur_env->categories == NULL) {
+        return -1;
     }
 
-    num_new_sync_ids = rmsg.body.cont.asy.num_new_sync_ids;
-    p_new_sync_ids = malloc(sizeof(uint32_t) * num_new_sync_ids);
-    if (p_new_sync_ids == NULL) {
-        _zdtm_clean_message(&rmsg);
-        return -4;
-    }
-    num_mod_sync_ids = rmsg.body.cont.asy.num_mod_sync_ids;
-    p_mod_sync_ids = malloc(sizeof(uint32_t) * num_mod_sync_ids);
-    if (p_mod_sync_ids == NULL) {
-        free(p_new_sync_ids);
-        _zdtm_clean_message(&rmsg);
-        return -4;
-    }
-    num_del_sync_ids = rmsg.body.cont.asy.num_del_sync_ids;
-    p_del_sync_ids = malloc(sizeof(uint32_t) * num_del_sync_ids);
-    if (p_del_sync_ids == NULL) {
-        free(p_mod_sync_ids);
-        free(p_new_sync_ids);
-        _zdtm_clean_message(&rmsg);
-        return -4;
-    }
-
-    /* At this point I know I have allocated all the necessary space so
-     * I can copy the lists over and assign the pointers and their
-     * associated lengths. */
-    memcpy(p_new_sync_ids, rmsg.body.cont.asy.new_sync_ids,
-           (sizeof(uint32_t) * num_new_sync_ids));
-    memcpy(p_mod_sync_ids, rmsg.body.cont.asy.mod_sync_ids,
-           (sizeof(uint32_t) * num_mod_sync_ids));
-    memcpy(p_del_sync_ids, rmsg.body.cont.asy.del_sync_ids,
-           (sizeof(uint32_t) * num_del_sync_ids));
-
-    (*pp_new_sync_ids) = p_new_sync_ids;
-    (*pp_mod_sync_ids) = p_mod_sync_ids;
-    (*pp_del_sync_ids) = p_del_sync_ids;
-    (*p_num_new_sync_ids) = num_new_sync_ids;
-    (*p_num_mod_sync_ids) = num_mod_sync_ids;
-    (*p_num_del_sync_ids) = num_del_sync_ids;
-
-    _zdtm_clean_message(&rmsg);
+    p_data = zdtm_category_lookup(cur_env->categories, category_id, p_len);
+    if (p_data == NULL) {
+        return -1;
+    }
+    (*pp_data) = p_data;
 
     return 0;
 }
@@ -378,7 +517,16 @@ int zdtm_obtain_todo_item(zdtm_lib_env *cur_env, uint32_t sync_id,
 
     r = _zdtm_obtain_item(cur_env, sync_id, &params, &num_params);
     if (r != 0) {
-        return -2;
+        return _zdtm_timeout_result(cur_env, -2);
+    }
+
+    if (cur_env->mirror != NULL) {
+        r = zdtm_mirror_put(cur_env->mirror, cur_env->sync_type, sync_id,
+            params, num_params);
+        if (r != 0) {
+            _zdtm_free_params(cur_env, params, num_params);
+            return -4;
+        }
     }
 
     r = _zdtm_parse_todo_item_params(cur_env->params, cur_env->num_params,
@@ -390,6 +538,21 @@ int zdtm_obtain_todo_item(zdtm_lib_env *cur_env, uint32_t sync_id,
 
     _zdtm_free_params(cur_env, params, num_params);
 
+    r = _zdtm_intern_category(cur_env, &p_todo_item->category,
+        p_todo_item->category_len, &p_todo_item->category_id,
+        cur_env->share_categories);
+    if (r != 0) {
+        return -6;
+    }
+
+    if (cur_env->journal != NULL) {
+        r = _zdtm_journal_mark(cur_env->journal, ZDTM_JOURNAL_OBTAINED,
+            sync_id);
+        if (r != 0) {
+            return -5;
+        }
+    }
+
     return 0;
 }
 
@@ -406,7 +569,16 @@ int zdtm_obtain_calendar_item(zdtm_lib_env *cur_env, uint32_t sync_id,
 
     r = _zdtm_obtain_item(cur_env, sync_id, &params, &num_params);
     if (r != 0) {
-        return -2;
+        return _zdtm_timeout_result(cur_env, -2);
+    }
+
+    if (cur_env->mirror != NULL) {
+        r = zdtm_mirror_put(cur_env->mirror, cur_env->sync_type, sync_id,
+            params, num_params);
+        if (r != 0) {
+            _zdtm_free_params(cur_env, params, num_params);
+            return -4;
+        }
     }
 
     r = _zdtm_parse_calendar_item_params(cur_env->params, cur_env->num_params,
@@ -418,6 +590,21 @@ int zdtm_obtain_calendar_item(zdtm_lib_env *cur_env, uint32_t sync_id,
 
     _zdtm_free_params(cur_env, params, num_params);
 
+    r = _zdtm_intern_category(cur_env, &p_calendar_item->category,
+        p_calendar_item->category_len, &p_calendar_item->category_id,
+        cur_env->share_categories);
+    if (r != 0) {
+        return -6;
+    }
+
+    if (cur_env->journal != NULL) {
+        r = _zdtm_journal_mark(cur_env->journal, ZDTM_JOURNAL_OBTAINED,
+            sync_id);
+        if (r != 0) {
+            return -5;
+        }
+    }
+
     return 0;
 }
 
@@ -434,7 +621,16 @@ int zdtm_obtain_address_item(zdtm_lib_env *cur_env, uint32_t sync_id,
 
     r = _zdtm_obtain_item(cur_env, sync_id, &params, &num_params);
     if (r != 0) {
-        return -2;
+        return _zdtm_timeout_result(cur_env, -2);
+    }
+
+    if (cur_env->mirror != NULL) {
+        r = zdtm_mirror_put(cur_env->mirror, cur_env->sync_type, sync_id,
+            params, num_params);
+        if (r != 0) {
+            _zdtm_free_params(cur_env, params, num_params);
+            return -4;
+        }
     }
 
     r = _zdtm_parse_address_item_params(cur_env->params, cur_env->num_params,
@@ -446,64 +642,369 @@ int zdtm_obtain_address_item(zdtm_lib_env *cur_env, uint32_t sync_id,
 
     _zdtm_free_params(cur_env, params, num_params);
 
+    r = _zdtm_intern_category(cur_env, &p_address_item->category,
+        p_address_item->category_len, &p_address_item->category_id,
+        cur_env->share_categories);
+    if (r != 0) {
+        return -6;
+    }
+
+    if (cur_env->journal != NULL) {
+        r = _zdtm_journal_mark(cur_env->journal, ZDTM_JOURNAL_OBTAINED,
+            sync_id);
+        if (r != 0) {
+            return -5;
+        }
+    }
+
     return 0;
 }
 
-int zdtm_delete_item(zdtm_lib_env *cur_env, uint32_t sync_id) {
-    zdtm_msg msg, rmsg;
+int zdtm_obtain_compact_address(zdtm_lib_env *cur_env, uint32_t sync_id,
+    zdtm_compact_address **pp_compact) {
+
     int r;
+    struct zdtm_adr_msg_param *params;
+    uint16_t num_params;
+
+    if (cur_env->sync_type != SYNC_TYPE_ADDRESS) {
+        return -1;
+    }
 
-    memset(&msg, 0, sizeof(zdtm_msg));
-    memcpy(msg.body.type, RDD_MSG_TYPE, MSG_TYPE_SIZE);
-    msg.body.cont.rdd.sync_type = cur_env->sync_type;
-    msg.body.cont.rdd.num_sync_ids = 1;
-    msg.body.cont.rdd.sync_id = sync_id;
+    r = _zdtm_obtain_item(cur_env, sync_id, &params, &num_params);
+    if (r != 0) {
+        return _zdtm_timeout_result(cur_env, -2);
+    }
 
-    r = _zdtm_wrapped_send_message(cur_env, &msg);
-    if (r != 0) { return -1; }
+    if (cur_env->mirror != NULL) {
+        r = zdtm_mirror_put(cur_env->mirror, cur_env->sync_type, sync_id,
+            params, num_params);
+        if (r != 0) {
+            _zdtm_free_params(cur_env, params, num_params);
+            return -4;
+        }
+    }
+
+    r = zdtm_compact_address_from_params(cur_env->params, cur_env->num_params,
+        params, num_params, pp_compact);
+    if (r != 0) {
+        _zdtm_free_params(cur_env, params, num_params);
+        return -3;
+    }
+
+    _zdtm_free_params(cur_env, params, num_params);
+
+    if (cur_env->journal != NULL) {
+        r = _zdtm_journal_mark(cur_env->journal, ZDTM_JOURNAL_OBTAINED,
+            sync_id);
+        if (r != 0) {
+            free(*pp_compact);
+            (*pp_compact) = NULL;
+            return -5;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Get session schema.
+ *
+ * The _zdtm_session_schema function builds the schema of the parameter
+ * format of the session the first time it is needed, obtaining the
+ * format if it has not been yet.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully built the schema, or had it already.
+ * @retval -1 Failed to obtain the parameter format.
+ * @retval -2 Failed to allocate memory for the schema.
+ */
+static int _zdtm_session_schema(zdtm_lib_env *cur_env) {
+    zdtm_schema *p_schema;
+
+    if (cur_env->schema != NULL) {
+        return 0;
+    }
+
+    if ((cur_env->params == NULL) &&
+        (_zdtm_obtain_param_format(cur_env) != 0)) {
+        return -1;
+    }
 
-    memset(&rmsg, 0, sizeof(zdtm_msg));
-    r = _zdtm_wrapped_recv_message(cur_env, &rmsg);
-    if (r != 0) { _zdtm_clean_message(&rmsg); return -2; }
+    p_schema = malloc(sizeof(zdtm_schema));
+    if (p_schema == NULL) {
+        return -2;
+    }
+    if (zdtm_schema_init(p_schema, cur_env->params,
+            cur_env->num_params) != 0) {
+        free(p_schema);
+        return -2;
+    }
+    cur_env->schema = p_schema;
 
-    if (memcmp(rmsg.body.type, AEX_MSG_TYPE, MSG_TYPE_SIZE) != 0) {
-        _zdtm_clean_message(&rmsg);
+    return 0;
+}
+
+int zdtm_obtain_record(zdtm_lib_env *cur_env, uint32_t sync_id,
+    zdtm_record *p_rec) {
+
+    int r;
+    struct zdtm_adr_msg_param *params;
+    uint16_t num_params;
+
+    r = _zdtm_session_schema(cur_env);
+    if (r != 0) {
+        return _zdtm_timeout_result(cur_env, -1);
+    }
+
+    r = _zdtm_obtain_item(cur_env, sync_id, &params, &num_params);
+    if (r != 0) {
+        return _zdtm_timeout_result(cur_env, -2);
+    }
+
+    if (cur_env->mirror != NULL) {
+        r = zdtm_mirror_put(cur_env->mirror, cur_env->sync_type, sync_id,
+            params, num_params);
+        if (r != 0) {
+            _zdtm_free_params(cur_env, params, num_params);
+            return -4;
+        }
+    }
+
+    r = zdtm_record_from_params(cur_env->schema, params, num_params, p_rec);
+    _zdtm_free_params(cur_env, params, num_params);
+    if (r != 0) {
         return -3;
     }
+    p_rec->sync_id = sync_id;
 
-    _zdtm_clean_message(&rmsg);
+    if (cur_env->journal != NULL) {
+        r = _zdtm_journal_mark(cur_env->journal, ZDTM_JOURNAL_OBTAINED,
+            sync_id);
+        if (r != 0) {
+            zdtm_record_free(p_rec);
+            return -5;
+        }
+    }
 
     return 0;
 }
 
-int zdtm_terminate_sync(zdtm_lib_env *cur_env) {
+/**
+ * Store lazy item in mirror.
+ *
+ * The _zdtm_mirror_put_lazy function stores a lazy item in the mirror
+ * store by params pointing into its raw content, so that none of the
+ * data of the item is copied.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param sync_id The sync id of the item.
+ * @param p_item Pointer to the lazy item to store.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully stored the item.
+ * @retval -1 Failed to allocate memory for the params.
+ * @retval -2 Failed to store the item in the mirror store.
+ */
+static int _zdtm_mirror_put_lazy(zdtm_lib_env *cur_env, uint32_t sync_id,
+    const zdtm_lazy_item *p_item) {
+
+    struct zdtm_adr_msg_param *params;
+    const unsigned char *p;
+    uint16_t num_params, i;
     int r;
-    zdtm_msg msg, rmsg;
 
-    /* send RQT message */
-    memset(&msg, 0, sizeof(zdtm_msg));
-    memcpy(msg.body.type, RQT_MSG_TYPE, MSG_TYPE_SIZE);
-    memset(msg.body.cont.rqt.null_bytes, 0,
-        sizeof(msg.body.cont.rqt.null_bytes));
+    num_params = p_item->schema->num_params;
+    params = malloc(sizeof(struct zdtm_adr_msg_param) * num_params);
+    if ((params == NULL) && (num_params != 0)) {
+        return -1;
+    }
 
-    r = _zdtm_wrapped_send_message(cur_env, &msg);
-    if (r != 0) { return -1; }
+    p = p_item->buf + 2 + sizeof(uint16_t);
+    for (i = 0; i < num_params; i++) {
+        params[i].param_len = zdtm_get_le32(p);
+        params[i].param_data = (unsigned char *)p + sizeof(uint32_t);
+        p += sizeof(uint32_t) + params[i].param_len;
+    }
 
-    memset(&rmsg, 0, sizeof(zdtm_msg));
-    r = _zdtm_wrapped_recv_message(cur_env, &rmsg);
-    _zdtm_clean_message(&rmsg);
-    if (r != 0) { return -2; }
+    r = zdtm_mirror_put(cur_env->mirror, cur_env->sync_type, sync_id,
+        params, num_params);
+    free(params);
+    if (r != 0) {
+        return -2;
+    }
+
+    return 0;
+}
+
+int zdtm_obtain_lazy_item(zdtm_lib_env *cur_env, uint32_t sync_id,
+    zdtm_lazy_item *p_item) {
+
+    int r;
+    void *buf;
+    uint16_t size;
+
+    r = _zdtm_session_schema(cur_env);
+    if (r != 0) {
+        return _zdtm_timeout_result(cur_env, -1);
+    }
+
+    r = _zdtm_obtain_raw_item(cur_env, sync_id, &buf, &size);
+    if (r != 0) {
+        return _zdtm_timeout_result(cur_env, -2);
+    }
+
+    r = zdtm_lazy_item_attach(p_item, cur_env->schema, buf, size);
+    if (r != 0) {
+        free(buf);
+        return -3;
+    }
+    p_item->sync_id = sync_id;
+
+    if (cur_env->mirror != NULL) {
+        r = _zdtm_mirror_put_lazy(cur_env, sync_id, p_item);
+        if (r != 0) {
+            return -4;
+        }
+    }
 
-    /* recv rqst message */
-    memset(&rmsg, 0, sizeof(zdtm_msg));
-    r = _zdtm_recv_message(cur_env, &rmsg);
-    if (r != 2) { _zdtm_clean_message(&rmsg); return -3; }
+    if (cur_env->journal != NULL) {
+        r = _zdtm_journal_mark(cur_env->journal, ZDTM_JOURNAL_OBTAINED,
+            sync_id);
+        if (r != 0) {
+            return -5;
+        }
+    }
+
+    return 0;
+}
+
+int zdtm_write_records(zdtm_lib_env *cur_env, const zdtm_record *p_records,
+    uint16_t num_records, uint32_t *p_sync_ids) {
+
+    int r, i;
+
+    r = _zdtm_session_schema(cur_env);
+    if (r != 0) {
+        return _zdtm_timeout_result(cur_env, -1);
+    }
+
+    for (i = 0; i < num_records; i++) {
+        if ((p_records[i].schema == NULL) ||
+            (p_records[i].schema->params != cur_env->params)) {
+            return -1;
+        }
+    }
+
+    r = _zdtm_write_items(cur_env, RDW_VAR_RECORD, p_records,
+        sizeof(zdtm_record), num_records, p_sync_ids);
+    if (r != 0) {
+        return _zdtm_timeout_result(cur_env, -2);
+    }
+
+    return 0;
+}
+
+int zdtm_write_todo_items(zdtm_lib_env *cur_env,
+    const struct zdtm_todo_item *p_items, uint16_t num_items,
+    uint32_t *p_sync_ids) {
 
-    /* send RAY message */
-    memset(&msg, 0, sizeof(zdtm_msg));
-    memcpy(msg.body.type, RAY_MSG_TYPE, MSG_TYPE_SIZE);
-    r = _zdtm_send_message(cur_env, &msg);
-    if (r != 0) { return -4; }
+    int r;
+
+    if (cur_env->sync_type != SYNC_TYPE_TODO) {
+        return -1;
+    }
+
+    r = _zdtm_write_items(cur_env, RDW_VAR_FORMAT, p_items,
+        sizeof(struct zdtm_todo_item), num_items, p_sync_ids);
+    if (r != 0) {
+        return _zdtm_timeout_result(cur_env, -2);
+    }
+
+    return 0;
+}
+
+int zdtm_write_calendar_items(zdtm_lib_env *cur_env,
+    const struct zdtm_calendar_item *p_items, uint16_t num_items,
+    uint32_t *p_sync_ids) {
+
+    int r;
+
+    if (cur_env->sync_type != SYNC_TYPE_CALENDAR) {
+        return -1;
+    }
+
+    r = _zdtm_write_items(cur_env, RDW_VAR_FORMAT, p_items,
+        sizeof(struct zdtm_calendar_item), num_items, p_sync_ids);
+    if (r != 0) {
+        return _zdtm_timeout_result(cur_env, -2);
+    }
+
+    return 0;
+}
+
+int zdtm_write_address_items(zdtm_lib_env *cur_env,
+    const struct zdtm_address_item *p_items, uint16_t num_items,
+    uint32_t *p_sync_ids) {
+
+    int r;
+
+    if (cur_env->sync_type != SYNC_TYPE_ADDRESS) {
+        return -1;
+    }
+
+    r = _zdtm_write_items(cur_env, RDW_VAR_FORMAT, p_items,
+        sizeof(struct zdtm_address_item), num_items, p_sync_ids);
+    if (r != 0) {
+        return _zdtm_timeout_result(cur_env, -2);
+    }
+
+    return 0;
+}
+
+int zdtm_delete_item(zdtm_lib_env *cur_env, uint32_t sync_id) {
+    zdtm_core core;
+    int r;
+
+    /* An item deleted by the interrupted synchronization this one
+     * resumes is not deleted on the Zaurus again. */
+    if ((cur_env->journal == NULL) ||
+        (zdtm_journal_state(cur_env->journal, sync_id) !=
+        ZDTM_JOURNAL_DELETED)) {
+        _zdtm_core_init(&core, cur_env);
+        core.sync_id = sync_id;
+        r = _zdtm_run_step(cur_env, &core, _zdtm_step_delete_item);
+        _zdtm_core_cleanup(&core);
+        if (r != 0) { return _zdtm_timeout_result(cur_env, r); }
+
+        if (cur_env->journal != NULL) {
+            r = _zdtm_journal_mark(cur_env->journal, ZDTM_JOURNAL_DELETED,
+                sync_id);
+            if (r != 0) { return -5; }
+        }
+    }
+
+    if (cur_env->mirror != NULL) {
+        r = zdtm_mirror_delete(cur_env->mirror, cur_env->sync_type, sync_id);
+        if (r < 0) { return -4; }
+    }
+
+    return 0;
+}
+
+int zdtm_terminate_sync(zdtm_lib_env *cur_env) {
+    zdtm_core core;
+    int r;
+
+    /* send RQT message, and RAY message once asked for it */
+    _zdtm_core_init(&core, cur_env);
+    r = _zdtm_run_step(cur_env, &core, _zdtm_step_terminate);
+    _zdtm_core_cleanup(&core);
+    if (r != 0) { return _zdtm_timeout_result(cur_env, r); }
+
+    /* The synchronization is complete, there is nothing to resume. */
+    if (cur_env->journal != NULL) {
+        r = _zdtm_journal_finish(cur_env->journal);
+        if (r != 0) { return -6; }
+    }
 
     /* close connection from the Zaurus */
     r = _zdtm_disconnect(cur_env);
@@ -515,8 +1016,14 @@ int zdtm_terminate_sync(zdtm_lib_env *cur_env) {
 int zdtm_finalize(zdtm_lib_env *cur_env) {
     int r, i;
 
-    r = _zdtm_stop_listening(cur_env);
-    if (r != 0) { return -2; }
+    /* A listener handed to zdtm_initialize_listener is left open for
+     * whoever handed it down, along with the connections queued on it. */
+    if (cur_env->own_listener) {
+        r = _zdtm_stop_listening(cur_env);
+        if (r != 0) { return -2; }
+        cur_env->own_listener = 0;
+    }
+    cur_env->listenfd = INVALID_SOCKET;
 
     r = _zdtm_close_log(cur_env);
     if (r != 0) { return -1; }
@@ -528,6 +1035,16 @@ int zdtm_finalize(zdtm_lib_env *cur_env) {
         free(cur_env->params);
     }
 
+    if (cur_env->schema != NULL) {
+        zdtm_schema_free(cur_env->schema);
+        free(cur_env->schema);
+    }
+
+    if (cur_env->categories != NULL) {
+        zdtm_category_table_free(cur_env->categories);
+        free(cur_env->categories);
+    }
+
     if (cur_env->passcode != NULL) {
         free(cur_env->passcode);
     }
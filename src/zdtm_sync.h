@@ -40,6 +40,17 @@ extern "C" {
 #include "zdtm_types.h"
 #include "zdtm_proto.h"
 #include "zdtm_log.h"
+#include "zdtm_iter.h"
+#include "zdtm_dtm.h"
+#include "zdtm_mirror.h"
+#include "zdtm_journal.h"
+#include "zdtm_reconcile.h"
+#include "zdtm_idset.h"
+#include "zdtm_record.h"
+#include "zdtm_compact.h"
+#include "zdtm_category.h"
+#include "zdtm_fleet.h"
+#include "zdtm_discover.h"
 
 /**
  * Initialize the library.
@@ -48,15 +59,115 @@ extern "C" {
  * to be used by all other lib_zdtm_sync API functions as well as
  * putting the library in a state of listening for a connection from the
  * Zaurus. Note: Any connections made to the library are queued until
- * the zdtm_connect() function is called.
+ * the zdtm_connect() function is called. The log of the environment is
+ * appended to $HOME/.lib_zdtm_sync.log, which is only opened once there
+ * is something to log, unless another sink is set with one of the
+ * zdtm_set_log_* functions.
  * @param cur_env Pointer to the current zdtm library environment.
  * @return An integer representing success (zero) or failure (non-zero).
  * @retval 0 Successfully initialized library environment.
- * @retval -1 Failed to open log file.
  * @retval -2 Failed to listen for Zaurus connections.
  */
 ZDTM_EXPORT int zdtm_initialize(zdtm_lib_env *cur_env);
 
+/**
+ * Initialize the library over a transport.
+ *
+ * The zdtm_initialize_transport function does the same as the
+ * zdtm_initialize function, except that all the connections of the
+ * synchronization are made over the given transport rather than over
+ * TCP/IP. Note: The transport must outlive the environment.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param p_tp Pointer to the transport to use, NULL for TCP/IP.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully initialized library environment.
+ * @retval -2 Failed to listen for Zaurus connections.
+ */
+ZDTM_EXPORT int zdtm_initialize_transport(zdtm_lib_env *cur_env,
+    zdtm_transport *p_tp);
+
+/**
+ * Initialize the library with a listener.
+ *
+ * The zdtm_initialize_listener function does the same as the
+ * zdtm_initialize_transport function, except that the environment
+ * does not create the listener the Zaurus connects back to. Rather it
+ * adopts the given one, already bound and listening on DLISTPORT, such
+ * as one obtained by zdtm_listen_fds() or handed down by a supervisor.
+ * The adopted listener is left open by zdtm_finalize(), along with any
+ * connection queued on it, so that it may be handed to the next
+ * environment, or process, right away. If listenfd is INVALID_SOCKET
+ * the listener is instead created by the first zdtm_initiate_sync()
+ * call, and closed by zdtm_finalize().
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param p_tp Pointer to the transport to use, NULL for TCP/IP.
+ * @param listenfd The listener to adopt, INVALID_SOCKET to defer it.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully initialized library environment.
+ */
+ZDTM_EXPORT int zdtm_initialize_listener(zdtm_lib_env *cur_env,
+    zdtm_transport *p_tp, SOCKET listenfd);
+
+/**
+ * Set the log file.
+ *
+ * The zdtm_set_log_file function has the log of the environment
+ * appended to the file at path from now on, rather than to its current
+ * sink. A NULL path goes back to the default $HOME/.lib_zdtm_sync.log
+ * file. Environments used at the same time should each be given a log
+ * of their own. Note: The log sink is reset by zdtm_initialize().
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param path The path of the log file, NULL for the default one.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully set the log file.
+ * @retval -1 Failed to open the log file, the log sink is unchanged.
+ */
+ZDTM_EXPORT int zdtm_set_log_file(zdtm_lib_env *cur_env, const char *path);
+
+/**
+ * Set the log descriptor.
+ *
+ * The zdtm_set_log_fd function has the log of the environment written
+ * to the given descriptor from now on. The descriptor belongs to the
+ * caller and must stay open until the environment is finalized or
+ * given another log sink.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param fd The descriptor to write the log to.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully set the log descriptor.
+ * @retval -1 Failed to close the previous log file.
+ */
+ZDTM_EXPORT int zdtm_set_log_fd(zdtm_lib_env *cur_env, int fd);
+
+/**
+ * Set the log function.
+ *
+ * The zdtm_set_log_func function has the log of the environment handed
+ * to the given function from now on, along with arg. The function is
+ * called from whichever thread is using the environment.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param func The function to hand the log to.
+ * @param arg The argument to hand to func along with the log.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully set the log function.
+ * @retval -1 Failed to close the previous log file.
+ * @retval -2 Failed, func is NULL.
+ */
+ZDTM_EXPORT int zdtm_set_log_func(zdtm_lib_env *cur_env, zdtm_log_func func,
+    void *arg);
+
+/**
+ * Discard the log.
+ *
+ * The zdtm_set_log_none function has the log of the environment
+ * discarded from now on, which also spares building it.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully discarded the log.
+ * @retval -1 Failed to close the previous log file.
+ */
+ZDTM_EXPORT int zdtm_set_log_none(zdtm_lib_env *cur_env);
+
 /**
  * Set the Zaurus IP address.
  *
@@ -73,6 +184,28 @@ ZDTM_EXPORT int zdtm_initialize(zdtm_lib_env *cur_env);
  */
 ZDTM_EXPORT int zdtm_set_zaurus_ip(zdtm_lib_env *cur_env, char *ip_addr);
 
+/**
+ * Set the connection deadlines.
+ *
+ * The zdtm_set_timeouts function sets how long the synchronization
+ * waits on its connections before giving up on the Zaurus: connecting
+ * to it, awaiting its connection back, and each single read or write
+ * thereafter. A negative value waits for as long as it takes, which is
+ * the default. The I/O deadline applies in full to connections made
+ * after it was set. Once a deadline is missed the functions of the
+ * synchronization return RET_CONNECT_TIMEOUT, RET_ACCEPT_TIMEOUT or
+ * RET_IO_TIMEOUT respectively, rather than their own failure values,
+ * until the next synchronization is initiated.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param connect_ms Milliseconds to connect to the Zaurus.
+ * @param accept_ms Milliseconds to await the connection of the Zaurus.
+ * @param io_ms Milliseconds to await each read or write.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully set the deadlines.
+ */
+ZDTM_EXPORT int zdtm_set_timeouts(zdtm_lib_env *cur_env, int connect_ms,
+    int accept_ms, int io_ms);
+
 /**
  * Set the Synchronization type.
  *
@@ -88,6 +221,30 @@ ZDTM_EXPORT int zdtm_set_zaurus_ip(zdtm_lib_env *cur_env, char *ip_addr);
  */
 ZDTM_EXPORT int zdtm_set_sync_type(zdtm_lib_env *cur_env, unsigned int type);
 
+/**
+ * Set category sharing.
+ *
+ * The zdtm_set_category_sharing function sets whether the items built
+ * by zdtm_obtain_todo_item(), zdtm_obtain_calendar_item(), and
+ * zdtm_obtain_address_item() share their categories. Whether or not
+ * they do, the category of every such item is interned in a table kept
+ * for the session, which gives each distinct category a small ID that
+ * is stored in the category_id member of the item, ZDTM_CATEGORY_NONE
+ * being the empty category. When items share their categories their
+ * category member points at the single payload the table holds for it
+ * rather than at a copy of their own, hence it must neither be changed
+ * nor freed, and it is valid until zdtm_finalize() is called. By
+ * default these items do not share their categories, so that callers
+ * which free the category of an item keep working. Items yielded by
+ * zdtm_item_iter_next() always share their categories regardless of
+ * this setting.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param share Flag stating if obtained items share their categories.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully set category sharing.
+ */
+ZDTM_EXPORT int zdtm_set_category_sharing(zdtm_lib_env *cur_env, int share);
+
 /**
  * Set the Passcode.
  *
@@ -118,6 +275,11 @@ ZDTM_EXPORT int zdtm_set_passcode(zdtm_lib_env *cur_env, char *passcode);
  * @retval -5 The Zaurus IP address has not been set yet.
  * @retval -6 Failed to connect to the Zaurus.
  * @retval -7 The synchronization type has not been set yet.
+ * @retval -17 Failed to read or start the checkpoint journal.
+ * @retval -18 Failed to create the deferred listener.
+ * @retval RET_CONNECT_TIMEOUT Not connected to the Zaurus in time.
+ * @retval RET_ACCEPT_TIMEOUT The Zaurus did not connect back in time.
+ * @retval RET_IO_TIMEOUT The Zaurus did not answer in time.
  */
 ZDTM_EXPORT int zdtm_initiate_sync(zdtm_lib_env *cur_env);
 
@@ -174,6 +336,8 @@ ZDTM_EXPORT int zdtm_requires_slow_sync(zdtm_lib_env *cur_env);
  * @retval -2 Failed to recv response message.
  * @retval -3 Failed, response message is NOT an ASY message.
  * @retval -4 Failed to allocate memory for ID lists.
+ * @retval -5 Failed to drop the deleted items from the mirror store.
+ * @retval -6 Failed to read or record the lists in the checkpoint journal.
  */
 ZDTM_EXPORT int zdtm_obtain_sync_id_lists(zdtm_lib_env *cur_env,
     uint32_t **pp_new_sync_ids, uint16_t *p_num_new_sync_ids,
@@ -195,10 +359,31 @@ ZDTM_EXPORT int zdtm_obtain_sync_id_lists(zdtm_lib_env *cur_env,
  * @retval -1 Failed, current environment is not set to Todo sync type.
  * @retval -2 Failed to obtain item data from the Zaurus.
  * @retval -3 Failed to build zdtm_todo_item struct from item data.
+ * @retval -4 Failed to store the item data in the mirror store.
+ * @retval -5 Failed to record the item in the checkpoint journal.
+ * @retval -6 Failed to intern the category of the item.
  * */
 ZDTM_EXPORT int zdtm_obtain_todo_item(zdtm_lib_env *cur_env,
     uint32_t sync_id, struct zdtm_todo_item *p_todo_item);
 
+/**
+ * Look up category.
+ *
+ * The zdtm_lookup_category function looks up the payload of a category
+ * given the category ID of an item obtained in the session, see
+ * zdtm_set_category_sharing().
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param category_id The category ID of the item.
+ * @param pp_data Pointer to store the address of the payload in, which
+ * must neither be changed nor freed.
+ * @param p_len Pointer to store the length of the payload in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully looked up the category.
+ * @retval -1 Failed, no category of that ID was obtained in the session.
+ */
+ZDTM_EXPORT int zdtm_lookup_category(zdtm_lib_env *cur_env,
+    uint16_t category_id, const unsigned char **pp_data, uint32_t *p_len);
+
 /**
  * Obtain Calendar Item.
  *
@@ -214,6 +399,9 @@ ZDTM_EXPORT int zdtm_obtain_todo_item(zdtm_lib_env *cur_env,
  * @retval -1 Failed, current environment is not set to Calendar sync type.
  * @retval -2 Failed to obtain item data from the Zaurus.
  * @retval -3 Failed to build zdtm_calendar_item struct from item data.
+ * @retval -4 Failed to store the item data in the mirror store.
+ * @retval -5 Failed to record the item in the checkpoint journal.
+ * @retval -6 Failed to intern the category of the item.
  * */
 ZDTM_EXPORT int zdtm_obtain_calendar_item(zdtm_lib_env *cur_env,
     uint32_t sync_id, struct zdtm_calendar_item *p_calendar_item);
@@ -233,10 +421,185 @@ ZDTM_EXPORT int zdtm_obtain_calendar_item(zdtm_lib_env *cur_env,
  * @retval -1 Failed, current environment is not set to Address sync type.
  * @retval -2 Failed to obtain item data from the Zaurus.
  * @retval -3 Failed to build zdtm_address_item struct from item data.
+ * @retval -4 Failed to store the item data in the mirror store.
+ * @retval -5 Failed to record the item in the checkpoint journal.
+ * @retval -6 Failed to intern the category of the item.
  * */
 ZDTM_EXPORT int zdtm_obtain_address_item(zdtm_lib_env *cur_env,
     uint32_t sync_id, struct zdtm_address_item *p_address_item);
 
+/**
+ * Obtain Compact Address Item.
+ *
+ * The zdtm_obtain_compact_address function attempts to obtain the data
+ * for a Address item given a sync id and build a compact Address item
+ * to represent it, whose strings are all held in a single allocation
+ * rather than one each as zdtm_obtain_address_item() does.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param sync_id The sync id of the item to obtain.
+ * @param pp_compact Pointer to store the pointer to the compact Address
+ * item in, which must be freed using the free() function.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully obtained Address item.
+ * @retval -1 Failed, current environment is not set to Address sync type.
+ * @retval -2 Failed to obtain item data from the Zaurus.
+ * @retval -3 Failed to build the compact Address item from item data.
+ * @retval -4 Failed to store the item data in the mirror store.
+ * @retval -5 Failed to record the item in the checkpoint journal.
+ * */
+ZDTM_EXPORT int zdtm_obtain_compact_address(zdtm_lib_env *cur_env,
+    uint32_t sync_id, zdtm_compact_address **pp_compact);
+
+/**
+ * Obtain Record.
+ *
+ * The zdtm_obtain_record function attempts to obtain the data for an
+ * item of the current sync type as a record, which keeps every
+ * parameter of the format of the session, including those the item
+ * structures have no member for. The record is laid out by the schema
+ * of the session, which is built along with the first record.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param sync_id The sync id of the item to obtain.
+ * @param p_rec Pointer to the record to store the item in, which is
+ * initialized with zdtm_record_init() and freed with zdtm_record_free().
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully obtained the record.
+ * @retval -1 Failed to build the schema of the session.
+ * @retval -2 Failed to obtain item data from the Zaurus.
+ * @retval -3 Failed to build the record from item data.
+ * @retval -4 Failed to store the item data in the mirror store.
+ * @retval -5 Failed to record the item in the checkpoint journal.
+ * */
+ZDTM_EXPORT int zdtm_obtain_record(zdtm_lib_env *cur_env,
+    uint32_t sync_id, zdtm_record *p_rec);
+
+/**
+ * Obtain Lazy Item.
+ *
+ * The zdtm_obtain_lazy_item function attempts to obtain the data for an
+ * item of the current sync type as a lazy item, which keeps the raw
+ * content of the ADR message and decodes none of it up front. Checking
+ * a few fields of the item, such as its SYID, MDTM, and ATTR, with
+ * zdtm_lazy_item_get() then allocates no memory at all, whereas the
+ * other obtain functions copy every field. Unless a mirror store is
+ * set the raw content received is the only memory the item takes.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param sync_id The sync id of the item to obtain.
+ * @param p_item Pointer to the lazy item to store the item in, which is
+ * initialized with zdtm_lazy_item_init() and freed with
+ * zdtm_lazy_item_free(). On failure it is left unchanged, unless the
+ * item was obtained but could not be stored or recorded (-4 and -5).
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully obtained the lazy item.
+ * @retval -1 Failed to build the schema of the session.
+ * @retval -2 Failed to obtain item data from the Zaurus.
+ * @retval -3 Failed, the item data does not match the format.
+ * @retval -4 Failed to store the item data in the mirror store.
+ * @retval -5 Failed to record the item in the checkpoint journal.
+ * */
+ZDTM_EXPORT int zdtm_obtain_lazy_item(zdtm_lib_env *cur_env,
+    uint32_t sync_id, zdtm_lazy_item *p_item);
+
+/**
+ * Write Records.
+ *
+ * The zdtm_write_records function attempts to write the given records
+ * to the Zaurus, adding those whose sync id is zero and replacing the
+ * others. Every field of a record is written back as it is, so that
+ * the parameters the library knows nothing of are kept. The first RDW
+ * message carries a single record, and the number of records packed
+ * into the next ones doubles as long as the Zaurus takes them all.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param p_records Pointer to the array of records to write, which must
+ * be laid out by the schema of the session.
+ * @param num_records The number of records in the array.
+ * @param p_sync_ids Pointer to num_records entries to store the sync
+ * id the Zaurus assigned to each record in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully wrote the records.
+ * @retval -1 Failed, a record is not laid out by the schema of the
+ * session, or the schema could not be built.
+ * @retval -2 Failed to write the records to the Zaurus.
+ * */
+ZDTM_EXPORT int zdtm_write_records(zdtm_lib_env *cur_env,
+    const zdtm_record *p_records, uint16_t num_records,
+    uint32_t *p_sync_ids);
+
+/**
+ * Write Todo Items.
+ *
+ * The zdtm_write_todo_items function attempts to write the given Todo
+ * items to the Zaurus, adding those whose sync id is zero and
+ * replacing the others. The items are laid out by the parameter format
+ * of the session, the parameters the item structure has no field for
+ * being written empty. Replacing an item this way hence clears those
+ * parameters on the Zaurus, which zdtm_write_records() keeps. The first
+ * RDW message carries a single item, and the number of items packed
+ * into the next ones doubles as long as the Zaurus takes them all.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param p_items Pointer to the array of items to write.
+ * @param num_items The number of items in the array.
+ * @param p_sync_ids Pointer to num_items entries to store the sync id
+ * the Zaurus assigned to each item in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully wrote the Todo items.
+ * @retval -1 Failed, current environment is not set to Todo sync type.
+ * @retval -2 Failed to write the items to the Zaurus.
+ * */
+ZDTM_EXPORT int zdtm_write_todo_items(zdtm_lib_env *cur_env,
+    const struct zdtm_todo_item *p_items, uint16_t num_items,
+    uint32_t *p_sync_ids);
+
+/**
+ * Write Calendar Items.
+ *
+ * The zdtm_write_calendar_items function attempts to write the given Calendar
+ * items to the Zaurus, adding those whose sync id is zero and
+ * replacing the others. The items are laid out by the parameter format
+ * of the session, the parameters the item structure has no field for
+ * being written empty. Replacing an item this way hence clears those
+ * parameters on the Zaurus, which zdtm_write_records() keeps. The first
+ * RDW message carries a single item, and the number of items packed
+ * into the next ones doubles as long as the Zaurus takes them all.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param p_items Pointer to the array of items to write.
+ * @param num_items The number of items in the array.
+ * @param p_sync_ids Pointer to num_items entries to store the sync id
+ * the Zaurus assigned to each item in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully wrote the Calendar items.
+ * @retval -1 Failed, current environment is not set to Calendar sync type.
+ * @retval -2 Failed to write the items to the Zaurus.
+ * */
+ZDTM_EXPORT int zdtm_write_calendar_items(zdtm_lib_env *cur_env,
+    const struct zdtm_calendar_item *p_items, uint16_t num_items,
+    uint32_t *p_sync_ids);
+
+/**
+ * Write Address Items.
+ *
+ * The zdtm_write_address_items function attempts to write the given Address
+ * items to the Zaurus, adding those whose sync id is zero and
+ * replacing the others. The items are laid out by the parameter format
+ * of the session, the parameters the item structure has no field for
+ * being written empty. Replacing an item this way hence clears those
+ * parameters on the Zaurus, which zdtm_write_records() keeps. The first
+ * RDW message carries a single item, and the number of items packed
+ * into the next ones doubles as long as the Zaurus takes them all.
+ * @param cur_env Pointer to the current zdtm library environment.
+ * @param p_items Pointer to the array of items to write.
+ * @param num_items The number of items in the array.
+ * @param p_sync_ids Pointer to num_items entries to store the sync id
+ * the Zaurus assigned to each item in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully wrote the Address items.
+ * @retval -1 Failed, current environment is not set to Address sync type.
+ * @retval -2 Failed to write the items to the Zaurus.
+ * */
+ZDTM_EXPORT int zdtm_write_address_items(zdtm_lib_env *cur_env,
+    const struct zdtm_address_item *p_items, uint16_t num_items,
+    uint32_t *p_sync_ids);
+
 /**
  * Delete Item.
  *
@@ -250,6 +613,8 @@ ZDTM_EXPORT int zdtm_obtain_address_item(zdtm_lib_env *cur_env,
  * @retval -1 Failed to sent the RDD message.
  * @retval -2 Failed to recv the response message.
  * @retval -3 Failed, response message received was NOT an AEX message.
+ * @retval -4 Failed to delete the item from the mirror store.
+ * @retval -5 Failed to record the deletion in the checkpoint journal.
  */
 ZDTM_EXPORT int zdtm_delete_item(zdtm_lib_env *cur_env, uint32_t sync_id);
 
@@ -268,6 +633,7 @@ ZDTM_EXPORT int zdtm_delete_item(zdtm_lib_env *cur_env, uint32_t sync_id);
  * @retval -3 Failed to receive request message from the Zaurus.
  * @retval -4 Failed to send RAY message to the Zaurus.
  * @retval -5 Failed to close TCP/IP connection from Zaurus.
+ * @retval -6 Failed to clear the checkpoint journal.
  */
 ZDTM_EXPORT int zdtm_terminate_sync(zdtm_lib_env *cur_env);
 
@@ -0,0 +1,1293 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+/**
+ * @file zdtm_transport.c
+ * @brief This is an implementation file for the connection transports.
+ *
+ * The zdtm_transport.c file is an implementation file for the TCP,
+ * socketpair, and memory transports shipped with lib_zdtm_sync.
+ */
+
+#include "zdtm_transport.h"
+
+#include <errno.h>
+#include <time.h>
+
+#ifndef WIN32
+#include <sys/uio.h>
+#include <poll.h>
+#include <fcntl.h>
+#endif
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+#ifdef HAVE_LINUX_FILTER_H
+#include <linux/filter.h>
+#endif
+
+// Most buffers handed to a single readv or writev operation.
+#define ZDTM_MAX_IOV 8
+
+// First descriptor handed down by socket activation.
+#define ZDTM_LISTEN_FDS_START 3
+
+// Flags used when writing to a socket. A Zaurus which went away must
+// fail the write rather than raise SIGPIPE.
+#ifdef MSG_NOSIGNAL
+#define ZDTM_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define ZDTM_SEND_FLAGS 0
+#endif
+
+// Whether the last socket call failed as it would have had to block,
+// and whether a non-blocking connect is still in progress.
+#ifdef WIN32
+#define ZDTM_WOULD_BLOCK (WSAGetLastError() == WSAEWOULDBLOCK)
+#define ZDTM_CONNECT_PENDING (WSAGetLastError() == WSAEWOULDBLOCK)
+#else
+#define ZDTM_WOULD_BLOCK ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+#define ZDTM_CONNECT_PENDING (errno == EINPROGRESS)
+#endif
+
+static int _zdtm_fd_poll(zdtm_transport *p_tp, SOCKET conn, int events,
+    int timeout_ms);
+
+/**
+ * Convert an address.
+ *
+ * The _zdtm_tcp_addr function fills in a TCP/IP socket address from a
+ * dotted-quad address and a port.
+ * @param p_sa Pointer to the socket address to fill in.
+ * @param addr The dotted-quad address, or NULL for any address.
+ * @param port The port.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully converted the address.
+ * @retval -1 Failed to convert the address.
+ */
+static int _zdtm_tcp_addr(struct sockaddr_in *p_sa, const char *addr,
+    uint16_t port) {
+
+    memset(p_sa, 0, sizeof(struct sockaddr_in));
+    p_sa->sin_family = AF_INET;
+    p_sa->sin_port = htons(port);
+
+    if (addr == NULL) {
+        p_sa->sin_addr.s_addr = htonl(INADDR_ANY);
+        return 0;
+    }
+
+#ifdef WIN32
+    p_sa->sin_addr.s_addr = inet_addr(addr);
+    if (p_sa->sin_addr.s_addr == INADDR_NONE) {
+        return -1;
+    }
+#else
+    if (inet_pton(AF_INET, addr, &p_sa->sin_addr) <= 0) {
+        return -1;
+    }
+#endif
+
+    return 0;
+}
+
+/**
+ * Close a socket.
+ *
+ * The _zdtm_close_socket function closes a socket or file descriptor.
+ * @param fd The socket to close.
+ * @return SOCKET_ERROR on failure, anything else on success.
+ */
+static int _zdtm_close_socket(SOCKET fd) {
+#ifdef WIN32
+    return closesocket(fd);
+#else
+    return close(fd);
+#endif
+}
+
+/**
+ * Disable Nagle's algorithm.
+ *
+ * The _zdtm_tcp_nodelay function disables Nagle's algorithm on a TCP
+ * connection. The protocol is made up of small rqst and ack messages
+ * which are often sent back to back, e.g. the ack of one message
+ * directly followed by the rqst for the next, which would otherwise be
+ * held back until the delayed ack of the previous segment arrives.
+ * @param fd The TCP connection.
+ */
+static void _zdtm_tcp_nodelay(SOCKET fd) {
+    int nodelay_flag;
+
+    nodelay_flag = 1;
+#ifdef WIN32
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY,
+        (const char *)&nodelay_flag, (socklen_t)sizeof(nodelay_flag));
+#else
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY,
+        (const void *)&nodelay_flag, (socklen_t)sizeof(nodelay_flag));
+#endif
+}
+
+/**
+ * Make a socket non-blocking.
+ *
+ * The _zdtm_fd_nonblock function switches a socket or file descriptor
+ * to non-blocking mode. It is the nonblock operation of the transports
+ * whose connections are file descriptors.
+ * @param p_tp Pointer to the transport.
+ * @param conn The socket.
+ * @return An integer representing success (zero) or failure (non-zero).
+ */
+static int _zdtm_fd_nonblock(zdtm_transport *p_tp, SOCKET conn) {
+#ifdef WIN32
+    u_long on;
+
+    on = 1;
+    if (ioctlsocket(conn, FIONBIO, &on) == SOCKET_ERROR) {
+        return -1;
+    }
+#else
+    int flags;
+
+    flags = fcntl(conn, F_GETFL, 0);
+    if ((flags < 0) || (fcntl(conn, F_SETFL, flags | O_NONBLOCK) < 0)) {
+        return -1;
+    }
+#endif
+
+    return 0;
+}
+
+/**
+ * Create listening socket.
+ *
+ * The _zdtm_tcp_listen_socket function creates a TCP socket bound to
+ * the given address and port and puts it into a listening state.
+ * @param addr The dotted-quad address, or NULL for any address.
+ * @param port The port.
+ * @param reuse_port Non-zero to let other sockets bind the same port.
+ * @param backlog Most connections to queue before they are accepted.
+ * @param p_listen Pointer to a SOCKET to store the listener in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully created the listener.
+ * @retval -1 Failed to create the socket.
+ * @retval -2 Failed to set the socket REUSEADDR or REUSEPORT option.
+ * @retval -3 Failed to bind the socket to the address and port.
+ * @retval -4 Failed to put socket into a listening state.
+ */
+static int _zdtm_tcp_listen_socket(const char *addr, uint16_t port,
+    int reuse_port, int backlog, SOCKET *p_listen) {
+
+    struct sockaddr_in servaddr;
+    SOCKET fd;
+    int retval;
+    int reuse_set_flag;
+
+    reuse_set_flag = 1;
+
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd == INVALID_SOCKET) {
+        return -1;
+    }
+
+    // Here I set a socket option so that if the applications ends
+    // prematurely the socket is not blocked by the TIME_WAIT state.
+#ifdef WIN32
+    retval = setsockopt(fd, SOL_SOCKET, SO_REUSEADDR,
+        (const char *)&reuse_set_flag, (socklen_t)sizeof(reuse_set_flag));
+#else
+    retval = setsockopt(fd, SOL_SOCKET, SO_REUSEADDR,
+        (const void *)&reuse_set_flag, (socklen_t)sizeof(reuse_set_flag));
+#endif
+    if (retval == SOCKET_ERROR) {
+        _zdtm_close_socket(fd);
+        return -2;
+    }
+
+    if (reuse_port) {
+#ifdef SO_REUSEPORT
+        retval = setsockopt(fd, SOL_SOCKET, SO_REUSEPORT,
+            (const void *)&reuse_set_flag,
+            (socklen_t)sizeof(reuse_set_flag));
+#else
+        retval = SOCKET_ERROR;
+#endif
+        if (retval == SOCKET_ERROR) {
+            _zdtm_close_socket(fd);
+            return -2;
+        }
+    }
+
+    if (_zdtm_tcp_addr(&servaddr, addr, port) != 0) {
+        _zdtm_close_socket(fd);
+        return -3;
+    }
+
+    retval = bind(fd, (struct sockaddr *)&servaddr,
+        (socklen_t)sizeof(servaddr));
+    if (retval == SOCKET_ERROR) {
+        _zdtm_close_socket(fd);
+        return -3;
+    }
+
+    retval = listen(fd, backlog);
+    if (retval == SOCKET_ERROR) {
+        _zdtm_close_socket(fd);
+        return -4;
+    }
+
+    (*p_listen) = fd;
+
+    return 0;
+}
+
+static int _zdtm_tcp_listen(zdtm_transport *p_tp, const char *addr,
+    uint16_t port, SOCKET *p_listen) {
+
+    return _zdtm_tcp_listen_socket(addr, port, 0, 1, p_listen);
+}
+
+static int _zdtm_tcp_connect(zdtm_transport *p_tp, const char *addr,
+    uint16_t port, int timeout_ms, SOCKET *p_conn) {
+
+    struct sockaddr_in servaddr;
+    SOCKET fd;
+    int retval, err;
+    socklen_t len;
+
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd == INVALID_SOCKET) {
+        return -1;
+    }
+
+    if ((addr == NULL) || (_zdtm_tcp_addr(&servaddr, addr, port) != 0)) {
+        _zdtm_close_socket(fd);
+        return -2;
+    }
+
+    if (timeout_ms < 0) {
+        retval = connect(fd, (struct sockaddr *)&servaddr,
+            sizeof(struct sockaddr));
+        if (retval == SOCKET_ERROR) {
+            _zdtm_close_socket(fd);
+            return -3;
+        }
+
+        _zdtm_tcp_nodelay(fd);
+        (*p_conn) = fd;
+        return 0;
+    }
+
+    /* With a deadline the connect is started without blocking and
+     * waited for with poll, the connection being left non-blocking. */
+    if (_zdtm_fd_nonblock(p_tp, fd) != 0) {
+        _zdtm_close_socket(fd);
+        return -1;
+    }
+
+    retval = connect(fd, (struct sockaddr *)&servaddr,
+        sizeof(struct sockaddr));
+    if ((retval == SOCKET_ERROR) && !ZDTM_CONNECT_PENDING) {
+        _zdtm_close_socket(fd);
+        return -3;
+    }
+
+    if (retval == SOCKET_ERROR) {
+        retval = _zdtm_fd_poll(p_tp, fd, ZDTM_POLL_OUT, timeout_ms);
+        if (retval == 0) {
+            _zdtm_close_socket(fd);
+            return ZDTM_TRANSPORT_TIMEOUT;
+        }
+
+        err = 0;
+        len = (socklen_t)sizeof(err);
+        if ((retval < 0) || (getsockopt(fd, SOL_SOCKET, SO_ERROR,
+                (zdtm_buf_t)&err, &len) == SOCKET_ERROR) || (err != 0)) {
+            _zdtm_close_socket(fd);
+            return -3;
+        }
+    }
+
+    _zdtm_tcp_nodelay(fd);
+
+    (*p_conn) = fd;
+
+    return 0;
+}
+
+static int _zdtm_tcp_accept(zdtm_transport *p_tp, SOCKET listen,
+    SOCKET *p_conn) {
+
+    struct sockaddr_in clntaddr;
+    socklen_t len;
+    SOCKET fd;
+
+    memset(&clntaddr, 0, sizeof(clntaddr));
+    len = sizeof(clntaddr);
+    fd = accept(listen, (struct sockaddr *)&clntaddr, &len);
+    if (fd == INVALID_SOCKET) {
+        return -1;
+    }
+
+    _zdtm_tcp_nodelay(fd);
+
+    (*p_conn) = fd;
+
+    return 0;
+}
+
+/* The remaining operations of the TCP transport work on any socket or
+ * file descriptor, hence they are shared with the socketpair transport
+ * whose connections are file descriptors as well. */
+
+static zdtm_ssize_t _zdtm_fd_readv(zdtm_transport *p_tp, SOCKET conn,
+    const struct zdtm_iovec *iov, int iovcnt) {
+
+#ifdef WIN32
+    /* Winsock has no readv, reading into the first buffer is enough as
+     * callers handle short reads. */
+    zdtm_ssize_t r;
+
+    r = recv(conn, (zdtm_buf_t)iov[0].base, iov[0].len, 0);
+    if ((r < 0) && ZDTM_WOULD_BLOCK) {
+        return ZDTM_TRANSPORT_AGAIN;
+    }
+    return r;
+#else
+    struct iovec vec[ZDTM_MAX_IOV];
+    struct msghdr mh;
+    zdtm_ssize_t r;
+    int i;
+
+    if (iovcnt > ZDTM_MAX_IOV) {
+        iovcnt = ZDTM_MAX_IOV;
+    }
+    for (i = 0; i < iovcnt; i++) {
+        vec[i].iov_base = iov[i].base;
+        vec[i].iov_len = iov[i].len;
+    }
+
+    memset(&mh, 0, sizeof(struct msghdr));
+    mh.msg_iov = vec;
+    mh.msg_iovlen = iovcnt;
+
+    do {
+        r = recvmsg(conn, &mh, 0);
+    } while ((r < 0) && (errno == EINTR));
+
+    if ((r < 0) && ZDTM_WOULD_BLOCK) {
+        return ZDTM_TRANSPORT_AGAIN;
+    }
+    return r;
+#endif
+}
+
+static zdtm_ssize_t _zdtm_fd_writev(zdtm_transport *p_tp, SOCKET conn,
+    const struct zdtm_iovec *iov, int iovcnt) {
+
+#ifdef WIN32
+    zdtm_ssize_t r;
+
+    r = send(conn, (const zdtm_buf_t)iov[0].base, iov[0].len, 0);
+    if ((r < 0) && ZDTM_WOULD_BLOCK) {
+        return ZDTM_TRANSPORT_AGAIN;
+    }
+    return r;
+#else
+    struct iovec vec[ZDTM_MAX_IOV];
+    struct msghdr mh;
+    zdtm_ssize_t r;
+    int i;
+
+    if (iovcnt > ZDTM_MAX_IOV) {
+        iovcnt = ZDTM_MAX_IOV;
+    }
+    for (i = 0; i < iovcnt; i++) {
+        vec[i].iov_base = iov[i].base;
+        vec[i].iov_len = iov[i].len;
+    }
+
+    memset(&mh, 0, sizeof(struct msghdr));
+    mh.msg_iov = vec;
+    mh.msg_iovlen = iovcnt;
+
+    do {
+        r = sendmsg(conn, &mh, ZDTM_SEND_FLAGS);
+    } while ((r < 0) && (errno == EINTR));
+
+    if ((r < 0) && ZDTM_WOULD_BLOCK) {
+        return ZDTM_TRANSPORT_AGAIN;
+    }
+    return r;
+#endif
+}
+
+static int _zdtm_fd_close(zdtm_transport *p_tp, SOCKET conn) {
+    if (_zdtm_close_socket(conn) == SOCKET_ERROR) {
+        return -1;
+    }
+
+    return 0;
+}
+
+static int _zdtm_fd_poll(zdtm_transport *p_tp, SOCKET conn, int events,
+    int timeout_ms) {
+
+#ifdef WIN32
+    fd_set rfds, wfds;
+    struct timeval tv;
+    int r;
+
+    FD_ZERO(&rfds);
+    FD_ZERO(&wfds);
+    if (events & ZDTM_POLL_IN) { FD_SET(conn, &rfds); }
+    if (events & ZDTM_POLL_OUT) { FD_SET(conn, &wfds); }
+    tv.tv_sec = timeout_ms / 1000;
+    tv.tv_usec = (timeout_ms % 1000) * 1000;
+
+    r = select(0, &rfds, &wfds, NULL, (timeout_ms < 0) ? NULL : &tv);
+    if (r == SOCKET_ERROR) {
+        return -1;
+    }
+
+    r = 0;
+    if (FD_ISSET(conn, &rfds)) { r |= ZDTM_POLL_IN; }
+    if (FD_ISSET(conn, &wfds)) { r |= ZDTM_POLL_OUT; }
+    return r;
+#else
+    struct pollfd pfd;
+    int r;
+
+    pfd.fd = conn;
+    pfd.events = 0;
+    pfd.revents = 0;
+    if (events & ZDTM_POLL_IN) { pfd.events |= POLLIN; }
+    if (events & ZDTM_POLL_OUT) { pfd.events |= POLLOUT; }
+
+    do {
+        r = poll(&pfd, 1, timeout_ms);
+    } while ((r < 0) && (errno == EINTR));
+    if (r < 0) {
+        return -1;
+    }
+
+    r = 0;
+    /* A failed or hung up connection is reported as ready, so that the
+     * following read or write reports what happened. */
+    if (pfd.revents & (POLLIN | POLLERR | POLLHUP)) {
+        r |= (events & ZDTM_POLL_IN);
+    }
+    if (pfd.revents & (POLLOUT | POLLERR | POLLHUP)) {
+        r |= (events & ZDTM_POLL_OUT);
+    }
+    return r;
+#endif
+}
+
+static zdtm_transport _zdtm_tcp = {
+    "tcp",
+    NULL,
+    _zdtm_tcp_listen,
+    _zdtm_tcp_connect,
+    _zdtm_tcp_accept,
+    _zdtm_fd_readv,
+    _zdtm_fd_writev,
+    _zdtm_fd_close,
+    _zdtm_fd_poll,
+    _zdtm_fd_nonblock,
+    NULL
+};
+
+zdtm_transport *zdtm_tcp_transport(void) {
+    return &_zdtm_tcp;
+}
+
+int zdtm_listen_fds(SOCKET *p_listenfd) {
+#ifdef WIN32
+    return 1;
+#else
+    const char *pid_env, *fds_env;
+    char *end;
+    unsigned long pid, num_fds;
+    int flags;
+
+    pid_env = getenv("LISTEN_PID");
+    fds_env = getenv("LISTEN_FDS");
+    if ((pid_env == NULL) || (fds_env == NULL)) {
+        return 1;
+    }
+
+    pid = strtoul(pid_env, &end, 10);
+    if ((*end != '\0') || (pid != (unsigned long)getpid())) {
+        return 1;
+    }
+    num_fds = strtoul(fds_env, &end, 10);
+    if ((*end != '\0') || (num_fds == 0)) {
+        return 1;
+    }
+
+    unsetenv("LISTEN_PID");
+    unsetenv("LISTEN_FDS");
+    unsetenv("LISTEN_FDNAMES");
+
+    /* The descriptors passed start right after stderr, and are not to
+     * leak into whatever the process goes on to run. */
+    flags = fcntl(ZDTM_LISTEN_FDS_START, F_GETFD);
+    if ((flags < 0) || (fcntl(ZDTM_LISTEN_FDS_START, F_SETFD,
+        flags | FD_CLOEXEC) < 0)) {
+        return -1;
+    }
+
+    (*p_listenfd) = ZDTM_LISTEN_FDS_START;
+
+    return 0;
+#endif
+}
+
+unsigned int zdtm_shard_of(const char *zaurus_ip, unsigned int num_shards) {
+    struct sockaddr_in sa;
+
+    if ((num_shards == 0) || (zaurus_ip == NULL) ||
+        (_zdtm_tcp_addr(&sa, zaurus_ip, 0) != 0)) {
+        return 0;
+    }
+
+    return (unsigned int)(ntohl(sa.sin_addr.s_addr) % num_shards);
+}
+
+#if defined(SO_ATTACH_REUSEPORT_CBPF) && defined(HAVE_LINUX_FILTER_H)
+
+/**
+ * Steer shard group.
+ *
+ * The _zdtm_steer_shards function attaches a socket filter to the
+ * SO_REUSEPORT group of the given listener which picks the listener of
+ * each new connection by its source address, the same way
+ * zdtm_shard_of() does. The kernel numbers the listeners of a group in
+ * the order they started listening, and moves the last listener into
+ * the place of one which is closed, hence the steering only holds while
+ * the whole group stays open.
+ * @param fd A listener of the group.
+ * @param num_shards The number of listeners in the group.
+ * @return An integer representing success (zero) or failure (non-zero).
+ */
+static int _zdtm_steer_shards(SOCKET fd, unsigned int num_shards) {
+    struct sock_filter code[] = {
+        // A = source address of the IPv4 header, in host order
+        { BPF_LD | BPF_W | BPF_ABS, 0, 0, (uint32_t)SKF_NET_OFF + 12 },
+        { BPF_ALU | BPF_MOD | BPF_K, 0, 0, 0 },
+        { BPF_RET | BPF_A, 0, 0, 0 }
+    };
+    struct sock_fprog prog;
+
+    code[1].k = num_shards;
+    prog.len = sizeof(code) / sizeof(code[0]);
+    prog.filter = code;
+
+    if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog,
+        (socklen_t)sizeof(prog)) == SOCKET_ERROR) {
+        return -1;
+    }
+
+    return 0;
+}
+
+#else
+
+static int _zdtm_steer_shards(SOCKET fd, unsigned int num_shards) {
+    return -1;
+}
+
+#endif
+
+int zdtm_listen_shards(const char *addr, uint16_t port,
+    unsigned int num_shards, int backlog, SOCKET *p_shards) {
+
+    unsigned int i, j;
+    int r;
+
+    if ((num_shards == 0) || (p_shards == NULL)) {
+        return -1;
+    }
+
+    if (backlog <= 0) {
+        backlog = SOMAXCONN;
+    }
+
+    for (i = 0; i < num_shards; i++) {
+        r = _zdtm_tcp_listen_socket(addr, port, 1, backlog, &p_shards[i]);
+        if (r != 0) {
+            for (j = 0; j < i; j++) {
+                _zdtm_close_socket(p_shards[j]);
+                p_shards[j] = INVALID_SOCKET;
+            }
+            return r - 1;
+        }
+    }
+
+    /* A single shard takes every connection, there is nothing to
+     * steer. */
+    if ((num_shards > 1) && (_zdtm_steer_shards(p_shards[0],
+        num_shards) != 0)) {
+        for (i = 0; i < num_shards; i++) {
+            _zdtm_close_socket(p_shards[i]);
+            p_shards[i] = INVALID_SOCKET;
+        }
+        return -6;
+    }
+
+    return 0;
+}
+
+#if defined(HAVE_PTHREAD_H) && !defined(WIN32)
+
+// Most connections waiting to be accepted by an in-process listener.
+#define ZDTM_INPROC_BACKLOG 16
+
+// Kinds of in-process ends.
+#define ZDTM_INPROC_FREE 0
+#define ZDTM_INPROC_LISTEN 1
+#define ZDTM_INPROC_CONN 2
+
+/**
+ * In-process end.
+ *
+ * The zdtm_inproc_end structure is a listener, or with the memory
+ * transport one end of a connection, of an in-process network.
+ */
+struct zdtm_inproc_end {
+    int kind;               // kind of end, ZDTM_INPROC_FREE if unused
+    SOCKET handle;          // handle the end is known by
+    uint16_t port;          // port a listener listens on
+    SOCKET backlog[ZDTM_INPROC_BACKLOG]; // connections to be accepted
+    int num_backlog;        // number of connections to be accepted
+    int peer;               // slot of the other end, -1 once closed
+    unsigned char *buf;     // bytes waiting to be read by this end
+    uint32_t head;          // offset of the first byte waiting in buf
+    uint32_t count;         // number of bytes waiting in buf
+    uint32_t cap;           // allocated size of buf
+};
+
+/**
+ * In-process network.
+ *
+ * The zdtm_inproc_net structure is the private data of the socketpair
+ * and memory transports. With the memory transport every end is a slot
+ * whose index is its handle. With the socketpair transport only the
+ * listeners are slots, their handle being an unconnected socket which
+ * serves to tell them apart from the connections.
+ */
+struct zdtm_inproc_net {
+    pthread_mutex_t lock;   // protects the ends
+    pthread_cond_t changed; // broadcast whenever an end changes
+    int use_socketpair;     // flag connections are socket pairs
+    struct zdtm_inproc_end *ends; // slots of the ends
+    int num_ends;           // number of slots
+};
+
+/**
+ * Find an in-process end.
+ *
+ * The _zdtm_inproc_find function finds the slot of the end known by
+ * the given handle. Note: The lock of the network must be held.
+ * @param net Pointer to the in-process network.
+ * @param handle The handle of the end.
+ * @param kind The kind of end looked for.
+ * @return The slot of the end, or -1 if there is none.
+ */
+static int _zdtm_inproc_find(struct zdtm_inproc_net *net, SOCKET handle,
+    int kind) {
+
+    int i;
+
+    if (!net->use_socketpair) {
+        if ((handle < 0) || (handle >= net->num_ends) ||
+            (net->ends[handle].kind != kind)) {
+            return -1;
+        }
+        return handle;
+    }
+
+    for (i = 0; i < net->num_ends; i++) {
+        if ((net->ends[i].kind == kind) && (net->ends[i].handle == handle)) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Allocate an in-process end.
+ *
+ * The _zdtm_inproc_alloc function allocates a free slot of the network
+ * for an end of the given kind. Note: The lock of the network must be
+ * held, and pointers to ends are invalidated.
+ * @param net Pointer to the in-process network.
+ * @param kind The kind of the new end.
+ * @return The slot of the new end, or -1 on failure.
+ */
+static int _zdtm_inproc_alloc(struct zdtm_inproc_net *net, int kind) {
+    struct zdtm_inproc_end *ends;
+    int i, num;
+
+    for (i = 0; i < net->num_ends; i++) {
+        if (net->ends[i].kind == ZDTM_INPROC_FREE) {
+            break;
+        }
+    }
+
+    if (i == net->num_ends) {
+        num = (net->num_ends == 0) ? 16 : (net->num_ends * 2);
+        ends = realloc(net->ends, sizeof(struct zdtm_inproc_end) * num);
+        if (ends == NULL) {
+            return -1;
+        }
+        memset(ends + net->num_ends, 0,
+            sizeof(struct zdtm_inproc_end) * (num - net->num_ends));
+        net->ends = ends;
+        net->num_ends = num;
+    }
+
+    memset(&net->ends[i], 0, sizeof(struct zdtm_inproc_end));
+    net->ends[i].kind = kind;
+    net->ends[i].handle = i;
+    net->ends[i].peer = -1;
+
+    return i;
+}
+
+/**
+ * Release an in-process end.
+ *
+ * The _zdtm_inproc_release function closes the end in the given slot,
+ * marking its peer as closed, and frees the slot. Note: The lock of the
+ * network must be held.
+ * @param net Pointer to the in-process network.
+ * @param slot The slot of the end.
+ */
+static void _zdtm_inproc_release(struct zdtm_inproc_net *net, int slot) {
+    struct zdtm_inproc_end *p_end;
+    int i;
+
+    p_end = &net->ends[slot];
+
+    if (p_end->kind == ZDTM_INPROC_LISTEN) {
+        /* Connections never accepted are closed along with it. */
+        for (i = 0; i < p_end->num_backlog; i++) {
+            if (net->use_socketpair) {
+                _zdtm_close_socket(p_end->backlog[i]);
+            } else {
+                _zdtm_inproc_release(net, p_end->backlog[i]);
+            }
+        }
+        if (net->use_socketpair) {
+            _zdtm_close_socket(p_end->handle);
+        }
+    } else if (p_end->peer >= 0) {
+        net->ends[p_end->peer].peer = -1;
+    }
+
+    if (p_end->buf != NULL) {
+        free(p_end->buf);
+    }
+    memset(p_end, 0, sizeof(struct zdtm_inproc_end));
+
+    pthread_cond_broadcast(&net->changed);
+}
+
+/**
+ * Wait for a change.
+ *
+ * The _zdtm_inproc_wait function waits for an end of the network to
+ * change, or the given deadline to pass. Note: The lock of the network
+ * must be held.
+ * @param net Pointer to the in-process network.
+ * @param p_deadline Pointer to the deadline, NULL to wait forever.
+ * @return Zero once woken up, non-zero once the deadline has passed.
+ */
+static int _zdtm_inproc_wait(struct zdtm_inproc_net *net,
+    const struct timespec *p_deadline) {
+
+    if (p_deadline == NULL) {
+        pthread_cond_wait(&net->changed, &net->lock);
+        return 0;
+    }
+
+    return pthread_cond_timedwait(&net->changed, &net->lock, p_deadline);
+}
+
+static int _zdtm_inproc_listen(zdtm_transport *p_tp, const char *addr,
+    uint16_t port, SOCKET *p_listen) {
+
+    struct zdtm_inproc_net *net;
+    SOCKET handle;
+    int i, slot;
+
+    net = (struct zdtm_inproc_net *)p_tp->ctx;
+
+    handle = INVALID_SOCKET;
+    if (net->use_socketpair) {
+        handle = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (handle == INVALID_SOCKET) {
+            return -1;
+        }
+    }
+
+    pthread_mutex_lock(&net->lock);
+
+    for (i = 0; i < net->num_ends; i++) {
+        if ((net->ends[i].kind == ZDTM_INPROC_LISTEN) &&
+            (net->ends[i].port == port)) {
+            /* address already in use */
+            pthread_mutex_unlock(&net->lock);
+            if (net->use_socketpair) {
+                _zdtm_close_socket(handle);
+            }
+            return -3;
+        }
+    }
+
+    slot = _zdtm_inproc_alloc(net, ZDTM_INPROC_LISTEN);
+    if (slot < 0) {
+        pthread_mutex_unlock(&net->lock);
+        if (net->use_socketpair) {
+            _zdtm_close_socket(handle);
+        }
+        return -1;
+    }
+    net->ends[slot].port = port;
+    if (net->use_socketpair) {
+        net->ends[slot].handle = handle;
+    }
+    (*p_listen) = net->ends[slot].handle;
+
+    pthread_mutex_unlock(&net->lock);
+
+    return 0;
+}
+
+static int _zdtm_inproc_connect(zdtm_transport *p_tp, const char *addr,
+    uint16_t port, int timeout_ms, SOCKET *p_conn) {
+
+    struct zdtm_inproc_net *net;
+    int fds[2];
+    int i, a, b;
+
+    net = (struct zdtm_inproc_net *)p_tp->ctx;
+
+    pthread_mutex_lock(&net->lock);
+
+    for (i = 0; i < net->num_ends; i++) {
+        if ((net->ends[i].kind == ZDTM_INPROC_LISTEN) &&
+            (net->ends[i].port == port)) {
+            break;
+        }
+    }
+    if ((i == net->num_ends) ||
+        (net->ends[i].num_backlog == ZDTM_INPROC_BACKLOG)) {
+        /* connection refused */
+        pthread_mutex_unlock(&net->lock);
+        return -3;
+    }
+
+    if (net->use_socketpair) {
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+            pthread_mutex_unlock(&net->lock);
+            return -1;
+        }
+        a = fds[0];
+        b = fds[1];
+    } else {
+        a = _zdtm_inproc_alloc(net, ZDTM_INPROC_CONN);
+        b = (a < 0) ? -1 : _zdtm_inproc_alloc(net, ZDTM_INPROC_CONN);
+        if (b < 0) {
+            if (a >= 0) {
+                _zdtm_inproc_release(net, a);
+            }
+            pthread_mutex_unlock(&net->lock);
+            return -1;
+        }
+        net->ends[a].peer = b;
+        net->ends[b].peer = a;
+    }
+
+    net->ends[i].backlog[net->ends[i].num_backlog++] = b;
+    pthread_cond_broadcast(&net->changed);
+
+    pthread_mutex_unlock(&net->lock);
+
+    (*p_conn) = a;
+
+    return 0;
+}
+
+static int _zdtm_inproc_accept(zdtm_transport *p_tp, SOCKET listen,
+    SOCKET *p_conn) {
+
+    struct zdtm_inproc_net *net;
+    struct zdtm_inproc_end *p_end;
+    int slot, i;
+
+    net = (struct zdtm_inproc_net *)p_tp->ctx;
+
+    pthread_mutex_lock(&net->lock);
+
+    for (;;) {
+        slot = _zdtm_inproc_find(net, listen, ZDTM_INPROC_LISTEN);
+        if (slot < 0) {
+            pthread_mutex_unlock(&net->lock);
+            return -1;
+        }
+        if (net->ends[slot].num_backlog > 0) {
+            break;
+        }
+        _zdtm_inproc_wait(net, NULL);
+    }
+
+    p_end = &net->ends[slot];
+    (*p_conn) = p_end->backlog[0];
+    for (i = 1; i < p_end->num_backlog; i++) {
+        p_end->backlog[i - 1] = p_end->backlog[i];
+    }
+    p_end->num_backlog--;
+
+    pthread_mutex_unlock(&net->lock);
+
+    return 0;
+}
+
+static zdtm_ssize_t _zdtm_mem_readv(zdtm_transport *p_tp, SOCKET conn,
+    const struct zdtm_iovec *iov, int iovcnt) {
+
+    struct zdtm_inproc_net *net;
+    struct zdtm_inproc_end *p_end;
+    zdtm_ssize_t tot;
+    uint32_t n;
+    int slot, i;
+
+    net = (struct zdtm_inproc_net *)p_tp->ctx;
+
+    pthread_mutex_lock(&net->lock);
+
+    for (;;) {
+        slot = _zdtm_inproc_find(net, conn, ZDTM_INPROC_CONN);
+        if (slot < 0) {
+            pthread_mutex_unlock(&net->lock);
+            return -1;
+        }
+        p_end = &net->ends[slot];
+        if ((p_end->count > 0) || (p_end->peer < 0)) {
+            break;
+        }
+        _zdtm_inproc_wait(net, NULL);
+    }
+
+    tot = 0;
+    for (i = 0; (i < iovcnt) && (p_end->count > 0); i++) {
+        n = (iov[i].len < p_end->count) ? iov[i].len : p_end->count;
+        memcpy(iov[i].base, p_end->buf + p_end->head, n);
+        p_end->head += n;
+        p_end->count -= n;
+        tot += n;
+    }
+    if (p_end->count == 0) {
+        p_end->head = 0;
+    }
+
+    pthread_mutex_unlock(&net->lock);
+
+    return tot;
+}
+
+static zdtm_ssize_t _zdtm_mem_writev(zdtm_transport *p_tp, SOCKET conn,
+    const struct zdtm_iovec *iov, int iovcnt) {
+
+    struct zdtm_inproc_net *net;
+    struct zdtm_inproc_end *p_peer;
+    unsigned char *buf;
+    zdtm_ssize_t tot;
+    uint32_t size, cap;
+    int slot, i;
+
+    net = (struct zdtm_inproc_net *)p_tp->ctx;
+
+    size = 0;
+    for (i = 0; i < iovcnt; i++) {
+        size += iov[i].len;
+    }
+
+    pthread_mutex_lock(&net->lock);
+
+    slot = _zdtm_inproc_find(net, conn, ZDTM_INPROC_CONN);
+    if ((slot < 0) || (net->ends[slot].peer < 0)) {
+        /* broken pipe */
+        pthread_mutex_unlock(&net->lock);
+        return -1;
+    }
+    p_peer = &net->ends[net->ends[slot].peer];
+
+    /* Make room behind the bytes still waiting in the peer buffer,
+     * moving them to the front or growing the buffer as needed. */
+    if ((p_peer->head + p_peer->count + size) > p_peer->cap) {
+        if ((p_peer->count + size) <= p_peer->cap) {
+            memmove(p_peer->buf, p_peer->buf + p_peer->head, p_peer->count);
+        } else {
+            cap = (p_peer->cap == 0) ? 4096 : p_peer->cap;
+            while (cap < (p_peer->count + size)) {
+                cap = cap * 2;
+            }
+            buf = malloc(cap);
+            if (buf == NULL) {
+                pthread_mutex_unlock(&net->lock);
+                return -1;
+            }
+            if (p_peer->buf != NULL) {
+                memcpy(buf, p_peer->buf + p_peer->head, p_peer->count);
+                free(p_peer->buf);
+            }
+            p_peer->buf = buf;
+            p_peer->cap = cap;
+        }
+        p_peer->head = 0;
+    }
+
+    tot = 0;
+    for (i = 0; i < iovcnt; i++) {
+        memcpy(p_peer->buf + p_peer->head + p_peer->count, iov[i].base,
+            iov[i].len);
+        p_peer->count += iov[i].len;
+        tot += iov[i].len;
+    }
+
+    pthread_cond_broadcast(&net->changed);
+
+    pthread_mutex_unlock(&net->lock);
+
+    return tot;
+}
+
+static int _zdtm_inproc_close(zdtm_transport *p_tp, SOCKET conn) {
+    struct zdtm_inproc_net *net;
+    int slot;
+
+    net = (struct zdtm_inproc_net *)p_tp->ctx;
+
+    pthread_mutex_lock(&net->lock);
+
+    slot = _zdtm_inproc_find(net, conn, ZDTM_INPROC_LISTEN);
+    if ((slot < 0) && !net->use_socketpair) {
+        slot = _zdtm_inproc_find(net, conn, ZDTM_INPROC_CONN);
+    }
+
+    if (slot >= 0) {
+        _zdtm_inproc_release(net, slot);
+        pthread_mutex_unlock(&net->lock);
+        return 0;
+    }
+
+    pthread_mutex_unlock(&net->lock);
+
+    if (net->use_socketpair) {
+        return _zdtm_fd_close(p_tp, conn);
+    }
+
+    return -1;
+}
+
+static int _zdtm_inproc_poll(zdtm_transport *p_tp, SOCKET conn, int events,
+    int timeout_ms) {
+
+    struct zdtm_inproc_net *net;
+    struct zdtm_inproc_end *p_end;
+    struct timespec deadline;
+    int slot, ready;
+
+    net = (struct zdtm_inproc_net *)p_tp->ctx;
+
+    if (timeout_ms >= 0) {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+    }
+
+    pthread_mutex_lock(&net->lock);
+
+    for (;;) {
+        slot = _zdtm_inproc_find(net, conn, ZDTM_INPROC_LISTEN);
+        if (slot >= 0) {
+            ready = (net->ends[slot].num_backlog > 0) ? ZDTM_POLL_IN : 0;
+        } else if (net->use_socketpair) {
+            /* a connection, which is a real socket */
+            pthread_mutex_unlock(&net->lock);
+            return _zdtm_fd_poll(p_tp, conn, events, timeout_ms);
+        } else {
+            slot = _zdtm_inproc_find(net, conn, ZDTM_INPROC_CONN);
+            if (slot < 0) {
+                pthread_mutex_unlock(&net->lock);
+                return -1;
+            }
+            p_end = &net->ends[slot];
+            ready = ZDTM_POLL_OUT;
+            if ((p_end->count > 0) || (p_end->peer < 0)) {
+                ready |= ZDTM_POLL_IN;
+            }
+        }
+
+        ready &= events;
+        if ((ready != 0) || (timeout_ms == 0)) {
+            break;
+        }
+        if (_zdtm_inproc_wait(net,
+                (timeout_ms < 0) ? NULL : &deadline) != 0) {
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&net->lock);
+
+    return ready;
+}
+
+static zdtm_ssize_t _zdtm_inproc_readv(zdtm_transport *p_tp, SOCKET conn,
+    const struct zdtm_iovec *iov, int iovcnt) {
+
+    if (((struct zdtm_inproc_net *)p_tp->ctx)->use_socketpair) {
+        return _zdtm_fd_readv(p_tp, conn, iov, iovcnt);
+    }
+
+    return _zdtm_mem_readv(p_tp, conn, iov, iovcnt);
+}
+
+static zdtm_ssize_t _zdtm_inproc_writev(zdtm_transport *p_tp, SOCKET conn,
+    const struct zdtm_iovec *iov, int iovcnt) {
+
+    if (((struct zdtm_inproc_net *)p_tp->ctx)->use_socketpair) {
+        return _zdtm_fd_writev(p_tp, conn, iov, iovcnt);
+    }
+
+    return _zdtm_mem_writev(p_tp, conn, iov, iovcnt);
+}
+
+static void _zdtm_inproc_destroy(zdtm_transport *p_tp) {
+    struct zdtm_inproc_net *net;
+    int i;
+
+    net = (struct zdtm_inproc_net *)p_tp->ctx;
+
+    for (i = 0; i < net->num_ends; i++) {
+        if (net->ends[i].kind != ZDTM_INPROC_FREE) {
+            _zdtm_inproc_release(net, i);
+        }
+    }
+    if (net->ends != NULL) {
+        free(net->ends);
+    }
+
+    pthread_cond_destroy(&net->changed);
+    pthread_mutex_destroy(&net->lock);
+    free(net);
+    free(p_tp);
+}
+
+/**
+ * Create an in-process transport.
+ *
+ * The _zdtm_inproc_new function creates a transport backed by an
+ * in-process network.
+ * @param name The name of the transport.
+ * @param use_socketpair Flag stating connections are socket pairs.
+ * @param pp_tp Pointer to a pointer to store the new transport in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully created the transport.
+ * @retval -1 Failed to allocate memory for the transport.
+ */
+static int _zdtm_inproc_new(const char *name, int use_socketpair,
+    zdtm_transport **pp_tp) {
+
+    zdtm_transport *p_tp;
+    struct zdtm_inproc_net *net;
+
+    p_tp = calloc(1, sizeof(zdtm_transport));
+    if (p_tp == NULL) {
+        return -1;
+    }
+
+    net = calloc(1, sizeof(struct zdtm_inproc_net));
+    if (net == NULL) {
+        free(p_tp);
+        return -1;
+    }
+    pthread_mutex_init(&net->lock, NULL);
+    pthread_cond_init(&net->changed, NULL);
+    net->use_socketpair = use_socketpair;
+
+    p_tp->name = name;
+    p_tp->ctx = net;
+    p_tp->listen = _zdtm_inproc_listen;
+    p_tp->connect = _zdtm_inproc_connect;
+    p_tp->accept = _zdtm_inproc_accept;
+    p_tp->readv = _zdtm_inproc_readv;
+    p_tp->writev = _zdtm_inproc_writev;
+    p_tp->close = _zdtm_inproc_close;
+    p_tp->poll = _zdtm_inproc_poll;
+    if (use_socketpair) {
+        p_tp->nonblock = _zdtm_fd_nonblock;
+    }
+    p_tp->destroy = _zdtm_inproc_destroy;
+
+    (*pp_tp) = p_tp;
+
+    return 0;
+}
+
+int zdtm_socketpair_transport_new(zdtm_transport **pp_tp) {
+    return _zdtm_inproc_new("socketpair", 1, pp_tp);
+}
+
+int zdtm_memory_transport_new(zdtm_transport **pp_tp) {
+    return _zdtm_inproc_new("memory", 0, pp_tp);
+}
+
+#else
+
+int zdtm_socketpair_transport_new(zdtm_transport **pp_tp) {
+    return -2;
+}
+
+int zdtm_memory_transport_new(zdtm_transport **pp_tp) {
+    return -2;
+}
+
+#endif
+
+void zdtm_transport_free(zdtm_transport *p_tp) {
+    if ((p_tp != NULL) && (p_tp->destroy != NULL)) {
+        p_tp->destroy(p_tp);
+    }
+}
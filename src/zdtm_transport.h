@@ -0,0 +1,254 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+/**
+ * @file zdtm_transport.h
+ * @brief This is a specifications file for the connection transports.
+ *
+ * The zdtm_transport.h file is a specifications file for the transport
+ * interface which all the connections of a synchronization are made
+ * over, along with the transports shipped with lib_zdtm_sync.
+ *
+ * - The TCP transport makes real TCP/IP connections, it is the default.
+ * - The socketpair transport connects the two sides with local stream
+ *   socket pairs, within a single process.
+ * - The memory transport connects the two sides with in-memory byte
+ *   queues, within a single process, with no kernel networking at all.
+ *
+ * A transport addresses listeners by port the same way TCP does, so
+ * the side playing the Zaurus listens on ZLISTPORT and connects back to
+ * DLISTPORT over the very same transport object as the Desktop side.
+ * The in-process transports ignore the address. An embedder may tunnel
+ * the protocol over a channel of its own by filling in a zdtm_transport
+ * structure with its own operations.
+ */
+
+#ifndef ZDTM_TRANSPORT_H
+#define ZDTM_TRANSPORT_H
+
+#include "zdtm_export.h"
+#include "zdtm_gentypes.h"
+
+// Events of the poll transport operation.
+#define ZDTM_POLL_IN 0x01
+#define ZDTM_POLL_OUT 0x02
+
+// Results of transport operations which are not plain failures.
+#define ZDTM_TRANSPORT_AGAIN -2
+#define ZDTM_TRANSPORT_TIMEOUT -4
+
+/**
+ * Transport I/O vector.
+ *
+ * The zdtm_iovec structure describes one of the buffers read into or
+ * written from by the readv and writev transport operations.
+ */
+struct zdtm_iovec {
+    void *base;             // start of the buffer
+    zdtm_size_t len;        // size of the buffer in bytes
+};
+
+typedef struct zdtm_transport zdtm_transport;
+
+/**
+ * Transport.
+ *
+ * The zdtm_transport structure is the interface connections are made
+ * over. Every operation is handed the transport itself, the ctx member
+ * being free for the transport to use. Connections and listeners are
+ * identified by SOCKET handles, which only need to mean something to
+ * the transport that handed them out. Unless stated otherwise the
+ * operations return zero on success and non-zero on failure, and they
+ * block until they are done.
+ */
+struct zdtm_transport {
+    const char *name;       // name of the transport
+    void *ctx;              // private data of the transport
+
+    /* Listen for connections on the given port of the given address,
+     * or of any address if addr is NULL. */
+    int (*listen)(zdtm_transport *p_tp, const char *addr, uint16_t port,
+        SOCKET *p_listen);
+
+    /* Connect to the given port of the given dotted-quad address,
+     * giving up after timeout_ms milliseconds unless it is negative.
+     * Returns ZDTM_TRANSPORT_TIMEOUT if it gave up. */
+    int (*connect)(zdtm_transport *p_tp, const char *addr, uint16_t port,
+        int timeout_ms, SOCKET *p_conn);
+
+    /* Accept a connection made to the given listener. */
+    int (*accept)(zdtm_transport *p_tp, SOCKET listen, SOCKET *p_conn);
+
+    /* Read into the given buffers, returning the number of bytes read,
+     * zero if the other end closed the connection, -1 on failure, or
+     * ZDTM_TRANSPORT_AGAIN if a non-blocking connection has no bytes. */
+    zdtm_ssize_t (*readv)(zdtm_transport *p_tp, SOCKET conn,
+        const struct zdtm_iovec *iov, int iovcnt);
+
+    /* Write from the given buffers, returning the number of bytes
+     * written, -1 on failure, or ZDTM_TRANSPORT_AGAIN if a non-blocking
+     * connection has no room for any of them. */
+    zdtm_ssize_t (*writev)(zdtm_transport *p_tp, SOCKET conn,
+        const struct zdtm_iovec *iov, int iovcnt);
+
+    /* Close a connection or a listener. */
+    int (*close)(zdtm_transport *p_tp, SOCKET conn);
+
+    /* Wait up to timeout_ms milliseconds, forever if negative, for any
+     * of the given ZDTM_POLL_ events on a connection or, for
+     * ZDTM_POLL_IN, a listener. Returns the events which are ready,
+     * zero on timeout, or -1 on failure. */
+    int (*poll)(zdtm_transport *p_tp, SOCKET conn, int events,
+        int timeout_ms);
+
+    /* Make readv and writev of a connection return what they can do
+     * without blocking, NULL for a transport whose readv and writev do
+     * not block once poll reported the connection ready. */
+    int (*nonblock)(zdtm_transport *p_tp, SOCKET conn);
+
+    /* Free the transport, NULL for a transport which is never freed. */
+    void (*destroy)(zdtm_transport *p_tp);
+};
+
+/**
+ * Obtain TCP transport.
+ *
+ * The zdtm_tcp_transport function obtains the TCP transport, which is
+ * the transport used by environments not given one of their own. It is
+ * shared and must not be modified.
+ * @return Pointer to the TCP transport.
+ */
+ZDTM_EXPORT zdtm_transport *zdtm_tcp_transport(void);
+
+/**
+ * Obtain activated listener.
+ *
+ * The zdtm_listen_fds function obtains the listening TCP socket handed
+ * down to the process by systemd style socket activation, that is the
+ * first descriptor passed when the LISTEN_PID environment variable
+ * names this process and LISTEN_FDS counts at least one descriptor.
+ * The LISTEN_* variables are unset once the socket is obtained, so
+ * that child processes do not take it for theirs. The socket may then
+ * be handed to zdtm_initialize_listener().
+ * @param p_listenfd Pointer to a SOCKET to store the listener in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully obtained the activated listener.
+ * @retval 1 No listener was handed down to this process.
+ * @retval -1 Failed, the listener handed down is not a valid descriptor.
+ */
+ZDTM_EXPORT int zdtm_listen_fds(SOCKET *p_listenfd);
+
+/**
+ * Create sharded listeners.
+ *
+ * The zdtm_listen_shards function creates num_shards TCP listeners all
+ * bound to the same address and port with SO_REUSEPORT, so that one
+ * process per shard, e.g. children forked after the call, can each
+ * accept Zaurus connections on the port. Every listener is handed to
+ * the environment of its process with zdtm_initialize_listener().
+ *
+ * The kernel steers each new connection to the listener whose index
+ * zdtm_shard_of() gives for the address the connection comes from, so
+ * a Zaurus calling back is accepted by the shard which connected to
+ * it, as long as each process only initiates syncs with the devices
+ * of its own shard. The steering is numbered in the order the
+ * listeners were created, and the kernel renumbers them as soon as one
+ * is closed for good. Hence a single long-lived owner, e.g. the parent
+ * process forking the shard processes, is to create the set and keep
+ * every listener of it open for as long as the set is in use. Once a
+ * shard is lost its connections, and those of the last shard, are still
+ * accepted but by whichever shard the kernel picks, and the owner is to
+ * close the whole set and create it again.
+ * @param addr The dotted-quad address, or NULL for any address.
+ * @param port The port to listen on, normally DLISTPORT.
+ * @param num_shards The number of listeners to create.
+ * @param backlog Most connections each listener queues before they are
+ * accepted, or zero or less for the system maximum.
+ * @param p_shards Pointer to an array of num_shards SOCKETs to store
+ * the listeners in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully created the listeners.
+ * @retval -1 Failed, num_shards is zero or p_shards is NULL.
+ * @retval -2 Failed to create a socket.
+ * @retval -3 Failed to set the socket REUSEADDR or REUSEPORT option.
+ * @retval -4 Failed to bind a socket to the address and port.
+ * @retval -5 Failed to put a socket into a listening state.
+ * @retval -6 Failed to steer connections, which needs Linux 4.5 or
+ * later when there is more than one shard.
+ */
+ZDTM_EXPORT int zdtm_listen_shards(const char *addr, uint16_t port,
+    unsigned int num_shards, int backlog, SOCKET *p_shards);
+
+/**
+ * Obtain shard of device.
+ *
+ * The zdtm_shard_of function obtains the index of the listener created
+ * by zdtm_listen_shards() which accepts the connections coming from
+ * the given address. A process owning a shard should only initiate
+ * syncs with the Zaurus devices this function maps to its shard.
+ * @param zaurus_ip The dotted-quad address of the Zaurus.
+ * @param num_shards The number of shards.
+ * @return The index of the shard, zero if the address is invalid.
+ */
+ZDTM_EXPORT unsigned int zdtm_shard_of(const char *zaurus_ip,
+    unsigned int num_shards);
+
+/**
+ * Create socketpair transport.
+ *
+ * The zdtm_socketpair_transport_new function creates a transport which
+ * connects its listeners and connections with local stream socket
+ * pairs. Connections made over it are real file descriptors which may
+ * as well be handed to the system calls directly. It may be used from
+ * multiple threads at once.
+ * @param pp_tp Pointer to a pointer to store the new transport in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully created the transport.
+ * @retval -1 Failed to allocate memory for the transport.
+ * @retval -2 Not supported on this platform.
+ */
+ZDTM_EXPORT int zdtm_socketpair_transport_new(zdtm_transport **pp_tp);
+
+/**
+ * Create memory transport.
+ *
+ * The zdtm_memory_transport_new function creates a transport which
+ * connects its listeners and connections with in-memory byte queues.
+ * It may be used from multiple threads at once.
+ * @param pp_tp Pointer to a pointer to store the new transport in.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully created the transport.
+ * @retval -1 Failed to allocate memory for the transport.
+ * @retval -2 Not supported on this platform.
+ */
+ZDTM_EXPORT int zdtm_memory_transport_new(zdtm_transport **pp_tp);
+
+/**
+ * Free transport.
+ *
+ * The zdtm_transport_free function frees a transport created by one of
+ * the zdtm_*_transport_new functions. All the connections and listeners
+ * of the transport must have been closed beforehand.
+ * @param p_tp Pointer to the transport to free.
+ */
+ZDTM_EXPORT void zdtm_transport_free(zdtm_transport *p_tp);
+
+#endif
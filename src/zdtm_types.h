@@ -33,6 +33,7 @@
 
 #include "zdtm_export.h"
 #include "zdtm_gentypes.h"
+#include "zdtm_transport.h"
 
 // This is the port that the Zaurus listens on waiting for a connection
 // to initiate a synchronization from the Desktop.
@@ -47,6 +48,12 @@
 #define MSG_TYPE_SIZE 3
 // This is the size, in bytes,  of a common messages.
 #define COM_MSG_SIZE 7
+// This is the size, in bytes, of a Zaurus DTM Message less its content,
+// the header, body size, type, and check sum.
+#define ZDTM_MSG_OVERHEAD (MSG_HDR_SIZE + 2 + MSG_TYPE_SIZE + 2)
+// This is the size, in bytes, of the largest content of a message, whose
+// body size, the type along with the content, is a uint16_t.
+#define ZDTM_MSG_MAX_CONT (0xffff - MSG_TYPE_SIZE)
 
 #define IP_STR_SIZE 16
 
@@ -65,6 +72,24 @@ extern const unsigned char DMSG_HDR[MSG_HDR_SIZE];
 
 #define MSG_HDR_CONT_OFFSET 0x09
 
+// Kinds of sinks the log of an environment is written to.
+#define ZDTM_LOG_DEFAULT 0  // $HOME/.lib_zdtm_sync.log, opened when needed
+#define ZDTM_LOG_NONE 1     // the log is discarded
+#define ZDTM_LOG_FILE 2     // a file opened by zdtm_set_log_file
+#define ZDTM_LOG_FD 3       // a descriptor owned by the caller
+#define ZDTM_LOG_FUNC 4     // a function of the caller
+
+/**
+ * Log function.
+ *
+ * The zdtm_log_func is a type defined to represent a function the log
+ * of an environment is handed to, see zdtm_set_log_func(). It is called
+ * from the thread using the environment with a chunk of the log, which
+ * is not nul terminated, and the argument it was set with.
+ */
+typedef void (*zdtm_log_func)(const char *buff, unsigned int size,
+    void *arg);
+
 /**
  * Zaurus ADI message parameter.
  *
@@ -93,9 +118,19 @@ struct zdtm_adi_msg_param {
  */
 typedef struct ZDTM_EXPORT zdtm_environment {
     SOCKET listenfd;   // socket - listen for zaurus conn request
+    int own_listener;  // flag stating the library closes the listener
     SOCKET connfd;     // socket - connection from zaurus to desktop
     SOCKET reqfd;      // socket - connection to zaurus from the desktop
+    zdtm_transport *transport; // transport the connections are made over
+    int connect_timeout; // ms to connect to the zaurus, negative for none
+    int accept_timeout; // ms to await the zaurus conn, negative for none
+    int io_timeout; // ms to await each read or write, negative for none
+    int timed_out; // RET_*_TIMEOUT of the deadline missed, zero if none
+    int log_sink;   // ZDTM_LOG_* kind of sink the log is written to
     FILE *logfp;    // file pointer - used as the log file.
+    int logfd;      // descriptor the log is written to for ZDTM_LOG_FD
+    zdtm_log_func log_func; // function the log is handed to
+    void *log_arg;  // argument handed to log_func
     // General Device Information
     int retreived_device_info; // flag stating device info has been obtained
     char model[256];    // c-string to hold the devices model
@@ -109,7 +144,12 @@ typedef struct ZDTM_EXPORT zdtm_environment {
     int address_book_slow_sync_required; // flag if slow sync is required
     uint16_t num_params;    // number of parameters in the params list
     struct zdtm_adi_msg_param *params; // params that compose item data format
+    struct zdtm_schema *schema; // schema of the params, for item records
+    struct zdtm_category_table *categories; // categories of obtained items
+    int share_categories; // flag stating obtained items share categories
     char *passcode; // zaurus passcode to use in synchronization
+    struct zdtm_mirror_store *mirror; // mirror store of obtained items
+    struct zdtm_journal_store *journal; // checkpoint journal of the device
 } zdtm_lib_env;
 
 #endif
@@ -0,0 +1,268 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+/**
+ * @file zdtm_bulk_bench.c
+ * @brief This is a benchmark of the bulk slow sync.
+ *
+ * The zdtm_bulk_bench.c file is a benchmark which obtains all the items
+ * of a simulated Zaurus during a slow sync, first with an RDR request
+ * per item and then in bulk through the DTM box file, and reports the
+ * time taken and the traffic of each. It then saves the DTM box and
+ * index files to disk and reports the time taken to scan and look up
+ * all the records of the memory mapped files without copying them.
+ */
+
+#include "zdtm_sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define BENCH_MAX_ITEMS 16000
+
+#define BENCH_BOX_PATH "/tmp/zdtm_bulk_bench.box"
+#define BENCH_IDX_PATH "/tmp/zdtm_bulk_bench.idx"
+
+#define BENCH_PER_ITEM 0
+#define BENCH_BULK 1
+#define BENCH_MAPPED 2
+
+struct bench_result {
+    double secs;
+    unsigned long items;
+    unsigned long msgs;
+    unsigned long bytes;
+};
+
+static double now(void) {
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + (tv.tv_usec / 1000000.0);
+}
+
+static int count_item(struct zdtm_item *p_item, void *arg) {
+    (*((unsigned long *)arg))++;
+    zdtm_clean_item(p_item);
+    return 0;
+}
+
+static int obtain_per_item(zdtm_lib_env *cur_env, unsigned long *p_items) {
+    int i, r;
+    uint32_t *p_new_sync_ids, *p_mod_sync_ids, *p_del_sync_ids;
+    uint16_t num_new_sync_ids, num_mod_sync_ids, num_del_sync_ids;
+    struct zdtm_item item;
+
+    r = zdtm_obtain_sync_id_lists(cur_env, &p_new_sync_ids, &num_new_sync_ids,
+        &p_mod_sync_ids, &num_mod_sync_ids, &p_del_sync_ids,
+        &num_del_sync_ids);
+    if (r != 0) {
+        fprintf(stderr, "ERR(%d): zdtm_obtain_sync_id_lists() failed.\n", r);
+        return -1;
+    }
+
+    for (i = 0; i < num_new_sync_ids; i++) {
+        memset(&item, 0, sizeof(struct zdtm_item));
+        item.sync_type = SYNC_TYPE_TODO;
+        r = zdtm_obtain_todo_item(cur_env, p_new_sync_ids[i],
+            &item.cont.todo);
+        if (r != 0) {
+            fprintf(stderr, "ERR(%d): zdtm_obtain_todo_item() failed.\n", r);
+            break;
+        }
+        count_item(&item, p_items);
+    }
+
+    free(p_new_sync_ids);
+    free(p_mod_sync_ids);
+    free(p_del_sync_ids);
+
+    return (r == 0) ? 0 : -2;
+}
+
+static int scan_mapped(zdtm_lib_env *cur_env, unsigned long *p_items) {
+    int r;
+    uint32_t cursor, title_len;
+    const unsigned char *p_title;
+    unsigned long found;
+    zdtm_dtm_db *p_db;
+    struct zdtm_dtm_record rec;
+    struct zdtm_item item;
+
+    r = zdtm_dtm_open(BENCH_BOX_PATH, BENCH_IDX_PATH, &p_db);
+    if (r != 0) {
+        fprintf(stderr, "ERR(%d): zdtm_dtm_open() failed.\n", r);
+        return -1;
+    }
+
+    cursor = 0;
+    while ((r = zdtm_dtm_next_record(p_db, &cursor, &rec)) == 0) {
+        r = zdtm_dtm_record_item(cur_env->params, cur_env->num_params,
+            cur_env->sync_type, &rec, &item);
+        if ((r != 0) || (zdtm_dtm_record_field(cur_env->params,
+            cur_env->num_params, &rec, "TITL", &p_title, &title_len) != 0)) {
+            fprintf(stderr, "ERR(%d): zdtm_dtm_record_item() failed.\n", r);
+            zdtm_dtm_close(p_db);
+            return -2;
+        }
+        (*p_items)++;
+    }
+    if (r != 1) {
+        fprintf(stderr, "ERR(%d): zdtm_dtm_next_record() failed.\n", r);
+        zdtm_dtm_close(p_db);
+        return -3;
+    }
+
+    for (found = 0; found < (*p_items); found++) {
+        if (zdtm_dtm_find_record(p_db, found + 1, &rec) != 0) {
+            fprintf(stderr, "ERR: zdtm_dtm_find_record() failed.\n");
+            zdtm_dtm_close(p_db);
+            return -4;
+        }
+    }
+
+    zdtm_dtm_close(p_db);
+
+    return 0;
+}
+
+static int run(int mode, unsigned int num_items, unsigned int delay_us,
+    struct bench_result *res) {
+
+    struct zdtm_sim sim;
+    zdtm_lib_env cur_env;
+    char ip[IP_STR_SIZE] = "127.0.0.1";
+    double start;
+    uint32_t size;
+    int r;
+
+    memset(&sim, 0, sizeof(struct zdtm_sim));
+    sim.first_sync_id = 1;
+    sim.num_new = num_items;
+    sim.item_delay_us = delay_us;
+    if (zdtm_sim_start(&sim) != 0) {
+        fprintf(stderr, "ERR: zdtm_sim_start() failed.\n");
+        return -1;
+    }
+
+    memset(&cur_env, 0, sizeof(zdtm_lib_env));
+    if ((zdtm_initialize(&cur_env) != 0) ||
+        (zdtm_set_zaurus_ip(&cur_env, ip) != 0) ||
+        (zdtm_set_sync_type(&cur_env, 0) != 0)) {
+        fprintf(stderr, "ERR: failed to set up the library.\n");
+        return -2;
+    }
+
+    r = zdtm_initiate_sync(&cur_env);
+    if (r != 0) {
+        fprintf(stderr, "ERR(%d): zdtm_initiate_sync() failed.\n", r);
+        return -3;
+    }
+
+    res->items = 0;
+    if (mode == BENCH_MAPPED) {
+        r = zdtm_obtain_dtm_file(&cur_env, ZDTM_DTM_BOX, BENCH_BOX_PATH, NULL,
+            &size);
+        if (r == 0) {
+            r = zdtm_obtain_dtm_file(&cur_env, ZDTM_DTM_IDX, BENCH_IDX_PATH,
+                NULL, &size);
+        }
+        if (r != 0) {
+            fprintf(stderr, "ERR(%d): zdtm_obtain_dtm_file() failed.\n", r);
+            return -4;
+        }
+    }
+
+    start = now();
+    if (mode == BENCH_BULK) {
+        r = zdtm_bulk_obtain_items(&cur_env, NULL, count_item, &res->items);
+    } else if (mode == BENCH_MAPPED) {
+        r = scan_mapped(&cur_env, &res->items);
+    } else {
+        r = obtain_per_item(&cur_env, &res->items);
+    }
+    res->secs = now() - start;
+    if (r != 0) {
+        fprintf(stderr, "ERR(%d): obtaining the items failed.\n", r);
+        return -4;
+    }
+
+    zdtm_terminate_sync(&cur_env);
+    zdtm_finalize(&cur_env);
+
+    r = zdtm_sim_wait(&sim);
+    if (r != 0) {
+        fprintf(stderr, "ERR(%d): the simulated Zaurus failed.\n", r);
+        return -5;
+    }
+    res->msgs = sim.msgs_recv + sim.msgs_sent;
+    res->bytes = sim.bytes_recv + sim.bytes_sent;
+
+    return 0;
+}
+
+static void report(const char *name, struct bench_result *res) {
+    printf("%-10s %8lu items %10.3f s %12.0f items/s %8lu msgs %10lu bytes\n",
+        name, res->items, res->secs,
+        (res->secs > 0) ? (res->items / res->secs) : 0.0,
+        res->msgs, res->bytes);
+}
+
+int main(int argc, char *argv[]) {
+    unsigned int num_items, delay_us;
+    struct bench_result per_item, bulk, mapped;
+
+    if (argc > 3) {
+        printf("Usage: %s [num items] [simulated RDR latency in usec]\n",
+            argv[0]);
+        return 0;
+    }
+
+    num_items = (argc > 1) ? atoi(argv[1]) : 10000;
+    delay_us = (argc > 2) ? atoi(argv[2]) : 0;
+    if ((num_items == 0) || (num_items > BENCH_MAX_ITEMS)) {
+        fprintf(stderr, "ERR: num items must be from 1 to %d.\n",
+            BENCH_MAX_ITEMS);
+        return 1;
+    }
+
+    if (run(BENCH_PER_ITEM, num_items, delay_us, &per_item) != 0) {
+        return 2;
+    }
+    if (run(BENCH_BULK, num_items, delay_us, &bulk) != 0) {
+        return 3;
+    }
+    if (run(BENCH_MAPPED, num_items, delay_us, &mapped) != 0) {
+        return 4;
+    }
+    remove(BENCH_BOX_PATH);
+    remove(BENCH_IDX_PATH);
+
+    report("RDR", &per_item);
+    report("RGE bulk", &bulk);
+    report("mmap scan", &mapped);
+    if (bulk.secs > 0) {
+        printf("speedup: %.1fx\n", per_item.secs / bulk.secs);
+    }
+
+    return 0;
+}
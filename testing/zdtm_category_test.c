@@ -0,0 +1,211 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+
+
+/*
+ * This program checks the interning of item categories. A category
+ * table hands out a single ID and payload for each distinct category
+ * however often it is seen, and keeps them in place as it grows. Items
+ * obtained in a session carry the ID of their category, and share its
+ * payload when asked to.
+ */
+
+#include "zdtm_sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CATEGORY_NUM_TABLE 1000
+#define CATEGORY_NUM_ITEMS 30
+#define CATEGORY_FIRST_ID 1
+
+struct session {
+    int share;                      // flag stating items share categories
+    int items_ok;                   // items obtained with category IDs
+    int shared_ok;                  // items of a category share it or not
+    int lookup_ok;                  // category IDs looked up
+};
+
+static int test_table(void) {
+    zdtm_category_table table;
+    const unsigned char *first, *p;
+    char name[16];
+    uint32_t len;
+    uint16_t id, id2;
+    int i, ok, fails;
+
+    zdtm_category_table_init(&table);
+    ok = (zdtm_category_intern(&table, "", 0, &id) == 0) &&
+        (id == ZDTM_CATEGORY_NONE) && (table.num_categories == 0) &&
+        (zdtm_category_lookup(&table, ZDTM_CATEGORY_NONE, &len) != NULL) &&
+        (len == 0);
+    fails = check("empty category has the none ID", ok);
+
+    ok = (zdtm_category_intern(&table, "Business", 8, &id) == 0) &&
+        (id == 1) &&
+        (zdtm_category_intern(&table, "Personal", 8, &id2) == 0) &&
+        (id2 == 2) &&
+        (zdtm_category_intern(&table, "Business", 8, &id) == 0) &&
+        (id == 1) && (table.num_categories == 2);
+    fails += check("  distinct categories interned once", ok);
+
+    first = zdtm_category_lookup(&table, 1, &len);
+    ok = (first != NULL) && (len == 8) && (memcmp(first, "Business", 8) == 0);
+    fails += check("  category looked up by ID", ok);
+    fails += check("  unknown ID not found",
+        zdtm_category_lookup(&table, 3, &len) == NULL);
+
+    /* Grow the table well past its first allocation. */
+    ok = 1;
+    for (i = 0; ok && (i < CATEGORY_NUM_TABLE); i++) {
+        snprintf(name, sizeof(name), "Category %d", i);
+        ok = (zdtm_category_intern(&table, name, strlen(name), &id) == 0) &&
+            (id == i + 3);
+    }
+    for (i = 0; ok && (i < CATEGORY_NUM_TABLE); i++) {
+        snprintf(name, sizeof(name), "Category %d", i);
+        ok = (zdtm_category_intern(&table, name, strlen(name), &id) == 0) &&
+            (id == i + 3);
+        p = zdtm_category_lookup(&table, id, &len);
+        ok = ok && (len == strlen(name)) && (memcmp(p, name, len) == 0);
+    }
+    fails += check("  many categories interned once", ok);
+    fails += check("  payloads kept in place as the table grows",
+        zdtm_category_lookup(&table, 1, &len) == first);
+
+    zdtm_category_table_free(&table);
+
+    return fails;
+}
+
+static int run(struct session *s) {
+    struct zdtm_sim sim;
+    zdtm_lib_env cur_env;
+    char ip[IP_STR_SIZE] = "127.0.0.1";
+    struct zdtm_todo_item items[CATEGORY_NUM_ITEMS];
+    const unsigned char *p;
+    uint32_t len;
+    int i, j, r;
+
+    memset(&sim, 0, sizeof(struct zdtm_sim));
+    sim.first_sync_id = CATEGORY_FIRST_ID;
+    sim.num_new = CATEGORY_NUM_ITEMS;
+    if (zdtm_sim_start(&sim) != 0) {
+        fprintf(stderr, "ERR: zdtm_sim_start() failed.\n");
+        return -1;
+    }
+
+    memset(&cur_env, 0, sizeof(zdtm_lib_env));
+    if ((zdtm_initialize(&cur_env) != 0) ||
+        (zdtm_set_zaurus_ip(&cur_env, ip) != 0) ||
+        (zdtm_set_sync_type(&cur_env, 0) != 0) ||
+        (zdtm_set_category_sharing(&cur_env, s->share) != 0)) {
+        fprintf(stderr, "ERR: failed to set up the library.\n");
+        return -2;
+    }
+
+    r = zdtm_initiate_sync(&cur_env);
+    if (r != 0) {
+        fprintf(stderr, "ERR(%d): zdtm_initiate_sync() failed.\n", r);
+        return -3;
+    }
+
+    s->items_ok = 1;
+    memset(items, 0, sizeof(items));
+    for (i = 0; i < CATEGORY_NUM_ITEMS; i++) {
+        s->items_ok &= (zdtm_obtain_todo_item(&cur_env,
+            CATEGORY_FIRST_ID + i, &items[i]) == 0) &&
+            (items[i].category_id != ZDTM_CATEGORY_NONE) &&
+            (items[i].category_id <= 3);
+    }
+
+    /* Items of the same category have the same ID, and point at the
+     * same payload exactly when they share it. */
+    s->shared_ok = 1;
+    for (i = 0; i < CATEGORY_NUM_ITEMS; i++) {
+        for (j = 0; j < i; j++) {
+            if ((items[i].category_len != items[j].category_len) ||
+                (memcmp(items[i].category, items[j].category,
+                    items[i].category_len) != 0)) {
+                s->shared_ok &= (items[i].category_id !=
+                    items[j].category_id);
+            } else {
+                s->shared_ok &= (items[i].category_id ==
+                    items[j].category_id) &&
+                    ((items[i].category == items[j].category) == s->share);
+            }
+        }
+    }
+
+    s->lookup_ok = 1;
+    for (i = 0; i < CATEGORY_NUM_ITEMS; i++) {
+        s->lookup_ok &= (zdtm_lookup_category(&cur_env, items[i].category_id,
+            &p, &len) == 0) && (len == items[i].category_len) &&
+            (memcmp(p, items[i].category, len) == 0) &&
+            ((p == (unsigned char *)items[i].category) == s->share);
+    }
+    s->lookup_ok &= (zdtm_lookup_category(&cur_env, 4, &p, &len) == -1);
+
+    for (i = 0; i < CATEGORY_NUM_ITEMS; i++) {
+        if (!s->share) {
+            free(items[i].category);
+        }
+        free(items[i].description);
+        free(items[i].notes);
+    }
+
+    r = zdtm_terminate_sync(&cur_env);
+    if (r != 0) {
+        fprintf(stderr, "ERR(%d): zdtm_terminate_sync() failed.\n", r);
+        return -4;
+    }
+    zdtm_finalize(&cur_env);
+
+    zdtm_sim_wait(&sim);
+
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    struct session s;
+    int fails;
+
+    fails = test_table();
+
+    memset(&s, 0, sizeof(struct session));
+    if (run(&s) != 0) { return 2; }
+    fails += check("items obtained with category IDs", s.items_ok);
+    fails += check("  items of a category have its ID", s.shared_ok);
+    fails += check("  category IDs looked up", s.lookup_ok);
+
+    memset(&s, 0, sizeof(struct session));
+    s.share = 1;
+    if (run(&s) != 0) { return 2; }
+    fails += check("items obtained sharing their categories", s.items_ok);
+    fails += check("  items of a category share its payload",
+        s.shared_ok);
+    fails += check("  shared category IDs looked up", s.lookup_ok);
+
+    printf("%d failure(s)\n", fails);
+
+    return fails ? 1 : 0;
+}
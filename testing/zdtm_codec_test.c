@@ -0,0 +1,390 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+
+/*
+ * This program checks the message codec cursors. Fields are stored
+ * little-endian whatever the host, a prepared message has exactly the
+ * content computed for it, and raw content cut short at every byte is
+ * refused by the parsers rather than read past.
+ */
+
+#include "zdtm_sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int test_cursor(void) {
+    unsigned char buf[8];
+    zdtm_writer wr;
+    zdtm_reader rd;
+    const unsigned char expect[7] = {0x7f, 0x34, 0x12, 0x78, 0x56, 0x34,
+        0x12};
+    int fails, ok;
+
+    zdtm_wr_init(&wr, buf, 7);
+    ok = (zdtm_wr_need(&wr, 7) == 0) && (zdtm_wr_need(&wr, 8) != 0);
+    zdtm_wr_u8(&wr, 0x7f);
+    zdtm_wr_u16(&wr, 0x1234);
+    zdtm_wr_u32(&wr, 0x12345678);
+    fails = check("fields written little-endian", ok &&
+        (zdtm_wr_left(&wr) == 0) && (memcmp(buf, expect, 7) == 0));
+
+    /* Read back from an odd address, as fields are not aligned. */
+    memmove(buf + 1, buf, 7);
+    zdtm_rd_init(&rd, buf + 1, 7);
+    fails += check("  read back unaligned",
+        (zdtm_rd_u8(&rd) == 0x7f) && (zdtm_rd_u16(&rd) == 0x1234) &&
+        (zdtm_rd_u32(&rd) == 0x12345678) && (zdtm_rd_need(&rd, 1) != 0));
+
+    return fails;
+}
+
+static int test_prepare(void) {
+    zdtm_lib_env cur_env;
+    zdtm_msg msg;
+    const unsigned char expect[7] = {0x06, 0x01, 0x00, 0x04, 0x03, 0x02,
+        0x01};
+    unsigned char *cont;
+    int r, fails;
+
+    memset(&cur_env, 0, sizeof(zdtm_lib_env));
+    memset(&msg, 0, sizeof(zdtm_msg));
+    memcpy(msg.body.type, RDR_MSG_TYPE, MSG_TYPE_SIZE);
+    msg.body.cont.rdr.sync_type = 0x06;
+    msg.body.cont.rdr.num_sync_ids = 1;
+    msg.body.cont.rdr.sync_id = 0x01020304;
+    r = _zdtm_prepare_message(&cur_env, &msg);
+    cont = (unsigned char *)msg.body.p_raw_content;
+    fails = check("RDR content written", (r == 0) &&
+        (msg.cont_size == 7) && (memcmp(cont, expect, 7) == 0) &&
+        (zdtm_get_le16(msg.header + MSG_HDR_CONT_OFFSET) == 7));
+    _zdtm_clean_message(&msg);
+
+    memset(&msg, 0, sizeof(zdtm_msg));
+    memcpy(msg.body.type, RDW_MSG_TYPE, MSG_TYPE_SIZE);
+    msg.body.cont.rdw.sync_type = 0x06;
+    msg.body.cont.rdw.variation = 9;
+    fails += check("  unknown RDW variation refused",
+        _zdtm_prepare_message(&cur_env, &msg) == RET_UNK_VAR);
+    _zdtm_clean_message(&msg);
+
+    return fails;
+}
+
+/* Parse every prefix of the given raw content, which must all fail,
+ * and the whole of it, which must not. */
+/* Fill in an RDW message writing a Todo item. */
+static void todo_rdw(zdtm_msg *p_msg, char *notes) {
+    memset(p_msg, 0, sizeof(zdtm_msg));
+    memcpy(p_msg->body.type, RDW_MSG_TYPE, MSG_TYPE_SIZE);
+    p_msg->body.cont.rdw.sync_type = SYNC_TYPE_TODO;
+    p_msg->body.cont.rdw.num_sync_ids = 1;
+    p_msg->body.cont.rdw.sync_id = 0x01020304;
+    p_msg->body.cont.rdw.variation = 3;
+    p_msg->body.cont.rdw.vars.three.sync_id = 0x01020304;
+    p_msg->body.cont.rdw.cont.todo.category = "Business";
+    p_msg->body.cont.rdw.cont.todo.category_len = 8;
+    p_msg->body.cont.rdw.cont.todo.description = "Write the report";
+    p_msg->body.cont.rdw.cont.todo.description_len = 16;
+    p_msg->body.cont.rdw.cont.todo.notes = notes;
+    p_msg->body.cont.rdw.cont.todo.notes_len = strlen(notes);
+    p_msg->body.cont.rdw.cont.todo.progress = 1;
+}
+
+static int test_write(void) {
+    zdtm_lib_env cur_env;
+    zdtm_msg msg;
+    unsigned char buf[512];
+    char notes[] = "Notes \xe9\xff past the 7 bit range.";
+    uint32_t size;
+    uint16_t cont_size, check_sum;
+    unsigned char *cont;
+    int r, fails;
+
+    memset(&cur_env, 0, sizeof(zdtm_lib_env));
+    todo_rdw(&msg, notes);
+    r = _zdtm_prepare_message(&cur_env, &msg);
+    cont_size = msg.cont_size;
+    check_sum = _zdtm_checksum(&msg);
+    cont = malloc(cont_size);
+    memcpy(cont, msg.body.p_raw_content, cont_size);
+    fails = check("prepared checksum summed while writing",
+        (r == 0) && (msg.check_sum == check_sum));
+    _zdtm_clean_message(&msg);
+
+    todo_rdw(&msg, notes);
+    r = _zdtm_write_message(&msg, buf, sizeof(buf), &size);
+    fails += check("  message written in one pass", (r == 0) &&
+        (size == (uint32_t)ZDTM_MSG_OVERHEAD + cont_size) &&
+        (memcmp(buf, DMSG_HDR, MSG_HDR_CONT_OFFSET) == 0) &&
+        (zdtm_get_le16(buf + MSG_HDR_CONT_OFFSET) == cont_size) &&
+        (zdtm_get_le16(buf + MSG_HDR_SIZE) == cont_size + MSG_TYPE_SIZE) &&
+        (memcmp(buf + MSG_HDR_SIZE + 2, RDW_MSG_TYPE, MSG_TYPE_SIZE) == 0) &&
+        (memcmp(buf + MSG_HDR_SIZE + 2 + MSG_TYPE_SIZE, cont,
+            cont_size) == 0) &&
+        (zdtm_get_le16(buf + size - 2) == check_sum) &&
+        (msg.check_sum == check_sum));
+
+    todo_rdw(&msg, notes);
+    fails += check("  message past the buffer refused",
+        _zdtm_write_message(&msg, buf, size - 1, &size) == RET_BAD_SIZE);
+    free(cont);
+
+    return fails;
+}
+
+static uint16_t sum_bytes(const unsigned char *p, uint32_t size) {
+    uint16_t sum;
+    uint32_t i;
+
+    sum = 0;
+    for (i = 0; i < size; i++) {
+        sum += p[i];
+    }
+
+    return sum;
+}
+
+/* Fill in an RDW message writing Calendar items laid out by a format. */
+static void calendar_rdw(zdtm_msg *p_msg, const int16_t *map,
+    uint16_t num_params, struct zdtm_calendar_item *items,
+    uint16_t num_items) {
+    memset(p_msg, 0, sizeof(zdtm_msg));
+    memcpy(p_msg->body.type, RDW_MSG_TYPE, MSG_TYPE_SIZE);
+    p_msg->body.cont.rdw.sync_type = SYNC_TYPE_CALENDAR;
+    p_msg->body.cont.rdw.num_sync_ids = num_items;
+    p_msg->body.cont.rdw.variation = RDW_VAR_FORMAT;
+    p_msg->body.cont.rdw.vars.four.map = map;
+    p_msg->body.cont.rdw.vars.four.num_params = num_params;
+    p_msg->body.cont.rdw.vars.four.items = items;
+}
+
+static int test_write_format(void) {
+    struct zdtm_adi_msg_param format[] = {
+        {"SYID", DATA_ID_ULONG, 0, NULL},
+        {"ARMN", DATA_ID_WORD, 0, NULL},
+        {"XXXX", DATA_ID_UTF8, 0, NULL},
+        {"DSRP", DATA_ID_UTF8, 0, NULL},
+        {"TIM1", DATA_ID_TIME, 0, NULL},
+        {"PLCE", DATA_ID_BARRAY, 0, NULL}
+    };
+    const unsigned char record[] = {
+        0x04, 0x03, 0x02, 0x01,
+        0x04, 0x00, 0x00, 0x00, 0x04, 0x03, 0x02, 0x01,
+        0x02, 0x00, 0x00, 0x00, 0x1e, 0x00,
+        0x00, 0x00, 0x00, 0x00,
+        0x05, 0x00, 0x00, 0x00, 'L', 'u', 'n', 'c', 'h',
+        0x05, 0x00, 0x00, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05,
+        0x00, 0x00, 0x00, 0x00
+    };
+    struct zdtm_calendar_item items[3];
+    zdtm_lib_env cur_env;
+    zdtm_msg msg;
+    unsigned char *buf, *cont;
+    int16_t map[6];
+    uint32_t size;
+    int i, r, fails;
+
+    r = zdtm_rdw_map_format(SYNC_TYPE_CALENDAR, format, 6, map);
+    fails = check("format mapped onto the item fields", (r == 0) &&
+        (map[0] >= 0) && (map[1] >= 0) && (map[2] == -1) &&
+        (map[3] >= 0) && (map[4] >= 0) && (map[5] == -1));
+    fails += check("  format of an unknown sync type refused",
+        zdtm_rdw_map_format(0x02, format, 6, map) == RET_UNK_TYPE);
+
+    memset(items, 0, sizeof(items));
+    for (i = 0; i < 3; i++) {
+        items[i].sync_id = 0x01020304;
+        items[i].alarm_time = 30;
+        items[i].description = "Lunch";
+        items[i].description_len = 5;
+        items[i].location = "Home";
+        items[i].location_len = 4;
+        memcpy(items[i].start_time, "\x01\x02\x03\x04\x05", 5);
+    }
+
+    buf = malloc(2 * ZDTM_MSG_OVERHEAD + 0x20000);
+    calendar_rdw(&msg, map, 6, items, 2);
+    r = _zdtm_write_message(&msg, buf, 512, &size);
+    cont = buf + MSG_HDR_SIZE + 2 + MSG_TYPE_SIZE;
+    fails += check("  records laid out by the format", (r == 0) &&
+        (msg.cont_size == 3 + 2 * sizeof(record)) &&
+        (cont[0] == SYNC_TYPE_CALENDAR) && (zdtm_get_le16(cont + 1) == 2) &&
+        (memcmp(cont + 3, record, sizeof(record)) == 0) &&
+        (memcmp(cont + 3 + sizeof(record), record, sizeof(record)) == 0) &&
+        (msg.body.cont.rdw.vars.four.num_written == 2));
+
+    calendar_rdw(&msg, map, 6, items, 2);
+    r = _zdtm_prepare_message(&cur_env, &msg);
+    fails += check("  prepared records the same as written", (r == 0) &&
+        (msg.cont_size == 3 + 2 * sizeof(record)) &&
+        (memcmp(msg.body.p_raw_content, cont, msg.cont_size) == 0) &&
+        (msg.check_sum == _zdtm_checksum(&msg)));
+    _zdtm_clean_message(&msg);
+
+    /* Records past the largest message are left for the next one, and
+     * a buffer smaller than the largest message is to be grown. */
+    for (i = 0; i < 3; i++) {
+        items[i].description_len = 30000;
+        items[i].description = malloc(items[i].description_len);
+        memset(items[i].description, 0xa5, items[i].description_len);
+    }
+    calendar_rdw(&msg, map, 6, items, 3);
+    fails += check("  records past a small buffer refused",
+        _zdtm_write_message(&msg, buf, 40000, &size) == RET_BAD_SIZE);
+
+    calendar_rdw(&msg, map, 6, items, 3);
+    r = _zdtm_write_message(&msg, buf, 2 * ZDTM_MSG_OVERHEAD + 0x20000,
+        &size);
+    fails += check("  records past the largest message left out",
+        (r == 0) && (msg.body.cont.rdw.vars.four.num_written == 2) &&
+        (zdtm_get_le16(cont + 1) == 2) &&
+        (zdtm_get_le16(buf + size - 2) ==
+            sum_bytes(buf + MSG_HDR_SIZE + 2, msg.body_size)));
+
+    calendar_rdw(&msg, map, 6, items, 3);
+    fails += check("  prepared records past the largest refused",
+        _zdtm_prepare_message(&cur_env, &msg) == RET_BAD_SIZE);
+    _zdtm_clean_message(&msg);
+
+    for (i = 0; i < 3; i++) {
+        free(items[i].description);
+    }
+    free(buf);
+
+    return fails;
+}
+
+static int parse_prefixes(const char *type, unsigned char *raw,
+    uint16_t size) {
+    zdtm_msg msg;
+    uint16_t len;
+    int refused;
+
+    refused = 0;
+    for (len = 0; len <= size; len++) {
+        memset(&msg, 0, sizeof(zdtm_msg));
+        memcpy(msg.body.type, type, MSG_TYPE_SIZE);
+        msg.body.p_raw_content = malloc(len + 1);
+        memcpy(msg.body.p_raw_content, raw, len);
+        msg.cont_size = len;
+        if (_zdtm_parse_raw_msg(&msg) != 0) {
+            refused++;
+        } else if (IS_ADR((&msg))) {
+            free(msg.body.cont.adr.params[0].param_data);
+            free(msg.body.cont.adr.params);
+        } else if (IS_AIG((&msg))) {
+            free(msg.body.cont.aig.model_str);
+        }
+        _zdtm_clean_message(&msg);
+    }
+
+    return refused;
+}
+
+static int test_truncated(void) {
+    unsigned char asy[] = {
+        0x01, 0x02, 0x00, 0x01, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00,
+        0x02, 0x01, 0x00, 0x03, 0x00, 0x00, 0x00,
+        0x03, 0x00, 0x00
+    };
+    unsigned char adr[] = {
+        0x00, 0x00, 0x01, 0x00, 0x03, 0x00, 0x00, 0x00, 'a', 'b', 'c'
+    };
+    unsigned char aig[] = {
+        0x03, 0x00, 'S', 'L', 'C', 0, 0, 0, 0, 0, 'E', 'N', 0x00,
+        0, 0, 0, 0, 0, 0
+    };
+    unsigned char age[] = {
+        0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00,
+        'd', 'a', 't', 'a'
+    };
+    unsigned char huge[] = {
+        0x00, 0x00, 0x01, 0x00, 0xff, 0xff, 0xff, 0xff, 'a'
+    };
+    unsigned char adw[] = {
+        0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x05, 0x00, 0x00, 0x00,
+        0x06, 0x00, 0x00, 0x00
+    };
+    int fails;
+
+    fails = check("truncated ASY refused",
+        parse_prefixes("ASY", asy, sizeof(asy)) == sizeof(asy));
+    fails += check("  truncated ADR refused",
+        parse_prefixes("ADR", adr, sizeof(adr)) == sizeof(adr));
+    fails += check("  truncated AIG refused",
+        parse_prefixes("AIG", aig, sizeof(aig)) == sizeof(aig));
+    fails += check("  truncated AGE refused",
+        parse_prefixes("AGE", age, sizeof(age)) == sizeof(age));
+    fails += check("  truncated ADW sync id list refused",
+        parse_prefixes("ADW", adw, sizeof(adw)) == sizeof(adw));
+    fails += check("  ADR param longer than the content refused",
+        parse_prefixes("ADR", huge, sizeof(huge)) == sizeof(huge) + 1);
+
+    return fails;
+}
+
+static int test_asy_storage(void) {
+    unsigned char asy[] = {
+        0x01, 0x02, 0x00, 0x01, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00,
+        0x02, 0x01, 0x00, 0x03, 0x00, 0x00, 0x00,
+        0x03, 0x00, 0x00
+    };
+    struct zdtm_asy_msg_content cont;
+    uint32_t ids[4];
+    size_t num_ids;
+    int fails;
+
+    fails = check("ASY counted",
+        (zdtm_count_asy_msg(asy, sizeof(asy), &num_ids) == 0) &&
+        (num_ids == 3));
+    fails += check("  ASY into small storage refused",
+        zdtm_decode_asy_msg(asy, sizeof(asy), &cont, ids, 2) == -1);
+    fails += check("  truncated ASY into storage refused",
+        zdtm_decode_asy_msg(asy, sizeof(asy) - 1, &cont, ids, 4) ==
+        RET_BAD_SIZE);
+    fails += check("  ASY decoded into storage",
+        (zdtm_decode_asy_msg(asy, sizeof(asy), &cont, ids, 4) == 0) &&
+        (cont.new_sync_ids == ids) && (cont.num_new_sync_ids == 2) &&
+        (cont.mod_sync_ids == ids + 2) && (cont.num_mod_sync_ids == 1) &&
+        (cont.del_sync_ids == ids + 3) && (cont.num_del_sync_ids == 0) &&
+        (cont.del_list_id == 0x03) && (ids[0] == 1) && (ids[1] == 2) &&
+        (ids[2] == 3));
+
+    return fails;
+}
+
+int main(int argc, char *argv[]) {
+    int fails;
+
+    fails = 0;
+    fails += test_cursor();
+    fails += test_prepare();
+    fails += test_write();
+    fails += test_write_format();
+    fails += test_truncated();
+    fails += test_asy_storage();
+
+    printf("%d failure(s)\n", fails);
+
+    return fails ? 1 : 0;
+}
@@ -0,0 +1,263 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+
+
+/*
+ * This program checks compact Address items. An Address item is packed
+ * into a single allocation with every field kept, packed straight from
+ * the params of an item the same as from the item they parse into,
+ * viewed back as an Address item without copying, and refused when its
+ * strings do not fit the 16 bit offsets.
+ */
+
+#include "zdtm_sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define COMPACT_NUM_PARAMS (4 + ZDTM_ADDR_NUM_FIELDS + 1)
+
+/* Abbreviations of the string fields, in the order of the fields. */
+static const char *abrevs[ZDTM_ADDR_NUM_FIELDS] = {"CTGR", "FULL", "NAPR",
+    "TITL", "LNME", "FNME", "MNME", "SUFX", "FLAS", "LNPR", "FNPR", "CPNY",
+    "CPPR", "SCTN", "PSTN", "TEL2", "FAX2", "CPS2", "BSTA", "BCTY", "BSTR",
+    "BZIP", "BCTR", "BWEB", "OFCE", "PRFS", "ASST", "MNGR", "BPGR", "CPS1",
+    "TEL1", "FAX1", "HSTA", "HCTY", "HSTR", "HZIP", "HCTR", "HWEB", "DMAL",
+    "MAL1", "SPUS", "GNDR", "BRTH", "ANIV", "NCNM", "CLDR", "MEM1", "GRPS"};
+
+static char strs[ZDTM_ADDR_NUM_FIELDS][ZDTM_ADDR_NUM_FIELDS];
+
+/* An Address item whose field f is f bytes of value 'A' + f. */
+static void build_item(struct zdtm_address_item *p_item) {
+    int f;
+
+    memset(p_item, 0, sizeof(struct zdtm_address_item));
+    p_item->sync_id = 0x01020304;
+    p_item->attribute = 0x05;
+    memcpy(p_item->creation_date, "\x01\x02\x03\x04\x05", 5);
+    memcpy(p_item->modification_date, "\x06\x07\x08\x09\x0a", 5);
+    for (f = 0; f < ZDTM_ADDR_NUM_FIELDS; f++) {
+        memset(strs[f], 'A' + f, f);
+    }
+
+    p_item->category = strs[0];             p_item->category_len = 0;
+    p_item->full_name = strs[1];            p_item->full_name_len = 1;
+    p_item->title = strs[3];                p_item->title_len = 3;
+    p_item->last_name = strs[4];            p_item->last_name_len = 4;
+    p_item->first_name = strs[5];           p_item->first_name_len = 5;
+    p_item->company = strs[11];             p_item->company_len = 11;
+    p_item->work_phone = strs[15];          p_item->work_phone_len = 15;
+    p_item->home_city = strs[33];           p_item->home_city_len = 33;
+    p_item->default_email = strs[38];       p_item->default_email_len = 38;
+    p_item->memo = strs[46];                p_item->memo_len = 46;
+    p_item->group = strs[47];               p_item->group_len = 47;
+}
+
+/* Whether field f of a compact Address item is that of build_item(). */
+static int field_ok(const zdtm_compact_address *p_compact, int f) {
+    static const int set[] = {1, 3, 4, 5, 11, 15, 33, 38, 46, 47};
+    const char *str;
+    uint16_t len;
+    size_t i;
+
+    str = zdtm_compact_address_field(p_compact, f, &len);
+    for (i = 0; i < sizeof(set) / sizeof(set[0]); i++) {
+        if (set[i] == f) {
+            return (len == f) && (memcmp(str, strs[f], len) == 0);
+        }
+    }
+
+    return len == 0;
+}
+
+static int header_ok(const zdtm_compact_address *p_compact) {
+    return (p_compact->sync_id == 0x01020304) &&
+        (p_compact->attribute == 0x05) &&
+        (memcmp(p_compact->creation_date, "\x01\x02\x03\x04\x05", 5) == 0) &&
+        (memcmp(p_compact->modification_date,
+            "\x06\x07\x08\x09\x0a", 5) == 0);
+}
+
+static int test_item(void) {
+    struct zdtm_address_item item, view;
+    zdtm_compact_address *p_compact, *p_again;
+    int f, ok, fails;
+
+    build_item(&item);
+    ok = (zdtm_compact_address_from_item(&item, &p_compact) == 0) &&
+        header_ok(p_compact);
+    for (f = 0; ok && (f < ZDTM_ADDR_NUM_FIELDS); f++) {
+        ok = field_ok(p_compact, f);
+    }
+    fails = check("Address item packed, every field kept", ok);
+    fails += check("  strings packed back to back",
+        p_compact->offsets[ZDTM_ADDR_NUM_FIELDS] ==
+        1 + 3 + 4 + 5 + 11 + 15 + 33 + 38 + 46 + 47);
+
+    zdtm_compact_address_view(p_compact, &view);
+    ok = (view.sync_id == item.sync_id) &&
+        (view.attribute == item.attribute) &&
+        (memcmp(view.modification_date, item.modification_date, 5) == 0) &&
+        (view.company_len == 11) &&
+        (view.company == p_compact->strings + p_compact->offsets[11]) &&
+        (view.group_len == 47) && (view.full_name_pronun_len == 0) &&
+        (zdtm_address_length(&view) == zdtm_address_length(&item));
+    fails += check("  viewed as an Address item without copying", ok);
+
+    ok = (zdtm_compact_address_from_item(&view, &p_again) == 0) &&
+        (memcmp(p_compact, p_again, sizeof(zdtm_compact_address) +
+            p_compact->offsets[ZDTM_ADDR_NUM_FIELDS]) == 0);
+    fails += check("  view packed again the same", ok);
+
+    free(p_compact);
+    free(p_again);
+
+    return fails;
+}
+
+static int same(const zdtm_compact_address *p_a,
+    const zdtm_compact_address *p_b) {
+    return memcmp(p_a, p_b, sizeof(zdtm_compact_address) +
+        p_a->offsets[ZDTM_ADDR_NUM_FIELDS]) == 0;
+}
+
+static int test_params(void) {
+    struct zdtm_adi_msg_param format[COMPACT_NUM_PARAMS];
+    struct zdtm_adr_msg_param params[COMPACT_NUM_PARAMS];
+    struct zdtm_address_item item, parsed;
+    zdtm_compact_address *p_compact, *p_item_compact, *p_parsed;
+    unsigned char syid[4];
+    uint16_t len;
+    int i, f, fails;
+
+    /* The header params followed by the string ones last to first, and
+     * a param the library has no member for. */
+    memset(format, 0, sizeof(format));
+    memcpy(format[0].abrev, "ATTR", 4);
+    format[0].type_id = DATA_ID_BIT;
+    memcpy(format[1].abrev, "CTTM", 4);
+    format[1].type_id = DATA_ID_TIME;
+    memcpy(format[2].abrev, "MDTM", 4);
+    format[2].type_id = DATA_ID_TIME;
+    memcpy(format[3].abrev, "SYID", 4);
+    format[3].type_id = DATA_ID_ULONG;
+    for (f = 0; f < ZDTM_ADDR_NUM_FIELDS; f++) {
+        i = 4 + ZDTM_ADDR_NUM_FIELDS - 1 - f;
+        memcpy(format[i].abrev, abrevs[f], 4);
+        format[i].type_id = (f == 0) ? DATA_ID_BARRAY : DATA_ID_UTF8;
+    }
+    memcpy(format[COMPACT_NUM_PARAMS - 1].abrev, "XUNK", 4);
+    format[COMPACT_NUM_PARAMS - 1].type_id = DATA_ID_UTF8;
+
+    /* The params of the item, taken from its compact form. */
+    build_item(&item);
+    zdtm_compact_address_from_item(&item, &p_item_compact);
+    zdtm_put_le32(syid, item.sync_id);
+    params[0].param_len = 1;
+    params[0].param_data = &p_item_compact->attribute;
+    params[1].param_len = 5;
+    params[1].param_data = (unsigned char *)p_item_compact->creation_date;
+    params[2].param_len = 5;
+    params[2].param_data =
+        (unsigned char *)p_item_compact->modification_date;
+    params[3].param_len = 4;
+    params[3].param_data = syid;
+    for (f = 0; f < ZDTM_ADDR_NUM_FIELDS; f++) {
+        i = 4 + ZDTM_ADDR_NUM_FIELDS - 1 - f;
+        params[i].param_data = (unsigned char *)zdtm_compact_address_field(
+            p_item_compact, f, &len);
+        params[i].param_len = len;
+    }
+    params[COMPACT_NUM_PARAMS - 1].param_len = 4;
+    params[COMPACT_NUM_PARAMS - 1].param_data = (unsigned char *)"junk";
+
+    fails = check("Address item packed straight from params",
+        (zdtm_compact_address_from_params(format, COMPACT_NUM_PARAMS,
+            params, COMPACT_NUM_PARAMS, &p_compact) == 0) &&
+        same(p_compact, p_item_compact));
+
+    memset(&parsed, 0, sizeof(struct zdtm_address_item));
+    fails += check("  same as packing the item the params parse into",
+        (_zdtm_map_address_item_params(format, COMPACT_NUM_PARAMS, params,
+            COMPACT_NUM_PARAMS, &parsed, 0) == 0) &&
+        (zdtm_compact_address_from_item(&parsed, &p_parsed) == 0) &&
+        same(p_compact, p_parsed));
+    free(p_parsed);
+    free(p_compact);
+
+    fails += check("  item of another format refused",
+        zdtm_compact_address_from_params(format, COMPACT_NUM_PARAMS,
+            params, COMPACT_NUM_PARAMS - 1, &p_compact) == -1);
+
+    /* A category of another data type is no category. */
+    format[4 + ZDTM_ADDR_NUM_FIELDS - 1].type_id = DATA_ID_UTF8;
+    params[4 + ZDTM_ADDR_NUM_FIELDS - 1].param_len = 3;
+    fails += check("  param of another data type skipped",
+        (zdtm_compact_address_from_params(format, COMPACT_NUM_PARAMS,
+            params, COMPACT_NUM_PARAMS, &p_compact) == 0) &&
+        (p_compact->offsets[ZDTM_ADDR_CATEGORY + 1] == 0) &&
+        same(p_compact, p_item_compact));
+    free(p_compact);
+
+    free(p_item_compact);
+
+    return fails;
+}
+
+static int test_limit(void) {
+    struct zdtm_address_item item;
+    zdtm_compact_address *p_compact;
+    char *big;
+    int fails;
+
+    big = calloc(0x10000, 1);
+    build_item(&item);
+    item.memo = big;
+    item.memo_len = 0xffff - (item.group_len + item.default_email_len +
+        item.home_city_len + item.work_phone_len + item.company_len +
+        item.first_name_len + item.last_name_len + item.title_len +
+        item.full_name_len);
+    fails = check("strings of 0xffff bytes packed",
+        (zdtm_compact_address_from_item(&item, &p_compact) == 0) &&
+        (p_compact->offsets[ZDTM_ADDR_NUM_FIELDS] == 0xffff));
+    free(p_compact);
+
+    item.memo_len++;
+    fails += check("  strings over 0xffff bytes refused",
+        zdtm_compact_address_from_item(&item, &p_compact) == -1);
+
+    free(big);
+
+    return fails;
+}
+
+int main(void) {
+    int fails;
+
+    fails = test_item();
+    fails += test_params();
+    fails += test_limit();
+
+    printf("%d failure(s)\n", fails);
+
+    return fails ? 1 : 0;
+}
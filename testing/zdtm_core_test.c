@@ -0,0 +1,250 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+/*
+ * This program exercises the sans-I/O protocol core without a socket.
+ * Each protocol step is run against a scripted stream of bytes from a
+ * simulated Zaurus, which is fed to the core in chunks of various sizes
+ * down to a single byte, and the bytes produced by the core are
+ * checked against what the Zaurus expects.
+ */
+
+#include "zdtm_sync.h"
+#include "zdtm_sim.h"
+#include <stdio.h>
+
+static const unsigned char ack[COM_MSG_SIZE] =
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x96, 0x06};
+static const unsigned char rqst[COM_MSG_SIZE] =
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x96, 0x05};
+static const unsigned char abrt[COM_MSG_SIZE] =
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x96, 0x18};
+
+struct script {
+    unsigned char in[2048];     // bytes sent by the Zaurus
+    int in_size;
+    unsigned char out[2048];    // bytes received by the Zaurus
+    int out_size;
+};
+
+static void put_u16(unsigned char *p, uint16_t v) {
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+}
+
+static void add_bytes(struct script *s, const unsigned char *buf, int size) {
+    memcpy(s->in + s->in_size, buf, size);
+    s->in_size += size;
+}
+
+static void add_msg(struct script *s, const char *type,
+    const unsigned char *cont, int cont_size) {
+
+    unsigned char *buf;
+    uint16_t sum;
+    int i;
+
+    buf = s->in + s->in_size;
+    memcpy(buf, ZMSG_HDR, MSG_HDR_SIZE);
+    put_u16(buf + MSG_HDR_CONT_OFFSET, cont_size);
+    put_u16(buf + MSG_HDR_SIZE, MSG_TYPE_SIZE + cont_size);
+    memcpy(buf + MSG_HDR_SIZE + 2, type, MSG_TYPE_SIZE);
+    memcpy(buf + MSG_HDR_SIZE + 2 + MSG_TYPE_SIZE, cont, cont_size);
+    sum = 0;
+    for (i = 0; i < MSG_TYPE_SIZE + cont_size; i++) {
+        sum += buf[MSG_HDR_SIZE + 2 + i];
+    }
+    put_u16(buf + MSG_HDR_SIZE + 2 + MSG_TYPE_SIZE + cont_size, sum);
+    s->in_size += MSG_HDR_SIZE + 2 + MSG_TYPE_SIZE + cont_size + 2;
+}
+
+/* Run the core until it is done, feeding it the script input in chunks
+ * of the given size and collecting its output. */
+static int run(zdtm_core *p_core, struct script *s, int chunk) {
+    const unsigned char *p_out;
+    uint32_t size;
+    int in_off, n;
+
+    in_off = 0;
+    s->out_size = 0;
+    while (!p_core->done) {
+        size = _zdtm_core_output(p_core, &p_out);
+        if (size > 0) {
+            if (size > 2) {
+                size = size - 2;    // exercise partial writes
+            }
+            memcpy(s->out + s->out_size, p_out, size);
+            s->out_size += size;
+            _zdtm_core_written(p_core, size);
+            continue;
+        }
+
+        if (in_off == s->in_size) {
+            _zdtm_core_abort(p_core, ZDTM_CORE_EOF);
+            continue;
+        }
+
+        n = s->in_size - in_off;
+        if (n > chunk) {
+            n = chunk;
+        }
+        in_off += _zdtm_core_input(p_core, s->in + in_off, n);
+    }
+
+    return p_core->retval;
+}
+
+/* The Zaurus side of a wrapped send of a message by the Desktop. */
+static int out_is_sent_msg(struct script *s, int off, const char *type) {
+    if (memcmp(s->out + off + MSG_HDR_SIZE + 2, type, MSG_TYPE_SIZE) != 0) {
+        return -1;
+    }
+    return off + MSG_HDR_SIZE + 2 + s->out[off + MSG_HDR_SIZE] +
+        (s->out[off + MSG_HDR_SIZE + 1] << 8) + 2;
+}
+
+static int test_obtain_item(zdtm_lib_env *env, int chunk) {
+    struct script s;
+    unsigned char adr[1024];
+    zdtm_core core;
+    char name[64];
+    int r, off, fails;
+
+    memset(&s, 0, sizeof(s));
+    adr[0] = 0x00;
+    adr[1] = 0x00;
+    r = zdtm_sim_build_item(42, 0, adr + 2, sizeof(adr) - 2);
+    add_bytes(&s, rqst, COM_MSG_SIZE);
+    add_bytes(&s, ack, COM_MSG_SIZE);
+    add_msg(&s, ADR_MSG_TYPE, adr, r + 2);
+
+    _zdtm_core_init(&core, env);
+    core.sync_id = 42;
+    _zdtm_core_start(&core, _zdtm_step_obtain_item);
+    r = run(&core, &s, chunk);
+
+    fails = 0;
+    snprintf(name, sizeof(name), "obtain item, chunks of %d", chunk);
+    fails += check(name, r == 0 && core.params != NULL &&
+        core.num_params > 0);
+    off = out_is_sent_msg(&s, 0, RDR_MSG_TYPE);
+    fails += check("  RDR then rqst then ack written", off > 0 &&
+        (s.out_size == off + 2 * COM_MSG_SIZE) &&
+        (memcmp(s.out + off, rqst, COM_MSG_SIZE) == 0) &&
+        (memcmp(s.out + off + COM_MSG_SIZE, ack, COM_MSG_SIZE) == 0));
+
+    if (core.params != NULL) {
+        _zdtm_free_params(env, core.params, core.num_params);
+    }
+    _zdtm_core_cleanup(&core);
+
+    return fails;
+}
+
+static int test_sync_state(zdtm_lib_env *env) {
+    struct script s;
+    unsigned char amg[49];
+    zdtm_core core;
+    int r, fails;
+
+    memset(&s, 0, sizeof(s));
+    memset(amg, 0, sizeof(amg));
+    amg[2] = AMG_CAL_MASK;
+    add_bytes(&s, rqst, COM_MSG_SIZE);
+    add_bytes(&s, ack, COM_MSG_SIZE);
+    add_msg(&s, AMG_MSG_TYPE, amg, sizeof(amg));
+
+    env->todo_slow_sync_required = 0;
+    env->calendar_slow_sync_required = 0;
+    env->address_book_slow_sync_required = 0;
+
+    _zdtm_core_init(&core, env);
+    _zdtm_core_start(&core, _zdtm_step_sync_state);
+    r = run(&core, &s, 5);
+    _zdtm_core_cleanup(&core);
+
+    fails = check("sync state", r == 0);
+    fails += check("  slow sync flags from AMG",
+        env->todo_slow_sync_required && !env->calendar_slow_sync_required &&
+        env->address_book_slow_sync_required);
+
+    return fails;
+}
+
+static int test_auth_denied(zdtm_lib_env *env) {
+    struct script s;
+    zdtm_core core;
+    int r;
+
+    memset(&s, 0, sizeof(s));
+    add_bytes(&s, rqst, COM_MSG_SIZE);
+    add_bytes(&s, ack, COM_MSG_SIZE);
+    add_bytes(&s, abrt, COM_MSG_SIZE);
+    add_msg(&s, ANG_MSG_TYPE, (const unsigned char *)"", 1);
+
+    _zdtm_core_init(&core, env);
+    core.passcode = "1234";
+    _zdtm_core_start(&core, _zdtm_step_authenticate);
+    r = run(&core, &s, 1);
+    _zdtm_core_cleanup(&core);
+
+    return check("authenticate, abort then ANG is denied", r == 1);
+}
+
+static int test_truncated(zdtm_lib_env *env) {
+    struct script s;
+    zdtm_core core;
+    int r;
+
+    memset(&s, 0, sizeof(s));
+    add_bytes(&s, rqst, COM_MSG_SIZE);
+    add_bytes(&s, ack, COM_MSG_SIZE);
+    add_msg(&s, AEX_MSG_TYPE, (const unsigned char *)"", 0);
+    s.in_size -= 3;
+
+    _zdtm_core_init(&core, env);
+    core.sync_id = 7;
+    _zdtm_core_start(&core, _zdtm_step_delete_item);
+    r = run(&core, &s, 4);
+    _zdtm_core_cleanup(&core);
+
+    return check("delete item, closed in the mid of AEX", r == -2);
+}
+
+int main(int argc, char *argv[]) {
+    zdtm_lib_env env;
+    int fails;
+
+    memset(&env, 0, sizeof(zdtm_lib_env));
+    env.sync_type = SYNC_TODO;
+
+    fails = 0;
+    fails += test_obtain_item(&env, 1);
+    fails += test_obtain_item(&env, 3);
+    fails += test_obtain_item(&env, 4096);
+    fails += test_sync_state(&env);
+    fails += test_auth_denied(&env);
+    fails += test_truncated(&env);
+
+    printf("%d failure(s)\n", fails);
+
+    return fails ? 1 : 0;
+}
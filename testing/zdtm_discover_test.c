@@ -0,0 +1,209 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+
+/*
+ * This program checks device discovery. A range of loopback addresses
+ * is probed with only some of them listening on ZLISTPORT, first just
+ * for the addresses which answer and then identifying simulated
+ * Zaurus devices. It also checks that a range which never answers is
+ * given up on once the time budget is spent, and that a device which
+ * never connects back does not use up the budget of the others.
+ */
+
+#include "zdtm_sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int test_ranges(void) {
+    struct zdtm_discovered *p_found;
+    unsigned int num_found;
+    int fails;
+
+    fails = check("range without a prefix refused",
+        zdtm_discover("127.0.0.0", 100, 0, 0, &p_found, &num_found) == -1);
+    fails += check("  range too large refused",
+        zdtm_discover("10.0.0.0/8", 100, 0, 0, &p_found, &num_found) == -1);
+    fails += check("  invalid address refused",
+        zdtm_discover("127.0.0/24", 100, 0, 0, &p_found, &num_found) == -1);
+    fails += check("  invalid prefix refused",
+        zdtm_discover("127.0.0.0/33", 100, 0, 0, &p_found, &num_found) == -1);
+
+    return fails;
+}
+
+static int test_probe(void) {
+    struct zdtm_discovered *p_found;
+    unsigned int num_found;
+    zdtm_transport *p_tp;
+    SOCKET listen_a, listen_b;
+    double secs;
+    int r, fails;
+
+    /* Only two addresses of the range are listening. */
+    p_tp = zdtm_tcp_transport();
+    if (p_tp->listen(p_tp, "127.0.0.3", ZLISTPORT, &listen_a) != 0) {
+        return check("probe listeners", 0);
+    }
+    if (p_tp->listen(p_tp, "127.0.0.12", ZLISTPORT, &listen_b) != 0) {
+        p_tp->close(p_tp, listen_a);
+        return check("probe listeners", 0);
+    }
+
+    secs = now();
+    r = zdtm_discover("127.0.0.0/28", 2000, 4, 0, &p_found, &num_found);
+    secs = now() - secs;
+    fails = check("listening addresses found", (r == 0) &&
+        (num_found == 2) && (strcmp(p_found[0].zaurus_ip, "127.0.0.3") == 0) &&
+        (strcmp(p_found[1].zaurus_ip, "127.0.0.12") == 0) &&
+        !p_found[0].identified && !p_found[1].identified);
+    free(p_found);
+    printf("  probed 14 addresses in %.3f s\n", secs);
+
+    r = zdtm_discover("127.0.0.12/32", 2000, 0, 0, &p_found, &num_found);
+    fails += check("  single address found", (r == 0) &&
+        (num_found == 1) && (strcmp(p_found[0].zaurus_ip, "127.0.0.12") == 0));
+    free(p_found);
+
+    p_tp->close(p_tp, listen_a);
+    p_tp->close(p_tp, listen_b);
+
+    return fails;
+}
+
+static int test_identify(void) {
+    struct zdtm_discovered *p_found;
+    unsigned int num_found, i;
+    struct zdtm_sim sim_a, sim_b;
+    int r, r_a, r_b, identified;
+
+    memset(&sim_a, 0, sizeof(struct zdtm_sim));
+    memset(&sim_b, 0, sizeof(struct zdtm_sim));
+    strcpy(sim_a.zaurus_ip, "127.0.0.5");
+    strcpy(sim_b.zaurus_ip, "127.0.0.9");
+    if (zdtm_sim_start(&sim_a) != 0) {
+        return check("devices identified", 0);
+    }
+    if (zdtm_sim_start(&sim_b) != 0) {
+        zdtm_sim_wait(&sim_a);
+        return check("devices identified", 0);
+    }
+
+    r = zdtm_discover("127.0.0.0/28", 5000, 0, 1, &p_found, &num_found);
+    identified = 0;
+    for (i = 0; (r == 0) && (i < num_found); i++) {
+        if (p_found[i].identified &&
+            (strcmp(p_found[i].model, "SL-C3200") == 0) &&
+            (strcmp(p_found[i].language, "EN") == 0)) {
+            identified++;
+        }
+    }
+    free(p_found);
+
+    r_a = zdtm_sim_wait(&sim_a);
+    r_b = zdtm_sim_wait(&sim_b);
+
+    return check("devices identified", (r == 0) && (num_found == 2) &&
+        (identified == 2)) + check("  sessions quit cleanly",
+        (r_a == 0) && (r_b == 0));
+}
+
+static int test_silent(void) {
+    struct zdtm_discovered *p_found;
+    unsigned int num_found;
+    struct zdtm_sim sim;
+    zdtm_transport *p_tp;
+    SOCKET listenfd;
+    double secs;
+    int r, r_sim, fails;
+
+    /* The first address answers the probe but is not a Zaurus, hence
+     * never connects back when asked to identify itself. */
+    p_tp = zdtm_tcp_transport();
+    if (p_tp->listen(p_tp, "127.0.0.3", ZLISTPORT, &listenfd) != 0) {
+        return check("silent device listener", 0);
+    }
+
+    memset(&sim, 0, sizeof(struct zdtm_sim));
+    strcpy(sim.zaurus_ip, "127.0.0.9");
+    if (zdtm_sim_start(&sim) != 0) {
+        p_tp->close(p_tp, listenfd);
+        return check("silent device listener", 0);
+    }
+
+    secs = now();
+    r = zdtm_discover("127.0.0.0/28", 2000, 0, 1, &p_found, &num_found);
+    secs = now() - secs;
+    fails = check("silent device leaves time for the next", (r == 0) &&
+        (num_found == 2) && !p_found[0].identified &&
+        p_found[1].identified &&
+        (strcmp(p_found[1].zaurus_ip, "127.0.0.9") == 0));
+    fails += check("  time budget kept", secs < 2.5);
+    free(p_found);
+
+    r_sim = zdtm_sim_wait(&sim);
+    fails += check("  session quit cleanly", r_sim == 0);
+    p_tp->close(p_tp, listenfd);
+
+    return fails;
+}
+
+static int test_budget(void) {
+    struct zdtm_discovered *p_found;
+    unsigned int num_found;
+    double secs;
+    int r;
+
+    /* Nothing answers from the benchmarking range, whether the connects
+     * fail at once or are left hanging. */
+    secs = now();
+    r = zdtm_discover("198.18.0.0/22", 300, 0, 0, &p_found, &num_found);
+    secs = now() - secs;
+    free(p_found);
+
+    return check("time budget kept", (r == 0) && (num_found == 0) &&
+        (secs < 1.0));
+}
+
+int main(int argc, char *argv[]) {
+    int fails;
+
+    fails = 0;
+    fails += test_ranges();
+    fails += test_probe();
+    fails += test_identify();
+    fails += test_silent();
+    fails += test_budget();
+
+    printf("%d failure(s)\n", fails);
+
+    return fails ? 1 : 0;
+}
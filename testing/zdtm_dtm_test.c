@@ -0,0 +1,339 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+
+/*
+ * This program checks the parsing of DTM box records. A record whose
+ * length leaves no room for its parameter count, or whose parameters
+ * run past its length, is refused rather than read past, by the record
+ * parser, by the decoding of a whole DTM box, and by the reading of
+ * hand-built DTM box and index files.
+ */
+
+#include "zdtm_sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_PARAMS 4
+#define BOX_PATH "/tmp/zdtm_dtm_test.box"
+#define IDX_PATH "/tmp/zdtm_dtm_test.idx"
+
+/* A Todo record of a SYID and a MARK param, 19 bytes long. */
+static uint32_t put_record(unsigned char *p, uint32_t sync_id,
+    unsigned char progress) {
+
+    zdtm_put_le32(p, 15);
+    zdtm_put_le16(p + 4, 2);
+    zdtm_put_le32(p + 6, 4);
+    zdtm_put_le32(p + 10, sync_id);
+    zdtm_put_le32(p + 14, 1);
+    p[18] = progress;
+
+    return 19;
+}
+
+static int parse(const unsigned char *buf, uint32_t size) {
+    struct zdtm_adr_msg_param params[MAX_PARAMS];
+    uint16_t num_params;
+    uint32_t rec_size;
+
+    return _zdtm_dtm_parse_record(buf, size, params, MAX_PARAMS,
+        &num_params, &rec_size);
+}
+
+static int test_parse(void) {
+    struct zdtm_adr_msg_param params[MAX_PARAMS];
+    unsigned char buf[64];
+    uint16_t num_params;
+    uint32_t rec_size, size, i;
+    int fails, ok;
+
+    size = put_record(buf, 7, 3);
+    fails = check("record parsed",
+        (_zdtm_dtm_parse_record(buf, size, params, MAX_PARAMS,
+            &num_params, &rec_size) == 0) &&
+        (num_params == 2) && (rec_size == size) &&
+        (params[0].param_len == 4) && (params[1].param_len == 1) &&
+        (params[1].param_data == buf + 18));
+
+    ok = 1;
+    for (i = 0; i < size; i++) {
+        ok = ok && (parse(buf, i) == -1);
+    }
+    fails += check("  record cut short at every byte refused", ok);
+
+    /* A rec_len too short to hold the parameter count itself. */
+    zdtm_put_le32(buf, 0);
+    fails += check("  rec_len of zero refused", parse(buf, size) == -1);
+    zdtm_put_le32(buf, 1);
+    fails += check("  rec_len of one refused", parse(buf, size) == -1);
+    zdtm_put_le32(buf, 5);
+    fails += check("  rec_len short of a param length refused",
+        parse(buf, size) == -1);
+    zdtm_put_le32(buf, 16);
+    fails += check("  rec_len past the buffer refused",
+        parse(buf, size) == -1);
+
+    size = put_record(buf, 7, 3);
+    zdtm_put_le32(buf + 6, 0xffffffff);
+    fails += check("  param_len overflowing the record refused",
+        parse(buf, size) == -1);
+    zdtm_put_le32(buf + 6, 0xfffffffc);
+    fails += check("  param_len wrapping the position refused",
+        parse(buf, size) == -1);
+
+    size = put_record(buf, 7, 3);
+    zdtm_put_le32(buf + 14, 2);
+    fails += check("  last param_len one past the record refused",
+        parse(buf, size) == -1);
+
+    size = put_record(buf, 7, 3);
+    zdtm_put_le16(buf + 4, MAX_PARAMS + 1);
+    fails += check("  more params than room for refused",
+        parse(buf, size) == -1);
+
+    return fails;
+}
+
+static int count_item(struct zdtm_item *p_item, void *arg) {
+    (*(int *)arg)++;
+    zdtm_clean_item(p_item);
+    return 0;
+}
+
+static int test_decode_box(void) {
+    zdtm_lib_env cur_env;
+    struct zdtm_adi_msg_param format[2];
+    unsigned char buf[64];
+    uint32_t size;
+    int fails, count;
+
+    memset(&cur_env, 0, sizeof(zdtm_lib_env));
+    memset(format, 0, sizeof(format));
+    memcpy(format[0].abrev, "SYID", 4);
+    format[0].type_id = DATA_ID_ULONG;
+    memcpy(format[1].abrev, "MARK", 4);
+    format[1].type_id = DATA_ID_UCHAR;
+    cur_env.sync_type = SYNC_TYPE_TODO;
+    cur_env.params = format;
+    cur_env.num_params = 2;
+
+    size = put_record(buf, 7, 3);
+    size += put_record(buf + size, 8, 4);
+    count = 0;
+    fails = check("box decoded",
+        (zdtm_dtm_decode_box(&cur_env, buf, size, count_item, &count) ==
+            0) && (count == 2));
+
+    /* A second record with only its param count, rec_len 1. */
+    size = put_record(buf, 7, 3);
+    zdtm_put_le32(buf + size, 1);
+    zdtm_put_le16(buf + size + 4, 2);
+    count = 0;
+    fails += check("  truncated rec_len in a box refused",
+        (zdtm_dtm_decode_box(&cur_env, buf, size + 6, count_item, &count) ==
+            -2) && (count == 1));
+
+    size = put_record(buf, 7, 3);
+    size += put_record(buf + size, 8, 4);
+    zdtm_put_le32(buf + 19 + 14, 0xffffffff);
+    count = 0;
+    fails += check("  param_len overflow in a box refused",
+        (zdtm_dtm_decode_box(&cur_env, buf, size, count_item, &count) ==
+            -2) && (count == 1));
+
+    count = 0;
+    fails += check("  box cut inside a record refused",
+        (zdtm_dtm_decode_box(&cur_env, buf, 19 + 3, count_item, &count) ==
+            -2) && (count == 1));
+
+    return fails;
+}
+
+/* Write a whole file. */
+static int store(const char *path, const unsigned char *buf, uint32_t size) {
+    FILE *fp;
+    int r;
+
+    fp = fopen(path, "wb");
+    if (fp == NULL) {
+        return -1;
+    }
+    r = (fwrite(buf, 1, size, fp) == size) ? 0 : -1;
+    fclose(fp);
+
+    return r;
+}
+
+/* An index of the given entries, pairs of sync id and box offset. */
+static uint32_t put_index(unsigned char *p, const uint32_t *entries,
+    uint32_t num_entries) {
+
+    uint32_t i;
+
+    zdtm_put_le32(p, num_entries);
+    for (i = 0; i < (2 * num_entries); i++) {
+        zdtm_put_le32(p + sizeof(uint32_t) + (i * sizeof(uint32_t)),
+            entries[i]);
+    }
+
+    return sizeof(uint32_t) + (2 * num_entries * sizeof(uint32_t));
+}
+
+/* Open the database of the box and index, and walk all of its records
+ * returning the result of the last zdtm_dtm_next_record() call. */
+static int walk(const unsigned char *box, uint32_t box_size,
+    const unsigned char *idx, uint32_t idx_size, zdtm_dtm_db **pp_db,
+    int *p_count) {
+
+    struct zdtm_dtm_record rec;
+    uint32_t cursor;
+    int r;
+
+    (*pp_db) = NULL;
+    if ((store(BOX_PATH, box, box_size) != 0) ||
+        (store(IDX_PATH, idx, idx_size) != 0)) {
+        return -10;
+    }
+    r = zdtm_dtm_open(BOX_PATH, IDX_PATH, pp_db);
+    if (r != 0) {
+        return r - 10;
+    }
+
+    (*p_count) = 0;
+    cursor = 0;
+    while ((r = zdtm_dtm_next_record((*pp_db), &cursor, &rec)) == 0) {
+        (*p_count)++;
+    }
+
+    return r;
+}
+
+static int test_files(void) {
+    zdtm_dtm_db *p_db;
+    struct zdtm_dtm_record rec;
+    struct zdtm_adi_msg_param format[2];
+    const unsigned char *data;
+    uint32_t len;
+    unsigned char box[64], idx[64];
+    uint32_t entries[4];
+    uint32_t box_size, idx_size;
+    int fails, count, r;
+
+    memset(&rec, 0, sizeof(struct zdtm_dtm_record));
+    box_size = put_record(box, 7, 3);
+    box_size += put_record(box + box_size, 8, 4);
+    entries[0] = 7;
+    entries[1] = 0;
+    entries[2] = 8;
+    entries[3] = 19;
+    idx_size = put_index(idx, entries, 2);
+    r = walk(box, box_size, idx, idx_size, &p_db, &count);
+    fails = check("files walked", (r == 1) && (count == 2));
+    fails += check("  record found by the index", (p_db != NULL) &&
+        (zdtm_dtm_find_record(p_db, 8, &rec) == 0) &&
+        (rec.offset == 19) && (rec.num_params == 2));
+
+    memset(format, 0, sizeof(format));
+    memcpy(format[0].abrev, "SYID", 4);
+    memcpy(format[1].abrev, "MARK", 4);
+    fails += check("  record field obtained",
+        (zdtm_dtm_record_field(format, 2, &rec, "MARK", &data, &len) == 0) &&
+        (len == 1) && (data[0] == 4));
+    fails += check("  short abbreviation matches no field",
+        zdtm_dtm_record_field(format, 2, &rec, "MAR", &data, &len) == 1);
+    zdtm_dtm_close(p_db);
+
+    /* The second record cut short by the end of the file. */
+    r = walk(box, box_size - 3, idx, idx_size, &p_db, &count);
+    fails += check("  truncated box stops with an error",
+        (r == -1) && (count == 1));
+    fails += check("  truncated record not found by the index",
+        (p_db != NULL) && (zdtm_dtm_find_record(p_db, 8, &rec) == -2));
+    zdtm_dtm_close(p_db);
+
+    /* A box only holding the record length and the parameter count. */
+    r = walk(box, 5, idx, idx_size, &p_db, &count);
+    fails += check("  box shorter than a record header refused",
+        (r == -1) && (count == 0));
+    zdtm_dtm_close(p_db);
+
+    /* The second record has a rec_len of one. */
+    zdtm_put_le32(box + 19, 1);
+    r = walk(box, box_size, idx, idx_size, &p_db, &count);
+    fails += check("  corrupt rec_len stops with an error",
+        (r == -1) && (count == 1));
+    fails += check("  corrupt rec_len not found by the index",
+        (p_db != NULL) && (zdtm_dtm_find_record(p_db, 8, &rec) == -2));
+    zdtm_dtm_close(p_db);
+
+    /* The second record has a param_len running past the file. */
+    box_size = put_record(box, 7, 3);
+    box_size += put_record(box + box_size, 8, 4);
+    zdtm_put_le32(box + 19 + 6, 0xfffffffe);
+    r = walk(box, box_size, idx, idx_size, &p_db, &count);
+    fails += check("  corrupt param_len stops with an error",
+        (r == -1) && (count == 1));
+    zdtm_dtm_close(p_db);
+
+    /* Index entries pointing past the box and into the middle of a
+     * record. */
+    box_size = put_record(box, 7, 3);
+    entries[1] = 64;
+    entries[3] = 5;
+    idx_size = put_index(idx, entries, 2);
+    r = walk(box, box_size, idx, idx_size, &p_db, &count);
+    fails += check("  index offset past the box refused",
+        (r == 1) && (zdtm_dtm_find_record(p_db, 7, &rec) == -2));
+    fails += check("  index offset inside a record refused",
+        zdtm_dtm_find_record(p_db, 8, &rec) == -2);
+    zdtm_dtm_close(p_db);
+
+    /* An index claiming more entries than it holds, or cut short of
+     * its entry count. */
+    zdtm_put_le32(idx, 3);
+    r = walk(box, box_size, idx, idx_size, &p_db, &count);
+    fails += check("  index with too many entries refused",
+        (r == -14) && (p_db == NULL));
+    r = walk(box, box_size, idx, 3, &p_db, &count);
+    fails += check("  index cut short refused",
+        (r == -14) && (p_db == NULL));
+
+    unlink(BOX_PATH);
+    unlink(IDX_PATH);
+
+    return fails;
+}
+
+int main(int argc, char *argv[]) {
+    int fails;
+
+    fails = 0;
+    fails += test_parse();
+    fails += test_decode_box();
+    fails += test_files();
+
+    printf("%d failure(s)\n", fails);
+
+    return fails ? 1 : 0;
+}
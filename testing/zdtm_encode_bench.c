@@ -0,0 +1,141 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+
+/**
+ * @file zdtm_encode_bench.c
+ * @brief This is a benchmark of encoding outgoing messages.
+ *
+ * The zdtm_encode_bench.c file is a benchmark which encodes an RDW
+ * message writing a Todo item, first the way messages used to be
+ * encoded, working out the length, allocating the raw content, writing
+ * it, summing it, and copying it into the frame, and then in a single
+ * pass with _zdtm_encode_message() into a buffer reused across
+ * messages.
+ */
+
+#include "zdtm_sync.h"
+#include "zdtm_core.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define BENCH_ROUNDS 200000
+
+static double now(void) {
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + (tv.tv_usec / 1000000.0);
+}
+
+static void todo_rdw(zdtm_msg *p_msg, char *notes) {
+    memset(p_msg, 0, sizeof(zdtm_msg));
+    memcpy(p_msg->body.type, RDW_MSG_TYPE, MSG_TYPE_SIZE);
+    p_msg->body.cont.rdw.sync_type = SYNC_TYPE_TODO;
+    p_msg->body.cont.rdw.num_sync_ids = 1;
+    p_msg->body.cont.rdw.sync_id = 0x01020304;
+    p_msg->body.cont.rdw.variation = 3;
+    p_msg->body.cont.rdw.vars.three.sync_id = 0x01020304;
+    p_msg->body.cont.rdw.cont.todo.category = "Business";
+    p_msg->body.cont.rdw.cont.todo.category_len = 8;
+    p_msg->body.cont.rdw.cont.todo.description = "Write the report";
+    p_msg->body.cont.rdw.cont.todo.description_len = 16;
+    p_msg->body.cont.rdw.cont.todo.notes = notes;
+    p_msg->body.cont.rdw.cont.todo.notes_len = strlen(notes);
+}
+
+int main(int argc, char *argv[]) {
+    zdtm_lib_env cur_env;
+    zdtm_msg msg;
+    char notes[1024];
+    unsigned char *frame, *p_buf, *p;
+    uint32_t cap, size, frame_size;
+    double start, old_secs, new_secs;
+    int r;
+
+    memset(&cur_env, 0, sizeof(zdtm_lib_env));
+    memset(notes, 'n', sizeof(notes) - 1);
+    notes[sizeof(notes) - 1] = '\0';
+
+    frame = NULL;
+    frame_size = 0;
+    start = now();
+    for (r = 0; r < BENCH_ROUNDS; r++) {
+        todo_rdw(&msg, notes);
+        if (_zdtm_prepare_message(&cur_env, &msg) != 0) {
+            fprintf(stderr, "ERR: _zdtm_prepare_message() failed.\n");
+            return 1;
+        }
+        msg.check_sum = _zdtm_checksum(&msg);
+
+        size = ZDTM_MSG_OVERHEAD + msg.cont_size;
+        frame = realloc(frame, size);
+        if (frame == NULL) {
+            fprintf(stderr, "ERR: failed to allocate memory.\n");
+            return 1;
+        }
+        p = frame;
+        memcpy(p, msg.header, MSG_HDR_SIZE);
+        p += MSG_HDR_SIZE;
+        zdtm_put_le16(p, msg.body_size);
+        p += 2;
+        memcpy(p, msg.body.type, MSG_TYPE_SIZE);
+        p += MSG_TYPE_SIZE;
+        memcpy(p, msg.body.p_raw_content, msg.cont_size);
+        p += msg.cont_size;
+        zdtm_put_le16(p, msg.check_sum);
+        frame_size = size;
+        _zdtm_clean_message(&msg);
+    }
+    old_secs = now() - start;
+
+    p_buf = NULL;
+    cap = 0;
+    start = now();
+    for (r = 0; r < BENCH_ROUNDS; r++) {
+        todo_rdw(&msg, notes);
+        if (_zdtm_encode_message(&cur_env, &msg, &p_buf, &cap, &size) != 0) {
+            fprintf(stderr, "ERR: _zdtm_encode_message() failed.\n");
+            return 1;
+        }
+    }
+    new_secs = now() - start;
+
+    if ((size != frame_size) || (memcmp(p_buf, frame, size) != 0)) {
+        fprintf(stderr, "ERR: the encodings disagree.\n");
+        return 2;
+    }
+
+    printf("RDW of a Todo item, %u bytes, %d messages\n", size,
+        BENCH_ROUNDS);
+    printf("length, allocate, write, sum, copy  %8.3f s %10.0f msgs/s\n",
+        old_secs, BENCH_ROUNDS / old_secs);
+    printf("single pass into reused buffer      %8.3f s %10.0f msgs/s\n",
+        new_secs, BENCH_ROUNDS / new_secs);
+    printf("speedup: %.1fx\n", old_secs / new_secs);
+
+    free(p_buf);
+    free(frame);
+
+    return 0;
+}
@@ -0,0 +1,210 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+
+/**
+ * @file zdtm_endian_bench.c
+ * @brief This is a benchmark of decoding the sync ID lists.
+ *
+ * The zdtm_endian_bench.c file is a benchmark which decodes an ASY
+ * message carrying 16000 sync IDs, the most that fit in a message, as
+ * parsed on this host, both into allocated lists and into storage
+ * given by the caller. It then times converting the sync IDs the way a
+ * big-endian host does, first with the former byte loop per sync ID,
+ * then with the byte swap intrinsic per sync ID, and then with the
+ * bulk conversion, checking that all three agree. The per sync ID
+ * conversions are both inlined, so that they compare like for like.
+ */
+
+#include "zdtm_sync.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define BENCH_NUM_IDS 16000
+#define BENCH_ROUNDS 2000
+
+static double now(void) {
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + (tv.tv_usec / 1000000.0);
+}
+
+/* The byte loop zdtm_liltobigl() used to be. */
+static uint32_t byte_loop_liltobigl(uint32_t lillong) {
+    int size, i;
+    unsigned char buff[sizeof(uint32_t)];
+
+    size = sizeof(uint32_t);
+
+    for (i = 0; i < size; i++) {
+        buff[i] = ((unsigned char *)&lillong)[(size - i - 1)];
+    }
+
+    return *(uint32_t *)buff;
+}
+
+/* Build the raw content of an ASY message of the given sync IDs, split
+ * over its new, mod and del lists. */
+static unsigned char *build_asy(uint16_t *p_size) {
+    static const uint16_t counts[3] = {8000, 6000, 2000};
+    unsigned char *buf, *p;
+    uint32_t id;
+    int l, i;
+
+    (*p_size) = 3 * 3 + BENCH_NUM_IDS * 4;
+    buf = malloc(*p_size);
+    if (buf == NULL) {
+        return NULL;
+    }
+
+    p = buf;
+    id = 0x01020304;
+    for (l = 0; l < 3; l++) {
+        *(p++) = l;
+        zdtm_put_le16(p, counts[l]);
+        p += 2;
+        for (i = 0; i < counts[l]; i++) {
+            zdtm_put_le32(p, id);
+            p += 4;
+            id += 0x01010101;
+        }
+    }
+
+    return buf;
+}
+
+static void report(const char *name, double secs, double base) {
+    printf("%-22s %8.3f s %12.0f ids/s %6.1fx\n", name, secs,
+        (BENCH_NUM_IDS * (double)BENCH_ROUNDS) / secs, base / secs);
+}
+
+int main(int argc, char *argv[]) {
+    struct zdtm_asy_msg_content asy;
+    unsigned char *raw, *ids_raw;
+    uint32_t *loop_ids, *swap_ids, *bulk_ids;
+    uint16_t size;
+    double start, parse_secs, decode_secs, loop_secs, swap_secs, bulk_secs;
+    uint32_t val;
+    int r, i, n;
+
+    raw = build_asy(&size);
+    loop_ids = malloc(BENCH_NUM_IDS * sizeof(uint32_t));
+    swap_ids = malloc(BENCH_NUM_IDS * sizeof(uint32_t));
+    bulk_ids = malloc(BENCH_NUM_IDS * sizeof(uint32_t));
+    if ((raw == NULL) || (loop_ids == NULL) || (swap_ids == NULL) ||
+        (bulk_ids == NULL)) {
+        fprintf(stderr, "ERR: failed to allocate memory.\n");
+        return 1;
+    }
+
+    /* Whole message as parsed on this host. */
+    start = now();
+    for (r = 0; r < BENCH_ROUNDS; r++) {
+        if (zdtm_parse_raw_asy_msg(raw, size, &asy) != 0) {
+            fprintf(stderr, "ERR: zdtm_parse_raw_asy_msg() failed.\n");
+            return 2;
+        }
+        free(asy.new_sync_ids);
+        free(asy.mod_sync_ids);
+        free(asy.del_sync_ids);
+    }
+    parse_secs = now() - start;
+
+    /* Whole message into the storage of the bulk conversion. */
+    start = now();
+    for (r = 0; r < BENCH_ROUNDS; r++) {
+        if (zdtm_decode_asy_msg(raw, size, &asy, bulk_ids,
+                BENCH_NUM_IDS) != 0) {
+            fprintf(stderr, "ERR: zdtm_decode_asy_msg() failed.\n");
+            return 2;
+        }
+    }
+    decode_secs = now() - start;
+
+    /* The sync IDs of the new list, which come first after a 3 byte
+     * header, then of the others, as a big-endian host sees them. */
+    ids_raw = malloc(BENCH_NUM_IDS * 4);
+    if (ids_raw == NULL) {
+        fprintf(stderr, "ERR: failed to allocate memory.\n");
+        return 1;
+    }
+    for (i = 0, n = 0; i < 3; i++) {
+        val = zdtm_get_le16(raw + 3 * i + n * 4 + 1);
+        memcpy(ids_raw + n * 4, raw + 3 * (i + 1) + n * 4, val * 4);
+        n += val;
+    }
+
+    start = now();
+    for (r = 0; r < BENCH_ROUNDS; r++) {
+        for (i = 0; i < BENCH_NUM_IDS; i++) {
+            memcpy(&val, ids_raw + i * 4, sizeof(uint32_t));
+            loop_ids[i] = byte_loop_liltobigl(val);
+        }
+        __asm__ __volatile__("" : : "r"(loop_ids) : "memory");
+    }
+    loop_secs = now() - start;
+
+    start = now();
+    for (r = 0; r < BENCH_ROUNDS; r++) {
+        for (i = 0; i < BENCH_NUM_IDS; i++) {
+            memcpy(&val, ids_raw + i * 4, sizeof(uint32_t));
+            swap_ids[i] = zdtm_liltobigl(val);
+        }
+        __asm__ __volatile__("" : : "r"(swap_ids) : "memory");
+    }
+    swap_secs = now() - start;
+
+    start = now();
+    for (r = 0; r < BENCH_ROUNDS; r++) {
+        zdtm_liltobigl_bulk(bulk_ids, ids_raw, BENCH_NUM_IDS);
+        __asm__ __volatile__("" : : "r"(bulk_ids) : "memory");
+    }
+    bulk_secs = now() - start;
+
+    if ((memcmp(loop_ids, swap_ids, BENCH_NUM_IDS * 4) != 0) ||
+        (memcmp(loop_ids, bulk_ids, BENCH_NUM_IDS * 4) != 0)) {
+        fprintf(stderr, "ERR: the conversions disagree.\n");
+        return 3;
+    }
+
+#ifdef WORDS_BIGENDIAN
+    printf("ASY decode of %d sync IDs, big-endian host\n", BENCH_NUM_IDS);
+#else
+    printf("ASY decode of %d sync IDs, little-endian host\n", BENCH_NUM_IDS);
+#endif
+    report("zdtm_parse_raw_asy_msg", parse_secs, parse_secs);
+    report("zdtm_decode_asy_msg", decode_secs, parse_secs);
+    printf("big-endian conversion\n");
+    report("  byte loop", loop_secs, loop_secs);
+    report("  inline bswap", swap_secs, loop_secs);
+    report("  bulk", bulk_secs, loop_secs);
+
+    free(ids_raw);
+    free(bulk_ids);
+    free(swap_ids);
+    free(loop_ids);
+    free(raw);
+
+    return 0;
+}
@@ -0,0 +1,307 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+
+/**
+ * @file zdtm_fleet_bench.c
+ * @brief This is a benchmark of the fleet scheduler.
+ *
+ * The zdtm_fleet_bench.c file is a benchmark which synchronizes a fleet
+ * of simulated Zaurus devices, each over a socketpair transport of its
+ * own, with the fleet scheduler. It first checks that a single worker
+ * takes the devices in priority order, then synchronizes the fleet
+ * with one worker and with a pool of workers under a concurrency cap,
+ * and reports the aggregate throughput of each. Every eighth device has
+ * many more items than the others and they all land on the queue of
+ * the same worker, which the other workers have to steal from. It also
+ * checks that devices synchronized over TCP/IP at once, each one from
+ * an address of its own, get the connections made back from their own
+ * address.
+ */
+
+#include "zdtm_sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_MAX_DEVICES 256
+#define BENCH_ORDER_DEVICES 24
+#define BENCH_TCP_DEVICES 8
+
+struct bench_device {
+    struct zdtm_fleet_device dev;
+    struct zdtm_sim sim;
+    zdtm_transport *tp;
+    unsigned int started;           // order the sync was started in
+};
+
+static pthread_mutex_t order_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned int order_next;
+
+static int record_start(zdtm_lib_env *cur_env, void *arg) {
+    pthread_mutex_lock(&order_lock);
+    ((struct bench_device *)arg)->started = order_next++;
+    pthread_mutex_unlock(&order_lock);
+
+    return 0;
+}
+
+static int count_item(struct zdtm_item *p_item, void *arg) {
+    return (p_item->sync_type == SYNC_TYPE_TODO) ? 0 : -1;
+}
+
+/* Each device over TCP/IP has sync ids of its own, an item of another
+ * device means the callback was handed to the wrong synchronization. */
+static int route_item(struct zdtm_item *p_item, void *arg) {
+    struct zdtm_sim *sim;
+
+    sim = &((struct bench_device *)arg)->sim;
+    if ((p_item->sync_id < sim->first_sync_id) ||
+        (p_item->sync_id >= (sim->first_sync_id + sim->num_new))) {
+        return -1;
+    }
+
+    return 0;
+}
+
+static int start_devices(struct bench_device *devs, unsigned int num_devices,
+    unsigned int num_items, unsigned int delay_us) {
+
+    unsigned int i;
+
+    for (i = 0; i < num_devices; i++) {
+        memset(&devs[i], 0, sizeof(struct bench_device));
+        if (zdtm_socketpair_transport_new(&devs[i].tp) != 0) {
+            return -1;
+        }
+        devs[i].sim.first_sync_id = 1;
+        devs[i].sim.num_new = num_items * (((i % 8) == 0) ? 16 : 1);
+        devs[i].sim.item_delay_us = delay_us;
+        devs[i].sim.transport = devs[i].tp;
+        if (zdtm_sim_start(&devs[i].sim) != 0) {
+            return -2;
+        }
+
+        strcpy(devs[i].dev.zaurus_ip, "127.0.0.1");
+        devs[i].dev.sync_type = 0;
+        devs[i].dev.transport = devs[i].tp;
+        devs[i].dev.setup = record_start;
+        devs[i].dev.consume = count_item;
+        devs[i].dev.arg = &devs[i];
+    }
+
+    return 0;
+}
+
+static int stop_devices(struct bench_device *devs, unsigned int num_devices) {
+    unsigned int i;
+    int r;
+
+    r = 0;
+    for (i = 0; i < num_devices; i++) {
+        if (zdtm_sim_wait(&devs[i].sim) != 0) {
+            r = -1;
+        }
+        zdtm_transport_free(devs[i].tp);
+    }
+
+    return r;
+}
+
+/* A single worker has to start the devices by priority, and in the
+ * order they were submitted within a priority. The first one submitted
+ * may start before the others are queued, hence it is left out. */
+static int test_order(void) {
+    struct bench_device devs[BENCH_ORDER_DEVICES];
+    struct bench_device *by_start[BENCH_ORDER_DEVICES];
+    zdtm_fleet *p_fleet;
+    unsigned int i;
+    int ordered;
+
+    if ((start_devices(devs, BENCH_ORDER_DEVICES, 20, 0) != 0) ||
+        (zdtm_fleet_new(1, 0, &p_fleet) != 0)) {
+        return check("priority order", 0);
+    }
+
+    order_next = 0;
+    for (i = 0; i < BENCH_ORDER_DEVICES; i++) {
+        devs[i].dev.priority = i % 4;
+        zdtm_fleet_submit(p_fleet, &devs[i].dev);
+    }
+    zdtm_fleet_wait(p_fleet);
+    zdtm_fleet_free(p_fleet);
+
+    ordered = (stop_devices(devs, BENCH_ORDER_DEVICES) == 0);
+    for (i = 0; i < BENCH_ORDER_DEVICES; i++) {
+        ordered &= (devs[i].dev.result == 0) &&
+            (devs[i].started < BENCH_ORDER_DEVICES);
+        by_start[devs[i].started % BENCH_ORDER_DEVICES] = &devs[i];
+    }
+    for (i = 2; ordered && (i < BENCH_ORDER_DEVICES); i++) {
+        if (by_start[i - 1] == &devs[0]) {
+            continue;
+        }
+        ordered &= (by_start[i - 1]->dev.priority > by_start[i]->dev.priority)
+            || ((by_start[i - 1]->dev.priority == by_start[i]->dev.priority) &&
+            (by_start[i - 1] < by_start[i]));
+    }
+
+    return check("priority order", ordered);
+}
+
+/* Devices over TCP/IP all call back to the single listener of the
+ * fleet, hence they may only run at once when each callback is routed
+ * by the address it comes from. */
+static int test_tcp_routing(void) {
+    struct bench_device devs[BENCH_TCP_DEVICES];
+    struct zdtm_fleet_metrics metrics;
+    zdtm_fleet *p_fleet;
+    unsigned int i, num_started;
+    int routed;
+
+    if (zdtm_fleet_new(4, 4, &p_fleet) != 0) {
+        return check("TCP callbacks routed by address", 0);
+    }
+
+    routed = 1;
+    for (num_started = 0, i = 0; i < BENCH_TCP_DEVICES; i++) {
+        memset(&devs[i], 0, sizeof(struct bench_device));
+        sprintf(devs[i].sim.zaurus_ip, "127.0.0.%u", i + 2);
+        devs[i].sim.first_sync_id = (i + 1) * 1000;
+        devs[i].sim.num_new = 20;
+        devs[i].sim.item_delay_us = 2000;
+        if (zdtm_sim_start(&devs[i].sim) != 0) {
+            routed = 0;
+            break;
+        }
+        num_started++;
+
+        strcpy(devs[i].dev.zaurus_ip, devs[i].sim.zaurus_ip);
+        devs[i].dev.sync_type = 0;
+        devs[i].dev.consume = route_item;
+        devs[i].dev.arg = &devs[i];
+        zdtm_fleet_submit(p_fleet, &devs[i].dev);
+    }
+    zdtm_fleet_wait(p_fleet);
+    zdtm_fleet_metrics(p_fleet, &metrics);
+    zdtm_fleet_free(p_fleet);
+
+    for (i = 0; i < num_started; i++) {
+        routed &= (zdtm_sim_wait(&devs[i].sim) == 0) &&
+            (devs[i].dev.result == 0) && (devs[i].dev.items == 20);
+    }
+
+    return check("TCP callbacks routed by address", routed) +
+        check("  TCP syncs ran at once", metrics.peak_running > 1);
+}
+
+static int run(const char *name, unsigned int num_workers,
+    unsigned int max_running, unsigned int num_devices,
+    unsigned int num_items, unsigned int delay_us,
+    struct zdtm_fleet_metrics *p_metrics) {
+
+    struct bench_device *devs;
+    zdtm_fleet *p_fleet;
+    unsigned long expected;
+    unsigned int i;
+    int fails;
+
+    devs = calloc(num_devices, sizeof(struct bench_device));
+    if ((devs == NULL) ||
+        (start_devices(devs, num_devices, num_items, delay_us) != 0) ||
+        (zdtm_fleet_new(num_workers, max_running, &p_fleet) != 0)) {
+        fprintf(stderr, "ERR: failed to set up the fleet.\n");
+        exit(2);
+    }
+
+    expected = 0;
+    for (i = 0; i < num_devices; i++) {
+        zdtm_fleet_submit(p_fleet, &devs[i].dev);
+        expected += devs[i].sim.num_new;
+    }
+    zdtm_fleet_wait(p_fleet);
+    zdtm_fleet_metrics(p_fleet, p_metrics);
+    zdtm_fleet_free(p_fleet);
+
+    fails = check(name, (stop_devices(devs, num_devices) == 0) &&
+        (p_metrics->failed == 0) && (p_metrics->devices == num_devices) &&
+        (p_metrics->items == expected));
+    if (max_running > 0) {
+        fails += check("  concurrency cap held",
+            p_metrics->peak_running <= max_running);
+    }
+    if (num_workers > 1) {
+        fails += check("  idle workers stole work", p_metrics->steals > 0);
+    }
+    free(devs);
+
+    return fails;
+}
+
+static void report(const char *name, struct zdtm_fleet_metrics *p_metrics) {
+    printf("%-10s %5lu devices %8lu items %8.3f s %8.1f devices/s "
+        "%10.0f items/s %5lu steals %3u peak\n", name, p_metrics->devices,
+        p_metrics->items, p_metrics->secs, p_metrics->devices_per_sec,
+        p_metrics->items_per_sec, p_metrics->steals,
+        p_metrics->peak_running);
+}
+
+int main(int argc, char *argv[]) {
+    unsigned int num_devices, num_workers, max_running, num_items, delay_us;
+    struct zdtm_fleet_metrics serial, pool;
+    int fails;
+
+    if (argc > 6) {
+        printf("Usage: %s [num devices] [num workers] [max running] "
+            "[num items per device] [simulated RDR latency in usec]\n",
+            argv[0]);
+        return 0;
+    }
+
+    num_devices = (argc > 1) ? atoi(argv[1]) : 64;
+    num_workers = (argc > 2) ? atoi(argv[2]) : 8;
+    max_running = (argc > 3) ? atoi(argv[3]) : 6;
+    num_items = (argc > 4) ? atoi(argv[4]) : 50;
+    delay_us = (argc > 5) ? atoi(argv[5]) : 200;
+    if ((num_devices == 0) || (num_devices > BENCH_MAX_DEVICES) ||
+        (num_workers == 0) || (num_items == 0) || (num_items > 4000 / 16)) {
+        fprintf(stderr, "ERR: num devices must be from 1 to %d, num "
+            "workers at least 1, and num items from 1 to %d.\n",
+            BENCH_MAX_DEVICES, 4000 / 16);
+        return 1;
+    }
+
+    fails = test_order();
+    fails += test_tcp_routing();
+    fails += run("one worker", 1, 0, num_devices, num_items, delay_us,
+        &serial);
+    fails += run("pool", num_workers, max_running, num_devices, num_items,
+        delay_us, &pool);
+
+    report("one worker", &serial);
+    report("pool", &pool);
+    if (pool.secs > 0) {
+        printf("speedup: %.1fx\n", serial.secs / pool.secs);
+    }
+    printf("%d failure(s)\n", fails);
+
+    return fails ? 1 : 0;
+}
@@ -0,0 +1,178 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+
+
+/*
+ * This program checks the sync ID sets. Sets built from unsorted lists
+ * with duplicates are sorted and distinct, and the union, intersection,
+ * difference, and membership of random sets of many sizes and overlaps
+ * agree with a plain bitmap over a small range of sync ids.
+ */
+
+#include "zdtm_sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Range the random sync ids are drawn from, small to force overlaps.
+#define RANGE 4096
+
+/* Build a random set of about num sync ids, marking them in map. */
+static int random_set(zdtm_id_set *p_set, uint32_t num, uint32_t base,
+    unsigned char *map) {
+    uint32_t *ids, i;
+    int r;
+
+    ids = malloc(sizeof(uint32_t) * (num + 1));
+    if (ids == NULL) {
+        return -1;
+    }
+
+    memset(map, 0, RANGE);
+    for (i = 0; i < num; i++) {
+        ids[i] = (uint32_t)(rand() % RANGE);
+        map[ids[i]] = 1;
+        ids[i] += base;
+    }
+
+    r = zdtm_id_set_from_ids(p_set, ids, num);
+    free(ids);
+
+    return r;
+}
+
+/* Check that a set holds exactly the sync ids marked in map. */
+static int same_as_map(const zdtm_id_set *p_set, uint32_t base,
+    const unsigned char *map) {
+    uint32_t i, n;
+
+    n = 0;
+    for (i = 0; i < RANGE; i++) {
+        if (map[i]) {
+            if ((n >= p_set->num_ids) || (p_set->ids[n] != (base + i))) {
+                return 0;
+            }
+            n++;
+        }
+    }
+
+    return n == p_set->num_ids;
+}
+
+static int test_build(void) {
+    const uint32_t ids[] = {0x30000001, 7, 0x30000001, 0xffffffff, 7, 0,
+        0x00010000, 0x00000100};
+    const uint32_t expect[] = {0, 7, 0x00000100, 0x00010000, 0x30000001,
+        0xffffffff};
+    zdtm_id_set set;
+    int fails;
+
+    zdtm_id_set_init(&set);
+    fails = check("set built sorted and distinct",
+        (zdtm_id_set_from_ids(&set, ids, 8) == 0) && (set.num_ids == 6) &&
+        (memcmp(set.ids, expect, sizeof(expect)) == 0));
+    fails += check("  empty set built",
+        (zdtm_id_set_from_ids(&set, ids, 0) == 0) && (set.num_ids == 0) &&
+        !zdtm_id_set_contains(&set, 7));
+    zdtm_id_set_free(&set);
+
+    return fails;
+}
+
+static int test_algebra(void) {
+    static const uint32_t sizes[] = {0, 1, 3, 4, 5, 8, 13, 64, 500, 3000,
+        20000};
+    unsigned char map_a[RANGE], map_b[RANGE], map[RANGE];
+    zdtm_id_set a, b, out;
+    uint32_t base, i, k, l;
+    int ok_set, ok_union, ok_inter, ok_diff, ok_has, round, fails;
+
+    zdtm_id_set_init(&a);
+    zdtm_id_set_init(&b);
+    zdtm_id_set_init(&out);
+    ok_set = ok_union = ok_inter = ok_diff = ok_has = 1;
+
+    srand(44);
+    for (round = 0; round < 4; round++) {
+        /* Sync ids past the low bytes make the sort do every pass. */
+        base = (round & 1) ? 0x7ffff000 : 0;
+        for (k = 0; k < (sizeof(sizes) / sizeof(sizes[0])); k++) {
+            for (l = 0; l < (sizeof(sizes) / sizeof(sizes[0])); l++) {
+                if ((random_set(&a, sizes[k], base, map_a) != 0) ||
+                    (random_set(&b, sizes[l], base, map_b) != 0)) {
+                    ok_set = 0;
+                    continue;
+                }
+                ok_set &= same_as_map(&a, base, map_a) &&
+                    same_as_map(&b, base, map_b);
+
+                for (i = 0; i < RANGE; i++) {
+                    map[i] = map_a[i] | map_b[i];
+                }
+                ok_union &= (zdtm_id_set_union(&out, &a, &b) == 0) &&
+                    same_as_map(&out, base, map);
+
+                for (i = 0; i < RANGE; i++) {
+                    map[i] = map_a[i] & map_b[i];
+                }
+                ok_inter &= (zdtm_id_set_intersect(&out, &a, &b) == 0) &&
+                    same_as_map(&out, base, map);
+
+                for (i = 0; i < RANGE; i++) {
+                    map[i] = map_a[i] & !map_b[i];
+                }
+                ok_diff &= (zdtm_id_set_difference(&out, &a, &b) == 0) &&
+                    same_as_map(&out, base, map);
+
+                for (i = 0; i < RANGE; i++) {
+                    ok_has &= (zdtm_id_set_contains(&a, base + i) ==
+                        map_a[i]);
+                }
+                ok_has &= !zdtm_id_set_contains(&a, base + RANGE);
+            }
+        }
+    }
+
+    fails = check("random sets sorted and distinct", ok_set);
+    fails += check("  union", ok_union);
+    fails += check("  intersection", ok_inter);
+    fails += check("  difference", ok_diff);
+    fails += check("  membership", ok_has);
+
+    zdtm_id_set_free(&out);
+    zdtm_id_set_free(&b);
+    zdtm_id_set_free(&a);
+
+    return fails;
+}
+
+int main(int argc, char *argv[]) {
+    int fails;
+
+    fails = 0;
+    fails += test_build();
+    fails += test_algebra();
+
+    printf("%d failure(s)\n", fails);
+
+    return fails ? 1 : 0;
+}
@@ -0,0 +1,271 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+/*
+ * This program checks the item iterator against a simulated Zaurus.
+ * The items have to come in the order of the new, mod, and del lists,
+ * the worker thread must not decode more than read_ahead items ahead
+ * of the consumer, an error of the worker has to reach the consumer,
+ * and closing the iterator with decoded items left in it must neither
+ * hang nor leak them.
+ */
+
+#include "zdtm_sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define ITER_FIRST_ID 1
+#define ITER_NUM_NEW 40
+#define ITER_NUM_MOD 20
+#define ITER_NUM_DEL 10
+#define ITER_READ_AHEAD 4
+#define ITER_DROP_AFTER 10
+
+/* Read the RDR counter of a simulated Zaurus still serving. */
+static unsigned long num_rdr(struct zdtm_sim *sim) {
+    return __atomic_load_n(&sim->num_rdr, __ATOMIC_SEQ_CST);
+}
+
+/* Wait for the simulated Zaurus to serve at least num RDRs, then give
+ * the worker thread time to go beyond them if it were to. */
+static unsigned long settle(struct zdtm_sim *sim, unsigned long num) {
+    int i;
+
+    for (i = 0; (i < 500) && (num_rdr(sim) < num); i++) {
+        usleep(10000);
+    }
+    usleep(200000);
+
+    return num_rdr(sim);
+}
+
+static int start(struct zdtm_sim *sim, zdtm_lib_env *cur_env) {
+    char ip[IP_STR_SIZE] = "127.0.0.1";
+    int r;
+
+    sim->first_sync_id = ITER_FIRST_ID;
+    if (zdtm_sim_start(sim) != 0) {
+        fprintf(stderr, "ERR: zdtm_sim_start() failed.\n");
+        return -1;
+    }
+
+    memset(cur_env, 0, sizeof(zdtm_lib_env));
+    if ((zdtm_initialize(cur_env) != 0) ||
+        (zdtm_set_zaurus_ip(cur_env, ip) != 0) ||
+        (zdtm_set_sync_type(cur_env, 0) != 0)) {
+        fprintf(stderr, "ERR: failed to set up the library.\n");
+        return -2;
+    }
+
+    r = zdtm_initiate_sync(cur_env);
+    if (r != 0) {
+        fprintf(stderr, "ERR(%d): zdtm_initiate_sync() failed.\n", r);
+        return -3;
+    }
+
+    return 0;
+}
+
+static int finish(struct zdtm_sim *sim, zdtm_lib_env *cur_env,
+    int terminate) {
+
+    int r;
+
+    r = 0;
+    if (terminate) {
+        r = zdtm_terminate_sync(cur_env);
+    } else {
+        /* The Zaurus went away, drop what is left of the session. */
+        _zdtm_close_conn_to_zaurus(cur_env);
+        _zdtm_close_zaurus_conn(cur_env);
+    }
+    zdtm_finalize(cur_env);
+    zdtm_sim_wait(sim);
+
+    return r;
+}
+
+static int test_order(void) {
+    struct zdtm_sim sim;
+    zdtm_lib_env cur_env;
+    zdtm_item_iter *p_iter;
+    struct zdtm_item item;
+    const unsigned char *p;
+    uint32_t expect_id, len;
+    int expect_list, num, ok, shared, r, fails;
+
+    memset(&sim, 0, sizeof(struct zdtm_sim));
+    sim.num_new = ITER_NUM_NEW;
+    sim.num_mod = ITER_NUM_MOD;
+    sim.num_del = ITER_NUM_DEL;
+    if (start(&sim, &cur_env) != 0) { return -1; }
+
+    if (zdtm_item_iter_open(&cur_env, ITER_READ_AHEAD, &p_iter) != 0) {
+        fprintf(stderr, "ERR: zdtm_item_iter_open() failed.\n");
+        return -1;
+    }
+
+    /* The simulated Zaurus hands out consecutive sync ids over the new,
+     * mod, and del lists in that order. */
+    ok = 1;
+    shared = 1;
+    num = 0;
+    expect_id = ITER_FIRST_ID;
+    while ((r = zdtm_item_iter_next(p_iter, &item)) == 0) {
+        if (num < ITER_NUM_NEW) {
+            expect_list = ZDTM_ITEM_NEW;
+        } else if (num < ITER_NUM_NEW + ITER_NUM_MOD) {
+            expect_list = ZDTM_ITEM_MOD;
+        } else {
+            expect_list = ZDTM_ITEM_DEL;
+        }
+        ok &= (item.list == expect_list) && (item.sync_id == expect_id) &&
+            (item.sync_type == SYNC_TYPE_TODO);
+        if (expect_list != ZDTM_ITEM_DEL) {
+            ok &= (item.cont.todo.description != NULL);
+
+            /* The category is interned on this thread and the item
+             * points at the payload the session table holds for it. */
+            shared &= item.shared_category &&
+                (item.cont.todo.category_id != ZDTM_CATEGORY_NONE) &&
+                (zdtm_lookup_category(&cur_env, item.cont.todo.category_id,
+                    &p, &len) == 0) &&
+                (p == (unsigned char *)item.cont.todo.category) &&
+                (len == item.cont.todo.category_len);
+        }
+        zdtm_clean_item(&item);
+        expect_id++;
+        num++;
+    }
+
+    fails = check("items in new, mod, del order", ok &&
+        (num == ITER_NUM_NEW + ITER_NUM_MOD + ITER_NUM_DEL));
+    fails += check("  items share their categories", shared);
+    fails += check("  end reported once the lists are walked", r == 1);
+    fails += check("  end reported again",
+        zdtm_item_iter_next(p_iter, &item) == 1);
+    fails += check("  deleted items not requested",
+        num_rdr(&sim) == ITER_NUM_NEW + ITER_NUM_MOD);
+
+    zdtm_item_iter_close(p_iter);
+    fails += check("  session terminated", finish(&sim, &cur_env, 1) == 0);
+
+    return fails;
+}
+
+static int test_read_ahead(void) {
+    struct zdtm_sim sim;
+    zdtm_lib_env cur_env;
+    zdtm_item_iter *p_iter;
+    struct zdtm_item item;
+    int fails;
+
+    memset(&sim, 0, sizeof(struct zdtm_sim));
+    sim.num_new = ITER_NUM_NEW;
+    if (start(&sim, &cur_env) != 0) { return -1; }
+
+    if (zdtm_item_iter_open(&cur_env, ITER_READ_AHEAD, &p_iter) != 0) {
+        fprintf(stderr, "ERR: zdtm_item_iter_open() failed.\n");
+        return -1;
+    }
+
+    fails = check("worker stops read_ahead items ahead",
+        settle(&sim, ITER_READ_AHEAD) == ITER_READ_AHEAD);
+
+    fails += check("  consuming an item lets it decode one more",
+        (zdtm_item_iter_next(p_iter, &item) == 0) &&
+        (item.sync_id == ITER_FIRST_ID) &&
+        (settle(&sim, ITER_READ_AHEAD + 1) == ITER_READ_AHEAD + 1));
+    zdtm_clean_item(&item);
+
+    /* The iterator is closed with a full ring of decoded items, which
+     * it has to free, and the worker waiting for room. */
+    fails += check("closed with unconsumed items",
+        zdtm_item_iter_close(p_iter) == 0);
+    fails += check("  session terminated", finish(&sim, &cur_env, 1) == 0);
+    fails += check("  no item requested once closed",
+        sim.num_rdr == ITER_READ_AHEAD + 1);
+
+    return fails;
+}
+
+static int test_error(void) {
+    struct zdtm_sim sim;
+    zdtm_lib_env cur_env;
+    zdtm_item_iter *p_iter;
+    struct zdtm_item item;
+    int num, r, fails;
+
+    memset(&sim, 0, sizeof(struct zdtm_sim));
+    sim.num_new = ITER_NUM_NEW;
+    sim.drop_after_rdr = ITER_DROP_AFTER;
+    if (start(&sim, &cur_env) != 0) { return -1; }
+
+    if (zdtm_item_iter_open(&cur_env, ITER_READ_AHEAD, &p_iter) != 0) {
+        fprintf(stderr, "ERR: zdtm_item_iter_open() failed.\n");
+        return -1;
+    }
+
+    num = 0;
+    while ((r = zdtm_item_iter_next(p_iter, &item)) == 0) {
+        zdtm_clean_item(&item);
+        num++;
+    }
+
+    fails = check("items decoded before the error yielded",
+        num == ITER_DROP_AFTER);
+    fails += check("  worker error reaches the consumer", r == -2);
+    fails += check("  error reported again",
+        zdtm_item_iter_next(p_iter, &item) == -2);
+    fails += check("  closed after the error",
+        zdtm_item_iter_close(p_iter) == 0);
+
+    finish(&sim, &cur_env, 0);
+
+    return fails;
+}
+
+int main(int argc, char *argv[]) {
+    int r, fails;
+
+    /* A hang of the iterator fails the test rather than stalling it. */
+    alarm(60);
+
+    fails = 0;
+
+    r = test_order();
+    if (r < 0) { return 2; }
+    fails += r;
+
+    r = test_read_ahead();
+    if (r < 0) { return 2; }
+    fails += r;
+
+    r = test_error();
+    if (r < 0) { return 2; }
+    fails += r;
+
+    printf("%d failure(s)\n", fails);
+
+    return fails ? 1 : 0;
+}
@@ -0,0 +1,352 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+
+
+/*
+ * This program checks the listener startup modes. Environments which
+ * defer their listener do not get in the way of each other until they
+ * synchronize, and an adopted listener outlives the environments it is
+ * handed to, along with the connections queued on it, the way it does
+ * when it is handed down from one daemon process to the next. It also
+ * checks that a listener passed by socket activation is picked up, and
+ * that sharded listeners each accept the connections of their devices,
+ * and that closing one of them loses the steering but no connection
+ * until the set is created again.
+ */
+
+#include "zdtm_sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+
+// Number of sharded listeners, and of addresses connected from.
+#define NUM_SHARDS 4
+#define NUM_SOURCES 8
+
+/* Synchronize the lists of a simulated Zaurus over the transport of an
+ * initialized environment. */
+static int sync_lists(zdtm_lib_env *cur_env, zdtm_transport *p_tp) {
+    struct zdtm_sim sim;
+    uint32_t *p_new_sync_ids, *p_mod_sync_ids, *p_del_sync_ids;
+    uint16_t num_new_sync_ids, num_mod_sync_ids, num_del_sync_ids;
+    char ip[IP_STR_SIZE] = "127.0.0.1";
+    int r;
+
+    memset(&sim, 0, sizeof(struct zdtm_sim));
+    sim.first_sync_id = 1;
+    sim.num_new = 10;
+    sim.transport = p_tp;
+    if (zdtm_sim_start(&sim) != 0) {
+        return -1;
+    }
+
+    zdtm_set_zaurus_ip(cur_env, ip);
+    zdtm_set_sync_type(cur_env, 0);
+    zdtm_set_log_none(cur_env);
+
+    r = zdtm_initiate_sync(cur_env);
+    if (r == 0) {
+        r = zdtm_obtain_sync_id_lists(cur_env, &p_new_sync_ids,
+            &num_new_sync_ids, &p_mod_sync_ids, &num_mod_sync_ids,
+            &p_del_sync_ids, &num_del_sync_ids);
+        if (r == 0) {
+            free(p_new_sync_ids);
+            free(p_mod_sync_ids);
+            free(p_del_sync_ids);
+            r = (num_new_sync_ids == 10) ? 0 : -2;
+        }
+    }
+    if (r == 0) {
+        r = zdtm_terminate_sync(cur_env);
+    } else {
+        _zdtm_close_conn_to_zaurus(cur_env);
+        _zdtm_close_zaurus_conn(cur_env);
+    }
+
+    if (zdtm_sim_wait(&sim) != 0) {
+        r = -3;
+    }
+
+    return r;
+}
+
+static int test_deferred(void) {
+    zdtm_lib_env env_a, env_b;
+    int r_a, r_b, fails;
+
+    /* Both environments are on TCP/IP, hence they could not both be
+     * listening on DLISTPORT at once. */
+    memset(&env_a, 0, sizeof(zdtm_lib_env));
+    memset(&env_b, 0, sizeof(zdtm_lib_env));
+    r_a = zdtm_initialize_listener(&env_a, NULL, INVALID_SOCKET);
+    r_b = zdtm_initialize_listener(&env_b, NULL, INVALID_SOCKET);
+    fails = check("deferred listeners initialized", (r_a == 0) &&
+        (r_b == 0) && (env_a.listenfd == INVALID_SOCKET) &&
+        (env_b.listenfd == INVALID_SOCKET));
+
+    r_a = sync_lists(&env_a, zdtm_tcp_transport());
+    zdtm_finalize(&env_a);
+    r_b = sync_lists(&env_b, zdtm_tcp_transport());
+    zdtm_finalize(&env_b);
+    fails += check("  each one synchronized in turn", (r_a == 0) &&
+        (r_b == 0));
+
+    return fails;
+}
+
+static int test_adopted(void) {
+    zdtm_transport *p_tp;
+    zdtm_lib_env cur_env;
+    SOCKET listenfd, connfd;
+    int r, fails;
+
+    p_tp = zdtm_tcp_transport();
+    if (p_tp->listen(p_tp, NULL, DLISTPORT, &listenfd) != 0) {
+        return check("adopted listener", 0);
+    }
+
+    memset(&cur_env, 0, sizeof(zdtm_lib_env));
+    r = zdtm_initialize_listener(&cur_env, NULL, listenfd);
+    if (r == 0) {
+        r = sync_lists(&cur_env, p_tp);
+        zdtm_finalize(&cur_env);
+    }
+    fails = check("adopted listener synchronized", r == 0);
+    fails += check("  left open by zdtm_finalize",
+        fcntl(listenfd, F_GETFD) >= 0);
+
+    /* A Zaurus connecting back while no environment is around is kept
+     * waiting on the listener for the next one. */
+    r = p_tp->connect(p_tp, "127.0.0.1", DLISTPORT, 1000, &connfd);
+    if (r == 0) {
+        memset(&cur_env, 0, sizeof(zdtm_lib_env));
+        zdtm_initialize_listener(&cur_env, NULL, listenfd);
+        zdtm_set_log_none(&cur_env);
+        zdtm_set_timeouts(&cur_env, -1, 1000, -1);
+        r = _zdtm_handle_zaurus_conn(&cur_env);
+        _zdtm_close_zaurus_conn(&cur_env);
+        zdtm_finalize(&cur_env);
+        p_tp->close(p_tp, connfd);
+    }
+    fails += check("  queued connection accepted by the next", r == 0);
+
+    p_tp->close(p_tp, listenfd);
+
+    return fails;
+}
+
+static int test_activation(void) {
+    zdtm_transport *p_tp;
+    SOCKET listenfd, activated;
+    char pid[32];
+    int r, fails;
+
+    if (fcntl(3, F_GETFD) >= 0) {
+        /* Descriptor 3 is taken, it can not be made the one passed. */
+        return check("socket activation (skipped)", 1);
+    }
+
+    p_tp = zdtm_tcp_transport();
+    if (p_tp->listen(p_tp, NULL, DLISTPORT, &listenfd) != 0) {
+        return check("socket activation", 0);
+    }
+    if (listenfd != 3) {
+        if (dup2(listenfd, 3) != 3) {
+            p_tp->close(p_tp, listenfd);
+            return check("socket activation", 0);
+        }
+        p_tp->close(p_tp, listenfd);
+    }
+
+    snprintf(pid, sizeof(pid), "%ld", (long)getpid());
+    setenv("LISTEN_PID", pid, 1);
+    setenv("LISTEN_FDS", "1", 1);
+    activated = INVALID_SOCKET;
+    r = zdtm_listen_fds(&activated);
+    fails = check("socket activation", (r == 0) && (activated == 3) &&
+        (getenv("LISTEN_PID") == NULL) && (getenv("LISTEN_FDS") == NULL));
+
+    setenv("LISTEN_PID", "1", 1);
+    setenv("LISTEN_FDS", "1", 1);
+    fails += check("  listener of another process ignored",
+        zdtm_listen_fds(&activated) == 1);
+    unsetenv("LISTEN_PID");
+    unsetenv("LISTEN_FDS");
+
+    close(3);
+
+    return fails;
+}
+
+/* Connect to DLISTPORT from the given loopback address, returning the
+ * connection or -1. */
+static int connect_from(const char *src) {
+    struct sockaddr_in sa;
+    int fd;
+
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    inet_pton(AF_INET, src, &sa.sin_addr);
+    if (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    sa.sin_port = htons(DLISTPORT);
+    inet_pton(AF_INET, "127.0.0.1", &sa.sin_addr);
+    if (connect(fd, (struct sockaddr *)&sa, sizeof(sa)) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/* Connect from each of the source addresses in turn, accepting each
+ * connection on the open shard it is waiting on. Closed shards are
+ * INVALID_SOCKET. */
+static int steer(zdtm_transport *p_tp, SOCKET *shards, int *p_accepted) {
+    SOCKET connfd;
+    struct pollfd pfds[NUM_SHARDS];
+    char src[IP_STR_SIZE];
+    int i, j, fd, steered;
+
+    steered = 0;
+    (*p_accepted) = 0;
+    for (i = 0; i < NUM_SOURCES; i++) {
+        snprintf(src, sizeof(src), "127.0.0.%d", i + 1);
+        fd = connect_from(src);
+        if (fd < 0) {
+            continue;
+        }
+        for (j = 0; j < NUM_SHARDS; j++) {
+            pfds[j].fd = shards[j];
+            pfds[j].events = POLLIN;
+            pfds[j].revents = 0;
+        }
+        poll(pfds, NUM_SHARDS, 1000);
+        for (j = 0; j < NUM_SHARDS; j++) {
+            if (!(pfds[j].revents & POLLIN)) {
+                continue;
+            }
+            if ((unsigned int)j == zdtm_shard_of(src, NUM_SHARDS)) {
+                steered++;
+            } else {
+                steered = -NUM_SOURCES;
+            }
+            if (p_tp->accept(p_tp, shards[j], &connfd) == 0) {
+                p_tp->close(p_tp, connfd);
+                (*p_accepted)++;
+            }
+        }
+        close(fd);
+    }
+
+    return steered;
+}
+
+static int test_sharded(void) {
+    zdtm_transport *p_tp;
+    zdtm_lib_env cur_env;
+    SOCKET shards[NUM_SHARDS];
+    int i, r, accepted, fails;
+
+    r = zdtm_listen_shards(NULL, DLISTPORT, NUM_SHARDS, 64, shards);
+    if (r == -6) {
+        /* The kernel can not steer connections. */
+        return check("sharded listeners (skipped)", 1);
+    }
+    fails = check("sharded listeners created", r == 0);
+    if (r != 0) {
+        return fails;
+    }
+
+    /* Each connection must be waiting on the shard of its source
+     * address, and on no other. */
+    p_tp = zdtm_tcp_transport();
+    fails += check("  connections steered by source address",
+        steer(p_tp, shards, &accepted) == NUM_SOURCES);
+
+    memset(&cur_env, 0, sizeof(zdtm_lib_env));
+    r = zdtm_initialize_listener(&cur_env, NULL,
+        shards[zdtm_shard_of("127.0.0.1", NUM_SHARDS)]);
+    if (r == 0) {
+        r = sync_lists(&cur_env, p_tp);
+        zdtm_finalize(&cur_env);
+    }
+    fails += check("  shard of the device synchronized", r == 0);
+
+    fails += check("  invalid shard count refused",
+        zdtm_listen_shards(NULL, DLISTPORT, 0, 0, shards) == -1);
+
+    /* Losing a shard renumbers the group, the connections are no
+     * longer all steered to their shard but none of them is lost. */
+    p_tp->close(p_tp, shards[1]);
+    shards[1] = INVALID_SOCKET;
+    r = steer(p_tp, shards, &accepted);
+    fails += check("closed shard loses the steering",
+        r != NUM_SOURCES);
+    fails += check("  connections still accepted",
+        accepted == NUM_SOURCES);
+
+    /* The owner closes the whole set and creates it again. */
+    for (i = 0; i < NUM_SHARDS; i++) {
+        if (shards[i] != INVALID_SOCKET) {
+            p_tp->close(p_tp, shards[i]);
+        }
+    }
+    r = zdtm_listen_shards(NULL, DLISTPORT, NUM_SHARDS, 64, shards);
+    fails += check("  set created again", r == 0);
+    if (r != 0) {
+        return fails;
+    }
+    fails += check("  connections steered again",
+        steer(p_tp, shards, &accepted) == NUM_SOURCES);
+
+    for (i = 0; i < NUM_SHARDS; i++) {
+        p_tp->close(p_tp, shards[i]);
+    }
+
+    return fails;
+}
+
+int main(int argc, char *argv[]) {
+    int fails;
+
+    fails = 0;
+    fails += test_deferred();
+    fails += test_adopted();
+    fails += test_activation();
+    fails += test_sharded();
+
+    printf("%d failure(s)\n", fails);
+
+    return fails ? 1 : 0;
+}
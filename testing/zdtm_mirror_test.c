@@ -0,0 +1,335 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+/*
+ * This program checks the mirror store. Items put in it have to be
+ * found, read back, and deleted, and putting an identical version again
+ * must not grow the log. Reopening has to recover the items from the
+ * log whenever the index does not match it, be it stale or missing,
+ * and a trailing record cut short by an interrupted write has to be
+ * discarded.
+ */
+
+#include "zdtm_sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define MIRROR_PATH "/tmp/zdtm_mirror_test.log"
+#define MIRROR_IDX_PATH MIRROR_PATH ZDTM_MIRROR_IDX_SUFFIX
+#define MIRROR_NUM_PARAMS 3
+
+/* Fill in the params of a version of an item, the data of which is
+ * kept in buf. */
+static void build_item(uint32_t sync_id, int revision, char *buf,
+    struct zdtm_adr_msg_param *params) {
+
+    int i, len;
+
+    for (i = 0; i < MIRROR_NUM_PARAMS; i++) {
+        len = sprintf(buf, "item %u field %d rev %d", sync_id, i, revision);
+        params[i].param_len = len;
+        params[i].param_data = (unsigned char *)buf;
+        buf += len + 1;
+    }
+}
+
+static int put(zdtm_mirror *p_mirror, uint32_t sync_id, int revision) {
+    struct zdtm_adr_msg_param params[MIRROR_NUM_PARAMS];
+    char buf[256];
+
+    build_item(sync_id, revision, buf, params);
+
+    return zdtm_mirror_put(p_mirror, SYNC_TYPE_TODO, sync_id, params,
+        MIRROR_NUM_PARAMS);
+}
+
+/* Check that the store holds the given version of an item, both in
+ * the index and in the log. */
+static int holds(zdtm_mirror *p_mirror, uint32_t sync_id, int revision) {
+    struct zdtm_adr_msg_param params[MIRROR_NUM_PARAMS];
+    struct zdtm_dtm_record rec;
+    char buf[256];
+    uint64_t hash;
+    int i;
+
+    build_item(sync_id, revision, buf, params);
+
+    if ((zdtm_mirror_lookup(p_mirror, sync_id, &hash, NULL) != 0) ||
+        (hash != zdtm_mirror_hash(params, MIRROR_NUM_PARAMS)) ||
+        (zdtm_mirror_read(p_mirror, sync_id, &rec) != 0) ||
+        (rec.num_params != MIRROR_NUM_PARAMS)) {
+        return 0;
+    }
+    for (i = 0; i < MIRROR_NUM_PARAMS; i++) {
+        if ((rec.params[i].param_len != params[i].param_len) ||
+            (memcmp(rec.params[i].param_data, params[i].param_data,
+                params[i].param_len) != 0)) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static long file_size(const char *path) {
+    struct stat st;
+
+    if (stat(path, &st) != 0) {
+        return -1;
+    }
+
+    return (long)st.st_size;
+}
+
+/* Read a whole file into memory. */
+static unsigned char *load(const char *path, long *p_size) {
+    unsigned char *buf;
+    FILE *fp;
+
+    (*p_size) = file_size(path);
+    if ((*p_size) <= 0) {
+        return NULL;
+    }
+    buf = malloc(*p_size);
+    fp = fopen(path, "rb");
+    if ((buf == NULL) || (fp == NULL) ||
+        (fread(buf, 1, *p_size, fp) != (size_t)(*p_size))) {
+        if (fp != NULL) { fclose(fp); }
+        free(buf);
+        return NULL;
+    }
+    fclose(fp);
+
+    return buf;
+}
+
+/* Write a whole file back. */
+static int store(const char *path, const unsigned char *buf, long size) {
+    FILE *fp;
+    int r;
+
+    fp = fopen(path, "wb");
+    if (fp == NULL) {
+        return -1;
+    }
+    r = (fwrite(buf, 1, size, fp) == (size_t)size) ? 0 : -1;
+    fclose(fp);
+
+    return r;
+}
+
+int main(int argc, char *argv[]) {
+    zdtm_mirror *p_mirror;
+    struct zdtm_dtm_record rec;
+    unsigned char rec_hdr[6];
+    unsigned char *old_idx, *log;
+    uint32_t cursor, sync_id, seen;
+    uint32_t offset, offset2;
+    uint64_t hash;
+    long size, size2, old_idx_size;
+    int ok, fails;
+
+    unlink(MIRROR_PATH);
+    unlink(MIRROR_IDX_PATH);
+
+    /* Put, look up, read, walk, and delete. */
+    if (zdtm_mirror_open(MIRROR_PATH, &p_mirror) != 0) {
+        fprintf(stderr, "ERR: zdtm_mirror_open() failed.\n");
+        return 2;
+    }
+    ok = (put(p_mirror, 1, 0) == 0) && (put(p_mirror, 2, 0) == 0) &&
+        (put(p_mirror, 3, 0) == 0);
+    fails = check("items put", ok && (zdtm_mirror_count(p_mirror) == 3));
+    fails += check("  items looked up and read", holds(p_mirror, 1, 0) &&
+        holds(p_mirror, 2, 0) && holds(p_mirror, 3, 0));
+    fails += check("  unknown item not found",
+        zdtm_mirror_lookup(p_mirror, 4, &hash, NULL) == 1);
+
+    seen = 0;
+    cursor = 0;
+    while (zdtm_mirror_next(p_mirror, &cursor, &sync_id, &hash) == 0) {
+        seen |= (sync_id < 32) ? (1U << sync_id) : 1;
+    }
+    fails += check("  items walked", seen == 0x0e);
+
+    ok = (zdtm_mirror_delete(p_mirror, SYNC_TYPE_TODO, 2) == 0) &&
+        (zdtm_mirror_lookup(p_mirror, 2, &hash, NULL) == 1) &&
+        (zdtm_mirror_count(p_mirror) == 2);
+    fails += check("  item deleted", ok);
+    fails += check("  deleting it again reports it missing",
+        zdtm_mirror_delete(p_mirror, SYNC_TYPE_TODO, 2) == 1);
+
+    ok = (put(p_mirror, 3, 1) == 0) && holds(p_mirror, 3, 1);
+    fails += check("  new version replaces the old one", ok &&
+        (zdtm_mirror_count(p_mirror) == 2));
+    zdtm_mirror_close(p_mirror);
+
+    /* An identical version is not written again. */
+    size = file_size(MIRROR_PATH);
+    if (zdtm_mirror_open(MIRROR_PATH, &p_mirror) != 0) {
+        fprintf(stderr, "ERR: zdtm_mirror_open() failed.\n");
+        return 2;
+    }
+    fails += check("reopened with the matching index",
+        holds(p_mirror, 1, 0) && holds(p_mirror, 3, 1) &&
+        (zdtm_mirror_count(p_mirror) == 2));
+    ok = (zdtm_mirror_lookup(p_mirror, 1, &hash, &offset) == 0) &&
+        (put(p_mirror, 1, 0) == 0) &&
+        (zdtm_mirror_lookup(p_mirror, 1, &hash, &offset2) == 0);
+    zdtm_mirror_close(p_mirror);
+    fails += check("  identical version put again", ok &&
+        (offset == offset2));
+    fails += check("  log not grown", file_size(MIRROR_PATH) == size);
+
+    /* The index left behind by an older session no longer matches the
+     * log, hence it is rebuilt. */
+    old_idx = load(MIRROR_IDX_PATH, &old_idx_size);
+    if (old_idx == NULL) {
+        fprintf(stderr, "ERR: failed to read the index.\n");
+        return 2;
+    }
+    if (zdtm_mirror_open(MIRROR_PATH, &p_mirror) != 0) {
+        fprintf(stderr, "ERR: zdtm_mirror_open() failed.\n");
+        return 2;
+    }
+    ok = (put(p_mirror, 4, 0) == 0) &&
+        (zdtm_mirror_delete(p_mirror, SYNC_TYPE_TODO, 1) == 0);
+    zdtm_mirror_close(p_mirror);
+    ok = ok && (store(MIRROR_IDX_PATH, old_idx, old_idx_size) == 0);
+    free(old_idx);
+
+    if (zdtm_mirror_open(MIRROR_PATH, &p_mirror) != 0) {
+        fprintf(stderr, "ERR: zdtm_mirror_open() failed.\n");
+        return 2;
+    }
+    fails += check("reopened with a stale index", ok &&
+        (zdtm_mirror_lookup(p_mirror, 1, &hash, NULL) == 1) &&
+        holds(p_mirror, 3, 1) && holds(p_mirror, 4, 0) &&
+        (zdtm_mirror_count(p_mirror) == 2));
+    zdtm_mirror_close(p_mirror);
+
+    /* Without an index it is rebuilt from the log as well. */
+    unlink(MIRROR_IDX_PATH);
+    if (zdtm_mirror_open(MIRROR_PATH, &p_mirror) != 0) {
+        fprintf(stderr, "ERR: zdtm_mirror_open() failed.\n");
+        return 2;
+    }
+    fails += check("reopened without an index",
+        (zdtm_mirror_lookup(p_mirror, 1, &hash, NULL) == 1) &&
+        holds(p_mirror, 3, 1) && holds(p_mirror, 4, 0) &&
+        (zdtm_mirror_count(p_mirror) == 2));
+    zdtm_mirror_close(p_mirror);
+    fails += check("  index written again",
+        file_size(MIRROR_IDX_PATH) > 0);
+
+    /* A put interrupted half way through its record. */
+    size = file_size(MIRROR_PATH);
+    if (zdtm_mirror_open(MIRROR_PATH, &p_mirror) != 0) {
+        fprintf(stderr, "ERR: zdtm_mirror_open() failed.\n");
+        return 2;
+    }
+    ok = (put(p_mirror, 5, 0) == 0);
+    zdtm_mirror_close(p_mirror);
+    size2 = file_size(MIRROR_PATH);
+    ok = ok && (size2 > size) &&
+        (truncate(MIRROR_PATH, size + ((size2 - size) / 2)) == 0);
+
+    if (zdtm_mirror_open(MIRROR_PATH, &p_mirror) != 0) {
+        fprintf(stderr, "ERR: zdtm_mirror_open() failed.\n");
+        return 2;
+    }
+    fails += check("truncated trailing record discarded", ok &&
+        (zdtm_mirror_lookup(p_mirror, 5, &hash, NULL) == 1) &&
+        holds(p_mirror, 3, 1) && holds(p_mirror, 4, 0) &&
+        (zdtm_mirror_count(p_mirror) == 2));
+    fails += check("  log cut back to the last whole record",
+        file_size(MIRROR_PATH) == size);
+
+    ok = (put(p_mirror, 5, 0) == 0);
+    zdtm_mirror_close(p_mirror);
+    if (zdtm_mirror_open(MIRROR_PATH, &p_mirror) != 0) {
+        fprintf(stderr, "ERR: zdtm_mirror_open() failed.\n");
+        return 2;
+    }
+    fails += check("  records appended after the cut", ok &&
+        holds(p_mirror, 5, 0) && (zdtm_mirror_count(p_mirror) == 3));
+    zdtm_mirror_close(p_mirror);
+
+    /* Records corrupted in place, which the matching index does not
+     * notice, are refused when read. */
+    if (zdtm_mirror_open(MIRROR_PATH, &p_mirror) != 0) {
+        fprintf(stderr, "ERR: zdtm_mirror_open() failed.\n");
+        return 2;
+    }
+    ok = (zdtm_mirror_lookup(p_mirror, 5, &hash, &offset) == 0);
+    zdtm_mirror_close(p_mirror);
+    log = load(MIRROR_PATH, &size);
+    ok = ok && (log != NULL);
+    if (ok) {
+        memcpy(rec_hdr, log + offset, sizeof(rec_hdr));
+        zdtm_put_le32(log + offset, 1);
+        ok = (store(MIRROR_PATH, log, size) == 0);
+    }
+    if (zdtm_mirror_open(MIRROR_PATH, &p_mirror) != 0) {
+        fprintf(stderr, "ERR: zdtm_mirror_open() failed.\n");
+        return 2;
+    }
+    fails += check("corrupt rec_len refused", ok &&
+        (zdtm_mirror_read(p_mirror, 5, &rec) == -3) &&
+        holds(p_mirror, 3, 1) && holds(p_mirror, 4, 0));
+    zdtm_mirror_close(p_mirror);
+
+    if (log != NULL) {
+        zdtm_put_le32(log + offset, size - offset);
+        ok = ok && (store(MIRROR_PATH, log, size) == 0);
+    }
+    if (zdtm_mirror_open(MIRROR_PATH, &p_mirror) != 0) {
+        fprintf(stderr, "ERR: zdtm_mirror_open() failed.\n");
+        return 2;
+    }
+    fails += check("  rec_len past the log refused", ok &&
+        (zdtm_mirror_read(p_mirror, 5, &rec) == -3));
+    zdtm_mirror_close(p_mirror);
+
+    if (log != NULL) {
+        memcpy(log + offset, rec_hdr, sizeof(rec_hdr));
+        zdtm_put_le32(log + offset + sizeof(rec_hdr), 0xfffffff0);
+        ok = ok && (store(MIRROR_PATH, log, size) == 0);
+    }
+    free(log);
+    if (zdtm_mirror_open(MIRROR_PATH, &p_mirror) != 0) {
+        fprintf(stderr, "ERR: zdtm_mirror_open() failed.\n");
+        return 2;
+    }
+    fails += check("  param_len past the record refused", ok &&
+        (zdtm_mirror_read(p_mirror, 5, &rec) == -3));
+    zdtm_mirror_close(p_mirror);
+
+    unlink(MIRROR_PATH);
+    unlink(MIRROR_IDX_PATH);
+
+    printf("%d failure(s)\n", fails);
+
+    return fails ? 1 : 0;
+}
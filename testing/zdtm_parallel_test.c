@@ -0,0 +1,258 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+
+
+/*
+ * This program runs many synchronizations at once, each in a thread of
+ * its own against a simulated Zaurus of its own, and checks they do
+ * not get in the way of each other. Each environment logs to a sink of
+ * its own kind: a file, a descriptor, a function, or nowhere. As every
+ * synchronization exchanges the same messages, every log kept has to
+ * come out the same size, and the default log file must not be touched.
+ */
+
+#include "zdtm_sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#define PARALLEL_MAX_SYNCS 256
+#define PARALLEL_HOME "/tmp/zdtm_parallel_test.home"
+#define PARALLEL_LOG "/tmp/zdtm_parallel_test"
+
+struct parallel_sync {
+    unsigned int index;
+    unsigned int num_items;
+    int sink;               // ZDTM_LOG_* kind of sink to log to
+    char path[64];          // log file, or file behind the descriptor
+    unsigned long log_size; // bytes logged
+    unsigned long items;    // items obtained
+    int result;
+    pthread_t thread;
+};
+
+static void count_log(const char *buff, unsigned int size, void *arg) {
+    ((struct parallel_sync *)arg)->log_size += size;
+}
+
+static int obtain_items(zdtm_lib_env *cur_env, unsigned long *p_items) {
+    int i, r;
+    uint32_t *p_new_sync_ids, *p_mod_sync_ids, *p_del_sync_ids;
+    uint16_t num_new_sync_ids, num_mod_sync_ids, num_del_sync_ids;
+    struct zdtm_item item;
+
+    r = zdtm_obtain_sync_id_lists(cur_env, &p_new_sync_ids, &num_new_sync_ids,
+        &p_mod_sync_ids, &num_mod_sync_ids, &p_del_sync_ids,
+        &num_del_sync_ids);
+    if (r != 0) {
+        return -1;
+    }
+
+    for (i = 0; i < num_new_sync_ids; i++) {
+        memset(&item, 0, sizeof(struct zdtm_item));
+        item.sync_type = SYNC_TYPE_TODO;
+        r = zdtm_obtain_todo_item(cur_env, p_new_sync_ids[i],
+            &item.cont.todo);
+        if (r != 0) { break; }
+        zdtm_clean_item(&item);
+        (*p_items)++;
+    }
+
+    free(p_new_sync_ids);
+    free(p_mod_sync_ids);
+    free(p_del_sync_ids);
+
+    return (r == 0) ? 0 : -2;
+}
+
+static int run_sync(struct parallel_sync *ps) {
+    struct zdtm_sim sim;
+    zdtm_lib_env cur_env;
+    zdtm_transport *p_tp;
+    char ip[IP_STR_SIZE] = "127.0.0.1";
+    struct stat st;
+    int fd, r;
+
+    if (zdtm_socketpair_transport_new(&p_tp) != 0) {
+        return -1;
+    }
+
+    memset(&sim, 0, sizeof(struct zdtm_sim));
+    sim.first_sync_id = 1;
+    sim.num_new = ps->num_items;
+    sim.transport = p_tp;
+    if (zdtm_sim_start(&sim) != 0) {
+        zdtm_transport_free(p_tp);
+        return -2;
+    }
+
+    fd = -1;
+    snprintf(ps->path, sizeof(ps->path), "%s.%u.log", PARALLEL_LOG,
+        ps->index);
+    unlink(ps->path);
+
+    memset(&cur_env, 0, sizeof(zdtm_lib_env));
+    r = zdtm_initialize_transport(&cur_env, p_tp);
+    if (r == 0) {
+        switch (ps->sink) {
+            case ZDTM_LOG_FILE:
+                r = zdtm_set_log_file(&cur_env, ps->path);
+                break;
+            case ZDTM_LOG_FD:
+                fd = open(ps->path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+                r = (fd < 0) ? -1 : zdtm_set_log_fd(&cur_env, fd);
+                break;
+            case ZDTM_LOG_FUNC:
+                r = zdtm_set_log_func(&cur_env, count_log, ps);
+                break;
+            default:
+                r = zdtm_set_log_none(&cur_env);
+                break;
+        }
+    }
+    if ((r != 0) || (zdtm_set_zaurus_ip(&cur_env, ip) != 0) ||
+        (zdtm_set_sync_type(&cur_env, 0) != 0)) {
+        return -3;
+    }
+
+    r = zdtm_initiate_sync(&cur_env);
+    if (r == 0) {
+        r = obtain_items(&cur_env, &ps->items);
+    }
+    if (r == 0) {
+        r = zdtm_terminate_sync(&cur_env);
+    }
+    zdtm_finalize(&cur_env);
+    if (fd >= 0) {
+        close(fd);
+    }
+
+    if ((zdtm_sim_wait(&sim) != 0) && (r == 0)) {
+        r = -4;
+    }
+    zdtm_transport_free(p_tp);
+
+    if ((ps->sink == ZDTM_LOG_FILE) || (ps->sink == ZDTM_LOG_FD)) {
+        if (stat(ps->path, &st) == 0) {
+            ps->log_size = st.st_size;
+        }
+    }
+    unlink(ps->path);
+
+    return r;
+}
+
+static void *sync_thread(void *arg) {
+    struct parallel_sync *ps;
+
+    ps = (struct parallel_sync *)arg;
+    ps->result = run_sync(ps);
+
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    unsigned int num_syncs, num_items, i;
+    struct parallel_sync *syncs;
+    struct stat st;
+    unsigned long log_size;
+    int failed, same_size, fails;
+
+    if (argc > 3) {
+        printf("Usage: %s [num syncs] [num items per sync]\n", argv[0]);
+        return 0;
+    }
+
+    num_syncs = (argc > 1) ? atoi(argv[1]) : 32;
+    num_items = (argc > 2) ? atoi(argv[2]) : 200;
+    if ((num_syncs < 4) || (num_syncs > PARALLEL_MAX_SYNCS) ||
+        (num_items == 0) || (num_items > 4000)) {
+        fprintf(stderr, "ERR: num syncs must be from 4 to %d and num "
+            "items from 1 to 4000.\n", PARALLEL_MAX_SYNCS);
+        return 2;
+    }
+
+    /* Point HOME at an empty directory to tell whether the default log
+     * file gets created. */
+    mkdir(PARALLEL_HOME, 0755);
+    unlink(PARALLEL_HOME "/.lib_zdtm_sync.log");
+    setenv("HOME", PARALLEL_HOME, 1);
+
+    syncs = calloc(num_syncs, sizeof(struct parallel_sync));
+    if (syncs == NULL) {
+        return 2;
+    }
+
+    for (i = 0; i < num_syncs; i++) {
+        syncs[i].index = i;
+        syncs[i].num_items = num_items;
+        switch (i % 4) {
+            case 0: syncs[i].sink = ZDTM_LOG_FILE; break;
+            case 1: syncs[i].sink = ZDTM_LOG_FD; break;
+            case 2: syncs[i].sink = ZDTM_LOG_FUNC; break;
+            default: syncs[i].sink = ZDTM_LOG_NONE; break;
+        }
+        if (pthread_create(&syncs[i].thread, NULL, sync_thread,
+            &syncs[i]) != 0) {
+            fprintf(stderr, "ERR: pthread_create() failed.\n");
+            return 2;
+        }
+    }
+
+    failed = 0;
+    same_size = 1;
+    log_size = 0;
+    for (i = 0; i < num_syncs; i++) {
+        pthread_join(syncs[i].thread, NULL);
+        if ((syncs[i].result != 0) || (syncs[i].items != num_items)) {
+            fprintf(stderr, "ERR(%d): sync %u obtained %lu items.\n",
+                syncs[i].result, i, syncs[i].items);
+            failed++;
+        }
+        if (syncs[i].sink == ZDTM_LOG_NONE) {
+            same_size &= (syncs[i].log_size == 0);
+        } else if (log_size == 0) {
+            log_size = syncs[i].log_size;
+        } else {
+            same_size &= (syncs[i].log_size == log_size);
+        }
+    }
+
+    fails = 0;
+    fails += check("parallel syncs completed", failed == 0);
+    fails += check("  every log kept on its own", same_size &&
+        (log_size > 0));
+    fails += check("  default log file untouched",
+        stat(PARALLEL_HOME "/.lib_zdtm_sync.log", &st) != 0);
+
+    rmdir(PARALLEL_HOME);
+    free(syncs);
+
+    printf("%u syncs of %u items, %lu bytes logged each\n", num_syncs,
+        num_items, log_size);
+    printf("%d failure(s)\n", fails);
+
+    return fails ? 1 : 0;
+}
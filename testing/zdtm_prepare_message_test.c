@@ -32,7 +32,7 @@ int main(int argc, char *argv[])
     
     memset(&cur_env, 0, sizeof(zdtm_lib_env));
 
-    retval = _zdtm_open_log(&cur_env);
+    retval = _zdtm_open_log(&cur_env, NULL);
     printf("_zdtm_open_log returned (%d).\n", retval);
 
     /* Make a simple RAY msg. */
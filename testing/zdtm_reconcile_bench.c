@@ -0,0 +1,165 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+/**
+ * @file zdtm_reconcile_bench.c
+ * @brief This is a benchmark of the slow sync reconciliation.
+ *
+ * The zdtm_reconcile_bench.c file is a benchmark which runs a series of
+ * slow syncs against a simulated Zaurus, reconciling each one with a
+ * local mirror store, and reports how many items had to be obtained.
+ * The first sync fills the mirror store, the second modifies some of
+ * the items, and the third deletes some of the items.
+ */
+
+#include "zdtm_sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#define BENCH_MAX_ITEMS 7000
+#define BENCH_MIRROR_PATH "/tmp/zdtm_reconcile_bench.log"
+
+static double now(void) {
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + (tv.tv_usec / 1000000.0);
+}
+
+static int run(const char *name, zdtm_mirror *p_mirror, uint32_t first,
+    uint16_t num_new, uint16_t num_mod, uint32_t revision,
+    unsigned int delay_us) {
+
+    struct zdtm_sim sim;
+    zdtm_lib_env cur_env;
+    char ip[IP_STR_SIZE] = "127.0.0.1";
+    uint32_t *p_new_sync_ids, *p_mod_sync_ids, *p_del_sync_ids;
+    uint16_t num_new_sync_ids, num_mod_sync_ids, num_del_sync_ids;
+    double start, secs;
+    int r;
+
+    memset(&sim, 0, sizeof(struct zdtm_sim));
+    sim.first_sync_id = first;
+    sim.num_new = num_new;
+    sim.num_mod = num_mod;
+    sim.mod_revision = revision;
+    sim.item_delay_us = delay_us;
+    if (zdtm_sim_start(&sim) != 0) {
+        fprintf(stderr, "ERR: zdtm_sim_start() failed.\n");
+        return -1;
+    }
+
+    memset(&cur_env, 0, sizeof(zdtm_lib_env));
+    if ((zdtm_initialize(&cur_env) != 0) ||
+        (zdtm_set_zaurus_ip(&cur_env, ip) != 0) ||
+        (zdtm_set_sync_type(&cur_env, 0) != 0) ||
+        (zdtm_set_mirror(&cur_env, p_mirror) != 0)) {
+        fprintf(stderr, "ERR: failed to set up the library.\n");
+        return -2;
+    }
+
+    r = zdtm_initiate_sync(&cur_env);
+    if (r != 0) {
+        fprintf(stderr, "ERR(%d): zdtm_initiate_sync() failed.\n", r);
+        return -3;
+    }
+
+    start = now();
+    r = zdtm_reconcile_sync_id_lists(&cur_env, &p_new_sync_ids,
+        &num_new_sync_ids, &p_mod_sync_ids, &num_mod_sync_ids,
+        &p_del_sync_ids, &num_del_sync_ids);
+    secs = now() - start;
+    if (r != 0) {
+        fprintf(stderr, "ERR(%d): zdtm_reconcile_sync_id_lists() failed.\n",
+            r);
+        return -4;
+    }
+    free(p_new_sync_ids);
+    free(p_mod_sync_ids);
+    free(p_del_sync_ids);
+
+    zdtm_terminate_sync(&cur_env);
+    zdtm_finalize(&cur_env);
+
+    r = zdtm_sim_wait(&sim);
+    if (r != 0) {
+        fprintf(stderr, "ERR(%d): the simulated Zaurus failed.\n", r);
+        return -5;
+    }
+
+    printf("%-8s %6u items %6u new %6u mod %6u del %6lu RDR %10.3f s\n",
+        name, num_new + num_mod, num_new_sync_ids, num_mod_sync_ids,
+        num_del_sync_ids, sim.num_rdr, secs);
+
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    unsigned int num_items, num_changed, delay_us;
+    zdtm_mirror *p_mirror;
+    int r;
+
+    if (argc > 4) {
+        printf("Usage: %s [num items] [num changed] "
+            "[simulated RDR latency in usec]\n", argv[0]);
+        return 0;
+    }
+
+    num_items = (argc > 1) ? atoi(argv[1]) : 5000;
+    num_changed = (argc > 2) ? atoi(argv[2]) : 50;
+    delay_us = (argc > 3) ? atoi(argv[3]) : 0;
+    if ((num_items == 0) || (num_items > BENCH_MAX_ITEMS) ||
+        (num_changed >= num_items / 2)) {
+        fprintf(stderr, "ERR: num items must be from 1 to %d and num "
+            "changed below half of it.\n", BENCH_MAX_ITEMS);
+        return 1;
+    }
+
+    unlink(BENCH_MIRROR_PATH);
+    unlink(BENCH_MIRROR_PATH ZDTM_MIRROR_IDX_SUFFIX);
+    if (zdtm_mirror_open(BENCH_MIRROR_PATH, &p_mirror) != 0) {
+        fprintf(stderr, "ERR: zdtm_mirror_open() failed.\n");
+        return 2;
+    }
+
+    /* The first num_changed items of the new list are deleted by the
+     * last sync, the items of the mod list are modified by the second
+     * one. */
+    r = run("initial", p_mirror, 1, num_items - num_changed, num_changed, 0,
+        delay_us);
+    if (r == 0) {
+        r = run("modified", p_mirror, 1, num_items - num_changed,
+            num_changed, 1, delay_us);
+    }
+    if (r == 0) {
+        r = run("deleted", p_mirror, 1 + num_changed,
+            num_items - (2 * num_changed), num_changed, 1, delay_us);
+    }
+
+    zdtm_mirror_close(p_mirror);
+    unlink(BENCH_MIRROR_PATH);
+    unlink(BENCH_MIRROR_PATH ZDTM_MIRROR_IDX_SUFFIX);
+
+    return (r == 0) ? 0 : 3;
+}
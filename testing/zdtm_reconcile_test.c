@@ -0,0 +1,306 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+
+/*
+ * This program checks the slow sync reconciliation against a simulated
+ * Zaurus. A mirror store is seeded with known items, and the new, mod,
+ * and del lists built for the items the simulated Zaurus lists have to
+ * hold exactly the added, modified, and removed ones, leaving out the
+ * unchanged ones, while the mirror store has to hold the current
+ * version of every listed item afterwards. More deleted items than fit
+ * in a del list have to be reported rather than silently left behind.
+ */
+
+#include "zdtm_sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MIRROR_PATH "/tmp/zdtm_reconcile_test.log"
+#define MIRROR_IDX_PATH MIRROR_PATH ZDTM_MIRROR_IDX_SUFFIX
+#define MAX_PARAMS 16
+
+/* Build the params of the given revision of a simulated item, which
+ * point into buf. */
+static int build_params(uint32_t sync_id, uint32_t revision,
+    unsigned char *buf, int size, struct zdtm_adr_msg_param *params,
+    uint16_t *p_num_params) {
+
+    unsigned char *p;
+    uint16_t i;
+
+    if (zdtm_sim_build_item(sync_id, revision, buf, size) < 0) {
+        return -1;
+    }
+
+    p = buf;
+    (*p_num_params) = zdtm_get_le16(p);
+    if ((*p_num_params) > MAX_PARAMS) {
+        return -1;
+    }
+    p += sizeof(uint16_t);
+    for (i = 0; i < (*p_num_params); i++) {
+        params[i].param_len = zdtm_get_le32(p);
+        params[i].param_data = p + sizeof(uint32_t);
+        p += sizeof(uint32_t) + params[i].param_len;
+    }
+
+    return 0;
+}
+
+/* Put the given revision of a simulated item in the mirror store. */
+static int seed(zdtm_mirror *p_mirror, uint32_t sync_id, uint32_t revision) {
+
+    struct zdtm_adr_msg_param params[MAX_PARAMS];
+    unsigned char buf[1024];
+    uint16_t num_params;
+
+    if (build_params(sync_id, revision, buf, sizeof(buf), params,
+        &num_params) != 0) {
+        return -1;
+    }
+
+    return zdtm_mirror_put(p_mirror, SYNC_TYPE_TODO, sync_id, params,
+        num_params);
+}
+
+/* Check that the mirror store holds the given revision of an item. */
+static int holds(zdtm_mirror *p_mirror, uint32_t sync_id,
+    uint32_t revision) {
+
+    struct zdtm_adr_msg_param params[MAX_PARAMS];
+    unsigned char buf[1024];
+    uint16_t num_params;
+    uint64_t hash;
+
+    if (build_params(sync_id, revision, buf, sizeof(buf), params,
+        &num_params) != 0) {
+        return 0;
+    }
+
+    return (zdtm_mirror_lookup(p_mirror, sync_id, &hash, NULL) == 0) &&
+        (hash == zdtm_mirror_hash(params, num_params));
+}
+
+/* Check that a list holds exactly the given sync ids, in any order. */
+static int is_list(const uint32_t *sync_ids, uint16_t num_sync_ids,
+    uint32_t first, uint32_t num) {
+
+    uint16_t i;
+
+    if (num_sync_ids != num) {
+        return 0;
+    }
+    for (i = 0; i < num_sync_ids; i++) {
+        if ((sync_ids[i] < first) || (sync_ids[i] >= first + num)) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+struct lists {
+    uint32_t *new_ids, *mod_ids, *del_ids;
+    uint16_t num_new, num_mod, num_del;
+    unsigned long num_rdr;
+};
+
+/* Reconcile the mirror store against a simulated Zaurus listing the
+ * given items, returning the result of the reconciliation. */
+static int reconcile(zdtm_mirror *p_mirror, uint32_t first,
+    uint16_t num_new, uint16_t num_mod, uint32_t revision,
+    struct lists *p_lists) {
+
+    struct zdtm_sim sim;
+    zdtm_lib_env cur_env;
+    char ip[IP_STR_SIZE] = "127.0.0.1";
+    int r;
+
+    memset(p_lists, 0, sizeof(struct lists));
+    memset(&sim, 0, sizeof(struct zdtm_sim));
+    sim.first_sync_id = first;
+    sim.num_new = num_new;
+    sim.num_mod = num_mod;
+    sim.mod_revision = revision;
+    if (zdtm_sim_start(&sim) != 0) {
+        fprintf(stderr, "ERR: zdtm_sim_start() failed.\n");
+        return -10;
+    }
+
+    memset(&cur_env, 0, sizeof(zdtm_lib_env));
+    if ((zdtm_initialize(&cur_env) != 0) ||
+        (zdtm_set_zaurus_ip(&cur_env, ip) != 0) ||
+        (zdtm_set_sync_type(&cur_env, 0) != 0) ||
+        (zdtm_set_mirror(&cur_env, p_mirror) != 0) ||
+        (zdtm_initiate_sync(&cur_env) != 0)) {
+        fprintf(stderr, "ERR: failed to start the session.\n");
+        zdtm_finalize(&cur_env);
+        zdtm_sim_wait(&sim);
+        return -11;
+    }
+
+    r = zdtm_reconcile_sync_id_lists(&cur_env, &p_lists->new_ids,
+        &p_lists->num_new, &p_lists->mod_ids, &p_lists->num_mod,
+        &p_lists->del_ids, &p_lists->num_del);
+
+    zdtm_terminate_sync(&cur_env);
+    zdtm_finalize(&cur_env);
+    if (zdtm_sim_wait(&sim) != 0) {
+        r = -12;
+    }
+    p_lists->num_rdr = sim.num_rdr;
+
+    return r;
+}
+
+static void free_lists(struct lists *p_lists) {
+    free(p_lists->new_ids);
+    free(p_lists->mod_ids);
+    free(p_lists->del_ids);
+}
+
+static int open_mirror(zdtm_mirror **pp_mirror) {
+    unlink(MIRROR_PATH);
+    unlink(MIRROR_IDX_PATH);
+
+    return zdtm_mirror_open(MIRROR_PATH, pp_mirror);
+}
+
+static int test_lists(void) {
+    zdtm_mirror *p_mirror;
+    struct lists lists;
+    uint64_t hash;
+    uint32_t i;
+    int fails, ok, r;
+
+    if (open_mirror(&p_mirror) != 0) {
+        return check("mirror store opened", 0);
+    }
+
+    /* The mirror store holds items 1 to 12, the simulated Zaurus lists
+     * items 3 to 14. Items 1 and 2 are deleted, 3 to 10 are unchanged,
+     * 11 and 12 are modified, and 13 and 14 are new. */
+    ok = 1;
+    for (i = 1; i <= 12; i++) {
+        ok = ok && (seed(p_mirror, i, 0) == 0);
+    }
+    fails = check("mirror store seeded", ok);
+
+    r = reconcile(p_mirror, 3, 8, 4, 1, &lists);
+    fails += check("lists reconciled", r == 0);
+    if (r < 0) {
+        zdtm_mirror_close(p_mirror);
+        return fails;
+    }
+    fails += check("  new list holds the added items",
+        is_list(lists.new_ids, lists.num_new, 13, 2));
+    fails += check("  mod list holds the modified items",
+        is_list(lists.mod_ids, lists.num_mod, 11, 2));
+    fails += check("  del list holds the removed items",
+        is_list(lists.del_ids, lists.num_del, 1, 2));
+    fails += check("  only the changed items obtained",
+        lists.num_rdr == 4);
+    free_lists(&lists);
+
+    ok = (zdtm_mirror_count(p_mirror) == 12) &&
+        (zdtm_mirror_lookup(p_mirror, 1, &hash, NULL) == 1) &&
+        (zdtm_mirror_lookup(p_mirror, 2, &hash, NULL) == 1);
+    for (i = 3; i <= 14; i++) {
+        ok = ok && holds(p_mirror, i, (i < 11) ? 0 : 1);
+    }
+    fails += check("  mirror store holds the listed items", ok);
+
+    /* Nothing changed since, nothing is obtained again. */
+    r = reconcile(p_mirror, 3, 8, 4, 1, &lists);
+    fails += check("reconciled again", (r == 0) &&
+        (lists.num_new == 0) && (lists.num_mod == 0) &&
+        (lists.num_del == 0) && (lists.num_rdr == 0));
+    if (r >= 0) {
+        free_lists(&lists);
+    }
+
+    zdtm_mirror_close(p_mirror);
+
+    return fails;
+}
+
+static int test_more_deleted(void) {
+    zdtm_mirror *p_mirror;
+    struct zdtm_adr_msg_param param;
+    struct lists lists;
+    unsigned char data[4];
+    uint32_t i, num;
+    int fails, ok, r;
+
+    if (open_mirror(&p_mirror) != 0) {
+        return check("mirror store opened", 0);
+    }
+
+    /* Two more items than a del list holds, none of which are listed. */
+    num = 0xffff + 2;
+    ok = 1;
+    param.param_len = sizeof(data);
+    param.param_data = data;
+    for (i = 1; ok && (i <= num); i++) {
+        zdtm_put_le32(data, i);
+        ok = (zdtm_mirror_put(p_mirror, SYNC_TYPE_TODO, 1000000 + i, &param,
+            1) == 0);
+    }
+    fails = check("more deleted items than a list holds seeded", ok);
+
+    r = reconcile(p_mirror, 1, 1, 0, 0, &lists);
+    fails += check("  more deleted items reported", (r == 1) &&
+        (lists.num_del == 0xffff) &&
+        (zdtm_mirror_count(p_mirror) == 3));
+    if (r >= 0) {
+        free_lists(&lists);
+    }
+
+    r = reconcile(p_mirror, 1, 1, 0, 0, &lists);
+    fails += check("  remaining ones found reconciling again",
+        (r == 0) && (lists.num_new == 0) && (lists.num_del == 2) &&
+        (zdtm_mirror_count(p_mirror) == 1) && holds(p_mirror, 1, 0));
+    if (r >= 0) {
+        free_lists(&lists);
+    }
+
+    zdtm_mirror_close(p_mirror);
+
+    return fails;
+}
+
+int main(int argc, char *argv[]) {
+    int fails;
+
+    fails = 0;
+    fails += test_lists();
+    fails += test_more_deleted();
+
+    unlink(MIRROR_PATH);
+    unlink(MIRROR_IDX_PATH);
+
+    printf("%d failure(s)\n", fails);
+
+    return fails ? 1 : 0;
+}
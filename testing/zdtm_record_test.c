@@ -0,0 +1,343 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+
+
+
+/*
+ * This program checks item records. The parameters of a format are
+ * looked up by abbreviation, an item is decoded into a record whatever
+ * its parameters, raw content cut short is refused, and a record is
+ * written back in an RDW message with every field as it was, including
+ * those of parameters the library has no member for.
+ */
+
+#include "zdtm_sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RECORD_NUM_PARAMS 40
+
+/* A format of the Todo params along with made up ones, whose last
+ * param repeats the abbreviation of the first. */
+static void build_format(struct zdtm_adi_msg_param *format) {
+    static const char *known[] = {"ATTR", "CTTM", "MDTM", "SYID", "CTGR",
+        "ETDY", "LTDY", "FNDY", "MARK", "PRTY", "TITL", "MEM1"};
+    char abrev[8];
+    int i;
+
+    memset(format, 0, RECORD_NUM_PARAMS * sizeof(format[0]));
+    for (i = 0; i < RECORD_NUM_PARAMS - 1; i++) {
+        if (i < 12) {
+            memcpy(format[i].abrev, known[i], 4);
+        } else {
+            snprintf(abrev, sizeof(abrev), "X%03d", i);
+            memcpy(format[i].abrev, abrev, 4);
+        }
+        format[i].type_id = DATA_ID_UTF8;
+    }
+    memcpy(format[RECORD_NUM_PARAMS - 1].abrev, "ATTR", 4);
+}
+
+/* Raw ADR content of an item whose field i is i bytes of value i, less
+ * the SYID field which holds the given sync id. */
+static int build_adr(unsigned char *buf, uint32_t sync_id) {
+    unsigned char *p;
+    int i;
+
+    p = buf;
+    p[0] = 0x00;
+    p[1] = 0x00;
+    zdtm_put_le16(p + 2, RECORD_NUM_PARAMS);
+    p += 4;
+    for (i = 0; i < RECORD_NUM_PARAMS; i++) {
+        if (i == 3) {
+            zdtm_put_le32(p, 4);
+            zdtm_put_le32(p + 4, sync_id);
+            p += 8;
+        } else {
+            zdtm_put_le32(p, i);
+            memset(p + 4, i, i);
+            p += 4 + i;
+        }
+    }
+
+    return p - buf;
+}
+
+static int fields_ok(const zdtm_record *p_rec) {
+    uint32_t len;
+    int i, j;
+
+    for (i = 0; i < RECORD_NUM_PARAMS; i++) {
+        if (i == 3) { continue; }
+        len = zdtm_record_len(p_rec, i);
+        if (len != (uint32_t)i) { return 0; }
+        for (j = 0; j < i; j++) {
+            if (zdtm_record_field(p_rec, i)[j] != i) { return 0; }
+        }
+    }
+
+    return 1;
+}
+
+static int test_schema(struct zdtm_adi_msg_param *format,
+    zdtm_schema *p_schema) {
+    int i, ok, fails;
+
+    ok = (zdtm_schema_init(p_schema, format, RECORD_NUM_PARAMS) == 0);
+    for (i = 0; ok && (i < RECORD_NUM_PARAMS - 1); i++) {
+        ok = (zdtm_schema_index(p_schema, (char *)format[i].abrev) == i);
+    }
+    fails = check("every param looked up by abbreviation", ok);
+    fails += check("  repeated abbreviation finds the first",
+        zdtm_schema_index(p_schema, "ATTR") == 0);
+    fails += check("  unknown abbreviation not found",
+        (zdtm_schema_index(p_schema, "NONE") == -1) &&
+        (zdtm_schema_index(p_schema, "X000") == -1));
+    fails += check("  shorter abbreviation not found",
+        (zdtm_schema_index(p_schema, "TIT") == -1) &&
+        (zdtm_schema_index(p_schema, "TI") == -1) &&
+        (zdtm_schema_index(p_schema, "") == -1));
+
+    return fails;
+}
+
+static int test_decode(zdtm_schema *p_schema) {
+    struct zdtm_adr_msg_param params[RECORD_NUM_PARAMS];
+    zdtm_record rec, rec2;
+    unsigned char buf[1024];
+    const unsigned char *p;
+    uint32_t len;
+    int size, i, refused, fails;
+
+    size = build_adr(buf, 0x01020304);
+    zdtm_record_init(&rec);
+    fails = check("record decoded from raw ADR content",
+        (zdtm_record_decode(p_schema, buf, size, &rec) == 0) &&
+        fields_ok(&rec) && (rec.sync_id == 0x01020304));
+
+    p = zdtm_record_get(&rec, "X020", &len);
+    fails += check("  unknown param field kept",
+        (p != NULL) && (len == 20) && (p[0] == 20));
+    fails += check("  field of a param the format lacks not found",
+        zdtm_record_get(&rec, "NONE", &len) == NULL);
+
+    refused = 0;
+    zdtm_record_init(&rec2);
+    for (i = 0; i < size; i++) {
+        if (zdtm_record_decode(p_schema, buf, i, &rec2) == RET_BAD_SIZE) {
+            refused++;
+        }
+    }
+    fails += check("  truncated ADR content refused", refused == size);
+
+    zdtm_put_le16(buf + 2, RECORD_NUM_PARAMS - 1);
+    fails += check("  item of another format refused",
+        zdtm_record_decode(p_schema, buf, size, &rec2) == -1);
+
+    /* The same record built from the params of the item. */
+    for (i = 0; i < RECORD_NUM_PARAMS; i++) {
+        params[i].param_len = zdtm_record_len(&rec, i);
+        params[i].param_data = (unsigned char *)zdtm_record_field(&rec, i);
+    }
+    fails += check("  record built from params the same",
+        (zdtm_record_from_params(p_schema, params, RECORD_NUM_PARAMS,
+            &rec2) == 0) && fields_ok(&rec2) &&
+        (rec2.sync_id == 0x01020304) &&
+        (memcmp(rec.offsets, rec2.offsets,
+            (RECORD_NUM_PARAMS + 1) * sizeof(uint32_t)) == 0));
+
+    zdtm_record_free(&rec);
+    zdtm_record_free(&rec2);
+
+    return fails;
+}
+
+static int test_set(zdtm_schema *p_schema) {
+    zdtm_record rec;
+    unsigned char buf[1024], id[4];
+    char title[200];
+    const unsigned char *p;
+    uint32_t len;
+    int i, ok, fails;
+
+    zdtm_record_init(&rec);
+    zdtm_record_decode(p_schema, buf, build_adr(buf, 7), &rec);
+
+    memset(title, 'T', sizeof(title));
+    i = zdtm_schema_index(p_schema, "TITL");
+    ok = (zdtm_record_set(&rec, i, title, sizeof(title)) == 0);
+    p = zdtm_record_get(&rec, "TITL", &len);
+    ok = ok && (len == sizeof(title)) && (memcmp(p, title, len) == 0);
+    p = zdtm_record_get(&rec, "X038", &len);
+    fails = check("field grown, fields after it kept",
+        ok && (len == 38) && (p[37] == 38));
+
+    ok = (zdtm_record_set(&rec, i, "", 0) == 0);
+    p = zdtm_record_get(&rec, "X038", &len);
+    fails += check("  field shrunk, fields after it kept",
+        ok && (zdtm_record_len(&rec, i) == 0) && (len == 38) &&
+        (p[37] == 38));
+
+    zdtm_put_le32(id, 0x0a0b0c0d);
+    fails += check("  sync id set along with SYID field",
+        (zdtm_record_set(&rec, 3, id, 4) == 0) &&
+        (rec.sync_id == 0x0a0b0c0d));
+    fails += check("  field out of range refused",
+        zdtm_record_set(&rec, RECORD_NUM_PARAMS, id, 4) == -1);
+
+    zdtm_record_free(&rec);
+
+    return fails;
+}
+
+static int test_write(zdtm_schema *p_schema) {
+    zdtm_lib_env cur_env;
+    zdtm_record recs[2];
+    zdtm_msg msg;
+    zdtm_reader rd;
+    unsigned char buf[1024], *out;
+    uint32_t size, len;
+    int i, j, ok, fails;
+
+    for (i = 0; i < 2; i++) {
+        zdtm_record_init(&recs[i]);
+        zdtm_record_decode(p_schema, buf, build_adr(buf, 100 + i),
+            &recs[i]);
+    }
+
+    memset(&msg, 0, sizeof(zdtm_msg));
+    memcpy(msg.body.type, RDW_MSG_TYPE, MSG_TYPE_SIZE);
+    msg.body.cont.rdw.sync_type = SYNC_TYPE_TODO;
+    msg.body.cont.rdw.num_sync_ids = 2;
+    msg.body.cont.rdw.variation = RDW_VAR_RECORD;
+    msg.body.cont.rdw.vars.four.items = recs;
+
+    memset(&cur_env, 0, sizeof(zdtm_lib_env));
+    out = malloc(8192);
+    ok = (_zdtm_write_message(&msg, out, 8192, &size) == 0) &&
+        (msg.body.cont.rdw.vars.four.num_written == 2);
+
+    /* Read the records back, field by field. */
+    zdtm_rd_init(&rd, out + MSG_HDR_SIZE + 2 + MSG_TYPE_SIZE,
+        msg.cont_size);
+    ok = ok && (zdtm_rd_u8(&rd) == SYNC_TYPE_TODO) &&
+        (zdtm_rd_u16(&rd) == 2);
+    for (i = 0; ok && (i < 2); i++) {
+        ok = (zdtm_rd_u32(&rd) == (uint32_t)(100 + i));
+        for (j = 0; ok && (j < RECORD_NUM_PARAMS); j++) {
+            len = zdtm_rd_u32(&rd);
+            ok = (len == zdtm_record_len(&recs[i], j)) &&
+                (memcmp(zdtm_rd_skip(&rd, len),
+                    zdtm_record_field(&recs[i], j), len) == 0);
+        }
+    }
+    fails = check("records written back field for field",
+        ok && (zdtm_rd_left(&rd) == 0));
+
+    memset(&msg, 0, sizeof(zdtm_msg));
+    memcpy(msg.body.type, RDW_MSG_TYPE, MSG_TYPE_SIZE);
+    msg.body.cont.rdw.sync_type = SYNC_TYPE_TODO;
+    msg.body.cont.rdw.num_sync_ids = 2;
+    msg.body.cont.rdw.variation = RDW_VAR_RECORD;
+    msg.body.cont.rdw.vars.four.items = recs;
+    fails += check("  prepared records the same as written",
+        (_zdtm_prepare_message(&cur_env, &msg) == 0) &&
+        (msg.cont_size == size - ZDTM_MSG_OVERHEAD) &&
+        (memcmp(msg.body.p_raw_content,
+            out + MSG_HDR_SIZE + 2 + MSG_TYPE_SIZE, msg.cont_size) == 0));
+    _zdtm_clean_message(&msg);
+
+    free(out);
+    for (i = 0; i < 2; i++) {
+        zdtm_record_free(&recs[i]);
+    }
+
+    return fails;
+}
+
+static int test_lazy(zdtm_schema *p_schema) {
+    zdtm_lazy_item item;
+    zdtm_record rec;
+    unsigned char *buf;
+    const unsigned char *p;
+    uint32_t len;
+    int size, i, ok, fails;
+
+    buf = malloc(1024);
+    size = build_adr(buf, 0x0a0b0c0d);
+
+    zdtm_lazy_item_init(&item);
+    zdtm_record_init(&rec);
+    ok = (zdtm_lazy_item_attach(&item, p_schema, buf, size - 1) ==
+        RET_BAD_SIZE) && (item.buf == NULL);
+    fails = check("lazy item of content cut short refused", ok);
+
+    ok = (zdtm_lazy_item_attach(&item, p_schema, buf, size) == 0) &&
+        (item.sync_id == 0x0a0b0c0d);
+    fails += check("  lazy item attached", ok);
+
+    p = zdtm_lazy_item_get(&item, "X020", &len);
+    /* Past the count, the 20 fields ahead of it, SYID of 4 bytes rather
+     * than 3 among them, and its own length. */
+    ok = (p == buf + 4 + 20 * 4 + (190 - 3 + 4) + 4) && (len == 20) &&
+        (p[19] == 20);
+    fails += check("  field found in place in the raw content", ok);
+    fails += check("  field of a param the format lacks not found",
+        (zdtm_lazy_item_get(&item, "NONE", &len) == NULL) &&
+        (zdtm_lazy_item_field(&item, RECORD_NUM_PARAMS, &len) == NULL));
+
+    ok = (zdtm_lazy_item_record(&item, &rec) == 0) && fields_ok(&rec);
+    for (i = 0; ok && (i < RECORD_NUM_PARAMS); i++) {
+        p = zdtm_lazy_item_field(&item, i, &len);
+        ok = (len == zdtm_record_len(&rec, i)) &&
+            (memcmp(p, zdtm_record_field(&rec, i), len) == 0);
+    }
+    fails += check("  every field the same as decoded", ok);
+
+    zdtm_record_free(&rec);
+    zdtm_lazy_item_free(&item);
+
+    return fails;
+}
+
+int main(int argc, char *argv[]) {
+    struct zdtm_adi_msg_param format[RECORD_NUM_PARAMS];
+    zdtm_schema schema;
+    int fails;
+
+    build_format(format);
+
+    fails = 0;
+    fails += test_schema(format, &schema);
+    fails += test_decode(&schema);
+    fails += test_set(&schema);
+    fails += test_write(&schema);
+    fails += test_lazy(&schema);
+
+    zdtm_schema_free(&schema);
+
+    printf("%d failure(s)\n", fails);
+
+    return fails ? 1 : 0;
+}
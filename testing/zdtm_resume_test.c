@@ -0,0 +1,221 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+
+
+/*
+ * This program checks that an interrupted synchronization is resumed
+ * from its checkpoint journal. The simulated Zaurus drops the
+ * connection part way through the items, the following session of the
+ * same device state has to skip the items already obtained, and one of
+ * a different device state has to start over. An interrupted slow sync
+ * has to be resumed even though the Zaurus has cleared its slow sync
+ * flag by then.
+ */
+
+#include "zdtm_sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define RESUME_JOURNAL_PATH "/tmp/zdtm_resume_test.journal"
+#define RESUME_NUM_NEW 2000
+#define RESUME_NUM_DEL 10
+
+struct session {
+    unsigned char fullsync_flags;   // AMG full sync flags of the Zaurus
+    unsigned long drop_after_rdr;   // RDRs served before dropping
+    int resumed;                    // journal resumed the session
+    int slow;                       // session reported a slow sync
+    uint16_t num_new;               // length of the new list obtained
+    uint16_t num_del;               // length of the del list obtained
+    unsigned long num_obtained;     // items obtained before the end
+    unsigned long num_rdr;          // RDR messages served by the Zaurus
+    int terminated;                 // session terminated properly
+};
+
+static int run(struct session *s) {
+    struct zdtm_sim sim;
+    zdtm_lib_env cur_env;
+    zdtm_journal *p_journal;
+    char ip[IP_STR_SIZE] = "127.0.0.1";
+    uint32_t *p_new_sync_ids, *p_mod_sync_ids, *p_del_sync_ids;
+    uint16_t num_new_sync_ids, num_mod_sync_ids, num_del_sync_ids;
+    struct zdtm_item item;
+    int i, r;
+
+    s->resumed = 0;
+    s->slow = 0;
+    s->num_new = 0;
+    s->num_del = 0;
+    s->num_obtained = 0;
+    s->terminated = 0;
+
+    if (zdtm_journal_open(RESUME_JOURNAL_PATH, &p_journal) != 0) {
+        fprintf(stderr, "ERR: zdtm_journal_open() failed.\n");
+        return -1;
+    }
+
+    memset(&sim, 0, sizeof(struct zdtm_sim));
+    sim.fullsync_flags = s->fullsync_flags;
+    sim.first_sync_id = 1;
+    sim.num_new = RESUME_NUM_NEW;
+    sim.num_del = RESUME_NUM_DEL;
+    sim.drop_after_rdr = s->drop_after_rdr;
+    if (zdtm_sim_start(&sim) != 0) {
+        fprintf(stderr, "ERR: zdtm_sim_start() failed.\n");
+        zdtm_journal_close(p_journal);
+        return -2;
+    }
+
+    memset(&cur_env, 0, sizeof(zdtm_lib_env));
+    if ((zdtm_initialize(&cur_env) != 0) ||
+        (zdtm_set_zaurus_ip(&cur_env, ip) != 0) ||
+        (zdtm_set_sync_type(&cur_env, 0) != 0) ||
+        (zdtm_set_journal(&cur_env, p_journal) != 0)) {
+        fprintf(stderr, "ERR: failed to set up the library.\n");
+        return -3;
+    }
+
+    r = zdtm_initiate_sync(&cur_env);
+    if (r != 0) {
+        fprintf(stderr, "ERR(%d): zdtm_initiate_sync() failed.\n", r);
+        return -4;
+    }
+    s->resumed = zdtm_journal_resumed(p_journal);
+    s->slow = zdtm_requires_slow_sync(&cur_env);
+
+    r = zdtm_obtain_sync_id_lists(&cur_env, &p_new_sync_ids,
+        &num_new_sync_ids, &p_mod_sync_ids, &num_mod_sync_ids,
+        &p_del_sync_ids, &num_del_sync_ids);
+    if (r != 0) {
+        fprintf(stderr, "ERR(%d): zdtm_obtain_sync_id_lists() failed.\n", r);
+        return -5;
+    }
+    s->num_new = num_new_sync_ids;
+    s->num_del = num_del_sync_ids;
+
+    for (i = 0; i < num_new_sync_ids; i++) {
+        memset(&item, 0, sizeof(struct zdtm_item));
+        item.sync_type = SYNC_TYPE_TODO;
+        r = zdtm_obtain_todo_item(&cur_env, p_new_sync_ids[i],
+            &item.cont.todo);
+        if (r != 0) { break; }
+        zdtm_clean_item(&item);
+        s->num_obtained++;
+    }
+
+    free(p_new_sync_ids);
+    free(p_mod_sync_ids);
+    free(p_del_sync_ids);
+
+    if (r == 0) {
+        r = zdtm_terminate_sync(&cur_env);
+        s->terminated = (r == 0);
+    } else {
+        /* The Zaurus went away, drop what is left of the session. */
+        _zdtm_close_conn_to_zaurus(&cur_env);
+        _zdtm_close_zaurus_conn(&cur_env);
+    }
+    zdtm_finalize(&cur_env);
+
+    zdtm_sim_wait(&sim);
+    s->num_rdr = sim.num_rdr;
+
+    zdtm_journal_close(p_journal);
+
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    struct session s;
+    struct stat st;
+    FILE *fp;
+    int fails;
+
+    fails = 0;
+    unlink(RESUME_JOURNAL_PATH);
+
+    /* The first session is interrupted after 700 items. */
+    memset(&s, 0, sizeof(struct session));
+    s.fullsync_flags = 0x01;
+    s.drop_after_rdr = 700;
+    if (run(&s) != 0) { return 2; }
+    fails += check("interrupted session", !s.resumed && !s.terminated &&
+        (s.num_new == RESUME_NUM_NEW) && (s.num_obtained == 700));
+
+    /* A Zaurus now requiring a slow sync is not in the state the journal
+     * recorded, hence it starts over. */
+    memset(&s, 0, sizeof(struct session));
+    s.drop_after_rdr = 300;
+    if (run(&s) != 0) { return 2; }
+    fails += check("changed device state starts over", !s.resumed &&
+        !s.terminated && (s.num_new == RESUME_NUM_NEW) &&
+        (s.num_obtained == 300));
+
+    /* An interrupted write leaves a partial record behind. */
+    fp = fopen(RESUME_JOURNAL_PATH, "ab");
+    if (fp != NULL) {
+        fwrite("\x01\x00\x00", 1, 3, fp);
+        fclose(fp);
+    }
+
+    /* The same state resumes with the items not obtained yet. */
+    memset(&s, 0, sizeof(struct session));
+    if (run(&s) != 0) { return 2; }
+    fails += check("resumed session", s.resumed && s.terminated);
+    fails += check("  lists without the obtained items",
+        (s.num_new == RESUME_NUM_NEW - 300) && (s.num_del == RESUME_NUM_DEL));
+    fails += check("  only the remaining items requested",
+        s.num_rdr == RESUME_NUM_NEW - 300);
+    fails += check("  journal emptied once terminated",
+        (stat(RESUME_JOURNAL_PATH, &st) == 0) && (st.st_size == 0));
+
+    /* Nothing is left to resume after a proper termination. */
+    memset(&s, 0, sizeof(struct session));
+    if (run(&s) != 0) { return 2; }
+    fails += check("complete session not resumed", !s.resumed &&
+        s.terminated && (s.num_rdr == RESUME_NUM_NEW));
+
+    /* A slow sync is interrupted after it reset the sync state, the
+     * Zaurus then reports the Todo slow sync flag clear. */
+    memset(&s, 0, sizeof(struct session));
+    s.drop_after_rdr = 500;
+    if (run(&s) != 0) { return 2; }
+    fails += check("interrupted slow sync", !s.resumed && s.slow &&
+        !s.terminated && (s.num_obtained == 500));
+
+    memset(&s, 0, sizeof(struct session));
+    s.fullsync_flags = 0x01;
+    if (run(&s) != 0) { return 2; }
+    fails += check("slow sync resumed with the flag clear", s.resumed &&
+        s.terminated && (s.num_new == RESUME_NUM_NEW - 500) &&
+        (s.num_rdr == RESUME_NUM_NEW - 500));
+    fails += check("  still reported as a slow sync", s.slow == 1);
+
+    unlink(RESUME_JOURNAL_PATH);
+
+    printf("%d failure(s)\n", fails);
+
+    return fails ? 1 : 0;
+}
@@ -0,0 +1,819 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+/**
+ * @file zdtm_sim.c
+ * @brief This is an implementation file for a simulated Zaurus.
+ *
+ * The zdtm_sim.c file is an implementation of a simulated Zaurus
+ * synchronization daemon. It accepts the desktop RAY message on the
+ * Zaurus listening port, connects back to the desktop and answers the
+ * desktop messages the way the Zaurus does, handing out generated todo
+ * items. The same items are served in bulk as a DTM box file and a DTM
+ * index file through RGE requests, and listed through RLR requests.
+ * Items written by RDW requests are answered with the sync ids they
+ * are assigned.
+ */
+
+#include "zdtm_sim.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SIM_MAX_RESP 4
+#define SIM_AGE_CHUNK 60000
+
+static const unsigned char sim_ack[COM_MSG_SIZE] =
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x96, 0x06};
+static const unsigned char sim_rqst[COM_MSG_SIZE] =
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x96, 0x05};
+static const unsigned char sim_abrt[COM_MSG_SIZE] =
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x96, 0x18};
+
+/* The parameter format handed out in the ADI message. */
+static const struct {
+    const char *abrev;
+    unsigned char type_id;
+    const char *desc;
+} sim_format[] = {
+    {"ATTR", DATA_ID_BIT, "Attribute"},
+    {"CTTM", DATA_ID_TIME, "Creation Date"},
+    {"MDTM", DATA_ID_TIME, "Modification Date"},
+    {"SYID", DATA_ID_ULONG, "Sync ID"},
+    {"CTGR", DATA_ID_BARRAY, "Category"},
+    {"ETDY", DATA_ID_TIME, "Start Date"},
+    {"LTDY", DATA_ID_TIME, "Due Date"},
+    {"FNDY", DATA_ID_TIME, "Completed Date"},
+    {"MARK", DATA_ID_UCHAR, "Completed"},
+    {"PRTY", DATA_ID_UCHAR, "Priority"},
+    {"TITL", DATA_ID_UTF8, "Description"},
+    {"MEM1", DATA_ID_UTF8, "Notes"}
+};
+#define SIM_NUM_FORMAT (sizeof(sim_format) / sizeof(sim_format[0]))
+
+static const char *sim_categories[] = {"Business", "Personal", "Holiday"};
+
+struct sim_resp {
+    int abrt;
+    char type[MSG_TYPE_SIZE];
+    unsigned char *cont;
+    int cont_size;
+};
+
+static void put_u16(unsigned char *p, uint16_t v) {
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+}
+
+static void put_u32(unsigned char *p, uint32_t v) {
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+    p[2] = (v >> 16) & 0xff;
+    p[3] = (v >> 24) & 0xff;
+}
+
+static int sim_write(struct zdtm_sim *sim, int fd, const void *buf, int len) {
+    struct zdtm_iovec iov;
+    int n, tot;
+
+    for (tot = 0; tot < len; tot += n) {
+        iov.base = (char *)buf + tot;
+        iov.len = len - tot;
+        n = sim->tp->writev(sim->tp, fd, &iov, 1);
+        if (n <= 0) { return -1; }
+    }
+    sim->bytes_sent += len;
+
+    return 0;
+}
+
+static int sim_read(struct zdtm_sim *sim, int fd, void *buf, int len) {
+    struct zdtm_iovec iov;
+    int n, tot;
+
+    for (tot = 0; tot < len; tot += n) {
+        iov.base = (char *)buf + tot;
+        iov.len = len - tot;
+        n = sim->tp->readv(sim->tp, fd, &iov, 1);
+        if (n <= 0) { return -1; }
+    }
+    sim->bytes_recv += len;
+
+    return 0;
+}
+
+static int sim_send_msg(struct zdtm_sim *sim, int fd, const char *type,
+    const unsigned char *cont, int cont_size) {
+
+    unsigned char *buf;
+    uint16_t sum;
+    int i, size, r;
+
+    size = MSG_HDR_SIZE + 2 + MSG_TYPE_SIZE + cont_size + 2;
+    buf = malloc(size);
+    if (buf == NULL) { return -1; }
+
+    memcpy(buf, ZMSG_HDR, MSG_HDR_SIZE);
+    put_u16(buf + MSG_HDR_CONT_OFFSET, cont_size);
+    put_u16(buf + MSG_HDR_SIZE, MSG_TYPE_SIZE + cont_size);
+    memcpy(buf + MSG_HDR_SIZE + 2, type, MSG_TYPE_SIZE);
+    if (cont_size > 0) {
+        memcpy(buf + MSG_HDR_SIZE + 2 + MSG_TYPE_SIZE, cont, cont_size);
+    }
+    sum = 0;
+    for (i = 0; i < MSG_TYPE_SIZE + cont_size; i++) {
+        sum += buf[MSG_HDR_SIZE + 2 + i];
+    }
+    put_u16(buf + size - 2, sum);
+
+    r = sim_write(sim, fd, buf, size);
+    free(buf);
+    if (r != 0) { return -1; }
+
+    sim->msgs_sent++;
+
+    return 0;
+}
+
+/* Read a message, returning 1, 2, or 3 for the ack, rqst, and abrt
+ * common messages, and 0 for a general message. */
+static int sim_recv_msg(struct zdtm_sim *sim, int fd, char *type,
+    unsigned char **pp_cont, int *p_cont_size) {
+
+    unsigned char hdr[MSG_HDR_SIZE + 2];
+    unsigned char *body;
+    int body_size, i;
+    uint16_t sum;
+
+    if (sim_read(sim, fd, hdr, COM_MSG_SIZE) != 0) { return -1; }
+    if (memcmp(hdr, sim_ack, COM_MSG_SIZE) == 0) { return 1; }
+    if (memcmp(hdr, sim_rqst, COM_MSG_SIZE) == 0) { return 2; }
+    if (memcmp(hdr, sim_abrt, COM_MSG_SIZE) == 0) { return 3; }
+
+    if (sim_read(sim, fd, hdr + COM_MSG_SIZE,
+        MSG_HDR_SIZE + 2 - COM_MSG_SIZE) != 0) {
+        return -1;
+    }
+    body_size = hdr[MSG_HDR_SIZE] | (hdr[MSG_HDR_SIZE + 1] << 8);
+    if (body_size < MSG_TYPE_SIZE) { return -2; }
+
+    body = malloc(body_size + 2);
+    if (body == NULL) { return -3; }
+    if (sim_read(sim, fd, body, body_size + 2) != 0) {
+        free(body);
+        return -1;
+    }
+
+    /* The check sum is the sum of the bytes of the body. */
+    sum = 0;
+    for (i = 0; i < body_size; i++) { sum += body[i]; }
+    if (sum != (body[body_size] | (body[body_size + 1] << 8))) {
+        free(body);
+        return -2;
+    }
+
+    memcpy(type, body, MSG_TYPE_SIZE);
+    *p_cont_size = body_size - MSG_TYPE_SIZE;
+    *pp_cont = malloc(*p_cont_size + 1);
+    if (*pp_cont == NULL) {
+        free(body);
+        return -3;
+    }
+    memcpy(*pp_cont, body + MSG_TYPE_SIZE, *p_cont_size);
+    free(body);
+
+    sim->msgs_recv++;
+
+    return 0;
+}
+
+/* The modification date of the given revision of an item. */
+static void sim_build_mdtm(uint32_t sync_id, uint32_t revision,
+    unsigned char *mdtm) {
+
+    unsigned int i;
+
+    put_u32(mdtm, 0x45000000 + sync_id + (revision << 16));
+    for (i = 0; i < SIM_NUM_FORMAT; i++) {
+        if (memcmp(sim_format[i].abrev, "MDTM", 4) == 0) { break; }
+    }
+    mdtm[4] = i;
+}
+
+int zdtm_sim_build_item(uint32_t sync_id, uint32_t revision,
+    unsigned char *buf, int size) {
+    unsigned char *p;
+    char str[64];
+    unsigned int i;
+    int len;
+
+    p = buf;
+    if (size < 2) { return -1; }
+    put_u16(p, SIM_NUM_FORMAT);
+    p += 2;
+
+    for (i = 0; i < SIM_NUM_FORMAT; i++) {
+        switch (sim_format[i].type_id) {
+            case DATA_ID_BIT:
+            case DATA_ID_UCHAR:
+                len = 1;
+                if (memcmp(sim_format[i].abrev, "PRTY", 4) == 0) {
+                    str[0] = 1 + (sync_id % 5);
+                } else if (memcmp(sim_format[i].abrev, "MARK", 4) == 0) {
+                    str[0] = sync_id % 2;
+                } else {
+                    str[0] = 0;
+                }
+                break;
+            case DATA_ID_TIME:
+                len = 5;
+                if (memcmp(sim_format[i].abrev, "MDTM", 4) == 0) {
+                    sim_build_mdtm(sync_id, revision, (unsigned char *)str);
+                    break;
+                }
+                put_u32((unsigned char *)str, 0x45000000 + sync_id);
+                str[4] = i;
+                break;
+            case DATA_ID_ULONG:
+                len = 4;
+                put_u32((unsigned char *)str, sync_id);
+                break;
+            case DATA_ID_BARRAY:
+                len = strlen(sim_categories[sync_id % 3]);
+                memcpy(str, sim_categories[sync_id % 3], len);
+                break;
+            default:
+                if ((memcmp(sim_format[i].abrev, "TITL", 4) == 0) &&
+                    (revision > 0)) {
+                    len = snprintf(str, sizeof(str), "Todo item %u rev %u",
+                        sync_id, revision);
+                } else if (memcmp(sim_format[i].abrev, "TITL", 4) == 0) {
+                    len = snprintf(str, sizeof(str), "Todo item %u", sync_id);
+                } else {
+                    len = snprintf(str, sizeof(str), "Notes for todo item %u",
+                        sync_id);
+                }
+                break;
+        }
+
+        if ((p - buf) + 4 + len > size) { return -1; }
+        put_u32(p, len);
+        memcpy(p + 4, str, len);
+        p += 4 + len;
+    }
+
+    return p - buf;
+}
+
+/* The revision of the item with the given sync id, the items of the mod
+ * list are at the configured revision and all others at zero. */
+static uint32_t sim_revision(struct zdtm_sim *sim, uint32_t sync_id) {
+    uint32_t first_mod;
+
+    first_mod = sim->first_sync_id + sim->num_new;
+    if ((sync_id >= first_mod) && (sync_id < first_mod + sim->num_mod)) {
+        return sim->mod_revision;
+    }
+
+    return 0;
+}
+
+static int sim_push(struct sim_resp *resp, int *p_num, const char *type,
+    unsigned char *cont, int cont_size) {
+
+    if (*p_num == SIM_MAX_RESP) {
+        free(cont);
+        return -1;
+    }
+    resp[*p_num].abrt = (type == NULL);
+    if (type != NULL) { memcpy(resp[*p_num].type, type, MSG_TYPE_SIZE); }
+    resp[*p_num].cont = cont;
+    resp[*p_num].cont_size = cont_size;
+    (*p_num)++;
+
+    return 0;
+}
+
+static unsigned char *sim_build_adi(int *p_size) {
+    unsigned char *buf, *p;
+    unsigned int i;
+
+    buf = malloc(7 + SIM_NUM_FORMAT * (4 + 1 + 2 + 32));
+    if (buf == NULL) { return NULL; }
+
+    p = buf;
+    put_u32(p, 1);
+    put_u16(p + 4, SIM_NUM_FORMAT);
+    p[6] = 0x00;
+    p += 7;
+    for (i = 0; i < SIM_NUM_FORMAT; i++) {
+        memcpy(p, sim_format[i].abrev, 4);
+        p += 4;
+    }
+    for (i = 0; i < SIM_NUM_FORMAT; i++) {
+        *p++ = sim_format[i].type_id;
+    }
+    for (i = 0; i < SIM_NUM_FORMAT; i++) {
+        put_u16(p, strlen(sim_format[i].desc));
+        memcpy(p + 2, sim_format[i].desc, strlen(sim_format[i].desc));
+        p += 2 + strlen(sim_format[i].desc);
+    }
+
+    *p_size = p - buf;
+    return buf;
+}
+
+static unsigned char *sim_build_asy(struct zdtm_sim *sim, int *p_size) {
+    unsigned char *buf, *p;
+    uint16_t nums[3];
+    uint32_t id;
+    int i, j;
+
+    nums[0] = sim->num_new;
+    nums[1] = sim->num_mod;
+    nums[2] = sim->num_del;
+
+    buf = malloc(9 + 4 * (nums[0] + nums[1] + nums[2]));
+    if (buf == NULL) { return NULL; }
+
+    p = buf;
+    id = sim->first_sync_id;
+    for (i = 0; i < 3; i++) {
+        *p++ = i + 1;
+        put_u16(p, nums[i]);
+        p += 2;
+        for (j = 0; j < nums[i]; j++) {
+            put_u32(p, id++);
+            p += 4;
+        }
+    }
+
+    *p_size = p - buf;
+    return buf;
+}
+
+/* Build the listing of every current item, which are those of the new
+ * and mod lists, answering an RLR message. */
+static unsigned char *sim_build_alr(struct zdtm_sim *sim, int *p_size) {
+    unsigned char *buf, *p;
+    uint32_t num, i, sync_id;
+
+    num = sim->num_new + sim->num_mod;
+    buf = malloc(2 + 9 * num);
+    if (buf == NULL) { return NULL; }
+
+    p = buf;
+    put_u16(p, num);
+    p += 2;
+    for (i = 0; i < num; i++) {
+        sync_id = sim->first_sync_id + i;
+        put_u32(p, sync_id);
+        sim_build_mdtm(sync_id, sim_revision(sim, sync_id), p + 4);
+        p += 9;
+    }
+
+    *p_size = p - buf;
+    return buf;
+}
+
+static unsigned char *sim_build_adr(struct zdtm_sim *sim, uint32_t sync_id,
+    int *p_size) {
+    unsigned char *buf;
+    int r;
+
+    buf = malloc(1024);
+    if (buf == NULL) { return NULL; }
+
+    buf[0] = 0x00;
+    buf[1] = 0x00;
+    r = zdtm_sim_build_item(sync_id, sim_revision(sim, sync_id), buf + 2,
+        1024 - 2);
+    if (r < 0) {
+        free(buf);
+        return NULL;
+    }
+
+    *p_size = r + 2;
+    return buf;
+}
+
+static uint32_t get_u32(const unsigned char *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* Build the ADW answering an RDW, which writes records of the sync id
+ * of an item followed by a field for each parameter of the format.
+ * Items without a sync id are assigned new ones. */
+static unsigned char *sim_build_adw(struct zdtm_sim *sim,
+    const unsigned char *cont, int cont_size, int *p_size) {
+    const unsigned char *p, *end;
+    unsigned char *buf;
+    uint16_t num, num_taken, i;
+    uint32_t sync_id;
+    unsigned int j;
+
+    if (cont_size < 3) { return NULL; }
+    num = cont[1] | (cont[2] << 8);
+    num_taken = num;
+    if ((sim->max_write_items > 0) && (num_taken > sim->max_write_items)) {
+        num_taken = sim->max_write_items;
+    }
+    if (num_taken == 0) { return NULL; }
+
+    buf = malloc(6 + 4 * num_taken);
+    if (buf == NULL) { return NULL; }
+    memset(buf, 0x00, 6);
+    put_u16(buf + 4, num_taken);
+
+    p = cont + 3;
+    end = cont + cont_size;
+    for (i = 0; i < num; i++) {
+        if (end - p < 4) { free(buf); return NULL; }
+        sync_id = get_u32(p);
+        p += 4;
+        for (j = 0; j < SIM_NUM_FORMAT; j++) {
+            if ((end - p < 4) || (end - p - 4 < get_u32(p))) {
+                free(buf);
+                return NULL;
+            }
+            p += 4 + get_u32(p);
+        }
+        if (i < num_taken) {
+            if (sync_id == 0) { sync_id = sim->next_write_id++; }
+            put_u32(buf + 6 + 4 * i, sync_id);
+        }
+    }
+    if (p != end) { free(buf); return NULL; }
+
+    if (sim->num_rdw == 0) { sim->first_rdw_records = num; }
+    if (num > sim->max_rdw_records) { sim->max_rdw_records = num; }
+    sim->num_rdw++;
+    sim->num_rdw_records += num;
+    sim->num_written += num_taken;
+
+    *p_size = 6 + 4 * num_taken;
+    return buf;
+}
+
+/* Build the DTM box file, or index file, holding the current items,
+ * which are those of the new and mod lists. */
+static unsigned char *sim_build_file(struct zdtm_sim *sim, int idx,
+    uint32_t *p_size) {
+
+    unsigned char *buf, *p;
+    uint32_t num, i, off;
+    int r;
+
+    num = sim->num_new + sim->num_mod;
+    buf = malloc(idx ? (4 + 8 * num) : (num * 512 + 1));
+    if (buf == NULL) { return NULL; }
+
+    p = buf;
+    if (idx) {
+        put_u32(p, num);
+        p += 4;
+    }
+    off = 0;
+    for (i = 0; i < num; i++) {
+        r = zdtm_sim_build_item(sim->first_sync_id + i,
+            sim_revision(sim, sim->first_sync_id + i), sim->scratch,
+            sizeof(sim->scratch));
+        if (r < 0) {
+            free(buf);
+            return NULL;
+        }
+        if (idx) {
+            put_u32(p, sim->first_sync_id + i);
+            put_u32(p + 4, off);
+            p += 8;
+        } else {
+            put_u32(p, r);
+            memcpy(p + 4, sim->scratch, r);
+            p += 4 + r;
+        }
+        off += 4 + r;
+    }
+
+    *p_size = p - buf;
+    return buf;
+}
+
+/* Queue the next AGE chunk of the file being sent, if any. */
+static int sim_push_chunk(struct zdtm_sim *sim, struct sim_resp *resp,
+    int *p_num) {
+
+    unsigned char *buf;
+    uint32_t len;
+
+    len = sim->file_size - sim->file_off;
+    if (len > SIM_AGE_CHUNK) { len = SIM_AGE_CHUNK; }
+
+    buf = malloc(10 + len);
+    if (buf == NULL) { return -1; }
+    put_u32(buf, sim->file_size);
+    put_u32(buf + 4, sim->file_off);
+    put_u16(buf + 8, len);
+    memcpy(buf + 10, sim->file + sim->file_off, len);
+
+    sim->file_off += len;
+    if (sim->file_off == sim->file_size) {
+        free(sim->file);
+        sim->file = NULL;
+    }
+
+    return sim_push(resp, p_num, "AGE", buf, 10 + len);
+}
+
+/* Handle a general message from the desktop, queueing the responses.
+ * Returns 1 when the desktop ends the session. */
+static int sim_handle(struct zdtm_sim *sim, const char *type,
+    unsigned char *cont, int cont_size, struct sim_resp *resp, int *p_num) {
+
+    unsigned char *buf;
+    const char *model = "SL-C3200";
+    int size;
+
+    buf = NULL;
+    size = 0;
+
+    if (memcmp(type, "RAY", 3) == 0) {
+        return 1;
+    } else if (memcmp(type, "RIG", 3) == 0) {
+        size = 2 + strlen(model) + 5 + 2 + 1 + 6;
+        buf = calloc(1, size);
+        if (buf == NULL) { return -1; }
+        put_u16(buf, strlen(model));
+        memcpy(buf + 2, model, strlen(model));
+        memcpy(buf + 2 + strlen(model) + 5, "EN", 2);
+        buf[2 + strlen(model) + 7] = sim->auth_state;
+        return sim_push(resp, p_num, "AIG", buf, size);
+    } else if (memcmp(type, "RMG", 3) == 0) {
+        size = 2 + 1 + 46;
+        buf = calloc(1, size);
+        if (buf == NULL) { return -1; }
+        memcpy(buf, "SL", 2);
+        buf[2] = sim->fullsync_flags;
+        if (cont_size >= 2) { sim->sync_type = cont[1]; }
+        return sim_push(resp, p_num, "AMG", buf, size);
+    } else if (memcmp(type, "RTG", 3) == 0) {
+        size = 14;
+        buf = malloc(size);
+        if (buf == NULL) { return -1; }
+        memcpy(buf, "20070101120000", size);
+        return sim_push(resp, p_num, "ATG", buf, size);
+    } else if (memcmp(type, "RMS", 3) == 0) {
+        if ((cont_size >= 2) && (cont[0] == 0) && (cont[1] == 0)) {
+            sim_push(resp, p_num, NULL, NULL, 0);
+            buf = calloc(1, 1);
+            if (buf == NULL) { return -1; }
+            return sim_push(resp, p_num, "ANG", buf, 1);
+        }
+        return sim_push(resp, p_num, "AEX", NULL, 0);
+    } else if (memcmp(type, "RDI", 3) == 0) {
+        buf = sim_build_adi(&size);
+        if (buf == NULL) { return -1; }
+        return sim_push(resp, p_num, "ADI", buf, size);
+    } else if (memcmp(type, "RSY", 3) == 0) {
+        buf = sim_build_asy(sim, &size);
+        if (buf == NULL) { return -1; }
+        return sim_push(resp, p_num, "ASY", buf, size);
+    } else if (memcmp(type, "RDR", 3) == 0) {
+        if (cont_size < 7) { return -1; }
+        if (sim->item_delay_us > 0) { usleep(sim->item_delay_us); }
+        if ((sim->drop_after_rdr > 0) &&
+            (sim->num_rdr >= sim->drop_after_rdr)) {
+            return -1;
+        }
+        sim->num_rdr++;
+        buf = sim_build_adr(sim, cont[3] | (cont[4] << 8) |
+            (cont[5] << 16) | ((uint32_t)cont[6] << 24), &size);
+        if (buf == NULL) { return -1; }
+        return sim_push(resp, p_num, "ADR", buf, size);
+    } else if (memcmp(type, "RDW", 3) == 0) {
+        buf = sim_build_adw(sim, cont, cont_size, &size);
+        if (buf == NULL) { return -1; }
+        return sim_push(resp, p_num, "ADW", buf, size);
+    } else if (memcmp(type, "RLR", 3) == 0) {
+        buf = sim_build_alr(sim, &size);
+        if (buf == NULL) { return -1; }
+        return sim_push(resp, p_num, "ALR", buf, size);
+    } else if (memcmp(type, "RGE", 3) == 0) {
+        if ((cont_size < 2) || ((cont[0] | (cont[1] << 8)) + 2 > cont_size) ||
+            (cont_size < 6)) {
+            return -1;
+        }
+        sim->num_rge++;
+        sim->file = sim_build_file(sim,
+            memcmp(cont + cont_size - 4, ".IDX", 4) == 0, &sim->file_size);
+        if (sim->file == NULL) { return -1; }
+        sim->file_off = 0;
+        return sim_push_chunk(sim, resp, p_num);
+    } else if ((memcmp(type, "RTS", 3) == 0) ||
+               (memcmp(type, "RSS", 3) == 0) ||
+               (memcmp(type, "RDD", 3) == 0) ||
+               (memcmp(type, "RDS", 3) == 0) ||
+               (memcmp(type, "RQT", 3) == 0) ||
+               (memcmp(type, "RRL", 3) == 0)) {
+        return sim_push(resp, p_num, "AEX", NULL, 0);
+    }
+
+    return -1;
+}
+
+/* Over TCP the connection back is made from zaurus_ip, as the fleet
+ * routes it by the address it comes from. */
+static int sim_connect_back(struct zdtm_sim *sim) {
+    struct sockaddr_in addr;
+    int fd, one;
+
+    if (sim->transport != NULL) {
+        return sim->tp->connect(sim->tp, "127.0.0.1", DLISTPORT, -1,
+            &sim->connfd);
+    }
+
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) { return -1; }
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    if (inet_pton(AF_INET, sim->zaurus_ip, &addr.sin_addr) <= 0) {
+        close(fd);
+        return -1;
+    }
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    addr.sin_port = htons(DLISTPORT);
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    sim->connfd = fd;
+
+    return 0;
+}
+
+static int sim_session(struct zdtm_sim *sim) {
+    struct sim_resp resp[SIM_MAX_RESP];
+    int num_resp, i, r;
+    SOCKET reqfd;
+    char type[MSG_TYPE_SIZE];
+    unsigned char *cont;
+    int cont_size;
+
+    if (sim->tp->accept(sim->tp, sim->listenfd, &reqfd) != 0) {
+        return -1;
+    }
+
+    r = sim_recv_msg(sim, reqfd, type, &cont, &cont_size);
+    if (r != 0) { sim->tp->close(sim->tp, reqfd); return -2; }
+    free(cont);
+    if (memcmp(type, "RAY", 3) != 0) {
+        sim->tp->close(sim->tp, reqfd);
+        return -3;
+    }
+
+    if (sim_connect_back(sim) != 0) {
+        sim->tp->close(sim->tp, reqfd);
+        return -4;
+    }
+
+    num_resp = 0;
+    r = sim_recv_msg(sim, sim->connfd, type, &cont, &cont_size);
+    if ((r != 0) || (memcmp(type, "RAY", 3) != 0)) { r = -5; goto done; }
+    free(cont);
+    if (sim_write(sim, sim->connfd, sim_ack, COM_MSG_SIZE) != 0) {
+        r = -6; goto done;
+    }
+    cont = calloc(1, 3);
+    sim_push(resp, &num_resp, "AAY", cont, 3);
+
+    for (;;) {
+        if (num_resp > 0) {
+            /* answer the desktop rqst with the oldest queued response */
+            r = sim_recv_msg(sim, sim->connfd, type, &cont, &cont_size);
+            if (r != 2) { r = -7; goto done; }
+            if (resp[0].abrt) {
+                r = sim_write(sim, sim->connfd, sim_abrt, COM_MSG_SIZE);
+            } else {
+                r = sim_send_msg(sim, sim->connfd, resp[0].type,
+                    resp[0].cont, resp[0].cont_size);
+                if (r == 0) {
+                    r = sim_recv_msg(sim, sim->connfd, type, &cont,
+                        &cont_size);
+                    r = (r == 1) ? 0 : -1;
+                }
+            }
+            free(resp[0].cont);
+            for (i = 1; i < num_resp; i++) { resp[i - 1] = resp[i]; }
+            num_resp--;
+            if (r != 0) { r = -8; goto done; }
+        } else if (sim->file != NULL) {
+            /* keep streaming the file being sent */
+            if (sim_push_chunk(sim, resp, &num_resp) != 0) {
+                r = -13; goto done;
+            }
+        } else {
+            /* ask the desktop for its next message */
+            if (sim_write(sim, sim->connfd, sim_rqst, COM_MSG_SIZE) != 0) {
+                r = -9; goto done;
+            }
+            r = sim_recv_msg(sim, sim->connfd, type, &cont, &cont_size);
+            if (r != 0) { r = -10; goto done; }
+            if (memcmp(type, "RAY", 3) != 0) {
+                if (sim_write(sim, sim->connfd, sim_ack, COM_MSG_SIZE) != 0) {
+                    free(cont);
+                    r = -11; goto done;
+                }
+            }
+            r = sim_handle(sim, type, cont, cont_size, resp, &num_resp);
+            free(cont);
+            if (r == 1) { r = 0; goto done; }
+            if (r != 0) { r = -12; goto done; }
+        }
+    }
+
+done:
+    for (i = 0; i < num_resp; i++) { free(resp[i].cont); }
+    if (sim->file != NULL) {
+        free(sim->file);
+        sim->file = NULL;
+    }
+    sim->tp->close(sim->tp, sim->connfd);
+    sim->tp->close(sim->tp, reqfd);
+    return r;
+}
+
+static void *sim_thread(void *arg) {
+    struct zdtm_sim *sim;
+
+    sim = (struct zdtm_sim *)arg;
+    sim->result = sim_session(sim);
+    sim->tp->close(sim->tp, sim->listenfd);
+
+    return NULL;
+}
+
+int zdtm_sim_start(struct zdtm_sim *sim) {
+
+    sim->msgs_recv = 0;
+    sim->msgs_sent = 0;
+    sim->bytes_recv = 0;
+    sim->bytes_sent = 0;
+    sim->num_rdr = 0;
+    sim->num_rge = 0;
+    sim->num_rdw = 0;
+    sim->num_written = 0;
+    sim->result = 0;
+    sim->next_write_id = sim->first_sync_id + sim->num_new + sim->num_mod +
+        sim->num_del;
+    sim->file = NULL;
+    sim->sync_type = 0;
+    if (sim->zaurus_ip[0] == '\0') {
+        strcpy(sim->zaurus_ip, "127.0.0.1");
+    }
+
+    sim->tp = (sim->transport != NULL) ? sim->transport :
+        zdtm_tcp_transport();
+
+    if (sim->tp->listen(sim->tp, sim->zaurus_ip, ZLISTPORT,
+            &sim->listenfd) != 0) {
+        return -1;
+    }
+
+    if (pthread_create(&sim->thread, NULL, sim_thread, sim) != 0) {
+        sim->tp->close(sim->tp, sim->listenfd);
+        return -2;
+    }
+
+    return 0;
+}
+
+int zdtm_sim_wait(struct zdtm_sim *sim) {
+    pthread_join(sim->thread, NULL);
+
+    return sim->result;
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+/**
+ * @file zdtm_sim.h
+ * @brief This is a specifications file for a simulated Zaurus.
+ *
+ * The zdtm_sim.h file is a specifications file for a simulated Zaurus
+ * synchronization daemon. It is used by the test programs to exercise
+ * the library against a local peer which speaks the Zaurus side of the
+ * protocol, without the need of an actual Zaurus, and holds the check
+ * reporting shared by all of them.
+ */
+
+#ifndef ZDTM_SIM_H
+#define ZDTM_SIM_H
+
+#include "zdtm_sync.h"
+#include <stdio.h>
+#include <pthread.h>
+
+/**
+ * Report a check.
+ *
+ * The check function prints the outcome of a check of a test program
+ * on a line of its own, for the failures to be counted.
+ * @param name The name of the check.
+ * @param cond The condition checked, non-zero when it holds.
+ * @return Zero if the check holds, one if it failed.
+ */
+static inline int check(const char *name, int cond) {
+    printf("%-48s %s\n", name, cond ? "ok" : "FAILED");
+    return cond ? 0 : 1;
+}
+
+/**
+ * Simulated Zaurus.
+ *
+ * The zdtm_sim structure holds the configuration, state, and counters
+ * of a simulated Zaurus. The configuration members are to be filled in
+ * prior to calling zdtm_sim_start(), the counters may be read after
+ * zdtm_sim_wait() has returned.
+ */
+struct zdtm_sim {
+    /* configuration */
+    char zaurus_ip[IP_STR_SIZE];    // address to listen on for RAY
+    unsigned char fullsync_flags;   // AMG full sync flags
+    unsigned char auth_state;       // AIG authentication state
+    uint32_t first_sync_id;         // first sync id handed out
+    uint16_t num_new;               // number of items in the new list
+    uint16_t num_mod;               // number of items in the mod list
+    uint16_t num_del;               // number of items in the del list
+    uint32_t mod_revision;          // revision of the mod list items
+    unsigned int item_delay_us;     // simulated latency of each RDR
+    unsigned long drop_after_rdr;   // RDRs served before dropping, 0 never
+    uint16_t max_write_items;       // items taken from each RDW, 0 all
+    zdtm_transport *transport;      // transport to serve over, NULL for TCP
+
+    /* counters */
+    unsigned long msgs_recv;        // general messages received
+    unsigned long msgs_sent;        // general messages sent
+    unsigned long bytes_recv;       // bytes received
+    unsigned long bytes_sent;       // bytes sent
+    unsigned long num_rdr;          // number of RDR messages handled
+    unsigned long num_rge;          // number of RGE messages handled
+    unsigned long num_rdw;          // number of RDW messages handled
+    unsigned long num_written;      // number of items written by RDWs
+    unsigned long num_rdw_records;  // records sent in RDWs, taken or not
+    uint16_t first_rdw_records;     // records sent in the first RDW
+    uint16_t max_rdw_records;       // most records sent in an RDW
+    int result;                     // result of the simulated session
+
+    /* private */
+    zdtm_transport *tp;
+    SOCKET listenfd;
+    SOCKET connfd;
+    unsigned char sync_type;
+    unsigned char *file;
+    uint32_t file_size;
+    uint32_t file_off;
+    uint32_t next_write_id;
+    unsigned char scratch[512];
+    pthread_t thread;
+};
+
+/**
+ * Start a simulated Zaurus.
+ *
+ * The zdtm_sim_start function starts listening for the desktop RAY
+ * message and serves a single synchronization session on a thread of
+ * its own.
+ * @param sim Pointer to the configured simulated Zaurus.
+ * @return An integer representing success (zero) or failure (non-zero).
+ * @retval 0 Successfully started the simulated Zaurus.
+ * @retval -1 Failed to create the listening socket.
+ * @retval -2 Failed to start the simulation thread.
+ */
+int zdtm_sim_start(struct zdtm_sim *sim);
+
+/**
+ * Wait for a simulated Zaurus.
+ *
+ * The zdtm_sim_wait function waits for the session served by the
+ * simulated Zaurus to end.
+ * @param sim Pointer to the started simulated Zaurus.
+ * @return The result of the simulated session, zero on success.
+ */
+int zdtm_sim_wait(struct zdtm_sim *sim);
+
+/**
+ * Build a simulated item.
+ *
+ * The zdtm_sim_build_item function builds the parameter block of the
+ * simulated todo item with the given sync id, in the same layout used
+ * by the content of the ADR message following its two unknown bytes.
+ * Each revision of an item has its own modification date and title.
+ * @param sync_id The sync id of the item to build.
+ * @param revision The revision of the item to build.
+ * @param buf Pointer to the buffer to build the item in.
+ * @param size Size of the buffer in bytes.
+ * @return The number of bytes built, or -1 if buf is too small.
+ */
+int zdtm_sim_build_item(uint32_t sync_id, uint32_t revision,
+    unsigned char *buf, int size);
+
+#endif
@@ -0,0 +1,239 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+
+/*
+ * This program checks that the connection deadlines of an environment
+ * are enforced. A Zaurus which never lets the desktop connect, one
+ * which never connects back, and one which connects back but never
+ * says a word, each have to make zdtm_initiate_sync return its own
+ * timeout value about when the deadline passes.
+ */
+
+#include "zdtm_sim.h"
+#include <stdio.h>
+#include <sys/time.h>
+#include <pthread.h>
+
+// Deadline of the stage under test, in milliseconds.
+#define DEADLINE 300
+
+struct silent_zaurus {
+    zdtm_transport *tp;
+    SOCKET listenfd;
+    int connect_back;       // flag stating to connect back to the desktop
+    int stop;               // flag stating the test is done
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    pthread_t thread;
+};
+
+static double now_ms(void) {
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return (tv.tv_sec * 1000.0) + (tv.tv_usec / 1000.0);
+}
+
+/* Accept the RAY connection, optionally connect back, and then keep
+ * quiet until the test is done. */
+static void *silent_main(void *arg) {
+    struct silent_zaurus *z;
+    struct zdtm_iovec iov;
+    unsigned char buf[64];
+    SOCKET reqfd, connfd;
+    int connected;
+
+    z = (struct silent_zaurus *)arg;
+
+    if (z->tp->accept(z->tp, z->listenfd, &reqfd) != 0) {
+        return NULL;
+    }
+    iov.base = buf;
+    iov.len = sizeof(buf);
+    z->tp->readv(z->tp, reqfd, &iov, 1);
+
+    connected = 0;
+    if (z->connect_back) {
+        connected = (z->tp->connect(z->tp, "127.0.0.1", DLISTPORT, -1,
+            &connfd) == 0);
+    }
+
+    pthread_mutex_lock(&z->lock);
+    while (!z->stop) {
+        pthread_cond_wait(&z->changed, &z->lock);
+    }
+    pthread_mutex_unlock(&z->lock);
+
+    if (connected) {
+        z->tp->close(z->tp, connfd);
+    }
+    z->tp->close(z->tp, reqfd);
+
+    return NULL;
+}
+
+/* Run zdtm_initiate_sync against a silent Zaurus over the given
+ * transport, checking it fails with the expected value in time. */
+static int test_silent(const char *name, zdtm_transport *tp,
+    int connect_back, int accept_ms, int io_ms, int expected) {
+
+    struct silent_zaurus z;
+    zdtm_lib_env env;
+    double start, elapsed;
+    char ip[IP_STR_SIZE] = "127.0.0.1";
+    char label[64];
+    int r, fails;
+
+    memset(&z, 0, sizeof(z));
+    z.tp = tp;
+    z.connect_back = connect_back;
+    pthread_mutex_init(&z.lock, NULL);
+    pthread_cond_init(&z.changed, NULL);
+
+    memset(&env, 0, sizeof(zdtm_lib_env));
+    if (zdtm_initialize_transport(&env, tp) != 0) {
+        return check(name, 0);
+    }
+    zdtm_set_zaurus_ip(&env, ip);
+    zdtm_set_sync_type(&env, 0);
+    zdtm_set_timeouts(&env, DEADLINE, accept_ms, io_ms);
+
+    if ((tp->listen(tp, "127.0.0.1", ZLISTPORT, &z.listenfd) != 0) ||
+        (pthread_create(&z.thread, NULL, silent_main, &z) != 0)) {
+        zdtm_finalize(&env);
+        return check(name, 0);
+    }
+
+    start = now_ms();
+    r = zdtm_initiate_sync(&env);
+    elapsed = now_ms() - start;
+
+    pthread_mutex_lock(&z.lock);
+    z.stop = 1;
+    pthread_cond_broadcast(&z.changed);
+    pthread_mutex_unlock(&z.lock);
+    pthread_join(z.thread, NULL);
+
+    tp->close(tp, z.listenfd);
+    _zdtm_close_conn_to_zaurus(&env);
+    if (connect_back) {
+        _zdtm_close_zaurus_conn(&env);
+    }
+    zdtm_finalize(&env);
+
+    fails = check(name, r == expected);
+    snprintf(label, sizeof(label), "  gave up after %.0f ms", elapsed);
+    fails += check(label, (elapsed >= DEADLINE * 0.9) &&
+        (elapsed < DEADLINE * 5));
+
+    pthread_cond_destroy(&z.changed);
+    pthread_mutex_destroy(&z.lock);
+
+    return fails;
+}
+
+/* Connect to a TCP listener whose backlog is full, for which the
+ * handshake is never completed. */
+static int test_connect(void) {
+    zdtm_transport *tp;
+    zdtm_lib_env env;
+    SOCKET listenfd, fds[8];
+    double start, elapsed;
+    int r, i, num_fds, fails;
+
+    tp = zdtm_tcp_transport();
+    if (tp->listen(tp, "127.0.0.1", ZLISTPORT, &listenfd) != 0) {
+        return check("connect deadline, tcp", 0);
+    }
+
+    /* Fill the backlog, the listener never accepting. */
+    num_fds = 0;
+    for (i = 0; i < 8; i++) {
+        if (tp->connect(tp, "127.0.0.1", ZLISTPORT, 100, &fds[i]) != 0) {
+            break;
+        }
+        num_fds++;
+    }
+
+    memset(&env, 0, sizeof(zdtm_lib_env));
+    env.transport = tp;
+    env.connect_timeout = DEADLINE;
+    env.io_timeout = -1;
+    env.timed_out = 0;
+
+    start = now_ms();
+    r = _zdtm_conn_to_zaurus(&env, "127.0.0.1");
+    elapsed = now_ms() - start;
+    if (r == 0) {
+        _zdtm_close_conn_to_zaurus(&env);
+    }
+
+    for (i = 0; i < num_fds; i++) {
+        tp->close(tp, fds[i]);
+    }
+    tp->close(tp, listenfd);
+
+    if (num_fds == 8) {
+        /* The backlog never filled up, connecting can not be held
+         * up on this system. */
+        return check("connect deadline, tcp (skipped)", 1);
+    }
+
+    fails = check("connect deadline, tcp", (r == RET_CONNECT_TIMEOUT) &&
+        (env.timed_out == RET_CONNECT_TIMEOUT));
+    fails += check("  gave up in time", (elapsed >= DEADLINE * 0.9) &&
+        (elapsed < DEADLINE * 5));
+
+    return fails;
+}
+
+int main(int argc, char *argv[]) {
+    zdtm_transport *tp;
+    int fails;
+
+    fails = 0;
+
+    fails += test_connect();
+
+    if (zdtm_memory_transport_new(&tp) == 0) {
+        fails += test_silent("accept deadline, memory", tp, 0, DEADLINE, -1,
+            RET_ACCEPT_TIMEOUT);
+        fails += test_silent("I/O deadline, memory", tp, 1, -1, DEADLINE,
+            RET_IO_TIMEOUT);
+        zdtm_transport_free(tp);
+    }
+
+    if (zdtm_socketpair_transport_new(&tp) == 0) {
+        fails += test_silent("I/O deadline, socketpair", tp, 1, -1,
+            DEADLINE, RET_IO_TIMEOUT);
+        zdtm_transport_free(tp);
+    }
+
+    fails += test_silent("accept deadline, tcp", zdtm_tcp_transport(), 0,
+        DEADLINE, -1, RET_ACCEPT_TIMEOUT);
+    fails += test_silent("I/O deadline, tcp", zdtm_tcp_transport(), 1, -1,
+        DEADLINE, RET_IO_TIMEOUT);
+
+    printf("%d failure(s)\n", fails);
+
+    return fails ? 1 : 0;
+}
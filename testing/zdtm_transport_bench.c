@@ -0,0 +1,206 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+/**
+ * @file zdtm_transport_bench.c
+ * @brief This is a benchmark of the connection transports.
+ *
+ * The zdtm_transport_bench.c file is a benchmark which runs the same
+ * slow sync, obtaining every item with an RDR request of its own,
+ * against a simulated Zaurus over each of the shipped transports, and
+ * reports the time taken by each. It doubles as a check that a whole
+ * synchronization works over the in-process transports.
+ */
+
+#include "zdtm_sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define BENCH_MAX_ITEMS 16000
+
+#define BENCH_TCP 0
+#define BENCH_SOCKETPAIR 1
+#define BENCH_MEMORY 2
+
+struct bench_result {
+    double secs;
+    unsigned long items;
+    unsigned long msgs;
+    unsigned long bytes;
+};
+
+static double now(void) {
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + (tv.tv_usec / 1000000.0);
+}
+
+static int obtain_per_item(zdtm_lib_env *cur_env, unsigned long *p_items) {
+    int i, r;
+    uint32_t *p_new_sync_ids, *p_mod_sync_ids, *p_del_sync_ids;
+    uint16_t num_new_sync_ids, num_mod_sync_ids, num_del_sync_ids;
+    struct zdtm_item item;
+
+    r = zdtm_obtain_sync_id_lists(cur_env, &p_new_sync_ids, &num_new_sync_ids,
+        &p_mod_sync_ids, &num_mod_sync_ids, &p_del_sync_ids,
+        &num_del_sync_ids);
+    if (r != 0) {
+        fprintf(stderr, "ERR(%d): zdtm_obtain_sync_id_lists() failed.\n", r);
+        return -1;
+    }
+
+    for (i = 0; i < num_new_sync_ids; i++) {
+        memset(&item, 0, sizeof(struct zdtm_item));
+        item.sync_type = SYNC_TYPE_TODO;
+        r = zdtm_obtain_todo_item(cur_env, p_new_sync_ids[i],
+            &item.cont.todo);
+        if (r != 0) {
+            fprintf(stderr, "ERR(%d): zdtm_obtain_todo_item() failed.\n", r);
+            break;
+        }
+        zdtm_clean_item(&item);
+        (*p_items)++;
+    }
+
+    free(p_new_sync_ids);
+    free(p_mod_sync_ids);
+    free(p_del_sync_ids);
+
+    return (r == 0) ? 0 : -2;
+}
+
+static int run(int kind, unsigned int num_items, struct bench_result *res) {
+    struct zdtm_sim sim;
+    zdtm_lib_env cur_env;
+    zdtm_transport *p_tp;
+    char ip[IP_STR_SIZE] = "127.0.0.1";
+    double start;
+    int r;
+
+    if (kind == BENCH_SOCKETPAIR) {
+        r = zdtm_socketpair_transport_new(&p_tp);
+    } else if (kind == BENCH_MEMORY) {
+        r = zdtm_memory_transport_new(&p_tp);
+    } else {
+        p_tp = zdtm_tcp_transport();
+        r = 0;
+    }
+    if (r != 0) {
+        fprintf(stderr, "ERR(%d): failed to create the transport.\n", r);
+        return -1;
+    }
+
+    memset(&sim, 0, sizeof(struct zdtm_sim));
+    sim.first_sync_id = 1;
+    sim.num_new = num_items;
+    sim.transport = p_tp;
+    if (zdtm_sim_start(&sim) != 0) {
+        fprintf(stderr, "ERR: zdtm_sim_start() failed.\n");
+        zdtm_transport_free(p_tp);
+        return -1;
+    }
+
+    /* The whole session is timed, connection setup included, as that
+     * is where the transports differ the most apart from the I/O. */
+    start = now();
+
+    memset(&cur_env, 0, sizeof(zdtm_lib_env));
+    if ((zdtm_initialize_transport(&cur_env, p_tp) != 0) ||
+        (zdtm_set_zaurus_ip(&cur_env, ip) != 0) ||
+        (zdtm_set_sync_type(&cur_env, 0) != 0)) {
+        fprintf(stderr, "ERR: failed to set up the library.\n");
+        return -2;
+    }
+
+    r = zdtm_initiate_sync(&cur_env);
+    if (r != 0) {
+        fprintf(stderr, "ERR(%d): zdtm_initiate_sync() failed.\n", r);
+        return -3;
+    }
+
+    res->items = 0;
+    r = obtain_per_item(&cur_env, &res->items);
+    if (r != 0) {
+        fprintf(stderr, "ERR(%d): obtaining the items failed.\n", r);
+        return -4;
+    }
+
+    zdtm_terminate_sync(&cur_env);
+    zdtm_finalize(&cur_env);
+
+    r = zdtm_sim_wait(&sim);
+    res->secs = now() - start;
+    if (r != 0) {
+        fprintf(stderr, "ERR(%d): the simulated Zaurus failed.\n", r);
+        return -5;
+    }
+    res->msgs = sim.msgs_recv + sim.msgs_sent;
+    res->bytes = sim.bytes_recv + sim.bytes_sent;
+
+    if (kind != BENCH_TCP) {
+        zdtm_transport_free(p_tp);
+    }
+
+    return 0;
+}
+
+static void report(const char *name, struct bench_result *res) {
+    printf("%-10s %8lu items %10.3f s %12.0f items/s %8lu msgs %10lu bytes\n",
+        name, res->items, res->secs,
+        (res->secs > 0) ? (res->items / res->secs) : 0.0,
+        res->msgs, res->bytes);
+}
+
+int main(int argc, char *argv[]) {
+    unsigned int num_items;
+    struct bench_result tcp, socketpair, memory;
+
+    if (argc > 2) {
+        printf("Usage: %s [num items]\n", argv[0]);
+        return 0;
+    }
+
+    num_items = (argc > 1) ? atoi(argv[1]) : 10000;
+    if ((num_items == 0) || (num_items > BENCH_MAX_ITEMS)) {
+        fprintf(stderr, "ERR: num items must be from 1 to %d.\n",
+            BENCH_MAX_ITEMS);
+        return 1;
+    }
+
+    if (run(BENCH_TCP, num_items, &tcp) != 0) {
+        return 2;
+    }
+    if (run(BENCH_SOCKETPAIR, num_items, &socketpair) != 0) {
+        return 3;
+    }
+    if (run(BENCH_MEMORY, num_items, &memory) != 0) {
+        return 4;
+    }
+
+    report("tcp", &tcp);
+    report("socketpair", &socketpair);
+    report("memory", &memory);
+
+    return 0;
+}
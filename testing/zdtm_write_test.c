@@ -0,0 +1,243 @@
+/*
+ * Copyright 2005-2007 Andrew De Ponte
+ * 
+ * This file is part of lib_zdtm_sync.
+ * 
+ * lib_zdtm_sync is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or any
+ * later version.
+ * 
+ * lib_zdtm_sync is distributed in the hopes that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with lib_zdtm_sync; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+
+
+
+/*
+ * This program checks that items are written to the Zaurus with the
+ * sync ids it assigns handed back, the first RDW message carrying a
+ * single item and the next ones more as long as the Zaurus takes them
+ * all. A simulated Zaurus taking fewer items from a message than it
+ * was sent has the rest sent again, and is never sent many more items
+ * than it takes. Records obtained from the Zaurus are written back the
+ * same way.
+ */
+
+#include "zdtm_sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WRITE_NUM_ITEMS 400
+#define WRITE_FIRST_ID 1
+#define WRITE_NUM_NEW 10
+
+struct session {
+    uint16_t max_write_items;       // items the Zaurus takes from an RDW
+    int result;                     // result of writing the items
+    int ids_ok;                     // sync ids handed back as assigned
+    int records_ok;                 // records obtained and written back
+    int lazy_ok;                    // lazy items the same as the records
+    unsigned long num_rdw;          // RDW messages handled by the Zaurus
+    unsigned long num_written;      // items written to the Zaurus
+    unsigned long num_sent;         // items sent, taken or not
+    uint16_t first_batch;           // items sent in the first RDW
+    uint16_t max_batch;             // most items sent in an RDW
+};
+
+static int run(struct session *s) {
+    struct zdtm_sim sim;
+    zdtm_lib_env cur_env;
+    char ip[IP_STR_SIZE] = "127.0.0.1";
+    struct zdtm_todo_item *items;
+    struct zdtm_calendar_item calendar;
+    zdtm_record records[WRITE_NUM_NEW];
+    zdtm_lazy_item lazy;
+    const unsigned char *p;
+    uint32_t len;
+    uint32_t *sync_ids, next_id;
+    char notes[64];
+    int i, j, r;
+
+    items = calloc(WRITE_NUM_ITEMS, sizeof(struct zdtm_todo_item));
+    sync_ids = calloc(WRITE_NUM_ITEMS, sizeof(uint32_t));
+    if ((items == NULL) || (sync_ids == NULL)) {
+        return -1;
+    }
+
+    /* Every other item is a new one, the rest replace existing ones. */
+    snprintf(notes, sizeof(notes), "Notes of an item written in bulk.");
+    for (i = 0; i < WRITE_NUM_ITEMS; i++) {
+        items[i].sync_id = (i % 2) ? (WRITE_FIRST_ID + (i % WRITE_NUM_NEW)) :
+            0;
+        items[i].category = "Business";
+        items[i].category_len = 8;
+        items[i].description = "Write the report";
+        items[i].description_len = 16;
+        items[i].notes = notes;
+        items[i].notes_len = strlen(notes);
+        items[i].priority = 1 + (i % 5);
+    }
+
+    memset(&sim, 0, sizeof(struct zdtm_sim));
+    sim.first_sync_id = WRITE_FIRST_ID;
+    sim.num_new = WRITE_NUM_NEW;
+    sim.max_write_items = s->max_write_items;
+    if (zdtm_sim_start(&sim) != 0) {
+        fprintf(stderr, "ERR: zdtm_sim_start() failed.\n");
+        return -2;
+    }
+
+    memset(&cur_env, 0, sizeof(zdtm_lib_env));
+    if ((zdtm_initialize(&cur_env) != 0) ||
+        (zdtm_set_zaurus_ip(&cur_env, ip) != 0) ||
+        (zdtm_set_sync_type(&cur_env, 0) != 0)) {
+        fprintf(stderr, "ERR: failed to set up the library.\n");
+        return -3;
+    }
+
+    r = zdtm_initiate_sync(&cur_env);
+    if (r != 0) {
+        fprintf(stderr, "ERR(%d): zdtm_initiate_sync() failed.\n", r);
+        return -4;
+    }
+
+    /* Items of another sync type than the session are refused. */
+    memset(&calendar, 0, sizeof(struct zdtm_calendar_item));
+    if (zdtm_write_calendar_items(&cur_env, &calendar, 1, sync_ids) != -1) {
+        fprintf(stderr, "ERR: Calendar items written to a Todo session.\n");
+        return -5;
+    }
+
+    s->result = zdtm_write_todo_items(&cur_env, items, WRITE_NUM_ITEMS,
+        sync_ids);
+
+    s->ids_ok = 1;
+    next_id = WRITE_FIRST_ID + WRITE_NUM_NEW;
+    for (i = 0; i < WRITE_NUM_ITEMS; i++) {
+        if (items[i].sync_id == 0) {
+            s->ids_ok &= (sync_ids[i] == next_id++);
+        } else {
+            s->ids_ok &= (sync_ids[i] == items[i].sync_id);
+        }
+    }
+
+    /* The records obtained are written back with a field changed, after
+     * checking the items obtained lazily have the same fields. */
+    s->records_ok = 1;
+    s->lazy_ok = 1;
+    zdtm_lazy_item_init(&lazy);
+    for (i = 0; i < WRITE_NUM_NEW; i++) {
+        zdtm_record_init(&records[i]);
+        s->records_ok &= (zdtm_obtain_record(&cur_env, WRITE_FIRST_ID + i,
+            &records[i]) == 0);
+        s->lazy_ok &= (zdtm_obtain_lazy_item(&cur_env, WRITE_FIRST_ID + i,
+            &lazy) == 0) && (lazy.sync_id == WRITE_FIRST_ID + i);
+        for (j = 0; s->lazy_ok && (j < cur_env.num_params); j++) {
+            p = zdtm_lazy_item_field(&lazy, j, &len);
+            s->lazy_ok = (p != NULL) &&
+                (len == zdtm_record_len(&records[i], j)) &&
+                (memcmp(p, zdtm_record_field(&records[i], j), len) == 0);
+        }
+        s->records_ok &= (zdtm_record_set(&records[i],
+            zdtm_schema_index(cur_env.schema, "TITL"), "Edited", 6) == 0);
+    }
+    s->records_ok &= (zdtm_write_records(&cur_env, records, WRITE_NUM_NEW,
+        sync_ids) == 0);
+    for (i = 0; i < WRITE_NUM_NEW; i++) {
+        s->records_ok &= (sync_ids[i] == WRITE_FIRST_ID + i);
+        zdtm_record_free(&records[i]);
+    }
+    zdtm_lazy_item_free(&lazy);
+
+    r = zdtm_terminate_sync(&cur_env);
+    if (r != 0) {
+        fprintf(stderr, "ERR(%d): zdtm_terminate_sync() failed.\n", r);
+        return -6;
+    }
+    zdtm_finalize(&cur_env);
+
+    zdtm_sim_wait(&sim);
+    s->num_rdw = sim.num_rdw;
+    s->num_written = sim.num_written;
+    s->num_sent = sim.num_rdw_records;
+    s->first_batch = sim.first_rdw_records;
+    s->max_batch = sim.max_rdw_records;
+
+    free(items);
+    free(sync_ids);
+
+    return 0;
+}
+
+/* The number of messages writing num items takes when every message
+ * carries twice as many as the last, starting from one. */
+static unsigned long doublings(unsigned long num) {
+    unsigned long n;
+
+    for (n = 0; num > 0; n++) {
+        num >>= 1;
+    }
+
+    return n;
+}
+
+int main(int argc, char *argv[]) {
+    struct session s;
+    int fails;
+
+    fails = 0;
+
+    /* A Zaurus taking every item sent is first sent a single one, then
+     * ever more of them at once, none of them twice. */
+    memset(&s, 0, sizeof(struct session));
+    if (run(&s) != 0) { return 2; }
+    fails += check("items written in bulk", (s.result == 0) &&
+        (s.num_written == WRITE_NUM_ITEMS + WRITE_NUM_NEW) &&
+        (s.num_sent == s.num_written) && (s.first_batch == 1) &&
+        (s.max_batch > 64) && (s.num_rdw <= doublings(WRITE_NUM_ITEMS) +
+        doublings(WRITE_NUM_NEW)));
+    fails += check("  assigned sync ids handed back", s.ids_ok);
+    fails += check("  records written back", s.records_ok);
+    fails += check("  items obtained lazily", s.lazy_ok);
+
+    /* A Zaurus taking 64 items at most is sent a single message it
+     * does not take whole, the rest being sent 64 at a time. */
+    memset(&s, 0, sizeof(struct session));
+    s.max_write_items = 64;
+    if (run(&s) != 0) { return 2; }
+    fails += check("items written in messages the Zaurus takes",
+        (s.result == 0) &&
+        (s.num_written == WRITE_NUM_ITEMS + WRITE_NUM_NEW) &&
+        (s.first_batch == 1) && (s.max_batch <= 128) &&
+        (s.num_sent - s.num_written <= 64) &&
+        (s.num_rdw <= doublings(64) + WRITE_NUM_ITEMS / 64 + 1 +
+        doublings(WRITE_NUM_NEW)));
+    fails += check("  assigned sync ids handed back", s.ids_ok);
+    fails += check("  records written back", s.records_ok);
+
+    /* A Zaurus taking one item at a time is sent two at once only
+     * once for each write. */
+    memset(&s, 0, sizeof(struct session));
+    s.max_write_items = 1;
+    if (run(&s) != 0) { return 2; }
+    fails += check("items written one at a time", (s.result == 0) &&
+        (s.num_written == WRITE_NUM_ITEMS + WRITE_NUM_NEW) &&
+        (s.num_rdw == WRITE_NUM_ITEMS + WRITE_NUM_NEW) &&
+        (s.first_batch == 1) && (s.max_batch == 2) &&
+        (s.num_sent - s.num_written == 2));
+    fails += check("  assigned sync ids handed back", s.ids_ok);
+
+    printf("%d failure(s)\n", fails);
+
+    return fails ? 1 : 0;
+}